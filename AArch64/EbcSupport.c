@@ -20,11 +20,6 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "EbcExecute.h"
 #include "EbcDebuggerHook.h"
 
-//
-// Amount of space that is not used in the stack
-//
-#define STACK_REMAIN_SIZE (1024 * 4)
-
 #pragma pack(1)
 typedef struct {
   UINT32    Instr[3];
@@ -151,12 +146,12 @@ EbcInterpret (
   // Adjust the VM's stack pointer down.
   //
 
-  Status = GetEBCStack((EFI_HANDLE)(UINTN)-1, &VmContext.StackPool, &StackIndex);
+  Status = GetEBCStack (EbcFindImageHandle (Addr), &VmContext.StackPool, &StackIndex);
   if (EFI_ERROR(Status)) {
     return Status;
   }
   VmContext.StackTop = (UINT8*)VmContext.StackPool + (STACK_REMAIN_SIZE);
-  VmContext.Gpr[0] = (UINT64) ((UINT8*)VmContext.StackPool + STACK_POOL_SIZE);
+  VmContext.Gpr[0] = (UINT64) ((UINT8*)VmContext.StackPool + GetEBCStackSize (StackIndex));
   VmContext.HighStackBottom = (UINTN) VmContext.Gpr[0];
   VmContext.Gpr[0] -= sizeof (UINTN);
 
@@ -295,7 +290,7 @@ ExecuteEbcImageEntryPoint (
     return Status;
   }
   VmContext.StackTop = (UINT8*)VmContext.StackPool + (STACK_REMAIN_SIZE);
-  VmContext.Gpr[0] = (UINT64) ((UINT8*)VmContext.StackPool + STACK_POOL_SIZE);
+  VmContext.Gpr[0] = (UINT64) ((UINT8*)VmContext.StackPool + GetEBCStackSize (StackIndex));
   VmContext.HighStackBottom = (UINTN) VmContext.Gpr[0];
   VmContext.Gpr[0] -= sizeof (UINTN);
 
@@ -599,7 +599,7 @@ UpdateStackTrackerFromDelta (
   // Check if the updated R0 is still in our original stack buffer.
   //
   if ((StackTracker->OrgIndex == 0) && ((UpdatedR0 < (UINTN) VmPtr->StackPool) ||
-      (UpdatedR0 >= (UINTN) VmPtr->StackPool + STACK_POOL_SIZE))) {
+      (UpdatedR0 >= VmPtr->HighStackBottom))) {
     //
     // We are swicthing from the default stack buffer to a newly allocated
     // one. Keep track of our current stack tracker index in case we come
@@ -619,7 +619,7 @@ UpdateStackTrackerFromDelta (
   }
 
   if ((StackTracker->OrgIndex != 0) && ((UpdatedR0 >= (UINTN) VmPtr->StackPool) ||
-      (UpdatedR0 < (UINTN) VmPtr->StackPool + STACK_POOL_SIZE))) {
+      (UpdatedR0 < VmPtr->HighStackBottom))) {
     //
     // Coming back from a newly allocated stack to the original one
     // As we don't expect stack ops to have been properly balanced we just
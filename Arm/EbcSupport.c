@@ -21,11 +21,6 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "EbcExecute.h"
 #include "EbcDebuggerHook.h"
 
-//
-// Amount of space that is not used in the stack
-//
-#define STACK_REMAIN_SIZE (1024 * 4)
-
 #pragma pack(1)
 typedef struct {
   UINT32    Instr[2];
@@ -222,7 +217,7 @@ EbcInterpret (
   // Initialize the stack pointer for the EBC. Get the current system stack
   // pointer and adjust it down by the max needed for the interpreter.
   //
-  Status = GetEBCStack((EFI_HANDLE)(UINTN)-1, &VmContext.StackPool, &StackIndex);
+  Status = GetEBCStack (EbcFindImageHandle (Addr), &VmContext.StackPool, &StackIndex);
   if (EFI_ERROR(Status)) {
     FreeStackTracker(&VmContext);
     return Status;
@@ -232,7 +227,7 @@ EbcInterpret (
   // Adjust the VM's stack pointer down.
   //
   VmContext.StackTop = (UINT8*)VmContext.StackPool + STACK_REMAIN_SIZE;
-  VmContext.Gpr[0] = (UINT64)(UINTN) ((UINT8*)VmContext.StackPool + STACK_POOL_SIZE);
+  VmContext.Gpr[0] = (UINT64)(UINTN) ((UINT8*)VmContext.StackPool + GetEBCStackSize (StackIndex));
   VmContext.HighStackBottom = (UINTN) VmContext.Gpr[0];
   VmContext.Gpr[0] -= sizeof (UINTN);
 
@@ -410,7 +405,7 @@ ExecuteEbcImageEntryPoint (
     return Status;
   }
   VmContext.StackTop = (UINT8*)VmContext.StackPool + STACK_REMAIN_SIZE;
-  VmContext.Gpr[0] = (UINT64)(UINTN) ((UINT8*)VmContext.StackPool + STACK_POOL_SIZE);
+  VmContext.Gpr[0] = (UINT64)(UINTN) ((UINT8*)VmContext.StackPool + GetEBCStackSize (StackIndex));
   VmContext.HighStackBottom = (UINTN)VmContext.Gpr[0];
   VmContext.Gpr[0] -= sizeof (UINTN);
 
@@ -0,0 +1,466 @@
+/** @file
+  Direct dispatch of the EBC CALLEX instructions that target well-known boot
+  and runtime services.
+
+  The addresses of a set of gBS and gRT services are recorded whenever an EBC
+  image is started. A CALLEX to one of these addresses is then served by a C
+  function that reads the arguments straight from the VM stack and calls the
+  service, instead of going through the thunk check of EbcLLCALLEX and the
+  stack frame copy of EbcLLCALLEXNative.
+
+  Arguments are read the same way as the native code would get them: one
+  natural sized slot per argument, except for 64-bit values, which use 8 bytes
+  of the stack on 32-bit platforms.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "EbcInt.h"
+#include "EbcExecute.h"
+
+//
+// Indexes of the services in mEbcCallExServices[]
+//
+#define CALLEX_ALLOCATE_POOL      0
+#define CALLEX_FREE_POOL          1
+#define CALLEX_COPY_MEM           2
+#define CALLEX_SET_MEM            3
+#define CALLEX_LOCATE_PROTOCOL    4
+#define CALLEX_HANDLE_PROTOCOL    5
+#define CALLEX_OPEN_PROTOCOL      6
+#define CALLEX_CREATE_EVENT       7
+#define CALLEX_SET_TIMER          8
+#define CALLEX_WAIT_FOR_EVENT     9
+#define CALLEX_SIGNAL_EVENT       10
+#define CALLEX_CLOSE_EVENT        11
+#define CALLEX_CHECK_EVENT        12
+#define CALLEX_RAISE_TPL          13
+#define CALLEX_RESTORE_TPL        14
+#define CALLEX_STALL              15
+#define CALLEX_GET_TIME           16
+#define CALLEX_GET_VARIABLE       17
+#define CALLEX_SET_VARIABLE       18
+
+UINT64 CallExAllocatePool (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExFreePool (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExCopyMem (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExSetMem (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExLocateProtocol (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExHandleProtocol (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExOpenProtocol (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExCreateEvent (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExSetTimer (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExWaitForEvent (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExSignalEvent (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExCloseEvent (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExCheckEvent (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExRaiseTpl (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExRestoreTpl (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExStall (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExGetTime (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExGetVariable (IN UINTN FuncAddr, IN UINTN *Args);
+UINT64 CallExSetVariable (IN UINTN FuncAddr, IN UINTN *Args);
+
+//
+// The services that get a direct path. The order must match the CALLEX_xxx
+// indexes above.
+//
+EBC_CALLEX_SERVICE mEbcCallExServices[] = {
+  { L"gBS->AllocatePool",     CallExAllocatePool,     0, 0 },
+  { L"gBS->FreePool",         CallExFreePool,         0, 0 },
+  { L"gBS->CopyMem",          CallExCopyMem,          0, 0 },
+  { L"gBS->SetMem",           CallExSetMem,           0, 0 },
+  { L"gBS->LocateProtocol",   CallExLocateProtocol,   0, 0 },
+  { L"gBS->HandleProtocol",   CallExHandleProtocol,   0, 0 },
+  { L"gBS->OpenProtocol",     CallExOpenProtocol,     0, 0 },
+  { L"gBS->CreateEvent",      CallExCreateEvent,      0, 0 },
+  { L"gBS->SetTimer",         CallExSetTimer,         0, 0 },
+  { L"gBS->WaitForEvent",     CallExWaitForEvent,     0, 0 },
+  { L"gBS->SignalEvent",      CallExSignalEvent,      0, 0 },
+  { L"gBS->CloseEvent",       CallExCloseEvent,       0, 0 },
+  { L"gBS->CheckEvent",       CallExCheckEvent,       0, 0 },
+  { L"gBS->RaiseTPL",         CallExRaiseTpl,         0, 0 },
+  { L"gBS->RestoreTPL",       CallExRestoreTpl,       0, 0 },
+  { L"gBS->Stall",            CallExStall,            0, 0 },
+  { L"gRT->GetTime",          CallExGetTime,          0, 0 },
+  { L"gRT->GetVariable",      CallExGetVariable,      0, 0 },
+  { L"gRT->SetVariable",      CallExSetVariable,      0, 0 },
+};
+
+UINTN mEbcCallExServiceCount = ARRAY_SIZE (mEbcCallExServices);
+
+//
+// The services' addresses span, for a quick rejection of other targets
+//
+UINTN mEbcCallExLow  = (UINTN) -1;
+UINTN mEbcCallExHigh = 0;
+
+//
+// The direct paths. Each one takes the address of the service, which may not
+// be the current one from gBS or gRT, and the arguments from the VM stack, and
+// returns what the native call would have left in R7.
+//
+
+UINT64
+CallExAllocatePool (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  return (UINT64) ((EFI_ALLOCATE_POOL) FuncAddr) (
+                    (EFI_MEMORY_TYPE) Args[0],
+                    Args[1],
+                    (VOID **) Args[2]
+                    );
+}
+
+UINT64
+CallExFreePool (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  return (UINT64) ((EFI_FREE_POOL) FuncAddr) ((VOID *) Args[0]);
+}
+
+UINT64
+CallExCopyMem (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  ((EFI_COPY_MEM) FuncAddr) ((VOID *) Args[0], (VOID *) Args[1], Args[2]);
+  return 0;
+}
+
+UINT64
+CallExSetMem (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  ((EFI_SET_MEM) FuncAddr) ((VOID *) Args[0], Args[1], (UINT8) Args[2]);
+  return 0;
+}
+
+UINT64
+CallExLocateProtocol (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  return (UINT64) ((EFI_LOCATE_PROTOCOL) FuncAddr) (
+                    (EFI_GUID *) Args[0],
+                    (VOID *) Args[1],
+                    (VOID **) Args[2]
+                    );
+}
+
+UINT64
+CallExHandleProtocol (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  return (UINT64) ((EFI_HANDLE_PROTOCOL) FuncAddr) (
+                    (EFI_HANDLE) Args[0],
+                    (EFI_GUID *) Args[1],
+                    (VOID **) Args[2]
+                    );
+}
+
+UINT64
+CallExOpenProtocol (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  return (UINT64) ((EFI_OPEN_PROTOCOL) FuncAddr) (
+                    (EFI_HANDLE) Args[0],
+                    (EFI_GUID *) Args[1],
+                    (VOID **) Args[2],
+                    (EFI_HANDLE) Args[3],
+                    (EFI_HANDLE) Args[4],
+                    (UINT32) Args[5]
+                    );
+}
+
+UINT64
+CallExCreateEvent (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  return (UINT64) ((EFI_CREATE_EVENT) FuncAddr) (
+                    (UINT32) Args[0],
+                    (EFI_TPL) Args[1],
+                    (EFI_EVENT_NOTIFY) Args[2],
+                    (VOID *) Args[3],
+                    (EFI_EVENT *) Args[4]
+                    );
+}
+
+UINT64
+CallExSetTimer (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  UINT64  TriggerTime;
+
+  //
+  // The trigger time takes two slots on 32-bit platforms
+  //
+  CopyMem (&TriggerTime, &Args[2], sizeof (UINT64));
+  return (UINT64) ((EFI_SET_TIMER) FuncAddr) (
+                    (EFI_EVENT) Args[0],
+                    (EFI_TIMER_DELAY) Args[1],
+                    TriggerTime
+                    );
+}
+
+UINT64
+CallExWaitForEvent (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  return (UINT64) ((EFI_WAIT_FOR_EVENT) FuncAddr) (
+                    Args[0],
+                    (EFI_EVENT *) Args[1],
+                    (UINTN *) Args[2]
+                    );
+}
+
+UINT64
+CallExSignalEvent (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  return (UINT64) ((EFI_SIGNAL_EVENT) FuncAddr) ((EFI_EVENT) Args[0]);
+}
+
+UINT64
+CallExCloseEvent (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  return (UINT64) ((EFI_CLOSE_EVENT) FuncAddr) ((EFI_EVENT) Args[0]);
+}
+
+UINT64
+CallExCheckEvent (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  return (UINT64) ((EFI_CHECK_EVENT) FuncAddr) ((EFI_EVENT) Args[0]);
+}
+
+UINT64
+CallExRaiseTpl (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  return (UINT64) ((EFI_RAISE_TPL) FuncAddr) ((EFI_TPL) Args[0]);
+}
+
+UINT64
+CallExRestoreTpl (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  ((EFI_RESTORE_TPL) FuncAddr) ((EFI_TPL) Args[0]);
+  return 0;
+}
+
+UINT64
+CallExStall (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  return (UINT64) ((EFI_STALL) FuncAddr) (Args[0]);
+}
+
+UINT64
+CallExGetTime (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  return (UINT64) ((EFI_GET_TIME) FuncAddr) (
+                    (EFI_TIME *) Args[0],
+                    (EFI_TIME_CAPABILITIES *) Args[1]
+                    );
+}
+
+UINT64
+CallExGetVariable (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  return (UINT64) ((EFI_GET_VARIABLE) FuncAddr) (
+                    (CHAR16 *) Args[0],
+                    (EFI_GUID *) Args[1],
+                    (UINT32 *) Args[2],
+                    (UINTN *) Args[3],
+                    (VOID *) Args[4]
+                    );
+}
+
+UINT64
+CallExSetVariable (
+  IN UINTN  FuncAddr,
+  IN UINTN  *Args
+  )
+{
+  return (UINT64) ((EFI_SET_VARIABLE) FuncAddr) (
+                    (CHAR16 *) Args[0],
+                    (EFI_GUID *) Args[1],
+                    (UINT32) Args[2],
+                    Args[3],
+                    (VOID *) Args[4]
+                    );
+}
+
+/**
+  Record the current addresses of the services that CALLEX can call directly.
+  This is called each time an EBC image is started, so that services that got
+  replaced in the meantime are picked up.
+
+**/
+VOID
+EbcInitCallExServices (
+  VOID
+  )
+{
+  UINTN   Index;
+  UINTN   Low;
+  UINTN   High;
+
+  mEbcCallExServices[CALLEX_ALLOCATE_POOL].FuncAddr   = (UINTN) gBS->AllocatePool;
+  mEbcCallExServices[CALLEX_FREE_POOL].FuncAddr       = (UINTN) gBS->FreePool;
+  mEbcCallExServices[CALLEX_COPY_MEM].FuncAddr        = (UINTN) gBS->CopyMem;
+  mEbcCallExServices[CALLEX_SET_MEM].FuncAddr         = (UINTN) gBS->SetMem;
+  mEbcCallExServices[CALLEX_LOCATE_PROTOCOL].FuncAddr = (UINTN) gBS->LocateProtocol;
+  mEbcCallExServices[CALLEX_HANDLE_PROTOCOL].FuncAddr = (UINTN) gBS->HandleProtocol;
+  mEbcCallExServices[CALLEX_OPEN_PROTOCOL].FuncAddr   = (UINTN) gBS->OpenProtocol;
+  mEbcCallExServices[CALLEX_CREATE_EVENT].FuncAddr    = (UINTN) gBS->CreateEvent;
+  mEbcCallExServices[CALLEX_SET_TIMER].FuncAddr       = (UINTN) gBS->SetTimer;
+  mEbcCallExServices[CALLEX_WAIT_FOR_EVENT].FuncAddr  = (UINTN) gBS->WaitForEvent;
+  mEbcCallExServices[CALLEX_SIGNAL_EVENT].FuncAddr    = (UINTN) gBS->SignalEvent;
+  mEbcCallExServices[CALLEX_CLOSE_EVENT].FuncAddr     = (UINTN) gBS->CloseEvent;
+  mEbcCallExServices[CALLEX_CHECK_EVENT].FuncAddr     = (UINTN) gBS->CheckEvent;
+  mEbcCallExServices[CALLEX_RAISE_TPL].FuncAddr       = (UINTN) gBS->RaiseTPL;
+  mEbcCallExServices[CALLEX_RESTORE_TPL].FuncAddr     = (UINTN) gBS->RestoreTPL;
+  mEbcCallExServices[CALLEX_STALL].FuncAddr           = (UINTN) gBS->Stall;
+  mEbcCallExServices[CALLEX_GET_TIME].FuncAddr        = (UINTN) gRT->GetTime;
+  mEbcCallExServices[CALLEX_GET_VARIABLE].FuncAddr    = (UINTN) gRT->GetVariable;
+  mEbcCallExServices[CALLEX_SET_VARIABLE].FuncAddr    = (UINTN) gRT->SetVariable;
+
+  Low  = (UINTN) -1;
+  High = 0;
+  for (Index = 0; Index < mEbcCallExServiceCount; Index++) {
+    if (mEbcCallExServices[Index].FuncAddr < Low) {
+      Low = mEbcCallExServices[Index].FuncAddr;
+    }
+    if (mEbcCallExServices[Index].FuncAddr > High) {
+      High = mEbcCallExServices[Index].FuncAddr;
+    }
+  }
+  mEbcCallExLow  = Low;
+  mEbcCallExHigh = High;
+}
+
+/**
+  Reset the call counts of the services that CALLEX can call directly.
+
+**/
+VOID
+EbcResetCallExServices (
+  VOID
+  )
+{
+  UINTN   Index;
+
+  for (Index = 0; Index < mEbcCallExServiceCount; Index++) {
+    mEbcCallExServices[Index].Count = 0;
+  }
+}
+
+/**
+  Execute a CALLEX to native code, through a direct path if the target is one
+  of the well-known services, or through EbcLLCALLEX otherwise.
+
+  @param  VmPtr             A pointer to a VM context.
+  @param  FuncAddr          Address of the function to call.
+  @param  NewStackPointer   New stack pointer after the call.
+  @param  FramePtr          New frame pointer after the call.
+  @param  Size              The size of the instruction.
+
+**/
+VOID
+EbcCallEx (
+  IN VM_CONTEXT   *VmPtr,
+  IN UINTN        FuncAddr,
+  IN UINTN        NewStackPointer,
+  IN VOID         *FramePtr,
+  IN UINT8        Size
+  )
+{
+  UINTN   Index;
+  VMIP    NextIp;
+#if EBC_PERFORMANCE_COUNTERS
+  UINT64  Start;
+
+  Start  = (mEbcVmPrivate->PerfCounters != NULL) ? EbcReadClock (NULL) : 0;
+#endif
+  NextIp = VmPtr->Ip + Size;
+
+  if ((FuncAddr >= mEbcCallExLow) && (FuncAddr <= mEbcCallExHigh)) {
+    for (Index = 0; Index < mEbcCallExServiceCount; Index++) {
+      if (mEbcCallExServices[Index].FuncAddr == FuncAddr) {
+        mEbcCallExServices[Index].Count++;
+        VmPtr->Gpr[7] = mEbcCallExServices[Index].Handler (FuncAddr, (UINTN *) NewStackPointer);
+        VmPtr->Ip += Size;
+        if (mEbcVirtualClock) {
+          mEbcVirtualTime += EBC_VIRTUAL_CALLEX_COST;
+        }
+#if EBC_PERFORMANCE_COUNTERS
+        EbcPerfCallEx (mEbcVmPrivate, FuncAddr, EBC_CALLEX_DIRECT, Start);
+#endif
+        return;
+      }
+    }
+  }
+
+  EbcLLCALLEX (VmPtr, FuncAddr, NewStackPointer, FramePtr, Size);
+
+  //
+  // EbcLLCALLEX only moves the IP past the CALLEX for a native call, and to
+  // the EBC code for a thunk. The virtual clock only charges the native
+  // code, as the EBC code it calls back advances the clock on its own.
+  //
+  if (mEbcVirtualClock && (VmPtr->Ip == NextIp)) {
+    mEbcVirtualTime += EBC_VIRTUAL_CALLEX_COST;
+  }
+
+#if EBC_PERFORMANCE_COUNTERS
+  EbcPerfCallEx (mEbcVmPrivate, FuncAddr, (VmPtr->Ip == NextIp) ? EBC_CALLEX_NATIVE : EBC_CALLEX_THUNK, Start);
+#endif
+}
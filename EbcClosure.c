@@ -0,0 +1,857 @@
+/** @file
+  Closure-compiled execution of hot EBC code.
+
+  When a branch target or an entry point has been reached often enough, the
+  straight-line run of instructions that starts there is decoded once into a
+  block of pre-bound handler calls, with all the operands, indexes, immediate
+  data and masks already resolved. Running the block then only calls each of
+  the handlers in turn, which avoids the fetch, dispatch and decoding work of
+  the interpreter, on any architecture, and without generating native code.
+
+  Only the moves, compares and data manipulations that can never raise an
+  exception, and that don't modify R0 directly, are compiled. The block stops
+  at the first other instruction, which is left to the interpreter, so that
+  branches, calls, stack tracking and exceptions all behave exactly as they
+  do without this tier.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "EbcInt.h"
+#include "EbcExecute.h"
+
+//
+// Maximum number of instructions in a block
+//
+#define CLOSURE_MAX_OPS         16
+//
+// Number of blocks that the cache can hold. Must be a power of 2.
+//
+#define CLOSURE_CACHE_SIZE      64
+//
+// Number of execution counters. Must be a power of 2.
+//
+#define CLOSURE_HOT_SIZE        1024
+//
+// Number of times a block head must be reached before it gets compiled
+//
+#define CLOSURE_HOT_THRESHOLD   32
+
+//
+// Operand flags
+//
+#define CLOSURE_FLAG_64BIT      0x01  // 64-bit compare or data manipulation
+#define CLOSURE_FLAG_SIGNED     0x02  // sign-extend 32-bit operands
+#define CLOSURE_FLAG_INDIRECT1  0x04  // operand 1 is @R1 + Index1
+#define CLOSURE_FLAG_INDIRECT2  0x08  // operand 2 is @R2 + Index2
+#define CLOSURE_FLAG_IMMEDIATE  0x10  // operand 2 is the constant Index2
+#define CLOSURE_FLAG_MEMORY     0x20  // the instruction accesses memory
+
+//
+// Size of the natural memory accesses
+//
+#define CLOSURE_SIZE_N          0
+
+typedef struct _CLOSURE_OP  CLOSURE_OP;
+
+typedef
+VOID
+(*CLOSURE_HANDLER) (
+  IN VM_CONTEXT   *VmPtr,
+  IN CLOSURE_OP   *Op
+  );
+
+struct _CLOSURE_OP {
+  CLOSURE_HANDLER           Handler;
+  DATA_MANIP_EXEC_FUNCTION  Function;   ///< computation of data manipulations
+  UINT64                    Mask;       ///< mask of a register destination
+  INT64                     Index1;     ///< index of operand 1
+  INT64                     Index2;     ///< index or immediate data of operand 2
+  UINT8                     Size;       ///< size of the instruction
+  UINT8                     Reg1;
+  UINT8                     Reg2;
+  UINT8                     DataSize;   ///< size of memory accesses, in bytes
+  UINT8                     Cond;       ///< condition of compares, as a CMP opcode
+  UINT8                     Flags;
+};
+
+typedef struct {
+  VMIP        Head;
+  UINTN       OpCount;                  ///< 0 if the head can't be compiled
+  CLOSURE_OP  Op[CLOSURE_MAX_OPS];
+} CLOSURE_BLOCK;
+
+CLOSURE_BLOCK mClosureCache[CLOSURE_CACHE_SIZE];
+UINT16        mClosureHot[CLOSURE_HOT_SIZE];
+
+//
+// Number of VMs that are currently running blocks. An EBC call from an event
+// may interrupt a block, in which case the cache must be left alone until the
+// block is done. Nested calls always restore the count before they return, so
+// it can be updated without raising the TPL.
+//
+volatile UINTN    mClosureBusy;
+volatile BOOLEAN  mClosureFlushPending;
+
+/**
+  Read memory, the same way as the VmReadMem functions do.
+
+  @param  VmPtr             A pointer to a VM context.
+  @param  Addr              The address to read from.
+  @param  DataSize          The size of the access, in bytes.
+
+  @return The zero-extended data.
+
+**/
+UINT64
+ClosureRead (
+  IN VM_CONTEXT *VmPtr,
+  IN UINTN      Addr,
+  IN UINT8      DataSize
+  )
+{
+  switch (DataSize) {
+  case 1:
+    return (UINT64) VmReadMem8 (VmPtr, Addr);
+  case 2:
+    return (UINT64) VmReadMem16 (VmPtr, Addr);
+  case 4:
+    return (UINT64) VmReadMem32 (VmPtr, Addr);
+  case 8:
+    return VmReadMem64 (VmPtr, Addr);
+  default:
+    return (UINT64) VmReadMemN (VmPtr, Addr);
+  }
+}
+
+/**
+  Write memory, the same way as the VmWriteMem functions do.
+
+  @param  VmPtr             A pointer to a VM context.
+  @param  Addr              The address to write to.
+  @param  DataSize          The size of the access, in bytes.
+  @param  Data              The data to write, truncated to DataSize.
+
+**/
+VOID
+ClosureWrite (
+  IN VM_CONTEXT *VmPtr,
+  IN UINTN      Addr,
+  IN UINT8      DataSize,
+  IN UINT64     Data
+  )
+{
+  switch (DataSize) {
+  case 1:
+    VmWriteMem8 (VmPtr, Addr, (UINT8) Data);
+    break;
+  case 2:
+    VmWriteMem16 (VmPtr, Addr, (UINT16) Data);
+    break;
+  case 4:
+    VmWriteMem32 (VmPtr, Addr, (UINT32) Data);
+    break;
+  case 8:
+    VmWriteMem64 (VmPtr, Addr, Data);
+    break;
+  default:
+    VmWriteMemN (VmPtr, Addr, (UINTN) Data);
+    break;
+  }
+}
+
+/**
+  Run a MOVxx, MOVI, MOVIn or MOVREL instruction.
+
+  @param  VmPtr             A pointer to a VM context.
+  @param  Op                The compiled instruction.
+
+**/
+VOID
+ClosureMove (
+  IN VM_CONTEXT   *VmPtr,
+  IN CLOSURE_OP   *Op
+  )
+{
+  UINT64  Data;
+
+  if ((Op->Flags & CLOSURE_FLAG_IMMEDIATE) != 0) {
+    Data = (UINT64) Op->Index2;
+  } else if ((Op->Flags & CLOSURE_FLAG_INDIRECT2) != 0) {
+    Data = ClosureRead (VmPtr, (UINTN) (VmPtr->Gpr[Op->Reg2] + Op->Index2), Op->DataSize);
+  } else {
+    Data = (UINT64) (VmPtr->Gpr[Op->Reg2] + Op->Index2);
+  }
+
+  if ((Op->Flags & CLOSURE_FLAG_INDIRECT1) != 0) {
+    ClosureWrite (VmPtr, (UINTN) (VmPtr->Gpr[Op->Reg1] + Op->Index1), Op->DataSize, Data);
+  } else {
+    VmPtr->Gpr[Op->Reg1] = Data & Op->Mask;
+  }
+  VmPtr->Ip += Op->Size;
+}
+
+/**
+  Run a CMP or CMPI instruction.
+
+  @param  VmPtr             A pointer to a VM context.
+  @param  Op                The compiled instruction.
+
+**/
+VOID
+ClosureCompare (
+  IN VM_CONTEXT   *VmPtr,
+  IN CLOSURE_OP   *Op
+  )
+{
+  INT64   Op1;
+  INT64   Op2;
+  BOOLEAN Flag;
+
+  Op1 = VmPtr->Gpr[Op->Reg1];
+  if ((Op->Flags & CLOSURE_FLAG_INDIRECT1) != 0) {
+    Op1 = (INT64) ClosureRead (VmPtr, (UINTN) (Op1 + Op->Index1), Op->DataSize);
+  }
+  if ((Op->Flags & CLOSURE_FLAG_IMMEDIATE) != 0) {
+    Op2 = Op->Index2;
+  } else if ((Op->Flags & CLOSURE_FLAG_INDIRECT2) != 0) {
+    Op2 = (INT64) ClosureRead (VmPtr, (UINTN) (VmPtr->Gpr[Op->Reg2] + Op->Index2), Op->DataSize);
+  } else {
+    Op2 = VmPtr->Gpr[Op->Reg2] + Op->Index2;
+  }
+
+  if ((Op->Flags & CLOSURE_FLAG_64BIT) != 0) {
+    switch (Op->Cond) {
+    case OPCODE_CMPEQ:
+      Flag = (BOOLEAN) (Op1 == Op2);
+      break;
+    case OPCODE_CMPLTE:
+      Flag = (BOOLEAN) (Op1 <= Op2);
+      break;
+    case OPCODE_CMPGTE:
+      Flag = (BOOLEAN) (Op1 >= Op2);
+      break;
+    case OPCODE_CMPULTE:
+      Flag = (BOOLEAN) ((UINT64) Op1 <= (UINT64) Op2);
+      break;
+    default:
+      Flag = (BOOLEAN) ((UINT64) Op1 >= (UINT64) Op2);
+      break;
+    }
+  } else {
+    switch (Op->Cond) {
+    case OPCODE_CMPEQ:
+      Flag = (BOOLEAN) ((INT32) Op1 == (INT32) Op2);
+      break;
+    case OPCODE_CMPLTE:
+      Flag = (BOOLEAN) ((INT32) Op1 <= (INT32) Op2);
+      break;
+    case OPCODE_CMPGTE:
+      Flag = (BOOLEAN) ((INT32) Op1 >= (INT32) Op2);
+      break;
+    case OPCODE_CMPULTE:
+      Flag = (BOOLEAN) ((UINT32) Op1 <= (UINT32) Op2);
+      break;
+    default:
+      Flag = (BOOLEAN) ((UINT32) Op1 >= (UINT32) Op2);
+      break;
+    }
+  }
+
+  if (Flag) {
+    VMFLAG_SET (VmPtr, VMFLAGS_CC);
+  } else {
+    VMFLAG_CLEAR (VmPtr, (UINT64)VMFLAGS_CC);
+  }
+  VmPtr->Ip += Op->Size;
+}
+
+/**
+  Run a data manipulation instruction, the same way as ExecuteDataManip().
+
+  @param  VmPtr             A pointer to a VM context.
+  @param  Op                The compiled instruction.
+
+**/
+VOID
+ClosureDataManip (
+  IN VM_CONTEXT   *VmPtr,
+  IN CLOSURE_OP   *Op
+  )
+{
+  UINT64  Op1;
+  UINT64  Op2;
+
+  Op2 = (UINT64) VmPtr->Gpr[Op->Reg2] + Op->Index2;
+  if ((Op->Flags & CLOSURE_FLAG_INDIRECT2) != 0) {
+    Op2 = ClosureRead (VmPtr, (UINTN) Op2, Op->DataSize);
+  }
+  Op1 = (UINT64) VmPtr->Gpr[Op->Reg1];
+  if ((Op->Flags & CLOSURE_FLAG_INDIRECT1) != 0) {
+    Op1 = ClosureRead (VmPtr, (UINTN) Op1, Op->DataSize);
+  }
+  if ((Op->Flags & CLOSURE_FLAG_64BIT) == 0) {
+    if ((Op->Flags & CLOSURE_FLAG_SIGNED) != 0) {
+      Op1 = (UINT64) (INT64) ((INT32) Op1);
+      Op2 = (UINT64) (INT64) ((INT32) Op2);
+    } else {
+      Op1 = (UINT64) ((UINT32) Op1);
+      Op2 = (UINT64) ((UINT32) Op2);
+    }
+  }
+
+  Op2 = Op->Function (VmPtr, Op1, Op2);
+
+  if ((Op->Flags & CLOSURE_FLAG_INDIRECT1) != 0) {
+    ClosureWrite (VmPtr, (UINTN) VmPtr->Gpr[Op->Reg1], Op->DataSize, Op2);
+  } else {
+    VmPtr->Gpr[Op->Reg1] = Op2 & Op->Mask;
+  }
+  VmPtr->Ip += Op->Size;
+}
+
+/**
+  Compile a MOVxx instruction.
+
+  @param  VmPtr             A pointer to a VM context, with its IP set to the
+                            instruction to compile.
+  @param  Op                The compiled instruction.
+
+  @return The size of the instruction, or 0 if it can't be compiled.
+
+**/
+UINT8
+ClosureCompileMOVxx (
+  IN  VM_CONTEXT  *VmPtr,
+  OUT CLOSURE_OP  *Op
+  )
+{
+  UINT8   Opcode;
+  UINT8   OpcMasked;
+  UINT8   Operands;
+  UINT8   Size;
+
+  Opcode    = GETOPCODE (VmPtr);
+  OpcMasked = (UINT8) (Opcode & OPCODE_M_OPCODE);
+  Operands  = GETOPERANDS (VmPtr);
+
+  Size = 2;
+  if ((OpcMasked <= OPCODE_MOVQW) || (OpcMasked == OPCODE_MOVNW)) {
+    if ((Opcode & OPCODE_M_IMMED_OP1) != 0) {
+      Op->Index1 = VmReadIndex16 (VmPtr, Size, NULL);
+      Size += sizeof (UINT16);
+    }
+    if ((Opcode & OPCODE_M_IMMED_OP2) != 0) {
+      Op->Index2 = VmReadIndex16 (VmPtr, Size, NULL);
+      Size += sizeof (UINT16);
+    }
+  } else if ((OpcMasked <= OPCODE_MOVQD) || (OpcMasked == OPCODE_MOVND)) {
+    if ((Opcode & OPCODE_M_IMMED_OP1) != 0) {
+      Op->Index1 = VmReadIndex32 (VmPtr, Size, NULL);
+      Size += sizeof (UINT32);
+    }
+    if ((Opcode & OPCODE_M_IMMED_OP2) != 0) {
+      Op->Index2 = VmReadIndex32 (VmPtr, Size, NULL);
+      Size += sizeof (UINT32);
+    }
+  } else if (OpcMasked == OPCODE_MOVQQ) {
+    if ((Opcode & OPCODE_M_IMMED_OP1) != 0) {
+      Op->Index1 = VmReadIndex64 (VmPtr, Size, NULL);
+      Size += sizeof (UINT64);
+    }
+    if ((Opcode & OPCODE_M_IMMED_OP2) != 0) {
+      Op->Index2 = VmReadIndex64 (VmPtr, Size, NULL);
+      Size += sizeof (UINT64);
+    }
+  } else {
+    return 0;
+  }
+
+  switch (OpcMasked) {
+  case OPCODE_MOVBW:
+  case OPCODE_MOVBD:
+    Op->DataSize = 1;
+    Op->Mask     = 0xFF;
+    break;
+  case OPCODE_MOVWW:
+  case OPCODE_MOVWD:
+    Op->DataSize = 2;
+    Op->Mask     = 0xFFFF;
+    break;
+  case OPCODE_MOVDW:
+  case OPCODE_MOVDD:
+    Op->DataSize = 4;
+    Op->Mask     = 0xFFFFFFFF;
+    break;
+  case OPCODE_MOVNW:
+  case OPCODE_MOVND:
+    Op->DataSize = CLOSURE_SIZE_N;
+    Op->Mask     = (UINT64)~0 >> (64 - 8 * sizeof (UINTN));
+    break;
+  default:
+    Op->DataSize = 8;
+    Op->Mask     = (UINT64)~0;
+    break;
+  }
+
+  //
+  // Leave invalid encodings, direct writes to R0 and the stack gap special
+  // case of ExecuteMOVxx() to the interpreter.
+  //
+  if (!OPERAND1_INDIRECT (Operands)) {
+    if (((Opcode & OPCODE_M_IMMED_OP1) != 0) || (OPERAND1_REGNUM (Operands) == 0)) {
+      return 0;
+    }
+  } else if ((OPERAND1_REGNUM (Operands) == 0) && (OPERAND2_REGNUM (Operands) == 0) &&
+             !OPERAND2_INDIRECT (Operands) && (Op->Index2 > 0)) {
+    return 0;
+  }
+
+  Op->Handler = ClosureMove;
+  Op->Reg1    = OPERAND1_REGNUM (Operands);
+  Op->Reg2    = OPERAND2_REGNUM (Operands);
+  if (OPERAND1_INDIRECT (Operands)) {
+    Op->Flags |= CLOSURE_FLAG_INDIRECT1 | CLOSURE_FLAG_MEMORY;
+  }
+  if (OPERAND2_INDIRECT (Operands)) {
+    Op->Flags |= CLOSURE_FLAG_INDIRECT2 | CLOSURE_FLAG_MEMORY;
+  }
+  return Size;
+}
+
+/**
+  Compile a MOVI, MOVIn or MOVREL instruction, which all move a constant.
+
+  @param  VmPtr             A pointer to a VM context, with its IP set to the
+                            instruction to compile.
+  @param  Op                The compiled instruction.
+
+  @return The size of the instruction, or 0 if it can't be compiled.
+
+**/
+UINT8
+ClosureCompileMOVI (
+  IN  VM_CONTEXT  *VmPtr,
+  OUT CLOSURE_OP  *Op
+  )
+{
+  UINT8   Opcode;
+  UINT8   OpcMasked;
+  UINT8   Operands;
+  UINT8   Size;
+  INT64   Data;
+
+  Opcode    = GETOPCODE (VmPtr);
+  OpcMasked = (UINT8) (Opcode & OPCODE_M_OPCODE);
+  Operands  = GETOPERANDS (VmPtr);
+
+  Size = 2;
+  if ((Operands & MOVI_M_IMMDATA) != 0) {
+    if (!OPERAND1_INDIRECT (Operands)) {
+      return 0;
+    }
+    Op->Index1 = VmReadIndex16 (VmPtr, 2, NULL);
+    Size += sizeof (UINT16);
+  }
+  if (!OPERAND1_INDIRECT (Operands) && (OPERAND1_REGNUM (Operands) == 0)) {
+    return 0;
+  }
+
+  //
+  // Read the data the same way as the interpreter does for each instruction
+  //
+  switch (Opcode & MOVI_M_DATAWIDTH) {
+  case MOVI_DATAWIDTH16:
+    if (OpcMasked == OPCODE_MOVIN) {
+      Data = VmReadIndex16 (VmPtr, Size, NULL);
+    } else {
+      Data = (INT64) (INT16) VmReadImmed16 (VmPtr, Size);
+    }
+    Size += sizeof (UINT16);
+    break;
+  case MOVI_DATAWIDTH32:
+    if (OpcMasked == OPCODE_MOVIN) {
+      Data = VmReadIndex32 (VmPtr, Size, NULL);
+    } else {
+      Data = (INT64) VmReadImmed32 (VmPtr, Size);
+    }
+    Size += sizeof (UINT32);
+    break;
+  case MOVI_DATAWIDTH64:
+    if (OpcMasked == OPCODE_MOVIN) {
+      Data = VmReadIndex64 (VmPtr, Size, NULL);
+    } else {
+      Data = (INT64) VmReadImmed64 (VmPtr, Size);
+    }
+    Size += sizeof (UINT64);
+    break;
+  default:
+    return 0;
+  }
+
+  Op->Mask     = (UINT64)~0;
+  Op->DataSize = CLOSURE_SIZE_N;
+  if (OpcMasked == OPCODE_MOVI) {
+    switch (Operands & MOVI_M_MOVEWIDTH) {
+    case MOVI_MOVEWIDTH8:
+      Op->DataSize = 1;
+      Op->Mask     = 0xFF;
+      break;
+    case MOVI_MOVEWIDTH16:
+      Op->DataSize = 2;
+      Op->Mask     = 0xFFFF;
+      break;
+    case MOVI_MOVEWIDTH32:
+      Op->DataSize = 4;
+      Op->Mask     = 0xFFFFFFFF;
+      break;
+    default:
+      Op->DataSize = 8;
+      break;
+    }
+  } else if (OpcMasked == OPCODE_MOVREL) {
+    Data = (INT64) ((UINT64) (UINTN) VmPtr->Ip) + Data + Size;
+  }
+
+  Op->Handler = ClosureMove;
+  Op->Reg1    = OPERAND1_REGNUM (Operands);
+  Op->Index2  = Data;
+  Op->Flags   = CLOSURE_FLAG_IMMEDIATE;
+  if (OPERAND1_INDIRECT (Operands)) {
+    Op->Flags |= CLOSURE_FLAG_INDIRECT1 | CLOSURE_FLAG_MEMORY;
+  }
+  return Size;
+}
+
+/**
+  Compile a CMP or CMPI instruction.
+
+  @param  VmPtr             A pointer to a VM context, with its IP set to the
+                            instruction to compile.
+  @param  Op                The compiled instruction.
+
+  @return The size of the instruction, or 0 if it can't be compiled.
+
+**/
+UINT8
+ClosureCompileCMP (
+  IN  VM_CONTEXT  *VmPtr,
+  OUT CLOSURE_OP  *Op
+  )
+{
+  UINT8   Opcode;
+  UINT8   OpcMasked;
+  UINT8   Operands;
+  UINT8   Size;
+
+  Opcode    = GETOPCODE (VmPtr);
+  OpcMasked = (UINT8) (Opcode & OPCODE_M_OPCODE);
+  Operands  = GETOPERANDS (VmPtr);
+
+  Op->Handler  = ClosureCompare;
+  Op->Reg1     = OPERAND1_REGNUM (Operands);
+  Op->Reg2     = OPERAND2_REGNUM (Operands);
+  Size         = 2;
+
+  if (OpcMasked <= OPCODE_CMPUGTE) {
+    Op->Cond = OpcMasked;
+    if ((Opcode & OPCODE_M_64BIT) != 0) {
+      Op->Flags   |= CLOSURE_FLAG_64BIT;
+      Op->DataSize = 8;
+    } else {
+      Op->DataSize = 4;
+    }
+    if ((Opcode & OPCODE_M_IMMDATA) != 0) {
+      if (OPERAND2_INDIRECT (Operands)) {
+        Op->Index2 = VmReadIndex16 (VmPtr, 2, NULL);
+      } else {
+        Op->Index2 = VmReadImmed16 (VmPtr, 2);
+      }
+      Size += sizeof (UINT16);
+    }
+    if (OPERAND2_INDIRECT (Operands)) {
+      Op->Flags |= CLOSURE_FLAG_INDIRECT2 | CLOSURE_FLAG_MEMORY;
+    }
+    return Size;
+  }
+
+  //
+  // CMPI compares are in the same order as the CMP ones
+  //
+  Op->Cond = (UINT8) (OpcMasked - OPCODE_CMPIEQ + OPCODE_CMPEQ);
+  if ((Opcode & OPCODE_M_CMPI64) != 0) {
+    Op->Flags   |= CLOSURE_FLAG_64BIT;
+    Op->DataSize = 8;
+  } else {
+    Op->DataSize = 4;
+  }
+  if ((Operands & OPERAND_M_CMPI_INDEX) != 0) {
+    if (!OPERAND1_INDIRECT (Operands)) {
+      return 0;
+    }
+    Op->Index1 = VmReadIndex16 (VmPtr, 2, NULL);
+    Size += sizeof (UINT16);
+  }
+  if (OPERAND1_INDIRECT (Operands)) {
+    Op->Flags |= CLOSURE_FLAG_INDIRECT1 | CLOSURE_FLAG_MEMORY;
+  }
+  if ((Opcode & OPCODE_M_CMPI32_DATA) != 0) {
+    Op->Index2 = (INT64) VmReadImmed32 (VmPtr, Size);
+    Size += sizeof (UINT32);
+  } else {
+    Op->Index2 = (INT64) ((INT16) VmReadImmed16 (VmPtr, Size));
+    Size += sizeof (UINT16);
+  }
+  //
+  // 64-bit unsigned CMPI compares against the zero-extended 32-bit data
+  //
+  if (((Op->Flags & CLOSURE_FLAG_64BIT) != 0) &&
+      ((Op->Cond == OPCODE_CMPULTE) || (Op->Cond == OPCODE_CMPUGTE))) {
+    Op->Index2 = (INT64) (UINT64) ((UINT32) Op->Index2);
+  }
+  Op->Flags |= CLOSURE_FLAG_IMMEDIATE;
+  return Size;
+}
+
+/**
+  Compile a data manipulation instruction.
+
+  @param  VmPtr             A pointer to a VM context, with its IP set to the
+                            instruction to compile.
+  @param  Op                The compiled instruction.
+
+  @return The size of the instruction, or 0 if it can't be compiled.
+
+**/
+UINT8
+ClosureCompileDataManip (
+  IN  VM_CONTEXT  *VmPtr,
+  OUT CLOSURE_OP  *Op
+  )
+{
+  UINT8   Opcode;
+  UINT8   OpcMasked;
+  UINT8   Operands;
+  UINT8   Size;
+
+  Opcode    = GETOPCODE (VmPtr);
+  OpcMasked = (UINT8) (Opcode & OPCODE_M_OPCODE);
+  Operands  = GETOPERANDS (VmPtr);
+
+  //
+  // Divisions may raise an exception, and R0 must be checked against the
+  // stack limits when it is written.
+  //
+  if ((OpcMasked >= OPCODE_DIV) && (OpcMasked <= OPCODE_MODU)) {
+    return 0;
+  }
+  if (!OPERAND1_INDIRECT (Operands) && (OPERAND1_REGNUM (Operands) == 0)) {
+    return 0;
+  }
+
+  Size = 2;
+  if ((Opcode & DATAMANIP_M_IMMDATA) != 0) {
+    if (OPERAND2_INDIRECT (Operands)) {
+      Op->Index2 = VmReadIndex16 (VmPtr, 2, NULL);
+    } else {
+      Op->Index2 = VmReadImmed16 (VmPtr, 2);
+    }
+    Size += sizeof (UINT16);
+  }
+
+  Op->Handler  = ClosureDataManip;
+  Op->Function = mDataManipDispatchTable[OpcMasked - OPCODE_NOT];
+  Op->Reg1     = OPERAND1_REGNUM (Operands);
+  Op->Reg2     = OPERAND2_REGNUM (Operands);
+  if ((Opcode & DATAMANIP_M_64) != 0) {
+    Op->Flags   |= CLOSURE_FLAG_64BIT;
+    Op->DataSize = 8;
+    Op->Mask     = (UINT64)~0;
+  } else {
+    Op->DataSize = 4;
+    Op->Mask     = 0xFFFFFFFF;
+  }
+  switch (OpcMasked) {
+  case OPCODE_NEG:
+  case OPCODE_ADD:
+  case OPCODE_SUB:
+  case OPCODE_MUL:
+  case OPCODE_ASHR:
+    Op->Flags |= CLOSURE_FLAG_SIGNED;
+    break;
+  default:
+    break;
+  }
+  if (OPERAND1_INDIRECT (Operands)) {
+    Op->Flags |= CLOSURE_FLAG_INDIRECT1 | CLOSURE_FLAG_MEMORY;
+  }
+  if (OPERAND2_INDIRECT (Operands)) {
+    Op->Flags |= CLOSURE_FLAG_INDIRECT2 | CLOSURE_FLAG_MEMORY;
+  }
+  return Size;
+}
+
+/**
+  Compile the run of instructions that starts at a given address.
+
+  @param  VmPtr             A pointer to a VM context.
+  @param  Head              The first instruction of the block.
+  @param  Block             The block to fill. OpCount is 0 on return if the
+                            first instruction can't be compiled.
+
+**/
+VOID
+ClosureCompile (
+  IN  VM_CONTEXT    *VmPtr,
+  IN  VMIP          Head,
+  OUT CLOSURE_BLOCK *Block
+  )
+{
+  VMIP        SavedIp;
+  UINT8       OpcMasked;
+  UINT8       Size;
+  CLOSURE_OP  *Op;
+
+  ZeroMem (Block, sizeof (CLOSURE_BLOCK));
+  Block->Head = Head;
+
+  //
+  // The code stream is read 16 bits at a time, which raises an alignment
+  // exception on an odd IP.
+  //
+  if (((UINTN) Head & 1) != 0) {
+    return;
+  }
+
+  //
+  // The decoding functions read from the current IP
+  //
+  SavedIp   = VmPtr->Ip;
+  VmPtr->Ip = Head;
+  while (Block->OpCount < CLOSURE_MAX_OPS) {
+    Op        = &Block->Op[Block->OpCount];
+    OpcMasked = (UINT8) (GETOPCODE (VmPtr) & OPCODE_M_OPCODE);
+    if (((OpcMasked >= OPCODE_MOVBW) && (OpcMasked <= OPCODE_MOVQD)) ||
+        (OpcMasked == OPCODE_MOVQQ) || (OpcMasked == OPCODE_MOVNW) || (OpcMasked == OPCODE_MOVND)) {
+      Size = ClosureCompileMOVxx (VmPtr, Op);
+    } else if ((OpcMasked >= OPCODE_MOVI) && (OpcMasked <= OPCODE_MOVREL)) {
+      Size = ClosureCompileMOVI (VmPtr, Op);
+    } else if (((OpcMasked >= OPCODE_CMPEQ) && (OpcMasked <= OPCODE_CMPUGTE)) ||
+               ((OpcMasked >= OPCODE_CMPIEQ) && (OpcMasked <= OPCODE_CMPIUGTE))) {
+      Size = ClosureCompileCMP (VmPtr, Op);
+    } else if ((OpcMasked >= OPCODE_NOT) && (OpcMasked <= OPCODE_EXTNDD)) {
+      Size = ClosureCompileDataManip (VmPtr, Op);
+    } else {
+      Size = 0;
+    }
+    if (Size == 0) {
+      ZeroMem (Op, sizeof (CLOSURE_OP));
+      break;
+    }
+    Op->Size = Size;
+    Block->OpCount++;
+    VmPtr->Ip += Size;
+  }
+  VmPtr->Ip = SavedIp;
+}
+
+/**
+  Flush the block cache. This must be called when EBC code is unloaded or
+  modified, as the blocks would otherwise run the old code.
+
+**/
+VOID
+EbcClosureFlushCache (
+  VOID
+  )
+{
+  EFI_TPL   OldTpl;
+
+  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  if (mClosureBusy != 0) {
+    mClosureFlushPending = TRUE;
+  } else {
+    ZeroMem (mClosureCache, sizeof (mClosureCache));
+    ZeroMem (mClosureHot, sizeof (mClosureHot));
+    mClosureFlushPending = FALSE;
+  }
+  gBS->RestoreTPL (OldTpl);
+}
+
+/**
+  Called at the start of each EBC invocation, and after each branch, call or
+  return, to run the compiled blocks that start at the current IP. A block is
+  compiled once its head has been reached CLOSURE_HOT_THRESHOLD times. On
+  return, the IP points to an instruction that the interpreter must run.
+
+  @param  VmPtr             A pointer to a VM context.
+
+**/
+VOID
+VmClosureRun (
+  IN VM_CONTEXT *VmPtr
+  )
+{
+  CLOSURE_BLOCK *Block;
+  CLOSURE_OP    *Op;
+  CLOSURE_OP    *End;
+  UINT16        *Hot;
+  EFI_TPL       OldTpl;
+
+  if (VMFLAG_ISSET (VmPtr, VMFLAGS_STEP)) {
+    return;
+  }
+
+  mClosureBusy++;
+  while (!mClosureFlushPending) {
+    Block = &mClosureCache[((UINTN) VmPtr->Ip >> 1) & (CLOSURE_CACHE_SIZE - 1)];
+    if (Block->Head != VmPtr->Ip) {
+      Hot = &mClosureHot[((UINTN) VmPtr->Ip >> 1) & (CLOSURE_HOT_SIZE - 1)];
+      if (++(*Hot) < CLOSURE_HOT_THRESHOLD) {
+        break;
+      }
+      //
+      // Only replace a block when no other VM may be running it
+      //
+      OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+      if (mClosureBusy == 1) {
+        *Hot = 0;
+        ClosureCompile (VmPtr, VmPtr->Ip, Block);
+      }
+      gBS->RestoreTPL (OldTpl);
+      if (Block->Head != VmPtr->Ip) {
+        break;
+      }
+    }
+    if (Block->OpCount == 0) {
+      break;
+    }
+
+    //
+    // The EBC VM is a strongly ordered processor, so perform a fence after
+    // each memory access, as the interpreter does.
+    //
+    End = &Block->Op[Block->OpCount];
+    EBC_PERF_ADD (mEbcVmPrivate, Instructions, Block->OpCount);
+    for (Op = Block->Op; Op < End; Op++) {
+      Op->Handler (VmPtr, Op);
+      if ((Op->Flags & CLOSURE_FLAG_MEMORY) != 0) {
+        MemoryFence ();
+      }
+    }
+  }
+
+  mClosureBusy--;
+  if ((mClosureBusy == 0) && mClosureFlushPending) {
+    EbcClosureFlushCache ();
+  }
+}
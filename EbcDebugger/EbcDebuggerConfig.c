@@ -14,9 +14,34 @@
 
 #include <Uefi.h>
 #include <Protocol/ShellParameters.h>
+#ifndef _GNU_EFI
+#include <Library/DevicePathLib.h>
+#include <Library/TimerLib.h>
+#include <Protocol/LoadedImage.h>
+#endif
 
 #include "EdbCommon.h"
 #include "EdbSupport.h"
+#include "EbcPerformance.h"
+#include "EdbBench.h"
+#include "EdbCorpus.h"
+#include "EdbInstMix.h"
+#include "EdbCallExProfile.h"
+
+//
+// Number of instruction forms and pairs of opcodes shown by RUN
+//
+#define EDB_RUN_INSTMIX_TOP  16
+
+//
+// Number of CALLEX targets shown by RUN
+//
+#define EDB_RUN_CALLEX_TOP   8
+
+//
+// The GUID of the EBC performance protocol isn't part of any package.
+//
+EFI_GUID gEfiEbcPerformanceProtocolGuid = EFI_EBC_PERFORMANCE_PROTOCOL_GUID;
 
 /**
 
@@ -37,6 +62,15 @@ PrintUsage (
     L"usage: EdbCfg <Command>\n"
     L"  CommandList:\n"
     L"    BO[C|CX|R|E|T|K] <ON|OFF> - Enable/Disable BOC/BOCX/BOR/BOE/BOT/BOK.\n"
+    L"    COVERAGE <ON|OFF>         - Enable/Disable the recording of the EBC code coverage.\n"
+    L"    RUN <File> [MIX|VIRTUAL]  - Run an EBC image and report the interpreter speed,\n"
+    L"                                the instruction mix, or the times measured with\n"
+    L"                                the virtual clock, which are reproducible.\n"
+    L"    BENCH [Iterations [Runs]] - Time each EBC opcode and the corpus, with CSV output.\n"
+    L"    BENCH CHECK <Baseline> [Threshold [Runs]]\n"
+    L"                              - Compare with the output of BENCH, and fail on a\n"
+    L"                                slow down of more than Threshold percent.\n"
+    L"    CORPUS                    - Run and check the EBC workload corpus.\n"
 //    L"    SHOWINFO                - Show Debugger Information.\n"
     L"\n"
     );
@@ -167,6 +201,327 @@ EdbConfigBreak (
   return ;
 }
 
+/**
+
+  EdbConfigCoverage function.
+
+  @param  DebuggerConfiguration    Point to the EFI_DEBUGGER_CONFIGURATION_PROTOCOL.
+  @param  CommandArg               The argument for this command.
+
+**/
+VOID
+EdbConfigCoverage (
+  EFI_DEBUGGER_CONFIGURATION_PROTOCOL *DebuggerConfiguration,
+  CHAR16                              *CommandArg
+  )
+{
+  EFI_DEBUGGER_PRIVATE_DATA *DebuggerPrivate;
+
+  DebuggerPrivate = (EFI_DEBUGGER_PRIVATE_DATA *)DebuggerConfiguration->DebuggerPrivateData;
+
+  if (CommandArg == NULL) {
+    if (DebuggerPrivate->CoverageContext.Enabled) {
+      Print (L"COVERAGE on\n");
+    } else {
+      Print (L"COVERAGE off\n");
+    }
+  } else if (StriCmp (CommandArg, L"ON") == 0) {
+    DebuggerPrivate->CoverageContext.Enabled = TRUE;
+  } else if (StriCmp (CommandArg, L"OFF") == 0) {
+    DebuggerPrivate->CoverageContext.Enabled = FALSE;
+  } else {
+    Print (L"Invalid parameter\n");
+  }
+  return ;
+}
+
+/**
+
+  Convert a number of performance counter ticks to microseconds.
+
+  @param  Ticks                    The number of ticks.
+  @param  Frequency                The frequency of the ticks, in Hz.
+
+  @return The number of microseconds.
+
+**/
+UINT64
+EdbTicksToMicroseconds (
+  UINT64                              Ticks,
+  UINT64                              Frequency
+  )
+{
+  return DivU64x64Remainder (MultU64x64 (Ticks, 1000000), Frequency, NULL);
+}
+
+/**
+
+  Print the most executed instruction forms and pairs of opcodes of the
+  instruction mix of all the images.
+
+  @param  Performance              The EBC performance protocol.
+
+**/
+VOID
+EdbPrintInstMix (
+  EFI_EBC_PERFORMANCE_PROTOCOL        *Performance
+  )
+{
+  EFI_EBC_INSTRUCTION_MIX             *Mix;
+  EDB_INSTMIX_ROW                     Rows[EDB_RUN_INSTMIX_TOP];
+  CHAR16                              Name[EDB_INSTMIX_NAME_MAX];
+  UINT64                              Total;
+  UINTN                               Count;
+  UINTN                               Index;
+
+  Mix = AllocatePool (sizeof (EFI_EBC_INSTRUCTION_MIX));
+  if (Mix == NULL) {
+    return;
+  }
+  Performance->MixSnapshot (Performance, NULL, Mix);
+  Total = EdbInstMixTotal (Mix);
+  if (Total != 0) {
+    Print (L"  Instruction forms:\n");
+    Count = EdbInstMixTopForms (Mix, Rows, EDB_RUN_INSTMIX_TOP);
+    for (Index = 0; Index < Count; Index++) {
+      EdbInstMixFormName (Rows[Index].Opcode, Rows[Index].Next, Name);
+      Print (L"    %12ld %s\n", Rows[Index].Count, Name);
+    }
+    Print (L"  Pairs of opcodes:\n");
+    Count = EdbInstMixTopPairs (Mix, Rows, EDB_RUN_INSTMIX_TOP);
+    for (Index = 0; Index < Count; Index++) {
+      Print (
+        L"    %12ld %s, %s\n",
+        Rows[Index].Count,
+        EdbInstMixOpcodeName (Rows[Index].Opcode),
+        EdbInstMixOpcodeName (Rows[Index].Next)
+        );
+    }
+  }
+  FreePool (Mix);
+}
+
+/**
+
+  Print the CALLEX targets that took the most native time, then the ones that
+  were called the most, with the service, protocol member or image they
+  resolve to.
+
+  @param  Performance              The EBC performance protocol.
+  @param  Frequency                The frequency of the performance counter, in Hz.
+
+**/
+VOID
+EdbPrintCallExProfile (
+  EFI_EBC_PERFORMANCE_PROTOCOL        *Performance,
+  UINT64                              Frequency
+  )
+{
+  EFI_EBC_CALLEX_PROFILE              *Profile;
+  EFI_EBC_CALLEX_TARGET               *Rows[EDB_RUN_CALLEX_TOP];
+  EDB_CALLEX_TARGET_NAME              Name;
+  UINTN                               Count;
+  UINTN                               Index;
+
+  Profile = AllocatePool (sizeof (EFI_EBC_CALLEX_PROFILE));
+  if (Profile == NULL) {
+    return;
+  }
+  if (!EFI_ERROR (Performance->CallExSnapshot (Performance, Profile))) {
+    Count = EdbCallExTopTargets (Profile, Rows, EDB_RUN_CALLEX_TOP);
+    if (Count != 0) {
+      Print (L"  CALLEX targets (calls, thunks, total us, max us):\n");
+    }
+    for (Index = 0; Index < Count; Index++) {
+      Print (
+        L"    %8ld %8ld %10ld %8ld ",
+        Rows[Index]->Calls,
+        Rows[Index]->Thunks,
+        EdbTicksToMicroseconds (Rows[Index]->NativeTime, Frequency),
+        EdbTicksToMicroseconds (Rows[Index]->MaxTime, Frequency)
+        );
+      //
+      // The targets in the image that was run are gone with it by now
+      //
+      EdbResolveCallExTarget ((UINTN) Rows[Index]->FuncAddr, &Name);
+      if (Name.Service != NULL) {
+        Print (L"%s\n", Name.Service);
+      } else if (Name.Protocol != NULL) {
+        Print (L"%g+0x%x\n", Name.Protocol, Name.Offset);
+      } else if (Name.ImageBase != 0) {
+        Print (L"image %lx+0x%x\n", (UINT64)Name.ImageBase, Name.Offset);
+      } else {
+        Print (L"%lx\n", Rows[Index]->FuncAddr);
+      }
+    }
+  }
+  FreePool (Profile);
+}
+
+/**
+
+  Run an EBC image, and report the instructions it retired, how long it took,
+  the resulting speed of the interpreter, and the CALLEX targets that took
+  the most time. With MIX, also report the most executed instruction forms
+  and pairs of opcodes, if the interpreter counts them. This slows the interpreter down, so the speed is not reported then.
+  With VIRTUAL, the times are measured with the virtual clock of the
+  interpreter, which gives the same times for the same run on any host.
+
+  The counters are reset before the image is started, and cover everything
+  that runs in EBC until it returns, including other EBC images that may get
+  called in the meantime.
+
+  @param  ImageHandle              The image handle of this application.
+  @param  FileName                 The path of the EBC image, on the same
+                                   volume as this application.
+  @param  WithMix                  Whether to count the instruction mix.
+  @param  Virtual                  Whether to measure with the virtual clock.
+
+  @retval EFI_SUCCESS              The image was run.
+  @retval EFI_NOT_FOUND            The EBC performance protocol was not found.
+  @retval EFI_UNSUPPORTED          The EBC performance protocol does not count
+                                   the instruction mix, or has no virtual clock.
+  @retval Others                   The image could not be loaded.
+
+**/
+EFI_STATUS
+EdbRunImage (
+  EFI_HANDLE                          ImageHandle,
+  CHAR16                              *FileName,
+  BOOLEAN                             WithMix,
+  BOOLEAN                             Virtual
+  )
+{
+  EFI_STATUS                          Status;
+  EFI_STATUS                          ExitStatus;
+  EFI_LOADED_IMAGE_PROTOCOL           *LoadedImage;
+  EFI_DEVICE_PATH_PROTOCOL            *DevicePath;
+  EFI_EBC_PERFORMANCE_PROTOCOL        *Performance;
+  EFI_EBC_PERFORMANCE_COUNTERS        Counters;
+  EFI_HANDLE                          ChildHandle;
+  UINT64                              StartValue;
+  UINT64                              EndValue;
+  UINT64                              Start;
+  UINT64                              End;
+  UINT64                              Frequency;
+  UINT64                              Elapsed;
+  UINT64                              Mips;
+  UINT64                              Tenths;
+
+  Status = gBS->LocateProtocol (
+                 &gEfiEbcPerformanceProtocolGuid,
+                 NULL,
+                 (VOID**)&Performance
+                 );
+  if (EFI_ERROR(Status)) {
+    Print (L"Error: EbcPerformance protocol not found.\n");
+    return EFI_NOT_FOUND;
+  }
+
+  if (WithMix && (Performance->Revision < 0x00010001)) {
+    Print (L"Error: EbcPerformance protocol does not count the instruction mix.\n");
+    return EFI_UNSUPPORTED;
+  }
+  if (Virtual && (Performance->Revision < 0x00010003)) {
+    Print (L"Error: EbcPerformance protocol does not have a virtual clock.\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // Load the image from the volume we were started from
+  //
+  Status = gBS->HandleProtocol (
+                  ImageHandle,
+                  &gEfiLoadedImageProtocolGuid,
+                  (VOID**)&LoadedImage
+                  );
+  if (EFI_ERROR(Status)) {
+    return Status;
+  }
+  DevicePath = FileDevicePath (LoadedImage->DeviceHandle, FileName);
+  if (DevicePath == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Status = gBS->LoadImage (FALSE, ImageHandle, DevicePath, NULL, 0, &ChildHandle);
+  FreePool (DevicePath);
+  if (EFI_ERROR(Status)) {
+    Print (L"Error: Cannot load %s - %r\n", FileName, Status);
+    return Status;
+  }
+
+  //
+  // An application gets unloaded, along with its own counters, when it
+  // returns. So only count this run, and report the global counters, which
+  // include the instruction mix of the images that were unloaded.
+  //
+  if (WithMix) {
+    Status = Performance->EnableMix (Performance, TRUE);
+    if (EFI_ERROR(Status)) {
+      Print (L"Warning: Cannot count the instruction mix - %r\n", Status);
+      WithMix = FALSE;
+    }
+  }
+  if (Virtual) {
+    Performance->SetClock (Performance, TRUE);
+  }
+  Performance->Reset (Performance);
+  Performance->Enable (Performance, TRUE);
+  if (Virtual) {
+    Performance->ReadClock (Performance, &Start, NULL);
+    ExitStatus = gBS->StartImage (ChildHandle, NULL, NULL);
+    Performance->ReadClock (Performance, &End, &Frequency);
+  } else {
+    Start      = GetPerformanceCounter ();
+    ExitStatus = gBS->StartImage (ChildHandle, NULL, NULL);
+    End        = GetPerformanceCounter ();
+  }
+  Performance->Enable (Performance, FALSE);
+  Performance->Snapshot (Performance, NULL, &Counters);
+  if (WithMix) {
+    Performance->EnableMix (Performance, FALSE);
+  }
+
+  if (Virtual) {
+    Elapsed = End - Start;
+  } else {
+    Frequency = GetPerformanceCounterProperties (&StartValue, &EndValue);
+    Elapsed   = (StartValue > EndValue) ? (Start - End) : (End - Start);
+  }
+
+  Print (L"%s returned %r\n", FileName, ExitStatus);
+  Print (L"  Instructions retired: %ld\n", Counters.Instructions);
+  Print (L"  CALL: %ld, CALLEX: %ld, RET: %ld\n", Counters.Calls, Counters.CallExs, Counters.Returns);
+  if (WithMix) {
+    EdbPrintInstMix (Performance);
+  } else if (Frequency == 0) {
+    Print (L"  Time: unavailable\n");
+  } else {
+    Elapsed = EdbTicksToMicroseconds (Elapsed, Frequency);
+    Print (L"  %s time: %ld us\n", Virtual ? L"Virtual" : L"Wall", Elapsed);
+    Print (L"  Native time: %ld us\n", EdbTicksToMicroseconds (Counters.NativeTime, Frequency));
+    if (Elapsed != 0) {
+      //
+      // Instructions per microsecond, in tenths
+      //
+      Mips = DivU64x64Remainder (MultU64x64 (Counters.Instructions, 10), Elapsed, NULL);
+      Mips = DivU64x64Remainder (Mips, 10, &Tenths);
+      Print (L"  MIPS: %ld.%ld\n", Mips, Tenths);
+    }
+    if (Performance->Revision >= 0x00010002) {
+      EdbPrintCallExProfile (Performance, Frequency);
+    }
+  }
+
+  //
+  // Switching the clock resets the counters, so it is only done once they
+  // have all been reported
+  //
+  if (Virtual) {
+    Performance->SetClock (Performance, FALSE);
+  }
+  return EFI_SUCCESS;
+}
+
 /**
   Alter the EBC Debugger configuration.
 
@@ -222,6 +577,41 @@ InitializeEbcDebuggerConfig (
     }
   }
 
+  //
+  // Running an image doesn't need the debugger, which would slow it down
+  //
+  if ((Argc == 3) && (StriCmp (Argv[1], L"RUN") == 0)) {
+    return EdbRunImage (ImageHandle, Argv[2], FALSE, FALSE);
+  }
+  if ((Argc == 4) && (StriCmp (Argv[1], L"RUN") == 0) && (StriCmp (Argv[3], L"MIX") == 0)) {
+    return EdbRunImage (ImageHandle, Argv[2], TRUE, FALSE);
+  }
+  if ((Argc == 4) && (StriCmp (Argv[1], L"RUN") == 0) && (StriCmp (Argv[3], L"VIRTUAL") == 0)) {
+    return EdbRunImage (ImageHandle, Argv[2], FALSE, TRUE);
+  }
+  if ((Argc >= 4) && (Argc <= 6) && (StriCmp (Argv[1], L"BENCH") == 0) &&
+      (StriCmp (Argv[2], L"CHECK") == 0)) {
+    return EdbRunOpcodeBenchmarks (
+             ImageHandle,
+             EDB_BENCH_DEFAULT_ITERATIONS,
+             (Argc == 6) ? Atoi (Argv[5]) : EDB_BENCH_DEFAULT_RUNS,
+             Argv[3],
+             (Argc >= 5) ? Atoi (Argv[4]) : EDB_BENCH_DEFAULT_THRESHOLD
+             );
+  }
+  if ((Argc >= 2) && (Argc <= 4) && (StriCmp (Argv[1], L"BENCH") == 0)) {
+    return EdbRunOpcodeBenchmarks (
+             ImageHandle,
+             (Argc >= 3) ? Atoi (Argv[2]) : EDB_BENCH_DEFAULT_ITERATIONS,
+             (Argc == 4) ? Atoi (Argv[3]) : EDB_BENCH_DEFAULT_RUNS,
+             NULL,
+             0
+             );
+  }
+  if ((Argc == 2) && (StriCmp (Argv[1], L"CORPUS") == 0)) {
+    return EdbRunCorpus (ImageHandle);
+  }
+
   Status = gBS->LocateProtocol (
                  &gEfiDebuggerConfigurationProtocolGuid,
                  NULL,
@@ -252,6 +642,11 @@ InitializeEbcDebuggerConfig (
     return EFI_SUCCESS;
   }
 
+  if (((Argc == 2) || (Argc == 3)) && (StriCmp (Argv[1], L"COVERAGE") == 0)) {
+    EdbConfigCoverage (DebuggerConfiguration, (Argc == 3) ? Argv[2] : NULL);
+    return EFI_SUCCESS;
+  }
+
   Print (L"Error: Invalid Command.\n");
   return EFI_INVALID_PARAMETER;
 }
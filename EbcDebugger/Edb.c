@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include <Uefi.h>
 #include "Edb.h"
+#include "EbcInt.h"
 
 EFI_DEBUGGER_PRIVATE_DATA mDebuggerPrivate = {
   EFI_DEBUGGER_SIGNATURE,                    // Signature
@@ -43,7 +44,14 @@ EFI_DEBUGGER_PRIVATE_DATA mDebuggerPrivate = {
   EFI_DEBUG_FLAG_EBC_BOE | EFI_DEBUG_FLAG_EBC_BOT, // FeatureFlags
   0,                                               // StatusFlags
   FALSE,                                           // EnablePageBreak
-  NULL                                             // BreakEvent
+  NULL,                                            // BreakEvent
+  {0},                                             // ProfileContext
+  {0},                                             // CallGraphContext
+  {0},                                             // CoverageContext
+  {0},                                             // HeatMapContext
+  {0},                                             // TimelineContext
+  {0},                                             // LogContext
+  {0}                                              // StackDepthContext
 };
 
 CHAR16 *mExceptionStr[] = {
@@ -493,6 +501,24 @@ EdbExceptionHandler (
 
   DEBUG ((DEBUG_ERROR, "Hello EBC Debugger!\n"));
 
+  //
+  // The steps of the debugger itself are not worth a timeline event
+  //
+  if (ExceptionType != EXCEPT_EBC_STEP) {
+    EbcDebuggerPushTimeline (
+      EFI_DEBUGGER_TIMELINE_EXCEPTION,
+      EFI_DEBUGGER_TIMELINE_INSTANT,
+      (UINTN)SystemContext.SystemContextEbc->Ip,
+      (UINT32)ExceptionType
+      );
+  }
+
+  //
+  // The time spent in the debugger does not belong to the profiles
+  //
+  mDebuggerPrivate.ProfileContext.Suspended = TRUE;
+  mDebuggerPrivate.CallGraphContext.PauseStart = EbcReadClock (NULL);
+
   if (!mInitialized) {
     //
     // Print version
@@ -584,6 +610,10 @@ EdbExceptionHandler (
   // Deinit Private Data
   //
   DeinitDebuggerPrivateData (&mDebuggerPrivate, ExceptionType, SystemContext, mInitialized);
+  EdbFlushLog ();
+
+  mDebuggerPrivate.CallGraphContext.PauseTicks += EbcReadClock (NULL) - mDebuggerPrivate.CallGraphContext.PauseStart;
+  mDebuggerPrivate.ProfileContext.Suspended = FALSE;
 
   DEBUG ((DEBUG_ERROR, "Goodbye EBC Debugger!\n"));
 
@@ -55,6 +55,7 @@ EdbExceptionHandler (
   );
 
 extern EFI_DEBUGGER_PRIVATE_DATA mDebuggerPrivate;
+extern CHAR16                    *mExceptionStr[];
 
 #include "EdbSupport.h"
 #include "EdbCommand.h"
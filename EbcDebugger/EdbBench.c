@@ -0,0 +1,1108 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include <Uefi.h>
+#ifndef _GNU_EFI
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Protocol/Ebc.h>
+#include <Protocol/LoadedImage.h>
+#include <Protocol/SimpleFileSystem.h>
+#include <Guid/FileInfo.h>
+#endif
+
+#include "EdbEmit.h"
+#include "EdbBench.h"
+#include "EdbCorpus.h"
+
+//
+// Times the benchmarked instruction, or sequence, is repeated in a loop
+//
+#define EDB_BENCH_UNROLL        16
+
+#define EDB_BENCH_CODE_SIZE     1024
+#define EDB_BENCH_SCRATCH_SIZE  256
+
+//
+// More runs would overflow the computation of the confidence intervals
+//
+#define EDB_BENCH_MAX_RUNS      32
+
+//
+// Kinds of benchmarks
+//
+#define EDB_BENCH_LOOP          0   ///< the loop alone
+#define EDB_BENCH_MOV           1
+#define EDB_BENCH_MOVI          2
+#define EDB_BENCH_DATAMANIP     3
+#define EDB_BENCH_CMP_JMP8      4
+#define EDB_BENCH_CMP_JMP       5
+#define EDB_BENCH_CMPI_JMP8     6
+#define EDB_BENCH_PUSH_POP      7
+#define EDB_BENCH_CALL_RET      8
+#define EDB_BENCH_CALLEX        9
+
+//
+// Use of the registers: R1 and R2 point into the scratch buffer, R3 and R4
+// hold data, R5 is the address of the native function, R6 counts the
+// iterations down and R7 is 1.
+//
+#define EDB_BENCH_DST           1
+#define EDB_BENCH_SRC           2
+#define EDB_BENCH_DATA          3
+#define EDB_BENCH_DATA2         4
+#define EDB_BENCH_NATIVE        5
+#define EDB_BENCH_COUNT         6
+#define EDB_BENCH_ONE           7
+
+#define D   EDB_EMIT_DIRECT
+#define I   EDB_EMIT_INDIRECT
+#define X   EDB_EMIT_INDEX
+
+typedef struct {
+  CHAR16  *Name;
+  UINT8   Kind;
+  UINT8   Opcode;
+  UINT8   Op1Flags;
+  UINT8   Op2Flags;
+  UINT8   Width;      ///< MOVI_MOVEWIDTHxx for MOVI, TRUE for other 64-bit operations
+  UINT8   DataWidth;  ///< MOVI_DATAWIDTHxx for MOVI, MOVIn, MOVREL and CMPI
+} EDB_BENCH;
+
+EDB_BENCH mEdbBenchmarks[] = {
+  { L"MOVqq R1, R2",                EDB_BENCH_MOV,       OPCODE_MOVQQ,    D,     D,     0,     0 },
+  { L"MOVqw R1, R2(+1,+8)",         EDB_BENCH_MOV,       OPCODE_MOVQW,    D,     X,     0,     0 },
+  { L"MOVqw @R1, R2",               EDB_BENCH_MOV,       OPCODE_MOVQW,    I,     D,     0,     0 },
+  { L"MOVqw R1, @R2",               EDB_BENCH_MOV,       OPCODE_MOVQW,    D,     I,     0,     0 },
+  { L"MOVqw @R1, @R2",              EDB_BENCH_MOV,       OPCODE_MOVQW,    I,     I,     0,     0 },
+  { L"MOVqw @R1(+1,+8), @R2(+1,+8)", EDB_BENCH_MOV,      OPCODE_MOVQW,    I | X, I | X, 0,     0 },
+  { L"MOVqd @R1(+1,+8), @R2(+1,+8)", EDB_BENCH_MOV,      OPCODE_MOVQD,    I | X, I | X, 0,     0 },
+  { L"MOVqq @R1(+1,+8), @R2(+1,+8)", EDB_BENCH_MOV,      OPCODE_MOVQQ,    I | X, I | X, 0,     0 },
+  { L"MOVbw @R1, @R2",              EDB_BENCH_MOV,       OPCODE_MOVBW,    I,     I,     0,     0 },
+  { L"MOVww @R1, @R2",              EDB_BENCH_MOV,       OPCODE_MOVWW,    I,     I,     0,     0 },
+  { L"MOVdw @R1, @R2",              EDB_BENCH_MOV,       OPCODE_MOVDW,    I,     I,     0,     0 },
+  { L"MOVnw @R1, @R2",              EDB_BENCH_MOV,       OPCODE_MOVNW,    I,     I,     0,     0 },
+  { L"MOVnd @R1(+1,+8), @R2(+1,+8)", EDB_BENCH_MOV,      OPCODE_MOVND,    I | X, I | X, 0,     0 },
+  { L"MOVsnw R1, @R2(+1,+8)",       EDB_BENCH_MOV,       OPCODE_MOVSNW,   D,     I | X, 0,     0 },
+  { L"MOVIqq R3, Imm64",            EDB_BENCH_MOVI,      OPCODE_MOVI,     D,     0,     MOVI_MOVEWIDTH64, MOVI_DATAWIDTH64 },
+  { L"MOVIqd R3, Imm32",            EDB_BENCH_MOVI,      OPCODE_MOVI,     D,     0,     MOVI_MOVEWIDTH64, MOVI_DATAWIDTH32 },
+  { L"MOVIqw R3, Imm16",            EDB_BENCH_MOVI,      OPCODE_MOVI,     D,     0,     MOVI_MOVEWIDTH64, MOVI_DATAWIDTH16 },
+  { L"MOVIbw @R1, Imm16",           EDB_BENCH_MOVI,      OPCODE_MOVI,     I,     0,     MOVI_MOVEWIDTH8,  MOVI_DATAWIDTH16 },
+  { L"MOVIdd @R1(+1,+8), Imm32",    EDB_BENCH_MOVI,      OPCODE_MOVI,     I | X, 0,     MOVI_MOVEWIDTH32, MOVI_DATAWIDTH32 },
+  { L"MOVInw R3, (+1,+8)",          EDB_BENCH_MOVI,      OPCODE_MOVIN,    D,     0,     0,     MOVI_DATAWIDTH16 },
+  { L"MOVInd R3, (+1,+8)",          EDB_BENCH_MOVI,      OPCODE_MOVIN,    D,     0,     0,     MOVI_DATAWIDTH32 },
+  { L"MOVInq R3, (+1,+8)",          EDB_BENCH_MOVI,      OPCODE_MOVIN,    D,     0,     0,     MOVI_DATAWIDTH64 },
+  { L"MOVRELw R3, 0",               EDB_BENCH_MOVI,      OPCODE_MOVREL,   D,     0,     0,     MOVI_DATAWIDTH16 },
+  { L"MOVRELq R3, 0",               EDB_BENCH_MOVI,      OPCODE_MOVREL,   D,     0,     0,     MOVI_DATAWIDTH64 },
+  { L"ADD32 R3, R4",                EDB_BENCH_DATAMANIP, OPCODE_ADD,      D,     D,     FALSE, 0 },
+  { L"ADD64 R3, R4",                EDB_BENCH_DATAMANIP, OPCODE_ADD,      D,     D,     TRUE,  0 },
+  { L"ADD64 R3, R4 Imm16",          EDB_BENCH_DATAMANIP, OPCODE_ADD,      D,     X,     TRUE,  0 },
+  { L"ADD64 R3, @R2",               EDB_BENCH_DATAMANIP, OPCODE_ADD,      D,     I,     TRUE,  0 },
+  { L"ADD64 R3, @R2(+1,+8)",        EDB_BENCH_DATAMANIP, OPCODE_ADD,      D,     I | X, TRUE,  0 },
+  { L"ADD64 @R1, R4",               EDB_BENCH_DATAMANIP, OPCODE_ADD,      I,     D,     TRUE,  0 },
+  { L"SUB64 R3, R4",                EDB_BENCH_DATAMANIP, OPCODE_SUB,      D,     D,     TRUE,  0 },
+  { L"MUL32 R3, R4",                EDB_BENCH_DATAMANIP, OPCODE_MUL,      D,     D,     FALSE, 0 },
+  { L"MUL64 R3, R4",                EDB_BENCH_DATAMANIP, OPCODE_MUL,      D,     D,     TRUE,  0 },
+  { L"MULU64 R3, R4",               EDB_BENCH_DATAMANIP, OPCODE_MULU,     D,     D,     TRUE,  0 },
+  { L"DIV32 R3, R4",                EDB_BENCH_DATAMANIP, OPCODE_DIV,      D,     D,     FALSE, 0 },
+  { L"DIV64 R3, R4",                EDB_BENCH_DATAMANIP, OPCODE_DIV,      D,     D,     TRUE,  0 },
+  { L"DIVU64 R3, R4",               EDB_BENCH_DATAMANIP, OPCODE_DIVU,     D,     D,     TRUE,  0 },
+  { L"MOD64 R3, R4",                EDB_BENCH_DATAMANIP, OPCODE_MOD,      D,     D,     TRUE,  0 },
+  { L"MODU64 R3, R4",               EDB_BENCH_DATAMANIP, OPCODE_MODU,     D,     D,     TRUE,  0 },
+  { L"AND64 R3, R4",                EDB_BENCH_DATAMANIP, OPCODE_AND,      D,     D,     TRUE,  0 },
+  { L"OR64 R3, R4",                 EDB_BENCH_DATAMANIP, OPCODE_OR,       D,     D,     TRUE,  0 },
+  { L"XOR64 R3, R4",                EDB_BENCH_DATAMANIP, OPCODE_XOR,      D,     D,     TRUE,  0 },
+  { L"SHL64 R3, R4",                EDB_BENCH_DATAMANIP, OPCODE_SHL,      D,     D,     TRUE,  0 },
+  { L"SHR64 R3, R4",                EDB_BENCH_DATAMANIP, OPCODE_SHR,      D,     D,     TRUE,  0 },
+  { L"ASHR64 R3, R4",               EDB_BENCH_DATAMANIP, OPCODE_ASHR,     D,     D,     TRUE,  0 },
+  { L"NOT64 R3, R4",                EDB_BENCH_DATAMANIP, OPCODE_NOT,      D,     D,     TRUE,  0 },
+  { L"NEG64 R3, R4",                EDB_BENCH_DATAMANIP, OPCODE_NEG,      D,     D,     TRUE,  0 },
+  { L"EXTNDB64 R3, R4",             EDB_BENCH_DATAMANIP, OPCODE_EXTNDB,   D,     D,     TRUE,  0 },
+  { L"EXTNDW64 R3, R4",             EDB_BENCH_DATAMANIP, OPCODE_EXTNDW,   D,     D,     TRUE,  0 },
+  { L"EXTNDD64 R3, R4",             EDB_BENCH_DATAMANIP, OPCODE_EXTNDD,   D,     D,     TRUE,  0 },
+  { L"CMP32eq R3, R4 + JMP8cc",     EDB_BENCH_CMP_JMP8,  OPCODE_CMPEQ,    D,     D,     FALSE, 0 },
+  { L"CMP64eq R3, R4 + JMP8cc",     EDB_BENCH_CMP_JMP8,  OPCODE_CMPEQ,    D,     D,     TRUE,  0 },
+  { L"CMP64lte R3, R4 + JMP8cc",    EDB_BENCH_CMP_JMP8,  OPCODE_CMPLTE,   D,     D,     TRUE,  0 },
+  { L"CMP64ugte R3, R4 + JMP8cc",   EDB_BENCH_CMP_JMP8,  OPCODE_CMPUGTE,  D,     D,     TRUE,  0 },
+  { L"CMP64eq R3, @R2 + JMP8cc",    EDB_BENCH_CMP_JMP8,  OPCODE_CMPEQ,    D,     I,     TRUE,  0 },
+  { L"CMP64eq R3, R4 + JMP32cc",    EDB_BENCH_CMP_JMP,   OPCODE_CMPEQ,    D,     D,     TRUE,  0 },
+  { L"CMPI32eq R3, Imm16 + JMP8cc", EDB_BENCH_CMPI_JMP8, OPCODE_CMPIEQ,   D,     0,     FALSE, MOVI_DATAWIDTH16 },
+  { L"CMPI64eq R3, Imm32 + JMP8cc", EDB_BENCH_CMPI_JMP8, OPCODE_CMPIEQ,   D,     0,     TRUE,  MOVI_DATAWIDTH32 },
+  { L"CMPI64ugte @R1(+1,+8), Imm16 + JMP8cc", EDB_BENCH_CMPI_JMP8, OPCODE_CMPIUGTE, I | X, 0, TRUE, MOVI_DATAWIDTH16 },
+  { L"PUSH32 R3 + POP32 R3",        EDB_BENCH_PUSH_POP,  OPCODE_PUSH,     D,     0,     FALSE, 0 },
+  { L"PUSH64 R3 + POP64 R3",        EDB_BENCH_PUSH_POP,  OPCODE_PUSH,     D,     0,     TRUE,  0 },
+  { L"PUSH64 @R1 + POP64 @R1",      EDB_BENCH_PUSH_POP,  OPCODE_PUSH,     I,     0,     TRUE,  0 },
+  { L"PUSHn R3 + POPn R3",          EDB_BENCH_PUSH_POP,  OPCODE_PUSHN,    D,     0,     FALSE, 0 },
+  { L"CALL32 + RET",                EDB_BENCH_CALL_RET,  OPCODE_CALL,     D,     0,     FALSE, 0 },
+  { L"CALLEX R5",                   EDB_BENCH_CALLEX,    OPCODE_CALL,     D,     0,     FALSE, 0 }
+};
+
+EDB_BENCH mEdbBenchmarkLoop = { L"Loop", EDB_BENCH_LOOP, 0, 0, 0, 0, 0 };
+
+//
+// The result of a benchmark, or of a program of the corpus. The times are in
+// hundredths of nanoseconds per instruction.
+//
+typedef struct {
+  CHAR16      *Name;
+  CHAR16      *Handler;
+  EFI_STATUS  Status;
+  UINT64      Instructions;
+  UINT64      Median;
+  UINT64      Low;        ///< 95% confidence interval of the median
+  UINT64      High;
+  UINT64      Baseline;   ///< 0 if the baseline doesn't have the benchmark
+} EDB_BENCH_RESULT;
+
+/**
+
+  The native function that CALLEX calls.
+
+  CALLEX puts the return value in R7, which the loop subtracts from the
+  count, so it must stay 1.
+
+  @return 1
+
+**/
+UINT64
+EFIAPI
+EdbBenchNativeFunction (
+  VOID
+  )
+{
+  return 1;
+}
+
+/**
+
+  Emit the benchmarked instruction, or sequence, once.
+
+  @param  Emitter   - The emitter
+  @param  Bench     - The benchmark
+  @param  Function  - Offset of a function that just returns
+
+  @return The number of instructions emitted
+
+**/
+UINTN
+EdbBenchEmitBody (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     EDB_BENCH   *Bench,
+  IN     UINTN       Function
+  )
+{
+  UINT8   Op1;
+  UINT8   Op2;
+  UINTN   Bits;
+
+  Op1 = ((Bench->Op1Flags & EDB_EMIT_INDIRECT) != 0) ? EDB_BENCH_DST : EDB_BENCH_DATA;
+  Op2 = ((Bench->Op2Flags & EDB_EMIT_INDIRECT) != 0) ? EDB_BENCH_SRC : EDB_BENCH_DATA2;
+
+  switch (Bench->Kind) {
+  case EDB_BENCH_MOV:
+    switch (Bench->Opcode) {
+    case OPCODE_MOVQQ:
+      Bits = 64;
+      break;
+    case OPCODE_MOVQD:
+    case OPCODE_MOVND:
+      Bits = 32;
+      break;
+    default:
+      Bits = 16;
+      break;
+    }
+    EdbEmitMov (
+      Emitter,
+      Bench->Opcode,
+      EDB_BENCH_DST,
+      Bench->Op1Flags,
+      EdbEmitIndex (FALSE, 1, 8, Bits),
+      EDB_BENCH_SRC,
+      Bench->Op2Flags,
+      EdbEmitIndex (FALSE, 1, 8, Bits)
+      );
+    return 1;
+
+  case EDB_BENCH_MOVI:
+    Bits = (Bench->DataWidth == MOVI_DATAWIDTH16) ? 16 : ((Bench->DataWidth == MOVI_DATAWIDTH32) ? 32 : 64);
+    EdbEmitMovi (
+      Emitter,
+      Bench->Opcode,
+      Bench->Width,
+      Op1,
+      Bench->Op1Flags,
+      EdbEmitIndex (FALSE, 1, 8, 16),
+      Bench->DataWidth,
+      (Bench->Opcode == OPCODE_MOVIN) ? EdbEmitIndex (FALSE, 1, 8, Bits) :
+      ((Bench->Opcode == OPCODE_MOVREL) ? 0 : 0x1234)
+      );
+    return 1;
+
+  case EDB_BENCH_DATAMANIP:
+    EdbEmitDataManip (
+      Emitter,
+      Bench->Opcode,
+      (BOOLEAN)Bench->Width,
+      Op1,
+      Bench->Op1Flags,
+      Op2,
+      Bench->Op2Flags,
+      ((Bench->Op2Flags & EDB_EMIT_INDIRECT) != 0) ? (UINT16)EdbEmitIndex (FALSE, 1, 8, 16) : 16
+      );
+    return 1;
+
+  case EDB_BENCH_CMP_JMP8:
+  case EDB_BENCH_CMP_JMP:
+    EdbEmitDataManip (Emitter, Bench->Opcode, (BOOLEAN)Bench->Width, EDB_BENCH_DATA, D, Op2, Bench->Op2Flags, 0);
+    if (Bench->Kind == EDB_BENCH_CMP_JMP8) {
+      EdbEmitJmp8 (Emitter, EDB_EMIT_CC, Emitter->Offset + 2);
+    } else {
+      EdbEmitJmp (Emitter, OPCODE_JMP, EDB_EMIT_CC | JMP_M_RELATIVE, 0, D, 4, 0);
+    }
+    return 2;
+
+  case EDB_BENCH_CMPI_JMP8:
+    EdbEmitCmpi (
+      Emitter,
+      Bench->Opcode,
+      (BOOLEAN)Bench->Width,
+      Op1,
+      Bench->Op1Flags,
+      (UINT16)EdbEmitIndex (FALSE, 1, 8, 16),
+      (BOOLEAN)(Bench->DataWidth == MOVI_DATAWIDTH32),
+      0x1234
+      );
+    EdbEmitJmp8 (Emitter, EDB_EMIT_CC, Emitter->Offset + 2);
+    return 2;
+
+  case EDB_BENCH_PUSH_POP:
+    EdbEmitPushPop (Emitter, Bench->Opcode, (BOOLEAN)Bench->Width, Op1, Bench->Op1Flags, 0);
+    EdbEmitPushPop (Emitter, (UINT8)(Bench->Opcode + 1), (BOOLEAN)Bench->Width, Op1, Bench->Op1Flags, 0);
+    return 2;
+
+  case EDB_BENCH_CALL_RET:
+    EdbEmitJmp (
+      Emitter,
+      OPCODE_CALL,
+      OPERAND_M_RELATIVE_ADDR,
+      0,
+      D,
+      4,
+      (UINT64)(INT64)((INTN)Function - (INTN)(Emitter->Offset + 6))
+      );
+    return 2;
+
+  case EDB_BENCH_CALLEX:
+    EdbEmitJmp (Emitter, OPCODE_CALL, OPERAND_M_NATIVE_CALL, EDB_BENCH_NATIVE, D, 0, 0);
+    return 1;
+
+  default:
+    return 0;
+  }
+}
+
+/**
+
+  Generate the loop of a benchmark.
+
+  @param  Emitter     - The emitter, which must be empty
+  @param  Bench       - The benchmark
+  @param  Iterations  - Number of iterations of the loop
+  @param  Scratch     - The scratch buffer
+  @param  Entry       - Offset of the entry point of the code
+  @param  Count       - Number of instructions run per iteration
+
+**/
+VOID
+EdbBenchEmit (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     EDB_BENCH   *Bench,
+  IN     UINTN       Iterations,
+  IN     UINT8       *Scratch,
+  OUT    UINTN       *Entry,
+  OUT    UINTN       *Count
+  )
+{
+  UINTN Function;
+  UINTN Loop;
+  UINTN Index;
+
+  //
+  // A function for the CALL benchmark, ahead of the entry point
+  //
+  Function = Emitter->Offset;
+  EdbEmitRet (Emitter);
+
+  *Entry = Emitter->Offset;
+  EdbEmitMovi (Emitter, OPCODE_MOVI, MOVI_MOVEWIDTH64, EDB_BENCH_DST, D, 0, MOVI_DATAWIDTH64, (UINT64)(UINTN)Scratch);
+  EdbEmitMovi (Emitter, OPCODE_MOVI, MOVI_MOVEWIDTH64, EDB_BENCH_SRC, D, 0, MOVI_DATAWIDTH64, (UINT64)(UINTN)(Scratch + EDB_BENCH_SCRATCH_SIZE / 2));
+  EdbEmitMovi (Emitter, OPCODE_MOVI, MOVI_MOVEWIDTH64, EDB_BENCH_DATA, D, 0, MOVI_DATAWIDTH64, 0x0123456789ABCDEFULL);
+  EdbEmitMovi (Emitter, OPCODE_MOVI, MOVI_MOVEWIDTH64, EDB_BENCH_DATA2, D, 0, MOVI_DATAWIDTH64, 3);
+  EdbEmitMovi (Emitter, OPCODE_MOVI, MOVI_MOVEWIDTH64, EDB_BENCH_NATIVE, D, 0, MOVI_DATAWIDTH64, (UINT64)(UINTN)EdbBenchNativeFunction);
+  EdbEmitMovi (Emitter, OPCODE_MOVI, MOVI_MOVEWIDTH64, EDB_BENCH_COUNT, D, 0, MOVI_DATAWIDTH64, Iterations);
+  EdbEmitMovi (Emitter, OPCODE_MOVI, MOVI_MOVEWIDTH64, EDB_BENCH_ONE, D, 0, MOVI_DATAWIDTH64, 1);
+
+  //
+  // The loop ends with a JMP32, as a body can be too large for a JMP8
+  //
+  Loop   = Emitter->Offset;
+  *Count = 0;
+  for (Index = 0; Index < EDB_BENCH_UNROLL; Index++) {
+    *Count += EdbBenchEmitBody (Emitter, Bench, Function);
+  }
+  EdbEmitDataManip (Emitter, OPCODE_SUB, TRUE, EDB_BENCH_COUNT, D, EDB_BENCH_ONE, D, 0);
+  EdbEmitCmpi (Emitter, OPCODE_CMPIEQ, TRUE, EDB_BENCH_COUNT, D, 0, FALSE, 0);
+  EdbEmitJmp (
+    Emitter,
+    OPCODE_JMP,
+    EDB_EMIT_CC | JMP_M_RELATIVE,
+    0,
+    D,
+    4,
+    (UINT64)(INT64)((INTN)Loop - (INTN)(Emitter->Offset + 6))
+    );
+
+  EdbEmitMovi (Emitter, OPCODE_MOVI, MOVI_MOVEWIDTH64, EDB_BENCH_ONE, D, 0, MOVI_DATAWIDTH64, EFI_SUCCESS);
+  EdbEmitRet (Emitter);
+}
+
+/**
+
+  Generate a benchmark, and time a run of it after a first warm-up run.
+
+  @param  Ebc         - The EBC protocol
+  @param  ImageHandle - The image handle of this application
+  @param  Bench       - The benchmark
+  @param  Iterations  - Number of iterations of the loop
+  @param  Code        - The buffer for the code
+  @param  Scratch     - The scratch buffer
+  @param  Ticks       - Duration of the timed run, in ticks
+  @param  Count       - Number of instructions benchmarked per iteration
+
+  @retval EFI_SUCCESS - The benchmark was run
+  @retval Others      - The benchmark could not be run
+
+**/
+EFI_STATUS
+EdbBenchRun (
+  IN  EFI_EBC_PROTOCOL *Ebc,
+  IN  EFI_HANDLE       ImageHandle,
+  IN  EDB_BENCH        *Bench,
+  IN  UINTN            Iterations,
+  IN  UINT8            *Code,
+  IN  UINT8            *Scratch,
+  OUT UINT64           *Ticks,
+  OUT UINTN            *Count
+  )
+{
+  EFI_STATUS            Status;
+  EDB_EMITTER           Emitter;
+  EFI_IMAGE_ENTRY_POINT Thunk;
+  UINTN                 Entry;
+  UINTN                 Run;
+  UINT64                Start;
+  UINT64                End;
+  UINT64                StartValue;
+  UINT64                EndValue;
+
+  EdbEmitInit (&Emitter, Code, EDB_BENCH_CODE_SIZE);
+  EdbBenchEmit (&Emitter, Bench, Iterations, Scratch, &Entry, Count);
+  if (Emitter.Overflow) {
+    return EFI_BUFFER_TOO_SMALL;
+  }
+  Status = Ebc->CreateThunk (Ebc, ImageHandle, Code + Entry, (VOID **)&Thunk);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Start = 0;
+  End   = 0;
+  for (Run = 0; Run < 2; Run++) {
+    SetMem (Scratch, EDB_BENCH_SCRATCH_SIZE, 0x11);
+    Start  = GetPerformanceCounter ();
+    Status = Thunk (ImageHandle, gST);
+    End    = GetPerformanceCounter ();
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+  }
+  //
+  // The next benchmark reuses the code buffer, so free the thunk, which also
+  // drops what the interpreter cached about the code
+  //
+  Ebc->UnloadImage (Ebc, ImageHandle);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  GetPerformanceCounterProperties (&StartValue, &EndValue);
+  *Ticks = (StartValue > EndValue) ? (Start - End) : (End - Start);
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Get the name of the interpreter function that executes the benchmarked
+  instruction, or the first instruction of the benchmarked sequence.
+
+  @param  Bench     - The benchmark
+
+  @return The name of the function
+
+**/
+CHAR16 *
+EdbBenchHandler (
+  IN EDB_BENCH *Bench
+  )
+{
+  switch (Bench->Kind) {
+  case EDB_BENCH_MOV:
+    if (Bench->Opcode == OPCODE_MOVSNW) {
+      return L"ExecuteMOVsnw";
+    }
+    if (Bench->Opcode == OPCODE_MOVSND) {
+      return L"ExecuteMOVsnd";
+    }
+    return L"ExecuteMOVxx";
+  case EDB_BENCH_MOVI:
+    if (Bench->Opcode == OPCODE_MOVIN) {
+      return L"ExecuteMOVIn";
+    }
+    if (Bench->Opcode == OPCODE_MOVREL) {
+      return L"ExecuteMOVREL";
+    }
+    return L"ExecuteMOVI";
+  case EDB_BENCH_DATAMANIP:
+    switch (Bench->Opcode) {
+    case OPCODE_NEG:
+    case OPCODE_ADD:
+    case OPCODE_SUB:
+    case OPCODE_MUL:
+    case OPCODE_DIV:
+    case OPCODE_MOD:
+    case OPCODE_ASHR:
+      return L"ExecuteSignedDataManip";
+    default:
+      return L"ExecuteUnsignedDataManip";
+    }
+  case EDB_BENCH_CMP_JMP8:
+  case EDB_BENCH_CMP_JMP:
+    return L"ExecuteCMP";
+  case EDB_BENCH_CMPI_JMP8:
+    return L"ExecuteCMPI";
+  case EDB_BENCH_PUSH_POP:
+    return (Bench->Opcode == OPCODE_PUSHN) ? L"ExecutePUSHn" : L"ExecutePUSH";
+  case EDB_BENCH_CALL_RET:
+  case EDB_BENCH_CALLEX:
+    return L"ExecuteCALL";
+  default:
+    return L"ExecuteJMP";
+  }
+}
+
+/**
+
+  Convert a duration to hundredths of nanoseconds per instruction.
+
+  @param  Ticks         - The duration, in ticks
+  @param  Frequency     - The frequency of the performance counter, in MHz
+  @param  Instructions  - Number of instructions run in that time
+
+  @return The time of one instruction, in hundredths of nanoseconds
+
+**/
+UINT64
+EdbBenchHundredths (
+  IN UINT64 Ticks,
+  IN UINT64 Frequency,
+  IN UINT64 Instructions
+  )
+{
+  if (Instructions == 0) {
+    return 0;
+  }
+  return DivU64x64Remainder (
+           DivU64x64Remainder (MultU64x64 (Ticks, 100000), Frequency, NULL),
+           Instructions,
+           NULL
+           );
+}
+
+/**
+
+  Get the median of the runs of a benchmark, and a 95% confidence interval
+  of it.
+
+  The interval is the one given by the order statistics: it spans from the
+  k-th smallest to the k-th largest run, where k is the largest value for
+  which the median falls outside with a probability of at most 5%, whatever
+  the distribution of the runs. With fewer than 6 runs, no such k exists, and
+  the interval is from the fastest to the slowest run.
+
+  @param  Values    - The runs, which get sorted
+  @param  Runs      - Number of runs
+  @param  Result    - The result to fill in
+
+**/
+VOID
+EdbBenchStatistics (
+  IN OUT UINT64           *Values,
+  IN     UINTN            Runs,
+  IN OUT EDB_BENCH_RESULT *Result
+  )
+{
+  UINT64  Value;
+  UINT64  Binomial;
+  UINT64  Sum;
+  UINTN   Index;
+  UINTN   Other;
+  UINTN   K;
+
+  for (Index = 1; Index < Runs; Index++) {
+    Value = Values[Index];
+    for (Other = Index; (Other > 0) && (Values[Other - 1] > Value); Other--) {
+      Values[Other] = Values[Other - 1];
+    }
+    Values[Other] = Value;
+  }
+
+  if ((Runs & 1) != 0) {
+    Result->Median = Values[Runs / 2];
+  } else {
+    Result->Median = (Values[Runs / 2 - 1] + Values[Runs / 2]) / 2;
+  }
+
+  //
+  // The median is below the k-th smallest run with a probability of
+  // Sum (C(Runs, i), i < k) / 2^Runs, and as likely above the k-th largest
+  //
+  K        = 1;
+  Sum      = 0;
+  Binomial = 1;
+  for (Index = 0; Index < Runs / 2; Index++) {
+    Sum += Binomial;
+    if (MultU64x64 (Sum, 40) > LShiftU64 (1, Runs)) {
+      break;
+    }
+    K        = Index + 1;
+    Binomial = DivU64x64Remainder (MultU64x64 (Binomial, Runs - Index), Index + 1, NULL);
+  }
+  Result->Low  = Values[K - 1];
+  Result->High = Values[Runs - K];
+}
+
+/**
+
+  Read a baseline, which is the output of a previous run of the benchmarks.
+
+  The file is on the same volume as this application. The output of the
+  UEFI Shell is in UCS-2 when redirected with '>', and in ASCII with '>a',
+  so both are accepted.
+
+  @param  ImageHandle   - The image handle of this application
+  @param  FileName      - The path of the baseline
+  @param  Text          - The content of the file, as a NUL terminated string
+
+  @retval EFI_SUCCESS   - The file was read
+  @retval Others        - The file could not be read
+
+**/
+EFI_STATUS
+EdbBenchReadBaseline (
+  IN  EFI_HANDLE  ImageHandle,
+  IN  CHAR16      *FileName,
+  OUT CHAR16      **Text
+  )
+{
+  EFI_STATUS                      Status;
+  EFI_LOADED_IMAGE_PROTOCOL       *LoadedImage;
+  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *Vol;
+  EFI_FILE_HANDLE                 RootDir;
+  EFI_FILE_HANDLE                 Handle;
+  EFI_FILE_INFO                   *FileInfo;
+  UINTN                           FileInfoSize;
+  UINTN                           Size;
+  UINT8                           *Buffer;
+  CHAR16                          *String;
+  UINTN                           Index;
+
+  Status = gBS->HandleProtocol (ImageHandle, &gEfiLoadedImageProtocolGuid, (VOID **)&LoadedImage);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Status = gBS->HandleProtocol (LoadedImage->DeviceHandle, &gEfiSimpleFileSystemProtocolGuid, (VOID **)&Vol);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Status = Vol->OpenVolume (Vol, &RootDir);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Status = RootDir->Open (RootDir, &Handle, FileName, EFI_FILE_MODE_READ, 0);
+  RootDir->Close (RootDir);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  FileInfoSize = sizeof (EFI_FILE_INFO) + 1024;
+  FileInfo     = AllocateZeroPool (FileInfoSize);
+  if (FileInfo == NULL) {
+    Handle->Close (Handle);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Status = Handle->GetInfo (Handle, &gEfiFileInfoGuid, &FileInfoSize, FileInfo);
+  Size   = (UINTN)FileInfo->FileSize;
+  FreePool (FileInfo);
+  if (EFI_ERROR (Status)) {
+    Handle->Close (Handle);
+    return Status;
+  }
+
+  Buffer = AllocateZeroPool (Size + sizeof (CHAR16));
+  if (Buffer == NULL) {
+    Handle->Close (Handle);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Status = Handle->Read (Handle, &Size, Buffer);
+  Handle->Close (Handle);
+  if (EFI_ERROR (Status)) {
+    FreePool (Buffer);
+    return Status;
+  }
+
+  if ((Size >= 2) && (Buffer[0] == 0xFF) && (Buffer[1] == 0xFE)) {
+    //
+    // UCS-2, already NUL terminated by the extra CHAR16
+    //
+    String = AllocateCopyPool (Size, Buffer + 2);
+  } else {
+    String = AllocateZeroPool ((Size + 1) * sizeof (CHAR16));
+    for (Index = 0; (String != NULL) && (Index < Size); Index++) {
+      String[Index] = Buffer[Index];
+    }
+  }
+  FreePool (Buffer);
+  if (String == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  *Text = String;
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Get the times of the baseline for the benchmarks that it has.
+
+  Only the lines that start with a quoted benchmark name are used, and the
+  time is the NsPerInstruction field of the first line of each benchmark.
+
+  @param  Text      - The content of the baseline
+  @param  Results   - The results, to fill in with the baseline
+  @param  Count     - Number of results
+
+**/
+VOID
+EdbBenchParseBaseline (
+  IN     CHAR16           *Text,
+  IN OUT EDB_BENCH_RESULT *Results,
+  IN     UINTN            Count
+  )
+{
+  CHAR16  *Name;
+  UINTN   NameLength;
+  UINTN   Field;
+  UINT64  Value;
+  UINTN   Digits;
+  UINTN   Index;
+
+  while (*Text != L'\0') {
+    if (*Text != L'"') {
+      goto NextLine;
+    }
+    Name = ++Text;
+    while ((*Text != L'"') && (*Text != L'\0') && (*Text != L'\n')) {
+      Text++;
+    }
+    if (*Text != L'"') {
+      goto NextLine;
+    }
+    NameLength = Text - Name;
+
+    //
+    // Name,Handler,Instructions,Runs,NsPerInstruction
+    //
+    for (Field = 0; (Field < 4) && (*Text != L'\0') && (*Text != L'\n'); Text++) {
+      if (*Text == L',') {
+        Field++;
+      }
+    }
+    if (Field < 4) {
+      goto NextLine;
+    }
+    Value = 0;
+    while ((*Text >= L'0') && (*Text <= L'9')) {
+      Value = MultU64x64 (Value, 10) + (*Text++ - L'0');
+    }
+    Value = MultU64x64 (Value, 100);
+    if (*Text == L'.') {
+      Text++;
+      for (Digits = 10; (Digits > 0) && (*Text >= L'0') && (*Text <= L'9'); Digits /= 10) {
+        Value += (*Text++ - L'0') * Digits;
+      }
+    }
+
+    for (Index = 0; Index < Count; Index++) {
+      if ((StrLen (Results[Index].Name) == NameLength) &&
+          (StrnCmp (Results[Index].Name, Name, NameLength) == 0)) {
+        if (Results[Index].Baseline == 0) {
+          Results[Index].Baseline = Value;
+        }
+        break;
+      }
+    }
+
+NextLine:
+    while ((*Text != L'\0') && (*Text != L'\n')) {
+      Text++;
+    }
+    if (*Text == L'\n') {
+      Text++;
+    }
+  }
+}
+
+/**
+
+  Print a CSV field with a time in hundredths, after a comma.
+
+  @param  Hundredths  - The time, in hundredths of nanoseconds
+
+**/
+VOID
+EdbBenchPrintTime (
+  IN UINT64 Hundredths
+  )
+{
+  UINT64  Remainder;
+
+  Hundredths = DivU64x64Remainder (Hundredths, 100, &Remainder);
+  Print (L",%ld.%02ld", Hundredths, Remainder);
+}
+
+/**
+
+  Get the change of a time from its baseline.
+
+  @param  Baseline  - The time of the baseline, not 0
+  @param  Current   - The time of this run
+  @param  Sign      - L'+' for a slow down, L'-' for a speed up
+
+  @return The change, in tenths of percent
+
+**/
+UINT64
+EdbBenchDelta (
+  IN  UINT64  Baseline,
+  IN  UINT64  Current,
+  OUT CHAR16  *Sign
+  )
+{
+  if (Current >= Baseline) {
+    *Sign = L'+';
+    return DivU64x64Remainder (MultU64x64 (Current - Baseline, 1000), Baseline, NULL);
+  }
+  *Sign = L'-';
+  return DivU64x64Remainder (MultU64x64 (Baseline - Current, 1000), Baseline, NULL);
+}
+
+/**
+
+  Compare the results with the baseline, and print the comparison as CSV,
+  for each benchmark and for each interpreter function.
+
+  A benchmark regressed when the low end of the confidence interval of its
+  median is slower than the baseline by more than the threshold. The change
+  for an interpreter function is that of the sum of its benchmarks.
+
+  @param  Results   - The results, with their baseline
+  @param  Count     - Number of results
+  @param  Threshold - The slow down that is a regression, in percent
+
+  @return Number of benchmarks that regressed
+
+**/
+UINTN
+EdbBenchCompare (
+  IN EDB_BENCH_RESULT *Results,
+  IN UINTN            Count,
+  IN UINTN            Threshold
+  )
+{
+  EDB_BENCH_RESULT  *Result;
+  UINT64            Baseline;
+  UINT64            Current;
+  UINT64            Delta;
+  UINT64            Tenths;
+  CHAR16            Sign;
+  BOOLEAN           Regressed;
+  UINTN             Regressions;
+  UINTN             Index;
+  UINTN             Other;
+
+  Print (L"\nBenchmark,Handler,Baseline,Current,Delta,Regressed\n");
+  Regressions = 0;
+  for (Index = 0; Index < Count; Index++) {
+    Result = &Results[Index];
+    if (EFI_ERROR (Result->Status) || (Result->Baseline == 0)) {
+      continue;
+    }
+    Regressed = (BOOLEAN)(MultU64x64 (Result->Low, 100) > MultU64x64 (Result->Baseline, 100 + Threshold));
+    if (Regressed) {
+      Regressions++;
+    }
+    Delta = DivU64x64Remainder (EdbBenchDelta (Result->Baseline, Result->Median, &Sign), 10, &Tenths);
+    Print (L"\"%s\",%s", Result->Name, Result->Handler);
+    EdbBenchPrintTime (Result->Baseline);
+    EdbBenchPrintTime (Result->Median);
+    Print (L",%c%ld.%ld%%,%s\n", Sign, Delta, Tenths, Regressed ? L"Yes" : L"No");
+  }
+
+  Print (L"\nHandler,Baseline,Current,Delta\n");
+  for (Index = 0; Index < Count; Index++) {
+    //
+    // Only list each function once, on its first benchmark
+    //
+    for (Other = 0; Other < Index; Other++) {
+      if (StrCmp (Results[Other].Handler, Results[Index].Handler) == 0) {
+        break;
+      }
+    }
+    if (Other < Index) {
+      continue;
+    }
+    Baseline = 0;
+    Current  = 0;
+    for (Other = Index; Other < Count; Other++) {
+      Result = &Results[Other];
+      if (EFI_ERROR (Result->Status) || (Result->Baseline == 0) ||
+          (StrCmp (Result->Handler, Results[Index].Handler) != 0)) {
+        continue;
+      }
+      Baseline += Result->Baseline;
+      Current  += Result->Median;
+    }
+    if (Baseline == 0) {
+      continue;
+    }
+    Delta = DivU64x64Remainder (EdbBenchDelta (Baseline, Current, &Sign), 10, &Tenths);
+    Print (L"%s", Results[Index].Handler);
+    EdbBenchPrintTime (Baseline);
+    EdbBenchPrintTime (Current);
+    Print (L",%c%ld.%ld%%\n", Sign, Delta, Tenths);
+  }
+  return Regressions;
+}
+
+/**
+
+  Run the opcode benchmarks and the programs of the corpus a number of times,
+  print the median of their results and its confidence interval as CSV, and
+  optionally compare them with a baseline.
+
+  Each benchmark is a generated EBC loop that repeats one instruction, or one
+  short sequence of instructions, and is run through the EBC protocol. The
+  time of an empty loop is taken off, so that the results are the time of
+  the instructions alone. The runs of the benchmarks are interleaved, so that
+  a change of the speed of the platform over time affects them all alike.
+
+  A baseline is the redirected output of a previous run, so that the effect
+  of a change of the interpreter can be checked by running the benchmarks
+  before and after it.
+
+  @param  ImageHandle   - The image handle of this application
+  @param  Iterations    - Number of iterations of each loop
+  @param  Runs          - Number of runs of each benchmark
+  @param  Baseline      - The path of the baseline, or NULL
+  @param  Threshold     - The slow down from the baseline that is a
+                          regression, in percent
+
+  @retval EFI_SUCCESS           - The benchmarks were run, without regression
+  @retval EFI_ABORTED           - A benchmark regressed
+  @retval EFI_INVALID_PARAMETER - Iterations or Runs is out of range
+  @retval EFI_NOT_FOUND         - The EBC protocol was not found
+  @retval Others                - The benchmarks could not be run
+
+**/
+EFI_STATUS
+EdbRunOpcodeBenchmarks (
+  IN EFI_HANDLE ImageHandle,
+  IN UINTN      Iterations,
+  IN UINTN      Runs,
+  IN CHAR16     *Baseline OPTIONAL,
+  IN UINTN      Threshold
+  )
+{
+  EFI_STATUS        Status;
+  EFI_EBC_PROTOCOL  *Ebc;
+  EDB_BENCH_RESULT  *Results;
+  EDB_BENCH_RESULT  *Result;
+  UINT64            *Samples;
+  UINT64            *Ticks;
+  UINT8             *Code;
+  UINT8             *Scratch;
+  CHAR16            *Text;
+  UINT64            Frequency;
+  UINT64            LoopTicks;
+  UINTN             BenchCount;
+  UINTN             Count;
+  UINTN             InstructionCount;
+  UINTN             Regressions;
+  UINTN             Index;
+  UINTN             Run;
+
+  if ((Iterations == 0) || (Runs == 0) || (Runs > EDB_BENCH_MAX_RUNS)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = gBS->LocateProtocol (&gEfiEbcProtocolGuid, NULL, (VOID **)&Ebc);
+  if (EFI_ERROR (Status)) {
+    Print (L"Error: EBC protocol not found.\n");
+    return EFI_NOT_FOUND;
+  }
+  //
+  // Use the frequency in MHz, so that the conversion to nanoseconds doesn't
+  // overflow
+  //
+  Frequency = DivU64x64Remainder (GetPerformanceCounterProperties (NULL, NULL), 1000000, NULL);
+  if (Frequency == 0) {
+    Print (L"Error: No performance counter.\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  BenchCount = sizeof (mEdbBenchmarks) / sizeof (mEdbBenchmarks[0]);
+  Count      = BenchCount + EdbGetCorpusSize ();
+  Text       = NULL;
+  Results    = AllocateZeroPool (Count * sizeof (EDB_BENCH_RESULT));
+  Samples    = AllocateZeroPool (Count * Runs * sizeof (UINT64));
+  Ticks      = AllocateZeroPool (Runs * sizeof (UINT64));
+  Code       = AllocatePool (EDB_BENCH_CODE_SIZE);
+  Scratch    = AllocatePool (EDB_BENCH_SCRATCH_SIZE);
+  if ((Results == NULL) || (Samples == NULL) || (Ticks == NULL) || (Code == NULL) || (Scratch == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  for (Index = 0; Index < BenchCount; Index++) {
+    Results[Index].Name    = mEdbBenchmarks[Index].Name;
+    Results[Index].Handler = EdbBenchHandler (&mEdbBenchmarks[Index]);
+  }
+  for (Run = 0; Run < Runs; Run++) {
+    //
+    // Time the loop alone first
+    //
+    Status = EdbBenchRun (Ebc, ImageHandle, &mEdbBenchmarkLoop, Iterations, Code, Scratch, &LoopTicks, &InstructionCount);
+    if (EFI_ERROR (Status)) {
+      Print (L"Error: Cannot run the benchmarks - %r\n", Status);
+      goto Done;
+    }
+    for (Index = 0; Index < BenchCount; Index++) {
+      Result = &Results[Index];
+      if (EFI_ERROR (Result->Status)) {
+        continue;
+      }
+      Result->Status = EdbBenchRun (Ebc, ImageHandle, &mEdbBenchmarks[Index], Iterations, Code, Scratch, &Ticks[0], &InstructionCount);
+      if (EFI_ERROR (Result->Status)) {
+        continue;
+      }
+      Ticks[0]             = (Ticks[0] > LoopTicks) ? (Ticks[0] - LoopTicks) : 0;
+      Result->Instructions = MultU64x64 (Iterations, InstructionCount);
+      Samples[Index * Runs + Run] = EdbBenchHundredths (Ticks[0], Frequency, Result->Instructions);
+    }
+  }
+
+  //
+  // The programs of the corpus are long enough to be timed as they are
+  //
+  for (Index = BenchCount; Index < Count; Index++) {
+    Result          = &Results[Index];
+    Result->Handler = L"Corpus";
+    Result->Status  = EdbTimeCorpusProgram (
+                        ImageHandle,
+                        Index - BenchCount,
+                        Runs,
+                        &Result->Name,
+                        &Result->Instructions,
+                        Ticks
+                        );
+    for (Run = 0; !EFI_ERROR (Result->Status) && (Run < Runs); Run++) {
+      Samples[Index * Runs + Run] = EdbBenchHundredths (Ticks[Run], Frequency, Result->Instructions);
+    }
+  }
+
+  Print (L"Benchmark,Handler,Instructions,Runs,NsPerInstruction,Low,High\n");
+  for (Index = 0; Index < Count; Index++) {
+    Result = &Results[Index];
+    if (EFI_ERROR (Result->Status)) {
+      Print (L"\"%s\",%s,0,0,0,0,0 (%r)\n", Result->Name, Result->Handler, Result->Status);
+      continue;
+    }
+    EdbBenchStatistics (&Samples[Index * Runs], Runs, Result);
+    Print (L"\"%s\",%s,%ld,%d", Result->Name, Result->Handler, Result->Instructions, Runs);
+    EdbBenchPrintTime (Result->Median);
+    EdbBenchPrintTime (Result->Low);
+    EdbBenchPrintTime (Result->High);
+    Print (L"\n");
+  }
+  Status = EFI_SUCCESS;
+
+  if (Baseline != NULL) {
+    Status = EdbBenchReadBaseline (ImageHandle, Baseline, &Text);
+    if (EFI_ERROR (Status)) {
+      Print (L"Error: Cannot read %s - %r\n", Baseline, Status);
+      goto Done;
+    }
+    EdbBenchParseBaseline (Text, Results, Count);
+    Regressions = EdbBenchCompare (Results, Count, Threshold);
+    if (Regressions != 0) {
+      Print (L"\n%d benchmark(s) regressed by more than %d%%.\n", Regressions, Threshold);
+      Status = EFI_ABORTED;
+    }
+  }
+
+Done:
+  if (Text != NULL) {
+    FreePool (Text);
+  }
+  if (Results != NULL) {
+    FreePool (Results);
+  }
+  if (Samples != NULL) {
+    FreePool (Samples);
+  }
+  if (Ticks != NULL) {
+    FreePool (Ticks);
+  }
+  if (Code != NULL) {
+    FreePool (Code);
+  }
+  if (Scratch != NULL) {
+    FreePool (Scratch);
+  }
+  return Status;
+}
@@ -0,0 +1,62 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#ifndef _EFI_EDB_BENCH_H_
+#define _EFI_EDB_BENCH_H_
+
+#include <Uefi.h>
+
+#define EDB_BENCH_DEFAULT_ITERATIONS  100000
+#define EDB_BENCH_DEFAULT_RUNS        7
+#define EDB_BENCH_DEFAULT_THRESHOLD   5
+
+/**
+
+  Run the opcode benchmarks and the programs of the corpus a number of times,
+  print the median of their results and its confidence interval as CSV, and
+  optionally compare them with a baseline.
+
+  Each benchmark is a generated EBC loop that repeats one instruction, or one
+  short sequence of instructions, and is run through the EBC protocol. The
+  time of an empty loop is taken off, so that the results are the time of
+  the instructions alone.
+
+  A baseline is the redirected output of a previous run, so that the effect
+  of a change of the interpreter can be checked by running the benchmarks
+  before and after it.
+
+  @param  ImageHandle   - The image handle of this application
+  @param  Iterations    - Number of iterations of each loop
+  @param  Runs          - Number of runs of each benchmark, up to 32
+  @param  Baseline      - The path of the baseline, or NULL
+  @param  Threshold     - The slow down from the baseline that is a
+                          regression, in percent
+
+  @retval EFI_SUCCESS           - The benchmarks were run, without regression
+  @retval EFI_ABORTED           - A benchmark regressed
+  @retval EFI_INVALID_PARAMETER - Iterations or Runs is out of range
+  @retval EFI_NOT_FOUND         - The EBC protocol was not found
+  @retval Others                - The benchmarks could not be run
+
+**/
+EFI_STATUS
+EdbRunOpcodeBenchmarks (
+  IN EFI_HANDLE ImageHandle,
+  IN UINTN      Iterations,
+  IN UINTN      Runs,
+  IN CHAR16     *Baseline OPTIONAL,
+  IN UINTN      Threshold
+  );
+
+#endif
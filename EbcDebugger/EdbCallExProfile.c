@@ -0,0 +1,285 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include "EdbCommon.h"
+#ifndef _GNU_EFI
+#include <Protocol/LoadedImage.h>
+#endif
+
+#include "EdbCallExProfile.h"
+
+//
+// Number of pointers of a protocol interface that are searched for a target
+//
+#define EDB_CALLEX_PROTOCOL_SLOTS  32
+
+//
+// The services of the boot and runtime services tables, in the order of the
+// tables, after their header
+//
+CHAR16 *mEdbBootServiceNames[] = {
+  L"gBS->RaiseTPL",
+  L"gBS->RestoreTPL",
+  L"gBS->AllocatePages",
+  L"gBS->FreePages",
+  L"gBS->GetMemoryMap",
+  L"gBS->AllocatePool",
+  L"gBS->FreePool",
+  L"gBS->CreateEvent",
+  L"gBS->SetTimer",
+  L"gBS->WaitForEvent",
+  L"gBS->SignalEvent",
+  L"gBS->CloseEvent",
+  L"gBS->CheckEvent",
+  L"gBS->InstallProtocolInterface",
+  L"gBS->ReinstallProtocolInterface",
+  L"gBS->UninstallProtocolInterface",
+  L"gBS->HandleProtocol",
+  NULL,                                     // Reserved
+  L"gBS->RegisterProtocolNotify",
+  L"gBS->LocateHandle",
+  L"gBS->LocateDevicePath",
+  L"gBS->InstallConfigurationTable",
+  L"gBS->LoadImage",
+  L"gBS->StartImage",
+  L"gBS->Exit",
+  L"gBS->UnloadImage",
+  L"gBS->ExitBootServices",
+  L"gBS->GetNextMonotonicCount",
+  L"gBS->Stall",
+  L"gBS->SetWatchdogTimer",
+  L"gBS->ConnectController",
+  L"gBS->DisconnectController",
+  L"gBS->OpenProtocol",
+  L"gBS->CloseProtocol",
+  L"gBS->OpenProtocolInformation",
+  L"gBS->ProtocolsPerHandle",
+  L"gBS->LocateHandleBuffer",
+  L"gBS->LocateProtocol",
+  L"gBS->InstallMultipleProtocolInterfaces",
+  L"gBS->UninstallMultipleProtocolInterfaces",
+  L"gBS->CalculateCrc32",
+  L"gBS->CopyMem",
+  L"gBS->SetMem",
+  L"gBS->CreateEventEx",
+};
+
+CHAR16 *mEdbRuntimeServiceNames[] = {
+  L"gRT->GetTime",
+  L"gRT->SetTime",
+  L"gRT->GetWakeupTime",
+  L"gRT->SetWakeupTime",
+  L"gRT->SetVirtualAddressMap",
+  L"gRT->ConvertPointer",
+  L"gRT->GetVariable",
+  L"gRT->GetNextVariableName",
+  L"gRT->SetVariable",
+  L"gRT->GetNextHighMonotonicCount",
+  L"gRT->ResetSystem",
+  L"gRT->UpdateCapsule",
+  L"gRT->QueryCapsuleCapabilities",
+  L"gRT->QueryVariableInfo",
+};
+
+/**
+
+  Get the targets of a CALLEX profile that took the most native time, then
+  the ones that were called the most.
+
+  @param  Profile   - The CALLEX profile
+  @param  Rows      - The rows that receive the targets, in decreasing order
+  @param  Count     - The number of rows
+
+  @return The number of rows that were filled
+
+**/
+UINTN
+EdbCallExTopTargets (
+  IN  EFI_EBC_CALLEX_PROFILE  *Profile,
+  OUT EFI_EBC_CALLEX_TARGET   **Rows,
+  IN  UINTN                   Count
+  )
+{
+  EFI_EBC_CALLEX_TARGET  *Target;
+  UINTN                  Used;
+  UINTN                  Index;
+  UINTN                  Row;
+
+  Used = 0;
+  for (Index = 0; Index < EFI_EBC_CALLEX_TARGETS; Index++) {
+    Target = &Profile->Targets[Index];
+    if (Target->Calls == 0) {
+      continue;
+    }
+    //
+    // Insertion sort, as there are few rows
+    //
+    for (Row = Used; Row > 0; Row--) {
+      if ((Rows[Row - 1]->NativeTime > Target->NativeTime) ||
+          ((Rows[Row - 1]->NativeTime == Target->NativeTime) && (Rows[Row - 1]->Calls >= Target->Calls))) {
+        break;
+      }
+      if (Row < Count) {
+        Rows[Row] = Rows[Row - 1];
+      }
+    }
+    if (Row < Count) {
+      Rows[Row] = Target;
+      if (Used < Count) {
+        Used++;
+      }
+    }
+  }
+  return Used;
+}
+
+/**
+
+  Find a target in a table of services.
+
+  @param  Table     - The services table, starting with its header
+  @param  Names     - The names of the services of the table
+  @param  NameCount - The number of names
+  @param  FuncAddr  - The target of the CALLEX
+
+  @return The name of the service, or NULL if the target isn't in the table
+
+**/
+CHAR16 *
+EdbFindCallExService (
+  IN EFI_TABLE_HEADER  *Table,
+  IN CHAR16            **Names,
+  IN UINTN             NameCount,
+  IN UINTN             FuncAddr
+  )
+{
+  UINTN  *Services;
+  UINTN  Count;
+  UINTN  Index;
+
+  if (Table == NULL) {
+    return NULL;
+  }
+  //
+  // Older tables may have fewer services
+  //
+  Services = (UINTN *) (Table + 1);
+  Count    = (Table->HeaderSize - sizeof (EFI_TABLE_HEADER)) / sizeof (UINTN);
+  if (Count > NameCount) {
+    Count = NameCount;
+  }
+  for (Index = 0; Index < Count; Index++) {
+    if ((Services[Index] == FuncAddr) && (Names[Index] != NULL)) {
+      return Names[Index];
+    }
+  }
+  return NULL;
+}
+
+/**
+
+  Find what a CALLEX target is: a boot or runtime service, a member of a
+  protocol interface that is installed on a handle, or an address in a
+  loaded image.
+
+  @param  FuncAddr  - The target of the CALLEX
+  @param  Name      - What the target is known as
+
+  @return TRUE if the target was found, FALSE if it is unknown
+
+**/
+BOOLEAN
+EdbResolveCallExTarget (
+  IN  UINTN                   FuncAddr,
+  OUT EDB_CALLEX_TARGET_NAME  *Name
+  )
+{
+  EFI_LOADED_IMAGE_PROTOCOL  *LoadedImage;
+  EFI_HANDLE                 *Handles;
+  EFI_GUID                   **Protocols;
+  EFI_STATUS                 Status;
+  UINTN                      *Interface;
+  UINTN                      HandleCount;
+  UINTN                      ProtocolCount;
+  UINTN                      HandleIndex;
+  UINTN                      ProtocolIndex;
+  UINTN                      Slot;
+
+  ZeroMem (Name, sizeof (EDB_CALLEX_TARGET_NAME));
+
+  Name->Service = EdbFindCallExService (
+                    (EFI_TABLE_HEADER *) gST->BootServices,
+                    mEdbBootServiceNames,
+                    sizeof (mEdbBootServiceNames) / sizeof (mEdbBootServiceNames[0]),
+                    FuncAddr
+                    );
+  if (Name->Service == NULL) {
+    Name->Service = EdbFindCallExService (
+                      (EFI_TABLE_HEADER *) gST->RuntimeServices,
+                      mEdbRuntimeServiceNames,
+                      sizeof (mEdbRuntimeServiceNames) / sizeof (mEdbRuntimeServiceNames[0]),
+                      FuncAddr
+                      );
+  }
+  if (Name->Service != NULL) {
+    return TRUE;
+  }
+
+  //
+  // Search the interfaces of all the protocols, which the EBC code gets its
+  // native calls from, and the loaded images on the way
+  //
+  Status = gBS->LocateHandleBuffer (AllHandles, NULL, NULL, &HandleCount, &Handles);
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+  for (HandleIndex = 0; (HandleIndex < HandleCount) && (Name->Protocol == NULL); HandleIndex++) {
+    Status = gBS->ProtocolsPerHandle (Handles[HandleIndex], &Protocols, &ProtocolCount);
+    if (EFI_ERROR (Status)) {
+      continue;
+    }
+    for (ProtocolIndex = 0; (ProtocolIndex < ProtocolCount) && (Name->Protocol == NULL); ProtocolIndex++) {
+      Status = gBS->HandleProtocol (Handles[HandleIndex], Protocols[ProtocolIndex], (VOID **) &Interface);
+      if (EFI_ERROR (Status) || (Interface == NULL)) {
+        continue;
+      }
+      if (CompareGuid (Protocols[ProtocolIndex], &gEfiLoadedImageProtocolGuid)) {
+        LoadedImage = (EFI_LOADED_IMAGE_PROTOCOL *) Interface;
+        if ((FuncAddr >= (UINTN) LoadedImage->ImageBase) &&
+            (FuncAddr - (UINTN) LoadedImage->ImageBase < LoadedImage->ImageSize)) {
+          Name->ImageBase = (UINTN) LoadedImage->ImageBase;
+          Name->Offset    = FuncAddr - Name->ImageBase;
+        }
+        continue;
+      }
+      //
+      // Interfaces may be smaller than this, but they are allocated from
+      // pool, which is mapped well past their end
+      //
+      for (Slot = 0; Slot < EDB_CALLEX_PROTOCOL_SLOTS; Slot++) {
+        if (Interface[Slot] == FuncAddr) {
+          CopyMem (&Name->ProtocolGuid, Protocols[ProtocolIndex], sizeof (EFI_GUID));
+          Name->Protocol  = &Name->ProtocolGuid;
+          Name->ImageBase = 0;
+          Name->Offset    = Slot * sizeof (UINTN);
+          break;
+        }
+      }
+    }
+    gBS->FreePool (Protocols);
+  }
+  gBS->FreePool (Handles);
+
+  return (BOOLEAN) ((Name->Protocol != NULL) || (Name->ImageBase != 0));
+}
@@ -0,0 +1,71 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#ifndef _EFI_EDB_CALLEX_PROFILE_H_
+#define _EFI_EDB_CALLEX_PROFILE_H_
+
+#include <Uefi.h>
+#include "EbcPerformance.h"
+
+//
+// What a CALLEX target is known as. Only one of Service, Protocol or
+// ImageBase is set, in this order of preference, or none if the target
+// is unknown.
+//
+typedef struct {
+  CHAR16    *Service;       ///< name of the boot or runtime service
+  EFI_GUID  *Protocol;      ///< protocol whose interface holds the target
+  UINTN     ImageBase;      ///< base of the image that contains the target
+  UINTN     Offset;         ///< of the member in the interface, or of the target in the image
+  EFI_GUID  ProtocolGuid;   ///< what Protocol points to
+} EDB_CALLEX_TARGET_NAME;
+
+/**
+
+  Get the targets of a CALLEX profile that took the most native time, then
+  the ones that were called the most.
+
+  @param  Profile   - The CALLEX profile
+  @param  Rows      - The rows that receive the targets, in decreasing order
+  @param  Count     - The number of rows
+
+  @return The number of rows that were filled
+
+**/
+UINTN
+EdbCallExTopTargets (
+  IN  EFI_EBC_CALLEX_PROFILE  *Profile,
+  OUT EFI_EBC_CALLEX_TARGET   **Rows,
+  IN  UINTN                   Count
+  );
+
+/**
+
+  Find what a CALLEX target is: a boot or runtime service, a member of a
+  protocol interface that is installed on a handle, or an address in a
+  loaded image.
+
+  @param  FuncAddr  - The target of the CALLEX
+  @param  Name      - What the target is known as
+
+  @return TRUE if the target was found, FALSE if it is unknown
+
+**/
+BOOLEAN
+EdbResolveCallExTarget (
+  IN  UINTN                   FuncAddr,
+  OUT EDB_CALLEX_TARGET_NAME  *Name
+  );
+
+#endif
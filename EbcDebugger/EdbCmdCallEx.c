@@ -0,0 +1,186 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include "Edb.h"
+#include "EbcInt.h"
+#include "EdbCallExProfile.h"
+
+//
+// Number of CALLEX targets shown by default
+//
+#define EDB_CALLEX_DEFAULT_TOP  16
+
+#if EBC_PERFORMANCE_COUNTERS
+/**
+
+  Show the CALLEX targets that took the most native time, then the ones that
+  were called the most.
+
+  @param  Profile         - The CALLEX profile
+  @param  Top             - The number of targets to show
+
+**/
+VOID
+EdbShowCallExProfile (
+  IN EFI_EBC_CALLEX_PROFILE  *Profile,
+  IN UINTN                   Top
+  )
+{
+  EFI_EBC_CALLEX_TARGET   **Rows;
+  EDB_CALLEX_TARGET_NAME  Name;
+  UINTN                   Count;
+  UINTN                   Index;
+
+  Rows = AllocatePool (sizeof (EFI_EBC_CALLEX_TARGET *) * Top);
+  if (Rows == NULL) {
+    EDBPrint (L"CallExStat: out of resources\n");
+    return;
+  }
+
+  EDBPrint (L"      Target           Calls    Thunks    Direct    NativeTime     MaxTime  Name\n");
+  EDBPrint (L"  ================ ========= ========= ========= ============= ============ ========\n");
+  Count = EdbCallExTopTargets (Profile, Rows, Top);
+  for (Index = 0; Index < Count; Index++) {
+    EDBPrint (
+      L"  %016lx %9ld %9ld %9ld %13ld %12ld ",
+      Rows[Index]->FuncAddr,
+      Rows[Index]->Calls,
+      Rows[Index]->Thunks,
+      Rows[Index]->Direct,
+      Rows[Index]->NativeTime,
+      Rows[Index]->MaxTime
+      );
+    EdbResolveCallExTarget ((UINTN) Rows[Index]->FuncAddr, &Name);
+    if (Name.Service != NULL) {
+      EDBPrint (L"%s\n", Name.Service);
+    } else if (Name.Protocol != NULL) {
+      EDBPrint (L"%g+0x%x\n", Name.Protocol, Name.Offset);
+    } else if (Name.ImageBase != 0) {
+      EDBPrint (L"image %016lx+0x%x\n", (UINT64)Name.ImageBase, Name.Offset);
+    } else {
+      EDBPrint (L"?\n");
+    }
+  }
+  if (Profile->Lost != 0) {
+    EDBPrint (L"  Lost: %ld\n", Profile->Lost);
+  }
+
+  FreePool (Rows);
+}
+#endif
+
+/**
+
+  DebuggerCommand - CallExStat.
+
+  @param  CommandArg      - The argument for this command
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  ExceptionType   - Exception type.
+  @param  SystemContext   - EBC system context.
+
+  @retval EFI_DEBUG_CONTINUE - formal return value
+
+**/
+EFI_DEBUG_STATUS
+DebuggerCallExStat (
+  IN     CHAR16                    *CommandArg,
+  IN     EFI_DEBUGGER_PRIVATE_DATA *DebuggerPrivate,
+  IN     EFI_EXCEPTION_TYPE        ExceptionType,
+  IN OUT EFI_SYSTEM_CONTEXT        SystemContext
+  )
+{
+#if EBC_PERFORMANCE_COUNTERS
+  EFI_EBC_PERFORMANCE_PROTOCOL  *Performance;
+  EFI_EBC_CALLEX_PROFILE        *Profile;
+  EFI_STATUS                    Status;
+#endif
+  UINTN                         Top;
+  UINTN                         Index;
+
+#if EBC_PERFORMANCE_COUNTERS
+  Performance = &mEbcPerformanceProtocol;
+#endif
+  Top = EDB_CALLEX_DEFAULT_TOP;
+  if (CommandArg != NULL) {
+#if EBC_PERFORMANCE_COUNTERS
+    if (StriCmp (CommandArg, L"on") == 0) {
+      //
+      // The performance counters of a call into EBC are set up when it starts,
+      // so the call that we stopped in is not profiled
+      //
+      Performance->Enable (Performance, TRUE);
+      EDBPrint (L"CallExStat: on\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"off") == 0) {
+      Performance->Enable (Performance, FALSE);
+      EDBPrint (L"CallExStat: off\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+#endif
+    if (StriCmp (CommandArg, L"reset") == 0) {
+      EbcResetCallExServices ();
+#if EBC_PERFORMANCE_COUNTERS
+      //
+      // This resets the other performance counters too
+      //
+      Performance->Reset (Performance);
+#endif
+      return EFI_DEBUG_CONTINUE;
+    }
+    Top = Xtoi (CommandArg);
+    if ((Top == 0) || (Top > EFI_EBC_CALLEX_TARGETS)) {
+      EDBPrint (L"CallExStat: invalid argument\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+  }
+
+  //
+  // Show the direct calls to each service
+  //
+  EDBPrint (L"          Service           Address          Calls\n");
+  EDBPrint (L"  ===================== ================ ================\n");
+  for (Index = 0; Index < mEbcCallExServiceCount; Index++) {
+    EDBPrint (
+      L"  %-21s %016lx %16ld\n",
+      mEbcCallExServices[Index].Name,
+      (UINT64)mEbcCallExServices[Index].FuncAddr,
+      mEbcCallExServices[Index].Count
+      );
+  }
+
+#if EBC_PERFORMANCE_COUNTERS
+  //
+  // Show the targets of all the CALLEX, direct or not
+  //
+  Profile = AllocatePool (sizeof (EFI_EBC_CALLEX_PROFILE));
+  if (Profile == NULL) {
+    EDBPrint (L"CallExStat: out of resources\n");
+    return EFI_DEBUG_CONTINUE;
+  }
+  Status = Performance->CallExSnapshot (Performance, Profile);
+  if (EFI_ERROR (Status)) {
+    EDBPrint (L"\nCallExStat: no profile - use 'callexstat on' to start profiling\n");
+  } else {
+    EDBPrint (L"\n");
+    EdbShowCallExProfile (Profile, Top);
+  }
+  FreePool (Profile);
+#endif
+
+  //
+  // Done
+  //
+  return EFI_DEBUG_CONTINUE;
+}
@@ -0,0 +1,428 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include "Edb.h"
+#include "EbcInt.h"
+
+//
+// Number of functions and calls shown, unless specified
+//
+#define EDB_CALLGRAPH_DEFAULT_TOP   16
+
+//
+// Size of a function name, as shown or exported
+//
+#define EDB_CALLGRAPH_NAME_MAX      (EFI_DEBUGGER_SYMBOL_NAME_MAX + 32)
+
+/**
+
+  Get the name of a function of the call graph, from the loaded symbols.
+  Native calls are named after their CALLEX instruction.
+
+  @param  Address         - The address of the function or CALLEX instruction
+  @param  Flags           - The flags of the call graph node
+  @param  Name            - The buffer receiving the name
+  @param  NameSize        - The size of the buffer, in bytes
+
+**/
+VOID
+EdbGetCallGraphName (
+  IN  UINTN   Address,
+  IN  UINT32  Flags,
+  OUT CHAR16  *Name,
+  IN  UINTN   NameSize
+  )
+{
+  EFI_DEBUGGER_SYMBOL_OBJECT *Object;
+  EFI_DEBUGGER_SYMBOL_ENTRY  *Entry;
+  UINTN                      SymbolAddress;
+  CHAR16                     *Prefix;
+
+  Prefix = ((Flags & EFI_DEBUGGER_CALLGRAPH_NATIVE) != 0) ? L"native@" : L"";
+
+  SymbolAddress = EbdFindSymbolAddress (Address, EdbMatchSymbolTypeLowerAddress, &Object, &Entry);
+  if ((SymbolAddress == 0) || (SymbolAddress == (UINTN) -1)) {
+    EDBSPrint (Name, NameSize, L"%s0x%lx", Prefix, (UINT64)Address);
+  } else if (SymbolAddress == Address) {
+    EDBSPrint (Name, NameSize, L"%s%a", Prefix, Entry->Name);
+  } else {
+    EDBSPrint (Name, NameSize, L"%s%a+0x%x", Prefix, Entry->Name, Address - SymbolAddress);
+  }
+}
+
+/**
+
+  Check whether a node of the call graph has an ancestor for the same
+  function, in which case its time is already part of the inclusive time
+  of that ancestor.
+
+  @param  Node            - The node table
+  @param  Index           - The index of the node
+
+  @retval TRUE            - The call is recursive
+  @retval FALSE           - The call is not recursive
+
+**/
+BOOLEAN
+EdbIsRecursiveCallGraphNode (
+  IN EFI_DEBUGGER_CALLGRAPH_NODE  *Node,
+  IN UINTN                        Index
+  )
+{
+  UINTN  Parent;
+
+  for (Parent = Node[Index].Parent; Parent != 0; Parent = Node[Parent].Parent) {
+    if ((Node[Parent].Address == Node[Index].Address) &&
+        ((Node[Parent].Flags & EFI_DEBUGGER_CALLGRAPH_NATIVE) == (Node[Index].Flags & EFI_DEBUGGER_CALLGRAPH_NATIVE))) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+
+  Find the node of a call graph table with the next highest time.
+
+  @param  Table           - The node table, of EFI_DEBUGGER_CALLGRAPH_NODE_MAX entries
+  @param  Prev            - The node returned by the previous call, or NULL
+  @param  Inclusive       - Whether to sort on the inclusive or exclusive time
+
+  @return The node, or NULL if there are no more nodes
+
+**/
+EFI_DEBUGGER_CALLGRAPH_NODE *
+EdbNextCallGraphNode (
+  IN EFI_DEBUGGER_CALLGRAPH_NODE  *Table,
+  IN EFI_DEBUGGER_CALLGRAPH_NODE  *Prev,
+  IN BOOLEAN                      Inclusive
+  )
+{
+  EFI_DEBUGGER_CALLGRAPH_NODE  *Node;
+  EFI_DEBUGGER_CALLGRAPH_NODE  *Best;
+  UINT64                       Time;
+  UINT64                       BestTime;
+  UINT64                       PrevTime;
+
+  Best     = NULL;
+  BestTime = 0;
+  PrevTime = 0;
+  if (Prev != NULL) {
+    PrevTime = Inclusive ? Prev->Inclusive : Prev->Exclusive;
+  }
+  for (Node = Table + 1; Node < Table + EFI_DEBUGGER_CALLGRAPH_NODE_MAX; Node++) {
+    if (Node->Calls == 0) {
+      continue;
+    }
+    Time = Inclusive ? Node->Inclusive : Node->Exclusive;
+    //
+    // Skip what was already returned. Nodes with the same time are
+    // returned in the order of the table.
+    //
+    if ((Prev != NULL) &&
+        ((Time > PrevTime) || ((Time == PrevTime) && (Node <= Prev)))) {
+      continue;
+    }
+    if ((Best == NULL) || (Time > BestTime)) {
+      Best     = Node;
+      BestTime = Time;
+    }
+  }
+
+  return Best;
+}
+
+/**
+
+  Print the functions that took the most time, and the calls between
+  functions that took the most time.
+
+  @param  CallGraphContext - The call graph context
+  @param  Top              - The number of functions and calls to show
+
+**/
+VOID
+EdbShowCallGraph (
+  IN EFI_DEBUGGER_CALLGRAPH_CONTEXT  *CallGraphContext,
+  IN UINTN                           Top
+  )
+{
+  EFI_DEBUGGER_CALLGRAPH_NODE  *Functions;
+  EFI_DEBUGGER_CALLGRAPH_NODE  *Edges;
+  EFI_DEBUGGER_CALLGRAPH_NODE  *Node;
+  EFI_DEBUGGER_CALLGRAPH_NODE  *Prev;
+  UINTN                        *FunctionIndex;
+  UINTN                        Index;
+  UINTN                        Target;
+  UINTN                        Rank;
+  UINT32                       Flags;
+  UINT64                       Frequency;
+  CHAR16                       Name[EDB_CALLGRAPH_NAME_MAX];
+  CHAR16                       CallerName[EDB_CALLGRAPH_NAME_MAX];
+
+  EbcReadClock (&Frequency);
+  EDBPrint (
+    L"CallGraph %s, %ld ticks per second, %d lost calls\n",
+    CallGraphContext->Enabled ? L"on" : L"off",
+    Frequency,
+    CallGraphContext->LostCount
+    );
+  if (CallGraphContext->Node == NULL) {
+    return ;
+  }
+
+  Functions     = AllocateZeroPool (sizeof(EFI_DEBUGGER_CALLGRAPH_NODE) * EFI_DEBUGGER_CALLGRAPH_NODE_MAX);
+  Edges         = AllocateZeroPool (sizeof(EFI_DEBUGGER_CALLGRAPH_NODE) * EFI_DEBUGGER_CALLGRAPH_NODE_MAX);
+  FunctionIndex = AllocateZeroPool (sizeof(UINTN) * EFI_DEBUGGER_CALLGRAPH_NODE_MAX);
+  if ((Functions == NULL) || (Edges == NULL) || (FunctionIndex == NULL)) {
+    EDBPrint (L"CallGraph: out of resources\n");
+    goto Done;
+  }
+
+  //
+  // Gather the nodes per callee, then per caller and callee. A recursive
+  // call only adds to the exclusive time, as its inclusive time is already
+  // part of the outermost call.
+  //
+  for (Index = 1; Index < EFI_DEBUGGER_CALLGRAPH_NODE_MAX; Index++) {
+    Node = &CallGraphContext->Node[Index];
+    if (Node->Calls == 0) {
+      continue;
+    }
+    Flags  = Node->Flags & EFI_DEBUGGER_CALLGRAPH_NATIVE;
+    Target = EbcDebuggerFindCallGraphNode (Functions, 0, Node->Address, Flags);
+    FunctionIndex[Index] = Target;
+    if (Target == 0) {
+      continue;
+    }
+    Functions[Target].Calls     += Node->Calls;
+    Functions[Target].Exclusive += Node->Exclusive;
+    if (!EdbIsRecursiveCallGraphNode (CallGraphContext->Node, Index)) {
+      Functions[Target].Inclusive += Node->Inclusive;
+    }
+  }
+  for (Index = 1; Index < EFI_DEBUGGER_CALLGRAPH_NODE_MAX; Index++) {
+    Node = &CallGraphContext->Node[Index];
+    if ((Node->Calls == 0) || (FunctionIndex[Index] == 0) ||
+        ((Node->Parent != 0) && (FunctionIndex[Node->Parent] == 0))) {
+      continue;
+    }
+    Flags  = Node->Flags & EFI_DEBUGGER_CALLGRAPH_NATIVE;
+    Target = EbcDebuggerFindCallGraphNode (Edges, FunctionIndex[Node->Parent], Node->Address, Flags);
+    if (Target == 0) {
+      continue;
+    }
+    Edges[Target].Calls     += Node->Calls;
+    Edges[Target].Exclusive += Node->Exclusive;
+    if (!EdbIsRecursiveCallGraphNode (CallGraphContext->Node, Index)) {
+      Edges[Target].Inclusive += Node->Inclusive;
+    }
+  }
+
+  EDBPrint (L"\n     Calls       Inclusive        Exclusive     Function\n");
+  EDBPrint (L"  ========== ================ ================ ========\n");
+  Prev = NULL;
+  for (Rank = 0; Rank < Top; Rank++) {
+    Node = EdbNextCallGraphNode (Functions, Prev, FALSE);
+    if (Node == NULL) {
+      break;
+    }
+    EdbGetCallGraphName (Node->Address, Node->Flags, Name, sizeof (Name));
+    EDBPrint (L"  %10ld %16ld %16ld %s\n", Node->Calls, Node->Inclusive, Node->Exclusive, Name);
+    Prev = Node;
+  }
+
+  EDBPrint (L"\n     Calls       Inclusive        Exclusive     Caller -> Callee\n");
+  EDBPrint (L"  ========== ================ ================ ================\n");
+  Prev = NULL;
+  for (Rank = 0; Rank < Top; Rank++) {
+    Node = EdbNextCallGraphNode (Edges, Prev, TRUE);
+    if (Node == NULL) {
+      break;
+    }
+    if (Node->Parent == 0) {
+      EDBSPrint (CallerName, sizeof (CallerName), L"<Entry>");
+    } else {
+      EdbGetCallGraphName (Functions[Node->Parent].Address, Functions[Node->Parent].Flags, CallerName, sizeof (CallerName));
+    }
+    EdbGetCallGraphName (Node->Address, Node->Flags, Name, sizeof (Name));
+    EDBPrint (L"  %10ld %16ld %16ld %s -> %s\n", Node->Calls, Node->Inclusive, Node->Exclusive, CallerName, Name);
+    Prev = Node;
+  }
+
+Done:
+  if (Functions != NULL) {
+    FreePool (Functions);
+  }
+  if (Edges != NULL) {
+    FreePool (Edges);
+  }
+  if (FunctionIndex != NULL) {
+    FreePool (FunctionIndex);
+  }
+}
+
+/**
+
+  Export the call graph in the collapsed stack format used to draw flame
+  graphs: one line per call path, with the frames separated by ';' and
+  followed by the exclusive time of the path, in ticks.
+
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  FileName        - The file to write
+
+  @retval EFI_SUCCESS     - The call graph was exported
+  @retval Others          - The file could not be written
+
+**/
+EFI_STATUS
+EdbExportCallGraph (
+  IN EFI_DEBUGGER_PRIVATE_DATA  *DebuggerPrivate,
+  IN CHAR16                     *FileName
+  )
+{
+  EFI_DEBUGGER_CALLGRAPH_NODE  *Node;
+  EFI_FILE_HANDLE              Handle;
+  EFI_STATUS                   Status;
+  UINTN                        Path[EFI_DEBUGGER_CALLGRAPH_DEPTH_MAX];
+  UINTN                        Depth;
+  UINTN                        Index;
+  UINTN                        Parent;
+  CHAR16                       Name[EDB_CALLGRAPH_NAME_MAX];
+
+  Node = DebuggerPrivate->CallGraphContext.Node;
+  if (Node == NULL) {
+    return EFI_NOT_STARTED;
+  }
+
+  Status = CreateFileOnVol (DebuggerPrivate, FileName, &Handle);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  for (Index = 1; (Index < EFI_DEBUGGER_CALLGRAPH_NODE_MAX) && !EFI_ERROR (Status); Index++) {
+    if ((Node[Index].Calls == 0) || (Node[Index].Exclusive == 0)) {
+      continue;
+    }
+    //
+    // Nodes are only added below the maximum depth, so the path fits
+    //
+    Depth = 0;
+    for (Parent = Index; (Parent != 0) && (Depth < EFI_DEBUGGER_CALLGRAPH_DEPTH_MAX); Parent = Node[Parent].Parent) {
+      Path[Depth++] = Parent;
+    }
+    while ((Depth > 0) && !EFI_ERROR (Status)) {
+      Depth--;
+      EdbGetCallGraphName (Node[Path[Depth]].Address, Node[Path[Depth]].Flags, Name, sizeof (Name));
+      Status = WriteFilePrint (Handle, (Depth == 0) ? L"%s" : L"%s;", Name);
+    }
+    if (!EFI_ERROR (Status)) {
+      Status = WriteFilePrint (Handle, L" %ld\n", Node[Index].Exclusive);
+    }
+  }
+
+  Handle->Close (Handle);
+  return Status;
+}
+
+/**
+
+  DebuggerCommand - CallGraph.
+
+  @param  CommandArg      - The argument for this command
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  ExceptionType   - Exception type.
+  @param  SystemContext   - EBC system context.
+
+  @retval EFI_DEBUG_CONTINUE - formal return value
+
+**/
+EFI_DEBUG_STATUS
+DebuggerCallGraph (
+  IN     CHAR16                    *CommandArg,
+  IN     EFI_DEBUGGER_PRIVATE_DATA *DebuggerPrivate,
+  IN     EFI_EXCEPTION_TYPE        ExceptionType,
+  IN OUT EFI_SYSTEM_CONTEXT        SystemContext
+  )
+{
+  EFI_DEBUGGER_CALLGRAPH_CONTEXT  *CallGraphContext;
+  EFI_STATUS                      Status;
+  CHAR16                          *FileName;
+  UINTN                           Top;
+
+  CallGraphContext = &DebuggerPrivate->CallGraphContext;
+
+  Top = EDB_CALLGRAPH_DEFAULT_TOP;
+  if (CommandArg != NULL) {
+    if (StriCmp (CommandArg, L"on") == 0) {
+      if (CallGraphContext->Node == NULL) {
+        CallGraphContext->Node = AllocateZeroPool (sizeof(EFI_DEBUGGER_CALLGRAPH_NODE) * EFI_DEBUGGER_CALLGRAPH_NODE_MAX);
+        if (CallGraphContext->Node == NULL) {
+          EDBPrint (L"CallGraph: out of resources\n");
+          return EFI_DEBUG_CONTINUE;
+        }
+        CallGraphContext->Node[0].Flags = EFI_DEBUGGER_CALLGRAPH_USED;
+      }
+      //
+      // The calls in progress are not tracked, as their start is unknown
+      //
+      CallGraphContext->Depth   = 0;
+      CallGraphContext->Enabled = TRUE;
+      EDBPrint (L"CallGraph: on\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"off") == 0) {
+      CallGraphContext->Enabled = FALSE;
+      CallGraphContext->Depth   = 0;
+      EDBPrint (L"CallGraph: off\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"reset") == 0) {
+      if (CallGraphContext->Node != NULL) {
+        ZeroMem (CallGraphContext->Node, sizeof(EFI_DEBUGGER_CALLGRAPH_NODE) * EFI_DEBUGGER_CALLGRAPH_NODE_MAX);
+        CallGraphContext->Node[0].Flags = EFI_DEBUGGER_CALLGRAPH_USED;
+      }
+      CallGraphContext->Depth     = 0;
+      CallGraphContext->LostCount = 0;
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"export") == 0) {
+      FileName = StrGetNextTokenLine (L" ");
+      if (FileName == NULL) {
+        EDBPrint (L"CallGraph: file name missing\n");
+        return EFI_DEBUG_CONTINUE;
+      }
+      Status = EdbExportCallGraph (DebuggerPrivate, FileName);
+      if (EFI_ERROR (Status)) {
+        EDBPrint (L"CallGraph: cannot export the call graph - %r\n", Status);
+      } else {
+        EDBPrint (L"CallGraph: exported to %s\n", FileName);
+      }
+      return EFI_DEBUG_CONTINUE;
+    }
+    Top = Xtoi (CommandArg);
+    if (Top == 0) {
+      EDBPrint (L"CallGraph: invalid argument\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+  }
+
+  EdbShowCallGraph (CallGraphContext, Top);
+
+  //
+  // Done
+  //
+  return EFI_DEBUG_CONTINUE;
+}
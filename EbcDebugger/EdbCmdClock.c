@@ -0,0 +1,84 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include "Edb.h"
+#include "EbcInt.h"
+
+/**
+
+  DebuggerCommand - Clock.
+
+  @param  CommandArg      - The argument for this command
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  ExceptionType   - Exception type.
+  @param  SystemContext   - EBC system context.
+
+  @retval EFI_DEBUG_CONTINUE - formal return value
+
+**/
+EFI_DEBUG_STATUS
+DebuggerClock (
+  IN     CHAR16                    *CommandArg,
+  IN     EFI_DEBUGGER_PRIVATE_DATA *DebuggerPrivate,
+  IN     EFI_EXCEPTION_TYPE        ExceptionType,
+  IN OUT EFI_SYSTEM_CONTEXT        SystemContext
+  )
+{
+  BOOLEAN  Virtual;
+  UINT64   Ticks;
+  UINT64   Frequency;
+
+  if (CommandArg != NULL) {
+    if (StriCmp (CommandArg, L"virtual") == 0) {
+      Virtual = TRUE;
+    } else if (StriCmp (CommandArg, L"real") == 0) {
+      Virtual = FALSE;
+    } else {
+      EDBPrint (L"Clock: invalid argument\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+
+#if EBC_PERFORMANCE_COUNTERS
+    //
+    // The counters are reset, as their times would mix both clocks
+    //
+    mEbcPerformanceProtocol.SetClock (&mEbcPerformanceProtocol, Virtual);
+#else
+    EbcSetVirtualClock (Virtual);
+#endif
+
+    //
+    // The debugger is paused on the clock it switches to
+    //
+    DebuggerPrivate->CallGraphContext.PauseTicks = 0;
+    DebuggerPrivate->CallGraphContext.PauseStart = EbcReadClock (NULL);
+    DebuggerPrivate->ProfileContext.NextSample   = DebuggerPrivate->CallGraphContext.PauseStart + EFI_DEBUG_PROFILE_VIRTUAL_INTERVAL;
+  }
+
+  Ticks = EbcReadClock (&Frequency);
+  EDBPrint (
+    L"Clock: %s, %ld ticks, %ld ticks per second\n",
+    mEbcVirtualClock ? L"virtual" : L"real",
+    Ticks,
+    Frequency
+    );
+  if (CommandArg != NULL) {
+    EDBPrint (L"Clock: reset the call graph, profile and timeline before measuring\n");
+  }
+
+  //
+  // Done
+  //
+  return EFI_DEBUG_CONTINUE;
+}
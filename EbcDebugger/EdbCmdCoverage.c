@@ -0,0 +1,256 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include "Edb.h"
+
+/**
+
+  Get the name of the image of a coverage bitmap, from the loaded symbols.
+
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  Image           - The coverage of the image
+
+  @return The name of the symbol file of the image, or NULL if there is none
+
+**/
+CHAR16 *
+EdbGetCoverageImageName (
+  IN EFI_DEBUGGER_PRIVATE_DATA    *DebuggerPrivate,
+  IN EFI_DEBUGGER_COVERAGE_IMAGE  *Image
+  )
+{
+  EFI_DEBUGGER_SYMBOL_CONTEXT  *DebuggerSymbolContext;
+  UINTN                        Index;
+
+  DebuggerSymbolContext = &DebuggerPrivate->DebuggerSymbolContext;
+  for (Index = 0; Index < DebuggerSymbolContext->ObjectCount; Index++) {
+    if (DebuggerSymbolContext->Object[Index].BaseAddress == Image->ImageBase) {
+      return DebuggerSymbolContext->Object[Index].Name;
+    }
+  }
+  return NULL;
+}
+
+/**
+
+  Count the units of an image where an instruction was executed.
+
+  @param  Image           - The coverage of the image
+
+  @return The number of bits that are set in the bitmap
+
+**/
+UINTN
+EdbCountCoverageUnits (
+  IN EFI_DEBUGGER_COVERAGE_IMAGE  *Image
+  )
+{
+  UINTN  Count;
+  UINTN  Index;
+  UINT8  Byte;
+
+  Count = 0;
+  for (Index = 0; Index < EFI_DEBUGGER_COVERAGE_BITMAP_SIZE (Image->ImageSize); Index++) {
+    for (Byte = Image->Bitmap[Index]; Byte != 0; Byte &= Byte - 1) {
+      Count++;
+    }
+  }
+  return Count;
+}
+
+/**
+
+  Show the coverage of each image.
+
+  @param  DebuggerPrivate - EBC Debugger private data structure
+
+**/
+VOID
+EdbShowCoverage (
+  IN EFI_DEBUGGER_PRIVATE_DATA  *DebuggerPrivate
+  )
+{
+  EFI_DEBUGGER_COVERAGE_IMAGE  *Image;
+  CHAR16                       *Name;
+
+  EDBPrint (
+    L"Coverage: %s\n",
+    DebuggerPrivate->CoverageContext.Enabled ? L"on" : L"off"
+    );
+  if (DebuggerPrivate->CoverageContext.Image == NULL) {
+    return;
+  }
+
+  EDBPrint (L"      Image            Base        Size   Executed Name\n");
+  EDBPrint (L"  ================ ================ ======== ======== ========\n");
+  for (Image = DebuggerPrivate->CoverageContext.Image; Image != NULL; Image = Image->Next) {
+    if (Image->ImageHandle == NULL) {
+      EDBPrint (L"  (unloaded)      ");
+    } else {
+      EDBPrint (L"  %016lx", (UINT64)(UINTN)Image->ImageHandle);
+    }
+    EDBPrint (
+      L" %016lx %08x %08x",
+      (UINT64)Image->ImageBase,
+      Image->ImageSize,
+      EdbCountCoverageUnits (Image)
+      );
+    Name = EdbGetCoverageImageName (DebuggerPrivate, Image);
+    if (Name == NULL) {
+      EDBPrint (L"\n");
+    } else {
+      EDBPrint (L" %s\n", Name);
+    }
+  }
+}
+
+/**
+
+  Save the coverage of all the images to a file, in the format that is
+  described in EdbCommon.h.
+
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  FileName        - The file to write to
+
+  @retval EFI_SUCCESS     - The coverage was saved
+  @retval EFI_NOT_STARTED - No coverage was recorded
+  @retval Others          - The file could not be written
+
+**/
+EFI_STATUS
+EdbSaveCoverage (
+  IN EFI_DEBUGGER_PRIVATE_DATA  *DebuggerPrivate,
+  IN CHAR16                     *FileName
+  )
+{
+  EFI_DEBUGGER_COVERAGE_FILE_HEADER  FileHeader;
+  EFI_DEBUGGER_COVERAGE_FILE_IMAGE   FileImage;
+  EFI_DEBUGGER_COVERAGE_IMAGE        *Image;
+  EFI_FILE_HANDLE                    Handle;
+  EFI_STATUS                         Status;
+  CHAR16                             *Name;
+  UINTN                              Size;
+  UINTN                              Index;
+
+  if (DebuggerPrivate->CoverageContext.Image == NULL) {
+    return EFI_NOT_STARTED;
+  }
+
+  Status = CreateFileOnVol (DebuggerPrivate, FileName, &Handle);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  ZeroMem (&FileHeader, sizeof (FileHeader));
+  FileHeader.Signature = EFI_DEBUGGER_COVERAGE_SIGNATURE;
+  FileHeader.Version   = EFI_DEBUGGER_COVERAGE_VERSION;
+  FileHeader.UnitSize  = EFI_DEBUGGER_COVERAGE_UNIT;
+  for (Image = DebuggerPrivate->CoverageContext.Image; Image != NULL; Image = Image->Next) {
+    FileHeader.ImageCount++;
+  }
+  Size   = sizeof (FileHeader);
+  Status = Handle->Write (Handle, &Size, &FileHeader);
+
+  for (Image = DebuggerPrivate->CoverageContext.Image; Image != NULL; Image = Image->Next) {
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+    ZeroMem (&FileImage, sizeof (FileImage));
+    FileImage.ImageBase  = (UINT64)Image->ImageBase;
+    FileImage.ImageSize  = (UINT32)Image->ImageSize;
+    FileImage.BitmapSize = (UINT32)EFI_DEBUGGER_COVERAGE_BITMAP_SIZE (Image->ImageSize);
+    //
+    // Symbol file names are all ASCII
+    //
+    Name = EdbGetCoverageImageName (DebuggerPrivate, Image);
+    if (Name != NULL) {
+      for (Index = 0; (Name[Index] != 0) && (Index < EFI_DEBUGGER_COVERAGE_NAME_MAX - 1); Index++) {
+        FileImage.Name[Index] = (CHAR8)Name[Index];
+      }
+    }
+    Size   = sizeof (FileImage);
+    Status = Handle->Write (Handle, &Size, &FileImage);
+    if (!EFI_ERROR (Status)) {
+      Size   = FileImage.BitmapSize;
+      Status = Handle->Write (Handle, &Size, Image->Bitmap);
+    }
+  }
+
+  Handle->Close (Handle);
+  return Status;
+}
+
+/**
+
+  DebuggerCommand - Coverage.
+
+  @param  CommandArg      - The argument for this command
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  ExceptionType   - Exception type.
+  @param  SystemContext   - EBC system context.
+
+  @retval EFI_DEBUG_CONTINUE - formal return value
+
+**/
+EFI_DEBUG_STATUS
+DebuggerCoverage (
+  IN     CHAR16                    *CommandArg,
+  IN     EFI_DEBUGGER_PRIVATE_DATA *DebuggerPrivate,
+  IN     EFI_EXCEPTION_TYPE        ExceptionType,
+  IN OUT EFI_SYSTEM_CONTEXT        SystemContext
+  )
+{
+  EFI_STATUS  Status;
+  CHAR16      *FileName;
+
+  if (CommandArg != NULL) {
+    if (StriCmp (CommandArg, L"on") == 0) {
+      DebuggerPrivate->CoverageContext.Enabled = TRUE;
+      EDBPrint (L"Coverage: on\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"off") == 0) {
+      DebuggerPrivate->CoverageContext.Enabled = FALSE;
+      EDBPrint (L"Coverage: off\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"reset") == 0) {
+      EbcDebuggerFreeCoverage ();
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"save") == 0) {
+      FileName = StrGetNextTokenLine (L" ");
+      if (FileName == NULL) {
+        EDBPrint (L"Coverage: file name missing\n");
+        return EFI_DEBUG_CONTINUE;
+      }
+      Status = EdbSaveCoverage (DebuggerPrivate, FileName);
+      if (EFI_ERROR (Status)) {
+        EDBPrint (L"Coverage: cannot save the coverage - %r\n", Status);
+      } else {
+        EDBPrint (L"Coverage: saved to %s\n", FileName);
+      }
+      return EFI_DEBUG_CONTINUE;
+    }
+    EDBPrint (L"Coverage: invalid argument\n");
+    return EFI_DEBUG_CONTINUE;
+  }
+
+  EdbShowCoverage (DebuggerPrivate);
+
+  //
+  // Done
+  //
+  return EFI_DEBUG_CONTINUE;
+}
@@ -0,0 +1,381 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include "Edb.h"
+#include "EdbEmit.h"
+
+#define EDB_EMIT_CHECK_CODE_SIZE  1024
+
+#define D   EDB_EMIT_DIRECT
+#define I   EDB_EMIT_INDIRECT
+#define X   EDB_EMIT_INDEX
+
+extern EDB_DISASM_INSTRUCTION mEdbDisasmInstructionTable[];
+
+typedef struct {
+  EDB_EMITTER         Emitter;
+  EFI_SYSTEM_CONTEXT  SystemContext;
+  UINTN               Checked;    ///< offset of the next instruction to check
+  UINTN               Count;
+  UINTN               Mismatches;
+} EDB_EMIT_CHECK_CONTEXT;
+
+/**
+
+  Compare two instruction strings, ignoring the spaces.
+
+  @param  String    - The disassembled instruction
+  @param  Expected  - The expected instruction
+
+  @retval TRUE  - The instructions are the same
+  @retval FALSE - The instructions differ
+
+**/
+BOOLEAN
+EdbEmitCheckCompare (
+  IN CHAR16 *String,
+  IN CHAR16 *Expected
+  )
+{
+  while (TRUE) {
+    while (*String == L' ') {
+      String++;
+    }
+    while (*Expected == L' ') {
+      Expected++;
+    }
+    if (*String != *Expected) {
+      return FALSE;
+    }
+    if (*String == L'\0') {
+      return TRUE;
+    }
+    String++;
+    Expected++;
+  }
+}
+
+/**
+
+  Disassemble the instruction that was just emitted, and check that it
+  decodes to the expected length and text.
+
+  @param  Context   - The check context
+  @param  Expected  - The expected instruction, as EdbDisasm prints it
+
+**/
+VOID
+EdbEmitCheck (
+  IN OUT EDB_EMIT_CHECK_CONTEXT *Context,
+  IN     CHAR16                 *Expected
+  )
+{
+  EFI_PHYSICAL_ADDRESS  Address;
+  UINT8                 Opcode;
+  UINTN                 Length;
+  UINTN                 Decoded;
+  CHAR16                *String;
+
+  Address          = (EFI_PHYSICAL_ADDRESS)(UINTN)(Context->Emitter.Buffer + Context->Checked);
+  Length           = Context->Emitter.Offset - Context->Checked;
+  Context->Checked = Context->Emitter.Offset;
+  Context->Count++;
+
+  Decoded = 0;
+  String  = NULL;
+  Opcode  = GET_OPCODE (Address);
+  if (!Context->Emitter.Overflow && (Opcode < OPCODE_MAX) && (mEdbDisasmInstructionTable[Opcode] != NULL)) {
+    Decoded = mEdbDisasmInstructionTable[Opcode] (Address, Context->SystemContext, &String);
+  }
+  if ((Decoded == Length) && (String != NULL) && EdbEmitCheckCompare (String, Expected)) {
+    return;
+  }
+
+  Context->Mismatches++;
+  EDBPrint (L"Emitted: %s (%d bytes)\n", Expected, Length);
+  EDBPrint (L"Decoded: %s (%d bytes)\n", ((Decoded != 0) && (String != NULL)) ? String : L"<Bad Instruction>", Decoded);
+}
+
+/**
+
+  Emit every form of every instruction, and check each of them.
+
+  @param  Context   - The check context
+
+**/
+VOID
+EdbEmitCheckInstructions (
+  IN OUT EDB_EMIT_CHECK_CONTEXT *Context
+  )
+{
+  EDB_EMITTER *Emitter;
+
+  Emitter = &Context->Emitter;
+
+  //
+  // MOVxx, MOVsnx and MOVnx, with each size of index
+  //
+  EdbEmitMov (Emitter, OPCODE_MOVBW, 1, D, 0, 2, D, 0);
+  EdbEmitCheck (Context, L"MOVbw R1, R2");
+  EdbEmitMov (Emitter, OPCODE_MOVWW, 1, I, 0, 2, I, 0);
+  EdbEmitCheck (Context, L"MOVww @R1, @R2");
+  EdbEmitMov (Emitter, OPCODE_MOVDW, 1, I | X, EdbEmitIndex (FALSE, 1, 8, 16), 2, D, 0);
+  EdbEmitCheck (Context, L"MOVdw @R1(+1,+8), R2");
+  EdbEmitMov (Emitter, OPCODE_MOVQW, 3, D, 0, 4, I | X, EdbEmitIndex (TRUE, 2, 16, 16));
+  EdbEmitCheck (Context, L"MOVqw R3, @R4(-2,-16)");
+  EdbEmitMov (Emitter, OPCODE_MOVBD, 5, I | X, EdbEmitIndex (FALSE, 3, 1000, 32), 6, I | X, EdbEmitIndex (FALSE, 0, 4, 32));
+  EdbEmitCheck (Context, L"MOVbd @R5(+3,+1000), @R6(+0,+4)");
+  EdbEmitMov (Emitter, OPCODE_MOVQQ, 7, I | X, EdbEmitIndex (FALSE, 1, 100000, 64), 0, I | X, EdbEmitIndex (TRUE, 5, 40, 64));
+  EdbEmitCheck (Context, L"MOVqq @R7(+1,+100000), @R0(-5,-40)");
+  EdbEmitMov (Emitter, OPCODE_MOVNW, 1, I | X, EdbEmitIndex (FALSE, 1, 0, 16), 2, D, 0);
+  EdbEmitCheck (Context, L"MOVnw @R1(+1,+0), R2");
+  EdbEmitMov (Emitter, OPCODE_MOVND, 1, D, 0, 2, I | X, EdbEmitIndex (FALSE, 1, 8, 32));
+  EdbEmitCheck (Context, L"MOVnd R1, @R2(+1,+8)");
+  EdbEmitMov (Emitter, OPCODE_MOVSNW, 1, D, 0, 2, D | X, 0x10);
+  EdbEmitCheck (Context, L"MOVsnw R1, R2(16)");
+  EdbEmitMov (Emitter, OPCODE_MOVSND, 1, I, 0, 2, I | X, EdbEmitIndex (FALSE, 1, 8, 32));
+  EdbEmitCheck (Context, L"MOVsnd @R1, @R2(+1,+8)");
+
+  //
+  // MOVI, MOVIn and MOVREL, with each size of immediate data
+  //
+  EdbEmitMovi (Emitter, OPCODE_MOVI, MOVI_MOVEWIDTH8, 1, D, 0, MOVI_DATAWIDTH16, 0x12);
+  EdbEmitCheck (Context, L"MOVIbw R1, 18");
+  EdbEmitMovi (Emitter, OPCODE_MOVI, MOVI_MOVEWIDTH16, 1, I, 0, MOVI_DATAWIDTH16, 0x1234);
+  EdbEmitCheck (Context, L"MOVIww @R1, 4660");
+  EdbEmitMovi (Emitter, OPCODE_MOVI, MOVI_MOVEWIDTH32, 1, I | X, EdbEmitIndex (FALSE, 1, 8, 16), MOVI_DATAWIDTH32, 0x12345678);
+  EdbEmitCheck (Context, L"MOVIdd @R1(+1,+8), 305419896");
+  EdbEmitMovi (Emitter, OPCODE_MOVI, MOVI_MOVEWIDTH64, 2, D, 0, MOVI_DATAWIDTH64, 0x123456789ABCDEF0ULL);
+  EdbEmitCheck (Context, L"MOVIqq R2, 1311768467463790320");
+  EdbEmitMovi (Emitter, OPCODE_MOVIN, 0, 3, D, 0, MOVI_DATAWIDTH16, EdbEmitIndex (FALSE, 1, 8, 16));
+  EdbEmitCheck (Context, L"MOVInw R3, (+1,+8)");
+  EdbEmitMovi (Emitter, OPCODE_MOVIN, 0, 3, I, 0, MOVI_DATAWIDTH32, EdbEmitIndex (TRUE, 2, 16, 32));
+  EdbEmitCheck (Context, L"MOVInd @R3, (-2,-16)");
+  EdbEmitMovi (Emitter, OPCODE_MOVIN, 0, 3, D, 0, MOVI_DATAWIDTH64, EdbEmitIndex (FALSE, 3, 24, 64));
+  EdbEmitCheck (Context, L"MOVInq R3, (+3,+24)");
+  EdbEmitMovi (Emitter, OPCODE_MOVREL, 0, 4, D, 0, MOVI_DATAWIDTH16, 0x10);
+  EdbEmitCheck (Context, L"MOVrelw R4, 0x0010");
+  EdbEmitMovi (Emitter, OPCODE_MOVREL, 0, 4, I | X, EdbEmitIndex (FALSE, 1, 8, 16), MOVI_DATAWIDTH32, 0x100);
+  EdbEmitCheck (Context, L"MOVreld @R4(+1,+8), 0x00000100");
+  EdbEmitMovi (Emitter, OPCODE_MOVREL, 0, 4, D, 0, MOVI_DATAWIDTH64, 0x1000);
+  EdbEmitCheck (Context, L"MOVrelq R4, 0x0000000000001000");
+
+  //
+  // Data manipulations, with each form of operand 2
+  //
+  EdbEmitDataManip (Emitter, OPCODE_ADD, FALSE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"ADD R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_SUB, TRUE, 1, I, 2, D, 0);
+  EdbEmitCheck (Context, L"SUB @R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_AND, TRUE, 1, D, 2, I | X, (UINT16)EdbEmitIndex (FALSE, 1, 8, 16));
+  EdbEmitCheck (Context, L"AND R1, @R2(+1,+8)");
+  EdbEmitDataManip (Emitter, OPCODE_OR, FALSE, 1, D, 2, D | X, 0x10);
+  EdbEmitCheck (Context, L"OR R1, R2(16)");
+  EdbEmitDataManip (Emitter, OPCODE_NOT, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"NOT R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_NEG, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"NEG R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_MUL, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"MUL R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_MULU, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"MULU R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_DIV, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"DIV R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_DIVU, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"DIVU R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_MOD, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"MOD R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_MODU, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"MODU R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_XOR, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"XOR R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_SHL, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"SHL R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_SHR, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"SHR R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_ASHR, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"ASHR R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_EXTNDB, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"EXTNDB R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_EXTNDW, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"EXTNDW R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_EXTNDD, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"EXTNDD R1, R2");
+
+  //
+  // CMP and CMPI
+  //
+  EdbEmitDataManip (Emitter, OPCODE_CMPEQ, FALSE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"CMPeq R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_CMPLTE, TRUE, 1, D, 2, I | X, (UINT16)EdbEmitIndex (FALSE, 1, 8, 16));
+  EdbEmitCheck (Context, L"CMPlte R1, @R2(+1,+8)");
+  EdbEmitDataManip (Emitter, OPCODE_CMPGTE, TRUE, 1, D, 2, D | X, 0x20);
+  EdbEmitCheck (Context, L"CMPgte R1, R2(32)");
+  EdbEmitDataManip (Emitter, OPCODE_CMPULTE, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"CMPulte R1, R2");
+  EdbEmitDataManip (Emitter, OPCODE_CMPUGTE, TRUE, 1, D, 2, D, 0);
+  EdbEmitCheck (Context, L"CMPugte R1, R2");
+  EdbEmitCmpi (Emitter, OPCODE_CMPIEQ, FALSE, 1, D, 0, FALSE, 0x1234);
+  EdbEmitCheck (Context, L"CMPIweq R1, 4660");
+  EdbEmitCmpi (Emitter, OPCODE_CMPILTE, TRUE, 1, I | X, (UINT16)EdbEmitIndex (FALSE, 1, 8, 16), TRUE, 0x12345678);
+  EdbEmitCheck (Context, L"CMPIdlte @R1(+1,+8), 305419896");
+  EdbEmitCmpi (Emitter, OPCODE_CMPIGTE, TRUE, 1, I, 0, FALSE, 0x10);
+  EdbEmitCheck (Context, L"CMPIwgte @R1, 16");
+  EdbEmitCmpi (Emitter, OPCODE_CMPIULTE, FALSE, 1, D, 0, TRUE, 0x10);
+  EdbEmitCheck (Context, L"CMPIdulte R1, 16");
+  EdbEmitCmpi (Emitter, OPCODE_CMPIUGTE, TRUE, 1, D, 0, FALSE, 0x10);
+  EdbEmitCheck (Context, L"CMPIwugte R1, 16");
+
+  //
+  // Jumps and calls, with each size of immediate data
+  //
+  EdbEmitJmp (Emitter, OPCODE_JMP, EDB_EMIT_ALWAYS | OPERAND_M_RELATIVE_ADDR, 0, D, 4, 0x10);
+  EdbEmitCheck (Context, L"JMP R0(16)");
+  EdbEmitJmp (Emitter, OPCODE_JMP, EDB_EMIT_CC, 1, I, 4, EdbEmitIndex (FALSE, 1, 8, 32));
+  EdbEmitCheck (Context, L"JMPcc @R1(+1,+8)");
+  EdbEmitJmp (Emitter, OPCODE_JMP, EDB_EMIT_CS, 2, D, 0, 0);
+  EdbEmitCheck (Context, L"JMPcs R2(0)");
+  EdbEmitJmp (Emitter, OPCODE_JMP, EDB_EMIT_ALWAYS, 0, D, 8, 0x123456789ABCDEF0ULL);
+  EdbEmitCheck (Context, L"JMP 0x123456789abcdef0");
+  EdbEmitJmp8 (Emitter, EDB_EMIT_ALWAYS, Emitter->Offset + 2);
+  EdbEmitCheck (Context, L"JMP8 0x00");
+  EdbEmitJmp8 (Emitter, EDB_EMIT_CC, Emitter->Offset);
+  EdbEmitCheck (Context, L"JMP8cc 0xff");
+  EdbEmitJmp8 (Emitter, EDB_EMIT_CS, Emitter->Offset + 0x20);
+  EdbEmitCheck (Context, L"JMP8cs 0x0f");
+  EdbEmitJmp (Emitter, OPCODE_CALL, OPERAND_M_RELATIVE_ADDR, 0, D, 4, 0x10);
+  EdbEmitCheck (Context, L"CALL R0(0x00000010)");
+  EdbEmitJmp (Emitter, OPCODE_CALL, 0, 1, I, 0, 0);
+  EdbEmitCheck (Context, L"CALL @R1");
+  EdbEmitJmp (Emitter, OPCODE_CALL, OPERAND_M_NATIVE_CALL, 1, I, 4, EdbEmitIndex (FALSE, 1, 8, 32));
+  EdbEmitCheck (Context, L"CALLEX @R1(+1,+8)");
+  EdbEmitJmp (Emitter, OPCODE_CALL, OPERAND_M_NATIVE_CALL, 0, D, 8, 0x123456789ABCDEF0ULL);
+  EdbEmitCheck (Context, L"CALLEX 0x123456789abcdef0");
+  EdbEmitRet (Emitter);
+  EdbEmitCheck (Context, L"RET");
+
+  //
+  // Stack and dedicated registers
+  //
+  EdbEmitPushPop (Emitter, OPCODE_PUSH, FALSE, 1, D, 0);
+  EdbEmitCheck (Context, L"PUSH R1");
+  EdbEmitPushPop (Emitter, OPCODE_PUSH, TRUE, 1, I | X, (UINT16)EdbEmitIndex (FALSE, 1, 8, 16));
+  EdbEmitCheck (Context, L"PUSH @R1(+1,+8)");
+  EdbEmitPushPop (Emitter, OPCODE_POP, TRUE, 1, D | X, 0x10);
+  EdbEmitCheck (Context, L"POP R1(16)");
+  EdbEmitPushPop (Emitter, OPCODE_PUSHN, FALSE, 1, I, 0);
+  EdbEmitCheck (Context, L"PUSHn @R1");
+  EdbEmitPushPop (Emitter, OPCODE_POPN, FALSE, 1, D, 0);
+  EdbEmitCheck (Context, L"POPn R1");
+  EdbEmitLoadSp (Emitter, EDB_EMIT_FLAGS, 2);
+  EdbEmitCheck (Context, L"LOADSP [FLAGS], R2");
+  EdbEmitStoreSp (Emitter, 1, EDB_EMIT_IP);
+  EdbEmitCheck (Context, L"STORESP R1, [IP]");
+  EdbEmitBreak (Emitter, 3);
+  EdbEmitCheck (Context, L"BREAK 3");
+}
+
+/**
+
+  Check that a PE32+ image of the emitted code reads back as the code, the
+  way a PE loader would read it.
+
+  @param  Emitter   - The emitter
+
+  @retval TRUE  - The image is correct
+  @retval FALSE - The image could not be made, or is incorrect
+
+**/
+BOOLEAN
+EdbEmitCheckImage (
+  IN EDB_EMITTER *Emitter
+  )
+{
+  UINT8                     *Image;
+  UINTN                     Size;
+  UINTN                     Entry;
+  EFI_IMAGE_DOS_HEADER      *DosHdr;
+  EFI_IMAGE_NT_HEADERS64    *NtHdr;
+  EFI_IMAGE_SECTION_HEADER  *Section;
+  BOOLEAN                   Result;
+
+  Size  = EdbEmitImageSize (Emitter);
+  Image = AllocatePool (Size);
+  if (Image == NULL) {
+    return FALSE;
+  }
+  Entry = Emitter->Offset - 2;
+  EdbEmitImage (Emitter, Entry, EFI_IMAGE_SUBSYSTEM_EFI_APPLICATION, Image);
+
+  DosHdr  = (EFI_IMAGE_DOS_HEADER *)Image;
+  NtHdr   = (EFI_IMAGE_NT_HEADERS64 *)(Image + DosHdr->e_lfanew);
+  Section = (EFI_IMAGE_SECTION_HEADER *)((UINT8 *)&NtHdr->OptionalHeader + NtHdr->FileHeader.SizeOfOptionalHeader);
+  Result  = (BOOLEAN)((DosHdr->e_magic == EFI_IMAGE_DOS_SIGNATURE) &&
+                      (NtHdr->Signature == EFI_IMAGE_NT_SIGNATURE) &&
+                      (NtHdr->FileHeader.Machine == EFI_IMAGE_MACHINE_EBC) &&
+                      (NtHdr->FileHeader.NumberOfSections == 1) &&
+                      (NtHdr->OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC) &&
+                      (NtHdr->OptionalHeader.SizeOfImage == Size) &&
+                      (Section->Misc.VirtualSize == Emitter->Offset) &&
+                      (Section->PointerToRawData + Section->SizeOfRawData <= Size) &&
+                      (NtHdr->OptionalHeader.AddressOfEntryPoint == Section->VirtualAddress + Entry) &&
+                      (CompareMem (Image + Section->PointerToRawData, Emitter->Buffer, Emitter->Offset) == 0));
+  FreePool (Image);
+  return Result;
+}
+
+/**
+
+  DebuggerCommand - EmitCheck.
+
+  @param  CommandArg      - The argument for this command
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  ExceptionType   - Exception type.
+  @param  SystemContext   - EBC system context.
+
+  @retval EFI_DEBUG_CONTINUE - formal return value
+
+**/
+EFI_DEBUG_STATUS
+DebuggerEmitCheck (
+  IN     CHAR16                    *CommandArg,
+  IN     EFI_DEBUGGER_PRIVATE_DATA *DebuggerPrivate,
+  IN     EFI_EXCEPTION_TYPE        ExceptionType,
+  IN OUT EFI_SYSTEM_CONTEXT        SystemContext
+  )
+{
+  EDB_EMIT_CHECK_CONTEXT  Context;
+  VOID                    *Buffer;
+
+  Buffer = AllocatePool (EDB_EMIT_CHECK_CODE_SIZE);
+  if (Buffer == NULL) {
+    EDBPrint (L"EmitCheck: out of resources\n");
+    return EFI_DEBUG_CONTINUE;
+  }
+  ZeroMem (&Context, sizeof (Context));
+  EdbEmitInit (&Context.Emitter, Buffer, EDB_EMIT_CHECK_CODE_SIZE);
+  Context.SystemContext = SystemContext;
+
+  EdbEmitCheckInstructions (&Context);
+  EDBPrint (
+    L"EmitCheck: %d instructions, %d bytes, %d mismatches\n",
+    Context.Count,
+    Context.Emitter.Offset,
+    Context.Mismatches
+    );
+  EDBPrint (L"EmitCheck: PE32+ image %s\n", EdbEmitCheckImage (&Context.Emitter) ? L"OK" : L"mismatch");
+
+  FreePool (Buffer);
+  return EFI_DEBUG_CONTINUE;
+}
@@ -0,0 +1,146 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include "Edb.h"
+#include "EbcInt.h"
+
+//
+// Number of entries shown per image, unless specified
+//
+#define EDB_EXEC_COUNT_DEFAULT_TOP  16
+
+/**
+
+  Print the symbol that an address belongs to, if any.
+
+  @param  Address         - The address
+
+**/
+VOID
+EdbPrintExecCountSymbol (
+  IN UINTN  Address
+  )
+{
+  EFI_DEBUGGER_SYMBOL_OBJECT *Object;
+  EFI_DEBUGGER_SYMBOL_ENTRY  *Entry;
+  UINTN                      SymbolAddress;
+
+  SymbolAddress = EbdFindSymbolAddress (Address, EdbMatchSymbolTypeLowerAddress, &Object, &Entry);
+  if ((SymbolAddress == 0) || (SymbolAddress == (UINTN) -1)) {
+    EDBPrint (L"\n");
+  } else if (SymbolAddress == Address) {
+    EDBPrint (L" %a\n", Entry->Name);
+  } else {
+    EDBPrint (L" %a+0x%x\n", Entry->Name, Address - SymbolAddress);
+  }
+}
+
+/**
+
+  DebuggerCommand - ExecCount.
+
+  @param  CommandArg      - The argument for this command
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  ExceptionType   - Exception type.
+  @param  SystemContext   - EBC system context.
+
+  @retval EFI_DEBUG_CONTINUE - formal return value
+
+**/
+EFI_DEBUG_STATUS
+DebuggerExecCount (
+  IN     CHAR16                    *CommandArg,
+  IN     EFI_DEBUGGER_PRIVATE_DATA *DebuggerPrivate,
+  IN     EFI_EXCEPTION_TYPE        ExceptionType,
+  IN OUT EFI_SYSTEM_CONTEXT        SystemContext
+  )
+{
+  EBC_IMAGE_LIST  *ImageList;
+  EBC_EXEC_COUNT  *Entry;
+  EBC_EXEC_COUNT  *Best;
+  EBC_EXEC_COUNT  *Prev;
+  UINTN           Top;
+  UINTN           Rank;
+
+  //
+  // Reset the counters, or get the number of entries to show
+  //
+  Top = EDB_EXEC_COUNT_DEFAULT_TOP;
+  if (CommandArg != NULL) {
+    if (StriCmp (CommandArg, L"reset") == 0) {
+      EbcResetExecCounts ();
+      return EFI_DEBUG_CONTINUE;
+    }
+    Top = Xtoi (CommandArg);
+    if (Top == 0) {
+      EDBPrint (L"ExecCount: invalid argument\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+  }
+
+  //
+  // Show the most executed function entries and loop heads of each image,
+  // in decreasing order
+  //
+  for (ImageList = mEbcImageList; ImageList != NULL; ImageList = ImageList->Next) {
+    EDBPrint (
+      L"Image %016lx (base %016lx), %d entries, %d lost\n",
+      (UINT64)(UINTN)ImageList->ImageHandle,
+      (UINT64)ImageList->ImageBase,
+      ImageList->ExecCountSize,
+      ImageList->ExecCountLost
+      );
+    if (ImageList->ExecCount == NULL) {
+      continue;
+    }
+    EDBPrint (L"      Address      Type   Count    Symbol\n");
+    EDBPrint (L"  ================ ==== ========== ========\n");
+    Prev = NULL;
+    for (Rank = 0; Rank < Top; Rank++) {
+      Best = NULL;
+      for (Entry = ImageList->ExecCount; Entry < ImageList->ExecCount + ImageList->ExecCountSize; Entry++) {
+        if (Entry->Key == 0) {
+          continue;
+        }
+        //
+        // Skip what was already shown. Entries with the same count are shown
+        // in the order of the table.
+        //
+        if ((Prev != NULL) &&
+            ((Entry->Count > Prev->Count) || ((Entry->Count == Prev->Count) && (Entry <= Prev)))) {
+          continue;
+        }
+        if ((Best == NULL) || (Entry->Count > Best->Count)) {
+          Best = Entry;
+        }
+      }
+      if (Best == NULL) {
+        break;
+      }
+      EDBPrint (
+        L"  %016lx %s %10d",
+        (UINT64)(ImageList->ImageBase + (Best->Key & ~EBC_EXEC_COUNT_LOOP)),
+        ((Best->Key & EBC_EXEC_COUNT_LOOP) != 0) ? L"loop" : L"call",
+        Best->Count
+        );
+      EdbPrintExecCountSymbol (ImageList->ImageBase + (Best->Key & ~EBC_EXEC_COUNT_LOOP));
+      Prev = Best;
+    }
+  }
+
+  //
+  // Done
+  //
+  return EFI_DEBUG_CONTINUE;
+}
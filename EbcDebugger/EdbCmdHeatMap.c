@@ -0,0 +1,346 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include "Edb.h"
+#include "EbcInt.h"
+
+//
+// Number of pages shown, unless specified
+//
+#define EDB_HEATMAP_DEFAULT_TOP  16
+
+/**
+
+  Get the memory map, to tell MMIO pages apart.
+
+  @param  MapSize         - The size of the memory map, in bytes
+  @param  DescriptorSize  - The size of a descriptor of the memory map
+
+  @return The memory map, which the caller frees, or NULL on error
+
+**/
+EFI_MEMORY_DESCRIPTOR *
+EdbGetMemoryMap (
+  OUT UINTN  *MapSize,
+  OUT UINTN  *DescriptorSize
+  )
+{
+  EFI_MEMORY_DESCRIPTOR  *Map;
+  EFI_STATUS             Status;
+  UINTN                  MapKey;
+  UINT32                 DescriptorVersion;
+
+  *MapSize = 0;
+  Status   = gBS->GetMemoryMap (MapSize, NULL, &MapKey, DescriptorSize, &DescriptorVersion);
+  if (Status != EFI_BUFFER_TOO_SMALL) {
+    return NULL;
+  }
+  //
+  // Allocating the buffer may add descriptors to the map
+  //
+  *MapSize += 4 * *DescriptorSize;
+  Map = AllocatePool (*MapSize);
+  if (Map == NULL) {
+    return NULL;
+  }
+  Status = gBS->GetMemoryMap (MapSize, Map, &MapKey, DescriptorSize, &DescriptorVersion);
+  if (EFI_ERROR (Status)) {
+    FreePool (Map);
+    return NULL;
+  }
+  return Map;
+}
+
+/**
+
+  Print what a page of the heat map is part of: an EBC image, an EBC stack,
+  MMIO, memory or an address that is not in the memory map.
+
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  Address         - The start of the page
+  @param  Map             - The memory map, or NULL if it is unknown
+  @param  MapSize         - The size of the memory map, in bytes
+  @param  DescriptorSize  - The size of a descriptor of the memory map
+
+**/
+VOID
+EdbPrintHeatMapPageOwner (
+  IN EFI_DEBUGGER_PRIVATE_DATA  *DebuggerPrivate,
+  IN UINTN                      Address,
+  IN EFI_MEMORY_DESCRIPTOR      *Map,
+  IN UINTN                      MapSize,
+  IN UINTN                      DescriptorSize
+  )
+{
+  EFI_DEBUGGER_SYMBOL_CONTEXT  *DebuggerSymbolContext;
+  EFI_MEMORY_DESCRIPTOR        *Descriptor;
+  EBC_IMAGE_LIST               *ImageList;
+  UINTN                        Index;
+
+  for (ImageList = mEbcImageList; ImageList != NULL; ImageList = ImageList->Next) {
+    if ((ImageList->ImageSize != 0) &&
+        (Address + EFI_PAGE_SIZE > ImageList->ImageBase) &&
+        (Address < ImageList->ImageBase + ImageList->ImageSize)) {
+      DebuggerSymbolContext = &DebuggerPrivate->DebuggerSymbolContext;
+      for (Index = 0; Index < DebuggerSymbolContext->ObjectCount; Index++) {
+        if (DebuggerSymbolContext->Object[Index].BaseAddress == ImageList->ImageBase) {
+          EDBPrint (L"image %s\n", DebuggerSymbolContext->Object[Index].Name);
+          return ;
+        }
+      }
+      EDBPrint (L"image %016lx\n", (UINT64)(UINTN)ImageList->ImageHandle);
+      return ;
+    }
+  }
+
+  for (Index = 0; Index < mStackNum; Index++) {
+    if ((Address + EFI_PAGE_SIZE > (UINTN)mStackBuffer[Index]) &&
+        (Address < (UINTN)mStackBuffer[Index] + mStackBufferSize[Index])) {
+      EDBPrint (L"stack\n");
+      return ;
+    }
+  }
+
+  if (Map == NULL) {
+    EDBPrint (L"?\n");
+    return ;
+  }
+  for (Descriptor = Map;
+       (UINTN)Descriptor < (UINTN)Map + MapSize;
+       Descriptor = NEXT_MEMORY_DESCRIPTOR (Descriptor, DescriptorSize)) {
+    if ((Address >= Descriptor->PhysicalStart) &&
+        (Address - Descriptor->PhysicalStart < LShiftU64 (Descriptor->NumberOfPages, EFI_PAGE_SHIFT))) {
+      if ((Descriptor->Type == EfiMemoryMappedIO) || (Descriptor->Type == EfiMemoryMappedIOPortSpace)) {
+        EDBPrint (L"mmio\n");
+      } else {
+        EDBPrint (L"memory\n");
+      }
+      return ;
+    }
+  }
+  //
+  // MMIO that is only reported to the GCD
+  //
+  EDBPrint (L"unmapped\n");
+}
+
+/**
+
+  Find the page of the heat map with the next highest number of accesses.
+
+  @param  Table           - The page table, of EFI_DEBUGGER_HEATMAP_PAGE_MAX entries
+  @param  Prev            - The page returned by the previous call, or NULL
+
+  @return The page, or NULL if there are no more pages
+
+**/
+EFI_DEBUGGER_HEATMAP_PAGE *
+EdbNextHeatMapPage (
+  IN EFI_DEBUGGER_HEATMAP_PAGE  *Table,
+  IN EFI_DEBUGGER_HEATMAP_PAGE  *Prev
+  )
+{
+  EFI_DEBUGGER_HEATMAP_PAGE  *Page;
+  EFI_DEBUGGER_HEATMAP_PAGE  *Best;
+
+  Best = NULL;
+  for (Page = Table; Page < Table + EFI_DEBUGGER_HEATMAP_PAGE_MAX; Page++) {
+    if (Page->Count == 0) {
+      continue;
+    }
+    //
+    // Skip what was already returned. Pages with the same count are
+    // returned in the order of the table.
+    //
+    if ((Prev != NULL) &&
+        ((Page->Count > Prev->Count) || ((Page->Count == Prev->Count) && (Page <= Prev)))) {
+      continue;
+    }
+    if ((Best == NULL) || (Page->Count > Best->Count)) {
+      Best = Page;
+    }
+  }
+
+  return Best;
+}
+
+/**
+
+  Print the accesses per size, and the pages that were accessed the most.
+
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  Top             - The number of pages to show
+
+**/
+VOID
+EdbShowHeatMap (
+  IN EFI_DEBUGGER_PRIVATE_DATA  *DebuggerPrivate,
+  IN UINTN                      Top
+  )
+{
+  EFI_DEBUGGER_HEATMAP_CONTEXT  *HeatMapContext;
+  EFI_DEBUGGER_HEATMAP_PAGE     *Page;
+  EFI_MEMORY_DESCRIPTOR         *Map;
+  UINTN                         MapSize;
+  UINTN                         DescriptorSize;
+  UINT64                        Read[EFI_DEBUGGER_HEATMAP_SIZES];
+  UINT64                        Write[EFI_DEBUGGER_HEATMAP_SIZES];
+  UINT64                        Unaligned;
+  UINT64                        Reads;
+  UINT64                        Writes;
+  UINTN                         PageCount;
+  UINTN                         Index;
+  UINTN                         SizeIndex;
+
+  HeatMapContext = &DebuggerPrivate->HeatMapContext;
+
+  ZeroMem (Read, sizeof (Read));
+  ZeroMem (Write, sizeof (Write));
+  Unaligned = 0;
+  PageCount = 0;
+  if (HeatMapContext->Page != NULL) {
+    for (Index = 0; Index < EFI_DEBUGGER_HEATMAP_PAGE_MAX; Index++) {
+      Page = &HeatMapContext->Page[Index];
+      if (Page->Count == 0) {
+        continue;
+      }
+      for (SizeIndex = 0; SizeIndex < EFI_DEBUGGER_HEATMAP_SIZES; SizeIndex++) {
+        Read[SizeIndex]  += Page->Read[SizeIndex];
+        Write[SizeIndex] += Page->Write[SizeIndex];
+      }
+      Unaligned += Page->Unaligned;
+      PageCount++;
+    }
+  }
+
+  EDBPrint (
+    L"HeatMap: %s, %d pages, %ld lost accesses\n",
+    HeatMapContext->Enabled ? L"on" : L"off",
+    PageCount,
+    HeatMapContext->LostCount
+    );
+  if (PageCount == 0) {
+    return;
+  }
+
+  EDBPrint (L"\n  Size      Reads      Writes\n");
+  EDBPrint (L"  ==== ========== ==========\n");
+  for (SizeIndex = 0; SizeIndex < EFI_DEBUGGER_HEATMAP_SIZES; SizeIndex++) {
+    EDBPrint (L"  %4d %10ld %10ld\n", 1 << SizeIndex, Read[SizeIndex], Write[SizeIndex]);
+  }
+  EDBPrint (L"  %ld unaligned accesses\n", Unaligned);
+
+  //
+  // The memory map is only needed to tell MMIO apart
+  //
+  Map = EdbGetMemoryMap (&MapSize, &DescriptorSize);
+
+  EDBPrint (L"\n        Page           Reads     Writes  Unaligned Where\n");
+  EDBPrint (L"  ================ ========== ========== ========== ========\n");
+  Page = NULL;
+  for (Index = 0; Index < Top; Index++) {
+    Page = EdbNextHeatMapPage (HeatMapContext->Page, Page);
+    if (Page == NULL) {
+      break;
+    }
+    Reads  = 0;
+    Writes = 0;
+    for (SizeIndex = 0; SizeIndex < EFI_DEBUGGER_HEATMAP_SIZES; SizeIndex++) {
+      Reads  += Page->Read[SizeIndex];
+      Writes += Page->Write[SizeIndex];
+    }
+    EDBPrint (
+      L"  %016lx %10ld %10ld %10ld ",
+      (UINT64)Page->Address,
+      Reads,
+      Writes,
+      Page->Unaligned
+      );
+    EdbPrintHeatMapPageOwner (DebuggerPrivate, Page->Address, Map, MapSize, DescriptorSize);
+  }
+
+  if (Map != NULL) {
+    FreePool (Map);
+  }
+}
+
+/**
+
+  DebuggerCommand - HeatMap.
+
+  @param  CommandArg      - The argument for this command
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  ExceptionType   - Exception type.
+  @param  SystemContext   - EBC system context.
+
+  @retval EFI_DEBUG_CONTINUE - formal return value
+
+**/
+EFI_DEBUG_STATUS
+DebuggerHeatMap (
+  IN     CHAR16                    *CommandArg,
+  IN     EFI_DEBUGGER_PRIVATE_DATA *DebuggerPrivate,
+  IN     EFI_EXCEPTION_TYPE        ExceptionType,
+  IN OUT EFI_SYSTEM_CONTEXT        SystemContext
+  )
+{
+  EFI_DEBUGGER_HEATMAP_CONTEXT  *HeatMapContext;
+  UINTN                         Top;
+
+  HeatMapContext = &DebuggerPrivate->HeatMapContext;
+
+  Top = EDB_HEATMAP_DEFAULT_TOP;
+  if (CommandArg != NULL) {
+    if (StriCmp (CommandArg, L"on") == 0) {
+#if EBC_MEMORY_ACCESS_HOOK
+      if (HeatMapContext->Page == NULL) {
+        HeatMapContext->Page = AllocateZeroPool (sizeof(EFI_DEBUGGER_HEATMAP_PAGE) * EFI_DEBUGGER_HEATMAP_PAGE_MAX);
+        if (HeatMapContext->Page == NULL) {
+          EDBPrint (L"HeatMap: out of resources\n");
+          return EFI_DEBUG_CONTINUE;
+        }
+      }
+      HeatMapContext->Enabled = TRUE;
+      EDBPrint (L"HeatMap: on\n");
+#else
+      EDBPrint (L"HeatMap: the interpreter was built without EBC_MEMORY_ACCESS_HOOK\n");
+#endif
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"off") == 0) {
+      HeatMapContext->Enabled = FALSE;
+      EDBPrint (L"HeatMap: off\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"reset") == 0) {
+      if (HeatMapContext->Page != NULL) {
+        ZeroMem (HeatMapContext->Page, sizeof(EFI_DEBUGGER_HEATMAP_PAGE) * EFI_DEBUGGER_HEATMAP_PAGE_MAX);
+      }
+      HeatMapContext->LostCount = 0;
+      return EFI_DEBUG_CONTINUE;
+    }
+    Top = Xtoi (CommandArg);
+    if (Top == 0) {
+      EDBPrint (L"HeatMap: invalid argument\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+  }
+
+  EdbShowHeatMap (DebuggerPrivate, Top);
+
+  //
+  // Done
+  //
+  return EFI_DEBUG_CONTINUE;
+}
@@ -0,0 +1,218 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include "Edb.h"
+#include "EbcInt.h"
+#include "EdbInstMix.h"
+
+//
+// Number of forms and pairs shown, unless specified
+//
+#define EDB_INSTMIX_DEFAULT_TOP  16
+
+#if EBC_INSTRUCTION_MIX
+
+/**
+
+  Print the count of a form or a pair, and its share of the total.
+
+  @param  Count           - The count
+  @param  Total           - The total, which must not be 0
+
+**/
+VOID
+EdbPrintInstMixCount (
+  IN UINT64  Count,
+  IN UINT64  Total
+  )
+{
+  UINTN  Hundredths;
+
+  Hundredths = (UINTN)DivU64x64Remainder (MultU64x64 (Count, 10000), Total, NULL);
+  EDBPrint (L"  %12ld %3d.%02d  ", Count, Hundredths / 100, Hundredths % 100);
+}
+
+/**
+
+  Show the most executed forms and pairs of opcodes of an instruction mix.
+
+  @param  Mix             - The instruction mix
+  @param  Rows            - The rows to use, of Top entries
+  @param  Top             - The number of forms and pairs to show
+
+**/
+VOID
+EdbShowInstMix (
+  IN EFI_EBC_INSTRUCTION_MIX  *Mix,
+  IN EDB_INSTMIX_ROW          *Rows,
+  IN UINTN                    Top
+  )
+{
+  CHAR16  Name[EDB_INSTMIX_NAME_MAX];
+  UINT64  Total;
+  UINTN   Count;
+  UINTN   Index;
+
+  Total = EdbInstMixTotal (Mix);
+  EDBPrint (L"  %ld instructions\n", Total);
+  if (Total == 0) {
+    return;
+  }
+
+  EDBPrint (L"\n          Count      %%     Form\n");
+  EDBPrint (L"  ============ ======  ====================\n");
+  Count = EdbInstMixTopForms (Mix, Rows, Top);
+  for (Index = 0; Index < Count; Index++) {
+    EdbPrintInstMixCount (Rows[Index].Count, Total);
+    EdbInstMixFormName (Rows[Index].Opcode, Rows[Index].Next, Name);
+    EDBPrint (L"%s\n", Name);
+  }
+
+  EDBPrint (L"\n          Count      %%     Pair\n");
+  EDBPrint (L"  ============ ======  ====================\n");
+  Count = EdbInstMixTopPairs (Mix, Rows, Top);
+  for (Index = 0; Index < Count; Index++) {
+    EdbPrintInstMixCount (Rows[Index].Count, Total);
+    EDBPrint (
+      L"%s, %s\n",
+      EdbInstMixOpcodeName (Rows[Index].Opcode),
+      EdbInstMixOpcodeName (Rows[Index].Next)
+      );
+  }
+}
+
+#endif
+
+/**
+
+  DebuggerCommand - InstMix.
+
+  @param  CommandArg      - The argument for this command
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  ExceptionType   - Exception type.
+  @param  SystemContext   - EBC system context.
+
+  @retval EFI_DEBUG_CONTINUE - formal return value
+
+**/
+EFI_DEBUG_STATUS
+DebuggerInstMix (
+  IN     CHAR16                    *CommandArg,
+  IN     EFI_DEBUGGER_PRIVATE_DATA *DebuggerPrivate,
+  IN     EFI_EXCEPTION_TYPE        ExceptionType,
+  IN OUT EFI_SYSTEM_CONTEXT        SystemContext
+  )
+{
+#if EBC_INSTRUCTION_MIX
+  EFI_EBC_PERFORMANCE_PROTOCOL  *Performance;
+  EFI_EBC_INSTRUCTION_MIX       *Mix;
+  EDB_INSTMIX_ROW               *Rows;
+  EBC_IMAGE_LIST                *ImageList;
+  EFI_STATUS                    Status;
+  BOOLEAN                       All;
+  UINTN                         Top;
+
+  Performance = &mEbcPerformanceProtocol;
+
+  All = FALSE;
+  Top = EDB_INSTMIX_DEFAULT_TOP;
+  if (CommandArg != NULL) {
+    if (StriCmp (CommandArg, L"on") == 0) {
+      Status = Performance->EnableMix (Performance, TRUE);
+      if (EFI_ERROR (Status)) {
+        EDBPrint (L"InstMix: cannot start counting - %r\n", Status);
+        return EFI_DEBUG_CONTINUE;
+      }
+      //
+      // The call that we stopped in counts from now on too
+      //
+      if (mVmPtr != NULL) {
+        EbcMixStart (mEbcVmPrivate, EbcFindImageHandle ((UINTN) mVmPtr->EntryPoint));
+      }
+      EDBPrint (L"InstMix: on\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"off") == 0) {
+      Performance->EnableMix (Performance, FALSE);
+      if (mVmPtr != NULL) {
+        mEbcVmPrivate->InstMix = NULL;
+      }
+      EDBPrint (L"InstMix: off\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"reset") == 0) {
+      //
+      // This resets the other performance counters too
+      //
+      Performance->Reset (Performance);
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"all") == 0) {
+      All = TRUE;
+    } else {
+      Top = Xtoi (CommandArg);
+      if ((Top == 0) || (Top > EFI_EBC_MIX_OPCODES * EFI_EBC_MIX_OPCODES)) {
+        EDBPrint (L"InstMix: invalid argument\n");
+        return EFI_DEBUG_CONTINUE;
+      }
+    }
+  }
+
+  Mix  = AllocatePool (sizeof (EFI_EBC_INSTRUCTION_MIX));
+  Rows = AllocatePool (sizeof (EDB_INSTMIX_ROW) * Top);
+  if ((Mix == NULL) || (Rows == NULL)) {
+    EDBPrint (L"InstMix: out of resources\n");
+    goto Done;
+  }
+
+  //
+  // Show the mix of all the images at once, including the ones that were
+  // unloaded, or the one of each image that was counted
+  //
+  if (All) {
+    Performance->MixSnapshot (Performance, NULL, Mix);
+    EDBPrint (L"All images\n");
+    EdbShowInstMix (Mix, Rows, Top);
+    goto Done;
+  }
+  for (ImageList = mEbcImageList; ImageList != NULL; ImageList = ImageList->Next) {
+    if (ImageList->Mix == NULL) {
+      continue;
+    }
+    Performance->MixSnapshot (Performance, ImageList->ImageHandle, Mix);
+    EDBPrint (
+      L"Image %016lx (base %016lx)\n",
+      (UINT64)(UINTN)ImageList->ImageHandle,
+      (UINT64)ImageList->ImageBase
+      );
+    EdbShowInstMix (Mix, Rows, Top);
+    EDBPrint (L"\n");
+  }
+
+Done:
+  if (Mix != NULL) {
+    FreePool (Mix);
+  }
+  if (Rows != NULL) {
+    FreePool (Rows);
+  }
+#else
+  EDBPrint (L"InstMix: the interpreter was built without EBC_INSTRUCTION_MIX\n");
+#endif
+
+  //
+  // Done
+  //
+  return EFI_DEBUG_CONTINUE;
+}
@@ -0,0 +1,103 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include "Edb.h"
+
+/**
+
+  Send the output of the debugger back to the console, closing the file it
+  was redirected to.
+
+  @param  LogContext      - The log context
+
+**/
+VOID
+EdbCloseLog (
+  IN EFI_DEBUGGER_LOG_CONTEXT  *LogContext
+  )
+{
+  if (LogContext->Handle == NULL) {
+    return ;
+  }
+
+  EdbFlushLog ();
+  LogContext->Handle->Close (LogContext->Handle);
+  LogContext->Handle = NULL;
+}
+
+/**
+
+  DebuggerCommand - Log.
+
+  @param  CommandArg      - The argument for this command
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  ExceptionType   - Exception type.
+  @param  SystemContext   - EBC system context.
+
+  @retval EFI_DEBUG_CONTINUE - formal return value
+
+**/
+EFI_DEBUG_STATUS
+DebuggerLog (
+  IN     CHAR16                    *CommandArg,
+  IN     EFI_DEBUGGER_PRIVATE_DATA *DebuggerPrivate,
+  IN     EFI_EXCEPTION_TYPE        ExceptionType,
+  IN OUT EFI_SYSTEM_CONTEXT        SystemContext
+  )
+{
+  EFI_DEBUGGER_LOG_CONTEXT  *LogContext;
+  EFI_FILE_HANDLE           Handle;
+  EFI_STATUS                Status;
+
+  LogContext = &DebuggerPrivate->LogContext;
+
+  if (CommandArg == NULL) {
+    if (LogContext->Handle == NULL) {
+      EDBPrint (L"Log: console\n");
+    } else {
+      EDBPrint (L"Log: file, %ld bytes written - %r\n", LogContext->Written, LogContext->Status);
+    }
+    return EFI_DEBUG_CONTINUE;
+  }
+
+  if (StriCmp (CommandArg, L"off") == 0) {
+    EdbCloseLog (LogContext);
+    EDBPrint (L"Log: console\n");
+    return EFI_DEBUG_CONTINUE;
+  }
+
+  //
+  // The output can only be redirected through the buffer
+  //
+  if (LogContext->Buffer == NULL) {
+    EDBPrint (L"Log: out of resources\n");
+    return EFI_DEBUG_CONTINUE;
+  }
+  Status = CreateFileOnVol (DebuggerPrivate, CommandArg, &Handle);
+  if (EFI_ERROR (Status)) {
+    EDBPrint (L"Log: cannot create %s - %r\n", CommandArg, Status);
+    return EFI_DEBUG_CONTINUE;
+  }
+  EdbCloseLog (LogContext);
+  EDBPrint (L"Log: %s\n", CommandArg);
+  EdbFlushLog ();
+  LogContext->Handle  = Handle;
+  LogContext->Written = 0;
+  LogContext->Status  = EFI_SUCCESS;
+
+  //
+  // Done
+  //
+  return EFI_DEBUG_CONTINUE;
+}
@@ -0,0 +1,437 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include "Edb.h"
+#include "EbcInt.h"
+
+//
+// Number of functions and instructions shown, unless specified
+//
+#define EDB_PROFILE_DEFAULT_TOP  16
+
+/**
+
+  Find the entry of an address in a profile table, adding it if needed.
+
+  @param  Table           - The profile table, of EFI_DEBUGGER_PROFILE_MAX entries
+  @param  Address         - The address, which must not be 0
+
+  @return The entry, or NULL if the table is too full to add it
+
+**/
+EFI_DEBUGGER_PROFILE_ENTRY *
+EdbProfileFindEntry (
+  IN EFI_DEBUGGER_PROFILE_ENTRY  *Table,
+  IN UINTN                       Address
+  )
+{
+  UINTN  Index;
+  UINTN  Probe;
+
+  Index = (Address ^ (Address >> 12)) & (EFI_DEBUGGER_PROFILE_MAX - 1);
+  for (Probe = 0; Probe < EFI_DEBUGGER_PROFILE_PROBES; Probe++) {
+    if (Table[Index].Address == 0) {
+      Table[Index].Address = Address;
+    }
+    if (Table[Index].Address == Address) {
+      return &Table[Index];
+    }
+    Index = (Index + 1) & (EFI_DEBUGGER_PROFILE_MAX - 1);
+  }
+
+  return NULL;
+}
+
+/**
+
+  Find the entry of a profile table with the next highest count.
+
+  @param  Table           - The profile table, of EFI_DEBUGGER_PROFILE_MAX entries
+  @param  Prev            - The entry returned by the previous call, or NULL
+
+  @return The entry, or NULL if there are no more entries
+
+**/
+EFI_DEBUGGER_PROFILE_ENTRY *
+EdbProfileNextEntry (
+  IN EFI_DEBUGGER_PROFILE_ENTRY  *Table,
+  IN EFI_DEBUGGER_PROFILE_ENTRY  *Prev
+  )
+{
+  EFI_DEBUGGER_PROFILE_ENTRY  *Entry;
+  EFI_DEBUGGER_PROFILE_ENTRY  *Best;
+
+  Best = NULL;
+  for (Entry = Table; Entry < Table + EFI_DEBUGGER_PROFILE_MAX; Entry++) {
+    if (Entry->Count == 0) {
+      continue;
+    }
+    //
+    // Skip what was already returned. Entries with the same count are
+    // returned in the order of the table.
+    //
+    if ((Prev != NULL) &&
+        ((Entry->Count > Prev->Count) || ((Entry->Count == Prev->Count) && (Entry <= Prev)))) {
+      continue;
+    }
+    if ((Best == NULL) || (Entry->Count > Best->Count)) {
+      Best = Entry;
+    }
+  }
+
+  return Best;
+}
+
+/**
+
+  Sample the IP of the running VM.
+
+  It is kept as short as possible: symbols are only looked up when the
+  profile is shown.
+
+  @param  VmPtr           - The running VM, or NULL if there is none
+
+**/
+VOID
+EdbProfileSample (
+  IN VM_CONTEXT               *VmPtr
+  )
+{
+  EFI_DEBUGGER_PROFILE_CONTEXT  *ProfileContext;
+  EFI_DEBUGGER_PROFILE_ENTRY    *Entry;
+
+  ProfileContext = &mDebuggerPrivate.ProfileContext;
+  if (ProfileContext->Suspended) {
+    return ;
+  }
+
+  ProfileContext->SampleCount++;
+  if ((VmPtr == NULL) || (VmPtr->Ip == 0)) {
+    ProfileContext->IdleCount++;
+    return ;
+  }
+
+  Entry = EdbProfileFindEntry (ProfileContext->Entry, (UINTN)VmPtr->Ip);
+  if (Entry == NULL) {
+    ProfileContext->LostCount++;
+    return ;
+  }
+  Entry->Count++;
+}
+
+/**
+
+  The profile timer notification, which samples the IP of the running VM.
+  While the virtual clock runs, the samples are taken by the interpreter
+  instead.
+
+  @param  Event           - The profile timer event
+  @param  Context         - The address of the VM_CONTEXT pointer
+
+**/
+VOID
+EFIAPI
+EdbProfileEventFunc (
+  IN EFI_EVENT                Event,
+  IN VOID                     *Context
+  )
+{
+  if (mEbcVirtualClock) {
+    return ;
+  }
+  EdbProfileSample (*(VM_CONTEXT **)Context);
+}
+
+/**
+
+  Print a number of samples, and the share of all the samples it represents.
+
+  @param  Count           - The number of samples
+  @param  Total           - The total number of samples
+
+**/
+VOID
+EdbPrintProfileCount (
+  IN UINTN  Count,
+  IN UINTN  Total
+  )
+{
+  UINTN  Hundredths;
+
+  Hundredths = (UINTN)DivU64x64Remainder (MultU64x64 (Count, 10000), Total, NULL);
+  EDBPrint (L"  %10d %3d.%02d ", Count, Hundredths / 100, Hundredths % 100);
+}
+
+/**
+
+  Start sampling the IP of the running VM.
+
+  @param  ProfileContext  - The profile context
+
+  @retval EFI_SUCCESS     - The profiler was started
+  @retval Others          - The profiler could not be started
+
+**/
+EFI_STATUS
+EdbStartProfile (
+  IN EFI_DEBUGGER_PROFILE_CONTEXT  *ProfileContext
+  )
+{
+  EFI_STATUS  Status;
+
+  if (ProfileContext->Event != NULL) {
+    return EFI_SUCCESS;
+  }
+  ProfileContext->NextSample = EbcReadClock (NULL) + EFI_DEBUG_PROFILE_VIRTUAL_INTERVAL;
+
+  if (ProfileContext->Entry == NULL) {
+    ProfileContext->Entry = AllocateZeroPool (sizeof(EFI_DEBUGGER_PROFILE_ENTRY) * EFI_DEBUGGER_PROFILE_MAX);
+    if (ProfileContext->Entry == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  //
+  // Same as the periodic callback of the interpreter: the notification
+  // needs to interrupt EBC code running at TPL_CALLBACK as well.
+  //
+  Status = gBS->CreateEvent (
+                  EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                  TPL_NOTIFY,
+                  EdbProfileEventFunc,
+                  &mVmPtr,
+                  &ProfileContext->Event
+                  );
+  if (EFI_ERROR (Status)) {
+    ProfileContext->Event = NULL;
+    return Status;
+  }
+
+  Status = gBS->SetTimer (
+                  ProfileContext->Event,
+                  TimerPeriodic,
+                  EFI_DEBUG_PROFILE_TIMER_INTERVAL
+                  );
+  if (EFI_ERROR (Status)) {
+    gBS->CloseEvent (ProfileContext->Event);
+    ProfileContext->Event = NULL;
+  }
+
+  return Status;
+}
+
+/**
+
+  Stop sampling the IP of the running VM. The samples are kept.
+
+  @param  ProfileContext  - The profile context
+
+**/
+VOID
+EdbStopProfile (
+  IN EFI_DEBUGGER_PROFILE_CONTEXT  *ProfileContext
+  )
+{
+  if (ProfileContext->Event != NULL) {
+    gBS->CloseEvent (ProfileContext->Event);
+    ProfileContext->Event = NULL;
+  }
+}
+
+/**
+
+  Print the flat profile: the functions and the instructions that were
+  sampled the most.
+
+  @param  ProfileContext  - The profile context
+  @param  Top             - The number of functions and instructions to show
+
+**/
+VOID
+EdbShowProfile (
+  IN EFI_DEBUGGER_PROFILE_CONTEXT  *ProfileContext,
+  IN UINTN                         Top
+  )
+{
+  EFI_DEBUGGER_PROFILE_ENTRY  *Functions;
+  EFI_DEBUGGER_PROFILE_ENTRY  *Function;
+  EFI_DEBUGGER_PROFILE_ENTRY  *Entry;
+  EFI_DEBUGGER_PROFILE_ENTRY  *Prev;
+  EFI_DEBUGGER_SYMBOL_OBJECT  *Object;
+  EFI_DEBUGGER_SYMBOL_ENTRY   *Symbol;
+  EBC_IMAGE_LIST              *ImageList;
+  UINTN                       SymbolAddress;
+  UINTN                       Unknown;
+  UINTN                       Total;
+  UINTN                       Rank;
+
+  EDBPrint (
+    L"Profile %s, %d samples, %d outside EBC, %d lost\n",
+    (ProfileContext->Event != NULL) ? L"on" : L"off",
+    ProfileContext->SampleCount,
+    ProfileContext->IdleCount,
+    ProfileContext->LostCount
+    );
+  Total = ProfileContext->SampleCount - ProfileContext->IdleCount;
+  if ((ProfileContext->Entry == NULL) || (Total == 0)) {
+    return ;
+  }
+
+  Functions = AllocateZeroPool (sizeof(EFI_DEBUGGER_PROFILE_ENTRY) * EFI_DEBUGGER_PROFILE_MAX);
+  if (Functions == NULL) {
+    EDBPrint (L"Profile: out of resources\n");
+    return ;
+  }
+
+  //
+  // Gather the samples per function, using the loaded symbols. Without
+  // symbols, the samples are gathered per image.
+  //
+  Unknown = 0;
+  for (Entry = ProfileContext->Entry; Entry < ProfileContext->Entry + EFI_DEBUGGER_PROFILE_MAX; Entry++) {
+    if (Entry->Count == 0) {
+      continue;
+    }
+    SymbolAddress = EbdFindSymbolAddress (Entry->Address, EdbMatchSymbolTypeLowerAddress, &Object, &Symbol);
+    if ((SymbolAddress == 0) || (SymbolAddress == (UINTN) -1)) {
+      SymbolAddress = 0;
+      for (ImageList = mEbcImageList; ImageList != NULL; ImageList = ImageList->Next) {
+        if (Entry->Address - ImageList->ImageBase < ImageList->ImageSize) {
+          SymbolAddress = ImageList->ImageBase;
+          break;
+        }
+      }
+    }
+    Function = NULL;
+    if (SymbolAddress != 0) {
+      Function = EdbProfileFindEntry (Functions, SymbolAddress);
+    }
+    if (Function == NULL) {
+      Unknown += Entry->Count;
+    } else {
+      Function->Count += Entry->Count;
+    }
+  }
+
+  EDBPrint (L"\n    Samples    %%     Function\n");
+  EDBPrint (L"  ========== ====== ========\n");
+  Prev = NULL;
+  for (Rank = 0; Rank < Top; Rank++) {
+    Function = EdbProfileNextEntry (Functions, Prev);
+    if (Function == NULL) {
+      break;
+    }
+    EdbPrintProfileCount (Function->Count, Total);
+    SymbolAddress = EbdFindSymbolAddress (Function->Address, EdbMatchSymbolTypeSameAdderss, &Object, &Symbol);
+    if (SymbolAddress == Function->Address) {
+      EDBPrint (L"%a\n", Symbol->Name);
+    } else {
+      EDBPrint (L"<Image %016lx>\n", (UINT64)Function->Address);
+    }
+    Prev = Function;
+  }
+  if (Unknown != 0) {
+    EdbPrintProfileCount (Unknown, Total);
+    EDBPrint (L"<Unknown>\n");
+  }
+
+  EDBPrint (L"\n    Samples    %%         Address      Symbol\n");
+  EDBPrint (L"  ========== ====== ================ ========\n");
+  Prev = NULL;
+  for (Rank = 0; Rank < Top; Rank++) {
+    Entry = EdbProfileNextEntry (ProfileContext->Entry, Prev);
+    if (Entry == NULL) {
+      break;
+    }
+    EdbPrintProfileCount (Entry->Count, Total);
+    EDBPrint (L"%016lx", (UINT64)Entry->Address);
+    SymbolAddress = EbdFindSymbolAddress (Entry->Address, EdbMatchSymbolTypeLowerAddress, &Object, &Symbol);
+    if ((SymbolAddress == 0) || (SymbolAddress == (UINTN) -1)) {
+      EDBPrint (L"\n");
+    } else if (SymbolAddress == Entry->Address) {
+      EDBPrint (L" %a\n", Symbol->Name);
+    } else {
+      EDBPrint (L" %a+0x%x\n", Symbol->Name, Entry->Address - SymbolAddress);
+    }
+    Prev = Entry;
+  }
+
+  FreePool (Functions);
+}
+
+/**
+
+  DebuggerCommand - Profile.
+
+  @param  CommandArg      - The argument for this command
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  ExceptionType   - Exception type.
+  @param  SystemContext   - EBC system context.
+
+  @retval EFI_DEBUG_CONTINUE - formal return value
+
+**/
+EFI_DEBUG_STATUS
+DebuggerProfile (
+  IN     CHAR16                    *CommandArg,
+  IN     EFI_DEBUGGER_PRIVATE_DATA *DebuggerPrivate,
+  IN     EFI_EXCEPTION_TYPE        ExceptionType,
+  IN OUT EFI_SYSTEM_CONTEXT        SystemContext
+  )
+{
+  EFI_DEBUGGER_PROFILE_CONTEXT  *ProfileContext;
+  EFI_STATUS                    Status;
+  UINTN                         Top;
+
+  ProfileContext = &DebuggerPrivate->ProfileContext;
+
+  Top = EDB_PROFILE_DEFAULT_TOP;
+  if (CommandArg != NULL) {
+    if (StriCmp (CommandArg, L"on") == 0) {
+      Status = EdbStartProfile (ProfileContext);
+      if (EFI_ERROR (Status)) {
+        EDBPrint (L"Profile: cannot start the profiler - %r\n", Status);
+      } else {
+        EDBPrint (L"Profile: on\n");
+      }
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"off") == 0) {
+      EdbStopProfile (ProfileContext);
+      EDBPrint (L"Profile: off\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"reset") == 0) {
+      if (ProfileContext->Entry != NULL) {
+        ZeroMem (ProfileContext->Entry, sizeof(EFI_DEBUGGER_PROFILE_ENTRY) * EFI_DEBUGGER_PROFILE_MAX);
+      }
+      ProfileContext->SampleCount = 0;
+      ProfileContext->IdleCount   = 0;
+      ProfileContext->LostCount   = 0;
+      return EFI_DEBUG_CONTINUE;
+    }
+    Top = Xtoi (CommandArg);
+    if (Top == 0) {
+      EDBPrint (L"Profile: invalid argument\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+  }
+
+  EdbShowProfile (ProfileContext, Top);
+
+  //
+  // Done
+  //
+  return EFI_DEBUG_CONTINUE;
+}
@@ -0,0 +1,225 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include "Edb.h"
+#include "EbcInt.h"
+
+/**
+
+  DebuggerCommand - StackUsage.
+
+  @param  CommandArg      - The argument for this command
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  ExceptionType   - Exception type.
+  @param  SystemContext   - EBC system context.
+
+  @retval EFI_DEBUG_CONTINUE - formal return value
+
+**/
+EFI_DEBUG_STATUS
+DebuggerStackUsage (
+  IN     CHAR16                    *CommandArg,
+  IN     EFI_DEBUGGER_PRIVATE_DATA *DebuggerPrivate,
+  IN     EFI_EXCEPTION_TYPE        ExceptionType,
+  IN OUT EFI_SYSTEM_CONTEXT        SystemContext
+  )
+{
+  EFI_STATUS      Status;
+  EFI_HANDLE      ImageHandle;
+  CHAR16          *CommandStr;
+  EBC_IMAGE_LIST  *ImageList;
+
+  //
+  // Set a stack size
+  //
+  if (CommandArg != NULL) {
+    if (StriCmp (CommandArg, L"default") == 0) {
+      ImageHandle = NULL;
+    } else {
+      ImageHandle = (EFI_HANDLE) Xtoi (CommandArg);
+    }
+    CommandStr = StrGetNextTokenLine (L" ");
+    if (CommandStr == NULL) {
+      EDBPrint (L"StackUsage: missing Size\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+
+    Status = EbcSetImageStackSize (ImageHandle, Xtoi (CommandStr));
+    if (EFI_ERROR (Status)) {
+      EDBPrint (L"StackUsage: cannot set stack size - %r\n", Status);
+    }
+    return EFI_DEBUG_CONTINUE;
+  }
+
+  //
+  // Show the stack usage of each image
+  //
+  EDBPrint (L"Default Stack Size: 0x%x\n", mEbcDefaultStackSize);
+  EDBPrint (L"    ImageHandle        ImageBase      Size     Peak    Calls\n");
+  EDBPrint (L"  ================ ================ ======== ======== ========\n");
+  for (ImageList = mEbcImageList; ImageList != NULL; ImageList = ImageList->Next) {
+    EDBPrint (
+      L"  %016lx %016lx %08x %08x %8d\n",
+      (UINT64)(UINTN)ImageList->ImageHandle,
+      (UINT64)ImageList->ImageBase,
+      EbcGetImageStackSize (ImageList),
+      ImageList->StackPeak,
+      ImageList->StackCount
+      );
+  }
+
+  //
+  // Done
+  //
+  return EFI_DEBUG_CONTINUE;
+}
+
+//
+// Stack use, in percent of the available stack, from which a peak is shown
+// as a near overflow
+//
+#define EDB_STACKDEPTH_WARNING      90
+
+/**
+
+  Print an address of the call chain of a stack depth peak, with the symbol
+  that it belongs to, if any.
+
+  @param  Address         - The address of the entry point or callee
+
+**/
+VOID
+EdbPrintStackDepthSymbol (
+  IN UINTN  Address
+  )
+{
+  EFI_DEBUGGER_SYMBOL_OBJECT *Object;
+  EFI_DEBUGGER_SYMBOL_ENTRY  *Entry;
+  UINTN                      SymbolAddress;
+
+  SymbolAddress = EbdFindSymbolAddress (Address, EdbMatchSymbolTypeLowerAddress, &Object, &Entry);
+  if ((SymbolAddress == 0) || (SymbolAddress == (UINTN) -1)) {
+    EDBPrint (L"    0x%016lx\n", (UINT64)Address);
+  } else if (SymbolAddress == Address) {
+    EDBPrint (L"    0x%016lx %a\n", (UINT64)Address, Entry->Name);
+  } else {
+    EDBPrint (L"    0x%016lx %a+0x%x\n", (UINT64)Address, Entry->Name, Address - SymbolAddress);
+  }
+}
+
+/**
+
+  DebuggerCommand - StackDepth.
+
+  @param  CommandArg      - The argument for this command
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  ExceptionType   - Exception type.
+  @param  SystemContext   - EBC system context.
+
+  @retval EFI_DEBUG_CONTINUE - formal return value
+
+**/
+EFI_DEBUG_STATUS
+DebuggerStackDepth (
+  IN     CHAR16                    *CommandArg,
+  IN     EFI_DEBUGGER_PRIVATE_DATA *DebuggerPrivate,
+  IN     EFI_EXCEPTION_TYPE        ExceptionType,
+  IN OUT EFI_SYSTEM_CONTEXT        SystemContext
+  )
+{
+  EFI_DEBUGGER_STACKDEPTH_CONTEXT  *Context;
+  EFI_DEBUGGER_STACKDEPTH_IMAGE    *Image;
+  BOOLEAN                          Enabled;
+  UINTN                            Percent;
+  UINTN                            Index;
+
+  Context = &DebuggerPrivate->StackDepthContext;
+
+  if (CommandArg != NULL) {
+    if (StriCmp (CommandArg, L"on") == 0) {
+      //
+      // The calls into EBC code in progress are tracked from the next
+      // instruction on
+      //
+      Context->EntryCount = 0;
+      Context->Depth      = 0;
+      Context->Enabled    = TRUE;
+      EDBPrint (L"StackDepth: on\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"off") == 0) {
+      Context->Enabled    = FALSE;
+      Context->EntryCount = 0;
+      Context->Depth      = 0;
+      EDBPrint (L"StackDepth: off\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"reset") == 0) {
+      Enabled = Context->Enabled;
+      EbcDebuggerFreeStackDepth ();
+      Context->Enabled = Enabled;
+      return EFI_DEBUG_CONTINUE;
+    }
+    EDBPrint (L"StackDepth: invalid argument\n");
+    return EFI_DEBUG_CONTINUE;
+  }
+
+  //
+  // Show the deepest stack use of each image
+  //
+  EDBPrint (L"Stack depth tracking %s\n", Context->Enabled ? L"on" : L"off");
+  if (Context->Image == NULL) {
+    return EFI_DEBUG_CONTINUE;
+  }
+  EDBPrint (L"    ImageHandle        ImageBase       Entries   Peak    Avail   Use  Depth\n");
+  EDBPrint (L"  ================ ================ ========== ======== ======== ==== =====\n");
+  for (Image = Context->Image; Image != NULL; Image = Image->Next) {
+    Percent = 0;
+    if (Image->Available != 0) {
+      Percent = Image->Peak * 100 / Image->Available;
+    }
+    EDBPrint (
+      L"  %016lx %016lx %10ld %08x %08x %3d%% %5d%s\n",
+      (UINT64)(UINTN)Image->ImageHandle,
+      (UINT64)Image->ImageBase,
+      Image->Entries,
+      Image->Peak,
+      Image->Available,
+      Percent,
+      Image->MaxDepth,
+      (Percent >= EDB_STACKDEPTH_WARNING) ? L" !" : L""
+      );
+  }
+
+  //
+  // Show the calls that were in progress at each peak, innermost last
+  //
+  for (Image = Context->Image; Image != NULL; Image = Image->Next) {
+    if (Image->ChainLength == 0) {
+      continue;
+    }
+    EDBPrint (L"\nPeak of image 0x%016lx, %d calls deep:\n", (UINT64)Image->ImageBase, Image->ChainLength - 1);
+    if (Image->ChainLength > Image->ChainCount) {
+      EDBPrint (L"    ... %d calls\n", Image->ChainLength - Image->ChainCount);
+    }
+    for (Index = 0; Index < Image->ChainCount; Index++) {
+      EdbPrintStackDepthSymbol (Image->Chain[Index]);
+    }
+  }
+
+  //
+  // Done
+  //
+  return EFI_DEBUG_CONTINUE;
+}
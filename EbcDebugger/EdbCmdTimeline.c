@@ -0,0 +1,304 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include "Edb.h"
+#include "EbcInt.h"
+
+//
+// Size of an event name, as exported
+//
+#define EDB_TIMELINE_NAME_MAX       (EFI_DEBUGGER_SYMBOL_NAME_MAX + 32)
+
+//
+// The categories of the events, per type
+//
+CHAR16 *mEdbTimelineCategory[] = {
+  L"call",
+  L"entry",
+  L"thunk",
+  L"native",
+  L"exception",
+};
+
+/**
+
+  Get the name of an event of the timeline, from the loaded symbols.
+  Native calls are named after their CALLEX instruction.
+
+  @param  Event           - The event
+  @param  Name            - The buffer receiving the name
+  @param  NameSize        - The size of the buffer, in bytes
+
+**/
+VOID
+EdbGetTimelineName (
+  IN  EFI_DEBUGGER_TIMELINE_EVENT  *Event,
+  OUT CHAR16                       *Name,
+  IN  UINTN                        NameSize
+  )
+{
+  EFI_DEBUGGER_SYMBOL_OBJECT *Object;
+  EFI_DEBUGGER_SYMBOL_ENTRY  *Entry;
+  UINTN                      SymbolAddress;
+  CHAR16                     *Prefix;
+
+  if (Event->Type == EFI_DEBUGGER_TIMELINE_EXCEPTION) {
+    if (Event->Data <= EXCEPT_EBC_STEP) {
+      EDBSPrint (Name, NameSize, L"%s", mExceptionStr[Event->Data]);
+    } else {
+      EDBSPrint (Name, NameSize, L"exception 0x%x", (UINTN)Event->Data);
+    }
+    return ;
+  }
+
+  Prefix = (Event->Type == EFI_DEBUGGER_TIMELINE_NATIVE) ? L"native@" : L"";
+
+  SymbolAddress = EbdFindSymbolAddress (Event->Address, EdbMatchSymbolTypeLowerAddress, &Object, &Entry);
+  if ((SymbolAddress == 0) || (SymbolAddress == (UINTN) -1)) {
+    EDBSPrint (Name, NameSize, L"%s0x%lx", Prefix, (UINT64)Event->Address);
+  } else if (SymbolAddress == Event->Address) {
+    EDBSPrint (Name, NameSize, L"%s%a", Prefix, Entry->Name);
+  } else {
+    EDBSPrint (Name, NameSize, L"%s%a+0x%x", Prefix, Entry->Name, Event->Address - SymbolAddress);
+  }
+}
+
+/**
+
+  Write the timestamp of an event, in microseconds from the first event
+  that is exported, and the end of the event.
+
+  @param  Handle          - The file handle, open for writing
+  @param  Ticks           - The ticks since the first event
+  @param  Frequency       - The frequency of the performance counter, in Hz
+
+  @retval EFI_SUCCESS     - The timestamp was written
+  @retval Others          - The file could not be written
+
+**/
+EFI_STATUS
+EdbWriteTimelineTimestamp (
+  IN EFI_FILE_HANDLE  Handle,
+  IN UINT64           Ticks,
+  IN UINT64           Frequency
+  )
+{
+  UINT64  Microseconds;
+  UINT64  Remainder;
+
+  Microseconds = DivU64x64Remainder (MultU64x64 (Ticks, 1000000), Frequency, &Remainder);
+  Remainder    = DivU64x64Remainder (MultU64x64 (Remainder, 1000), Frequency, NULL);
+  return WriteFilePrint (Handle, L"\"ts\":%ld.%03ld}", Microseconds, Remainder);
+}
+
+/**
+
+  Export the timeline in the JSON trace event format read by the Chrome and
+  Perfetto trace viewers. Calls and native calls are duration events, and
+  exceptions are instant events, all on the same thread. Calls that ended
+  without their start in the ring are dropped, and calls that have not
+  ended yet end with the last event.
+
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  FileName        - The file to write
+
+  @retval EFI_SUCCESS     - The timeline was exported
+  @retval EFI_NOT_STARTED - No event was recorded
+  @retval EFI_UNSUPPORTED - The performance counter does not run
+  @retval Others          - The file could not be written
+
+**/
+EFI_STATUS
+EdbExportTimeline (
+  IN EFI_DEBUGGER_PRIVATE_DATA  *DebuggerPrivate,
+  IN CHAR16                     *FileName
+  )
+{
+  EFI_DEBUGGER_TIMELINE_CONTEXT  *TimelineContext;
+  EFI_DEBUGGER_TIMELINE_EVENT    *Event;
+  EFI_FILE_HANDLE                Handle;
+  EFI_STATUS                     Status;
+  UINT64                         Frequency;
+  UINT64                         First;
+  UINT64                         Index;
+  UINT64                         Start;
+  UINTN                          Depth;
+  CHAR16                         *Separator;
+  CHAR16                         Name[EDB_TIMELINE_NAME_MAX];
+
+  TimelineContext = &DebuggerPrivate->TimelineContext;
+  if ((TimelineContext->Event == NULL) || (TimelineContext->Count == 0)) {
+    return EFI_NOT_STARTED;
+  }
+  EbcReadClock (&Frequency);
+  if (Frequency == 0) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = CreateFileOnVol (DebuggerPrivate, FileName, &Handle);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  First = 0;
+  if (TimelineContext->Count > EFI_DEBUGGER_TIMELINE_EVENT_MAX) {
+    First = TimelineContext->Count - EFI_DEBUGGER_TIMELINE_EVENT_MAX;
+  }
+  Start     = TimelineContext->Event[(UINTN)First & (EFI_DEBUGGER_TIMELINE_EVENT_MAX - 1)].Timestamp;
+  Event     = NULL;
+  Depth     = 0;
+  Separator = L"";
+
+  Status = WriteFilePrint (Handle, L"{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  for (Index = First; (Index < TimelineContext->Count) && !EFI_ERROR (Status); Index++) {
+    Event = &TimelineContext->Event[(UINTN)Index & (EFI_DEBUGGER_TIMELINE_EVENT_MAX - 1)];
+    if (Event->Phase == EFI_DEBUGGER_TIMELINE_END) {
+      if (Depth == 0) {
+        continue;
+      }
+      Depth--;
+      Status = WriteFilePrint (Handle, L"%s{\"ph\":\"E\",\"pid\":1,\"tid\":1,", Separator);
+    } else {
+      if (Event->Phase == EFI_DEBUGGER_TIMELINE_BEGIN) {
+        Depth++;
+      }
+      EdbGetTimelineName (Event, Name, sizeof (Name));
+      Status = WriteFilePrint (
+                 Handle,
+                 L"%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%s\",\"pid\":1,\"tid\":1,\"args\":{\"address\":\"0x%lx\"},",
+                 Separator,
+                 Name,
+                 mEdbTimelineCategory[Event->Type],
+                 (Event->Phase == EFI_DEBUGGER_TIMELINE_BEGIN) ? L"B" : L"i",
+                 (UINT64)Event->Address
+                 );
+      if (!EFI_ERROR (Status) && (Event->Phase == EFI_DEBUGGER_TIMELINE_INSTANT)) {
+        Status = WriteFilePrint (Handle, L"\"s\":\"t\",");
+      }
+    }
+    if (!EFI_ERROR (Status)) {
+      Status = EdbWriteTimelineTimestamp (Handle, Event->Timestamp - Start, Frequency);
+    }
+    Separator = L",\n";
+  }
+
+  //
+  // End the calls that are still running with the last event
+  //
+  for (; (Depth > 0) && !EFI_ERROR (Status); Depth--) {
+    Status = WriteFilePrint (Handle, L"%s{\"ph\":\"E\",\"pid\":1,\"tid\":1,", Separator);
+    if (!EFI_ERROR (Status)) {
+      Status = EdbWriteTimelineTimestamp (Handle, Event->Timestamp - Start, Frequency);
+    }
+  }
+  if (!EFI_ERROR (Status)) {
+    Status = WriteFilePrint (Handle, L"\n]}\n");
+  }
+
+  Handle->Close (Handle);
+  return Status;
+}
+
+/**
+
+  DebuggerCommand - Timeline.
+
+  @param  CommandArg      - The argument for this command
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  ExceptionType   - Exception type.
+  @param  SystemContext   - EBC system context.
+
+  @retval EFI_DEBUG_CONTINUE - formal return value
+
+**/
+EFI_DEBUG_STATUS
+DebuggerTimeline (
+  IN     CHAR16                    *CommandArg,
+  IN     EFI_DEBUGGER_PRIVATE_DATA *DebuggerPrivate,
+  IN     EFI_EXCEPTION_TYPE        ExceptionType,
+  IN OUT EFI_SYSTEM_CONTEXT        SystemContext
+  )
+{
+  EFI_DEBUGGER_TIMELINE_CONTEXT  *TimelineContext;
+  EFI_STATUS                     Status;
+  CHAR16                         *FileName;
+  UINT64                         Kept;
+  UINT64                         Frequency;
+
+  TimelineContext = &DebuggerPrivate->TimelineContext;
+
+  if (CommandArg != NULL) {
+    if (StriCmp (CommandArg, L"on") == 0) {
+      if (TimelineContext->Event == NULL) {
+        TimelineContext->Event = AllocateZeroPool (sizeof(EFI_DEBUGGER_TIMELINE_EVENT) * EFI_DEBUGGER_TIMELINE_EVENT_MAX);
+        if (TimelineContext->Event == NULL) {
+          EDBPrint (L"Timeline: out of resources\n");
+          return EFI_DEBUG_CONTINUE;
+        }
+      }
+      //
+      // The CALLEX in progress are not tracked, as their start is unknown
+      //
+      TimelineContext->NativeDepth = 0;
+      TimelineContext->Enabled     = TRUE;
+      EDBPrint (L"Timeline: on\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"off") == 0) {
+      TimelineContext->Enabled     = FALSE;
+      TimelineContext->NativeDepth = 0;
+      EDBPrint (L"Timeline: off\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"reset") == 0) {
+      TimelineContext->NativeDepth = 0;
+      TimelineContext->Count       = 0;
+      return EFI_DEBUG_CONTINUE;
+    }
+    if (StriCmp (CommandArg, L"export") == 0) {
+      FileName = StrGetNextTokenLine (L" ");
+      if (FileName == NULL) {
+        EDBPrint (L"Timeline: file name missing\n");
+        return EFI_DEBUG_CONTINUE;
+      }
+      Status = EdbExportTimeline (DebuggerPrivate, FileName);
+      if (EFI_ERROR (Status)) {
+        EDBPrint (L"Timeline: cannot export the timeline - %r\n", Status);
+      } else {
+        EDBPrint (L"Timeline: exported to %s\n", FileName);
+      }
+      return EFI_DEBUG_CONTINUE;
+    }
+    EDBPrint (L"Timeline: invalid argument\n");
+    return EFI_DEBUG_CONTINUE;
+  }
+
+  Kept = TimelineContext->Count;
+  if (Kept > EFI_DEBUGGER_TIMELINE_EVENT_MAX) {
+    Kept = EFI_DEBUGGER_TIMELINE_EVENT_MAX;
+  }
+  EbcReadClock (&Frequency);
+  EDBPrint (
+    L"Timeline %s, %ld events recorded, %ld kept, %ld ticks per second\n",
+    TimelineContext->Enabled ? L"on" : L"off",
+    TimelineContext->Count,
+    Kept,
+    Frequency
+    );
+
+  //
+  // Done
+  //
+  return EFI_DEBUG_CONTINUE;
+}
@@ -0,0 +1,103 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include "Edb.h"
+#include "EbcInt.h"
+
+/**
+
+  DebuggerCommand - Watchdog.
+
+  @param  CommandArg      - The argument for this command
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  ExceptionType   - Exception type.
+  @param  SystemContext   - EBC system context.
+
+  @retval EFI_DEBUG_CONTINUE - formal return value
+
+**/
+EFI_DEBUG_STATUS
+DebuggerWatchdog (
+  IN     CHAR16                    *CommandArg,
+  IN     EFI_DEBUGGER_PRIVATE_DATA *DebuggerPrivate,
+  IN     EFI_EXCEPTION_TYPE        ExceptionType,
+  IN OUT EFI_SYSTEM_CONTEXT        SystemContext
+  )
+{
+  EFI_STATUS      Status;
+  EFI_HANDLE      ImageHandle;
+  CHAR16          *CommandStr;
+  UINT64          Budget;
+  EBC_IMAGE_LIST  *ImageList;
+
+  //
+  // Set a budget
+  //
+  if (CommandArg != NULL) {
+    if (StriCmp (CommandArg, L"default") == 0) {
+      ImageHandle = NULL;
+    } else {
+      ImageHandle = (EFI_HANDLE) Xtoi (CommandArg);
+    }
+    CommandStr = StrGetNextTokenLine (L" ");
+    if (CommandStr == NULL) {
+      EDBPrint (L"Watchdog: missing Budget\n");
+      return EFI_DEBUG_CONTINUE;
+    }
+
+    if (StriCmp (CommandStr, L"off") == 0) {
+      Budget = EBC_WATCHDOG_DISABLED;
+    } else {
+      Budget = LXtoi (CommandStr);
+    }
+    Status = EbcSetImageWatchdogBudget (ImageHandle, Budget);
+    if (EFI_ERROR (Status)) {
+      EDBPrint (L"Watchdog: cannot set budget - %r\n", Status);
+    }
+    return EFI_DEBUG_CONTINUE;
+  }
+
+  //
+  // Show the budget of each image
+  //
+  if (mEbcDefaultWatchdogBudget == EBC_WATCHDOG_DISABLED) {
+    EDBPrint (L"Default Budget: off\n");
+  } else {
+    EDBPrint (L"Default Budget: 0x%lx\n", mEbcDefaultWatchdogBudget);
+  }
+  EDBPrint (L"    ImageHandle         Budget       Aborted\n");
+  EDBPrint (L"  ================ ================ ========\n");
+  for (ImageList = mEbcImageList; ImageList != NULL; ImageList = ImageList->Next) {
+    Budget = EbcGetImageWatchdogBudget (ImageList->ImageHandle);
+    if (Budget == EBC_WATCHDOG_DISABLED) {
+      EDBPrint (
+        L"  %016lx              off %8d\n",
+        (UINT64)(UINTN)ImageList->ImageHandle,
+        ImageList->WatchdogCount
+        );
+    } else {
+      EDBPrint (
+        L"  %016lx %016lx %8d\n",
+        (UINT64)(UINTN)ImageList->ImageHandle,
+        Budget,
+        ImageList->WatchdogCount
+        );
+    }
+  }
+
+  //
+  // Done
+  //
+  return EFI_DEBUG_CONTINUE;
+}
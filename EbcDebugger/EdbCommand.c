@@ -230,6 +230,192 @@ EFI_DEBUGGER_COMMAND_SET  mDebuggerCommandSet[] = {
     {SCAN_NULL, CHAR_NULL},
     DebuggerInstructionBranch
   },
+  {
+    L"STACKUSAGE",
+    L"STACKUSAGE         - show/set EBC stack usage per image\n",
+    L"The stack usage command will show the stack size and the peak stack usage of each EBC image, as measured when the image returns its stack. It can also override the stack size to use for a loaded EBC image, which applies to the next call into that image, in place of the one set by the policy table of the interpreter.\n\n",
+    L"STACKUSAGE [<ImageHandle>|default] [<Size>]\n"
+    L"  (No Argument) - Show the stack usage of each image\n"
+    L"  <ImageHandle> - The hexical handle of the image to set the stack size for\n"
+    L"  default       - Set the default stack size, for images that have none set\n"
+    L"  <Size>        - The hexical stack size, 0 to use the policy or the default\n",
+    L"",
+    {SCAN_NULL, CHAR_NULL},
+    DebuggerStackUsage
+  },
+  {
+    L"STACKDEPTH",
+    L"STACKDEPTH         - track the EBC stack depth per image\n",
+    L"The stack depth command tracks how far below the bottom of its stack the stack pointer of each call into EBC code goes, as it runs. It shows, for each image, the deepest stack use of the calls into it against the stack that they had, and the deepest nesting of EBC calls. Peaks that use 90% of the stack or more are marked with '!'. The EBC calls that were in progress at each peak, from the entry point, are shown with their symbols.\n\n",
+    L"STACKDEPTH [on|off|reset]\n"
+    L"  (No Argument) - Show the deepest stack use of each image\n"
+    L"  on            - Start tracking the stack depth\n"
+    L"  off           - Stop tracking the stack depth\n"
+    L"  reset         - Clear the stack depth of all the images\n",
+    L"",
+    {SCAN_NULL, CHAR_NULL},
+    DebuggerStackDepth
+  },
+  {
+    L"WATCHDOG",
+    L"WATCHDOG           - show/set the EBC watchdog budget per image\n",
+    L"The watchdog command will show the watchdog budget of each EBC image, and how many calls into it were aborted for running out of it. The budget is counted in safepoints, which are the backward jumps and the calls, and applies to each call into the image. It can also override the budget to use for a loaded EBC image, which applies to the next call into that image, in place of the one set by the policy table of the interpreter.\n\n",
+    L"WATCHDOG [<ImageHandle>|default] [<Budget>|off]\n"
+    L"  (No Argument) - Show the watchdog budget of each image\n"
+    L"  <ImageHandle> - The hexical handle of the image to set the budget for\n"
+    L"  default       - Set the default budget, for images that have none set\n"
+    L"  <Budget>      - The hexical number of safepoints, 0 to use the policy or the default\n"
+    L"  off           - Disable the watchdog\n",
+    L"",
+    {SCAN_NULL, CHAR_NULL},
+    DebuggerWatchdog
+  },
+  {
+    L"CALLEXSTAT",
+    L"CALLEXSTAT         - show/reset the CALLEX counts per service and per target\n",
+    L"The callex statistics command will show how many CALLEX instructions were served by a direct path, for each of the well-known boot and runtime services that have one. Such calls do not go through the native call thunk. The address is the one recorded when the last EBC image was started.\n\n"
+    L"While profiling is on, it will also show the targets that took the most native time, then the ones that were called the most. For each target, it shows the calls, the calls that were redirected to EBC code by a thunk, the calls that took the direct path, and the total and longest time of the native calls, in performance counter ticks. The target is named after the boot or runtime service, the protocol member (GUID+offset) or the image (base+offset) it belongs to. Profiling starts with the next call into EBC.\n\n",
+    L"CALLEXSTAT [on|off|reset|<Count>]\n"
+    L"  (No Argument) - Show the direct call count of each service, and the 16 first targets\n"
+    L"  on            - Start profiling the CALLEX targets\n"
+    L"  off           - Stop profiling the CALLEX targets\n"
+    L"  reset         - Reset the counts, and the other performance counters\n"
+    L"  <Count>       - The hexical number of targets to show\n",
+    L"",
+    {SCAN_NULL, CHAR_NULL},
+    DebuggerCallExStat
+  },
+  {
+    L"EXECCOUNT",
+    L"EXECCOUNT          - show/reset the EBC execution counts per image\n",
+    L"The execution count command will show the function entries and loop heads that were executed the most, for each EBC image. Function entries are counted at each EBC call, and loop heads at each backward jump. The number of lost entries is the number of executions that could not be counted because the table of the image was full.\n\n",
+    L"EXECCOUNT [<Count>|reset]\n"
+    L"  (No Argument) - Show the 16 most executed addresses of each image\n"
+    L"  <Count>       - The hexical number of addresses to show per image\n"
+    L"  reset         - Reset the counts\n",
+    L"",
+    {SCAN_NULL, CHAR_NULL},
+    DebuggerExecCount
+  },
+  {
+    L"PROFILE",
+    L"PROFILE            - start/stop/show the EBC sampling profiler\n",
+    L"The profile command samples the IP of the running EBC code every millisecond, and shows the functions and the instructions where the most samples were taken. Functions are found from the loaded symbols, or shown per image when there are none. The time spent in a native call made through CALLEX is counted on the CALLEX instruction. No samples are taken while the debugger has control.\n\n",
+    L"PROFILE [on|off|reset|<Count>]\n"
+    L"  (No Argument) - Show the 16 most sampled functions and instructions\n"
+    L"  on            - Start sampling\n"
+    L"  off           - Stop sampling, keeping the samples\n"
+    L"  reset         - Clear the samples\n"
+    L"  <Count>       - The hexical number of functions and instructions to show\n",
+    L"",
+    {SCAN_NULL, CHAR_NULL},
+    DebuggerProfile
+  },
+  {
+    L"CALLGRAPH",
+    L"CALLGRAPH          - start/stop/show/export the EBC call graph profiler\n",
+    L"The call graph command times every EBC call and return with the performance counter, and keeps a shadow call stack. It shows the functions with the most exclusive time and the calls between functions with the most inclusive time, in ticks. Native calls made through CALLEX are timed separately, and named after their CALLEX instruction. The call graph can be exported in the collapsed stack format used to draw flame graphs. The time spent in the debugger is not counted.\n\n",
+    L"CALLGRAPH [on|off|reset|export <File>|<Count>]\n"
+    L"  (No Argument) - Show the 16 most expensive functions and calls\n"
+    L"  on            - Start profiling\n"
+    L"  off           - Stop profiling, keeping the call graph\n"
+    L"  reset         - Clear the call graph\n"
+    L"  export <File> - Write the call graph in collapsed stack format to <File>\n"
+    L"  <Count>       - The hexical number of functions and calls to show\n",
+    L"",
+    {SCAN_NULL, CHAR_NULL},
+    DebuggerCallGraph
+  },
+  {
+    L"COVERAGE",
+    L"COVERAGE           - start/stop/show/save the EBC code coverage\n",
+    L"The coverage command records which instructions of each EBC image get executed, as one bit per 2 bytes of the image, which is set where an instruction starts. The bitmaps are allocated the first time an image is executed, and kept when the image is unloaded. They can be saved to a file, for the host tools to merge them across runs and to annotate them against the MAP and COD files of the images. The recording can also be started with EdbCfg, to cover a whole boot flow.\n\n",
+    L"COVERAGE [on|off|reset|save <File>]\n"
+    L"  (No Argument) - Show the number of units executed in each image\n"
+    L"  on            - Start recording\n"
+    L"  off           - Stop recording, keeping the coverage\n"
+    L"  reset         - Clear the coverage\n"
+    L"  save <File>   - Write the coverage bitmaps to <File>\n",
+    L"",
+    {SCAN_NULL, CHAR_NULL},
+    DebuggerCoverage
+  },
+  {
+    L"INSTMIX",
+    L"INSTMIX            - start/stop/show the EBC instruction mix\n",
+    L"The instruction mix command counts the EBC instructions that are executed, per opcode and operand form, and per pair of consecutive opcodes, for each image. The most frequent pairs are the candidates for superinstructions. The loops and blocks that would otherwise run natively are interpreted one instruction at a time while the mix is counted, so that every instruction is seen. Resetting the mix also resets the EBC performance counters.\n\n",
+    L"INSTMIX [on|off|reset|all|<Count>]\n"
+    L"  (No Argument) - Show the 16 most executed forms and pairs of each image\n"
+    L"  on            - Start counting\n"
+    L"  off           - Stop counting, keeping the counts\n"
+    L"  reset         - Clear the counts\n"
+    L"  all           - Show the 16 most executed forms and pairs of all the images\n"
+    L"  <Count>       - The hexical number of forms and pairs to show\n",
+    L"",
+    {SCAN_NULL, CHAR_NULL},
+    DebuggerInstMix
+  },
+  {
+    L"HEATMAP",
+    L"HEATMAP            - start/stop/show the EBC memory heat map\n",
+    L"The heat map command counts the reads and writes of the EBC code per 4 KB page and per access size, and the unaligned accesses that take the slow path of being split into smaller ones, which are counted once. It shows the pages that were accessed the most, and whether they are part of an EBC image, an EBC stack, MMIO or memory. Addresses that are not in the memory map, usually MMIO, are shown as unmapped. Accesses to new pages that find the table of 4096 pages full are counted as lost.\n\n",
+    L"HEATMAP [on|off|reset|<Count>]\n"
+    L"  (No Argument) - Show the 16 most accessed pages\n"
+    L"  on            - Start counting\n"
+    L"  off           - Stop counting, keeping the counts\n"
+    L"  reset         - Clear the counts\n"
+    L"  <Count>       - The hexical number of pages to show\n",
+    L"",
+    {SCAN_NULL, CHAR_NULL},
+    DebuggerHeatMap
+  },
+  {
+    L"TIMELINE",
+    L"TIMELINE           - start/stop/show/export the EBC execution timeline\n",
+    L"The timeline command records the EBC calls, the entries into EBC through an image entry point or a thunk, the native calls made through CALLEX and the exceptions as events with a performance counter timestamp. The events go into a ring of 32768 events that is allocated when the recording starts, where the newest events overwrite the oldest ones. The timeline can be exported as a JSON trace event file, for the Chrome and Perfetto trace viewers. The time spent in the debugger is not counted.\n\n",
+    L"TIMELINE [on|off|reset|export <File>]\n"
+    L"  (No Argument) - Show the number of events recorded\n"
+    L"  on            - Start recording\n"
+    L"  off           - Stop recording, keeping the events\n"
+    L"  reset         - Clear the events\n"
+    L"  export <File> - Write the events in JSON trace event format to <File>\n",
+    L"",
+    {SCAN_NULL, CHAR_NULL},
+    DebuggerTimeline
+  },
+  {
+    L"LOG",
+    L"LOG                - redirect the debugger output to a file\n",
+    L"The log command sends the output of the debugger to a file on the debugger's volume, instead of the console. The command line itself is still echoed to the console. The output goes through a buffer of 64K characters, which is written in one go when it is full, before the debugger waits for a key, and when the EBC code resumes, so that large profiles, traces or disassembly are not slowed down by the console. Page breaks are ignored while the output goes to a file.\n\n",
+    L"LOG [<File>|off]\n"
+    L"  (No Argument) - Show where the output goes\n"
+    L"  <File>        - Send the output to <File>, as ASCII\n"
+    L"  off           - Send the output back to the console\n",
+    L"",
+    {SCAN_NULL, CHAR_NULL},
+    DebuggerLog
+  },
+  {
+    L"CLOCK",
+    L"CLOCK              - show/select the clock of the performance measurements\n",
+    L"The clock command selects the clock that the profiles, call graph, timeline and performance counters are measured with. The real clock is the performance counter of the CPU. The virtual clock is advanced by the interpreter, by a fixed cost per instruction and per CALLEX, so that the same workload always measures the same, whatever the host and its load. The virtual clock counts nanoseconds of a nominal 1GHz CPU and starts at 0. The profile is sampled every millisecond of the virtual clock, by the interpreter, and the periodic callback runs from it too. The measurements should be reset after the clock is switched.\n\n",
+    L"CLOCK [real|virtual]\n"
+    L"  (No Argument) - Show the clock in use and its current value\n"
+    L"  real          - Use the performance counter of the CPU\n"
+    L"  virtual       - Use the virtual clock, which resets it\n",
+    L"",
+    {SCAN_NULL, CHAR_NULL},
+    DebuggerClock
+  },
+  {
+    L"EMITCHECK",
+    L"EMITCHECK          - check the EBC emitter against the disassembler\n",
+    L"The emitter check command emits every instruction form of the EBC emitter into a scratch buffer, then checks that the disassembler decodes each of them to the expected instruction and length. It also builds a PE32+ EBC image from the emitted code, and checks that its headers and code are the ones that were asked for.\n\n",
+    L"EMITCHECK\n",
+    L"",
+    {SCAN_NULL, CHAR_NULL},
+    DebuggerEmitCheck
+  },
   {
     L"R",
     L"R/[F2]             - display/modify register\n",
@@ -94,6 +94,20 @@ EDB_COMMAND_DEFINE (DebuggerQuit);
 EDB_COMMAND_DEFINE (DebuggerRegister);
 EDB_COMMAND_DEFINE (DebuggerScope);
 EDB_COMMAND_DEFINE (DebuggerList);
+EDB_COMMAND_DEFINE (DebuggerStackUsage);
+EDB_COMMAND_DEFINE (DebuggerStackDepth);
+EDB_COMMAND_DEFINE (DebuggerWatchdog);
+EDB_COMMAND_DEFINE (DebuggerCallExStat);
+EDB_COMMAND_DEFINE (DebuggerExecCount);
+EDB_COMMAND_DEFINE (DebuggerEmitCheck);
+EDB_COMMAND_DEFINE (DebuggerProfile);
+EDB_COMMAND_DEFINE (DebuggerCallGraph);
+EDB_COMMAND_DEFINE (DebuggerCoverage);
+EDB_COMMAND_DEFINE (DebuggerInstMix);
+EDB_COMMAND_DEFINE (DebuggerHeatMap);
+EDB_COMMAND_DEFINE (DebuggerTimeline);
+EDB_COMMAND_DEFINE (DebuggerLog);
+EDB_COMMAND_DEFINE (DebuggerClock);
 EDB_COMMAND_DEFINE (DebuggerStepInto);
 EDB_COMMAND_DEFINE (DebuggerStepOver);
 EDB_COMMAND_DEFINE (DebuggerStepOut);
@@ -118,4 +132,16 @@ EDB_COMMAND_DEFINE (DebuggerExtPciCFGD);
 
 extern EFI_DEBUGGER_COMMAND_SET  mDebuggerCommandSet[];
 
+/**
+
+  Sample the IP of the running VM.
+
+  @param  VmPtr           - The running VM, or NULL if there is none
+
+**/
+VOID
+EdbProfileSample (
+  IN VM_CONTEXT               *VmPtr
+  );
+
 #endif
@@ -24,6 +24,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/UefiLib.h>
 #include <Library/PrintLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/TimerLib.h>
 #include <Protocol/Ebc.h>
 #include <Protocol/EbcVmTest.h>
 #include <Protocol/DebugSupport.h>
@@ -189,6 +190,290 @@ typedef struct {
   EFI_PHYSICAL_ADDRESS      BreakAddress;
 } EFI_DEBUGGER_GOTIL_CONTEXT;
 
+//
+// Definition for Debugger Profile
+//
+#define EFI_DEBUGGER_PROFILE_MAX       0x1000
+#define EFI_DEBUGGER_PROFILE_PROBES    8
+
+typedef struct {
+  UINTN                     Address;
+  UINTN                     Count;
+} EFI_DEBUGGER_PROFILE_ENTRY;
+
+typedef struct {
+  EFI_EVENT                   Event;
+  //
+  // No sample is taken while the debugger has control
+  //
+  BOOLEAN                     Suspended;
+  UINTN                       SampleCount;
+  //
+  // While the virtual clock runs, the samples are taken by the interpreter
+  // when the clock reaches this time, rather than by the timer
+  //
+  UINT64                      NextSample;
+  //
+  // Samples taken while no EBC code was running, and samples that could
+  // not be recorded because the table was full
+  //
+  UINTN                       IdleCount;
+  UINTN                       LostCount;
+  EFI_DEBUGGER_PROFILE_ENTRY  *Entry;
+} EFI_DEBUGGER_PROFILE_CONTEXT;
+
+//
+// Definition for Debugger CallGraph
+//
+#define EFI_DEBUGGER_CALLGRAPH_NODE_MAX     0x1000
+#define EFI_DEBUGGER_CALLGRAPH_DEPTH_MAX    0x100
+#define EFI_DEBUGGER_CALLGRAPH_PROBES       8
+
+#define EFI_DEBUGGER_CALLGRAPH_USED         0x1
+#define EFI_DEBUGGER_CALLGRAPH_NATIVE       0x2
+#define EFI_DEBUGGER_CALLGRAPH_ENTRY        0x4
+
+//
+// A node of the calling context tree: a function called along a given
+// path. Native calls are keyed by the address of their CALLEX instruction.
+// Entry nodes are where EBC code is entered from native code.
+//
+typedef struct {
+  UINTN                         Parent;
+  UINTN                         Address;
+  UINT32                        Flags;
+  UINT64                        Calls;
+  UINT64                        Inclusive;
+  UINT64                        Exclusive;
+} EFI_DEBUGGER_CALLGRAPH_NODE;
+
+typedef struct {
+  UINTN                         Node;
+  UINT32                        Flags;
+  VOID                          *FramePtr;
+  UINT64                        Start;
+  UINT64                        Children;
+} EFI_DEBUGGER_CALLGRAPH_FRAME;
+
+typedef struct {
+  BOOLEAN                       Enabled;
+  //
+  // Time spent in the debugger, which is not accounted for
+  //
+  UINT64                        PauseStart;
+  UINT64                        PauseTicks;
+  //
+  // The shadow call stack. Calls deeper than the stack are not recorded.
+  //
+  UINTN                         Depth;
+  EFI_DEBUGGER_CALLGRAPH_FRAME  Frame[EFI_DEBUGGER_CALLGRAPH_DEPTH_MAX];
+  //
+  // The nodes, the first one being the root. Calls that find the table
+  // full are counted as lost.
+  //
+  UINTN                         LostCount;
+  EFI_DEBUGGER_CALLGRAPH_NODE   *Node;
+} EFI_DEBUGGER_CALLGRAPH_CONTEXT;
+
+//
+// Definition for Debugger Coverage
+//
+// The coverage of an image has one bit per 2-byte unit of the image, which
+// is set when an instruction starts there. The bitmaps are saved to a file
+// as a header, followed by an image header and the bitmap of each image,
+// which the host tools can match with the MAP and COD files of the images.
+//
+#define EFI_DEBUGGER_COVERAGE_SIGNATURE     SIGNATURE_32 ('E', 'C', 'O', 'V')
+#define EFI_DEBUGGER_COVERAGE_VERSION       1
+#define EFI_DEBUGGER_COVERAGE_UNIT          2
+#define EFI_DEBUGGER_COVERAGE_NAME_MAX      64
+
+#define EFI_DEBUGGER_COVERAGE_BITMAP_SIZE(ImageSize) \
+  (((ImageSize) / EFI_DEBUGGER_COVERAGE_UNIT + 7) / 8)
+
+typedef struct _EFI_DEBUGGER_COVERAGE_IMAGE EFI_DEBUGGER_COVERAGE_IMAGE;
+struct _EFI_DEBUGGER_COVERAGE_IMAGE {
+  EFI_DEBUGGER_COVERAGE_IMAGE   *Next;
+  //
+  // The handle is NULL once the image is unloaded, and its coverage is kept
+  //
+  EFI_HANDLE                    ImageHandle;
+  UINTN                         ImageBase;
+  UINTN                         ImageSize;
+  UINT8                         *Bitmap;
+};
+
+typedef struct {
+  BOOLEAN                       Enabled;
+  //
+  // The image that was last hit, which most instructions are part of
+  //
+  EFI_DEBUGGER_COVERAGE_IMAGE   *Last;
+  EFI_DEBUGGER_COVERAGE_IMAGE   *Image;
+} EFI_DEBUGGER_COVERAGE_CONTEXT;
+
+typedef struct {
+  UINT32                        Signature;
+  UINT32                        Version;
+  UINT32                        ImageCount;
+  UINT32                        UnitSize;         ///< bytes of code per bit
+} EFI_DEBUGGER_COVERAGE_FILE_HEADER;
+
+typedef struct {
+  UINT64                        ImageBase;
+  UINT32                        ImageSize;
+  UINT32                        BitmapSize;       ///< bytes of bitmap that follow
+  CHAR8                         Name[EFI_DEBUGGER_COVERAGE_NAME_MAX];
+} EFI_DEBUGGER_COVERAGE_FILE_IMAGE;
+
+//
+// Definition for Debugger Memory Heat Map
+//
+// The reads and writes of the EBC code are counted per 4 KB page and per
+// access size, in a table that is allocated when the counting starts.
+// Accesses to new pages that find the table full are counted as lost.
+//
+#define EFI_DEBUGGER_HEATMAP_PAGE_SHIFT     12
+#define EFI_DEBUGGER_HEATMAP_PAGE_MAX       0x1000
+#define EFI_DEBUGGER_HEATMAP_PROBES         8
+#define EFI_DEBUGGER_HEATMAP_SIZES          4           ///< 1, 2, 4 and 8 bytes
+
+typedef struct {
+  UINTN                         Address;          ///< start of the page
+  UINT64                        Count;            ///< all accesses, 0 if the entry is free
+  UINT64                        Read[EFI_DEBUGGER_HEATMAP_SIZES];
+  UINT64                        Write[EFI_DEBUGGER_HEATMAP_SIZES];
+  UINT64                        Unaligned;        ///< accesses that were split
+} EFI_DEBUGGER_HEATMAP_PAGE;
+
+typedef struct {
+  BOOLEAN                       Enabled;
+  UINT64                        LostCount;
+  EFI_DEBUGGER_HEATMAP_PAGE     *Page;
+} EFI_DEBUGGER_HEATMAP_CONTEXT;
+
+//
+// Definition for Debugger Timeline
+//
+// The timeline records the EBC calls, the entries into EBC from native code,
+// the native calls made through CALLEX and the exceptions as events with a
+// timestamp, in a ring buffer that is allocated when the recording starts.
+// Once the ring is full, the newest events overwrite the oldest ones.
+//
+#define EFI_DEBUGGER_TIMELINE_EVENT_MAX     0x8000      ///< must be a power of 2
+#define EFI_DEBUGGER_TIMELINE_NATIVE_MAX    0x40
+
+#define EFI_DEBUGGER_TIMELINE_CALL          0
+#define EFI_DEBUGGER_TIMELINE_ENTRY         1           ///< ExecuteEbcImageEntryPoint
+#define EFI_DEBUGGER_TIMELINE_THUNK         2           ///< EbcInterpret
+#define EFI_DEBUGGER_TIMELINE_NATIVE        3           ///< CALLEX to native code
+#define EFI_DEBUGGER_TIMELINE_EXCEPTION     4
+
+#define EFI_DEBUGGER_TIMELINE_BEGIN         0
+#define EFI_DEBUGGER_TIMELINE_END           1
+#define EFI_DEBUGGER_TIMELINE_INSTANT       2
+
+typedef struct {
+  UINT64                        Timestamp;        ///< performance counter, less the time in the debugger
+  UINTN                         Address;          ///< callee, CALLEX or RET instruction, or exception IP
+  UINT8                         Type;
+  UINT8                         Phase;
+  UINT16                        Reserved;
+  UINT32                        Data;             ///< exception type
+} EFI_DEBUGGER_TIMELINE_EVENT;
+
+typedef struct {
+  BOOLEAN                       Enabled;
+  //
+  // The frame pointers of the CALLEX in progress, which tell the native
+  // calls from the ones that a thunk redirected to EBC code
+  //
+  UINTN                         NativeDepth;
+  VOID                          *NativeFramePtr[EFI_DEBUGGER_TIMELINE_NATIVE_MAX];
+  //
+  // The number of events recorded, of which the last ones are in the ring
+  //
+  UINT64                        Count;
+  EFI_DEBUGGER_TIMELINE_EVENT   *Event;
+} EFI_DEBUGGER_TIMELINE_CONTEXT;
+
+//
+// Definition for Debugger Log
+//
+// The output of EDBPrint is gathered in a buffer, which is written at once
+// to the console, or to the file that the output is redirected to, when it
+// is full, before the debugger waits for a key, and when it gives control
+// back to the EBC code.
+//
+#define EFI_DEBUGGER_LOG_BUFFER_SIZE        0x10000     ///< in characters
+
+typedef struct {
+  EFI_FILE_HANDLE               Handle;           ///< NULL for the console
+  CHAR16                        *Buffer;          ///< NULL if it could not be allocated
+  UINTN                         Length;           ///< characters in the buffer
+  UINT64                        Written;          ///< bytes written to the file
+  EFI_STATUS                    Status;           ///< of the last write to the file
+} EFI_DEBUGGER_LOG_CONTEXT;
+
+//
+// Definition for Debugger Stack Depth
+//
+// The stack depth tracker follows how far below HighStackBottom the stack
+// pointer of each call into EBC code goes, along with the EBC calls that it
+// makes. Each image keeps the deepest stack use of the calls into it, the
+// calls that were in progress then, and the deepest nesting of calls.
+// Entries and calls that are nested deeper than the tables are not tracked.
+//
+#define EFI_DEBUGGER_STACKDEPTH_ENTRY_MAX   0x20
+#define EFI_DEBUGGER_STACKDEPTH_CALL_MAX    0x100
+#define EFI_DEBUGGER_STACKDEPTH_CHAIN_MAX   0x10
+
+typedef struct _EFI_DEBUGGER_STACKDEPTH_IMAGE EFI_DEBUGGER_STACKDEPTH_IMAGE;
+struct _EFI_DEBUGGER_STACKDEPTH_IMAGE {
+  EFI_DEBUGGER_STACKDEPTH_IMAGE *Next;
+  //
+  // The handle is NULL once the image is unloaded, and its record is kept
+  //
+  EFI_HANDLE                    ImageHandle;
+  UINTN                         ImageBase;
+  UINT64                        Entries;          ///< calls into the image
+  UINTN                         MaxDepth;         ///< nested EBC calls
+  UINTN                         Peak;             ///< bytes below HighStackBottom
+  UINTN                         Available;        ///< bytes of the stack that reached the peak
+  //
+  // The calls in progress at the peak, starting with the entry, of which
+  // only the innermost ones are kept
+  //
+  UINTN                         ChainLength;
+  UINTN                         ChainCount;       ///< calls kept in Chain
+  UINTN                         Chain[EFI_DEBUGGER_STACKDEPTH_CHAIN_MAX];
+};
+
+typedef struct {
+  UINTN                         HighStackBottom;  ///< tells the VM apart
+  UINTN                         Lowest;           ///< stack pointer
+  UINTN                         Base;             ///< index of the entry in Call
+  VOID                          *CallExFramePtr;  ///< of the CALLEX in progress
+  EFI_DEBUGGER_STACKDEPTH_IMAGE *Image;
+} EFI_DEBUGGER_STACKDEPTH_ENTRY;
+
+typedef struct {
+  BOOLEAN                       Enabled;
+  //
+  // The calls into EBC code in progress, the newest one being the one
+  // that runs
+  //
+  UINTN                         EntryCount;
+  EFI_DEBUGGER_STACKDEPTH_ENTRY Entry[EFI_DEBUGGER_STACKDEPTH_ENTRY_MAX];
+  //
+  // The shadow call stack of all the entries, with the address of each
+  // entry point and callee
+  //
+  UINTN                         Depth;
+  UINTN                         Call[EFI_DEBUGGER_STACKDEPTH_CALL_MAX];
+  EFI_DEBUGGER_STACKDEPTH_IMAGE *Image;
+} EFI_DEBUGGER_STACKDEPTH_CONTEXT;
+
 //
 // Definition for Debugger private data structure
 //
@@ -197,6 +482,8 @@ typedef struct {
 #define EFI_DEBUG_DEFAULT_INSTRUCTION_NUMBER  5
 
 #define EFI_DEBUG_BREAK_TIMER_INTERVAL        10000000   // 1 second
+#define EFI_DEBUG_PROFILE_TIMER_INTERVAL      10000      // 1 millisecond
+#define EFI_DEBUG_PROFILE_VIRTUAL_INTERVAL    1000000    // 1 millisecond of the virtual clock
 
 #define EFI_DEBUG_FLAG_EBC            0x80000000
 #define EFI_DEBUG_FLAG_EBC_B_BOC      0x1
@@ -248,6 +535,13 @@ typedef struct _EFI_DEBUGGER_PRIVATE_DATA {
   UINT32                                      StatusFlags;
   BOOLEAN                                     EnablePageBreak;
   EFI_EVENT                                   BreakEvent;
+  EFI_DEBUGGER_PROFILE_CONTEXT                ProfileContext;
+  EFI_DEBUGGER_CALLGRAPH_CONTEXT              CallGraphContext;
+  EFI_DEBUGGER_COVERAGE_CONTEXT               CoverageContext;
+  EFI_DEBUGGER_HEATMAP_CONTEXT                HeatMapContext;
+  EFI_DEBUGGER_TIMELINE_CONTEXT               TimelineContext;
+  EFI_DEBUGGER_LOG_CONTEXT                    LogContext;
+  EFI_DEBUGGER_STACKDEPTH_CONTEXT             StackDepthContext;
 } EFI_DEBUGGER_PRIVATE_DATA;
 
 #endif
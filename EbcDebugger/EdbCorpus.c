@@ -0,0 +1,1009 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include <Uefi.h>
+#ifndef _GNU_EFI
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Protocol/Ebc.h>
+#endif
+
+#include "EbcPerformance.h"
+#include "EdbEmit.h"
+#include "EdbCorpus.h"
+
+#define EDB_CORPUS_CODE_SIZE    1024
+#define EDB_CORPUS_DATA_SIZE    8192
+
+//
+// Frame buffers of the blit program: 64 x 32 pixels of 32 bits
+//
+#define EDB_CORPUS_BLIT_STRIDE  256
+
+//
+// Number of devices on the simulated PCI bus
+//
+#define EDB_CORPUS_PCI_DEVICES  32
+
+#define D   EDB_EMIT_DIRECT
+#define I   EDB_EMIT_INDIRECT
+#define X   EDB_EMIT_INDEX
+
+typedef struct {
+  EFI_EBC_PROTOCOL  *Ebc;
+  EFI_HANDLE        ImageHandle;
+  UINT8             *Code;
+  UINT8             *Input;       ///< data that the programs read
+  UINT8             *Output;      ///< data that the programs write, zeroed before each run
+} EDB_CORPUS_CONTEXT;
+
+typedef
+UINT64
+(EFIAPI *EDB_CORPUS_CALLBACK) (
+  IN UINTN Value
+  );
+
+/**
+
+  Generate a program of the corpus.
+
+  @param  Emitter   - The emitter, which is empty
+  @param  Context   - The buffers of the program
+  @param  Entry     - Offset of the entry point of the program
+
+  @retval EFI_SUCCESS - The program was generated
+  @retval Others      - The program could not be generated
+
+**/
+typedef
+EFI_STATUS
+(*EDB_CORPUS_EMIT) (
+  IN OUT EDB_EMITTER        *Emitter,
+  IN     EDB_CORPUS_CONTEXT *Context,
+  OUT    UINTN              *Entry
+  );
+
+typedef struct {
+  CHAR16          *Name;
+  EDB_CORPUS_EMIT Emit;
+  UINT32          OutputCrc;      ///< CRC32 of the output buffer after a run
+  UINT64          Instructions;   ///< EBC instructions retired by a run
+} EDB_CORPUS_PROGRAM;
+
+//
+// Number of times each device has had its status read
+//
+UINTN mEdbCorpusPciPolls[EDB_CORPUS_PCI_DEVICES];
+
+/**
+
+  Read a register of the simulated PCI bus, as the programs do through
+  CALLEX. The devices are at (Device << 8), and one in three is absent.
+  Register 0 holds the IDs, and register 4 the status, which becomes ready
+  after a number of reads that depends on the device.
+
+  @param  Address   - (Device << 8) | Register
+
+  @return The value of the register, or 0xFFFFFFFF if there is no device
+
+**/
+UINT64
+EFIAPI
+EdbCorpusPciRead (
+  IN UINTN Address
+  )
+{
+  UINTN Device;
+
+  Device = (Address >> 8) % EDB_CORPUS_PCI_DEVICES;
+  if ((Device % 3) == 1) {
+    return 0xFFFFFFFF;
+  }
+  if ((Address & 0xFF) == 0) {
+    return ((0x1000 + Device) << 16) | 0x8086;
+  }
+  mEdbCorpusPciPolls[Device]++;
+  return (mEdbCorpusPciPolls[Device] > (Device % 7) * 8) ? 0x11 : 0x10;
+}
+
+/**
+
+  The native side of the ping-pong program: call back into EBC.
+
+  @param  Callback  - The thunk of the EBC function to call back
+  @param  Value     - The value to pass to it
+
+  @return What the callback returned, plus one
+
+**/
+UINT64
+EFIAPI
+EdbCorpusPong (
+  IN EDB_CORPUS_CALLBACK  Callback,
+  IN UINTN                Value
+  )
+{
+  return Callback (Value ^ 0x5A) + 1;
+}
+
+/**
+
+  Emit a MOVI of a value to a register, with the smallest immediate data
+  that holds it.
+
+  @param  Emitter   - The emitter
+  @param  Reg       - The register
+  @param  Value     - The value
+
+**/
+VOID
+EdbCorpusMovi (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Reg,
+  IN     UINT64      Value
+  )
+{
+  UINT8 DataWidth;
+
+  if ((INT64)Value == (INT16)Value) {
+    DataWidth = MOVI_DATAWIDTH16;
+  } else if ((INT64)Value == (INT32)Value) {
+    DataWidth = MOVI_DATAWIDTH32;
+  } else {
+    DataWidth = MOVI_DATAWIDTH64;
+  }
+  EdbEmitMovi (Emitter, OPCODE_MOVI, MOVI_MOVEWIDTH64, Reg, D, 0, DataWidth, Value);
+}
+
+/**
+
+  Emit a 64-bit data manipulation on two registers, Op1 = Op1 <op> (Op2 + Immed).
+
+  @param  Emitter   - The emitter
+  @param  Opcode    - OPCODE_NOT to OPCODE_EXTNDD
+  @param  Op1       - Register of operand 1
+  @param  Op2       - Register of operand 2
+  @param  Immed     - Immediate data added to operand 2, if not 0
+
+**/
+VOID
+EdbCorpusOp (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Opcode,
+  IN     UINT8       Op1,
+  IN     UINT8       Op2,
+  IN     INT16       Immed
+  )
+{
+  EdbEmitDataManip (Emitter, Opcode, TRUE, Op1, D, Op2, (UINT8)((Immed != 0) ? X : D), (UINT16)Immed);
+}
+
+/**
+
+  Emit a 64-bit CMPI of a register against 16-bit immediate data.
+
+  @param  Emitter   - The emitter
+  @param  Opcode    - OPCODE_CMPIEQ to OPCODE_CMPIUGTE
+  @param  Op1       - The register
+  @param  Data      - The immediate data
+
+**/
+VOID
+EdbCorpusCmpi (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Opcode,
+  IN     UINT8       Op1,
+  IN     INT16       Data
+  )
+{
+  EdbEmitCmpi (Emitter, Opcode, TRUE, Op1, D, 0, FALSE, (UINT32)(INT32)Data);
+}
+
+/**
+
+  Emit a JMP32 to an instruction that has already been emitted.
+
+  @param  Emitter   - The emitter
+  @param  Condition - EDB_EMIT_ALWAYS, EDB_EMIT_CC or EDB_EMIT_CS
+  @param  Target    - Offset of the target in the buffer
+
+**/
+VOID
+EdbCorpusJmp (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Condition,
+  IN     UINTN       Target
+  )
+{
+  EdbEmitJmp (
+    Emitter,
+    OPCODE_JMP,
+    (UINT8)(Condition | JMP_M_RELATIVE),
+    0,
+    D,
+    4,
+    (UINT64)(INT64)((INTN)Target - (INTN)(Emitter->Offset + 6))
+    );
+}
+
+/**
+
+  Emit a relative CALL32 to a function that has already been emitted.
+
+  @param  Emitter   - The emitter
+  @param  Target    - Offset of the function in the buffer
+
+**/
+VOID
+EdbCorpusCall (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINTN       Target
+  )
+{
+  EdbEmitJmp (
+    Emitter,
+    OPCODE_CALL,
+    OPERAND_M_RELATIVE_ADDR,
+    0,
+    D,
+    4,
+    (UINT64)(INT64)((INTN)Target - (INTN)(Emitter->Offset + 6))
+    );
+}
+
+/**
+
+  Emit a forward JMP8, whose target is set by EdbCorpusLabel().
+
+  @param  Emitter   - The emitter
+  @param  Condition - EDB_EMIT_ALWAYS, EDB_EMIT_CC or EDB_EMIT_CS
+
+  @return Offset of the JMP8
+
+**/
+UINTN
+EdbCorpusJmp8Forward (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Condition
+  )
+{
+  UINTN Jmp8;
+
+  Jmp8 = Emitter->Offset;
+  EdbEmitJmp8 (Emitter, Condition, Jmp8 + 2);
+  return Jmp8;
+}
+
+/**
+
+  Make a forward JMP8 land on the next instruction to be emitted.
+
+  @param  Emitter   - The emitter
+  @param  Jmp8      - Offset of the JMP8
+
+**/
+VOID
+EdbCorpusLabel (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINTN       Jmp8
+  )
+{
+  UINTN Offset;
+
+  Offset = (Emitter->Offset - (Jmp8 + 2)) / 2;
+  if ((Jmp8 + 2 > Emitter->Size) || (Offset > 127)) {
+    Emitter->Overflow = TRUE;
+    return;
+  }
+  Emitter->Buffer[Jmp8 + 1] = (UINT8)Offset;
+}
+
+/**
+
+  Frame buffer blits: copy a 48 x 24 rectangle between two frame buffers,
+  8 times, then fill a 32 x 8 rectangle with a colour.
+
+**/
+EFI_STATUS
+EdbCorpusEmitBlit (
+  IN OUT EDB_EMITTER        *Emitter,
+  IN     EDB_CORPUS_CONTEXT *Context,
+  OUT    UINTN              *Entry
+  )
+{
+  UINTN Frame;
+  UINTN Row;
+  UINTN Col;
+
+  *Entry = Emitter->Offset;
+  EdbCorpusMovi (Emitter, 6, 8);                                          // MOVI R6, 8
+  EdbCorpusMovi (Emitter, 7, 1);                                          // MOVI R7, 1
+  EdbCorpusMovi (Emitter, 5, 8);                                          // MOVI R5, 8
+  Frame = Emitter->Offset;
+  //
+  // MOVI R1, &Output[6][4] and MOVI R2, &Input[4][8]
+  //
+  EdbCorpusMovi (Emitter, 1, (UINTN)(Context->Output + 6 * EDB_CORPUS_BLIT_STRIDE + 4 * 4));
+  EdbCorpusMovi (Emitter, 2, (UINTN)(Context->Input + 4 * EDB_CORPUS_BLIT_STRIDE + 8 * 4));
+  EdbCorpusMovi (Emitter, 4, 24);                                         // MOVI R4, 24
+  Row = Emitter->Offset;
+  EdbCorpusMovi (Emitter, 3, 24);                                         // MOVI R3, 24
+  Col = Emitter->Offset;
+  EdbEmitMov (Emitter, OPCODE_MOVQQ, 1, I, 0, 2, I, 0);                   // MOVqq @R1, @R2
+  EdbCorpusOp (Emitter, OPCODE_ADD, 1, 6, 0);                             // ADD64 R1, R6
+  EdbCorpusOp (Emitter, OPCODE_ADD, 2, 6, 0);                             // ADD64 R2, R6
+  EdbCorpusOp (Emitter, OPCODE_SUB, 3, 7, 0);                             // SUB64 R3, R7
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIEQ, 3, 0);                           // CMPI64eq R3, 0
+  EdbEmitJmp8 (Emitter, EDB_EMIT_CC, Col);                                // JMP8cc Col
+  EdbCorpusOp (Emitter, OPCODE_ADD, 1, 6, EDB_CORPUS_BLIT_STRIDE - 192 - 8); // ADD64 R1, R6 56
+  EdbCorpusOp (Emitter, OPCODE_ADD, 2, 6, EDB_CORPUS_BLIT_STRIDE - 192 - 8); // ADD64 R2, R6 56
+  EdbCorpusOp (Emitter, OPCODE_SUB, 4, 7, 0);                             // SUB64 R4, R7
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIEQ, 4, 0);                           // CMPI64eq R4, 0
+  EdbEmitJmp8 (Emitter, EDB_EMIT_CC, Row);                                // JMP8cc Row
+  EdbCorpusOp (Emitter, OPCODE_SUB, 5, 7, 0);                             // SUB64 R5, R7
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIEQ, 5, 0);                           // CMPI64eq R5, 0
+  EdbEmitJmp8 (Emitter, EDB_EMIT_CC, Frame);                              // JMP8cc Frame
+
+  EdbCorpusMovi (Emitter, 2, 0xFF336699FF336699ULL);                      // MOVI R2, Colour
+  EdbCorpusMovi (Emitter, 1, (UINTN)Context->Output);                     // MOVI R1, Output
+  EdbCorpusMovi (Emitter, 4, 8);                                          // MOVI R4, 8
+  Row = Emitter->Offset;
+  EdbCorpusMovi (Emitter, 3, 16);                                         // MOVI R3, 16
+  Col = Emitter->Offset;
+  EdbEmitMov (Emitter, OPCODE_MOVQQ, 1, I, 0, 2, D, 0);                   // MOVqq @R1, R2
+  EdbCorpusOp (Emitter, OPCODE_ADD, 1, 6, 0);                             // ADD64 R1, R6
+  EdbCorpusOp (Emitter, OPCODE_SUB, 3, 7, 0);                             // SUB64 R3, R7
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIEQ, 3, 0);                           // CMPI64eq R3, 0
+  EdbEmitJmp8 (Emitter, EDB_EMIT_CC, Col);                                // JMP8cc Col
+  EdbCorpusOp (Emitter, OPCODE_ADD, 1, 6, EDB_CORPUS_BLIT_STRIDE - 128 - 8); // ADD64 R1, R6 120
+  EdbCorpusOp (Emitter, OPCODE_SUB, 4, 7, 0);                             // SUB64 R4, R7
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIEQ, 4, 0);                           // CMPI64eq R4, 0
+  EdbEmitJmp8 (Emitter, EDB_EMIT_CC, Row);                                // JMP8cc Row
+  EdbCorpusMovi (Emitter, 7, EFI_SUCCESS);                                // MOVI R7, 0
+  EdbEmitRet (Emitter);                                                   // RET
+  return EFI_SUCCESS;
+}
+
+/**
+
+  PCI polling: read the IDs of every device of the simulated bus through
+  CALLEX, and poll the status of the ones that are present until they are
+  ready. The output is the XOR of the IDs, and the number of status reads.
+
+**/
+EFI_STATUS
+EdbCorpusEmitPciPoll (
+  IN OUT EDB_EMITTER        *Emitter,
+  IN     EDB_CORPUS_CONTEXT *Context,
+  OUT    UINTN              *Entry
+  )
+{
+  UINTN Device;
+  UINTN Poll;
+  UINTN Absent;
+
+  *Entry = Emitter->Offset;
+  EdbCorpusMovi (Emitter, 5, (UINTN)EdbCorpusPciRead);                    // MOVI R5, EdbCorpusPciRead
+  EdbCorpusMovi (Emitter, 6, (UINTN)Context->Output);                     // MOVI R6, Output
+  EdbCorpusMovi (Emitter, 1, 0);                                          // MOVI R1, 0
+  EdbCorpusMovi (Emitter, 3, 0);                                          // MOVI R3, 0
+  EdbCorpusMovi (Emitter, 4, 1);                                          // MOVI R4, 1
+  Device = Emitter->Offset;
+  EdbEmitPushPop (Emitter, OPCODE_PUSHN, FALSE, 1, D, 0);                 // PUSHn R1
+  EdbEmitJmp (Emitter, OPCODE_CALL, OPERAND_M_NATIVE_CALL, 5, D, 0, 0);   // CALLEX R5
+  EdbEmitPushPop (Emitter, OPCODE_POPN, FALSE, 1, D, 0);                  // POPn R1
+  EdbEmitCmpi (Emitter, OPCODE_CMPIEQ, FALSE, 7, D, 0, FALSE, 0xFFFF);    // CMPI32eq R7, -1
+  Absent = EdbCorpusJmp8Forward (Emitter, EDB_EMIT_CS);                   // JMP8cs Next
+  EdbEmitDataManip (Emitter, OPCODE_XOR, TRUE, 6, I, 7, D, 0);            // XOR64 @R6, R7
+  EdbEmitMov (Emitter, OPCODE_MOVQQ, 2, D, 0, 1, D, 0);                   // MOVqq R2, R1
+  EdbCorpusOp (Emitter, OPCODE_ADD, 2, 4, 3);                             // ADD64 R2, R4 3
+  Poll = Emitter->Offset;
+  EdbCorpusOp (Emitter, OPCODE_ADD, 3, 4, 0);                             // ADD64 R3, R4
+  EdbEmitPushPop (Emitter, OPCODE_PUSHN, FALSE, 2, D, 0);                 // PUSHn R2
+  EdbEmitJmp (Emitter, OPCODE_CALL, OPERAND_M_NATIVE_CALL, 5, D, 0, 0);   // CALLEX R5
+  EdbEmitPushPop (Emitter, OPCODE_POPN, FALSE, 2, D, 0);                  // POPn R2
+  EdbCorpusOp (Emitter, OPCODE_AND, 7, 4, 0);                             // AND64 R7, R4
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIEQ, 7, 0);                           // CMPI64eq R7, 0
+  EdbEmitJmp8 (Emitter, EDB_EMIT_CS, Poll);                               // JMP8cs Poll
+  EdbCorpusLabel (Emitter, Absent);                                       // Next:
+  EdbCorpusOp (Emitter, OPCODE_ADD, 1, 4, 255);                           // ADD64 R1, R4 255
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIUGTE, 1, EDB_CORPUS_PCI_DEVICES << 8); // CMPI64ugte R1, 0x2000
+  EdbEmitJmp8 (Emitter, EDB_EMIT_CC, Device);                             // JMP8cc Device
+  EdbEmitMov (Emitter, OPCODE_MOVQW, 6, I | X, EdbEmitIndex (FALSE, 0, 8, 16), 3, D, 0); // MOVqw @R6(+0,+8), R3
+  EdbCorpusMovi (Emitter, 7, EFI_SUCCESS);                                // MOVI R7, 0
+  EdbEmitRet (Emitter);                                                   // RET
+  return EFI_SUCCESS;
+}
+
+/**
+
+  String formatting: print 256 32-bit values as "<decimal> 0x<hex>,", the
+  decimal digits going through the stack.
+
+**/
+EFI_STATUS
+EdbCorpusEmitFormat (
+  IN OUT EDB_EMITTER        *Emitter,
+  IN     EDB_CORPUS_CONTEXT *Context,
+  OUT    UINTN              *Entry
+  )
+{
+  UINTN Loop;
+  UINTN Dec;
+  UINTN Out;
+  UINTN Hex;
+  UINTN Digit;
+
+  *Entry = Emitter->Offset;
+  EdbCorpusMovi (Emitter, 4, 10);                                         // MOVI R4, 10
+  EdbCorpusMovi (Emitter, 5, 0);                                          // MOVI R5, 0
+  EdbCorpusMovi (Emitter, 6, (UINTN)Context->Output);                     // MOVI R6, Output
+  EdbCorpusMovi (Emitter, 7, 256);                                        // MOVI R7, 256
+  Loop = Emitter->Offset;
+  EdbCorpusMovi (Emitter, 1, 0xFFFFFFFF);                                 // MOVI R1, 0xFFFFFFFF
+  EdbCorpusOp (Emitter, OPCODE_AND, 1, 5, 0);                             // AND64 R1, R5
+  EdbCorpusMovi (Emitter, 3, 0);                                          // MOVI R3, 0
+  Dec = Emitter->Offset;
+  EdbEmitMov (Emitter, OPCODE_MOVQQ, 2, D, 0, 1, D, 0);                   // MOVqq R2, R1
+  EdbCorpusOp (Emitter, OPCODE_MODU, 2, 4, 0);                            // MODU64 R2, R4
+  EdbCorpusOp (Emitter, OPCODE_DIVU, 1, 4, 0);                            // DIVU64 R1, R4
+  EdbCorpusOp (Emitter, OPCODE_ADD, 2, 4, '0' - 10);                      // ADD64 R2, R4 38
+  EdbEmitPushPop (Emitter, OPCODE_PUSH, TRUE, 2, D, 0);                   // PUSH64 R2
+  EdbCorpusOp (Emitter, OPCODE_ADD, 3, 4, -9);                            // ADD64 R3, R4 -9
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIEQ, 1, 0);                           // CMPI64eq R1, 0
+  EdbEmitJmp8 (Emitter, EDB_EMIT_CC, Dec);                                // JMP8cc Dec
+  Out = Emitter->Offset;
+  EdbEmitPushPop (Emitter, OPCODE_POP, TRUE, 2, D, 0);                    // POP64 R2
+  EdbEmitMov (Emitter, OPCODE_MOVBW, 6, I, 0, 2, D, 0);                   // MOVbw @R6, R2
+  EdbCorpusOp (Emitter, OPCODE_ADD, 6, 4, -9);                            // ADD64 R6, R4 -9
+  EdbCorpusOp (Emitter, OPCODE_SUB, 3, 4, -9);                            // SUB64 R3, R4 -9
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIEQ, 3, 0);                           // CMPI64eq R3, 0
+  EdbEmitJmp8 (Emitter, EDB_EMIT_CC, Out);                                // JMP8cc Out
+
+  EdbEmitMovi (Emitter, OPCODE_MOVI, MOVI_MOVEWIDTH8, 6, I, 0, MOVI_DATAWIDTH16, ' '); // MOVIbw @R6, ' '
+  EdbEmitMovi (                                                           // MOVIww @R6(+0,+1), "0x"
+    Emitter,
+    OPCODE_MOVI,
+    MOVI_MOVEWIDTH16,
+    6,
+    I | X,
+    EdbEmitIndex (FALSE, 0, 1, 16),
+    MOVI_DATAWIDTH16,
+    'x' << 8 | '0'
+    );
+  EdbCorpusOp (Emitter, OPCODE_ADD, 6, 4, -7);                            // ADD64 R6, R4 -7
+  EdbCorpusMovi (Emitter, 1, 0xFFFFFFFF);                                 // MOVI R1, 0xFFFFFFFF
+  EdbCorpusOp (Emitter, OPCODE_AND, 1, 5, 0);                             // AND64 R1, R5
+  EdbCorpusMovi (Emitter, 3, 8);                                          // MOVI R3, 8
+  Hex = Emitter->Offset;
+  EdbEmitMov (Emitter, OPCODE_MOVQQ, 2, D, 0, 1, D, 0);                   // MOVqq R2, R1
+  EdbCorpusOp (Emitter, OPCODE_SHR, 2, 4, 18);                            // SHR64 R2, R4 18
+  EdbCorpusOp (Emitter, OPCODE_AND, 2, 4, 5);                             // AND64 R2, R4 5
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIUGTE, 2, 10);                        // CMPI64ugte R2, 10
+  Digit = EdbCorpusJmp8Forward (Emitter, EDB_EMIT_CC);                    // JMP8cc Digit
+  EdbCorpusOp (Emitter, OPCODE_ADD, 2, 4, 'A' - '0' - 10 - 10);           // ADD64 R2, R4 -3
+  EdbCorpusLabel (Emitter, Digit);                                        // Digit:
+  EdbCorpusOp (Emitter, OPCODE_ADD, 2, 4, '0' - 10);                      // ADD64 R2, R4 38
+  EdbEmitMov (Emitter, OPCODE_MOVBW, 6, I, 0, 2, D, 0);                   // MOVbw @R6, R2
+  EdbCorpusOp (Emitter, OPCODE_ADD, 6, 4, -9);                            // ADD64 R6, R4 -9
+  EdbCorpusOp (Emitter, OPCODE_SHL, 1, 4, -6);                            // SHL64 R1, R4 -6
+  EdbCorpusOp (Emitter, OPCODE_SUB, 3, 4, -9);                            // SUB64 R3, R4 -9
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIEQ, 3, 0);                           // CMPI64eq R3, 0
+  EdbEmitJmp8 (Emitter, EDB_EMIT_CC, Hex);                                // JMP8cc Hex
+
+  EdbEmitMovi (Emitter, OPCODE_MOVI, MOVI_MOVEWIDTH8, 6, I, 0, MOVI_DATAWIDTH16, ','); // MOVIbw @R6, ','
+  EdbCorpusOp (Emitter, OPCODE_ADD, 6, 4, -9);                            // ADD64 R6, R4 -9
+  EdbCorpusMovi (Emitter, 2, 0x9E3779B1);                                 // MOVI R2, 0x9E3779B1
+  EdbCorpusOp (Emitter, OPCODE_ADD, 5, 2, 0);                             // ADD64 R5, R2
+  EdbCorpusOp (Emitter, OPCODE_SUB, 7, 4, -9);                            // SUB64 R7, R4 -9
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIEQ, 7, 0);                           // CMPI64eq R7, 0
+  EdbCorpusJmp (Emitter, EDB_EMIT_CC, Loop);                              // JMP32cc Loop
+  EdbCorpusMovi (Emitter, 7, EFI_SUCCESS);                                // MOVI R7, 0
+  EdbEmitRet (Emitter);                                                   // RET
+  return EFI_SUCCESS;
+}
+
+/**
+
+  CRC loop: the bitwise CRC32 of the 4 KB at the start of the input.
+
+**/
+EFI_STATUS
+EdbCorpusEmitCrc (
+  IN OUT EDB_EMITTER        *Emitter,
+  IN     EDB_CORPUS_CONTEXT *Context,
+  OUT    UINTN              *Entry
+  )
+{
+  UINTN Byte;
+  UINTN Bit;
+  UINTN Skip;
+
+  *Entry = Emitter->Offset;
+  EdbCorpusMovi (Emitter, 1, (UINTN)Context->Input);                      // MOVI R1, Input
+  EdbCorpusMovi (Emitter, 2, 4096);                                       // MOVI R2, 4096
+  EdbCorpusMovi (Emitter, 3, 0xFFFFFFFF);                                 // MOVI R3, 0xFFFFFFFF
+  EdbCorpusMovi (Emitter, 4, 0xEDB88320);                                 // MOVI R4, 0xEDB88320
+  EdbCorpusMovi (Emitter, 7, 1);                                          // MOVI R7, 1
+  Byte = Emitter->Offset;
+  EdbEmitMov (Emitter, OPCODE_MOVBW, 5, D, 0, 1, I, 0);                   // MOVbw R5, @R1
+  EdbCorpusOp (Emitter, OPCODE_XOR, 3, 5, 0);                             // XOR64 R3, R5
+  EdbCorpusMovi (Emitter, 6, 8);                                          // MOVI R6, 8
+  Bit = Emitter->Offset;
+  EdbEmitMov (Emitter, OPCODE_MOVQQ, 5, D, 0, 3, D, 0);                   // MOVqq R5, R3
+  EdbCorpusOp (Emitter, OPCODE_AND, 5, 7, 0);                             // AND64 R5, R7
+  EdbCorpusOp (Emitter, OPCODE_SHR, 3, 7, 0);                             // SHR64 R3, R7
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIEQ, 5, 0);                           // CMPI64eq R5, 0
+  Skip = EdbCorpusJmp8Forward (Emitter, EDB_EMIT_CS);                     // JMP8cs Skip
+  EdbCorpusOp (Emitter, OPCODE_XOR, 3, 4, 0);                             // XOR64 R3, R4
+  EdbCorpusLabel (Emitter, Skip);                                         // Skip:
+  EdbCorpusOp (Emitter, OPCODE_SUB, 6, 7, 0);                             // SUB64 R6, R7
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIEQ, 6, 0);                           // CMPI64eq R6, 0
+  EdbEmitJmp8 (Emitter, EDB_EMIT_CC, Bit);                                // JMP8cc Bit
+  EdbCorpusOp (Emitter, OPCODE_ADD, 1, 7, 0);                             // ADD64 R1, R7
+  EdbCorpusOp (Emitter, OPCODE_SUB, 2, 7, 0);                             // SUB64 R2, R7
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIEQ, 2, 0);                           // CMPI64eq R2, 0
+  EdbEmitJmp8 (Emitter, EDB_EMIT_CC, Byte);                               // JMP8cc Byte
+  EdbCorpusMovi (Emitter, 5, 0xFFFFFFFF);                                 // MOVI R5, 0xFFFFFFFF
+  EdbCorpusOp (Emitter, OPCODE_XOR, 3, 5, 0);                             // XOR64 R3, R5
+  EdbCorpusMovi (Emitter, 1, (UINTN)Context->Output);                     // MOVI R1, Output
+  EdbEmitMov (Emitter, OPCODE_MOVDW, 1, I, 0, 3, D, 0);                   // MOVdw @R1, R3
+  EdbCorpusMovi (Emitter, 7, EFI_SUCCESS);                                // MOVI R7, 0
+  EdbEmitRet (Emitter);                                                   // RET
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Recursive calls: Fibonacci(20), with one EBC call per term.
+
+**/
+EFI_STATUS
+EdbCorpusEmitRecursion (
+  IN OUT EDB_EMITTER        *Emitter,
+  IN     EDB_CORPUS_CONTEXT *Context,
+  OUT    UINTN              *Entry
+  )
+{
+  UINTN Fib;
+  UINTN Recurse;
+
+  //
+  // UINT64 Fib (UINTN N)
+  //
+  Fib = Emitter->Offset;
+  EdbEmitMov (Emitter, OPCODE_MOVNW, 1, D, 0, 0, I | X, EdbEmitIndex (FALSE, 0, 16, 16)); // MOVnw R1, @R0(+0,+16)
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIUGTE, 1, 2);                         // CMPI64ugte R1, 2
+  Recurse = EdbCorpusJmp8Forward (Emitter, EDB_EMIT_CS);                  // JMP8cs Recurse
+  EdbEmitMov (Emitter, OPCODE_MOVQQ, 7, D, 0, 1, D, 0);                   // MOVqq R7, R1
+  EdbEmitRet (Emitter);                                                   // RET
+  EdbCorpusLabel (Emitter, Recurse);                                      // Recurse:
+  EdbEmitMov (Emitter, OPCODE_MOVQW, 1, D, 0, 1, X, EdbEmitIndex (TRUE, 0, 1, 16)); // MOVqw R1, R1(-0,-1)
+  EdbEmitPushPop (Emitter, OPCODE_PUSHN, FALSE, 1, D, 0);                 // PUSHn R1
+  EdbCorpusCall (Emitter, Fib);                                           // CALL32 Fib
+  EdbEmitPushPop (Emitter, OPCODE_POPN, FALSE, 1, D, 0);                  // POPn R1
+  EdbEmitPushPop (Emitter, OPCODE_PUSH, TRUE, 7, D, 0);                   // PUSH64 R7
+  EdbEmitMov (Emitter, OPCODE_MOVQW, 1, D, 0, 1, X, EdbEmitIndex (TRUE, 0, 1, 16)); // MOVqw R1, R1(-0,-1)
+  EdbEmitPushPop (Emitter, OPCODE_PUSHN, FALSE, 1, D, 0);                 // PUSHn R1
+  EdbCorpusCall (Emitter, Fib);                                           // CALL32 Fib
+  EdbEmitPushPop (Emitter, OPCODE_POPN, FALSE, 1, D, 0);                  // POPn R1
+  EdbEmitPushPop (Emitter, OPCODE_POP, TRUE, 2, D, 0);                    // POP64 R2
+  EdbCorpusOp (Emitter, OPCODE_ADD, 7, 2, 0);                             // ADD64 R7, R2
+  EdbEmitRet (Emitter);                                                   // RET
+
+  *Entry = Emitter->Offset;
+  EdbCorpusMovi (Emitter, 1, 20);                                         // MOVI R1, 20
+  EdbEmitPushPop (Emitter, OPCODE_PUSHN, FALSE, 1, D, 0);                 // PUSHn R1
+  EdbCorpusCall (Emitter, Fib);                                           // CALL32 Fib
+  EdbEmitPushPop (Emitter, OPCODE_POPN, FALSE, 1, D, 0);                  // POPn R1
+  EdbCorpusMovi (Emitter, 1, (UINTN)Context->Output);                     // MOVI R1, Output
+  EdbEmitMov (Emitter, OPCODE_MOVQQ, 1, I, 0, 7, D, 0);                   // MOVqq @R1, R7
+  EdbCorpusMovi (Emitter, 7, EFI_SUCCESS);                                // MOVI R7, 0
+  EdbEmitRet (Emitter);                                                   // RET
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Callbacks through thunks: 512 round trips of EBC calling native code,
+  which calls back into EBC, as with protocol notifications.
+
+**/
+EFI_STATUS
+EdbCorpusEmitPingPong (
+  IN OUT EDB_EMITTER        *Emitter,
+  IN     EDB_CORPUS_CONTEXT *Context,
+  OUT    UINTN              *Entry
+  )
+{
+  EFI_STATUS  Status;
+  VOID        *Thunk;
+  UINTN       Loop;
+
+  //
+  // UINT64 Ping (UINTN Value), which returns Value * 3 + 1
+  //
+  Status = Context->Ebc->CreateThunk (
+                           Context->Ebc,
+                           Context->ImageHandle,
+                           Context->Code + Emitter->Offset,
+                           &Thunk
+                           );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  EdbEmitMov (Emitter, OPCODE_MOVNW, 7, D, 0, 0, I | X, EdbEmitIndex (FALSE, 0, 16, 16)); // MOVnw R7, @R0(+0,+16)
+  EdbCorpusMovi (Emitter, 1, 3);                                          // MOVI R1, 3
+  EdbCorpusOp (Emitter, OPCODE_MULU, 7, 1, 0);                            // MULU64 R7, R1
+  EdbCorpusOp (Emitter, OPCODE_ADD, 7, 1, -2);                            // ADD64 R7, R1 -2
+  EdbEmitRet (Emitter);                                                   // RET
+
+  *Entry = Emitter->Offset;
+  EdbCorpusMovi (Emitter, 5, (UINTN)EdbCorpusPong);                       // MOVI R5, EdbCorpusPong
+  EdbCorpusMovi (Emitter, 6, (UINTN)Thunk);                               // MOVI R6, Ping
+  EdbCorpusMovi (Emitter, 4, 0);                                          // MOVI R4, 0
+  EdbCorpusMovi (Emitter, 3, 512);                                        // MOVI R3, 512
+  EdbCorpusMovi (Emitter, 2, 0xFFFF);                                     // MOVI R2, 0xFFFF
+  EdbCorpusMovi (Emitter, 1, 1);                                          // MOVI R1, 1
+  Loop = Emitter->Offset;
+  EdbEmitPushPop (Emitter, OPCODE_PUSHN, FALSE, 4, D, 0);                 // PUSHn R4
+  EdbEmitPushPop (Emitter, OPCODE_PUSHN, FALSE, 6, D, 0);                 // PUSHn R6
+  EdbEmitJmp (Emitter, OPCODE_CALL, OPERAND_M_NATIVE_CALL, 5, D, 0, 0);   // CALLEX R5
+  EdbEmitPushPop (Emitter, OPCODE_POPN, FALSE, 6, D, 0);                  // POPn R6
+  EdbEmitPushPop (Emitter, OPCODE_POPN, FALSE, 4, D, 0);                  // POPn R4
+  EdbCorpusOp (Emitter, OPCODE_ADD, 4, 7, 0);                             // ADD64 R4, R7
+  EdbCorpusOp (Emitter, OPCODE_AND, 4, 2, 0);                             // AND64 R4, R2
+  EdbCorpusOp (Emitter, OPCODE_SUB, 3, 1, 0);                             // SUB64 R3, R1
+  EdbCorpusCmpi (Emitter, OPCODE_CMPIEQ, 3, 0);                           // CMPI64eq R3, 0
+  EdbEmitJmp8 (Emitter, EDB_EMIT_CC, Loop);                               // JMP8cc Loop
+  EdbCorpusMovi (Emitter, 1, (UINTN)Context->Output);                     // MOVI R1, Output
+  EdbEmitMov (Emitter, OPCODE_MOVQQ, 1, I, 0, 4, D, 0);                   // MOVqq @R1, R4
+  EdbCorpusMovi (Emitter, 7, EFI_SUCCESS);                                // MOVI R7, 0
+  EdbEmitRet (Emitter);                                                   // RET
+  return EFI_SUCCESS;
+}
+
+//
+// The corpus, with the results of a run of each program. The instructions
+// include the ones run by callbacks.
+//
+EDB_CORPUS_PROGRAM mEdbCorpus[] = {
+  { L"Blit",       EdbCorpusEmitBlit,      0x7EEBD2E1,  29536 },
+  { L"PciPoll",    EdbCorpusEmitPciPoll,   0x692C1AFB,   3890 },
+  { L"Format",     EdbCorpusEmitFormat,    0x8A4ABB70,  64251 },
+  { L"Crc32",      EdbCorpusEmitCrc,       0x423E3AA7, 307100 },
+  { L"Recursion",  EdbCorpusEmitRecursion, 0x5B608301, 218913 },
+  { L"PingPong",   EdbCorpusEmitPingPong,  0x178ACE31,   7690 }
+};
+
+/**
+
+  Fill the input buffer with the same pseudo-random bytes every time.
+
+  @param  Input     - The input buffer
+
+**/
+VOID
+EdbCorpusFillInput (
+  OUT UINT8 *Input
+  )
+{
+  UINT32 Seed;
+  UINTN  Index;
+
+  Seed = 1;
+  for (Index = 0; Index < EDB_CORPUS_DATA_SIZE; Index++) {
+    Seed         = Seed * 1103515245 + 12345;
+    Input[Index] = (UINT8)(Seed >> 16);
+  }
+}
+
+/**
+
+  Generate a program of the corpus, and run it once to warm up and once
+  to count and time it.
+
+  @param  Context       - The buffers of the program
+  @param  Program       - The program
+  @param  Performance   - The EBC performance protocol, or NULL
+  @param  Ticks         - Duration of the timed run, in ticks
+  @param  Counters      - The counters of the timed run, if Performance isn't NULL
+
+  @retval EFI_SUCCESS   - The program was run
+  @retval Others        - The program could not be run, or returned an error
+
+**/
+EFI_STATUS
+EdbCorpusRun (
+  IN  EDB_CORPUS_CONTEXT            *Context,
+  IN  EDB_CORPUS_PROGRAM            *Program,
+  IN  EFI_EBC_PERFORMANCE_PROTOCOL  *Performance,
+  OUT UINT64                        *Ticks,
+  OUT EFI_EBC_PERFORMANCE_COUNTERS  *Counters
+  )
+{
+  EFI_STATUS            Status;
+  EDB_EMITTER           Emitter;
+  EFI_IMAGE_ENTRY_POINT Thunk;
+  UINTN                 Entry;
+  UINTN                 Run;
+  UINT64                Start;
+  UINT64                End;
+  UINT64                StartValue;
+  UINT64                EndValue;
+
+  EdbEmitInit (&Emitter, Context->Code, EDB_CORPUS_CODE_SIZE);
+  Status = Program->Emit (&Emitter, Context, &Entry);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  if (Emitter.Overflow) {
+    return EFI_BUFFER_TOO_SMALL;
+  }
+  Status = Context->Ebc->CreateThunk (Context->Ebc, Context->ImageHandle, Context->Code + Entry, (VOID **)&Thunk);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Start = 0;
+  End   = 0;
+  for (Run = 0; Run < 2; Run++) {
+    ZeroMem (Context->Output, EDB_CORPUS_DATA_SIZE);
+    ZeroMem (mEdbCorpusPciPolls, sizeof (mEdbCorpusPciPolls));
+    if ((Run == 1) && (Performance != NULL)) {
+      Performance->Reset (Performance);
+      Performance->Enable (Performance, TRUE);
+    }
+    Start  = GetPerformanceCounter ();
+    Status = Thunk (Context->ImageHandle, gST);
+    End    = GetPerformanceCounter ();
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+  }
+  if (Performance != NULL) {
+    Performance->Enable (Performance, FALSE);
+    Performance->Snapshot (Performance, NULL, Counters);
+  }
+  //
+  // The next program reuses the code buffer, so free the thunks, which also
+  // drops what the interpreter cached about the code
+  //
+  Context->Ebc->UnloadImage (Context->Ebc, Context->ImageHandle);
+
+  GetPerformanceCounterProperties (&StartValue, &EndValue);
+  *Ticks = (StartValue > EndValue) ? (Start - End) : (End - Start);
+  return Status;
+}
+
+/**
+
+  Find the EBC protocol, and allocate the buffers of the programs.
+
+  @param  ImageHandle   - The image handle of this application
+  @param  Context       - The buffers of the programs
+
+  @retval EFI_SUCCESS   - The buffers are ready
+  @retval EFI_NOT_FOUND - The EBC protocol was not found
+  @retval EFI_OUT_OF_RESOURCES - The buffers could not be allocated
+
+**/
+EFI_STATUS
+EdbCorpusOpen (
+  IN  EFI_HANDLE          ImageHandle,
+  OUT EDB_CORPUS_CONTEXT  *Context
+  )
+{
+  EFI_STATUS  Status;
+
+  ZeroMem (Context, sizeof (*Context));
+  Context->ImageHandle = ImageHandle;
+  Status = gBS->LocateProtocol (&gEfiEbcProtocolGuid, NULL, (VOID **)&Context->Ebc);
+  if (EFI_ERROR (Status)) {
+    Print (L"Error: EBC protocol not found.\n");
+    return EFI_NOT_FOUND;
+  }
+
+  Context->Code   = AllocatePool (EDB_CORPUS_CODE_SIZE);
+  Context->Input  = AllocatePool (EDB_CORPUS_DATA_SIZE);
+  Context->Output = AllocatePool (EDB_CORPUS_DATA_SIZE);
+  if ((Context->Code == NULL) || (Context->Input == NULL) || (Context->Output == NULL)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  EdbCorpusFillInput (Context->Input);
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Free the buffers of the programs.
+
+  @param  Context       - The buffers of the programs
+
+**/
+VOID
+EdbCorpusClose (
+  IN EDB_CORPUS_CONTEXT *Context
+  )
+{
+  if (Context->Code != NULL) {
+    FreePool (Context->Code);
+  }
+  if (Context->Input != NULL) {
+    FreePool (Context->Input);
+  }
+  if (Context->Output != NULL) {
+    FreePool (Context->Output);
+  }
+}
+
+/**
+
+  Get the number of programs in the corpus.
+
+  @return The number of programs
+
+**/
+UINTN
+EdbGetCorpusSize (
+  VOID
+  )
+{
+  return sizeof (mEdbCorpus) / sizeof (mEdbCorpus[0]);
+}
+
+/**
+
+  Time a number of runs of a program of the corpus, checking its output
+  each time.
+
+  @param  ImageHandle   - The image handle of this application
+  @param  Index         - The program, from 0 to EdbGetCorpusSize() - 1
+  @param  Runs          - Number of runs
+  @param  Name          - The name of the program
+  @param  Instructions  - Number of instructions retired by a run
+  @param  Ticks         - Duration of each run, in ticks
+
+  @retval EFI_SUCCESS           - The program was run
+  @retval EFI_INVALID_PARAMETER - Index is out of range
+  @retval EFI_CRC_ERROR         - The program gave an unexpected result
+  @retval Others                - The program could not be run
+
+**/
+EFI_STATUS
+EdbTimeCorpusProgram (
+  IN  EFI_HANDLE  ImageHandle,
+  IN  UINTN       Index,
+  IN  UINTN       Runs,
+  OUT CHAR16      **Name,
+  OUT UINT64      *Instructions,
+  OUT UINT64      *Ticks
+  )
+{
+  EFI_STATUS          Status;
+  EDB_CORPUS_CONTEXT  Context;
+  UINT32              Crc;
+  UINTN               Run;
+
+  if (Index >= EdbGetCorpusSize ()) {
+    return EFI_INVALID_PARAMETER;
+  }
+  *Name         = mEdbCorpus[Index].Name;
+  *Instructions = mEdbCorpus[Index].Instructions;
+
+  Status = EdbCorpusOpen (ImageHandle, &Context);
+  for (Run = 0; (Run < Runs) && !EFI_ERROR (Status); Run++) {
+    Status = EdbCorpusRun (&Context, &mEdbCorpus[Index], NULL, &Ticks[Run], NULL);
+    if (!EFI_ERROR (Status)) {
+      gBS->CalculateCrc32 (Context.Output, EDB_CORPUS_DATA_SIZE, &Crc);
+      if (Crc != mEdbCorpus[Index].OutputCrc) {
+        Status = EFI_CRC_ERROR;
+      }
+    }
+  }
+  EdbCorpusClose (&Context);
+  return Status;
+}
+
+/**
+
+  Run the programs of the EBC workload corpus, check their output and the
+  number of instructions they retired, and print how long they took.
+
+  The programs are generated, and model what EBC drivers spend their time
+  on: frame buffer blits, polling of PCI devices through native calls,
+  string formatting, CRC loops, recursive calls, and callbacks from native
+  code through thunks. As their results are known, they also serve to check
+  the interpreter and its faster execution paths.
+
+  @param  ImageHandle   - The image handle of this application
+
+  @retval EFI_SUCCESS   - All the programs gave the expected results
+  @retval EFI_CRC_ERROR - A program gave an unexpected result
+  @retval EFI_NOT_FOUND - The EBC protocol was not found
+  @retval Others        - The programs could not be run
+
+**/
+EFI_STATUS
+EdbRunCorpus (
+  IN EFI_HANDLE ImageHandle
+  )
+{
+  EFI_STATUS                    Status;
+  EFI_STATUS                    Result;
+  EDB_CORPUS_CONTEXT            Context;
+  EFI_EBC_PERFORMANCE_PROTOCOL  *Performance;
+  EFI_EBC_PERFORMANCE_COUNTERS  Counters;
+  UINT64                        Frequency;
+  UINT64                        Ticks;
+  UINT32                        Crc;
+  BOOLEAN                       Passed;
+  UINTN                         Index;
+
+  Result = EdbCorpusOpen (ImageHandle, &Context);
+  if (EFI_ERROR (Result)) {
+    goto Done;
+  }
+  //
+  // Without the performance protocol, only the output can be checked
+  //
+  Status = gBS->LocateProtocol (&gEfiEbcPerformanceProtocolGuid, NULL, (VOID **)&Performance);
+  if (EFI_ERROR (Status)) {
+    Performance = NULL;
+  }
+  Frequency = DivU64x64Remainder (GetPerformanceCounterProperties (NULL, NULL), 1000000, NULL);
+
+  Result = EFI_SUCCESS;
+  Print (L"Program     Result  Instructions    Time (us)\n");
+  for (Index = 0; Index < sizeof (mEdbCorpus) / sizeof (mEdbCorpus[0]); Index++) {
+    ZeroMem (&Counters, sizeof (Counters));
+    Status = EdbCorpusRun (&Context, &mEdbCorpus[Index], Performance, &Ticks, &Counters);
+    if (EFI_ERROR (Status)) {
+      Print (L"%-10s  Error - %r\n", mEdbCorpus[Index].Name, Status);
+      Result = Status;
+      continue;
+    }
+    gBS->CalculateCrc32 (Context.Output, EDB_CORPUS_DATA_SIZE, &Crc);
+    Passed = (BOOLEAN)(Crc == mEdbCorpus[Index].OutputCrc);
+    if ((Performance != NULL) && (Counters.Instructions != mEdbCorpus[Index].Instructions)) {
+      Passed = FALSE;
+    }
+    if (!Passed && !EFI_ERROR (Result)) {
+      Result = EFI_CRC_ERROR;
+    }
+    Print (
+      L"%-10s  %-6s  %12ld  %11ld\n",
+      mEdbCorpus[Index].Name,
+      Passed ? L"OK" : L"FAILED",
+      Counters.Instructions,
+      (Frequency != 0) ? DivU64x64Remainder (Ticks, Frequency, NULL) : 0
+      );
+    if (!Passed) {
+      Print (
+        L"            Expected CRC %08x and %ld instructions, got CRC %08x\n",
+        mEdbCorpus[Index].OutputCrc,
+        mEdbCorpus[Index].Instructions,
+        Crc
+        );
+    }
+  }
+
+Done:
+  EdbCorpusClose (&Context);
+  return Result;
+}
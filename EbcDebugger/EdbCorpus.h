@@ -0,0 +1,84 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#ifndef _EFI_EDB_CORPUS_H_
+#define _EFI_EDB_CORPUS_H_
+
+#include <Uefi.h>
+
+/**
+
+  Run the programs of the EBC workload corpus, check their output and the
+  number of instructions they retired, and print how long they took.
+
+  The programs are generated, and model what EBC drivers spend their time
+  on: frame buffer blits, polling of PCI devices through native calls,
+  string formatting, CRC loops, recursive calls, and callbacks from native
+  code through thunks. As their results are known, they also serve to check
+  the interpreter and its faster execution paths.
+
+  @param  ImageHandle   - The image handle of this application
+
+  @retval EFI_SUCCESS   - All the programs gave the expected results
+  @retval EFI_CRC_ERROR - A program gave an unexpected result
+  @retval EFI_NOT_FOUND - The EBC protocol was not found
+  @retval Others        - The programs could not be run
+
+**/
+EFI_STATUS
+EdbRunCorpus (
+  IN EFI_HANDLE ImageHandle
+  );
+
+/**
+
+  Get the number of programs in the corpus.
+
+  @return The number of programs
+
+**/
+UINTN
+EdbGetCorpusSize (
+  VOID
+  );
+
+/**
+
+  Time a number of runs of a program of the corpus, checking its output
+  each time.
+
+  @param  ImageHandle   - The image handle of this application
+  @param  Index         - The program, from 0 to EdbGetCorpusSize() - 1
+  @param  Runs          - Number of runs
+  @param  Name          - The name of the program
+  @param  Instructions  - Number of instructions retired by a run
+  @param  Ticks         - Duration of each run, in ticks
+
+  @retval EFI_SUCCESS           - The program was run
+  @retval EFI_INVALID_PARAMETER - Index is out of range
+  @retval EFI_CRC_ERROR         - The program gave an unexpected result
+  @retval Others                - The program could not be run
+
+**/
+EFI_STATUS
+EdbTimeCorpusProgram (
+  IN  EFI_HANDLE  ImageHandle,
+  IN  UINTN       Index,
+  IN  UINTN       Runs,
+  OUT CHAR16      **Name,
+  OUT UINT64      *Instructions,
+  OUT UINT64      *Ticks
+  );
+
+#endif
@@ -194,8 +194,8 @@ EdbDisasmJMP (
 //    } else {
 //      EdbPrintInstructionName (L"32");
 //    }
-    if ((Modifiers & CONDITION_M_CONDITIONAL) != 0) {
-      if ((Modifiers & JMP_M_CS) != 0) {
+    if ((Operands & CONDITION_M_CONDITIONAL) != 0) {
+      if ((Operands & JMP_M_CS) != 0) {
         EdbPrintInstructionName (L"cs");
       } else {
         EdbPrintInstructionName (L"cc");
@@ -1052,7 +1052,7 @@ EdbDisasmLOADSP (
     EdbPrintInstructionName (L"LOADSP");
 
     EdbPrintDedicatedRegister1 (Operands);
-
+    EdbPrintComma ();
     EdbPrintRegister2 (Operands);
 
     EdbPostInstructionString ();
@@ -1094,7 +1094,7 @@ EdbDisasmSTORESP (
     EdbPrintInstructionName (L"STORESP");
 
     EdbPrintRegister1 (Operands);
-
+    EdbPrintComma ();
     EdbPrintDedicatedRegister2 (Operands);
 
     EdbPostInstructionString ();
@@ -0,0 +1,620 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include <Uefi.h>
+#ifndef _GNU_EFI
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <IndustryStandard/PeImage.h>
+#endif
+
+#include "EdbEmit.h"
+
+/**
+
+  Start emitting EBC code into a buffer.
+
+  @param  Emitter   - The emitter
+  @param  Buffer    - The buffer, which should be 2-byte aligned
+  @param  Size      - The size of the buffer
+
+**/
+VOID
+EdbEmitInit (
+  OUT EDB_EMITTER *Emitter,
+  IN  VOID        *Buffer,
+  IN  UINTN       Size
+  )
+{
+  Emitter->Buffer   = (UINT8 *)Buffer;
+  Emitter->Size     = Size;
+  Emitter->Offset   = 0;
+  Emitter->Overflow = FALSE;
+}
+
+/**
+
+  Emit raw data, little endian.
+
+  @param  Emitter   - The emitter
+  @param  Data      - The data
+  @param  Size      - The size of the data, 1, 2, 4 or 8 bytes
+
+**/
+VOID
+EdbEmitData (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT64      Data,
+  IN     UINTN       Size
+  )
+{
+  UINTN Index;
+
+  if (Emitter->Offset + Size > Emitter->Size) {
+    Emitter->Overflow = TRUE;
+    return;
+  }
+  for (Index = 0; Index < Size; Index++) {
+    Emitter->Buffer[Emitter->Offset++] = (UINT8)Data;
+    Data = RShiftU64 (Data, 8);
+  }
+}
+
+/**
+
+  Encode a natural index, using the smallest number of bits for the natural
+  units that the value needs.
+
+  @param  Negative  - TRUE for a negative index
+  @param  Natural   - Number of natural units
+  @param  Constant  - Number of bytes
+  @param  Bits      - Size of the index, 16, 32 or 64 bits
+
+  @return The encoded index, or 0 if it doesn't fit
+
+**/
+UINT64
+EdbEmitIndex (
+  IN BOOLEAN Negative,
+  IN UINTN   Natural,
+  IN UINTN   Constant,
+  IN UINTN   Bits
+  )
+{
+  UINT64 Index;
+  UINTN  Width;
+  UINTN  NBits;
+
+  //
+  // The top 4 bits hold the sign, and the number of bits assigned to the
+  // natural units, in multiples of Bits / 8. The constant gets the rest.
+  //
+  for (Width = 0; Width < 8; Width++) {
+    NBits = Width * (Bits / 8);
+    if (NBits > Bits - 4) {
+      return 0;
+    }
+    if ((RShiftU64 (Natural, NBits) == 0) &&
+        (RShiftU64 (Constant, Bits - 4 - NBits) == 0)) {
+      break;
+    }
+  }
+  if (Width == 8) {
+    return 0;
+  }
+
+  Index = LShiftU64 (Width, Bits - 4) | LShiftU64 (Constant, NBits) | Natural;
+  if (Negative) {
+    Index |= LShiftU64 (1, Bits - 1);
+  }
+  return Index;
+}
+
+/**
+
+  Emit the operands byte of an instruction.
+
+  @param  Emitter   - The emitter
+  @param  Modifiers - Other bits of the byte
+  @param  Op1       - Register of operand 1
+  @param  Op1Flags  - EDB_EMIT_xxx flags of operand 1
+  @param  Op2       - Register of operand 2
+  @param  Op2Flags  - EDB_EMIT_xxx flags of operand 2
+
+**/
+VOID
+EdbEmitOperands (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Modifiers,
+  IN     UINT8       Op1,
+  IN     UINT8       Op1Flags,
+  IN     UINT8       Op2,
+  IN     UINT8       Op2Flags
+  )
+{
+  UINT8 Operands;
+
+  Operands = (UINT8)(Modifiers | (Op1 & OPERAND_M_OP1) | ((Op2 << 4) & OPERAND_M_OP2));
+  if ((Op1Flags & EDB_EMIT_INDIRECT) != 0) {
+    Operands |= OPERAND_M_INDIRECT1;
+  }
+  if ((Op2Flags & EDB_EMIT_INDIRECT) != 0) {
+    Operands |= OPERAND_M_INDIRECT2;
+  }
+  EdbEmitData (Emitter, Operands, 1);
+}
+
+/**
+
+  Emit a MOVxx, MOVsnx or MOVnx instruction. The size of the indexes
+  is the one of the opcode.
+
+  @param  Emitter   - The emitter
+  @param  Opcode    - OPCODE_MOVBW to OPCODE_MOVQQ, OPCODE_MOVNW or OPCODE_MOVND
+  @param  Op1       - Register of operand 1
+  @param  Op1Flags  - EDB_EMIT_xxx flags of operand 1
+  @param  Index1    - Encoded index of operand 1
+  @param  Op2       - Register of operand 2
+  @param  Op2Flags  - EDB_EMIT_xxx flags of operand 2
+  @param  Index2    - Encoded index, or immediate data, of operand 2
+
+**/
+VOID
+EdbEmitMov (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Opcode,
+  IN     UINT8       Op1,
+  IN     UINT8       Op1Flags,
+  IN     UINT64      Index1,
+  IN     UINT8       Op2,
+  IN     UINT8       Op2Flags,
+  IN     UINT64      Index2
+  )
+{
+  UINTN IndexSize;
+
+  switch (Opcode) {
+  case OPCODE_MOVBW:
+  case OPCODE_MOVWW:
+  case OPCODE_MOVDW:
+  case OPCODE_MOVQW:
+  case OPCODE_MOVSNW:
+  case OPCODE_MOVNW:
+    IndexSize = 2;
+    break;
+  case OPCODE_MOVQQ:
+    IndexSize = 8;
+    break;
+  default:
+    IndexSize = 4;
+    break;
+  }
+
+  if ((Op1Flags & EDB_EMIT_INDEX) != 0) {
+    Opcode |= OPCODE_M_IMMED_OP1;
+  }
+  if ((Op2Flags & EDB_EMIT_INDEX) != 0) {
+    Opcode |= OPCODE_M_IMMED_OP2;
+  }
+  EdbEmitData (Emitter, Opcode, 1);
+  EdbEmitOperands (Emitter, 0, Op1, Op1Flags, Op2, Op2Flags);
+  if ((Op1Flags & EDB_EMIT_INDEX) != 0) {
+    EdbEmitData (Emitter, Index1, IndexSize);
+  }
+  if ((Op2Flags & EDB_EMIT_INDEX) != 0) {
+    EdbEmitData (Emitter, Index2, IndexSize);
+  }
+}
+
+/**
+
+  Emit a MOVI, MOVIn or MOVREL instruction.
+
+  @param  Emitter   - The emitter
+  @param  Opcode    - OPCODE_MOVI, OPCODE_MOVIN or OPCODE_MOVREL
+  @param  MoveWidth - MOVI_MOVEWIDTHxx for MOVI, 0 otherwise
+  @param  Op1       - Register of operand 1
+  @param  Op1Flags  - EDB_EMIT_xxx flags of operand 1
+  @param  Index1    - Encoded 16-bit index of operand 1
+  @param  DataWidth - MOVI_DATAWIDTHxx
+  @param  Data      - Immediate data, encoded index or offset
+
+**/
+VOID
+EdbEmitMovi (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Opcode,
+  IN     UINT8       MoveWidth,
+  IN     UINT8       Op1,
+  IN     UINT8       Op1Flags,
+  IN     UINT64      Index1,
+  IN     UINT8       DataWidth,
+  IN     UINT64      Data
+  )
+{
+  UINT8 Modifiers;
+
+  Modifiers = MoveWidth;
+  if ((Op1Flags & EDB_EMIT_INDEX) != 0) {
+    Modifiers |= MOVI_M_IMMDATA;
+  }
+  EdbEmitData (Emitter, Opcode | DataWidth, 1);
+  EdbEmitOperands (Emitter, Modifiers, Op1, Op1Flags, 0, EDB_EMIT_DIRECT);
+  if ((Op1Flags & EDB_EMIT_INDEX) != 0) {
+    EdbEmitData (Emitter, Index1, 2);
+  }
+  switch (DataWidth) {
+  case MOVI_DATAWIDTH16:
+    EdbEmitData (Emitter, Data, 2);
+    break;
+  case MOVI_DATAWIDTH32:
+    EdbEmitData (Emitter, Data, 4);
+    break;
+  default:
+    EdbEmitData (Emitter, Data, 8);
+    break;
+  }
+}
+
+/**
+
+  Emit a data manipulation or CMP instruction.
+
+  @param  Emitter   - The emitter
+  @param  Opcode    - OPCODE_NOT to OPCODE_EXTNDD, or OPCODE_CMPEQ to OPCODE_CMPUGTE
+  @param  Is64      - TRUE for a 64-bit operation
+  @param  Op1       - Register of operand 1
+  @param  Op1Flags  - EDB_EMIT_xxx flags of operand 1
+  @param  Op2       - Register of operand 2
+  @param  Op2Flags  - EDB_EMIT_xxx flags of operand 2
+  @param  Index2    - Encoded 16-bit index, or immediate data, of operand 2
+
+**/
+VOID
+EdbEmitDataManip (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Opcode,
+  IN     BOOLEAN     Is64,
+  IN     UINT8       Op1,
+  IN     UINT8       Op1Flags,
+  IN     UINT8       Op2,
+  IN     UINT8       Op2Flags,
+  IN     UINT16      Index2
+  )
+{
+  if (Is64) {
+    Opcode |= DATAMANIP_M_64;
+  }
+  if ((Op2Flags & EDB_EMIT_INDEX) != 0) {
+    Opcode |= DATAMANIP_M_IMMDATA;
+  }
+  EdbEmitData (Emitter, Opcode, 1);
+  EdbEmitOperands (Emitter, 0, Op1, Op1Flags, Op2, Op2Flags);
+  if ((Op2Flags & EDB_EMIT_INDEX) != 0) {
+    EdbEmitData (Emitter, Index2, 2);
+  }
+}
+
+/**
+
+  Emit a CMPI instruction.
+
+  @param  Emitter   - The emitter
+  @param  Opcode    - OPCODE_CMPIEQ to OPCODE_CMPIUGTE
+  @param  Is64      - TRUE for a 64-bit comparison
+  @param  Op1       - Register of operand 1
+  @param  Op1Flags  - EDB_EMIT_xxx flags of operand 1
+  @param  Index1    - Encoded 16-bit index of operand 1
+  @param  Is32      - TRUE for 32-bit immediate data, FALSE for 16-bit
+  @param  Data      - Immediate data
+
+**/
+VOID
+EdbEmitCmpi (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Opcode,
+  IN     BOOLEAN     Is64,
+  IN     UINT8       Op1,
+  IN     UINT8       Op1Flags,
+  IN     UINT16      Index1,
+  IN     BOOLEAN     Is32,
+  IN     UINT32      Data
+  )
+{
+  if (Is64) {
+    Opcode |= OPCODE_M_CMPI64;
+  }
+  if (Is32) {
+    Opcode |= OPCODE_M_CMPI32_DATA;
+  }
+  EdbEmitData (Emitter, Opcode, 1);
+  EdbEmitOperands (
+    Emitter,
+    (UINT8)(((Op1Flags & EDB_EMIT_INDEX) != 0) ? OPERAND_M_CMPI_INDEX : 0),
+    Op1,
+    Op1Flags,
+    0,
+    EDB_EMIT_DIRECT
+    );
+  if ((Op1Flags & EDB_EMIT_INDEX) != 0) {
+    EdbEmitData (Emitter, Index1, 2);
+  }
+  EdbEmitData (Emitter, Data, Is32 ? 4 : 2);
+}
+
+/**
+
+  Emit a JMP or CALL instruction.
+
+  @param  Emitter   - The emitter
+  @param  Opcode    - OPCODE_JMP or OPCODE_CALL
+  @param  Modifiers - EDB_EMIT_ALWAYS, EDB_EMIT_CC or EDB_EMIT_CS for JMP,
+                      OPERAND_M_NATIVE_CALL for CALLEX, optionally ORed with
+                      OPERAND_M_RELATIVE_ADDR
+  @param  Op1       - Register of operand 1
+  @param  Op1Flags  - EDB_EMIT_xxx flags of operand 1
+  @param  DataSize  - Size of the immediate data, 0, 4 or 8 bytes
+  @param  Data      - Immediate data
+
+**/
+VOID
+EdbEmitJmp (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Opcode,
+  IN     UINT8       Modifiers,
+  IN     UINT8       Op1,
+  IN     UINT8       Op1Flags,
+  IN     UINTN       DataSize,
+  IN     UINT64      Data
+  )
+{
+  if (DataSize != 0) {
+    Opcode |= OPCODE_M_IMMDATA;
+  }
+  if (DataSize == 8) {
+    Opcode |= OPCODE_M_IMMDATA64;
+  }
+  EdbEmitData (Emitter, Opcode, 1);
+  EdbEmitOperands (Emitter, Modifiers, Op1, Op1Flags, 0, EDB_EMIT_DIRECT);
+  if (DataSize != 0) {
+    EdbEmitData (Emitter, Data, DataSize);
+  }
+}
+
+/**
+
+  Emit a JMP8 instruction.
+
+  @param  Emitter   - The emitter
+  @param  Condition - EDB_EMIT_ALWAYS, EDB_EMIT_CC or EDB_EMIT_CS
+  @param  Target    - Offset of the target in the buffer
+
+**/
+VOID
+EdbEmitJmp8 (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Condition,
+  IN     UINTN       Target
+  )
+{
+  INTN Offset;
+
+  //
+  // The offset is in words, from the end of the instruction
+  //
+  Offset = ((INTN)Target - (INTN)(Emitter->Offset + 2)) / 2;
+  if ((Offset < -128) || (Offset > 127)) {
+    Emitter->Overflow = TRUE;
+    return;
+  }
+  EdbEmitData (Emitter, OPCODE_JMP8 | Condition, 1);
+  EdbEmitData (Emitter, (UINT8)Offset, 1);
+}
+
+/**
+
+  Emit a PUSH, POP, PUSHn or POPn instruction.
+
+  @param  Emitter   - The emitter
+  @param  Opcode    - OPCODE_PUSH, OPCODE_POP, OPCODE_PUSHN or OPCODE_POPN
+  @param  Is64      - TRUE for a 64-bit PUSH or POP
+  @param  Op1       - Register of operand 1
+  @param  Op1Flags  - EDB_EMIT_xxx flags of operand 1
+  @param  Index1    - Encoded 16-bit index, or immediate data, of operand 1
+
+**/
+VOID
+EdbEmitPushPop (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Opcode,
+  IN     BOOLEAN     Is64,
+  IN     UINT8       Op1,
+  IN     UINT8       Op1Flags,
+  IN     UINT16      Index1
+  )
+{
+  if (Is64) {
+    Opcode |= PUSHPOP_M_64;
+  }
+  if ((Op1Flags & EDB_EMIT_INDEX) != 0) {
+    Opcode |= PUSHPOP_M_IMMDATA;
+  }
+  EdbEmitData (Emitter, Opcode, 1);
+  EdbEmitOperands (Emitter, 0, Op1, Op1Flags, 0, EDB_EMIT_DIRECT);
+  if ((Op1Flags & EDB_EMIT_INDEX) != 0) {
+    EdbEmitData (Emitter, Index1, 2);
+  }
+}
+
+/**
+
+  Emit a RET instruction.
+
+  @param  Emitter   - The emitter
+
+**/
+VOID
+EdbEmitRet (
+  IN OUT EDB_EMITTER *Emitter
+  )
+{
+  EdbEmitData (Emitter, OPCODE_RET, 1);
+  EdbEmitData (Emitter, 0, 1);
+}
+
+/**
+
+  Emit a BREAK instruction.
+
+  @param  Emitter   - The emitter
+  @param  Code      - The break code, 0 to 6
+
+**/
+VOID
+EdbEmitBreak (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Code
+  )
+{
+  EdbEmitData (Emitter, OPCODE_BREAK, 1);
+  EdbEmitData (Emitter, Code, 1);
+}
+
+/**
+
+  Emit a LOADSP instruction.
+
+  @param  Emitter   - The emitter
+  @param  Dedicated - EDB_EMIT_FLAGS
+  @param  Op2       - Register of operand 2
+
+**/
+VOID
+EdbEmitLoadSp (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Dedicated,
+  IN     UINT8       Op2
+  )
+{
+  EdbEmitData (Emitter, OPCODE_LOADSP, 1);
+  EdbEmitOperands (Emitter, 0, Dedicated, EDB_EMIT_DIRECT, Op2, EDB_EMIT_DIRECT);
+}
+
+/**
+
+  Emit a STORESP instruction.
+
+  @param  Emitter   - The emitter
+  @param  Op1       - Register of operand 1
+  @param  Dedicated - EDB_EMIT_FLAGS or EDB_EMIT_IP
+
+**/
+VOID
+EdbEmitStoreSp (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Op1,
+  IN     UINT8       Dedicated
+  )
+{
+  EdbEmitData (Emitter, OPCODE_STORESP, 1);
+  EdbEmitOperands (Emitter, 0, Op1, EDB_EMIT_DIRECT, Dedicated, EDB_EMIT_DIRECT);
+}
+
+/**
+
+  Get the size of the PE32+ image of the emitted code.
+
+  @param  Emitter   - The emitter
+
+  @return The size of the image
+
+**/
+UINTN
+EdbEmitImageSize (
+  IN EDB_EMITTER *Emitter
+  )
+{
+  //
+  // The headers fill the first block, and the code section the next ones
+  //
+  return EDB_EMIT_IMAGE_ALIGNMENT +
+         ((Emitter->Offset + EDB_EMIT_IMAGE_ALIGNMENT - 1) & ~(EDB_EMIT_IMAGE_ALIGNMENT - 1));
+}
+
+/**
+
+  Write the emitted code as a PE32+ EBC image, that can be loaded with
+  LoadImage, or saved to a file.
+
+  The image has a single section, for code and data, so the code must be
+  position independent: it has no relocations.
+
+  @param  Emitter   - The emitter
+  @param  Entry     - Offset of the entry point in the code
+  @param  Subsystem - EFI_IMAGE_SUBSYSTEM_EFI_xxx
+  @param  Image     - The buffer for the image, of EdbEmitImageSize() bytes
+
+**/
+VOID
+EdbEmitImage (
+  IN  EDB_EMITTER *Emitter,
+  IN  UINTN       Entry,
+  IN  UINT16      Subsystem,
+  OUT VOID        *Image
+  )
+{
+  EFI_IMAGE_DOS_HEADER      *DosHdr;
+  EFI_IMAGE_NT_HEADERS64    *NtHdr;
+  EFI_IMAGE_SECTION_HEADER  *Section;
+  UINTN                     Size;
+
+  Size = EdbEmitImageSize (Emitter);
+  ZeroMem (Image, Size);
+
+  DosHdr           = (EFI_IMAGE_DOS_HEADER *)Image;
+  DosHdr->e_magic  = EFI_IMAGE_DOS_SIGNATURE;
+  DosHdr->e_lfanew = sizeof (EFI_IMAGE_DOS_HEADER);
+
+  NtHdr            = (EFI_IMAGE_NT_HEADERS64 *)((UINT8 *)Image + DosHdr->e_lfanew);
+  NtHdr->Signature = EFI_IMAGE_NT_SIGNATURE;
+  NtHdr->FileHeader.Machine              = EFI_IMAGE_MACHINE_EBC;
+  NtHdr->FileHeader.NumberOfSections     = 1;
+  NtHdr->FileHeader.SizeOfOptionalHeader = sizeof (EFI_IMAGE_OPTIONAL_HEADER64);
+  NtHdr->FileHeader.Characteristics      = EFI_IMAGE_FILE_EXECUTABLE_IMAGE | EFI_IMAGE_FILE_LINE_NUMS_STRIPPED;
+
+  //
+  // The file and the loaded image have the same layout
+  //
+  NtHdr->OptionalHeader.Magic               = EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC;
+  NtHdr->OptionalHeader.SizeOfCode          = (UINT32)(Size - EDB_EMIT_IMAGE_ALIGNMENT);
+  NtHdr->OptionalHeader.AddressOfEntryPoint = (UINT32)(EDB_EMIT_IMAGE_ALIGNMENT + Entry);
+  NtHdr->OptionalHeader.BaseOfCode          = EDB_EMIT_IMAGE_ALIGNMENT;
+  NtHdr->OptionalHeader.SectionAlignment    = EDB_EMIT_IMAGE_ALIGNMENT;
+  NtHdr->OptionalHeader.FileAlignment       = EDB_EMIT_IMAGE_ALIGNMENT;
+  NtHdr->OptionalHeader.SizeOfImage         = (UINT32)Size;
+  NtHdr->OptionalHeader.SizeOfHeaders       = EDB_EMIT_IMAGE_ALIGNMENT;
+  NtHdr->OptionalHeader.Subsystem           = Subsystem;
+  NtHdr->OptionalHeader.NumberOfRvaAndSizes = EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES;
+
+  Section = (EFI_IMAGE_SECTION_HEADER *)(NtHdr + 1);
+  CopyMem (Section->Name, ".text", 5);
+  Section->Misc.VirtualSize = (UINT32)Emitter->Offset;
+  Section->VirtualAddress   = EDB_EMIT_IMAGE_ALIGNMENT;
+  Section->SizeOfRawData    = (UINT32)(Size - EDB_EMIT_IMAGE_ALIGNMENT);
+  Section->PointerToRawData = EDB_EMIT_IMAGE_ALIGNMENT;
+  Section->Characteristics  = EFI_IMAGE_SCN_CNT_CODE | EFI_IMAGE_SCN_MEM_EXECUTE |
+                              EFI_IMAGE_SCN_MEM_READ | EFI_IMAGE_SCN_MEM_WRITE;
+
+  CopyMem ((UINT8 *)Image + EDB_EMIT_IMAGE_ALIGNMENT, Emitter->Buffer, Emitter->Offset);
+}
@@ -0,0 +1,369 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#ifndef _EFI_EDB_EMIT_H_
+#define _EFI_EDB_EMIT_H_
+
+#include <Uefi.h>
+#include <Protocol/DebugSupport.h>
+
+//
+// Operand flags
+//
+#define EDB_EMIT_DIRECT     0x00
+#define EDB_EMIT_INDIRECT   0x01  ///< @Rx
+#define EDB_EMIT_INDEX      0x02  ///< an index or immediate data follows
+
+//
+// Conditions of the jumps
+//
+#define EDB_EMIT_ALWAYS     0x00
+#define EDB_EMIT_CC         CONDITION_M_CONDITIONAL
+#define EDB_EMIT_CS         (CONDITION_M_CONDITIONAL | CONDITION_M_CS)
+
+//
+// Dedicated registers of LOADSP and STORESP
+//
+#define EDB_EMIT_FLAGS      0
+#define EDB_EMIT_IP         1
+
+//
+// Alignment of the headers and of the code section in an image
+//
+#define EDB_EMIT_IMAGE_ALIGNMENT  0x200
+
+typedef struct {
+  UINT8   *Buffer;
+  UINTN   Size;
+  UINTN   Offset;       ///< where the next instruction goes
+  BOOLEAN Overflow;     ///< set if an instruction didn't fit in the buffer
+} EDB_EMITTER;
+
+/**
+
+  Start emitting EBC code into a buffer.
+
+  @param  Emitter   - The emitter
+  @param  Buffer    - The buffer, which should be 2-byte aligned
+  @param  Size      - The size of the buffer
+
+**/
+VOID
+EdbEmitInit (
+  OUT EDB_EMITTER *Emitter,
+  IN  VOID        *Buffer,
+  IN  UINTN       Size
+  );
+
+/**
+
+  Emit raw data, little endian.
+
+  @param  Emitter   - The emitter
+  @param  Data      - The data
+  @param  Size      - The size of the data, 1, 2, 4 or 8 bytes
+
+**/
+VOID
+EdbEmitData (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT64      Data,
+  IN     UINTN       Size
+  );
+
+/**
+
+  Encode a natural index, using the smallest number of bits for the natural
+  units that the value needs.
+
+  @param  Negative  - TRUE for a negative index
+  @param  Natural   - Number of natural units
+  @param  Constant  - Number of bytes
+  @param  Bits      - Size of the index, 16, 32 or 64 bits
+
+  @return The encoded index, or 0 if it doesn't fit
+
+**/
+UINT64
+EdbEmitIndex (
+  IN BOOLEAN Negative,
+  IN UINTN   Natural,
+  IN UINTN   Constant,
+  IN UINTN   Bits
+  );
+
+/**
+
+  Emit a MOVxx, MOVsnx or MOVnx instruction. The size of the indexes
+  is the one of the opcode.
+
+  @param  Emitter   - The emitter
+  @param  Opcode    - OPCODE_MOVBW to OPCODE_MOVQQ, OPCODE_MOVNW or OPCODE_MOVND
+  @param  Op1       - Register of operand 1
+  @param  Op1Flags  - EDB_EMIT_xxx flags of operand 1
+  @param  Index1    - Encoded index of operand 1
+  @param  Op2       - Register of operand 2
+  @param  Op2Flags  - EDB_EMIT_xxx flags of operand 2
+  @param  Index2    - Encoded index, or immediate data, of operand 2
+
+**/
+VOID
+EdbEmitMov (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Opcode,
+  IN     UINT8       Op1,
+  IN     UINT8       Op1Flags,
+  IN     UINT64      Index1,
+  IN     UINT8       Op2,
+  IN     UINT8       Op2Flags,
+  IN     UINT64      Index2
+  );
+
+/**
+
+  Emit a MOVI, MOVIn or MOVREL instruction.
+
+  @param  Emitter   - The emitter
+  @param  Opcode    - OPCODE_MOVI, OPCODE_MOVIN or OPCODE_MOVREL
+  @param  MoveWidth - MOVI_MOVEWIDTHxx for MOVI, 0 otherwise
+  @param  Op1       - Register of operand 1
+  @param  Op1Flags  - EDB_EMIT_xxx flags of operand 1
+  @param  Index1    - Encoded 16-bit index of operand 1
+  @param  DataWidth - MOVI_DATAWIDTHxx
+  @param  Data      - Immediate data, encoded index or offset
+
+**/
+VOID
+EdbEmitMovi (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Opcode,
+  IN     UINT8       MoveWidth,
+  IN     UINT8       Op1,
+  IN     UINT8       Op1Flags,
+  IN     UINT64      Index1,
+  IN     UINT8       DataWidth,
+  IN     UINT64      Data
+  );
+
+/**
+
+  Emit a data manipulation or CMP instruction.
+
+  @param  Emitter   - The emitter
+  @param  Opcode    - OPCODE_NOT to OPCODE_EXTNDD, or OPCODE_CMPEQ to OPCODE_CMPUGTE
+  @param  Is64      - TRUE for a 64-bit operation
+  @param  Op1       - Register of operand 1
+  @param  Op1Flags  - EDB_EMIT_xxx flags of operand 1
+  @param  Op2       - Register of operand 2
+  @param  Op2Flags  - EDB_EMIT_xxx flags of operand 2
+  @param  Index2    - Encoded 16-bit index, or immediate data, of operand 2
+
+**/
+VOID
+EdbEmitDataManip (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Opcode,
+  IN     BOOLEAN     Is64,
+  IN     UINT8       Op1,
+  IN     UINT8       Op1Flags,
+  IN     UINT8       Op2,
+  IN     UINT8       Op2Flags,
+  IN     UINT16      Index2
+  );
+
+/**
+
+  Emit a CMPI instruction.
+
+  @param  Emitter   - The emitter
+  @param  Opcode    - OPCODE_CMPIEQ to OPCODE_CMPIUGTE
+  @param  Is64      - TRUE for a 64-bit comparison
+  @param  Op1       - Register of operand 1
+  @param  Op1Flags  - EDB_EMIT_xxx flags of operand 1
+  @param  Index1    - Encoded 16-bit index of operand 1
+  @param  Is32      - TRUE for 32-bit immediate data, FALSE for 16-bit
+  @param  Data      - Immediate data
+
+**/
+VOID
+EdbEmitCmpi (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Opcode,
+  IN     BOOLEAN     Is64,
+  IN     UINT8       Op1,
+  IN     UINT8       Op1Flags,
+  IN     UINT16      Index1,
+  IN     BOOLEAN     Is32,
+  IN     UINT32      Data
+  );
+
+/**
+
+  Emit a JMP or CALL instruction.
+
+  @param  Emitter   - The emitter
+  @param  Opcode    - OPCODE_JMP or OPCODE_CALL
+  @param  Modifiers - EDB_EMIT_ALWAYS, EDB_EMIT_CC or EDB_EMIT_CS for JMP,
+                      OPERAND_M_NATIVE_CALL for CALLEX, optionally ORed with
+                      OPERAND_M_RELATIVE_ADDR
+  @param  Op1       - Register of operand 1
+  @param  Op1Flags  - EDB_EMIT_xxx flags of operand 1
+  @param  DataSize  - Size of the immediate data, 0, 4 or 8 bytes
+  @param  Data      - Immediate data
+
+**/
+VOID
+EdbEmitJmp (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Opcode,
+  IN     UINT8       Modifiers,
+  IN     UINT8       Op1,
+  IN     UINT8       Op1Flags,
+  IN     UINTN       DataSize,
+  IN     UINT64      Data
+  );
+
+/**
+
+  Emit a JMP8 instruction.
+
+  @param  Emitter   - The emitter
+  @param  Condition - EDB_EMIT_ALWAYS, EDB_EMIT_CC or EDB_EMIT_CS
+  @param  Target    - Offset of the target in the buffer
+
+**/
+VOID
+EdbEmitJmp8 (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Condition,
+  IN     UINTN       Target
+  );
+
+/**
+
+  Emit a PUSH, POP, PUSHn or POPn instruction.
+
+  @param  Emitter   - The emitter
+  @param  Opcode    - OPCODE_PUSH, OPCODE_POP, OPCODE_PUSHN or OPCODE_POPN
+  @param  Is64      - TRUE for a 64-bit PUSH or POP
+  @param  Op1       - Register of operand 1
+  @param  Op1Flags  - EDB_EMIT_xxx flags of operand 1
+  @param  Index1    - Encoded 16-bit index, or immediate data, of operand 1
+
+**/
+VOID
+EdbEmitPushPop (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Opcode,
+  IN     BOOLEAN     Is64,
+  IN     UINT8       Op1,
+  IN     UINT8       Op1Flags,
+  IN     UINT16      Index1
+  );
+
+/**
+
+  Emit a RET instruction.
+
+  @param  Emitter   - The emitter
+
+**/
+VOID
+EdbEmitRet (
+  IN OUT EDB_EMITTER *Emitter
+  );
+
+/**
+
+  Emit a BREAK instruction.
+
+  @param  Emitter   - The emitter
+  @param  Code      - The break code, 0 to 6
+
+**/
+VOID
+EdbEmitBreak (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Code
+  );
+
+/**
+
+  Emit a LOADSP instruction.
+
+  @param  Emitter   - The emitter
+  @param  Dedicated - EDB_EMIT_FLAGS
+  @param  Op2       - Register of operand 2
+
+**/
+VOID
+EdbEmitLoadSp (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Dedicated,
+  IN     UINT8       Op2
+  );
+
+/**
+
+  Emit a STORESP instruction.
+
+  @param  Emitter   - The emitter
+  @param  Op1       - Register of operand 1
+  @param  Dedicated - EDB_EMIT_FLAGS or EDB_EMIT_IP
+
+**/
+VOID
+EdbEmitStoreSp (
+  IN OUT EDB_EMITTER *Emitter,
+  IN     UINT8       Op1,
+  IN     UINT8       Dedicated
+  );
+
+/**
+
+  Get the size of the PE32+ image of the emitted code.
+
+  @param  Emitter   - The emitter
+
+  @return The size of the image
+
+**/
+UINTN
+EdbEmitImageSize (
+  IN EDB_EMITTER *Emitter
+  );
+
+/**
+
+  Write the emitted code as a PE32+ EBC image, that can be loaded with
+  LoadImage, or saved to a file.
+
+  The image has a single section, for code and data, so the code must be
+  position independent: it has no relocations.
+
+  @param  Emitter   - The emitter
+  @param  Entry     - Offset of the entry point in the code
+  @param  Subsystem - EFI_IMAGE_SUBSYSTEM_EFI_xxx
+  @param  Image     - The buffer for the image, of EdbEmitImageSize() bytes
+
+**/
+VOID
+EdbEmitImage (
+  IN  EDB_EMITTER *Emitter,
+  IN  UINTN       Entry,
+  IN  UINT16      Subsystem,
+  OUT VOID        *Image
+  );
+
+#endif
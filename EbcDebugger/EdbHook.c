@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 **/
 
 #include "Edb.h"
+#include "EbcInt.h"
 
 /**
 
@@ -282,6 +283,360 @@ EbcDebuggerPushStepEntry (
 }
 
 
+/**
+
+  Find the node of a call in a call graph table, adding it if needed.
+
+  @param  Table    - The node table, of EFI_DEBUGGER_CALLGRAPH_NODE_MAX entries
+  @param  Parent   - The index of the parent node
+  @param  Address  - The address of the callee
+  @param  Flags    - EFI_DEBUGGER_CALLGRAPH_NATIVE and EFI_DEBUGGER_CALLGRAPH_ENTRY
+
+  @return The index of the node, or 0 if the table is too full to add it
+
+**/
+UINTN
+EbcDebuggerFindCallGraphNode (
+  IN EFI_DEBUGGER_CALLGRAPH_NODE  *Table,
+  IN UINTN                        Parent,
+  IN UINTN                        Address,
+  IN UINT32                       Flags
+  )
+{
+  UINTN  Index;
+  UINTN  Probe;
+
+  Flags |= EFI_DEBUGGER_CALLGRAPH_USED;
+  Index = ((Parent * 31) ^ Address ^ (Address >> 12)) & (EFI_DEBUGGER_CALLGRAPH_NODE_MAX - 1);
+  for (Probe = 0; Probe < EFI_DEBUGGER_CALLGRAPH_PROBES; Probe++) {
+    //
+    // The first node is the root
+    //
+    if (Index != 0) {
+      if (Table[Index].Flags == 0) {
+        Table[Index].Parent  = Parent;
+        Table[Index].Address = Address;
+        Table[Index].Flags   = Flags;
+      }
+      if ((Table[Index].Parent == Parent) && (Table[Index].Address == Address) && (Table[Index].Flags == Flags)) {
+        return Index;
+      }
+    }
+    Index = (Index + 1) & (EFI_DEBUGGER_CALLGRAPH_NODE_MAX - 1);
+  }
+
+  return 0;
+}
+
+/**
+
+  It will push a call on the shadow call stack of the call graph profiler.
+
+  @param  Address  - The address of the callee, or of the CALLEX instruction
+  @param  Flags    - EFI_DEBUGGER_CALLGRAPH_NATIVE and EFI_DEBUGGER_CALLGRAPH_ENTRY
+  @param  FramePtr - The frame pointer of the caller
+
+**/
+VOID
+EbcDebuggerPushCallGraph (
+  IN UINTN                    Address,
+  IN UINT32                   Flags,
+  IN VOID                     *FramePtr
+  )
+{
+  EFI_DEBUGGER_CALLGRAPH_CONTEXT  *Context;
+  EFI_DEBUGGER_CALLGRAPH_FRAME    *Frame;
+  UINTN                           Depth;
+
+  Context = &mDebuggerPrivate.CallGraphContext;
+  if (!Context->Enabled) {
+    return ;
+  }
+
+  Depth = Context->Depth++;
+  if (Depth >= EFI_DEBUGGER_CALLGRAPH_DEPTH_MAX) {
+    return ;
+  }
+
+  //
+  // The calls made by a call that was lost are lost as well
+  //
+  Frame = &Context->Frame[Depth];
+  Frame->Node = 0;
+  if ((Depth == 0) || (Context->Frame[Depth - 1].Node != 0)) {
+    Frame->Node = EbcDebuggerFindCallGraphNode (
+                    Context->Node,
+                    (Depth == 0) ? 0 : Context->Frame[Depth - 1].Node,
+                    Address,
+                    Flags
+                    );
+  }
+  if (Frame->Node == 0) {
+    Context->LostCount++;
+  } else {
+    Context->Node[Frame->Node].Calls++;
+  }
+  Frame->Flags    = Flags;
+  Frame->FramePtr = FramePtr;
+  Frame->Children = 0;
+  Frame->Start    = EbcReadClock (NULL) - Context->PauseTicks;
+
+  return ;
+}
+
+/**
+
+  It will pop the newest call from the shadow call stack of the call graph
+  profiler, and account for its duration.
+
+**/
+VOID
+EbcDebuggerPopCallGraph (
+  VOID
+  )
+{
+  EFI_DEBUGGER_CALLGRAPH_CONTEXT  *Context;
+  EFI_DEBUGGER_CALLGRAPH_FRAME    *Frame;
+  EFI_DEBUGGER_CALLGRAPH_NODE     *Node;
+  UINT64                          Elapsed;
+
+  Context = &mDebuggerPrivate.CallGraphContext;
+  if (!Context->Enabled || (Context->Depth == 0)) {
+    //
+    // The calls made before the profiler was started are not tracked
+    //
+    return ;
+  }
+
+  Context->Depth--;
+  if (Context->Depth >= EFI_DEBUGGER_CALLGRAPH_DEPTH_MAX) {
+    return ;
+  }
+
+  Frame   = &Context->Frame[Context->Depth];
+  Elapsed = EbcReadClock (NULL) - Context->PauseTicks - Frame->Start;
+  if (Frame->Node != 0) {
+    Node = &Context->Node[Frame->Node];
+    Node->Inclusive += Elapsed;
+    Node->Exclusive += Elapsed - Frame->Children;
+  }
+  if (Context->Depth != 0) {
+    Context->Frame[Context->Depth - 1].Children += Elapsed;
+  }
+
+  return ;
+}
+
+/**
+
+  It will pop the calls of the call graph profiler when a CALLEX returns.
+  A CALLEX to a thunk is an EBC call that has just started, in which case
+  the native call is replaced with a call to the EBC function.
+
+  @param  VmPtr - pointer to VM context.
+
+**/
+VOID
+EbcDebuggerEndNativeCallGraph (
+  IN VM_CONTEXT *VmPtr
+  )
+{
+  EFI_DEBUGGER_CALLGRAPH_CONTEXT  *Context;
+  EFI_DEBUGGER_CALLGRAPH_FRAME    *Frame;
+
+  Context = &mDebuggerPrivate.CallGraphContext;
+  if (!Context->Enabled || (Context->Depth == 0)) {
+    return ;
+  }
+  if (Context->Depth > EFI_DEBUGGER_CALLGRAPH_DEPTH_MAX) {
+    Context->Depth--;
+    return ;
+  }
+
+  Frame = &Context->Frame[Context->Depth - 1];
+  if (VmPtr->FramePtr == Frame->FramePtr) {
+    EbcDebuggerPopCallGraph ();
+    return ;
+  }
+
+  if (Frame->Node != 0) {
+    Context->Node[Frame->Node].Calls--;
+    Frame->Node = EbcDebuggerFindCallGraphNode (
+                    Context->Node,
+                    Context->Node[Frame->Node].Parent,
+                    (UINTN)VmPtr->Ip,
+                    0
+                    );
+    if (Frame->Node == 0) {
+      Context->LostCount++;
+    } else {
+      Context->Node[Frame->Node].Calls++;
+    }
+  }
+  Frame->Flags = 0;
+
+  return ;
+}
+
+/**
+
+  It will pop the calls of the call graph profiler when a RET returns.
+  The last RET of an EBC entry point or thunk pops all the calls up to
+  the entry, so that calls that were not tracked do not stay on the stack.
+
+  @param  VmPtr - pointer to VM context.
+
+**/
+VOID
+EbcDebuggerRetCallGraph (
+  IN VM_CONTEXT *VmPtr
+  )
+{
+  EFI_DEBUGGER_CALLGRAPH_CONTEXT  *Context;
+  UINT32                          Flags;
+
+  Context = &mDebuggerPrivate.CallGraphContext;
+  if (VmPtr->StackRetAddr != (UINT64) VmPtr->Gpr[0]) {
+    EbcDebuggerPopCallGraph ();
+    return ;
+  }
+
+  while (Context->Enabled && (Context->Depth != 0)) {
+    Flags = EFI_DEBUGGER_CALLGRAPH_ENTRY;
+    if (Context->Depth <= EFI_DEBUGGER_CALLGRAPH_DEPTH_MAX) {
+      Flags = Context->Frame[Context->Depth - 1].Flags;
+    }
+    EbcDebuggerPopCallGraph ();
+    if ((Flags & EFI_DEBUGGER_CALLGRAPH_ENTRY) != 0) {
+      break;
+    }
+  }
+
+  return ;
+}
+
+/**
+
+  It will record an event of the timeline, if the recording is on.
+  The ring is allocated when the recording starts, so this never allocates.
+
+  @param  Type     - EFI_DEBUGGER_TIMELINE_CALL, ENTRY, THUNK, NATIVE or EXCEPTION
+  @param  Phase    - EFI_DEBUGGER_TIMELINE_BEGIN, END or INSTANT
+  @param  Address  - The callee, the CALLEX or RET instruction, or the exception IP
+  @param  Data     - The exception type, or 0
+
+**/
+VOID
+EbcDebuggerPushTimeline (
+  IN UINT8                    Type,
+  IN UINT8                    Phase,
+  IN UINTN                    Address,
+  IN UINT32                   Data
+  )
+{
+  EFI_DEBUGGER_TIMELINE_CONTEXT  *Context;
+  EFI_DEBUGGER_TIMELINE_EVENT    *Event;
+
+  Context = &mDebuggerPrivate.TimelineContext;
+  if (!Context->Enabled) {
+    return ;
+  }
+
+  //
+  // The time spent in the debugger is taken out, as for the call graph
+  //
+  Event = &Context->Event[(UINTN)Context->Count & (EFI_DEBUGGER_TIMELINE_EVENT_MAX - 1)];
+  Event->Timestamp = EbcReadClock (NULL) - mDebuggerPrivate.CallGraphContext.PauseTicks;
+  Event->Address   = Address;
+  Event->Type      = Type;
+  Event->Phase     = Phase;
+  Event->Data      = Data;
+  Context->Count++;
+
+  return ;
+}
+
+/**
+
+  It will record the start of a CALLEX on the timeline.
+
+  @param  VmPtr - pointer to VM context.
+
+**/
+VOID
+EbcDebuggerStartNativeTimeline (
+  IN VM_CONTEXT *VmPtr
+  )
+{
+  EFI_DEBUGGER_TIMELINE_CONTEXT  *Context;
+
+  Context = &mDebuggerPrivate.TimelineContext;
+  if (!Context->Enabled) {
+    return ;
+  }
+
+  if (Context->NativeDepth < EFI_DEBUGGER_TIMELINE_NATIVE_MAX) {
+    Context->NativeFramePtr[Context->NativeDepth] = VmPtr->FramePtr;
+  }
+  Context->NativeDepth++;
+  EbcDebuggerPushTimeline (EFI_DEBUGGER_TIMELINE_NATIVE, EFI_DEBUGGER_TIMELINE_BEGIN, (UINTN)VmPtr->Ip, 0);
+
+  return ;
+}
+
+/**
+
+  It will record the end of a CALLEX on the timeline. A CALLEX to a thunk
+  is an EBC call that has just started, in which case the native call is
+  replaced with a call to the EBC function.
+
+  @param  VmPtr - pointer to VM context.
+
+**/
+VOID
+EbcDebuggerEndNativeTimeline (
+  IN VM_CONTEXT *VmPtr
+  )
+{
+  EFI_DEBUGGER_TIMELINE_CONTEXT  *Context;
+  EFI_DEBUGGER_TIMELINE_EVENT    *Event;
+  VOID                           *FramePtr;
+
+  Context = &mDebuggerPrivate.TimelineContext;
+  if (!Context->Enabled || (Context->NativeDepth == 0)) {
+    //
+    // The CALLEX started before the recording did
+    //
+    return ;
+  }
+
+  Context->NativeDepth--;
+  FramePtr = VmPtr->FramePtr;
+  if (Context->NativeDepth < EFI_DEBUGGER_TIMELINE_NATIVE_MAX) {
+    FramePtr = Context->NativeFramePtr[Context->NativeDepth];
+  }
+  if (VmPtr->FramePtr == FramePtr) {
+    EbcDebuggerPushTimeline (EFI_DEBUGGER_TIMELINE_NATIVE, EFI_DEBUGGER_TIMELINE_END, (UINTN)VmPtr->Ip, 0);
+    return ;
+  }
+
+  //
+  // Nothing else gets recorded while a thunk redirects a CALLEX, so the
+  // start of the CALLEX is the last event
+  //
+  Event = &Context->Event[(UINTN)(Context->Count - 1) & (EFI_DEBUGGER_TIMELINE_EVENT_MAX - 1)];
+  if ((Event->Type == EFI_DEBUGGER_TIMELINE_NATIVE) && (Event->Phase == EFI_DEBUGGER_TIMELINE_BEGIN)) {
+    Event->Type    = EFI_DEBUGGER_TIMELINE_CALL;
+    Event->Address = (UINTN)VmPtr->Ip;
+  } else {
+    EbcDebuggerPushTimeline (EFI_DEBUGGER_TIMELINE_NATIVE, EFI_DEBUGGER_TIMELINE_END, (UINTN)VmPtr->Ip, 0);
+    EbcDebuggerPushTimeline (EFI_DEBUGGER_TIMELINE_CALL, EFI_DEBUGGER_TIMELINE_BEGIN, (UINTN)VmPtr->Ip, 0);
+  }
+
+  return ;
+}
+
+
 /**
   Notify the callback function when an event is triggered.
 
@@ -308,6 +663,446 @@ EbcDebuggerBreakEventFunc (
   }
 }
 
+/**
+
+  It will find the coverage of the image that contains an address, and
+  allocate it the first time that an instruction of the image is executed.
+
+  @param  Address  - The address of the instruction
+
+  @return The coverage of the image, or NULL if the address is not part of
+          a known image or if the bitmap could not be allocated
+
+**/
+EFI_DEBUGGER_COVERAGE_IMAGE *
+EbcDebuggerFindCoverageImage (
+  IN UINTN                        Address
+  )
+{
+  EFI_DEBUGGER_COVERAGE_CONTEXT  *Context;
+  EFI_DEBUGGER_COVERAGE_IMAGE    *Image;
+  EBC_IMAGE_LIST                 *ImageList;
+
+  Context = &mDebuggerPrivate.CoverageContext;
+
+  ImageList = EbcGetImageList (EbcFindImageHandle (Address), FALSE);
+  if ((ImageList == NULL) || (ImageList->ImageSize == 0)) {
+    return NULL;
+  }
+  for (Image = Context->Image; Image != NULL; Image = Image->Next) {
+    if ((Image->ImageHandle == ImageList->ImageHandle) && (Image->ImageBase == ImageList->ImageBase)) {
+      return Image;
+    }
+  }
+
+  Image = AllocateZeroPool (sizeof (EFI_DEBUGGER_COVERAGE_IMAGE));
+  if (Image == NULL) {
+    return NULL;
+  }
+  Image->Bitmap = AllocateZeroPool (EFI_DEBUGGER_COVERAGE_BITMAP_SIZE (ImageList->ImageSize));
+  if (Image->Bitmap == NULL) {
+    FreePool (Image);
+    return NULL;
+  }
+  Image->ImageHandle = ImageList->ImageHandle;
+  Image->ImageBase   = ImageList->ImageBase;
+  Image->ImageSize   = ImageList->ImageSize;
+  Image->Next        = Context->Image;
+  Context->Image     = Image;
+
+  return Image;
+}
+
+/**
+
+  It will free the coverage of all the images.
+
+**/
+VOID
+EbcDebuggerFreeCoverage (
+  VOID
+  )
+{
+  EFI_DEBUGGER_COVERAGE_CONTEXT  *Context;
+  EFI_DEBUGGER_COVERAGE_IMAGE    *Image;
+
+  Context = &mDebuggerPrivate.CoverageContext;
+
+  Context->Last = NULL;
+  while (Context->Image != NULL) {
+    Image          = Context->Image;
+    Context->Image = Image->Next;
+    FreePool (Image->Bitmap);
+    FreePool (Image);
+  }
+
+  return ;
+}
+
+/**
+
+  It will record that an instruction was executed, in the coverage bitmap
+  of its image.
+
+  @param  Address  - The address of the instruction
+
+**/
+VOID
+EbcDebuggerRecordCoverage (
+  IN UINTN                        Address
+  )
+{
+  EFI_DEBUGGER_COVERAGE_CONTEXT  *Context;
+  EFI_DEBUGGER_COVERAGE_IMAGE    *Image;
+  UINTN                          Unit;
+
+  Context = &mDebuggerPrivate.CoverageContext;
+
+  Image = Context->Last;
+  if ((Image == NULL) || (Address - Image->ImageBase >= Image->ImageSize)) {
+    Image = EbcDebuggerFindCoverageImage (Address);
+    if (Image == NULL) {
+      return ;
+    }
+    Context->Last = Image;
+  }
+
+  Unit = (Address - Image->ImageBase) / EFI_DEBUGGER_COVERAGE_UNIT;
+  Image->Bitmap[Unit / 8] |= (UINT8) (1 << (Unit % 8));
+
+  return ;
+}
+
+/**
+
+  It will free the memory heat map.
+
+**/
+VOID
+EbcDebuggerFreeHeatMap (
+  VOID
+  )
+{
+  mDebuggerPrivate.HeatMapContext.Enabled   = FALSE;
+  mDebuggerPrivate.HeatMapContext.LostCount = 0;
+  if (mDebuggerPrivate.HeatMapContext.Page != NULL) {
+    FreePool (mDebuggerPrivate.HeatMapContext.Page);
+    mDebuggerPrivate.HeatMapContext.Page = NULL;
+  }
+
+  return ;
+}
+
+/**
+
+  It will find the stack depth record of the image that an address is part
+  of, and add one if there is none yet.
+
+  @param  Address  - The address of the entry point
+
+  @return The record of the image, or NULL if the address is not part of
+          a known image or if the record could not be allocated
+
+**/
+EFI_DEBUGGER_STACKDEPTH_IMAGE *
+EbcDebuggerFindStackDepthImage (
+  IN UINTN                        Address
+  )
+{
+  EFI_DEBUGGER_STACKDEPTH_CONTEXT  *Context;
+  EFI_DEBUGGER_STACKDEPTH_IMAGE    *Image;
+  EBC_IMAGE_LIST                   *ImageList;
+
+  Context = &mDebuggerPrivate.StackDepthContext;
+
+  ImageList = EbcGetImageList (EbcFindImageHandle (Address), FALSE);
+  if (ImageList == NULL) {
+    return NULL;
+  }
+  for (Image = Context->Image; Image != NULL; Image = Image->Next) {
+    if ((Image->ImageHandle == ImageList->ImageHandle) && (Image->ImageBase == ImageList->ImageBase)) {
+      return Image;
+    }
+  }
+
+  Image = AllocateZeroPool (sizeof (EFI_DEBUGGER_STACKDEPTH_IMAGE));
+  if (Image == NULL) {
+    return NULL;
+  }
+  Image->ImageHandle = ImageList->ImageHandle;
+  Image->ImageBase   = ImageList->ImageBase;
+  Image->Next        = Context->Image;
+  Context->Image     = Image;
+
+  return Image;
+}
+
+/**
+
+  It will free the stack depth records of all the images.
+
+**/
+VOID
+EbcDebuggerFreeStackDepth (
+  VOID
+  )
+{
+  EFI_DEBUGGER_STACKDEPTH_CONTEXT  *Context;
+  EFI_DEBUGGER_STACKDEPTH_IMAGE    *Image;
+
+  Context = &mDebuggerPrivate.StackDepthContext;
+
+  Context->Enabled    = FALSE;
+  Context->EntryCount = 0;
+  Context->Depth      = 0;
+  while (Context->Image != NULL) {
+    Image          = Context->Image;
+    Context->Image = Image->Next;
+    FreePool (Image);
+  }
+
+  return ;
+}
+
+/**
+
+  It will start tracking the stack of a call into EBC code.
+
+  @param  VmPtr - pointer to VM context.
+
+**/
+VOID
+EbcDebuggerPushStackDepthEntry (
+  IN VM_CONTEXT *VmPtr
+  )
+{
+  EFI_DEBUGGER_STACKDEPTH_CONTEXT  *Context;
+  EFI_DEBUGGER_STACKDEPTH_ENTRY    *Entry;
+
+  Context = &mDebuggerPrivate.StackDepthContext;
+  if (!Context->Enabled) {
+    return ;
+  }
+
+  if (Context->EntryCount++ >= EFI_DEBUGGER_STACKDEPTH_ENTRY_MAX) {
+    return ;
+  }
+  Entry = &Context->Entry[Context->EntryCount - 1];
+  Entry->HighStackBottom = VmPtr->HighStackBottom;
+  Entry->Lowest          = VmPtr->HighStackBottom;
+  Entry->Base            = Context->Depth;
+  Entry->CallExFramePtr  = NULL;
+  Entry->Image           = EbcDebuggerFindStackDepthImage ((UINTN)VmPtr->Ip);
+  if (Entry->Image != NULL) {
+    Entry->Image->Entries++;
+  }
+
+  if (Context->Depth < EFI_DEBUGGER_STACKDEPTH_CALL_MAX) {
+    Context->Call[Context->Depth] = (UINTN)VmPtr->Ip;
+  }
+  Context->Depth++;
+
+  return ;
+}
+
+/**
+
+  It will check the stack pointer of the EBC code that runs against the
+  deepest one of its image, and keep the calls in progress if it is deeper.
+  An entry that started before the tracking did is tracked from there on,
+  and the entries that ended without their last RET are dropped.
+
+  @param  VmPtr - pointer to VM context.
+
+**/
+VOID
+EbcDebuggerCheckStackDepth (
+  IN VM_CONTEXT *VmPtr
+  )
+{
+  EFI_DEBUGGER_STACKDEPTH_CONTEXT  *Context;
+  EFI_DEBUGGER_STACKDEPTH_ENTRY    *Entry;
+  EFI_DEBUGGER_STACKDEPTH_IMAGE    *Image;
+  UINTN                            Used;
+  UINTN                            Depth;
+  UINTN                            First;
+
+  Context = &mDebuggerPrivate.StackDepthContext;
+  if (Context->EntryCount > EFI_DEBUGGER_STACKDEPTH_ENTRY_MAX) {
+    return ;
+  }
+
+  while ((Context->EntryCount != 0) &&
+         (Context->Entry[Context->EntryCount - 1].HighStackBottom != VmPtr->HighStackBottom)) {
+    Context->EntryCount--;
+    Context->Depth = Context->Entry[Context->EntryCount].Base;
+  }
+  if (Context->EntryCount == 0) {
+    EbcDebuggerPushStackDepthEntry (VmPtr);
+  }
+
+  //
+  // This is the only check that runs for every instruction
+  //
+  Entry = &Context->Entry[Context->EntryCount - 1];
+  if ((UINTN)VmPtr->Gpr[0] >= Entry->Lowest) {
+    return ;
+  }
+  Entry->Lowest = (UINTN)VmPtr->Gpr[0];
+
+  Image = Entry->Image;
+  Used  = VmPtr->HighStackBottom - Entry->Lowest;
+  if ((Image == NULL) || (Used <= Image->Peak)) {
+    return ;
+  }
+  Image->Peak        = Used;
+  Image->Available   = VmPtr->HighStackBottom - (UINTN)VmPtr->StackTop;
+  Image->ChainLength = Context->Depth - Entry->Base;
+
+  Depth = Context->Depth;
+  if (Depth > EFI_DEBUGGER_STACKDEPTH_CALL_MAX) {
+    Depth = EFI_DEBUGGER_STACKDEPTH_CALL_MAX;
+  }
+  First = Entry->Base;
+  if (Depth - First > EFI_DEBUGGER_STACKDEPTH_CHAIN_MAX) {
+    First = Depth - EFI_DEBUGGER_STACKDEPTH_CHAIN_MAX;
+  }
+  Image->ChainCount = 0;
+  if (Depth > First) {
+    Image->ChainCount = Depth - First;
+    CopyMem (Image->Chain, &Context->Call[First], Image->ChainCount * sizeof (UINTN));
+  }
+
+  return ;
+}
+
+/**
+
+  It will push an EBC call on the shadow call stack of the stack depth
+  tracker.
+
+  @param  Address  - The address of the callee
+
+**/
+VOID
+EbcDebuggerPushStackDepthCall (
+  IN UINTN                        Address
+  )
+{
+  EFI_DEBUGGER_STACKDEPTH_CONTEXT  *Context;
+  EFI_DEBUGGER_STACKDEPTH_ENTRY    *Entry;
+
+  Context = &mDebuggerPrivate.StackDepthContext;
+  if ((Context->EntryCount == 0) || (Context->EntryCount > EFI_DEBUGGER_STACKDEPTH_ENTRY_MAX)) {
+    return ;
+  }
+
+  if (Context->Depth < EFI_DEBUGGER_STACKDEPTH_CALL_MAX) {
+    Context->Call[Context->Depth] = Address;
+  }
+  Context->Depth++;
+
+  Entry = &Context->Entry[Context->EntryCount - 1];
+  if ((Entry->Image != NULL) && (Context->Depth - Entry->Base - 1 > Entry->Image->MaxDepth)) {
+    Entry->Image->MaxDepth = Context->Depth - Entry->Base - 1;
+  }
+
+  return ;
+}
+
+/**
+
+  It will pop the newest call of the stack depth tracker when a RET runs.
+  The last RET of an EBC entry point or thunk ends the entry.
+
+  @param  VmPtr - pointer to VM context.
+
+**/
+VOID
+EbcDebuggerPopStackDepthCall (
+  IN VM_CONTEXT *VmPtr
+  )
+{
+  EFI_DEBUGGER_STACKDEPTH_CONTEXT  *Context;
+
+  Context = &mDebuggerPrivate.StackDepthContext;
+  if (Context->EntryCount == 0) {
+    return ;
+  }
+
+  if (VmPtr->StackRetAddr == (UINT64) VmPtr->Gpr[0]) {
+    Context->EntryCount--;
+    if (Context->EntryCount < EFI_DEBUGGER_STACKDEPTH_ENTRY_MAX) {
+      Context->Depth = Context->Entry[Context->EntryCount].Base;
+    }
+    return ;
+  }
+
+  //
+  // The calls made before the entry was tracked are not on the stack
+  //
+  if ((Context->EntryCount <= EFI_DEBUGGER_STACKDEPTH_ENTRY_MAX) &&
+      (Context->Depth > Context->Entry[Context->EntryCount - 1].Base + 1)) {
+    Context->Depth--;
+  }
+
+  return ;
+}
+
+/**
+
+  It will keep the frame pointer of a CALLEX for the stack depth tracker.
+
+  @param  VmPtr - pointer to VM context.
+
+**/
+VOID
+EbcDebuggerStartNativeStackDepth (
+  IN VM_CONTEXT *VmPtr
+  )
+{
+  EFI_DEBUGGER_STACKDEPTH_CONTEXT  *Context;
+
+  Context = &mDebuggerPrivate.StackDepthContext;
+  if ((Context->EntryCount == 0) || (Context->EntryCount > EFI_DEBUGGER_STACKDEPTH_ENTRY_MAX)) {
+    return ;
+  }
+
+  Context->Entry[Context->EntryCount - 1].CallExFramePtr = VmPtr->FramePtr;
+
+  return ;
+}
+
+/**
+
+  It will push an EBC call on the stack depth tracker when a CALLEX to a
+  thunk is redirected to the EBC function, which the frame pointer tells.
+
+  @param  VmPtr - pointer to VM context.
+
+**/
+VOID
+EbcDebuggerEndNativeStackDepth (
+  IN VM_CONTEXT *VmPtr
+  )
+{
+  EFI_DEBUGGER_STACKDEPTH_CONTEXT  *Context;
+  EFI_DEBUGGER_STACKDEPTH_ENTRY    *Entry;
+
+  Context = &mDebuggerPrivate.StackDepthContext;
+  if ((Context->EntryCount == 0) || (Context->EntryCount > EFI_DEBUGGER_STACKDEPTH_ENTRY_MAX)) {
+    return ;
+  }
+
+  Entry = &Context->Entry[Context->EntryCount - 1];
+  if ((Entry->CallExFramePtr != NULL) && (VmPtr->FramePtr != Entry->CallExFramePtr)) {
+    EbcDebuggerPushStackDepthCall ((UINTN)VmPtr->Ip);
+  }
+  Entry->CallExFramePtr = NULL;
+
+  return ;
+}
+
 /**
 
   The hook in InitializeEbcDriver.
@@ -329,6 +1124,11 @@ EbcDebuggerHookInit (
   EFI_DEBUGGER_SYMBOL_ENTRY  *Entry;
 
 
+  //
+  // The debugger needs to see every instruction that gets executed
+  //
+  mEbcFastPathEnabled = FALSE;
+
   //
   // Register all exception handler
   //
@@ -364,6 +1164,11 @@ EbcDebuggerHookInit (
     ASSERT (Object[Index].SourceBuffer != NULL);
   }
 
+  //
+  // Init the log buffer, without which the output is not buffered
+  //
+  mDebuggerPrivate.LogContext.Buffer = AllocatePool ((EFI_DEBUGGER_LOG_BUFFER_SIZE + 1) * sizeof(CHAR16));
+
   //
   // locate PciRootBridgeIo
   //
@@ -435,6 +1240,64 @@ EbcDebuggerHookUnload (
     gBS->CloseEvent (mDebuggerPrivate.BreakEvent);
   }
 
+  //
+  // Free the call graph
+  //
+  mDebuggerPrivate.CallGraphContext.Enabled = FALSE;
+  if (mDebuggerPrivate.CallGraphContext.Node != NULL) {
+    gBS->FreePool (mDebuggerPrivate.CallGraphContext.Node);
+    mDebuggerPrivate.CallGraphContext.Node = NULL;
+  }
+
+  //
+  // Free the coverage
+  //
+  EbcDebuggerFreeCoverage ();
+
+  //
+  // Free the memory heat map
+  //
+  EbcDebuggerFreeHeatMap ();
+
+  //
+  // Free the stack depth records
+  //
+  EbcDebuggerFreeStackDepth ();
+
+  //
+  // Write what is left of the output, and close the file it goes to
+  //
+  EdbFlushLog ();
+  if (mDebuggerPrivate.LogContext.Handle != NULL) {
+    mDebuggerPrivate.LogContext.Handle->Close (mDebuggerPrivate.LogContext.Handle);
+    mDebuggerPrivate.LogContext.Handle = NULL;
+  }
+  if (mDebuggerPrivate.LogContext.Buffer != NULL) {
+    gBS->FreePool (mDebuggerPrivate.LogContext.Buffer);
+    mDebuggerPrivate.LogContext.Buffer = NULL;
+  }
+
+  //
+  // Free the timeline
+  //
+  mDebuggerPrivate.TimelineContext.Enabled = FALSE;
+  if (mDebuggerPrivate.TimelineContext.Event != NULL) {
+    gBS->FreePool (mDebuggerPrivate.TimelineContext.Event);
+    mDebuggerPrivate.TimelineContext.Event = NULL;
+  }
+
+  //
+  // Close the profile event
+  //
+  if (mDebuggerPrivate.ProfileContext.Event != NULL) {
+    gBS->CloseEvent (mDebuggerPrivate.ProfileContext.Event);
+    mDebuggerPrivate.ProfileContext.Event = NULL;
+  }
+  if (mDebuggerPrivate.ProfileContext.Entry != NULL) {
+    gBS->FreePool (mDebuggerPrivate.ProfileContext.Entry);
+    mDebuggerPrivate.ProfileContext.Entry = NULL;
+  }
+
   //
   // Clean up the symbol
   //
@@ -473,7 +1336,8 @@ EbcDebuggerHookUnload (
 /**
 
   The hook in EbcUnloadImage.
-  Currently do nothing here.
+  It will keep the coverage of the image, apart from the one of any image
+  that gets loaded at the same address afterwards.
 
   @param  Handle           - The EbcImage handle.
 
@@ -483,6 +1347,21 @@ EbcDebuggerHookEbcUnloadImage (
   IN EFI_HANDLE                  Handle
   )
 {
+  EFI_DEBUGGER_COVERAGE_IMAGE    *Image;
+  EFI_DEBUGGER_STACKDEPTH_IMAGE  *StackImage;
+
+  for (Image = mDebuggerPrivate.CoverageContext.Image; Image != NULL; Image = Image->Next) {
+    if (Image->ImageHandle == Handle) {
+      Image->ImageHandle = NULL;
+    }
+  }
+  mDebuggerPrivate.CoverageContext.Last = NULL;
+  for (StackImage = mDebuggerPrivate.StackDepthContext.Image; StackImage != NULL; StackImage = StackImage->Next) {
+    if (StackImage->ImageHandle == Handle) {
+      StackImage->ImageHandle = NULL;
+    }
+  }
+
   return ;
 }
 
@@ -504,6 +1383,9 @@ EbcDebuggerHookExecuteEbcImageEntryPoint (
   EbcDebuggerPushCallstackSource ((UINT64)(UINTN)-1, EfiDebuggerBranchTypeEbcCall);
   EbcDebuggerPushCallstackParameter ((UINT64)(UINTN)VmPtr->Gpr[0], EfiDebuggerBranchTypeEbcCall);
   EbcDebuggerPushCallstackDest ((UINT64)(UINTN)VmPtr->Ip, EfiDebuggerBranchTypeEbcCall);
+  EbcDebuggerPushCallGraph ((UINTN)VmPtr->Ip, EFI_DEBUGGER_CALLGRAPH_ENTRY, VmPtr->FramePtr);
+  EbcDebuggerPushTimeline (EFI_DEBUGGER_TIMELINE_ENTRY, EFI_DEBUGGER_TIMELINE_BEGIN, (UINTN)VmPtr->Ip, 0);
+  EbcDebuggerPushStackDepthEntry (VmPtr);
   EbcDebuggerCheckHookFlag (VmPtr, EFI_DEBUG_FLAG_EBC_BOE);
   return ;
 }
@@ -525,6 +1407,9 @@ EbcDebuggerHookEbcInterpret (
   EbcDebuggerPushCallstackSource ((UINT64)(UINTN)-2, EfiDebuggerBranchTypeEbcCall);
   EbcDebuggerPushCallstackParameter ((UINT64)(UINTN)VmPtr->Gpr[0], EfiDebuggerBranchTypeEbcCall);
   EbcDebuggerPushCallstackDest ((UINT64)(UINTN)VmPtr->Ip, EfiDebuggerBranchTypeEbcCall);
+  EbcDebuggerPushCallGraph ((UINTN)VmPtr->Ip, EFI_DEBUGGER_CALLGRAPH_ENTRY, VmPtr->FramePtr);
+  EbcDebuggerPushTimeline (EFI_DEBUGGER_TIMELINE_THUNK, EFI_DEBUGGER_TIMELINE_BEGIN, (UINTN)VmPtr->Ip, 0);
+  EbcDebuggerPushStackDepthEntry (VmPtr);
   EbcDebuggerCheckHookFlag (VmPtr, EFI_DEBUG_FLAG_EBC_BOT);
   return ;
 }
@@ -544,6 +1429,29 @@ EbcDebuggerHookExecuteStart (
 {
   EFI_TPL   CurrentTpl;
 
+  //
+  // Record the coverage
+  //
+  if (mDebuggerPrivate.CoverageContext.Enabled) {
+    EbcDebuggerRecordCoverage ((UINTN)VmPtr->Ip);
+  }
+
+  //
+  // Track the stack depth
+  //
+  if (mDebuggerPrivate.StackDepthContext.Enabled) {
+    EbcDebuggerCheckStackDepth (VmPtr);
+  }
+
+  //
+  // Sample the IP on the virtual clock, which the profile timer ignores
+  //
+  if (mEbcVirtualClock && (mDebuggerPrivate.ProfileContext.Event != NULL) &&
+      (mEbcVirtualTime >= mDebuggerPrivate.ProfileContext.NextSample)) {
+    mDebuggerPrivate.ProfileContext.NextSample = mEbcVirtualTime + EFI_DEBUG_PROFILE_VIRTUAL_INTERVAL;
+    EdbProfileSample (VmPtr);
+  }
+
   //
   // Check Ip for GoTil
   //
@@ -672,6 +1580,9 @@ EbcDebuggerHookCALLEnd (
 
   EbcDebuggerPushCallstackDest ((UINT64)(UINTN)VmPtr->Ip, EfiDebuggerBranchTypeEbcCall);
   EbcDebuggerPushTraceDestEntry ((UINT64)(UINTN)VmPtr->Ip, EfiDebuggerBranchTypeEbcCall);
+  EbcDebuggerPushCallGraph ((UINTN)VmPtr->Ip, 0, VmPtr->FramePtr);
+  EbcDebuggerPushTimeline (EFI_DEBUGGER_TIMELINE_CALL, EFI_DEBUGGER_TIMELINE_BEGIN, (UINTN)VmPtr->Ip, 0);
+  EbcDebuggerPushStackDepthCall ((UINTN)VmPtr->Ip);
 
   //
   // Get Old FramePtr
@@ -712,6 +1623,9 @@ EbcDebuggerHookCALLEXStart (
 //  EbcDebuggerPushCallstackSource ((UINT64)(UINTN)VmPtr->Ip, EfiDebuggerBranchTypeEbcCallEx);
 //  EbcDebuggerPushCallstackParameter ((UINT64)(UINTN)VmPtr->R[0], EfiDebuggerBranchTypeEbcCallEx);
   EbcDebuggerPushTraceSourceEntry ((UINT64)(UINTN)VmPtr->Ip, EfiDebuggerBranchTypeEbcCallEx);
+  EbcDebuggerPushCallGraph ((UINTN)VmPtr->Ip, EFI_DEBUGGER_CALLGRAPH_NATIVE, VmPtr->FramePtr);
+  EbcDebuggerStartNativeTimeline (VmPtr);
+  EbcDebuggerStartNativeStackDepth (VmPtr);
   return ;
 }
 
@@ -730,6 +1644,9 @@ EbcDebuggerHookCALLEXEnd (
 {
 //  EbcDebuggerPushCallstackDest ((UINT64)(UINTN)VmPtr->Ip, EfiDebuggerBranchTypeEbcCallEx);
   EbcDebuggerPushTraceDestEntry ((UINT64)(UINTN)VmPtr->Ip, EfiDebuggerBranchTypeEbcCallEx);
+  EbcDebuggerEndNativeCallGraph (VmPtr);
+  EbcDebuggerEndNativeTimeline (VmPtr);
+  EbcDebuggerEndNativeStackDepth (VmPtr);
   return ;
 }
 
@@ -749,6 +1666,9 @@ EbcDebuggerHookRETStart (
 {
   EbcDebuggerCheckHookFlag (VmPtr, EFI_DEBUG_FLAG_EBC_BOR);
   EbcDebuggerPopCallstack ();
+  EbcDebuggerRetCallGraph (VmPtr);
+  EbcDebuggerPushTimeline (EFI_DEBUGGER_TIMELINE_CALL, EFI_DEBUGGER_TIMELINE_END, (UINTN)VmPtr->Ip, 0);
+  EbcDebuggerPopStackDepthCall (VmPtr);
   EbcDebuggerPushTraceSourceEntry ((UINT64)(UINTN)VmPtr->Ip, EfiDebuggerBranchTypeEbcRet);
   return ;
 }
@@ -837,3 +1757,64 @@ EbcDebuggerHookJMP8End (
   EbcDebuggerPushTraceDestEntry ((UINT64)(UINTN)VmPtr->Ip, EfiDebuggerBranchTypeEbcJmp8);
   return ;
 }
+
+/**
+
+  The hook in VmReadMemxx and VmWriteMemxx.
+  It will count the access in the memory heat map.
+
+  @param  VmPtr - pointer to VM context.
+  @param  Addr  - the address that is accessed.
+  @param  Size  - the size of the access, in bytes.
+  @param  Flags - EBC_MEMORY_ACCESS_WRITE and EBC_MEMORY_ACCESS_UNALIGNED.
+
+**/
+VOID
+EbcDebuggerHookMemoryAccess (
+  IN VM_CONTEXT *VmPtr,
+  IN UINTN      Addr,
+  IN UINTN      Size,
+  IN UINT32     Flags
+  )
+{
+  EFI_DEBUGGER_HEATMAP_CONTEXT  *Context;
+  EFI_DEBUGGER_HEATMAP_PAGE     *Page;
+  UINTN                         PageNumber;
+  UINTN                         Index;
+  UINTN                         Probe;
+  UINTN                         SizeIndex;
+
+  Context = &mDebuggerPrivate.HeatMapContext;
+  if (!Context->Enabled || (Context->Page == NULL)) {
+    return ;
+  }
+
+  PageNumber = Addr >> EFI_DEBUGGER_HEATMAP_PAGE_SHIFT;
+  Index      = (PageNumber ^ (PageNumber >> 12)) & (EFI_DEBUGGER_HEATMAP_PAGE_MAX - 1);
+  for (Probe = 0; Probe < EFI_DEBUGGER_HEATMAP_PROBES; Probe++) {
+    Page = &Context->Page[Index];
+    if (Page->Count == 0) {
+      Page->Address = PageNumber << EFI_DEBUGGER_HEATMAP_PAGE_SHIFT;
+    }
+    if (Page->Address == (PageNumber << EFI_DEBUGGER_HEATMAP_PAGE_SHIFT)) {
+      //
+      // 1, 2, 4 and 8 bytes
+      //
+      SizeIndex = (UINTN)HighBitSet32 ((UINT32)Size);
+      if ((Flags & EBC_MEMORY_ACCESS_WRITE) != 0) {
+        Page->Write[SizeIndex]++;
+      } else {
+        Page->Read[SizeIndex]++;
+      }
+      if ((Flags & EBC_MEMORY_ACCESS_UNALIGNED) != 0) {
+        Page->Unaligned++;
+      }
+      Page->Count++;
+      return ;
+    }
+    Index = (Index + 1) & (EFI_DEBUGGER_HEATMAP_PAGE_MAX - 1);
+  }
+  Context->LostCount++;
+
+  return ;
+}
@@ -17,4 +17,72 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Uefi.h>
 #include "EbcDebuggerHook.h"
 
+/**
+
+  Find the node of a call in a call graph table, adding it if needed.
+
+  @param  Table    - The node table, of EFI_DEBUGGER_CALLGRAPH_NODE_MAX entries
+  @param  Parent   - The index of the parent node
+  @param  Address  - The address of the callee
+  @param  Flags    - EFI_DEBUGGER_CALLGRAPH_NATIVE and EFI_DEBUGGER_CALLGRAPH_ENTRY
+
+  @return The index of the node, or 0 if the table is too full to add it
+
+**/
+UINTN
+EbcDebuggerFindCallGraphNode (
+  IN EFI_DEBUGGER_CALLGRAPH_NODE  *Table,
+  IN UINTN                        Parent,
+  IN UINTN                        Address,
+  IN UINT32                       Flags
+  );
+
+/**
+
+  It will free the coverage of all the images.
+
+**/
+VOID
+EbcDebuggerFreeCoverage (
+  VOID
+  );
+
+/**
+
+  It will free the memory heat map.
+
+**/
+VOID
+EbcDebuggerFreeHeatMap (
+  VOID
+  );
+
+/**
+
+  It will free the stack depth records of all the images.
+
+**/
+VOID
+EbcDebuggerFreeStackDepth (
+  VOID
+  );
+
+/**
+
+  It will record an event of the timeline, if the recording is on.
+
+  @param  Type     - EFI_DEBUGGER_TIMELINE_CALL, ENTRY, THUNK, NATIVE or EXCEPTION
+  @param  Phase    - EFI_DEBUGGER_TIMELINE_BEGIN, END or INSTANT
+  @param  Address  - The callee, the CALLEX or RET instruction, or the exception IP
+  @param  Data     - The exception type, or 0
+
+**/
+VOID
+EbcDebuggerPushTimeline (
+  IN UINT8                    Type,
+  IN UINT8                    Phase,
+  IN UINTN                    Address,
+  IN UINT32                   Data
+  );
+
 #endif
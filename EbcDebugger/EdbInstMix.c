@@ -0,0 +1,399 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#include <Uefi.h>
+#ifndef _GNU_EFI
+#include <Library/BaseMemoryLib.h>
+#endif
+#include <Protocol/DebugSupport.h>
+
+#include "EdbInstMix.h"
+
+//
+// What the form bits mean for an opcode
+//
+#define EDB_INSTMIX_CLASS_NONE    0   // no operands, or none that have form bits
+#define EDB_INSTMIX_CLASS_ALU     1   // 64-bit, immediate data, two operands
+#define EDB_INSTMIX_CLASS_UNARY   2   // 64-bit, immediate data, one operand
+#define EDB_INSTMIX_CLASS_MOV     3   // index of operand 1 and 2, two operands
+#define EDB_INSTMIX_CLASS_MOVI    4   // width of the immediate data, one operand
+#define EDB_INSTMIX_CLASS_CMPI    5   // 64-bit, 32-bit immediate data, one operand
+#define EDB_INSTMIX_CLASS_JMP     6   // 64-bit, immediate data, one operand, conditional
+#define EDB_INSTMIX_CLASS_JMP8    7   // conditional, condition set
+#define EDB_INSTMIX_CLASS_NATURAL 8   // immediate data, one operand
+
+typedef struct {
+  CHAR16  *Name;
+  UINT8   Class;
+} EDB_INSTMIX_OPCODE;
+
+EDB_INSTMIX_OPCODE mEdbInstMixOpcodes[EFI_EBC_MIX_OPCODES] = {
+  {L"BREAK",    EDB_INSTMIX_CLASS_NONE},   // opcode 0x00
+  {L"JMP",      EDB_INSTMIX_CLASS_JMP},    // opcode 0x01
+  {L"JMP8",     EDB_INSTMIX_CLASS_JMP8},   // opcode 0x02
+  {L"CALL",     EDB_INSTMIX_CLASS_UNARY},  // opcode 0x03
+  {L"RET",      EDB_INSTMIX_CLASS_NONE},   // opcode 0x04
+  {L"CMPeq",    EDB_INSTMIX_CLASS_ALU},    // opcode 0x05
+  {L"CMPlte",   EDB_INSTMIX_CLASS_ALU},    // opcode 0x06
+  {L"CMPgte",   EDB_INSTMIX_CLASS_ALU},    // opcode 0x07
+  {L"CMPulte",  EDB_INSTMIX_CLASS_ALU},    // opcode 0x08
+  {L"CMPugte",  EDB_INSTMIX_CLASS_ALU},    // opcode 0x09
+  {L"NOT",      EDB_INSTMIX_CLASS_ALU},    // opcode 0x0A
+  {L"NEG",      EDB_INSTMIX_CLASS_ALU},    // opcode 0x0B
+  {L"ADD",      EDB_INSTMIX_CLASS_ALU},    // opcode 0x0C
+  {L"SUB",      EDB_INSTMIX_CLASS_ALU},    // opcode 0x0D
+  {L"MUL",      EDB_INSTMIX_CLASS_ALU},    // opcode 0x0E
+  {L"MULU",     EDB_INSTMIX_CLASS_ALU},    // opcode 0x0F
+  {L"DIV",      EDB_INSTMIX_CLASS_ALU},    // opcode 0x10
+  {L"DIVU",     EDB_INSTMIX_CLASS_ALU},    // opcode 0x11
+  {L"MOD",      EDB_INSTMIX_CLASS_ALU},    // opcode 0x12
+  {L"MODU",     EDB_INSTMIX_CLASS_ALU},    // opcode 0x13
+  {L"AND",      EDB_INSTMIX_CLASS_ALU},    // opcode 0x14
+  {L"OR",       EDB_INSTMIX_CLASS_ALU},    // opcode 0x15
+  {L"XOR",      EDB_INSTMIX_CLASS_ALU},    // opcode 0x16
+  {L"SHL",      EDB_INSTMIX_CLASS_ALU},    // opcode 0x17
+  {L"SHR",      EDB_INSTMIX_CLASS_ALU},    // opcode 0x18
+  {L"ASHR",     EDB_INSTMIX_CLASS_ALU},    // opcode 0x19
+  {L"EXTNDB",   EDB_INSTMIX_CLASS_ALU},    // opcode 0x1A
+  {L"EXTNDW",   EDB_INSTMIX_CLASS_ALU},    // opcode 0x1B
+  {L"EXTNDD",   EDB_INSTMIX_CLASS_ALU},    // opcode 0x1C
+  {L"MOVbw",    EDB_INSTMIX_CLASS_MOV},    // opcode 0x1D
+  {L"MOVww",    EDB_INSTMIX_CLASS_MOV},    // opcode 0x1E
+  {L"MOVdw",    EDB_INSTMIX_CLASS_MOV},    // opcode 0x1F
+  {L"MOVqw",    EDB_INSTMIX_CLASS_MOV},    // opcode 0x20
+  {L"MOVbd",    EDB_INSTMIX_CLASS_MOV},    // opcode 0x21
+  {L"MOVwd",    EDB_INSTMIX_CLASS_MOV},    // opcode 0x22
+  {L"MOVdd",    EDB_INSTMIX_CLASS_MOV},    // opcode 0x23
+  {L"MOVqd",    EDB_INSTMIX_CLASS_MOV},    // opcode 0x24
+  {L"MOVsnw",   EDB_INSTMIX_CLASS_MOV},    // opcode 0x25
+  {L"MOVsnd",   EDB_INSTMIX_CLASS_MOV},    // opcode 0x26
+  {L"?",        EDB_INSTMIX_CLASS_NONE},   // opcode 0x27
+  {L"MOVqq",    EDB_INSTMIX_CLASS_MOV},    // opcode 0x28
+  {L"LOADSP",   EDB_INSTMIX_CLASS_NONE},   // opcode 0x29
+  {L"STORESP",  EDB_INSTMIX_CLASS_NONE},   // opcode 0x2A
+  {L"PUSH",     EDB_INSTMIX_CLASS_UNARY},  // opcode 0x2B
+  {L"POP",      EDB_INSTMIX_CLASS_UNARY},  // opcode 0x2C
+  {L"CMPIeq",   EDB_INSTMIX_CLASS_CMPI},   // opcode 0x2D
+  {L"CMPIlte",  EDB_INSTMIX_CLASS_CMPI},   // opcode 0x2E
+  {L"CMPIgte",  EDB_INSTMIX_CLASS_CMPI},   // opcode 0x2F
+  {L"CMPIulte", EDB_INSTMIX_CLASS_CMPI},   // opcode 0x30
+  {L"CMPIugte", EDB_INSTMIX_CLASS_CMPI},   // opcode 0x31
+  {L"MOVnw",    EDB_INSTMIX_CLASS_MOV},    // opcode 0x32
+  {L"MOVnd",    EDB_INSTMIX_CLASS_MOV},    // opcode 0x33
+  {L"?",        EDB_INSTMIX_CLASS_NONE},   // opcode 0x34
+  {L"PUSHn",    EDB_INSTMIX_CLASS_NATURAL}, // opcode 0x35
+  {L"POPn",     EDB_INSTMIX_CLASS_NATURAL}, // opcode 0x36
+  {L"MOVI",     EDB_INSTMIX_CLASS_MOVI},   // opcode 0x37
+  {L"MOVIn",    EDB_INSTMIX_CLASS_MOVI},   // opcode 0x38
+  {L"MOVrel",   EDB_INSTMIX_CLASS_MOVI},   // opcode 0x39
+  {L"?",        EDB_INSTMIX_CLASS_NONE},   // opcode 0x3A
+  {L"?",        EDB_INSTMIX_CLASS_NONE},   // opcode 0x3B
+  {L"?",        EDB_INSTMIX_CLASS_NONE},   // opcode 0x3C
+  {L"?",        EDB_INSTMIX_CLASS_NONE},   // opcode 0x3D
+  {L"?",        EDB_INSTMIX_CLASS_NONE},   // opcode 0x3E
+  {L"?",        EDB_INSTMIX_CLASS_NONE},   // opcode 0x3F
+};
+
+//
+// Form bits that have a meaning, per class
+//
+UINT8 mEdbInstMixFormMask[] = {
+  0,
+  EFI_EBC_MIX_FORM_BIT6 | EFI_EBC_MIX_FORM_BIT7 | EFI_EBC_MIX_FORM_OP1_INDIRECT | EFI_EBC_MIX_FORM_OP2_INDIRECT,
+  EFI_EBC_MIX_FORM_BIT6 | EFI_EBC_MIX_FORM_BIT7 | EFI_EBC_MIX_FORM_OP1_INDIRECT,
+  EFI_EBC_MIX_FORM_BIT6 | EFI_EBC_MIX_FORM_BIT7 | EFI_EBC_MIX_FORM_OP1_INDIRECT | EFI_EBC_MIX_FORM_OP2_INDIRECT,
+  EFI_EBC_MIX_FORM_BIT6 | EFI_EBC_MIX_FORM_BIT7 | EFI_EBC_MIX_FORM_OP1_INDIRECT,
+  EFI_EBC_MIX_FORM_BIT6 | EFI_EBC_MIX_FORM_BIT7 | EFI_EBC_MIX_FORM_OP1_INDIRECT,
+  EFI_EBC_MIX_FORM_BIT6 | EFI_EBC_MIX_FORM_BIT7 | EFI_EBC_MIX_FORM_OP1_INDIRECT | EFI_EBC_MIX_FORM_OP2_INDIRECT,
+  EFI_EBC_MIX_FORM_BIT6 | EFI_EBC_MIX_FORM_BIT7,
+  EFI_EBC_MIX_FORM_BIT7 | EFI_EBC_MIX_FORM_OP1_INDIRECT,
+};
+
+/**
+
+  Append a string to the name of a form.
+
+  @param  Buffer    - The name, of EDB_INSTMIX_NAME_MAX characters
+  @param  String    - The string to append
+
+**/
+VOID
+EdbInstMixAppend (
+  IN OUT CHAR16  *Buffer,
+  IN     CHAR16  *String
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Buffer[Index] != 0; Index++) {
+    ;
+  }
+  while ((*String != 0) && (Index < EDB_INSTMIX_NAME_MAX - 1)) {
+    Buffer[Index++] = *String++;
+  }
+  Buffer[Index] = 0;
+}
+
+/**
+
+  Get the name of an opcode.
+
+  @param  Opcode    - The opcode, without its modifier bits
+
+  @return The name, or "?" if the opcode is not defined
+
+**/
+CHAR16 *
+EdbInstMixOpcodeName (
+  IN UINTN  Opcode
+  )
+{
+  if (Opcode >= EFI_EBC_MIX_OPCODES) {
+    return L"?";
+  }
+  return mEdbInstMixOpcodes[Opcode].Name;
+}
+
+/**
+
+  Get the name of an instruction form, as the name of the opcode followed
+  by what the form bits mean for it.
+
+  @param  Opcode    - The opcode, without its modifier bits
+  @param  Form      - The form, of the EFI_EBC_MIX_FORM_xxx bits
+  @param  Buffer    - The buffer that receives the name, of EDB_INSTMIX_NAME_MAX characters
+
+**/
+VOID
+EdbInstMixFormName (
+  IN  UINTN   Opcode,
+  IN  UINTN   Form,
+  OUT CHAR16  *Buffer
+  )
+{
+  UINT8  Class;
+
+  Buffer[0] = 0;
+  EdbInstMixAppend (Buffer, EdbInstMixOpcodeName (Opcode));
+  if (Opcode >= EFI_EBC_MIX_OPCODES) {
+    return;
+  }
+  Class = mEdbInstMixOpcodes[Opcode].Class;
+
+  switch (Class) {
+  case EDB_INSTMIX_CLASS_ALU:
+  case EDB_INSTMIX_CLASS_UNARY:
+  case EDB_INSTMIX_CLASS_JMP:
+    EdbInstMixAppend (Buffer, ((Form & EFI_EBC_MIX_FORM_BIT6) != 0) ? L"64" : L"32");
+    break;
+  case EDB_INSTMIX_CLASS_CMPI:
+    EdbInstMixAppend (Buffer, ((Form & EFI_EBC_MIX_FORM_BIT6) != 0) ? L"64" : L"32");
+    EdbInstMixAppend (Buffer, ((Form & EFI_EBC_MIX_FORM_BIT7) != 0) ? L"d" : L"w");
+    break;
+  case EDB_INSTMIX_CLASS_MOVI:
+    switch (Form & (EFI_EBC_MIX_FORM_BIT6 | EFI_EBC_MIX_FORM_BIT7)) {
+    case EFI_EBC_MIX_FORM_BIT6:
+      EdbInstMixAppend (Buffer, L"w");
+      break;
+    case EFI_EBC_MIX_FORM_BIT7:
+      EdbInstMixAppend (Buffer, L"d");
+      break;
+    case EFI_EBC_MIX_FORM_BIT6 | EFI_EBC_MIX_FORM_BIT7:
+      EdbInstMixAppend (Buffer, L"q");
+      break;
+    }
+    break;
+  case EDB_INSTMIX_CLASS_JMP8:
+    if ((Form & EFI_EBC_MIX_FORM_BIT7) != 0) {
+      EdbInstMixAppend (Buffer, ((Form & EFI_EBC_MIX_FORM_BIT6) != 0) ? L"cs" : L"cc");
+    }
+    return;
+  case EDB_INSTMIX_CLASS_MOV:
+  case EDB_INSTMIX_CLASS_NATURAL:
+    break;
+  default:
+    return;
+  }
+
+  //
+  // Operands: indirect, then immediate data or index
+  //
+  EdbInstMixAppend (Buffer, ((Form & EFI_EBC_MIX_FORM_OP1_INDIRECT) != 0) ? L" @R" : L" R");
+  if ((Class == EDB_INSTMIX_CLASS_MOV) && ((Form & EFI_EBC_MIX_FORM_BIT7) != 0)) {
+    EdbInstMixAppend (Buffer, L"(idx)");
+  }
+  if (Class == EDB_INSTMIX_CLASS_JMP) {
+    if ((Form & EFI_EBC_MIX_FORM_OP2_INDIRECT) != 0) {
+      EdbInstMixAppend (Buffer, L" cond");
+    }
+  } else if ((Class == EDB_INSTMIX_CLASS_ALU) || (Class == EDB_INSTMIX_CLASS_MOV)) {
+    EdbInstMixAppend (Buffer, ((Form & EFI_EBC_MIX_FORM_OP2_INDIRECT) != 0) ? L", @R" : L", R");
+  }
+  if ((Class == EDB_INSTMIX_CLASS_MOV) && ((Form & EFI_EBC_MIX_FORM_BIT6) != 0)) {
+    EdbInstMixAppend (Buffer, L"(idx)");
+  }
+  if ((Class != EDB_INSTMIX_CLASS_MOV) && (Class != EDB_INSTMIX_CLASS_MOVI) &&
+      (Class != EDB_INSTMIX_CLASS_CMPI) && ((Form & EFI_EBC_MIX_FORM_BIT7) != 0)) {
+    EdbInstMixAppend (Buffer, L" imm");
+  }
+  if ((Class == EDB_INSTMIX_CLASS_MOVI) || (Class == EDB_INSTMIX_CLASS_CMPI)) {
+    EdbInstMixAppend (Buffer, L", imm");
+  }
+}
+
+/**
+
+  Get the number of instructions in an instruction mix.
+
+  @param  Mix       - The instruction mix
+
+  @return The number of instructions
+
+**/
+UINT64
+EdbInstMixTotal (
+  IN EFI_EBC_INSTRUCTION_MIX  *Mix
+  )
+{
+  UINT64  Total;
+  UINTN   Opcode;
+  UINTN   Form;
+
+  Total = 0;
+  for (Opcode = 0; Opcode < EFI_EBC_MIX_OPCODES; Opcode++) {
+    for (Form = 0; Form < EFI_EBC_MIX_FORMS; Form++) {
+      Total += Mix->Forms[Opcode][Form];
+    }
+  }
+  return Total;
+}
+
+/**
+
+  Insert a row in a list of rows in decreasing order, if it belongs there.
+
+  @param  Rows      - The rows
+  @param  Used      - The number of rows in use, updated on return
+  @param  Count     - The number of rows
+  @param  Opcode    - The opcode of the row
+  @param  Next      - The form or the next opcode of the row
+  @param  Value     - The count of the row
+
+**/
+VOID
+EdbInstMixInsert (
+  IN OUT EDB_INSTMIX_ROW  *Rows,
+  IN OUT UINTN            *Used,
+  IN     UINTN            Count,
+  IN     UINTN            Opcode,
+  IN     UINTN            Next,
+  IN     UINT64           Value
+  )
+{
+  UINTN  Index;
+
+  if ((Value == 0) || (Count == 0)) {
+    return;
+  }
+  Index = *Used;
+  if (Index == Count) {
+    if (Rows[Count - 1].Count >= Value) {
+      return;
+    }
+    Index--;
+  } else {
+    (*Used)++;
+  }
+  //
+  // Rows with the same count stay in the order they were found
+  //
+  while ((Index > 0) && (Rows[Index - 1].Count < Value)) {
+    CopyMem (&Rows[Index], &Rows[Index - 1], sizeof (EDB_INSTMIX_ROW));
+    Index--;
+  }
+  Rows[Index].Opcode = (UINT8) Opcode;
+  Rows[Index].Next   = (UINT8) Next;
+  Rows[Index].Count  = Value;
+}
+
+/**
+
+  Get the most executed instruction forms of an instruction mix. The form
+  bits that have no meaning for an opcode are ignored.
+
+  @param  Mix       - The instruction mix
+  @param  Rows      - The rows that receive the forms, in decreasing order
+  @param  Count     - The number of rows
+
+  @return The number of rows that were filled
+
+**/
+UINTN
+EdbInstMixTopForms (
+  IN  EFI_EBC_INSTRUCTION_MIX  *Mix,
+  OUT EDB_INSTMIX_ROW          *Rows,
+  IN  UINTN                    Count
+  )
+{
+  UINT64  Forms[EFI_EBC_MIX_FORMS];
+  UINTN   Used;
+  UINTN   Opcode;
+  UINTN   Form;
+  UINT8   Mask;
+
+  Used = 0;
+  for (Opcode = 0; Opcode < EFI_EBC_MIX_OPCODES; Opcode++) {
+    Mask = mEdbInstMixFormMask[mEdbInstMixOpcodes[Opcode].Class];
+    ZeroMem (Forms, sizeof (Forms));
+    for (Form = 0; Form < EFI_EBC_MIX_FORMS; Form++) {
+      Forms[Form & Mask] += Mix->Forms[Opcode][Form];
+    }
+    for (Form = 0; Form < EFI_EBC_MIX_FORMS; Form++) {
+      EdbInstMixInsert (Rows, &Used, Count, Opcode, Form, Forms[Form]);
+    }
+  }
+  return Used;
+}
+
+/**
+
+  Get the most executed pairs of consecutive opcodes of an instruction mix,
+  which are the candidates for superinstructions.
+
+  @param  Mix       - The instruction mix
+  @param  Rows      - The rows that receive the pairs, in decreasing order
+  @param  Count     - The number of rows
+
+  @return The number of rows that were filled
+
+**/
+UINTN
+EdbInstMixTopPairs (
+  IN  EFI_EBC_INSTRUCTION_MIX  *Mix,
+  OUT EDB_INSTMIX_ROW          *Rows,
+  IN  UINTN                    Count
+  )
+{
+  UINTN  Used;
+  UINTN  Opcode;
+  UINTN  Next;
+
+  Used = 0;
+  for (Opcode = 0; Opcode < EFI_EBC_MIX_OPCODES; Opcode++) {
+    for (Next = 0; Next < EFI_EBC_MIX_OPCODES; Next++) {
+      EdbInstMixInsert (Rows, &Used, Count, Opcode, Next, Mix->Pairs[Opcode][Next]);
+    }
+  }
+  return Used;
+}
@@ -0,0 +1,115 @@
+/** @file
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+
+**/
+
+#ifndef _EFI_EDB_INSTMIX_H_
+#define _EFI_EDB_INSTMIX_H_
+
+#include <Uefi.h>
+#include "EbcPerformance.h"
+
+//
+// Size of the buffer that receives the name of a form, in characters
+//
+#define EDB_INSTMIX_NAME_MAX  32
+
+typedef struct {
+  UINT8   Opcode;
+  UINT8   Next;         ///< the form, or the next opcode of a pair
+  UINT64  Count;
+} EDB_INSTMIX_ROW;
+
+/**
+
+  Get the name of an opcode.
+
+  @param  Opcode    - The opcode, without its modifier bits
+
+  @return The name, or "?" if the opcode is not defined
+
+**/
+CHAR16 *
+EdbInstMixOpcodeName (
+  IN UINTN  Opcode
+  );
+
+/**
+
+  Get the name of an instruction form, as the name of the opcode followed
+  by what the form bits mean for it.
+
+  @param  Opcode    - The opcode, without its modifier bits
+  @param  Form      - The form, of the EFI_EBC_MIX_FORM_xxx bits
+  @param  Buffer    - The buffer that receives the name, of EDB_INSTMIX_NAME_MAX characters
+
+**/
+VOID
+EdbInstMixFormName (
+  IN  UINTN   Opcode,
+  IN  UINTN   Form,
+  OUT CHAR16  *Buffer
+  );
+
+/**
+
+  Get the number of instructions in an instruction mix.
+
+  @param  Mix       - The instruction mix
+
+  @return The number of instructions
+
+**/
+UINT64
+EdbInstMixTotal (
+  IN EFI_EBC_INSTRUCTION_MIX  *Mix
+  );
+
+/**
+
+  Get the most executed instruction forms of an instruction mix. The form
+  bits that have no meaning for an opcode are ignored.
+
+  @param  Mix       - The instruction mix
+  @param  Rows      - The rows that receive the forms, in decreasing order
+  @param  Count     - The number of rows
+
+  @return The number of rows that were filled
+
+**/
+UINTN
+EdbInstMixTopForms (
+  IN  EFI_EBC_INSTRUCTION_MIX  *Mix,
+  OUT EDB_INSTMIX_ROW          *Rows,
+  IN  UINTN                    Count
+  );
+
+/**
+
+  Get the most executed pairs of consecutive opcodes of an instruction mix,
+  which are the candidates for superinstructions.
+
+  @param  Mix       - The instruction mix
+  @param  Rows      - The rows that receive the pairs, in decreasing order
+  @param  Count     - The number of rows
+
+  @return The number of rows that were filled
+
+**/
+UINTN
+EdbInstMixTopPairs (
+  IN  EFI_EBC_INSTRUCTION_MIX  *Mix,
+  OUT EDB_INSTMIX_ROW          *Rows,
+  IN  UINTN                    Count
+  );
+
+#endif
@@ -379,6 +379,30 @@ SetPageBreak (
   VOID
   );
 
+/**
+  Add a string to the debugger output, which goes to the console or to the
+  file that it is redirected to, through the log buffer.
+
+  @param  String    A Null-terminated Unicode string.
+
+**/
+VOID
+EFIAPI
+EdbWriteLog (
+  IN CONST CHAR16  *String
+  );
+
+/**
+  Write the log buffer to the console or to the file that the output is
+  redirected to.
+
+**/
+VOID
+EFIAPI
+EdbFlushLog (
+  VOID
+  );
+
 /**
   Print a Unicode string to the output device.
 
@@ -465,6 +489,47 @@ ReadFileToBuffer (
   IN  BOOLEAN                     ScanFs
   );
 
+/**
+
+  Create a file, or truncate it if it already exists.
+  It will use DebuggerPrivate->Vol, or the first FS if there is none.
+
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  FileName        - The file to be created.
+  @param  Handle          - The handle of the file, open for writing
+
+  @retval EFI_SUCCESS    - create file successfully
+  @retval Others         - the file could not be created
+
+**/
+EFI_STATUS
+EFIAPI
+CreateFileOnVol (
+  IN  EFI_DEBUGGER_PRIVATE_DATA   *DebuggerPrivate,
+  IN  CHAR16                      *FileName,
+  OUT EFI_FILE_HANDLE             *Handle
+  );
+
+/**
+
+  Print a formatted line to a file, as ASCII.
+
+  @param  Handle          - The file handle, open for writing
+  @param  Format          - A Null-terminated Unicode format string.
+  @param  ...             - The variable argument list
+
+  @retval EFI_SUCCESS    - write file successfully
+  @retval Others         - the file could not be written
+
+**/
+EFI_STATUS
+EFIAPI
+WriteFilePrint (
+  IN EFI_FILE_HANDLE              Handle,
+  IN CONST CHAR16                 *Format,
+  ...
+  );
+
 /**
 
   Get file name under this dir with index
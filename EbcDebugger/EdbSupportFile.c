@@ -388,3 +388,121 @@ GetFileNameUnderDir (
 
   return TempName;
 }
+
+/**
+
+  Create a file, or truncate it if it already exists.
+  It will use DebuggerPrivate->Vol, or the first FS if there is none.
+
+  @param  DebuggerPrivate - EBC Debugger private data structure
+  @param  FileName        - The file to be created.
+  @param  Handle          - The handle of the file, open for writing
+
+  @retval EFI_SUCCESS    - create file successfully
+  @retval Others         - the file could not be created
+
+**/
+EFI_STATUS
+EFIAPI
+CreateFileOnVol (
+  IN  EFI_DEBUGGER_PRIVATE_DATA   *DebuggerPrivate,
+  IN  CHAR16                      *FileName,
+  OUT EFI_FILE_HANDLE             *Handle
+  )
+{
+  EFI_STATUS                        Status;
+  EFI_FILE_HANDLE                   RootDir;
+  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL   *Vol;
+
+  if ((FileName == NULL) || (Handle == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (DebuggerPrivate->Vol == NULL) {
+    Status = gBS->LocateProtocol (
+                    &gEfiSimpleFileSystemProtocolGuid,
+                    NULL,
+                    (VOID**) &DebuggerPrivate->Vol
+                    );
+    if (EFI_ERROR(Status)) {
+      return Status;
+    }
+  }
+  Vol = DebuggerPrivate->Vol;
+
+  //
+  // Open the root directory
+  //
+  Status = Vol->OpenVolume (Vol, &RootDir);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Delete the file if it exists, as opening it does not truncate it
+  //
+  Status = RootDir->Open (
+                      RootDir,
+                      Handle,
+                      FileName,
+                      EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE,
+                      0
+                      );
+  if (!EFI_ERROR (Status)) {
+    (*Handle)->Delete (*Handle);
+  }
+
+  //
+  // Create the file
+  //
+  Status = RootDir->Open (
+                      RootDir,
+                      Handle,
+                      FileName,
+                      EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE,
+                      0
+                      );
+  RootDir->Close (RootDir);
+
+  return Status;
+}
+
+/**
+
+  Print a formatted line to a file, as ASCII.
+
+  @param  Handle          - The file handle, open for writing
+  @param  Format          - A Null-terminated Unicode format string.
+  @param  ...             - The variable argument list
+
+  @retval EFI_SUCCESS    - write file successfully
+  @retval Others         - the file could not be written
+
+**/
+EFI_STATUS
+EFIAPI
+WriteFilePrint (
+  IN EFI_FILE_HANDLE              Handle,
+  IN CONST CHAR16                 *Format,
+  ...
+  )
+{
+  VA_LIST Marker;
+  CHAR16  Buffer[EFI_DEBUG_MAX_PRINT_BUFFER];
+  CHAR8   AsciiBuffer[EFI_DEBUG_MAX_PRINT_BUFFER];
+  UINTN   Length;
+  UINTN   Index;
+
+  VA_START (Marker, Format);
+  Length = UnicodeVSPrint (Buffer, sizeof (Buffer), Format, Marker);
+  VA_END (Marker);
+
+  //
+  // Symbol names and numbers are all ASCII
+  //
+  for (Index = 0; Index < Length; Index++) {
+    AsciiBuffer[Index] = (CHAR8) Buffer[Index];
+  }
+
+  return Handle->Write (Handle, &Length, AsciiBuffer);
+}
@@ -226,6 +226,11 @@ Input (
   ASSERT (ConIn != NULL);
   ASSERT (InStr != NULL);
 
+  //
+  // What was printed goes out before the prompt, and the line being edited
+  // is echoed to the console, whatever the output is redirected to
+  //
+  EdbFlushLog ();
   if (Prompt != NULL) {
     ConOut->OutputString (ConOut, Prompt);
   }
@@ -420,7 +425,7 @@ Input (
         for (SubIndex = 0; SubIndex < EFI_DEBUG_INPUS_BUFFER_SIZE - (StartColumn - EFI_DEBUG_PROMPT_COLUMN); SubIndex++) {
           mBackupSpace[SubIndex] = L' ';
         }
-        EDBPrint (mBackupSpace);
+        ConOut->OutputString (ConOut, mBackupSpace);
         SetMem (mBackupSpace, (EFI_DEBUG_INPUS_BUFFER_SIZE - (StartColumn - EFI_DEBUG_PROMPT_COLUMN)) * sizeof(CHAR16), 0);
 
         ConOut->SetCursorPosition (ConOut, StartColumn, Row);
@@ -461,12 +466,12 @@ Input (
         for (SubIndex = 0; SubIndex < EFI_DEBUG_INPUS_BUFFER_SIZE - (Column - EFI_DEBUG_PROMPT_COLUMN); SubIndex++) {
           mBackupSpace[SubIndex] = L' ';
         }
-        EDBPrint (mBackupSpace);
+        ConOut->OutputString (ConOut, mBackupSpace);
         SetMem (mBackupSpace, (EFI_DEBUG_INPUS_BUFFER_SIZE - (Column - EFI_DEBUG_PROMPT_COLUMN)) * sizeof(CHAR16), 0);
         ConOut->SetCursorPosition (ConOut, Column, Row);
         NeedAdjust = FALSE;
       }
-      EDBPrint (InStr + Update);
+      ConOut->OutputString (ConOut, InStr + Update);
       Len = StrLen (InStr);
 
       if (Delete != 0) {
@@ -578,7 +583,7 @@ SetCursorPosition (
     *(Str + StrPos + Column * Row)  = 0;
   }
 
-  EDBPrint (L"%s", Str + StrPos);
+  ConOut->OutputString (ConOut, Str + StrPos);
   if (Len - StrPos > Column * Row) {
     *(Str + StrPos + Column * Row) = Backup;
   }
@@ -607,6 +612,13 @@ SetPageBreak (
   if (!mDebuggerPrivate.EnablePageBreak) {
     return FALSE;
   }
+  //
+  // Nobody reads a file page by page
+  //
+  if (mDebuggerPrivate.LogContext.Handle != NULL) {
+    return FALSE;
+  }
+  EdbFlushLog ();
 
   gST->ConOut->OutputString (gST->ConOut, L"Press ENTER to continue, 'q' to exit:");
 
@@ -660,6 +672,79 @@ SetPageBreak (
   return OmitPrint;
 }
 
+/**
+  Write the log buffer to the console or to the file that the output is
+  redirected to. The buffer is converted to ASCII in place for the file,
+  as the names and numbers the debugger prints are all ASCII.
+
+**/
+VOID
+EFIAPI
+EdbFlushLog (
+  VOID
+  )
+{
+  EFI_DEBUGGER_LOG_CONTEXT  *LogContext;
+  CHAR8                     *Ascii;
+  UINTN                     Size;
+  UINTN                     Index;
+
+  LogContext = &mDebuggerPrivate.LogContext;
+  if (LogContext->Length == 0) {
+    return ;
+  }
+
+  if (LogContext->Handle == NULL) {
+    LogContext->Buffer[LogContext->Length] = 0;
+    if (gST->ConOut != NULL) {
+      gST->ConOut->OutputString (gST->ConOut, LogContext->Buffer);
+    }
+  } else {
+    Ascii = (CHAR8 *) LogContext->Buffer;
+    for (Index = 0; Index < LogContext->Length; Index++) {
+      Ascii[Index] = (LogContext->Buffer[Index] < 0x80) ? (CHAR8) LogContext->Buffer[Index] : '?';
+    }
+    Size = LogContext->Length;
+    LogContext->Status   = LogContext->Handle->Write (LogContext->Handle, &Size, Ascii);
+    LogContext->Written += Size;
+  }
+  LogContext->Length = 0;
+}
+
+/**
+  Add a string to the debugger output, which goes to the console or to the
+  file that it is redirected to, through the log buffer.
+
+  @param  String    A Null-terminated Unicode string.
+
+**/
+VOID
+EFIAPI
+EdbWriteLog (
+  IN CONST CHAR16  *String
+  )
+{
+  EFI_DEBUGGER_LOG_CONTEXT  *LogContext;
+
+  LogContext = &mDebuggerPrivate.LogContext;
+  if (LogContext->Buffer == NULL) {
+    //
+    // To be extra safe make sure ConOut has been initialized
+    //
+    if (gST->ConOut != NULL) {
+      gST->ConOut->OutputString (gST->ConOut, (CHAR16 *) String);
+    }
+    return ;
+  }
+
+  for (; *String != 0; String++) {
+    if (LogContext->Length == EFI_DEBUGGER_LOG_BUFFER_SIZE) {
+      EdbFlushLog ();
+    }
+    LogContext->Buffer[LogContext->Length++] = *String;
+  }
+}
+
 /**
   Print a Unicode string to the output device.
 
@@ -683,12 +768,7 @@ EDBPrint (
   Return = UnicodeVSPrint (Buffer, sizeof (Buffer), Format, Marker);
   VA_END (Marker);
 
-  if (gST->ConOut != NULL) {
-    //
-    // To be extra safe make sure ConOut has been initialized
-    //
-    gST->ConOut->OutputString (gST->ConOut, Buffer);
-  }
+  EdbWriteLog (Buffer);
 
   return Return;
 }
@@ -327,6 +327,7 @@ EdbLoadSymbolEntryByIec (
         // Else it should be Object.
         // let it bypass here
         //
+        // fall through
       case  EdbEbcSymbolParseStateReadyForObject:
         switch (Type) {
         case EfiDebuggerSymbolTypeMax:
@@ -271,3 +271,24 @@ EbcDebuggerHookJMP8End (
 {
   return;
 }
+
+/**
+
+  The hook in VmReadMemxx and VmWriteMemxx.
+
+  @param  VmPtr - pointer to VM context.
+  @param  Addr  - the address that is accessed.
+  @param  Size  - the size of the access, in bytes.
+  @param  Flags - EBC_MEMORY_ACCESS_WRITE and EBC_MEMORY_ACCESS_UNALIGNED.
+
+**/
+VOID
+EbcDebuggerHookMemoryAccess (
+  IN VM_CONTEXT *VmPtr,
+  IN UINTN      Addr,
+  IN UINTN      Size,
+  IN UINT32     Flags
+  )
+{
+  return;
+}
@@ -244,4 +244,29 @@ EbcDebuggerHookJMP8End (
   IN VM_CONTEXT *VmPtr
   );
 
+//
+// Flags of EbcDebuggerHookMemoryAccess()
+//
+#define EBC_MEMORY_ACCESS_WRITE      0x1
+#define EBC_MEMORY_ACCESS_UNALIGNED  0x2
+
+/**
+
+  The hook in VmReadMemxx and VmWriteMemxx, which is only called when the
+  interpreter is built with EBC_MEMORY_ACCESS_HOOK.
+
+  @param  VmPtr - pointer to VM context.
+  @param  Addr  - the address that is accessed.
+  @param  Size  - the size of the access, in bytes.
+  @param  Flags - EBC_MEMORY_ACCESS_WRITE and EBC_MEMORY_ACCESS_UNALIGNED.
+
+**/
+VOID
+EbcDebuggerHookMemoryAccess (
+  IN VM_CONTEXT *VmPtr,
+  IN UINTN      Addr,
+  IN UINTN      Size,
+  IN UINT32     Flags
+  );
+
 #endif
@@ -28,6 +28,11 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #define DATA_SIZE_64      8
 #define DATA_SIZE_N       48  // 4 or 8
 //
+// Number of bytes of the stack guard region, starting from the stack top,
+// that are checked at each CALL and RET. The whole region is checked on exit.
+//
+#define STACK_GUARD_CHECK_SIZE  64
+//
 // Structure we'll use to dispatch opcodes to execute functions.
 //
 typedef struct {
@@ -35,83 +40,6 @@ typedef struct {
 }
 VM_TABLE_ENTRY;
 
-typedef
-UINT64
-(*DATA_MANIP_EXEC_FUNCTION) (
-  IN VM_CONTEXT * VmPtr,
-  IN UINT64     Op1,
-  IN UINT64     Op2
-  );
-
-/**
-  Decode a 16-bit index to determine the offset. Given an index value:
-
-    b15     - sign bit
-    b14:12  - number of bits in this index assigned to natural units (=a)
-    ba:11   - constant units = ConstUnits
-    b0:a    - natural units = NaturalUnits
-
-  Given this info, the offset can be computed by:
-    offset = sign_bit * (ConstUnits + NaturalUnits * sizeof(UINTN))
-
-  Max offset is achieved with index = 0x7FFF giving an offset of
-  0x27B (32-bit machine) or 0x477 (64-bit machine).
-  Min offset is achieved with index =
-
-  @param  VmPtr             A pointer to VM context.
-  @param  CodeOffset        Offset from IP of the location of the 16-bit index
-                            to decode.
-  @param  IndexPtr          An optional pointer where the decoded index pair
-                            values can be written.
-
-  @return The decoded offset.
-
-**/
-INT16
-VmReadIndex16 (
-  IN VM_CONTEXT     *VmPtr,
-  IN UINT32         CodeOffset,
-  OUT EBC_INDEX     *IndexPtr OPTIONAL
-  );
-
-/**
-  Decode a 32-bit index to determine the offset.
-
-  @param  VmPtr             A pointer to VM context.
-  @param  CodeOffset        Offset from IP of the location of the 32-bit index
-                            to decode.
-  @param  IndexPtr          An optional pointer where the decoded index pair
-                            values can be written.
-
-  @return Converted index per EBC VM specification.
-
-**/
-INT32
-VmReadIndex32 (
-  IN VM_CONTEXT     *VmPtr,
-  IN UINT32         CodeOffset,
-  OUT EBC_INDEX     *IndexPtr OPTIONAL
-  );
-
-/**
-  Decode a 64-bit index to determine the offset.
-
-  @param  VmPtr             A pointer to VM context.s
-  @param  CodeOffset        Offset from IP of the location of the 64-bit index
-                            to decode.
-  @param  IndexPtr          An optional pointer where the decoded index pair
-                            values can be written.
-
-  @return Converted index per EBC VM specification
-
-**/
-INT64
-VmReadIndex64 (
-  IN VM_CONTEXT     *VmPtr,
-  IN UINT32         CodeOffset,
-  OUT EBC_INDEX     *IndexPtr OPTIONAL
-  );
-
 /**
   Update the stack tracker according to the latest natural and constant
   value stack manipulation operations.
@@ -154,168 +82,50 @@ UpdateStackTrackerFromDelta (
   );
 
 /**
-  Reads 8-bit data form the memory address.
-
-  @param  VmPtr             A pointer to VM context.
-  @param  Addr              The memory address.
-
-  @return The 8-bit value from the memory address.
-
-**/
-UINT8
-VmReadMem8 (
-  IN VM_CONTEXT   *VmPtr,
-  IN UINTN        Addr
-  );
-
-/**
-  Reads 16-bit data form the memory address.
-
-  @param  VmPtr             A pointer to VM context.
-  @param  Addr              The memory address.
-
-  @return The 16-bit value from the memory address.
-
-**/
-UINT16
-VmReadMem16 (
-  IN VM_CONTEXT *VmPtr,
-  IN UINTN      Addr
-  );
-
-/**
-  Reads 32-bit data form the memory address.
-
-  @param  VmPtr             A pointer to VM context.
-  @param  Addr              The memory address.
-
-  @return The 32-bit value from the memory address.
-
-**/
-UINT32
-VmReadMem32 (
-  IN VM_CONTEXT *VmPtr,
-  IN UINTN      Addr
-  );
-
-/**
-  Reads 64-bit data form the memory address.
-
-  @param  VmPtr             A pointer to VM context.
-  @param  Addr              The memory address.
-
-  @return The 64-bit value from the memory address.
-
-**/
-UINT64
-VmReadMem64 (
-  IN VM_CONTEXT   *VmPtr,
-  IN UINTN        Addr
-  );
-
-/**
-  Read a natural value from memory. May or may not be aligned.
-
-  @param  VmPtr             current VM context
-  @param  Addr              the address to read from
-
-  @return The natural value at address Addr.
-
-**/
-UINTN
-VmReadMemN (
-  IN VM_CONTEXT    *VmPtr,
-  IN UINTN         Addr
-  );
-
-/**
-  Writes 8-bit data to memory address.
-
-  This routine is called by the EBC data
-  movement instructions that write to memory. Since these writes
-  may be to the stack, which looks like (high address on top) this,
-
-  [EBC entry point arguments]
-  [VM stack]
-  [EBC stack]
-
-  we need to detect all attempts to write to the EBC entry point argument
-  stack area and adjust the address (which will initially point into the
-  VM stack) to point into the EBC entry point arguments.
+  Check the VM stack pointer against the top of the stack guard region, and
+  signal a stack fault if it went past it. This is called by the instructions
+  that modify R0, rather than after every instruction.
 
   @param  VmPtr             A pointer to a VM context.
-  @param  Addr              Address to write to.
-  @param  Data              Value to write to Addr.
-
-  @retval EFI_SUCCESS       The instruction is executed successfully.
-  @retval Other             Some error occurs when writing data to the address.
 
 **/
-EFI_STATUS
-VmWriteMem8 (
-  IN VM_CONTEXT    *VmPtr,
-  IN UINTN         Addr,
-  IN UINT8         Data
+VOID
+VmCheckStackLimit (
+  IN VM_CONTEXT *VmPtr
   );
 
 /**
-  Writes 16-bit data to memory address.
-
-  This routine is called by the EBC data
-  movement instructions that write to memory. Since these writes
-  may be to the stack, which looks like (high address on top) this,
-
-  [EBC entry point arguments]
-  [VM stack]
-  [EBC stack]
-
-  we need to detect all attempts to write to the EBC entry point argument
-  stack area and adjust the address (which will initially point into the
-  VM stack) to point into the EBC entry point arguments.
+  Check the stack magic value as well as the guard region at the bottom of
+  the VM stack, and signal a stack fault if either was overwritten.
 
   @param  VmPtr             A pointer to a VM context.
-  @param  Addr              Address to write to.
-  @param  Data              Value to write to Addr.
+  @param  FullCheck         If TRUE, check the whole guard region. Otherwise,
+                            only check the part nearest to the stack top.
 
-  @retval EFI_SUCCESS       The instruction is executed successfully.
-  @retval Other             Some error occurs when writing data to the address.
+  @retval TRUE              The stack magic value and guard region are intact.
+  @retval FALSE             The stack has been corrupted.
 
 **/
-EFI_STATUS
-VmWriteMem16 (
-  IN VM_CONTEXT   *VmPtr,
-  IN UINTN        Addr,
-  IN UINT16       Data
+BOOLEAN
+VmCheckStackGuard (
+  IN VM_CONTEXT *VmPtr,
+  IN BOOLEAN    FullCheck
   );
 
 /**
-  Writes 32-bit data to memory address.
-
-  This routine is called by the EBC data
-  movement instructions that write to memory. Since these writes
-  may be to the stack, which looks like (high address on top) this,
-
-  [EBC entry point arguments]
-  [VM stack]
-  [EBC stack]
-
-  we need to detect all attempts to write to the EBC entry point argument
-  stack area and adjust the address (which will initially point into the
-  VM stack) to point into the EBC entry point arguments.
+  Count down the watchdog budget of a VM at a safepoint, and abort the call
+  with EFI_TIMEOUT if it ran out. Safepoints are the backward jumps and the
+  calls, which every runaway loop has to go through.
 
   @param  VmPtr             A pointer to a VM context.
-  @param  Addr              Address to write to.
-  @param  Data              Value to write to Addr.
-
-  @retval EFI_SUCCESS       The instruction is executed successfully.
-  @retval Other             Some error occurs when writing data to the address.
+  @param  FromIp            The IP of the jump or call instruction. The IP of
+                            the VM context is its target.
 
 **/
-EFI_STATUS
-VmWriteMem32 (
-  IN VM_CONTEXT   *VmPtr,
-  IN UINTN        Addr,
-  IN UINT32       Data
+VOID
+VmSafepoint (
+  IN VM_CONTEXT *VmPtr,
+  IN VMIP       FromIp
   );
 
 /**
@@ -392,66 +202,6 @@ VmReadImmed8 (
   IN UINT32     Offset
   );
 
-/**
-  Reads 16-bit immediate value at the offset.
-
-  This routine is called by the EBC execute
-  functions to read EBC immediate values from the code stream.
-  Since we can't assume alignment, each tries to read in the biggest
-  chunks size available, but will revert to smaller reads if necessary.
-
-  @param  VmPtr             A pointer to a VM context.
-  @param  Offset            offset from IP of the code bytes to read.
-
-  @return Signed data of the requested size from the specified address.
-
-**/
-INT16
-VmReadImmed16 (
-  IN VM_CONTEXT *VmPtr,
-  IN UINT32     Offset
-  );
-
-/**
-  Reads 32-bit immediate value at the offset.
-
-  This routine is called by the EBC execute
-  functions to read EBC immediate values from the code stream.
-  Since we can't assume alignment, each tries to read in the biggest
-  chunks size available, but will revert to smaller reads if necessary.
-
-  @param  VmPtr             A pointer to a VM context.
-  @param  Offset            offset from IP of the code bytes to read.
-
-  @return Signed data of the requested size from the specified address.
-
-**/
-INT32
-VmReadImmed32 (
-  IN VM_CONTEXT *VmPtr,
-  IN UINT32     Offset
-  );
-
-/**
-  Reads 64-bit immediate value at the offset.
-
-  This routine is called by the EBC execute
-  functions to read EBC immediate values from the code stream.
-  Since we can't assume alignment, each tries to read in the biggest
-  chunks size available, but will revert to smaller reads if necessary.
-
-  @param  VmPtr             A pointer to a VM context.
-  @param  Offset            offset from IP of the code bytes to read.
-
-  @return Signed data of the requested size from the specified address.
-
-**/
-INT64
-VmReadImmed64 (
-  IN VM_CONTEXT *VmPtr,
-  IN UINT32     Offset
-  );
-
 /**
   Given an address that EBC is going to read from or write to, return
   an appropriate address that accounts for a gap in the stack.
@@ -1417,13 +1167,24 @@ EbcExecuteInstructions (
   IN OUT UINTN                *InstructionCount
   )
 {
-  UINTN       ExecFunc;
-  EFI_STATUS  Status;
-  UINTN       InstructionsLeft;
-  UINTN       SavedInstructionCount;
+  UINTN           ExecFunc;
+  EFI_STATUS      Status;
+  UINTN           InstructionsLeft;
+  UINTN           SavedInstructionCount;
+  EBC_VM_PRIVATE  VmPrivate;
+  EBC_VM_PRIVATE  *PrevVmPrivate;
 
   Status = EFI_SUCCESS;
 
+  //
+  // Instructions run through the test protocol aren't counted, nor limited
+  // by the watchdog, and leave the state of any running call alone
+  //
+  ZeroMem (&VmPrivate, sizeof (VmPrivate));
+  VmPrivate.WatchdogBudget = EBC_WATCHDOG_DISABLED;
+  PrevVmPrivate            = mEbcVmPrivate;
+  mEbcVmPrivate            = &VmPrivate;
+
   if (*InstructionCount == 0) {
     InstructionsLeft = 1;
   } else {
@@ -1442,7 +1203,8 @@ EbcExecuteInstructions (
     ExecFunc = (UINTN) mVmOpcodeTable[(*VmPtr->Ip & OPCODE_M_OPCODE)].ExecuteFunction;
     if (ExecFunc == (UINTN) NULL) {
       EbcDebugSignalException (EXCEPT_EBC_INVALID_OPCODE, EXCEPTION_FLAG_FATAL, VmPtr);
-      return EFI_UNSUPPORTED;
+      Status = EFI_UNSUPPORTED;
+      break;
     } else {
       mVmOpcodeTable[(*VmPtr->Ip & OPCODE_M_OPCODE)].ExecuteFunction (VmPtr);
       *InstructionCount = *InstructionCount + 1;
@@ -1456,10 +1218,148 @@ EbcExecuteInstructions (
     }
   }
 
+  mEbcVmPrivate = PrevVmPrivate;
+
   return Status;
 }
 
 
+/**
+  Signal a stack fault for a VM. Only report it once though.
+
+  @param  VmPtr             A pointer to a VM context.
+
+**/
+VOID
+VmSignalStackFault (
+  IN VM_CONTEXT *VmPtr
+  )
+{
+  if ((VmPtr->StopFlags & STOPFLAG_STACK_FAULT) == 0) {
+    VmPtr->StopFlags |= STOPFLAG_STACK_FAULT;
+    EbcDebugSignalException (EXCEPT_EBC_STACK_FAULT, EXCEPTION_FLAG_FATAL, VmPtr);
+  }
+}
+
+
+/**
+  Check the VM stack pointer against the top of the stack guard region, and
+  signal a stack fault if it went past it. This is called by the instructions
+  that modify R0, rather than after every instruction.
+
+  @param  VmPtr             A pointer to a VM context.
+
+**/
+VOID
+VmCheckStackLimit (
+  IN VM_CONTEXT *VmPtr
+  )
+{
+  if ((UINT64) VmPtr->Gpr[0] <= (UINT64) (UINTN) VmPtr->StackTop) {
+    VmSignalStackFault (VmPtr);
+  }
+}
+
+
+/**
+  Check the stack magic value as well as the guard region at the bottom of
+  the VM stack, and signal a stack fault if either was overwritten.
+
+  @param  VmPtr             A pointer to a VM context.
+  @param  FullCheck         If TRUE, check the whole guard region. Otherwise,
+                            only check the part nearest to the stack top.
+
+  @retval TRUE              The stack magic value and guard region are intact.
+  @retval FALSE             The stack has been corrupted.
+
+**/
+BOOLEAN
+VmCheckStackGuard (
+  IN VM_CONTEXT *VmPtr,
+  IN BOOLEAN    FullCheck
+  )
+{
+  UINT32  *Guard;
+  UINTN   Count;
+  UINTN   Index;
+
+  if (*VmPtr->StackMagicPtr != (UINTN) VM_STACK_KEY_VALUE) {
+    VmSignalStackFault (VmPtr);
+    return FALSE;
+  }
+
+  //
+  // The guard region grows down from the stack top, so that an overflow
+  // always hits the words we check at CALL and RET first.
+  //
+  Guard = (UINT32 *) VmPtr->StackTop;
+  Count = (FullCheck ? STACK_REMAIN_SIZE : STACK_GUARD_CHECK_SIZE) / sizeof (UINT32);
+  for (Index = 1; Index <= Count; Index++) {
+    if (Guard[-(INTN) Index] != VM_STACK_GUARD_VALUE) {
+      VmSignalStackFault (VmPtr);
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+
+/**
+  Count down the watchdog budget of a VM at a safepoint, and abort the call
+  with EFI_TIMEOUT if it ran out. Safepoints are the backward jumps and the
+  calls, which every runaway loop has to go through.
+
+  @param  VmPtr             A pointer to a VM context.
+  @param  FromIp            The IP of the jump or call instruction. The IP of
+                            the VM context is its target.
+
+**/
+VOID
+VmSafepoint (
+  IN VM_CONTEXT *VmPtr,
+  IN VMIP       FromIp
+  )
+{
+  EFI_HANDLE      ImageHandle;
+  EBC_IMAGE_LIST  *ImageList;
+
+  if (--mEbcVmPrivate->WatchdogBudget != 0) {
+    return;
+  }
+
+  ImageHandle = VmPtr->ImageHandle;
+  if (ImageHandle == NULL) {
+    ImageHandle = EbcFindImageHandle ((UINTN) VmPtr->EntryPoint);
+  }
+  ImageList = EbcGetImageList (ImageHandle, FALSE);
+  if (ImageList != NULL) {
+    ImageList->WatchdogCount++;
+  }
+
+  //
+  // The jump or call that used up the budget is part of the runaway code,
+  // so report it along with its target.
+  //
+  DEBUG ((
+    EFI_D_ERROR,
+    "EBC watchdog: call to 0x%lx in image 0x%lx ran out of its budget of %ld safepoints\n"
+    "  hot IP range: 0x%lx - 0x%lx\n",
+    (UINT64) (UINTN) VmPtr->EntryPoint,
+    (UINT64) (UINTN) ImageHandle,
+    EbcGetImageWatchdogBudget (ImageHandle),
+    (UINT64) (UINTN) ((VmPtr->Ip < FromIp) ? VmPtr->Ip : FromIp),
+    (UINT64) (UINTN) ((VmPtr->Ip < FromIp) ? FromIp : VmPtr->Ip)
+    ));
+
+  //
+  // Abort the call, the caller gets EFI_TIMEOUT as the return value
+  //
+  VmPtr->Gpr[7]     = (UINT64) (UINTN) EFI_TIMEOUT;
+  VmPtr->StopFlags |= STOPFLAG_APP_DONE;
+}
+
+
 /**
   Execute an EBC image from an entry point or from a published protocol.
 
@@ -1475,20 +1375,42 @@ EbcExecute (
   )
 {
   UINTN                             ExecFunc;
-  UINT8                             StackCorrupted;
+  UINT8                             Opcode;
+  BOOLEAN                           StackCorrupted;
+  BOOLEAN                           ClosureEnabled;
   EFI_STATUS                        Status;
+  EFI_HANDLE                        ImageHandle;
   EFI_EBC_SIMPLE_DEBUGGER_PROTOCOL  *EbcSimpleDebugger;
-
+  VM_CONTEXT                        *PrevVmPtr;
+  EBC_VM_PRIVATE                    VmPrivate;
+  EBC_VM_PRIVATE                    *PrevVmPrivate;
+#if EBC_PERFORMANCE_COUNTERS
+  EFI_EBC_PERFORMANCE_COUNTERS      PerfCounters;
+#endif
+#if EBC_INSTRUCTION_MIX
+  EFI_EBC_INSTRUCTION_MIX           *Mix;
+  UINTN                             PrevOpcode;
+#endif
+
+  //
+  // EBC code called back from a native call runs in a new VM context. The
+  // caller's context becomes the running one again when it returns, and the
+  // same goes for the interpreter state of the call.
+  //
+  ZeroMem (&VmPrivate, sizeof (VmPrivate));
+  PrevVmPtr         = mVmPtr;
   mVmPtr            = VmPtr;
+  PrevVmPrivate     = mEbcVmPrivate;
+  mEbcVmPrivate     = &VmPrivate;
   EbcSimpleDebugger = NULL;
   Status            = EFI_SUCCESS;
-  StackCorrupted    = 0;
+  StackCorrupted    = FALSE;
 
   //
   // Make sure the magic value has been put on the stack before we got here.
   //
   if (*VmPtr->StackMagicPtr != (UINTN) VM_STACK_KEY_VALUE) {
-    StackCorrupted = 1;
+    StackCorrupted = TRUE;
   }
 
   VmPtr->FramePtr = (VOID *) ((UINT8 *) (UINTN) VmPtr->Gpr[0] + 8);
@@ -1514,11 +1436,50 @@ EbcExecute (
   //
   VmPtr->EntryPoint = (VOID *) VmPtr->Ip;
 
+  //
+  // Calls through thunks are counted as function entries, the same as the
+  // CALLs from EBC code.
+  //
+  EbcCountExecution ((UINTN) VmPtr->Ip, EBC_EXEC_COUNT_CALL);
+
+  //
+  // Each call into EBC gets the watchdog budget of the image it belongs to.
+  // Calls through thunks don't have an image handle, so look it up.
+  //
+  ImageHandle = VmPtr->ImageHandle;
+  if (ImageHandle == NULL) {
+    ImageHandle = EbcFindImageHandle ((UINTN) VmPtr->Ip);
+  }
+  VmPrivate.WatchdogBudget = EbcGetImageWatchdogBudget (ImageHandle);
+
+#if EBC_PERFORMANCE_COUNTERS
+  EbcPerfStart (&VmPrivate, &PerfCounters);
+  EbcMixStart (&VmPrivate, ImageHandle);
+#endif
+#if EBC_INSTRUCTION_MIX
+  PrevOpcode = EFI_EBC_MIX_OPCODES;
+#endif
+
   //
   // We'll wait for this flag to know when we're done. The RET
   // instruction sets it if it runs out of stack.
   //
   VmPtr->StopFlags = 0;
+  if (StackCorrupted) {
+    VmPtr->StopFlags |= STOPFLAG_STACK_FAULT;
+  }
+
+  //
+  // Compiled blocks don't go through the debugger hooks, so only use them
+  // when no debugger is watching, when the instruction mix isn't being
+  // counted, and when the virtual clock isn't running.
+  //
+  ClosureEnabled = (BOOLEAN) (mEbcFastPathEnabled && (EbcSimpleDebugger == NULL) &&
+                              (VmPrivate.InstMix == NULL) && !mEbcVirtualClock);
+  if (ClosureEnabled) {
+    VmClosureRun (VmPtr);
+  }
+
   while ((VmPtr->StopFlags & STOPFLAG_APP_DONE) == 0) {
     //
     // If we've found a simple debugger protocol, call it
@@ -1533,13 +1494,25 @@ EbcExecute (
     // Use the opcode bits to index into the opcode dispatch table. If the
     // function pointer is null then generate an exception.
     //
-    ExecFunc = (UINTN) mVmOpcodeTable[(*VmPtr->Ip & OPCODE_M_OPCODE)].ExecuteFunction;
+    Opcode   = (UINT8) (*VmPtr->Ip & OPCODE_M_OPCODE);
+    ExecFunc = (UINTN) mVmOpcodeTable[Opcode].ExecuteFunction;
     if (ExecFunc == (UINTN) NULL) {
       EbcDebugSignalException (EXCEPT_EBC_INVALID_OPCODE, EXCEPTION_FLAG_FATAL, VmPtr);
       Status = EFI_UNSUPPORTED;
       goto Done;
     }
 
+#if EBC_INSTRUCTION_MIX
+    if (VmPrivate.InstMix != NULL) {
+      Mix = VmPrivate.InstMix;
+      Mix->Forms[Opcode][EFI_EBC_MIX_FORM (VmPtr->Ip[0], VmPtr->Ip[1])]++;
+      if (PrevOpcode < EFI_EBC_MIX_OPCODES) {
+        Mix->Pairs[PrevOpcode][Opcode]++;
+      }
+      PrevOpcode = Opcode;
+    }
+#endif
+
     EbcDebuggerHookExecuteStart (VmPtr);
 
     //
@@ -1548,10 +1521,23 @@ EbcExecute (
     //
     MemoryFence ();
 
-    mVmOpcodeTable[(*VmPtr->Ip & OPCODE_M_OPCODE)].ExecuteFunction (VmPtr);
+    mVmOpcodeTable[Opcode].ExecuteFunction (VmPtr);
 
     MemoryFence ();
 
+    EBC_PERF_ADD (&VmPrivate, Instructions, 1);
+
+    //
+    // The interpreter calls the periodic callback itself while the virtual
+    // clock runs, so that it happens at the same instruction on every run
+    //
+    if (mEbcVirtualClock) {
+      mEbcVirtualTime += mEbcVirtualCost[Opcode];
+      if (mEbcVirtualTime >= mEbcVirtualDeadline) {
+        EbcVirtualClockPeriodic (VmPtr);
+      }
+    }
+
     EbcDebuggerHookExecuteEnd (VmPtr);
 
     //
@@ -1561,21 +1547,32 @@ EbcExecute (
     if (VMFLAG_ISSET (VmPtr, VMFLAGS_STEP)) {
       EbcDebugSignalException (EXCEPT_EBC_STEP, EXCEPTION_FLAG_NONE, VmPtr);
     }
+
     //
-    // Make sure stack has not been corrupted. Only report it once though.
+    // Blocks start at the targets of branches, calls and returns
     //
-    if ((StackCorrupted == 0) && (*VmPtr->StackMagicPtr != (UINTN) VM_STACK_KEY_VALUE)) {
-      EbcDebugSignalException (EXCEPT_EBC_STACK_FAULT, EXCEPTION_FLAG_FATAL, VmPtr);
-      StackCorrupted = 1;
-    }
-    if ((StackCorrupted == 0) && ((UINT64)VmPtr->Gpr[0] <= (UINT64)(UINTN) VmPtr->StackTop)) {
-      EbcDebugSignalException (EXCEPT_EBC_STACK_FAULT, EXCEPTION_FLAG_FATAL, VmPtr);
-      StackCorrupted = 1;
+    if (ClosureEnabled && (Opcode >= OPCODE_JMP) && (Opcode <= OPCODE_RET) &&
+        ((VmPtr->StopFlags & STOPFLAG_APP_DONE) == 0)) {
+      VmClosureRun (VmPtr);
     }
   }
 
 Done:
-  mVmPtr          = NULL;
+  //
+  // Stack overflows are detected by the instructions that modify R0, and the
+  // guard region is checked at call boundaries. Check the whole of it on the
+  // way out, and restore it for the next user of this stack if it was hit.
+  //
+  if (!VmCheckStackGuard (VmPtr, TRUE)) {
+    InitEBCStackGuard (VmPtr->StackPool);
+  }
+
+#if EBC_PERFORMANCE_COUNTERS
+  EbcPerfStop (&VmPrivate, ImageHandle);
+#endif
+
+  mVmPtr          = PrevVmPtr;
+  mEbcVmPrivate   = PrevVmPrivate;
 
   return Status;
 }
@@ -1886,6 +1883,9 @@ ExecuteMOVxx (
     // register.
     //
     VmPtr->Gpr[OPERAND1_REGNUM (Operands)] = Data64 & DataMask;
+    if (OPERAND1_REGNUM (Operands) == 0) {
+      VmCheckStackLimit (VmPtr);
+    }
   }
   //
   // Advance the instruction pointer
@@ -2067,9 +2067,11 @@ ExecuteJMP (
   UINT64  Data64;
   INT32   Index32;
   UINTN   Addr;
+  VMIP    FromIp;
 
   Operand = GETOPERANDS (VmPtr);
   Opcode  = GETOPCODE (VmPtr);
+  FromIp  = VmPtr->Ip;
 
   //
   // Get instruction length from the opcode. The upper two bits are used here
@@ -2132,6 +2134,10 @@ ExecuteJMP (
     } else {
       VmPtr->Ip = (VMIP) (UINTN) Data64;
     }
+    if (VmPtr->Ip <= FromIp) {
+      VmSafepoint (VmPtr, FromIp);
+      EbcCountExecution ((UINTN) VmPtr->Ip, EBC_EXEC_COUNT_LOOP);
+    }
     EbcDebuggerHookJMPEnd (VmPtr);
 
     return EFI_SUCCESS;
@@ -2184,6 +2190,10 @@ ExecuteJMP (
     } else {
       VmPtr->Ip = (VMIP) Addr;
     }
+    if (VmPtr->Ip <= FromIp) {
+      VmSafepoint (VmPtr, FromIp);
+      EbcCountExecution ((UINTN) VmPtr->Ip, EBC_EXEC_COUNT_LOOP);
+    }
     EbcDebuggerHookJMPEnd (VmPtr);
 
   } else {
@@ -2207,6 +2217,10 @@ ExecuteJMP (
     } else {
       VmPtr->Ip = (VMIP) Addr;
     }
+    if (VmPtr->Ip <= FromIp) {
+      VmSafepoint (VmPtr, FromIp);
+      EbcCountExecution ((UINTN) VmPtr->Ip, EBC_EXEC_COUNT_LOOP);
+    }
     EbcDebuggerHookJMPEnd (VmPtr);
 
   }
@@ -2235,11 +2249,13 @@ ExecuteJMP8 (
   UINT8 ConditionFlag;
   UINT8 CompareSet;
   INT8  Offset;
+  VMIP  FromIp;
 
   //
   // Decode instruction.
   //
   Opcode        = GETOPCODE (VmPtr);
+  FromIp        = VmPtr->Ip;
   CompareSet    = (UINT8) (((Opcode & JMP_M_CS) != 0) ? 1 : 0);
   ConditionFlag = (UINT8) VMFLAG_ISSET (VmPtr, VMFLAGS_CC);
 
@@ -2264,6 +2280,18 @@ ExecuteJMP8 (
   //
   EbcDebuggerHookJMP8Start (VmPtr);
   VmPtr->Ip += (Offset * 2) + 2;
+  if (Offset < 0) {
+    VmSafepoint (VmPtr, FromIp);
+    //
+    // Run copy, fill and scan loops natively, once they are hot enough, unless
+    // every instruction needs to be counted, or to advance the virtual clock
+    //
+    if ((EbcCountExecution ((UINTN) VmPtr->Ip, EBC_EXEC_COUNT_LOOP) >= EBC_TIER_UP_THRESHOLD) &&
+        mEbcFastPathEnabled && (mEbcVmPrivate->InstMix == NULL) && !mEbcVirtualClock &&
+        ((VmPtr->StopFlags & STOPFLAG_APP_DONE) == 0)) {
+      VmIdiomFastForward (VmPtr, FromIp);
+    }
+  }
   EbcDebuggerHookJMP8End (VmPtr);
   return EFI_SUCCESS;
 }
@@ -2380,6 +2408,9 @@ ExecuteMOVI (
     }
 
     VmPtr->Gpr[OPERAND1_REGNUM (Operands)] = ImmData64 & Mask64;
+    if (OPERAND1_REGNUM (Operands) == 0) {
+      VmCheckStackLimit (VmPtr);
+    }
   } else {
     //
     // Get the address then write back based on size of the move
@@ -2499,6 +2530,9 @@ ExecuteMOVIn (
     }
 
     VmPtr->Gpr[OPERAND1_REGNUM (Operands)] = ImmedIndex64;
+    if (OPERAND1_REGNUM (Operands) == 0) {
+      VmCheckStackLimit (VmPtr);
+    }
   } else {
     //
     // Get the address
@@ -2607,6 +2641,9 @@ ExecuteMOVREL (
     }
 
     VmPtr->Gpr[OPERAND1_REGNUM (Operands)] = (VM_REGISTER) Op2;
+    if (OPERAND1_REGNUM (Operands) == 0) {
+      VmCheckStackLimit (VmPtr);
+    }
   } else {
     //
     // Get the address = [Rx] + Index16
@@ -2714,6 +2751,9 @@ ExecuteMOVsnw (
       }
     }
     VmPtr->Gpr[OPERAND1_REGNUM (Operands)] = Op2;
+    if (OPERAND1_REGNUM (Operands) == 0) {
+      VmCheckStackLimit (VmPtr);
+    }
   } else {
     VmWriteMemN (VmPtr, (UINTN) (VmPtr->Gpr[OPERAND1_REGNUM (Operands)] + Op1Index), (UINTN) Op2);
   }
@@ -2815,6 +2855,9 @@ ExecuteMOVsnd (
       }
     }
     VmPtr->Gpr[OPERAND1_REGNUM (Operands)] = Op2;
+    if (OPERAND1_REGNUM (Operands) == 0) {
+      VmCheckStackLimit (VmPtr);
+    }
   } else {
     VmWriteMemN (VmPtr, (UINTN) (VmPtr->Gpr[OPERAND1_REGNUM (Operands)] + Op1Index), (UINTN) Op2);
   }
@@ -2880,6 +2923,7 @@ ExecutePUSHn (
   // Adjust the stack down.
   //
   VmPtr->Gpr[0] -= sizeof (UINTN);
+  VmCheckStackLimit (VmPtr);
   VmWriteMemN (VmPtr, (UINTN) VmPtr->Gpr[0], DataN);
   if (VmPtr->StackTracker != NULL) {
     return UpdateStackTracker (VmPtr, -1, 0);
@@ -2944,6 +2988,7 @@ ExecutePUSH (
     // Adjust the stack down, then write back the data
     //
     VmPtr->Gpr[0] -= sizeof (UINT64);
+    VmCheckStackLimit (VmPtr);
     VmWriteMem64 (VmPtr, (UINTN) VmPtr->Gpr[0], Data64);
   } else {
     //
@@ -2958,6 +3003,7 @@ ExecutePUSH (
     // Adjust the stack down and write the data
     //
     VmPtr->Gpr[0] -= sizeof (UINT32);
+    VmCheckStackLimit (VmPtr);
     VmWriteMem32 (VmPtr, (UINTN) VmPtr->Gpr[0], Data32);
   }
 
@@ -3023,6 +3069,7 @@ ExecutePOPn (
   } else {
     VmPtr->Gpr[OPERAND1_REGNUM (Operands)] = (INT64) (UINT64) ((UINTN) DataN + Index16);
   }
+  VmCheckStackLimit (VmPtr);
 
   if (VmPtr->StackTracker != NULL) {
     return UpdateStackTracker (VmPtr, 1, 0);
@@ -3106,6 +3153,7 @@ ExecutePOP (
       VmPtr->Gpr[OPERAND1_REGNUM (Operands)] = (INT64) Data32 + Index16;
     }
   }
+  VmCheckStackLimit (VmPtr);
 
   if (VmPtr->StackTracker != NULL) {
     return UpdateStackTracker (VmPtr, 0, ((Opcode & PUSHPOP_M_64) != 0) ? 8 : 4);
@@ -3142,12 +3190,14 @@ ExecuteCALL (
   UINT8 Size;
   INT64 Immed64;
   VOID  *FramePtr;
+  VMIP  FromIp;
 
   //
   // Get opcode and operands
   //
   Opcode    = GETOPCODE (VmPtr);
   Operands  = GETOPERANDS (VmPtr);
+  FromIp    = VmPtr->Ip;
 
   if ((Operands & OPERAND_M_NATIVE_CALL) != 0) {
     EbcDebuggerHookCALLEXStart (VmPtr);
@@ -3155,6 +3205,11 @@ ExecuteCALL (
     EbcDebuggerHookCALLStart (VmPtr);
   }
 
+  //
+  // Call boundaries are where the stack guard gets checked
+  //
+  VmCheckStackGuard (VmPtr, FALSE);
+
   //
   // Assign these as well to avoid compiler warnings
   //
@@ -3208,7 +3263,7 @@ ExecuteCALL (
       //
       // Call external function, get the return value, and advance the IP
       //
-      EbcLLCALLEX (VmPtr, (UINTN) Immed64, (UINTN) VmPtr->Gpr[0], FramePtr, Size);
+      EbcCallEx (VmPtr, (UINTN) Immed64, (UINTN) VmPtr->Gpr[0], FramePtr, Size);
     }
   } else {
     //
@@ -3245,17 +3300,29 @@ ExecuteCALL (
       // Native call. Relative or absolute?
       //
       if ((Operands & OPERAND_M_RELATIVE_ADDR) != 0) {
-        EbcLLCALLEX (VmPtr, (UINTN) (Immed64 + VmPtr->Ip + Size), (UINTN) VmPtr->Gpr[0], FramePtr, Size);
+        EbcCallEx (VmPtr, (UINTN) (Immed64 + VmPtr->Ip + Size), (UINTN) VmPtr->Gpr[0], FramePtr, Size);
       } else {
         if ((VmPtr->StopFlags & STOPFLAG_BREAK_ON_CALLEX) != 0) {
           CpuBreakpoint ();
         }
 
-        EbcLLCALLEX (VmPtr, (UINTN) Immed64, (UINTN) VmPtr->Gpr[0], FramePtr, Size);
+        EbcCallEx (VmPtr, (UINTN) Immed64, (UINTN) VmPtr->Gpr[0], FramePtr, Size);
       }
     }
   }
 
+  //
+  // EBC calls, including CALLEX to a thunk, have pushed a new frame
+  //
+  VmCheckStackLimit (VmPtr);
+
+  VmSafepoint (VmPtr, FromIp);
+
+  if ((Operands & OPERAND_M_NATIVE_CALL) == 0) {
+    EbcCountExecution ((UINTN) VmPtr->Ip, EBC_EXEC_COUNT_CALL);
+    EBC_PERF_ADD (mEbcVmPrivate, Calls, 1);
+  }
+
   if ((Operands & OPERAND_M_NATIVE_CALL) != 0) {
     EbcDebuggerHookCALLEXEnd (VmPtr);
   } else {
@@ -3285,6 +3352,10 @@ ExecuteRET (
 
   EbcDebuggerHookRETStart (VmPtr);
 
+  VmCheckStackGuard (VmPtr, FALSE);
+
+  EBC_PERF_ADD (mEbcVmPrivate, Returns, 1);
+
   //
   // If we're at the top of the stack, then simply set the done
   // flag and return
@@ -4459,6 +4530,9 @@ ExecuteDataManip (
     if ((Opcode & DATAMANIP_M_64) == 0) {
       VmPtr->Gpr[OPERAND1_REGNUM (Operands)] &= 0xFFFFFFFF;
     }
+    if (OPERAND1_REGNUM (Operands) == 0) {
+      VmCheckStackLimit (VmPtr);
+    }
   }
   //
   // Advance the instruction pointer
@@ -4578,6 +4652,10 @@ ExecuteSTORESP (
     break;
   }
 
+  if (OPERAND1_REGNUM (Operands) == 0) {
+    VmCheckStackLimit (VmPtr);
+  }
+
   VmPtr->Ip += 2;
   return EFI_SUCCESS;
 }
@@ -4871,6 +4949,7 @@ VmWriteMem8 (
   // Convert the address if it's in the stack gap
   //
   Addr            = ConvertStackAddr (VmPtr, Addr);
+  EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINT8), EBC_MEMORY_ACCESS_WRITE);
   *(UINT8 *) Addr = Data;
   return EFI_SUCCESS;
 }
@@ -4916,22 +4995,24 @@ VmWriteMem16 (
   // Do a simple write if aligned
   //
   if (IS_ALIGNED (Addr, sizeof (UINT16))) {
+    EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINT16), EBC_MEMORY_ACCESS_WRITE);
     *(UINT16 *) Addr = Data;
   } else {
+    EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINT16), EBC_MEMORY_ACCESS_WRITE | EBC_MEMORY_ACCESS_UNALIGNED);
     //
     // Write as two bytes
     //
+    EBC_MEMORY_SPLIT_START ();
     MemoryFence ();
-    if ((Status = VmWriteMem8 (VmPtr, Addr, (UINT8) Data)) != EFI_SUCCESS) {
-      return Status;
-    }
-
-    MemoryFence ();
-    if ((Status = VmWriteMem8 (VmPtr, Addr + 1, (UINT8) (Data >> 8))) != EFI_SUCCESS) {
-      return Status;
+    Status = VmWriteMem8 (VmPtr, Addr, (UINT8) Data);
+    if (Status == EFI_SUCCESS) {
+      MemoryFence ();
+      Status = VmWriteMem8 (VmPtr, Addr + 1, (UINT8) (Data >> 8));
     }
 
     MemoryFence ();
+    EBC_MEMORY_SPLIT_END ();
+    return Status;
   }
 
   return EFI_SUCCESS;
@@ -4979,22 +5060,24 @@ VmWriteMem32 (
   // Do a simple write if aligned
   //
   if (IS_ALIGNED (Addr, sizeof (UINT32))) {
+    EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINT32), EBC_MEMORY_ACCESS_WRITE);
     *(UINT32 *) Addr = Data;
   } else {
+    EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINT32), EBC_MEMORY_ACCESS_WRITE | EBC_MEMORY_ACCESS_UNALIGNED);
     //
     // Write as two words
     //
+    EBC_MEMORY_SPLIT_START ();
     MemoryFence ();
-    if ((Status = VmWriteMem16 (VmPtr, Addr, (UINT16) Data)) != EFI_SUCCESS) {
-      return Status;
-    }
-
-    MemoryFence ();
-    if ((Status = VmWriteMem16 (VmPtr, Addr + sizeof (UINT16), (UINT16) (Data >> 16))) != EFI_SUCCESS) {
-      return Status;
+    Status = VmWriteMem16 (VmPtr, Addr, (UINT16) Data);
+    if (Status == EFI_SUCCESS) {
+      MemoryFence ();
+      Status = VmWriteMem16 (VmPtr, Addr + sizeof (UINT16), (UINT16) (Data >> 16));
     }
 
     MemoryFence ();
+    EBC_MEMORY_SPLIT_END ();
+    return Status;
   }
 
   return EFI_SUCCESS;
@@ -5042,22 +5125,24 @@ VmWriteMem64 (
   // Do a simple write if aligned
   //
   if (IS_ALIGNED (Addr, sizeof (UINT64))) {
+    EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINT64), EBC_MEMORY_ACCESS_WRITE);
     *(UINT64 *) Addr = Data;
   } else {
+    EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINT64), EBC_MEMORY_ACCESS_WRITE | EBC_MEMORY_ACCESS_UNALIGNED);
     //
     // Write as two 32-bit words
     //
+    EBC_MEMORY_SPLIT_START ();
     MemoryFence ();
-    if ((Status = VmWriteMem32 (VmPtr, Addr, (UINT32) Data)) != EFI_SUCCESS) {
-      return Status;
-    }
-
-    MemoryFence ();
-    if ((Status = VmWriteMem32 (VmPtr, Addr + sizeof (UINT32), (UINT32) RShiftU64(Data, 32))) != EFI_SUCCESS) {
-      return Status;
+    Status = VmWriteMem32 (VmPtr, Addr, (UINT32) Data);
+    if (Status == EFI_SUCCESS) {
+      MemoryFence ();
+      Status = VmWriteMem32 (VmPtr, Addr + sizeof (UINT32), (UINT32) RShiftU64(Data, 32));
     }
 
     MemoryFence ();
+    EBC_MEMORY_SPLIT_END ();
+    return Status;
   }
 
   return EFI_SUCCESS;
@@ -5108,14 +5193,18 @@ VmWriteMemN (
   // Do a simple write if aligned
   //
   if (IS_ALIGNED (Addr, sizeof (UINTN))) {
+    EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINTN), EBC_MEMORY_ACCESS_WRITE);
     *(UINTN *) Addr = Data;
   } else {
+    EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINTN), EBC_MEMORY_ACCESS_WRITE | EBC_MEMORY_ACCESS_UNALIGNED);
+    EBC_MEMORY_SPLIT_START ();
     for (Index = 0; Index < sizeof (UINTN) / sizeof (UINT32); Index++) {
       MemoryFence ();
       Status = VmWriteMem32 (VmPtr, Addr + Index * sizeof (UINT32), (UINT32) Data);
       MemoryFence ();
       Data = (UINTN) RShiftU64 ((UINT64)Data, 32);
     }
+    EBC_MEMORY_SPLIT_END ();
   }
 
   return Status;
@@ -5404,6 +5493,7 @@ VmReadMem8 (
   // Convert the address if it's in the stack gap
   //
   Addr = ConvertStackAddr (VmPtr, Addr);
+  EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINT8), 0);
   //
   // Simply return the data in flat memory space
   //
@@ -5433,11 +5523,13 @@ VmReadMem16 (
   // Read direct if aligned
   //
   if (IS_ALIGNED (Addr, sizeof (UINT16))) {
+    EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINT16), 0);
     return * (UINT16 *) Addr;
   }
   //
   // Return unaligned data
   //
+  EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINT16), EBC_MEMORY_ACCESS_UNALIGNED);
   return (UINT16) (*(UINT8 *) Addr + (*(UINT8 *) (Addr + 1) << 8));
 }
 
@@ -5466,13 +5558,17 @@ VmReadMem32 (
   // Read direct if aligned
   //
   if (IS_ALIGNED (Addr, sizeof (UINT32))) {
+    EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINT32), 0);
     return * (UINT32 *) Addr;
   }
   //
   // Return unaligned data
   //
+  EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINT32), EBC_MEMORY_ACCESS_UNALIGNED);
+  EBC_MEMORY_SPLIT_START ();
   Data = (UINT32) VmReadMem16 (VmPtr, Addr);
   Data |= (VmReadMem16 (VmPtr, Addr + 2) << 16);
+  EBC_MEMORY_SPLIT_END ();
   return Data;
 }
 
@@ -5503,13 +5599,17 @@ VmReadMem64 (
   // Read direct if aligned
   //
   if (IS_ALIGNED (Addr, sizeof (UINT64))) {
+    EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINT64), 0);
     return * (UINT64 *) Addr;
   }
   //
   // Return unaligned data. Assume little endian.
   //
+  EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINT64), EBC_MEMORY_ACCESS_UNALIGNED);
+  EBC_MEMORY_SPLIT_START ();
   Data32 = VmReadMem32 (VmPtr, Addr);
   Data  = (UINT64) VmReadMem32 (VmPtr, Addr + sizeof (UINT32));
+  EBC_MEMORY_SPLIT_END ();
   Data  = LShiftU64 (Data, 32) | Data32;
   return Data;
 }
@@ -5572,11 +5672,13 @@ VmReadMemN (
   // Read direct if aligned
   //
   if (IS_ALIGNED (Addr, sizeof (UINTN))) {
+    EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINTN), 0);
     return * (UINTN *) Addr;
   }
   //
   // Return unaligned data
   //
+  EBC_MEMORY_ACCESS (VmPtr, Addr, sizeof (UINTN), EBC_MEMORY_ACCESS_UNALIGNED);
   Data    = 0;
   FromPtr = (UINT8 *) Addr;
   ToPtr   = (UINT8 *) &Data;
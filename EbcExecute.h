@@ -36,6 +36,19 @@ typedef struct {
 //
 #define EBCMSG(s) gST->ConOut->OutputString (gST->ConOut, s)
 
+typedef
+UINT64
+(*DATA_MANIP_EXEC_FUNCTION) (
+  IN VM_CONTEXT * VmPtr,
+  IN UINT64     Op1,
+  IN UINT64     Op2
+  );
+
+//
+// Functions that execute the data manipulation instructions, indexed by
+// (opcode - OPCODE_NOT)
+//
+extern CONST DATA_MANIP_EXEC_FUNCTION mDataManipDispatchTable[];
 
 /**
   Execute an EBC image from an entry point or from a published protocol.
@@ -64,6 +77,171 @@ GetVmVersion (
   VOID
   );
 
+/**
+  Reads 8-bit data form the memory address.
+
+  @param  VmPtr             A pointer to VM context.
+  @param  Addr              The memory address.
+
+  @return The 8-bit value from the memory address.
+
+**/
+UINT8
+VmReadMem8 (
+  IN VM_CONTEXT   *VmPtr,
+  IN UINTN        Addr
+  );
+
+/**
+  Reads 16-bit data form the memory address.
+
+  @param  VmPtr             A pointer to VM context.
+  @param  Addr              The memory address.
+
+  @return The 16-bit value from the memory address.
+
+**/
+UINT16
+VmReadMem16 (
+  IN VM_CONTEXT *VmPtr,
+  IN UINTN      Addr
+  );
+
+/**
+  Reads 32-bit data form the memory address.
+
+  @param  VmPtr             A pointer to VM context.
+  @param  Addr              The memory address.
+
+  @return The 32-bit value from the memory address.
+
+**/
+UINT32
+VmReadMem32 (
+  IN VM_CONTEXT *VmPtr,
+  IN UINTN      Addr
+  );
+
+/**
+  Reads 64-bit data form the memory address.
+
+  @param  VmPtr             A pointer to VM context.
+  @param  Addr              The memory address.
+
+  @return The 64-bit value from the memory address.
+
+**/
+UINT64
+VmReadMem64 (
+  IN VM_CONTEXT   *VmPtr,
+  IN UINTN        Addr
+  );
+
+/**
+  Read a natural value from memory. May or may not be aligned.
+
+  @param  VmPtr             current VM context
+  @param  Addr              the address to read from
+
+  @return The natural value at address Addr.
+
+**/
+UINTN
+VmReadMemN (
+  IN VM_CONTEXT    *VmPtr,
+  IN UINTN         Addr
+  );
+
+/**
+  Writes 8-bit data to memory address.
+
+  This routine is called by the EBC data
+  movement instructions that write to memory. Since these writes
+  may be to the stack, which looks like (high address on top) this,
+
+  [EBC entry point arguments]
+  [VM stack]
+  [EBC stack]
+
+  we need to detect all attempts to write to the EBC entry point argument
+  stack area and adjust the address (which will initially point into the
+  VM stack) to point into the EBC entry point arguments.
+
+  @param  VmPtr             A pointer to a VM context.
+  @param  Addr              Address to write to.
+  @param  Data              Value to write to Addr.
+
+  @retval EFI_SUCCESS       The instruction is executed successfully.
+  @retval Other             Some error occurs when writing data to the address.
+
+**/
+EFI_STATUS
+VmWriteMem8 (
+  IN VM_CONTEXT    *VmPtr,
+  IN UINTN         Addr,
+  IN UINT8         Data
+  );
+
+/**
+  Writes 16-bit data to memory address.
+
+  This routine is called by the EBC data
+  movement instructions that write to memory. Since these writes
+  may be to the stack, which looks like (high address on top) this,
+
+  [EBC entry point arguments]
+  [VM stack]
+  [EBC stack]
+
+  we need to detect all attempts to write to the EBC entry point argument
+  stack area and adjust the address (which will initially point into the
+  VM stack) to point into the EBC entry point arguments.
+
+  @param  VmPtr             A pointer to a VM context.
+  @param  Addr              Address to write to.
+  @param  Data              Value to write to Addr.
+
+  @retval EFI_SUCCESS       The instruction is executed successfully.
+  @retval Other             Some error occurs when writing data to the address.
+
+**/
+EFI_STATUS
+VmWriteMem16 (
+  IN VM_CONTEXT   *VmPtr,
+  IN UINTN        Addr,
+  IN UINT16       Data
+  );
+
+/**
+  Writes 32-bit data to memory address.
+
+  This routine is called by the EBC data
+  movement instructions that write to memory. Since these writes
+  may be to the stack, which looks like (high address on top) this,
+
+  [EBC entry point arguments]
+  [VM stack]
+  [EBC stack]
+
+  we need to detect all attempts to write to the EBC entry point argument
+  stack area and adjust the address (which will initially point into the
+  VM stack) to point into the EBC entry point arguments.
+
+  @param  VmPtr             A pointer to a VM context.
+  @param  Addr              Address to write to.
+  @param  Data              Value to write to Addr.
+
+  @retval EFI_SUCCESS       The instruction is executed successfully.
+  @retval Other             Some error occurs when writing data to the address.
+
+**/
+EFI_STATUS
+VmWriteMem32 (
+  IN VM_CONTEXT   *VmPtr,
+  IN UINTN        Addr,
+  IN UINT32       Data
+  );
+
 /**
   Writes UINTN data to memory address.
 
@@ -124,6 +302,188 @@ VmWriteMem64 (
   IN UINT64       Data
   );
 
+/**
+  Decode a 16-bit index to determine the offset. Given an index value:
+
+    b15     - sign bit
+    b14:12  - number of bits in this index assigned to natural units (=a)
+    ba:11   - constant units = ConstUnits
+    b0:a    - natural units = NaturalUnits
+
+  Given this info, the offset can be computed by:
+    offset = sign_bit * (ConstUnits + NaturalUnits * sizeof(UINTN))
+
+  Max offset is achieved with index = 0x7FFF giving an offset of
+  0x27B (32-bit machine) or 0x477 (64-bit machine).
+  Min offset is achieved with index =
+
+  @param  VmPtr             A pointer to VM context.
+  @param  CodeOffset        Offset from IP of the location of the 16-bit index
+                            to decode.
+  @param  IndexPtr          An optional pointer where the decoded index pair
+                            values can be written.
+
+  @return The decoded offset.
+
+**/
+INT16
+VmReadIndex16 (
+  IN VM_CONTEXT     *VmPtr,
+  IN UINT32         CodeOffset,
+  OUT EBC_INDEX     *IndexPtr OPTIONAL
+  );
+
+/**
+  Decode a 32-bit index to determine the offset.
+
+  @param  VmPtr             A pointer to VM context.
+  @param  CodeOffset        Offset from IP of the location of the 32-bit index
+                            to decode.
+  @param  IndexPtr          An optional pointer where the decoded index pair
+                            values can be written.
+
+  @return Converted index per EBC VM specification.
+
+**/
+INT32
+VmReadIndex32 (
+  IN VM_CONTEXT     *VmPtr,
+  IN UINT32         CodeOffset,
+  OUT EBC_INDEX     *IndexPtr OPTIONAL
+  );
+
+/**
+  Decode a 64-bit index to determine the offset.
+
+  @param  VmPtr             A pointer to VM context.s
+  @param  CodeOffset        Offset from IP of the location of the 64-bit index
+                            to decode.
+  @param  IndexPtr          An optional pointer where the decoded index pair
+                            values can be written.
+
+  @return Converted index per EBC VM specification
+
+**/
+INT64
+VmReadIndex64 (
+  IN VM_CONTEXT     *VmPtr,
+  IN UINT32         CodeOffset,
+  OUT EBC_INDEX     *IndexPtr OPTIONAL
+  );
+
+/**
+  Reads 16-bit immediate value at the offset.
+
+  This routine is called by the EBC execute
+  functions to read EBC immediate values from the code stream.
+  Since we can't assume alignment, each tries to read in the biggest
+  chunks size available, but will revert to smaller reads if necessary.
+
+  @param  VmPtr             A pointer to a VM context.
+  @param  Offset            offset from IP of the code bytes to read.
+
+  @return Signed data of the requested size from the specified address.
+
+**/
+INT16
+VmReadImmed16 (
+  IN VM_CONTEXT *VmPtr,
+  IN UINT32     Offset
+  );
+
+/**
+  Reads 32-bit immediate value at the offset.
+
+  This routine is called by the EBC execute
+  functions to read EBC immediate values from the code stream.
+  Since we can't assume alignment, each tries to read in the biggest
+  chunks size available, but will revert to smaller reads if necessary.
+
+  @param  VmPtr             A pointer to a VM context.
+  @param  Offset            offset from IP of the code bytes to read.
+
+  @return Signed data of the requested size from the specified address.
+
+**/
+INT32
+VmReadImmed32 (
+  IN VM_CONTEXT *VmPtr,
+  IN UINT32     Offset
+  );
+
+/**
+  Reads 64-bit immediate value at the offset.
+
+  This routine is called by the EBC execute
+  functions to read EBC immediate values from the code stream.
+  Since we can't assume alignment, each tries to read in the biggest
+  chunks size available, but will revert to smaller reads if necessary.
+
+  @param  VmPtr             A pointer to a VM context.
+  @param  Offset            offset from IP of the code bytes to read.
+
+  @return Signed data of the requested size from the specified address.
+
+**/
+INT64
+VmReadImmed64 (
+  IN VM_CONTEXT *VmPtr,
+  IN UINT32     Offset
+  );
+
+/**
+  Called when the backward JMP8 of a loop was taken, to run the rest of the
+  loop natively if it is a copy, fill or scan idiom. On return, the VM is in
+  the same state as if the interpreter had run the loop, either to its end or
+  for a number of iterations.
+
+  @param  VmPtr             A pointer to a VM context, with its IP set to the
+                            head of the loop.
+  @param  Tail              The address of the JMP8 instruction.
+
+  @retval TRUE              Some iterations of the loop were run natively.
+  @retval FALSE             The loop is not an idiom, or could not be run.
+
+**/
+BOOLEAN
+VmIdiomFastForward (
+  IN VM_CONTEXT *VmPtr,
+  IN VMIP       Tail
+  );
+
+/**
+  Flush the loop cache. This must be called when EBC code is unloaded, as
+  new code may then be loaded at the same address.
+
+**/
+VOID
+EbcIdiomFlushCache (
+  VOID
+  );
+
+/**
+  Called at the start of each EBC invocation, and after each branch, call or
+  return, to run the compiled blocks that start at the current IP. On return,
+  the IP points to an instruction that the interpreter must run.
+
+  @param  VmPtr             A pointer to a VM context.
+
+**/
+VOID
+VmClosureRun (
+  IN VM_CONTEXT *VmPtr
+  );
+
+/**
+  Flush the block cache. This must be called when EBC code is unloaded or
+  modified, as the blocks would otherwise run the old code.
+
+**/
+VOID
+EbcClosureFlushCache (
+  VOID
+  );
+
 /**
   Given a pointer to a new VM context, execute one or more instructions. This
   function is only used for test purposes via the EBC VM test protocol.
@@ -0,0 +1,868 @@
+/** @file
+  Recognition of the EBC loops that copy, fill or scan memory, so that a whole
+  run of such a loop can be executed natively, rather than one instruction at
+  a time.
+
+  A loop is considered when its backward JMP8 is taken. Its body is decoded
+  once into a small list of micro operations, which is kept in a cache that is
+  indexed by the loop head. Only bodies made of register arithmetic, a single
+  memory access and a single compare are recognized, so that the registers can
+  be stepped natively and the memory access applied in bulk, with the exact
+  same result as the interpreter.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "EbcInt.h"
+#include "EbcExecute.h"
+
+//
+// Maximum number of instructions in a loop body, not counting the JMP8
+//
+#define IDIOM_MAX_UOPS          6
+//
+// Number of loops that the cache can hold. Must be a power of 2.
+//
+#define IDIOM_CACHE_SIZE        64
+//
+// Maximum number of iterations to run natively at once, so that the periodic
+// callback and the timer events still get a chance to run on very long loops.
+//
+#define IDIOM_MAX_ITERATIONS    0x100000
+
+//
+// Micro operations that a loop body is decoded into
+//
+#define IDIOM_UOP_ADD           0   // R1 = R1 + (R2 + Imm)
+#define IDIOM_UOP_SUB           1   // R1 = R1 - (R2 + Imm)
+#define IDIOM_UOP_MOVREG        2   // R1 = (R2 + Imm) & Mask
+#define IDIOM_UOP_MOVIMM        3   // R1 = Imm & Mask
+#define IDIOM_UOP_CMP           4   // CC = R1 <cond> R2 + Imm
+#define IDIOM_UOP_CMPIMM        5   // CC = R1 <cond> Imm
+#define IDIOM_UOP_LOAD          6   // R1 = [R2 + Imm] & Mask
+#define IDIOM_UOP_COPY          7   // [R1 + Index] = [R2 + Imm]
+#define IDIOM_UOP_FILL          8   // [R1 + Index] = R2
+#define IDIOM_UOP_FILLIMM       9   // [R1 + Index] = Imm
+
+//
+// Kinds of loops
+//
+#define IDIOM_KIND_NONE         0
+#define IDIOM_KIND_COPY         1
+#define IDIOM_KIND_FILL         2
+#define IDIOM_KIND_SCAN         3
+
+typedef struct {
+  UINT8   Type;
+  UINT8   Opcode;                 ///< masked opcode of compares
+  UINT8   Reg1;
+  UINT8   Reg2;
+  UINT8   Size;                   ///< access size of memory operations, in bytes
+  BOOLEAN Is64;                   ///< 64-bit arithmetic or compare
+  UINT64  Mask;
+  INT64   Index;                  ///< index of operand 1 for stores
+  INT64   Imm;                    ///< index or immediate data of operand 2
+} IDIOM_UOP;
+
+typedef struct {
+  UINTN     Sequence;             ///< odd while the entry is being written
+  VMIP      Head;
+  VMIP      Tail;                 ///< address of the backward JMP8
+  UINT8     Kind;
+  UINT8     CondSet;              ///< 1 for JMP8cs, 0 for JMP8cc
+  UINT8     UopCount;
+  UINT8     MemUop;               ///< index of the memory access in Uop[]
+  IDIOM_UOP Uop[IDIOM_MAX_UOPS];
+} IDIOM_ENTRY;
+
+IDIOM_ENTRY   mIdiomCache[IDIOM_CACHE_SIZE];
+
+/**
+  Decode one instruction of a loop body into a micro operation.
+
+  @param  VmPtr             A pointer to a VM context, with its IP set to the
+                            instruction to decode.
+  @param  Uop               The micro operation to fill.
+
+  @return The size of the instruction, or 0 if it can't be part of an idiom.
+
+**/
+UINT8
+IdiomDecode (
+  IN  VM_CONTEXT  *VmPtr,
+  OUT IDIOM_UOP   *Uop
+  )
+{
+  UINT8   Opcode;
+  UINT8   OpcMasked;
+  UINT8   Operands;
+  UINT8   Size;
+  BOOLEAN Is32Index;
+
+  Opcode    = GETOPCODE (VmPtr);
+  OpcMasked = (UINT8) (Opcode & OPCODE_M_OPCODE);
+  Operands  = GETOPERANDS (VmPtr);
+
+  ZeroMem (Uop, sizeof (IDIOM_UOP));
+  Uop->Reg1 = (UINT8) OPERAND1_REGNUM (Operands);
+  Uop->Reg2 = (UINT8) OPERAND2_REGNUM (Operands);
+
+  switch (OpcMasked) {
+  case OPCODE_ADD:
+  case OPCODE_SUB:
+    //
+    // Register to register only: ADD[32|64] R1, R2 {Immed16}
+    //
+    if (OPERAND1_INDIRECT (Operands) || OPERAND2_INDIRECT (Operands)) {
+      return 0;
+    }
+    Size = 2;
+    if ((Opcode & DATAMANIP_M_IMMDATA) != 0) {
+      Uop->Imm = VmReadImmed16 (VmPtr, 2);
+      Size     = 4;
+    }
+    Uop->Type = (UINT8) ((OpcMasked == OPCODE_ADD) ? IDIOM_UOP_ADD : IDIOM_UOP_SUB);
+    Uop->Is64 = (BOOLEAN) ((Opcode & DATAMANIP_M_64) != 0);
+    return Size;
+
+  case OPCODE_CMPEQ:
+  case OPCODE_CMPLTE:
+  case OPCODE_CMPGTE:
+  case OPCODE_CMPULTE:
+  case OPCODE_CMPUGTE:
+    if (OPERAND2_INDIRECT (Operands)) {
+      return 0;
+    }
+    Size = 2;
+    if ((Opcode & OPCODE_M_IMMDATA) != 0) {
+      Uop->Imm = VmReadImmed16 (VmPtr, 2);
+      Size     = 4;
+    }
+    Uop->Type   = IDIOM_UOP_CMP;
+    Uop->Opcode = OpcMasked;
+    Uop->Is64   = (BOOLEAN) ((Opcode & OPCODE_M_64BIT) != 0);
+    return Size;
+
+  case OPCODE_CMPIEQ:
+  case OPCODE_CMPILTE:
+  case OPCODE_CMPIGTE:
+  case OPCODE_CMPIULTE:
+  case OPCODE_CMPIUGTE:
+    if (OPERAND1_INDIRECT (Operands) || ((Operands & OPERAND_M_CMPI_INDEX) != 0)) {
+      return 0;
+    }
+    if ((Opcode & OPCODE_M_CMPI32_DATA) != 0) {
+      Uop->Imm = VmReadImmed32 (VmPtr, 2);
+      Size     = 6;
+    } else {
+      Uop->Imm = VmReadImmed16 (VmPtr, 2);
+      Size     = 4;
+    }
+    Uop->Type   = IDIOM_UOP_CMPIMM;
+    Uop->Opcode = OpcMasked;
+    Uop->Is64   = (BOOLEAN) ((Opcode & OPCODE_M_CMPI64) != 0);
+    return Size;
+
+  case OPCODE_MOVI:
+    Size = 2;
+    if ((Operands & MOVI_M_IMMDATA) != 0) {
+      if (!OPERAND1_INDIRECT (Operands)) {
+        return 0;
+      }
+      Uop->Index = VmReadIndex16 (VmPtr, 2, NULL);
+      Size       = 4;
+    }
+    if ((Opcode & MOVI_M_DATAWIDTH) == MOVI_DATAWIDTH16) {
+      Uop->Imm = VmReadImmed16 (VmPtr, Size);
+      Size    += 2;
+    } else if ((Opcode & MOVI_M_DATAWIDTH) == MOVI_DATAWIDTH32) {
+      Uop->Imm = VmReadImmed32 (VmPtr, Size);
+      Size    += 4;
+    } else if ((Opcode & MOVI_M_DATAWIDTH) == MOVI_DATAWIDTH64) {
+      Uop->Imm = VmReadImmed64 (VmPtr, Size);
+      Size    += 8;
+    } else {
+      return 0;
+    }
+    if ((Operands & MOVI_M_MOVEWIDTH) == MOVI_MOVEWIDTH8) {
+      Uop->Size = 1;
+    } else if ((Operands & MOVI_M_MOVEWIDTH) == MOVI_MOVEWIDTH16) {
+      Uop->Size = 2;
+    } else if ((Operands & MOVI_M_MOVEWIDTH) == MOVI_MOVEWIDTH32) {
+      Uop->Size = 4;
+    } else {
+      Uop->Size = 8;
+    }
+    Uop->Mask = (UINT64)~0 >> (64 - 8 * Uop->Size);
+    Uop->Type = (UINT8) (OPERAND1_INDIRECT (Operands) ? IDIOM_UOP_FILLIMM : IDIOM_UOP_MOVIMM);
+    return Size;
+
+  case OPCODE_MOVBW:
+  case OPCODE_MOVWW:
+  case OPCODE_MOVDW:
+  case OPCODE_MOVQW:
+  case OPCODE_MOVNW:
+  case OPCODE_MOVBD:
+  case OPCODE_MOVWD:
+  case OPCODE_MOVDD:
+  case OPCODE_MOVQD:
+  case OPCODE_MOVND:
+    Is32Index = (BOOLEAN) ((OpcMasked >= OPCODE_MOVBD) && (OpcMasked != OPCODE_MOVNW));
+    Size      = 2;
+    if ((Opcode & OPCODE_M_IMMED_OP1) != 0) {
+      if (!OPERAND1_INDIRECT (Operands)) {
+        return 0;
+      }
+      Uop->Index = Is32Index ? VmReadIndex32 (VmPtr, Size, NULL) : VmReadIndex16 (VmPtr, Size, NULL);
+      Size       = (UINT8) (Size + (Is32Index ? 4 : 2));
+    }
+    if ((Opcode & OPCODE_M_IMMED_OP2) != 0) {
+      Uop->Imm = Is32Index ? VmReadIndex32 (VmPtr, Size, NULL) : VmReadIndex16 (VmPtr, Size, NULL);
+      Size     = (UINT8) (Size + (Is32Index ? 4 : 2));
+    }
+    if ((OpcMasked == OPCODE_MOVBW) || (OpcMasked == OPCODE_MOVBD)) {
+      Uop->Size = 1;
+    } else if ((OpcMasked == OPCODE_MOVWW) || (OpcMasked == OPCODE_MOVWD)) {
+      Uop->Size = 2;
+    } else if ((OpcMasked == OPCODE_MOVDW) || (OpcMasked == OPCODE_MOVDD)) {
+      Uop->Size = 4;
+    } else if ((OpcMasked == OPCODE_MOVQW) || (OpcMasked == OPCODE_MOVQD)) {
+      Uop->Size = 8;
+    } else {
+      Uop->Size = sizeof (UINTN);
+    }
+    Uop->Mask = (UINT64)~0 >> (64 - 8 * Uop->Size);
+    if (OPERAND1_INDIRECT (Operands)) {
+      if (OPERAND2_INDIRECT (Operands)) {
+        Uop->Type = IDIOM_UOP_COPY;
+      } else {
+        //
+        // A fill value with an index would be an address, and the stack gap
+        // conversion of MOVxx may apply to it, so leave those alone.
+        //
+        if ((Opcode & OPCODE_M_IMMED_OP2) != 0) {
+          return 0;
+        }
+        Uop->Type = IDIOM_UOP_FILL;
+      }
+    } else {
+      Uop->Type = (UINT8) (OPERAND2_INDIRECT (Operands) ? IDIOM_UOP_LOAD : IDIOM_UOP_MOVREG);
+    }
+    return Size;
+
+  default:
+    return 0;
+  }
+}
+
+/**
+  Check whether a register is written by a loop body.
+
+  @param  Entry             The loop.
+  @param  Reg               The register number.
+
+  @retval TRUE              The register is written by the loop.
+  @retval FALSE             The register is invariant in the loop.
+
+**/
+BOOLEAN
+IdiomIsWritten (
+  IN IDIOM_ENTRY  *Entry,
+  IN UINT8        Reg
+  )
+{
+  UINTN     Index;
+  IDIOM_UOP *Uop;
+
+  for (Index = 0; Index < Entry->UopCount; Index++) {
+    Uop = &Entry->Uop[Index];
+    switch (Uop->Type) {
+    case IDIOM_UOP_ADD:
+    case IDIOM_UOP_SUB:
+    case IDIOM_UOP_MOVREG:
+    case IDIOM_UOP_MOVIMM:
+    case IDIOM_UOP_LOAD:
+      if (Uop->Reg1 == Reg) {
+        return TRUE;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  return FALSE;
+}
+
+/**
+  Check that a register only moves by a constant amount on each iteration of
+  a loop, so that the addresses it is used for are evenly spaced.
+
+  @param  Entry             The loop.
+  @param  Reg               The register number.
+
+  @retval TRUE              The register is an induction variable.
+  @retval FALSE             The register can't be used as a copy or fill address.
+
+**/
+BOOLEAN
+IdiomIsInduction (
+  IN IDIOM_ENTRY  *Entry,
+  IN UINT8        Reg
+  )
+{
+  UINTN     Index;
+  IDIOM_UOP *Uop;
+
+  for (Index = 0; Index < Entry->UopCount; Index++) {
+    Uop = &Entry->Uop[Index];
+    switch (Uop->Type) {
+    case IDIOM_UOP_ADD:
+    case IDIOM_UOP_SUB:
+      if ((Uop->Reg1 == Reg) &&
+          (!Uop->Is64 || (Uop->Reg2 == Reg) || IdiomIsWritten (Entry, Uop->Reg2))) {
+        return FALSE;
+      }
+      break;
+    case IDIOM_UOP_MOVREG:
+      if ((Uop->Reg1 == Reg) && ((Uop->Reg2 != Reg) || (Uop->Size != 8))) {
+        return FALSE;
+      }
+      break;
+    case IDIOM_UOP_MOVIMM:
+    case IDIOM_UOP_LOAD:
+      if (Uop->Reg1 == Reg) {
+        return FALSE;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  return TRUE;
+}
+
+/**
+  Compute how much an induction variable moves on each iteration of a loop.
+
+  @param  Entry             The loop.
+  @param  Gpr               The register values on entry to the loop.
+  @param  Reg               The register number.
+
+  @return The amount the register moves by.
+
+**/
+UINT64
+IdiomStride (
+  IN IDIOM_ENTRY  *Entry,
+  IN UINT64       *Gpr,
+  IN UINT8        Reg
+  )
+{
+  UINTN     Index;
+  IDIOM_UOP *Uop;
+  UINT64    Stride;
+
+  Stride = 0;
+  for (Index = 0; Index < Entry->UopCount; Index++) {
+    Uop = &Entry->Uop[Index];
+    if (Uop->Reg1 != Reg) {
+      continue;
+    }
+    if (Uop->Type == IDIOM_UOP_ADD) {
+      Stride += Gpr[Uop->Reg2] + Uop->Imm;
+    } else if (Uop->Type == IDIOM_UOP_SUB) {
+      Stride -= Gpr[Uop->Reg2] + Uop->Imm;
+    } else if (Uop->Type == IDIOM_UOP_MOVREG) {
+      Stride += Uop->Imm;
+    }
+  }
+  return Stride;
+}
+
+/**
+  Decode a loop body, and check that it is one of the idioms we can run
+  natively.
+
+  @param  VmPtr             A pointer to a VM context.
+  @param  Head              The first instruction of the loop.
+  @param  Tail              The address of the backward JMP8 of the loop.
+  @param  Entry             The cache entry to fill.
+
+**/
+VOID
+IdiomAnalyze (
+  IN  VM_CONTEXT  *VmPtr,
+  IN  VMIP        Head,
+  IN  VMIP        Tail,
+  OUT IDIOM_ENTRY *Entry
+  )
+{
+  VMIP      SavedIp;
+  UINT8     Size;
+  UINTN     Index;
+  UINTN     MemCount;
+  UINTN     CmpCount;
+  IDIOM_UOP *Uop;
+
+  ZeroMem (Entry, sizeof (IDIOM_ENTRY));
+  Entry->Head    = Head;
+  Entry->Tail    = Tail;
+  Entry->CondSet = (UINT8) (((*Tail & JMP_M_CS) != 0) ? 1 : 0);
+  if ((*Tail & CONDITION_M_CONDITIONAL) == 0) {
+    return;
+  }
+
+  //
+  // The decoding functions read from the current IP
+  //
+  SavedIp   = VmPtr->Ip;
+  VmPtr->Ip = Head;
+  while (VmPtr->Ip < Tail) {
+    if (Entry->UopCount == IDIOM_MAX_UOPS) {
+      break;
+    }
+    Size = IdiomDecode (VmPtr, &Entry->Uop[Entry->UopCount]);
+    if (Size == 0) {
+      break;
+    }
+    Entry->UopCount++;
+    VmPtr->Ip += Size;
+  }
+  Size      = (UINT8) (VmPtr->Ip == Tail);
+  VmPtr->Ip = SavedIp;
+  if (Size == 0) {
+    return;
+  }
+
+  //
+  // We need exactly one memory access and one compare, and R0 must be left
+  // alone, as the interpreter checks it against the stack limits.
+  //
+  MemCount = 0;
+  CmpCount = 0;
+  for (Index = 0; Index < Entry->UopCount; Index++) {
+    Uop = &Entry->Uop[Index];
+    switch (Uop->Type) {
+    case IDIOM_UOP_CMP:
+    case IDIOM_UOP_CMPIMM:
+      CmpCount++;
+      break;
+    case IDIOM_UOP_LOAD:
+    case IDIOM_UOP_COPY:
+    case IDIOM_UOP_FILL:
+    case IDIOM_UOP_FILLIMM:
+      Entry->MemUop = (UINT8) Index;
+      MemCount++;
+      break;
+    default:
+      break;
+    }
+    if (((Uop->Type <= IDIOM_UOP_MOVIMM) || (Uop->Type == IDIOM_UOP_LOAD)) && (Uop->Reg1 == 0)) {
+      return;
+    }
+  }
+  if ((MemCount != 1) || (CmpCount != 1)) {
+    return;
+  }
+
+  Uop = &Entry->Uop[Entry->MemUop];
+  switch (Uop->Type) {
+  case IDIOM_UOP_LOAD:
+    Entry->Kind = IDIOM_KIND_SCAN;
+    break;
+  case IDIOM_UOP_COPY:
+    if (IdiomIsInduction (Entry, Uop->Reg1) && IdiomIsInduction (Entry, Uop->Reg2)) {
+      Entry->Kind = IDIOM_KIND_COPY;
+    }
+    break;
+  case IDIOM_UOP_FILL:
+    if (IdiomIsInduction (Entry, Uop->Reg1) && !IdiomIsWritten (Entry, Uop->Reg2)) {
+      Entry->Kind = IDIOM_KIND_FILL;
+    }
+    break;
+  case IDIOM_UOP_FILLIMM:
+    if (IdiomIsInduction (Entry, Uop->Reg1)) {
+      Entry->Kind = IDIOM_KIND_FILL;
+    }
+    break;
+  }
+}
+
+/**
+  Evaluate a compare micro operation the same way as ExecuteCMP() and
+  ExecuteCMPI() do.
+
+  @param  Uop               The compare.
+  @param  Gpr               The current register values.
+
+  @return The new value of the condition flag.
+
+**/
+UINT8
+IdiomCompare (
+  IN IDIOM_UOP  *Uop,
+  IN UINT64     *Gpr
+  )
+{
+  INT64   Op1;
+  INT64   Op2;
+  BOOLEAN Flag;
+
+  Op1 = (INT64) Gpr[Uop->Reg1];
+  if (Uop->Type == IDIOM_UOP_CMP) {
+    Op2 = (INT64) (Gpr[Uop->Reg2] + Uop->Imm);
+  } else {
+    Op2 = Uop->Imm;
+  }
+
+  switch (Uop->Opcode) {
+  case OPCODE_CMPEQ:
+  case OPCODE_CMPIEQ:
+    Flag = Uop->Is64 ? (Op1 == Op2) : ((INT32) Op1 == (INT32) Op2);
+    break;
+  case OPCODE_CMPLTE:
+  case OPCODE_CMPILTE:
+    Flag = Uop->Is64 ? (Op1 <= Op2) : ((INT32) Op1 <= (INT32) Op2);
+    break;
+  case OPCODE_CMPGTE:
+  case OPCODE_CMPIGTE:
+    Flag = Uop->Is64 ? (Op1 >= Op2) : ((INT32) Op1 >= (INT32) Op2);
+    break;
+  case OPCODE_CMPULTE:
+  case OPCODE_CMPIULTE:
+    //
+    // 64-bit CMPI zero-extends its immediate for unsigned compares
+    //
+    if (Uop->Is64 && (Uop->Type == IDIOM_UOP_CMPIMM)) {
+      Op2 = (INT64) (UINT32) Op2;
+    }
+    Flag = Uop->Is64 ? ((UINT64) Op1 <= (UINT64) Op2) : ((UINT32) Op1 <= (UINT32) Op2);
+    break;
+  default:
+    if (Uop->Is64 && (Uop->Type == IDIOM_UOP_CMPIMM)) {
+      Op2 = (INT64) (UINT32) Op2;
+    }
+    Flag = Uop->Is64 ? ((UINT64) Op1 >= (UINT64) Op2) : ((UINT32) Op1 >= (UINT32) Op2);
+    break;
+  }
+
+  return (UINT8) (Flag ? 1 : 0);
+}
+
+/**
+  Read memory for a scan loop, the same way as the VmReadMem functions do.
+
+  @param  Addr              The address to read from.
+  @param  Size              The size of the access, in bytes.
+
+  @return The zero-extended data.
+
+**/
+UINT64
+IdiomRead (
+  IN UINTN  Addr,
+  IN UINT8  Size
+  )
+{
+  UINT64  Data;
+
+  Data = 0;
+  CopyMem (&Data, (VOID *) Addr, Size);
+  return Data;
+}
+
+/**
+  Run one iteration of a loop body on a copy of the registers.
+
+  @param  Entry             The loop.
+  @param  Gpr               The register values, updated on return.
+  @param  MemAddr           Returns the destination address of the memory access.
+  @param  SrcAddr           Returns the source address of a copy.
+
+  @return The new value of the condition flag.
+
+**/
+UINT8
+IdiomStep (
+  IN     IDIOM_ENTRY  *Entry,
+  IN OUT UINT64       *Gpr,
+  OUT    UINTN        *MemAddr,
+  OUT    UINTN        *SrcAddr
+  )
+{
+  UINTN     Index;
+  IDIOM_UOP *Uop;
+  UINT64    Result;
+  UINT8     Flag;
+
+  Flag = 0;
+  for (Index = 0; Index < Entry->UopCount; Index++) {
+    Uop = &Entry->Uop[Index];
+    switch (Uop->Type) {
+    case IDIOM_UOP_ADD:
+    case IDIOM_UOP_SUB:
+      if (Uop->Type == IDIOM_UOP_ADD) {
+        Result = Gpr[Uop->Reg1] + (Gpr[Uop->Reg2] + Uop->Imm);
+      } else {
+        Result = Gpr[Uop->Reg1] - (Gpr[Uop->Reg2] + Uop->Imm);
+      }
+      Gpr[Uop->Reg1] = Uop->Is64 ? Result : (Result & 0xFFFFFFFF);
+      break;
+    case IDIOM_UOP_MOVREG:
+      Gpr[Uop->Reg1] = (Gpr[Uop->Reg2] + Uop->Imm) & Uop->Mask;
+      break;
+    case IDIOM_UOP_MOVIMM:
+      Gpr[Uop->Reg1] = (UINT64) Uop->Imm & Uop->Mask;
+      break;
+    case IDIOM_UOP_CMP:
+    case IDIOM_UOP_CMPIMM:
+      Flag = IdiomCompare (Uop, Gpr);
+      break;
+    case IDIOM_UOP_LOAD:
+      Gpr[Uop->Reg1] = IdiomRead ((UINTN) (Gpr[Uop->Reg2] + Uop->Imm), Uop->Size) & Uop->Mask;
+      break;
+    default:
+      //
+      // Copies and fills are applied in bulk by the caller
+      //
+      *MemAddr = (UINTN) (Gpr[Uop->Reg1] + Uop->Index);
+      *SrcAddr = (UINTN) (Gpr[Uop->Reg2] + Uop->Imm);
+      break;
+    }
+  }
+  return Flag;
+}
+
+/**
+  Fill memory with a value of 1, 2, 4 or 8 bytes.
+
+  @param  Buffer            The buffer to fill.
+  @param  Count             The number of values to write.
+  @param  Size              The size of the value, in bytes.
+  @param  Value             The value.
+
+**/
+VOID
+IdiomFill (
+  IN VOID    *Buffer,
+  IN UINTN   Count,
+  IN UINT8   Size,
+  IN UINT64  Value
+  )
+{
+  UINT8   *Ptr;
+  UINTN   Index;
+
+  if (Size == 1) {
+    SetMem (Buffer, Count, (UINT8) Value);
+    return;
+  }
+
+  //
+  // Unaligned fills are written one value at a time, as the interpreter does
+  //
+  if (((UINTN) Buffer & (Size - 1)) != 0) {
+    for (Ptr = Buffer; Count > 0; Count--, Ptr += Size) {
+      CopyMem (Ptr, &Value, Size);
+    }
+    return;
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    if (Size == 2) {
+      ((UINT16 *) Buffer)[Index] = (UINT16) Value;
+    } else if (Size == 4) {
+      ((UINT32 *) Buffer)[Index] = (UINT32) Value;
+    } else {
+      ((UINT64 *) Buffer)[Index] = Value;
+    }
+  }
+}
+
+/**
+  Flush the loop cache. This must be called when EBC code is unloaded, as
+  new code may then be loaded at the same address.
+
+**/
+VOID
+EbcIdiomFlushCache (
+  VOID
+  )
+{
+  EFI_TPL   OldTpl;
+
+  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  ZeroMem (mIdiomCache, sizeof (mIdiomCache));
+  gBS->RestoreTPL (OldTpl);
+}
+
+/**
+  Called when the backward JMP8 of a loop was taken, to run the rest of the
+  loop natively if it is a copy, fill or scan idiom. On return, the VM is in
+  the same state as if the interpreter had run the loop, either to its end or
+  for a number of iterations.
+
+  @param  VmPtr             A pointer to a VM context, with its IP set to the
+                            head of the loop.
+  @param  Tail              The address of the JMP8 instruction.
+
+  @retval TRUE              Some iterations of the loop were run natively.
+  @retval FALSE             The loop is not an idiom, or could not be run.
+
+**/
+BOOLEAN
+VmIdiomFastForward (
+  IN VM_CONTEXT *VmPtr,
+  IN VMIP       Tail
+  )
+{
+  IDIOM_ENTRY *Slot;
+  IDIOM_ENTRY Entry;
+  IDIOM_UOP   *Uop;
+  UINTN       Sequence;
+  EFI_TPL     OldTpl;
+  UINT64      Gpr[8];
+  UINT64      Stride;
+  UINTN       Limit;
+  UINTN       Count;
+  UINTN       Gap;
+  UINTN       Dst;
+  UINTN       Src;
+  UINTN       Unused;
+  UINTN       Length;
+  UINT8       Flag;
+
+  if (VMFLAG_ISSET (VmPtr, VMFLAGS_STEP)) {
+    return FALSE;
+  }
+
+  //
+  // Get the loop from the cache. An EBC call from an event may update the
+  // same slot while we read it, in which case the sequence changes.
+  //
+  Slot     = &mIdiomCache[((UINTN) VmPtr->Ip >> 1) & (IDIOM_CACHE_SIZE - 1)];
+  Sequence = Slot->Sequence;
+  CopyMem (&Entry, Slot, sizeof (IDIOM_ENTRY));
+  if (((Sequence & 1) != 0) || (Slot->Sequence != Sequence)) {
+    return FALSE;
+  }
+  if ((Entry.Head != VmPtr->Ip) || (Entry.Tail != Tail)) {
+    IdiomAnalyze (VmPtr, VmPtr->Ip, Tail, &Entry);
+    OldTpl           = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+    Entry.Sequence   = Slot->Sequence + 2;
+    Slot->Sequence  += 1;
+    CopyMem ((UINT8 *) Slot + sizeof (UINTN), (UINT8 *) &Entry + sizeof (UINTN), sizeof (IDIOM_ENTRY) - sizeof (UINTN));
+    Slot->Sequence   = Entry.Sequence;
+    gBS->RestoreTPL (OldTpl);
+  }
+  if (Entry.Kind == IDIOM_KIND_NONE) {
+    return FALSE;
+  }
+
+  //
+  // Each further taken branch is a watchdog safepoint, so stop short of
+  // running out of budget, and let the interpreter deal with it.
+  //
+  if (mEbcVmPrivate->WatchdogBudget <= 1) {
+    return FALSE;
+  }
+  Limit = IDIOM_MAX_ITERATIONS;
+  if (mEbcVmPrivate->WatchdogBudget - 1 < Limit) {
+    Limit = (UINTN) mEbcVmPrivate->WatchdogBudget - 1;
+  }
+
+  CopyMem (Gpr, VmPtr->Gpr, sizeof (Gpr));
+  Uop = &Entry.Uop[Entry.MemUop];
+  Dst = 0;
+  Src = 0;
+
+  //
+  // Copies and fills need to move by exactly their access size on each
+  // iteration, in the same direction for the source and destination.
+  //
+  Stride = 0;
+  if (Entry.Kind != IDIOM_KIND_SCAN) {
+    Stride = IdiomStride (&Entry, Gpr, Uop->Reg1);
+    if ((Stride != Uop->Size) && (Stride != (UINT64) -(INT64) Uop->Size)) {
+      return FALSE;
+    }
+    if ((Entry.Kind == IDIOM_KIND_COPY) && (IdiomStride (&Entry, Gpr, Uop->Reg2) != Stride)) {
+      return FALSE;
+    }
+  }
+
+  //
+  // Step the registers until the loop exits, or we reach the limit
+  //
+  Count = 0;
+  do {
+    if (Count == 0) {
+      Flag = IdiomStep (&Entry, Gpr, &Dst, &Src);
+      //
+      // A copy where the destination is ahead of the source reads back what
+      // it wrote before, which only a sequential copy gets right. Stop before
+      // the first of these reads.
+      //
+      if (Entry.Kind == IDIOM_KIND_COPY) {
+        Gap = (Stride == Uop->Size) ? (Dst - Src) : (Src - Dst);
+        if ((Dst != Src) && (Gap < Limit * Uop->Size)) {
+          Limit = (Gap < Uop->Size) ? 1 : (Gap / Uop->Size);
+        }
+      }
+    } else {
+      Flag = IdiomStep (&Entry, Gpr, &Unused, &Unused);
+    }
+    Count++;
+  } while ((Flag == Entry.CondSet) && (Count < Limit));
+
+  //
+  // Apply the memory accesses in bulk, unless they would overwrite the loop
+  //
+  if (Entry.Kind != IDIOM_KIND_SCAN) {
+    Length = Count * Uop->Size;
+    if (Stride != Uop->Size) {
+      Dst = Dst + Uop->Size - Length;
+      Src = Src + Uop->Size - Length;
+    }
+    if ((Dst + Length < Dst) || (Src + Length < Src) ||
+        ((Dst < (UINTN) Tail + 2) && ((UINTN) Entry.Head < Dst + Length))) {
+      return FALSE;
+    }
+    if (Entry.Kind == IDIOM_KIND_COPY) {
+      CopyMem ((VOID *) Dst, (VOID *) Src, Length);
+    } else if (Uop->Type == IDIOM_UOP_FILL) {
+      IdiomFill ((VOID *) Dst, Count, Uop->Size, VmPtr->Gpr[Uop->Reg2]);
+    } else {
+      IdiomFill ((VOID *) Dst, Count, Uop->Size, (UINT64) Uop->Imm);
+    }
+  }
+
+  //
+  // Update the VM as if it had run the loop. The last branch was taken if
+  // we stopped on the limit, in which case we're back at the loop head.
+  //
+  CopyMem (VmPtr->Gpr, Gpr, sizeof (Gpr));
+  EBC_PERF_ADD (mEbcVmPrivate, Instructions, Count * (Entry.UopCount + 1));
+  if (Flag != 0) {
+    VMFLAG_SET (VmPtr, VMFLAGS_CC);
+  } else {
+    VMFLAG_CLEAR (VmPtr, (UINT64)VMFLAGS_CC);
+  }
+  if (Flag == Entry.CondSet) {
+    mEbcVmPrivate->WatchdogBudget -= Count;
+  } else {
+    mEbcVmPrivate->WatchdogBudget -= Count - 1;
+    VmPtr->Ip = Tail + 2;
+  }
+
+  return TRUE;
+}
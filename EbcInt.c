@@ -18,25 +18,6 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "EbcExecute.h"
 #include "EbcDebuggerHook.h"
 
-//
-// We'll keep track of all thunks we create in a linked list. Each
-// thunk is tied to an image handle, so we have a linked list of
-// image handles, with each having a linked list of thunks allocated
-// to that image handle.
-//
-typedef struct _EBC_THUNK_LIST EBC_THUNK_LIST;
-struct _EBC_THUNK_LIST {
-  VOID            *ThunkBuffer;
-  EBC_THUNK_LIST  *Next;
-};
-
-typedef struct _EBC_IMAGE_LIST EBC_IMAGE_LIST;
-struct _EBC_IMAGE_LIST {
-  EBC_IMAGE_LIST  *Next;
-  EFI_HANDLE      ImageHandle;
-  EBC_THUNK_LIST  *ThunkList;
-};
-
 /**
   This routine is called by the core when an image is being unloaded from
   memory. Basically we now have the opportunity to do any necessary cleanup.
@@ -188,13 +169,21 @@ InitEbcVmTestProtocol (
 /**
   Returns the EFI_UNSUPPORTED Status.
 
+  @param  This        The EBC test protocol instance.
+  @param  AsmText     The text of the instruction.
+  @param  Buffer      The buffer of the instruction.
+  @param  BufferLen   The length of the buffer.
+
   @return EFI_UNSUPPORTED  This function always return EFI_UNSUPPORTED status.
 
 **/
 EFI_STATUS
 EFIAPI
 EbcVmTestUnsupported (
-  VOID
+  IN     EFI_EBC_VM_TEST_PROTOCOL   *This,
+  IN     CHAR16                     *AsmText,
+  IN OUT INT8                       *Buffer,
+  IN OUT UINTN                      *BufferLen
   );
 
 /**
@@ -296,8 +285,9 @@ EbcDebugRegisterExceptionCallback (
   );
 
 /**
-  This EBC debugger protocol service is called by the debug agent.  Required
-  for DebugSupport compliance but is only stubbed out for EBC.
+  This EBC debugger protocol service is called by the debug agent after it has
+  modified EBC code, for instance to insert a breakpoint. The loops and blocks
+  that were decoded from the old code are flushed.
 
   @param  This                  A pointer to the EFI_DEBUG_SUPPORT_PROTOCOL
                                 instance.
@@ -327,6 +317,10 @@ EbcDebugInvalidateInstructionCache (
 // a This pointer.
 //
 EBC_IMAGE_LIST         *mEbcImageList = NULL;
+//
+// Image of the last execution that was counted
+//
+EBC_IMAGE_LIST         *mEbcExecCountImage = NULL;
 
 //
 // Callback function to flush the icache after thunk creation
@@ -341,14 +335,42 @@ EFI_EXCEPTION_CALLBACK mDebugExceptionCallback[MAX_EBC_EXCEPTION + 1] = {NULL};
 
 VOID                   *mStackBuffer[MAX_STACK_NUM];
 EFI_HANDLE             mStackBufferIndex[MAX_STACK_NUM];
+UINTN                  mStackBufferSize[MAX_STACK_NUM];
 UINTN                  mStackNum = 0;
 
+//
+// Stack size for the images that don't have one set by the policy table or
+// through EbcSetImageStackSize()
+//
+UINTN                  mEbcDefaultStackSize = EBC_DEFAULT_STACK_SIZE;
+
+//
+// Watchdog budget for the images that don't have one set by the policy table
+// or through EbcSetImageWatchdogBudget(). Disabled unless the platform asks
+// for it.
+//
+UINT64                 mEbcDefaultWatchdogBudget = EBC_DEFAULT_WATCHDOG_BUDGET;
+
+//
+// Whether the interpreter may run parts of the EBC code natively, such as the
+// memory copy and fill loops, or as compiled blocks. The debugger turns this
+// off, as it needs to see every instruction.
+//
+BOOLEAN                mEbcFastPathEnabled = TRUE;
+
 //
 // Event for Periodic callback
 //
 EFI_EVENT              mEbcPeriodicEvent;
 VM_CONTEXT             *mVmPtr = NULL;
 
+//
+// Interpreter state of the running call into EBC. Outside of the calls, it
+// is an idle state that neither counts nor runs the watchdog.
+//
+EBC_VM_PRIVATE         mEbcVmIdle = { EBC_WATCHDOG_DISABLED, NULL };
+EBC_VM_PRIVATE         *mEbcVmPrivate = &mEbcVmIdle;
+
 
 /**
   Initializes the VM EFI interface.  Allocates memory for the VM interface
@@ -458,6 +480,8 @@ InitializeEbcDriver (
     goto ErrorExit;
   }
 
+  EbcInitClock ();
+
   //
   // Allocate memory for our debug protocol. Then fill in the blanks.
   //
@@ -502,6 +526,13 @@ InitializeEbcDriver (
     InitEbcVmTestProtocol (&ImageHandle);
   DEBUG_CODE_END ();
 
+#if EBC_PERFORMANCE_COUNTERS
+  //
+  // Produce the performance protocol. Not required for execution either.
+  //
+  InitEbcPerformanceProtocol (&ImageHandle);
+#endif
+
   EbcDebuggerHookInit (ImageHandle, EbcDebugProtocol);
 
   return EFI_SUCCESS;
@@ -575,7 +606,10 @@ EbcCreateThunk (
   OUT VOID              **Thunk
   )
 {
-  EFI_STATUS  Status;
+  EFI_STATUS                 Status;
+  EFI_LOADED_IMAGE_PROTOCOL  *LoadedImage;
+  EBC_IMAGE_LIST             *ImageList;
+  UINTN                      Size;
 
   Status = EbcCreateThunks (
             ImageHandle,
@@ -583,7 +617,48 @@ EbcCreateThunk (
             Thunk,
             FLAG_THUNK_ENTRY_POINT
             );
-  return Status;
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Pick up the current addresses of the services that CALLEX calls directly
+  //
+  EbcInitCallExServices ();
+
+  //
+  // Record where the image lives, so that the thunks it creates for its
+  // protocol services can be tied back to it when they are called.
+  //
+  ImageList = EbcGetImageList (ImageHandle, FALSE);
+  if (ImageList != NULL) {
+    Status = gBS->HandleProtocol (
+                    ImageHandle,
+                    &gEfiLoadedImageProtocolGuid,
+                    (VOID **) &LoadedImage
+                    );
+    if (!EFI_ERROR (Status)) {
+      ImageList->ImageBase = (UINTN) LoadedImage->ImageBase;
+      ImageList->ImageSize = (UINTN) LoadedImage->ImageSize;
+      EbcApplyImagePolicy (ImageList, LoadedImage);
+      //
+      // Size the execution counters after the image. Without them, the image
+      // runs the same, only uncounted.
+      //
+      if (ImageList->ExecCount == NULL) {
+        Size = EBC_EXEC_COUNT_MIN;
+        while ((Size < EBC_EXEC_COUNT_MAX) && (Size * EBC_EXEC_COUNT_DENSITY < ImageList->ImageSize)) {
+          Size *= 2;
+        }
+        ImageList->ExecCount = AllocateZeroPool (Size * sizeof (EBC_EXEC_COUNT));
+        if (ImageList->ExecCount != NULL) {
+          ImageList->ExecCountSize = Size;
+        }
+      }
+    }
+  }
+
+  return EFI_SUCCESS;
 }
 
 
@@ -700,8 +775,9 @@ EbcDebugRegisterExceptionCallback (
 
 
 /**
-  This EBC debugger protocol service is called by the debug agent.  Required
-  for DebugSupport compliance but is only stubbed out for EBC.
+  This EBC debugger protocol service is called by the debug agent after it has
+  modified EBC code, for instance to insert a breakpoint. The loops and blocks
+  that were decoded from the old code are flushed.
 
   @param  This                  A pointer to the EFI_DEBUG_SUPPORT_PROTOCOL
                                 instance.
@@ -724,6 +800,9 @@ EbcDebugInvalidateInstructionCache (
   IN UINT64                              Length
   )
 {
+  EbcIdiomFlushCache ();
+  EbcClosureFlushCache ();
+
   return EFI_SUCCESS;
 }
 
@@ -755,6 +834,7 @@ EbcDebugSignalException (
   //
   VmPtr->ExceptionFlags |= ExceptionFlags;
   VmPtr->LastException = (UINTN) ExceptionType;
+  EBC_PERF_ADD (mEbcVmPrivate, Exceptions, 1);
   //
   // If it's a fatal exception, then flag it in the VM context in case an
   // attached debugger tries to return from it.
@@ -962,7 +1042,10 @@ EbcPeriodicNotifyFunction (
 
   VmPtr = *(VM_CONTEXT **)Context;
 
-  if (VmPtr != NULL) {
+  //
+  // The interpreter calls back on its own while the virtual clock runs
+  //
+  if ((VmPtr != NULL) && !mEbcVirtualClock) {
     EbcDebugPeriodic (VmPtr);
   }
 
@@ -970,6 +1053,23 @@ EbcPeriodicNotifyFunction (
 }
 
 
+/**
+  Call the periodic callback once the virtual clock has reached its next
+  deadline, and set the one after.
+
+  @param  VmPtr                  The VM context of the running call.
+
+**/
+VOID
+EbcVirtualClockPeriodic (
+  IN VM_CONTEXT *VmPtr
+  )
+{
+  mEbcVirtualDeadline = mEbcVirtualTime + EBC_VIRTUAL_PERIODIC_TICKS;
+  EbcDebugPeriodic (VmPtr);
+}
+
+
 /**
   The VM interpreter calls this function on a periodic basis to support
   the EFI debug support protocol.
@@ -1075,6 +1175,18 @@ EbcUnloadImage (
   if (ImageList == NULL) {
     return EFI_INVALID_PARAMETER;
   }
+
+  if (ImageList->StackCount != 0) {
+    DEBUG ((
+      EFI_D_INFO,
+      "EBC image %p - peak stack usage 0x%x/0x%x over %d calls\n",
+      ImageHandle,
+      ImageList->StackPeak,
+      EbcGetImageStackSize (ImageList),
+      ImageList->StackCount
+      ));
+  }
+
   //
   // Free up all the thunk buffers and thunks list elements for this image
   // handle.
@@ -1100,8 +1212,24 @@ EbcUnloadImage (
   //
   // Now free up the image list element
   //
+  if (mEbcExecCountImage == ImageList) {
+    mEbcExecCountImage = NULL;
+  }
+  if (ImageList->ExecCount != NULL) {
+    FreePool (ImageList->ExecCount);
+  }
+#if EBC_INSTRUCTION_MIX
+  EbcMixRetire (ImageList);
+#endif
   FreePool (ImageList);
 
+  //
+  // The loops and blocks we decoded may be replaced by new code at the same
+  // address
+  //
+  EbcIdiomFlushCache ();
+  EbcClosureFlushCache ();
+
   EbcDebuggerHookEbcUnloadImage (ImageHandle);
 
   return EFI_SUCCESS;
@@ -1142,29 +1270,11 @@ EbcAddImageThunk (
     }
   }
   //
-  // Go through our list of known image handles and see if we've already
-  // created a image list element for this image handle.
+  // Find the image list element for this image handle, or create it.
   //
-  for (ImageList = mEbcImageList; ImageList != NULL; ImageList = ImageList->Next) {
-    if (ImageList->ImageHandle == ImageHandle) {
-      break;
-    }
-  }
-
+  ImageList = EbcGetImageList (ImageHandle, TRUE);
   if (ImageList == NULL) {
-    //
-    // Allocate a new one
-    //
-    ImageList = AllocatePool (sizeof (EBC_IMAGE_LIST));
-
-    if (ImageList == NULL) {
-      return EFI_OUT_OF_RESOURCES;
-    }
-
-    ImageList->ThunkList    = NULL;
-    ImageList->ImageHandle  = ImageHandle;
-    ImageList->Next         = mEbcImageList;
-    mEbcImageList           = ImageList;
+    return EFI_OUT_OF_RESOURCES;
   }
   //
   // Ok, now create a new thunk element to add to the list
@@ -1183,6 +1293,159 @@ EbcAddImageThunk (
   return EFI_SUCCESS;
 }
 
+/**
+  Find the image list element for an image handle, and optionally create it.
+
+  @param  ImageHandle   The image handle to look for.
+  @param  Create        If TRUE, create the element if it doesn't exist yet.
+
+  @return The image list element, or NULL if not found or out of resources.
+
+**/
+EBC_IMAGE_LIST *
+EbcGetImageList (
+  IN EFI_HANDLE ImageHandle,
+  IN BOOLEAN    Create
+  )
+{
+  EBC_IMAGE_LIST  *ImageList;
+
+  //
+  // Go through our list of known image handles and see if we've already
+  // created a image list element for this image handle.
+  //
+  for (ImageList = mEbcImageList; ImageList != NULL; ImageList = ImageList->Next) {
+    if (ImageList->ImageHandle == ImageHandle) {
+      return ImageList;
+    }
+  }
+
+  if (!Create) {
+    return NULL;
+  }
+
+  //
+  // Allocate a new one
+  //
+  ImageList = AllocateZeroPool (sizeof (EBC_IMAGE_LIST));
+  if (ImageList == NULL) {
+    return NULL;
+  }
+
+  ImageList->ImageHandle  = ImageHandle;
+  ImageList->Next         = mEbcImageList;
+  mEbcImageList           = ImageList;
+  return ImageList;
+}
+
+/**
+  Find the handle of the image that contains an EBC address.
+
+  @param  Address       An address in the code of an EBC image.
+
+  @return The image handle, or (EFI_HANDLE)-1 if the address could not be tied
+          to a known image.
+
+**/
+EFI_HANDLE
+EbcFindImageHandle (
+  IN UINTN Address
+  )
+{
+  EBC_IMAGE_LIST  *ImageList;
+
+  for (ImageList = mEbcImageList; ImageList != NULL; ImageList = ImageList->Next) {
+    if ((Address >= ImageList->ImageBase) &&
+        (Address - ImageList->ImageBase < ImageList->ImageSize)) {
+      return ImageList->ImageHandle;
+    }
+  }
+
+  return (EFI_HANDLE)(UINTN)-1;
+}
+
+/**
+  Count one execution of a function entry or a loop head, in the table of the
+  image that contains it.
+
+  @param  Address       The address of the function or loop head.
+  @param  Kind          EBC_EXEC_COUNT_CALL or EBC_EXEC_COUNT_LOOP.
+
+  @return The number of times the address was counted, or 0 if it is not part
+          of a known image.
+
+**/
+UINT32
+EbcCountExecution (
+  IN UINTN  Address,
+  IN UINT32 Kind
+  )
+{
+  EBC_IMAGE_LIST  *ImageList;
+  EBC_EXEC_COUNT  *Entry;
+  UINT32          Key;
+  UINTN           Index;
+  UINTN           Probe;
+
+  //
+  // Most calls and loops stay within the same image as the previous one
+  //
+  ImageList = mEbcExecCountImage;
+  if ((ImageList == NULL) || (Address - ImageList->ImageBase >= ImageList->ImageSize)) {
+    for (ImageList = mEbcImageList; ImageList != NULL; ImageList = ImageList->Next) {
+      if ((Address >= ImageList->ImageBase) &&
+          (Address - ImageList->ImageBase < ImageList->ImageSize)) {
+        break;
+      }
+    }
+    if (ImageList == NULL) {
+      return 0;
+    }
+    mEbcExecCountImage = ImageList;
+  }
+  if (ImageList->ExecCount == NULL) {
+    return 0;
+  }
+
+  Key   = (UINT32) (Address - ImageList->ImageBase) | Kind;
+  Index = (Key >> 1) & (ImageList->ExecCountSize - 1);
+  for (Probe = 0; Probe < EBC_EXEC_COUNT_PROBES; Probe++) {
+    Entry = &ImageList->ExecCount[Index];
+    if (Entry->Key == 0) {
+      Entry->Key = Key;
+    }
+    if (Entry->Key == Key) {
+      if (Entry->Count != 0xFFFFFFFF) {
+        Entry->Count++;
+      }
+      return Entry->Count;
+    }
+    Index = (Index + 1) & (ImageList->ExecCountSize - 1);
+  }
+
+  ImageList->ExecCountLost++;
+  return 0;
+}
+
+/**
+  Reset the execution counters of all the images.
+
+**/
+VOID
+EbcResetExecCounts (
+  VOID
+  )
+{
+  EBC_IMAGE_LIST  *ImageList;
+
+  for (ImageList = mEbcImageList; ImageList != NULL; ImageList = ImageList->Next) {
+    if (ImageList->ExecCount != NULL) {
+      ZeroMem (ImageList->ExecCount, ImageList->ExecCountSize * sizeof (EBC_EXEC_COUNT));
+    }
+    ImageList->ExecCountLost = 0;
+  }
+}
+
 /**
   Registers a callback function that the EBC interpreter calls to flush the
   processor instruction cache following creation of thunks.
@@ -1250,24 +1513,285 @@ GetEBCStack(
   OUT UINTN      *BufferIndex
   )
 {
-  UINTN   Index;
-  EFI_TPL OldTpl;
+  UINTN           Index;
+  UINTN           Free;
+  UINTN           Best;
+  UINTN           Size;
+  VOID            *Buffer;
+  EBC_IMAGE_LIST  *ImageList;
+  EFI_TPL         OldTpl;
+
+  ImageList = EbcGetImageList (Handle, FALSE);
+  Size      = EbcGetImageStackSize (ImageList);
+
   OldTpl = gBS->RaiseTPL(TPL_HIGH_LEVEL);
+  //
+  // Prefer the smallest free stack that is large enough. Only if there is
+  // none do we take any free stack, and grow it.
+  //
+  Free = mStackNum;
+  Best = mStackNum;
   for (Index = 0; Index < mStackNum; Index ++) {
-    if (mStackBufferIndex[Index] == NULL) {
-      mStackBufferIndex[Index] = Handle;
-      break;
+    if (mStackBufferIndex[Index] != NULL) {
+      continue;
     }
+    if (Free == mStackNum) {
+      Free = Index;
+    }
+    if ((mStackBufferSize[Index] >= Size) &&
+        ((Best == mStackNum) || (mStackBufferSize[Index] < mStackBufferSize[Best]))) {
+      Best = Index;
+    }
+  }
+  Index = (Best < mStackNum) ? Best : Free;
+  if (Index < mStackNum) {
+    mStackBufferIndex[Index] = Handle;
+#if EBC_PERFORMANCE_COUNTERS
+    if (mEbcPerfEnabled) {
+      EbcPerfUpdateStacks (Handle);
+    }
+#endif
   }
   gBS->RestoreTPL(OldTpl);
   if (Index == mStackNum) {
     return EFI_OUT_OF_RESOURCES;
   }
+
+  //
+  // Grow the stack if needed. We own the stack at this stage, but can only
+  // allocate memory if we were called at or below TPL_NOTIFY. Otherwise, or
+  // if the allocation fails, just use the stack with its current size.
+  //
+  if ((mStackBufferSize[Index] < Size) && (OldTpl <= TPL_NOTIFY)) {
+    Buffer = AllocatePool (Size);
+    if (Buffer != NULL) {
+      FreePool (mStackBuffer[Index]);
+      mStackBuffer[Index]     = Buffer;
+      mStackBufferSize[Index] = Size;
+      InitEBCStackGuard (Buffer);
+      InitEBCStackFill (Buffer, STACK_REMAIN_SIZE, Size);
+    }
+  }
+
   *BufferIndex = Index;
   *StackBuffer = mStackBuffer[Index];
   return EFI_SUCCESS;
 }
 
+/**
+  Get the size of an EBC stack, as allocated for the image it was given to.
+
+  @param  Index         The index of the EBC stack, as returned by GetEBCStack().
+
+  @return The size of the EBC stack, in bytes.
+
+**/
+UINTN
+GetEBCStackSize (
+  IN UINTN Index
+  )
+{
+  return mStackBufferSize[Index];
+}
+
+/**
+  Get the size of the EBC stack to use when running code from an image: the
+  one set by the debugger, the one set by the policy table, or the default.
+
+  @param  ImageList     The image list element of the image, or NULL for an
+                        unknown image.
+
+  @return The size of the EBC stack, in bytes.
+
+**/
+UINTN
+EbcGetImageStackSize (
+  IN EBC_IMAGE_LIST *ImageList
+  )
+{
+  if (ImageList != NULL) {
+    if (ImageList->StackSize != 0) {
+      return ImageList->StackSize;
+    }
+    if (ImageList->StackPolicy != 0) {
+      return ImageList->StackPolicy;
+    }
+  }
+  return mEbcDefaultStackSize;
+}
+
+/**
+  Override the size of the EBC stack to use when running code from a loaded
+  EBC image, in place of the one set by the policy table.
+
+  This can be called for an image that has been loaded but not started yet.
+  The new size is applied on the next entry into the image, be it through its
+  entry point or through a thunk.
+
+  @param  ImageHandle           The image to set the stack size for, or NULL
+                                to set the default for all the other images.
+  @param  StackSize             The stack size, in bytes, including the guard
+                                region. 0 restores the size of the policy
+                                table, or the default size.
+
+  @retval EFI_SUCCESS           The stack size was set.
+  @retval EFI_INVALID_PARAMETER StackSize is too small to be usable.
+  @retval EFI_NOT_FOUND         ImageHandle is not a loaded EBC image.
+
+**/
+EFI_STATUS
+EbcSetImageStackSize (
+  IN EFI_HANDLE ImageHandle,
+  IN UINTN      StackSize
+  )
+{
+  EBC_IMAGE_LIST  *ImageList;
+
+  if ((StackSize != 0) && (StackSize < STACK_POOL_SIZE_MIN)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  StackSize = EBC_ALIGN_STACK_SIZE (StackSize);
+
+  if (ImageHandle == NULL) {
+    mEbcDefaultStackSize = (StackSize != 0) ? StackSize : EBC_DEFAULT_STACK_SIZE;
+    return EFI_SUCCESS;
+  }
+
+  //
+  // Only the images that were loaded, and so had their policy applied, can
+  // be overridden
+  //
+  ImageList = EbcGetImageList (ImageHandle, FALSE);
+  if ((ImageList == NULL) || (ImageList->ImageSize == 0)) {
+    return EFI_NOT_FOUND;
+  }
+  ImageList->StackSize = StackSize;
+  return EFI_SUCCESS;
+}
+
+/**
+  Override the watchdog budget of a loaded EBC image, in place of the one set
+  by the policy table.
+
+  The budget is counted in safepoints, which are the backward jumps and the
+  calls executed by the interpreter, and applies to each call into the image.
+  A call that runs out of it is aborted with EFI_TIMEOUT.
+
+  @param  ImageHandle           The image to set the budget for, or NULL to
+                                set the default for all the other images.
+  @param  Budget                The number of safepoints allowed per call. 0
+                                restores the budget of the policy table, or
+                                the default, EBC_WATCHDOG_DISABLED disables
+                                the watchdog.
+
+  @retval EFI_SUCCESS           The budget was set.
+  @retval EFI_NOT_FOUND         ImageHandle is not a loaded EBC image.
+
+**/
+EFI_STATUS
+EbcSetImageWatchdogBudget (
+  IN EFI_HANDLE ImageHandle,
+  IN UINT64     Budget
+  )
+{
+  EBC_IMAGE_LIST  *ImageList;
+
+  if (ImageHandle == NULL) {
+    mEbcDefaultWatchdogBudget = (Budget != 0) ? Budget : EBC_DEFAULT_WATCHDOG_BUDGET;
+    return EFI_SUCCESS;
+  }
+
+  ImageList = EbcGetImageList (ImageHandle, FALSE);
+  if ((ImageList == NULL) || (ImageList->ImageSize == 0)) {
+    return EFI_NOT_FOUND;
+  }
+  ImageList->WatchdogBudget = Budget;
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the watchdog budget that applies to a call into an EBC image: the one
+  set by the debugger, the one set by the policy table, or the default.
+
+  @param  ImageHandle   The image handle, as returned by EbcFindImageHandle().
+
+  @return The number of safepoints allowed for the call.
+
+**/
+UINT64
+EbcGetImageWatchdogBudget (
+  IN EFI_HANDLE ImageHandle
+  )
+{
+  EBC_IMAGE_LIST  *ImageList;
+
+  ImageList = EbcGetImageList (ImageHandle, FALSE);
+  if (ImageList != NULL) {
+    if (ImageList->WatchdogBudget != 0) {
+      return ImageList->WatchdogBudget;
+    }
+    if (ImageList->WatchdogPolicy != 0) {
+      return ImageList->WatchdogPolicy;
+    }
+  }
+  return mEbcDefaultWatchdogBudget;
+}
+
+/**
+  Fill part of an EBC stack with the pattern used to measure stack usage.
+
+  @param  StackBuffer   The EBC stack pool.
+  @param  Start         The offset to start filling at.
+  @param  End           The offset to stop filling at.
+
+**/
+VOID
+InitEBCStackFill (
+  IN VOID  *StackBuffer,
+  IN UINTN Start,
+  IN UINTN End
+  )
+{
+  UINT32  *Fill;
+  UINTN   Index;
+
+  Fill = (UINT32 *) StackBuffer;
+  for (Index = Start / sizeof (UINT32); Index < End / sizeof (UINT32); Index++) {
+    Fill[Index] = VM_STACK_FILL_VALUE;
+  }
+}
+
+/**
+  Measure how much of an EBC stack was used, by looking for the lowest part
+  that no longer holds the fill pattern, and restore the pattern.
+
+  The scan goes up from the guard region, so that uninitialized locals, which
+  still hold the pattern, are not mistaken for the end of the used part.
+
+  @param  Index         The index of the EBC stack.
+
+  @return The number of bytes of the stack that were used.
+
+**/
+UINTN
+MeasureEBCStackUsage (
+  IN UINTN Index
+  )
+{
+  UINT32  *Fill;
+  UINTN   Lowest;
+
+  Fill = (UINT32 *) mStackBuffer[Index];
+  for (Lowest = STACK_REMAIN_SIZE; Lowest < mStackBufferSize[Index]; Lowest += sizeof (UINT32)) {
+    if (Fill[Lowest / sizeof (UINT32)] != VM_STACK_FILL_VALUE) {
+      break;
+    }
+  }
+
+  InitEBCStackFill (Fill, Lowest, mStackBufferSize[Index]);
+  return mStackBufferSize[Index] - Lowest;
+}
+
 /**
   Returns from the EBC stack by stack Index.
 
@@ -1281,6 +1805,21 @@ ReturnEBCStack(
   IN UINTN Index
   )
 {
+  EBC_IMAGE_LIST  *ImageList;
+  UINTN           Usage;
+
+  //
+  // Update the peak stack usage of the image before releasing the stack
+  //
+  Usage = MeasureEBCStackUsage (Index);
+  ImageList = EbcGetImageList (mStackBufferIndex[Index], FALSE);
+  if (ImageList != NULL) {
+    ImageList->StackCount++;
+    if (Usage > ImageList->StackPeak) {
+      ImageList->StackPeak = Usage;
+    }
+  }
+
   mStackBufferIndex[Index] = NULL;
   return EFI_SUCCESS;
 }
@@ -1307,8 +1846,11 @@ ReturnEBCStackByHandle(
   if (Index == mStackNum) {
     return EFI_NOT_FOUND;
   }
-  mStackBufferIndex[Index] = NULL;
-  return EFI_SUCCESS;
+  //
+  // The image is being unloaded while it still holds a stack, so account
+  // for its usage, the same as when the stack is returned
+  //
+  return ReturnEBCStack (Index);
 }
 
 /**
@@ -1324,18 +1866,73 @@ InitEBCStack (
   )
 {
   for (mStackNum = 0; mStackNum < MAX_STACK_NUM; mStackNum ++) {
-    mStackBuffer[mStackNum] = AllocatePool(STACK_POOL_SIZE);
+    mStackBuffer[mStackNum] = AllocatePool(mEbcDefaultStackSize);
     mStackBufferIndex[mStackNum] = NULL;
     if (mStackBuffer[mStackNum] == NULL) {
       break;
     }
+    mStackBufferSize[mStackNum] = mEbcDefaultStackSize;
+    InitEBCStackGuard (mStackBuffer[mStackNum]);
+    InitEBCStackFill (mStackBuffer[mStackNum], STACK_REMAIN_SIZE, mEbcDefaultStackSize);
   }
   if (mStackNum == 0) {
     return EFI_OUT_OF_RESOURCES;
   }
+  //
+  // Thunk calls that can't be tied to an image are accounted for under the
+  // same pseudo handle as the one they get their stack with.
+  //
+  EbcGetImageList ((EFI_HANDLE)(UINTN)-1, TRUE);
   return EFI_SUCCESS;
 }
 
+/**
+  Fill the guard region at the bottom of an EBC stack with the guard pattern.
+
+  @param  StackBuffer   The EBC stack pool, as returned by GetEBCStack().
+
+**/
+VOID
+InitEBCStackGuard (
+  IN VOID *StackBuffer
+  )
+{
+  UINT32  *Guard;
+  UINTN   Index;
+
+  Guard = (UINT32 *) StackBuffer;
+  for (Index = 0; Index < STACK_REMAIN_SIZE / sizeof (UINT32); Index++) {
+    Guard[Index] = VM_STACK_GUARD_VALUE;
+  }
+}
+
+
+/**
+  Count the EBC stacks that are in use.
+
+  @param  Handle        The image to count the stacks of, or NULL to count
+                        the stacks of all the images.
+
+  @return The number of EBC stacks in use.
+
+**/
+UINTN
+EbcCountStacksInUse (
+  IN EFI_HANDLE Handle
+  )
+{
+  UINTN Index;
+  UINTN Count;
+
+  Count = 0;
+  for (Index = 0; Index < mStackNum; Index++) {
+    if ((mStackBufferIndex[Index] != NULL) &&
+        ((Handle == NULL) || (mStackBufferIndex[Index] == Handle))) {
+      Count++;
+    }
+  }
+  return Count;
+}
 
 /**
   Free all EBC stacks allocated before.
@@ -1383,8 +1980,8 @@ InitEbcVmTestProtocol (
   EbcVmTestProtocol->Execute      = (EBC_VM_TEST_EXECUTE) EbcExecuteInstructions;
 
   DEBUG_CODE_BEGIN ();
-    EbcVmTestProtocol->Assemble     = (EBC_VM_TEST_ASM) EbcVmTestUnsupported;
-    EbcVmTestProtocol->Disassemble  = (EBC_VM_TEST_DASM) EbcVmTestUnsupported;
+    EbcVmTestProtocol->Assemble     = EbcVmTestUnsupported;
+    EbcVmTestProtocol->Disassemble  = EbcVmTestUnsupported;
   DEBUG_CODE_END ();
 
   //
@@ -1402,13 +1999,21 @@ InitEbcVmTestProtocol (
 /**
   Returns the EFI_UNSUPPORTED Status.
 
+  @param  This        The EBC test protocol instance.
+  @param  AsmText     The text of the instruction.
+  @param  Buffer      The buffer of the instruction.
+  @param  BufferLen   The length of the buffer.
+
   @return EFI_UNSUPPORTED  This function always return EFI_UNSUPPORTED status.
 
 **/
 EFI_STATUS
 EFIAPI
 EbcVmTestUnsupported (
-  VOID
+  IN     EFI_EBC_VM_TEST_PROTOCOL   *This,
+  IN     CHAR16                     *AsmText,
+  IN OUT INT8                       *Buffer,
+  IN OUT UINTN                      *BufferLen
   )
 {
   return EFI_UNSUPPORTED;
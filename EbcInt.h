@@ -25,6 +25,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #endif
 #include <Protocol/EbcVmTest.h>
 #include <Protocol/EbcSimpleDebugger.h>
+#include "EbcPerformance.h"
 
 #ifndef _GNU_EFI
 #include <Library/BaseLib.h>
@@ -33,9 +34,214 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/BaseMemoryLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/TimerLib.h>
+#include <Protocol/LoadedImage.h>
 #endif
 
+//
+// We'll keep track of all thunks we create in a linked list. Each
+// thunk is tied to an image handle, so we have a linked list of
+// image handles, with each having a linked list of thunks allocated
+// to that image handle.
+//
+typedef struct _EBC_THUNK_LIST EBC_THUNK_LIST;
+struct _EBC_THUNK_LIST {
+  VOID            *ThunkBuffer;
+  EBC_THUNK_LIST  *Next;
+};
+
+//
+// Execution counter of a function entry or loop head. The key is the offset
+// of the address in the image, or'ed with EBC_EXEC_COUNT_LOOP for the targets
+// of backward branches. A key of 0 marks an unused entry.
+//
+typedef struct {
+  UINT32          Key;
+  UINT32          Count;
+} EBC_EXEC_COUNT;
+
+#define EBC_EXEC_COUNT_CALL     0x0
+#define EBC_EXEC_COUNT_LOOP     0x1
+//
+// The table of each image gets one entry per EBC_EXEC_COUNT_DENSITY bytes of
+// image, within the limits below, and lookups give up after a few probes.
+//
+#define EBC_EXEC_COUNT_DENSITY  64
+#define EBC_EXEC_COUNT_MIN      64
+#define EBC_EXEC_COUNT_MAX      4096
+#define EBC_EXEC_COUNT_PROBES   8
+//
+// Number of executions after which a faster execution tier may be used
+//
+#define EBC_TIER_UP_THRESHOLD   32
+
+//
+// Set EBC_PERFORMANCE_COUNTERS to 0 to compile the performance counters out.
+// Otherwise, they are only updated while enabled through the protocol, and
+// EBC_PERF_ADD() adds to the counters of a call into EBC, if any.
+//
+#ifndef EBC_PERFORMANCE_COUNTERS
+#define EBC_PERFORMANCE_COUNTERS  1
+#endif
+#if EBC_PERFORMANCE_COUNTERS
+#define EBC_PERF_ADD(Private, Field, Value) \
+  do { \
+    if ((Private)->PerfCounters != NULL) { \
+      (Private)->PerfCounters->Field += (Value); \
+    } \
+  } while (FALSE)
+#else
+#define EBC_PERF_ADD(Private, Field, Value)
+#endif
+
+//
+// Set EBC_INSTRUCTION_MIX to 1 to count the instructions that are executed
+// per opcode, operand form and pair of consecutive opcodes, for each image.
+// This needs the performance counters, and costs a test per instruction even
+// while the counting is disabled, so it is only built in on request.
+//
+#ifndef EBC_INSTRUCTION_MIX
+#define EBC_INSTRUCTION_MIX  0
+#endif
+#if !EBC_PERFORMANCE_COUNTERS
+#undef EBC_INSTRUCTION_MIX
+#define EBC_INSTRUCTION_MIX  0
+#endif
+
+//
+// Set EBC_MEMORY_ACCESS_HOOK to 1 to report the reads and writes of the EBC
+// code to the debugger, through EbcDebuggerHookMemoryAccess(). An unaligned
+// access is reported once, and not as the smaller accesses that it is split
+// into. This costs a call per access, so it is only built in on request.
+//
+#ifndef EBC_MEMORY_ACCESS_HOOK
+#define EBC_MEMORY_ACCESS_HOOK  0
+#endif
+#if EBC_MEMORY_ACCESS_HOOK
+#define EBC_MEMORY_ACCESS(VmPtr, Addr, Size, Flags) \
+  do { \
+    if (mEbcVmPrivate->SplitAccess == 0) { \
+      EbcDebuggerHookMemoryAccess ((VmPtr), (Addr), (Size), (Flags)); \
+    } \
+  } while (FALSE)
+#define EBC_MEMORY_SPLIT_START()  (mEbcVmPrivate->SplitAccess++)
+#define EBC_MEMORY_SPLIT_END()    (mEbcVmPrivate->SplitAccess--)
+#else
+#define EBC_MEMORY_ACCESS(VmPtr, Addr, Size, Flags)
+#define EBC_MEMORY_SPLIT_START()
+#define EBC_MEMORY_SPLIT_END()
+#endif
+
+typedef struct _EBC_IMAGE_LIST EBC_IMAGE_LIST;
+struct _EBC_IMAGE_LIST {
+  EBC_IMAGE_LIST  *Next;
+  EFI_HANDLE      ImageHandle;
+  EBC_THUNK_LIST  *ThunkList;
+  //
+  // Where the image was loaded, so that thunk calls can be tied back to it
+  //
+  UINTN           ImageBase;
+  UINTN           ImageSize;
+  //
+  // Stack size set by the policy table, stack size set by the debugger, which
+  // overrides it (0 for the default), and stack usage statistics
+  //
+  UINTN           StackPolicy;
+  UINTN           StackSize;
+  UINTN           StackPeak;
+  UINTN           StackCount;
+  //
+  // Watchdog budget set by the policy table, watchdog budget set by the
+  // debugger, which overrides it, in safepoints (0 for the default), and
+  // number of calls that were aborted because they ran out of it
+  //
+  UINT64          WatchdogPolicy;
+  UINT64          WatchdogBudget;
+  UINTN           WatchdogCount;
+  //
+  // Execution counters of the function entries and loop heads, and number of
+  // them that could not be counted because the table was full
+  //
+  EBC_EXEC_COUNT  *ExecCount;
+  UINTN           ExecCountSize;
+  UINTN           ExecCountLost;
+  //
+  // Performance counters, updated while they are enabled
+  //
+  EFI_EBC_PERFORMANCE_COUNTERS  Perf;
+  //
+  // Instruction mix, allocated the first time it is counted for this image
+  //
+  EFI_EBC_INSTRUCTION_MIX       *Mix;
+};
+
+//
+// Interpreter state of a call into EBC, which lives on the stack of
+// EbcExecute(). It is kept out of VM_CONTEXT, whose layout is the one of the
+// EBC VM test protocol, and mEbcVmPrivate points to the state of the call
+// that is running, the same way mVmPtr does for its VM context. It is never
+// NULL, as an idle state is used outside of the calls.
+//
+typedef struct {
+  //
+  // Safepoints left before the watchdog aborts the call
+  //
+  UINT64                        WatchdogBudget;
+  //
+  // Counters and instruction mix of the call, or NULL if not counting
+  //
+  EFI_EBC_PERFORMANCE_COUNTERS  *PerfCounters;
+  EFI_EBC_INSTRUCTION_MIX       *InstMix;
+  //
+  // Nesting of the unaligned accesses that are being split
+  //
+  UINTN                         SplitAccess;
+} EBC_VM_PRIVATE;
+
+//
+// Boot and runtime services that CALLEX calls directly, rather than through
+// EbcLLCALLEX, with the number of calls that took the direct path
+//
+typedef
+UINT64
+(*EBC_CALLEX_HANDLER) (
+  IN UINTN        FuncAddr,
+  IN UINTN        *Args
+  );
+
+typedef struct {
+  CHAR16              *Name;
+  EBC_CALLEX_HANDLER  Handler;
+  UINTN               FuncAddr;
+  UINT64              Count;
+} EBC_CALLEX_SERVICE;
+
+//
+// How a CALLEX reached its target, for the CALLEX profile
+//
+#define EBC_CALLEX_NATIVE           0   // through EbcLLCALLEXNative
+#define EBC_CALLEX_DIRECT           1   // through the direct path of a service
+#define EBC_CALLEX_THUNK            2   // redirected to the EBC code of a thunk
+
+#define EBC_CALLEX_PROFILE_PROBES   8
+
 extern VM_CONTEXT                    *mVmPtr;
+extern EBC_VM_PRIVATE                *mEbcVmPrivate;
+extern EBC_IMAGE_LIST                *mEbcImageList;
+extern UINTN                         mEbcDefaultStackSize;
+extern VOID                          *mStackBuffer[];
+extern UINTN                         mStackBufferSize[];
+extern UINTN                         mStackNum;
+extern UINT64                        mEbcDefaultWatchdogBudget;
+extern BOOLEAN                       mEbcFastPathEnabled;
+extern EBC_CALLEX_SERVICE            mEbcCallExServices[];
+extern UINTN                         mEbcCallExServiceCount;
+extern BOOLEAN                       mEbcPerfEnabled;
+extern BOOLEAN                       mEbcVirtualClock;
+extern UINT64                        mEbcVirtualTime;
+extern UINT64                        mEbcVirtualDeadline;
+extern CONST UINT8                   mEbcVirtualCost[];
+extern EFI_EBC_PERFORMANCE_PROTOCOL  mEbcPerformanceProtocol;
 
 //
 // Flags passed to the internal create-thunks function.
@@ -52,6 +258,37 @@ extern VM_CONTEXT                    *mVmPtr;
 // occasion to make sure the stack has not been corrupted.
 //
 #define VM_STACK_KEY_VALUE      0xDEADBEEF
+//
+// The lowest STACK_REMAIN_SIZE bytes of each stack pool are never handed to
+// the VM. They are filled with this pattern when the pool is allocated, so
+// that an overflow past VmPtr->StackTop can be detected by checking the
+// pattern at call boundaries, rather than R0 after every instruction.
+//
+#define VM_STACK_GUARD_VALUE    0x5AEBC5A5
+//
+// Private VmPtr->StopFlags bit, set once a stack fault has been reported so
+// that it is only ever signaled once for a VM context.
+//
+#define STOPFLAG_STACK_FAULT    0x8000
+//
+// The part of each stack pool that is above the guard region is filled with
+// this pattern, so that the peak stack usage can be measured when the stack
+// is returned. Since the stack may contain uninitialized locals, the scan
+// goes up from the guard region to the first word that was written.
+//
+#define VM_STACK_FILL_VALUE     0xEBC0F111
+//
+// Watchdog budget that never runs out. The budget is counted down at each
+// safepoint, so that runaway EBC code cannot hang the boot forever.
+//
+#define EBC_WATCHDOG_DISABLED   ((UINT64) -1)
+//
+// Watchdog budget of the images that have none set. Platforms may set it at
+// build time, and set the budget of each image in the policy table.
+//
+#ifndef EBC_DEFAULT_WATCHDOG_BUDGET
+#define EBC_DEFAULT_WATCHDOG_BUDGET EBC_WATCHDOG_DISABLED
+#endif
 
 /**
   Create thunks for an EBC image entry point, or an EBC protocol service.
@@ -104,9 +341,45 @@ EbcAddImageThunk (
 //
 #define EFI_TIMER_UNIT_1MS            (1000 * 10)
 #define EBC_VM_PERIODIC_CALLBACK_RATE (1000 * EFI_TIMER_UNIT_1MS)
+
+//
+// Cost of a native call made through CALLEX on the virtual clock, on top of
+// the cost of the CALL instruction and of the EBC code that it calls back,
+// and period of the periodic callback on the virtual clock.
+//
+#define EBC_VIRTUAL_CALLEX_COST       100
+#define EBC_VIRTUAL_PERIODIC_TICKS \
+  ((UINT64) EBC_VM_PERIODIC_CALLBACK_RATE * (EFI_EBC_VIRTUAL_CLOCK_FREQUENCY / 10000000))
+
 #define STACK_POOL_SIZE               (1024 * 1020)
+#define STACK_REMAIN_SIZE             (1024 * 4)
+#define STACK_POOL_SIZE_MIN           (STACK_REMAIN_SIZE + 1024 * 4)
 #define MAX_STACK_NUM                 4
 
+//
+// Stack size of the images that have none set. Platforms may override it
+// at build time, and set the size of each image in the policy table.
+//
+#ifndef EBC_DEFAULT_STACK_SIZE
+#define EBC_DEFAULT_STACK_SIZE        STACK_POOL_SIZE
+#endif
+
+//
+// Keep the top of the stacks naturally aligned
+//
+#define EBC_ALIGN_STACK_SIZE(Size) \
+  (((Size) + sizeof (UINT64) - 1) & ~(sizeof (UINT64) - 1))
+
+//
+// Settings of an EBC image in the policy table, by the GUID of the firmware
+// file it is loaded from. The settings left to 0 use the defaults.
+//
+typedef struct {
+  EFI_GUID        FileGuid;
+  UINTN           StackSize;
+  UINT64          WatchdogBudget;
+} EBC_IMAGE_POLICY;
+
 //
 // External low level functions that are native-processor dependent
 //
@@ -172,6 +445,44 @@ EbcLLCALLEX (
   IN UINT8        Size
   );
 
+/**
+  Execute a CALLEX to native code, through a direct path if the target is one
+  of the well-known services, or through EbcLLCALLEX otherwise.
+
+  @param  VmPtr            Pointer to a VM context.
+  @param  FuncAddr         Callee's address
+  @param  NewStackPointer  New stack pointer after the call
+  @param  FramePtr         New frame pointer after the call
+  @param  Size             The size of call instruction
+
+**/
+VOID
+EbcCallEx (
+  IN VM_CONTEXT   *VmPtr,
+  IN UINTN        FuncAddr,
+  IN UINTN        NewStackPointer,
+  IN VOID         *FramePtr,
+  IN UINT8        Size
+  );
+
+/**
+  Record the current addresses of the services that CALLEX can call directly.
+
+**/
+VOID
+EbcInitCallExServices (
+  VOID
+  );
+
+/**
+  Reset the call counts of the services that CALLEX can call directly.
+
+**/
+VOID
+EbcResetCallExServices (
+  VOID
+  );
+
 /**
   Returns the stack index and buffer assosicated with the Handle parameter.
 
@@ -217,6 +528,354 @@ InitEBCStack (
   VOID
   );
 
+/**
+  Fill the guard region at the bottom of an EBC stack with the guard pattern.
+
+  @param  StackBuffer   The EBC stack pool, as returned by GetEBCStack().
+
+**/
+VOID
+InitEBCStackGuard (
+  IN VOID *StackBuffer
+  );
+
+/**
+  Fill part of an EBC stack with the pattern used to measure stack usage.
+
+  @param  StackBuffer   The EBC stack pool.
+  @param  Start         The offset to start filling at.
+  @param  End           The offset to stop filling at.
+
+**/
+VOID
+InitEBCStackFill (
+  IN VOID  *StackBuffer,
+  IN UINTN Start,
+  IN UINTN End
+  );
+
+/**
+  Get the size of an EBC stack, as allocated for the image it was given to.
+
+  @param  Index         The index of the EBC stack, as returned by GetEBCStack().
+
+  @return The size of the EBC stack, in bytes.
+
+**/
+UINTN
+GetEBCStackSize (
+  IN UINTN Index
+  );
+
+/**
+  Get the size of the EBC stack to use when running code from an image: the
+  one set by the debugger, the one set by the policy table, or the default.
+
+  @param  ImageList     The image list element of the image, or NULL for an
+                        unknown image.
+
+  @return The size of the EBC stack, in bytes.
+
+**/
+UINTN
+EbcGetImageStackSize (
+  IN EBC_IMAGE_LIST *ImageList
+  );
+
+/**
+  Override the size of the EBC stack to use when running code from a loaded
+  EBC image, in place of the one set by the policy table.
+
+  This can be called for an image that has been loaded but not started yet.
+  The new size is applied on the next entry into the image, be it through its
+  entry point or through a thunk.
+
+  @param  ImageHandle           The image to set the stack size for, or NULL
+                                to set the default for all the other images.
+  @param  StackSize             The stack size, in bytes, including the guard
+                                region. 0 restores the size of the policy
+                                table, or the default size.
+
+  @retval EFI_SUCCESS           The stack size was set.
+  @retval EFI_INVALID_PARAMETER StackSize is too small to be usable.
+  @retval EFI_NOT_FOUND         ImageHandle is not a loaded EBC image.
+
+**/
+EFI_STATUS
+EbcSetImageStackSize (
+  IN EFI_HANDLE ImageHandle,
+  IN UINTN      StackSize
+  );
+
+/**
+  Override the watchdog budget of a loaded EBC image, in place of the one set
+  by the policy table.
+
+  The budget is counted in safepoints, which are the backward jumps and the
+  calls executed by the interpreter, and applies to each call into the image.
+  A call that runs out of it is aborted with EFI_TIMEOUT.
+
+  @param  ImageHandle           The image to set the budget for, or NULL to
+                                set the default for all the other images.
+  @param  Budget                The number of safepoints allowed per call. 0
+                                restores the budget of the policy table, or
+                                the default, EBC_WATCHDOG_DISABLED disables
+                                the watchdog.
+
+  @retval EFI_SUCCESS           The budget was set.
+  @retval EFI_NOT_FOUND         ImageHandle is not a loaded EBC image.
+
+**/
+EFI_STATUS
+EbcSetImageWatchdogBudget (
+  IN EFI_HANDLE ImageHandle,
+  IN UINT64     Budget
+  );
+
+/**
+  Get the watchdog budget that applies to a call into an EBC image: the one
+  set by the debugger, the one set by the policy table, or the default.
+
+  @param  ImageHandle   The image handle, as returned by EbcFindImageHandle().
+
+  @return The number of safepoints allowed for the call.
+
+**/
+UINT64
+EbcGetImageWatchdogBudget (
+  IN EFI_HANDLE ImageHandle
+  );
+
+/**
+  Find the image list element for an image handle, and optionally create it.
+
+  @param  ImageHandle   The image handle to look for.
+  @param  Create        If TRUE, create the element if it doesn't exist yet.
+
+  @return The image list element, or NULL if not found or out of resources.
+
+**/
+EBC_IMAGE_LIST *
+EbcGetImageList (
+  IN EFI_HANDLE ImageHandle,
+  IN BOOLEAN    Create
+  );
+
+/**
+  Apply the policy of an EBC image, once it is loaded.
+
+  The settings of the policy that are not valid are ignored, and the image
+  gets the defaults instead.
+
+  @param  ImageList     The image list element of the image.
+  @param  LoadedImage   The loaded image protocol of the image.
+
+**/
+VOID
+EbcApplyImagePolicy (
+  IN EBC_IMAGE_LIST             *ImageList,
+  IN EFI_LOADED_IMAGE_PROTOCOL  *LoadedImage
+  );
+
+/**
+  Find the handle of the image that contains an EBC address.
+
+  @param  Address       An address in the code of an EBC image.
+
+  @return The image handle, or (EFI_HANDLE)-1 if the address could not be tied
+          to a known image.
+
+**/
+EFI_HANDLE
+EbcFindImageHandle (
+  IN UINTN Address
+  );
+
+/**
+  Count one execution of a function entry or a loop head, in the table of the
+  image that contains it.
+
+  @param  Address       The address of the function or loop head.
+  @param  Kind          EBC_EXEC_COUNT_CALL or EBC_EXEC_COUNT_LOOP.
+
+  @return The number of times the address was counted, or 0 if it is not part
+          of a known image.
+
+**/
+UINT32
+EbcCountExecution (
+  IN UINTN  Address,
+  IN UINT32 Kind
+  );
+
+/**
+  Reset the execution counters of all the images.
+
+**/
+VOID
+EbcResetExecCounts (
+  VOID
+  );
+
+/**
+  Count the EBC stacks that are in use.
+
+  @param  Handle        The image to count the stacks of, or NULL to count
+                        the stacks of all the images.
+
+  @return The number of EBC stacks in use.
+
+**/
+UINTN
+EbcCountStacksInUse (
+  IN EFI_HANDLE Handle
+  );
+
+/**
+  Start counting for a call into EBC, if counting is enabled.
+
+  @param  Private       The interpreter state of the call.
+  @param  Counters      The counters to use for the call, which must remain
+                        valid until EbcPerfStop() is called.
+
+**/
+VOID
+EbcPerfStart (
+  IN EBC_VM_PRIVATE               *Private,
+  IN EFI_EBC_PERFORMANCE_COUNTERS *Counters
+  );
+
+/**
+  Stop counting for a call into EBC, and add its counters to the ones of its
+  image and to the global ones.
+
+  @param  Private       The interpreter state of the call.
+  @param  ImageHandle   The image the call belongs to.
+
+**/
+VOID
+EbcPerfStop (
+  IN EBC_VM_PRIVATE               *Private,
+  IN EFI_HANDLE                   ImageHandle
+  );
+
+/**
+  Update the peak number of EBC stacks in use, after one was taken. Must be
+  called at TPL_HIGH_LEVEL.
+
+  @param  Handle        The image that took the stack.
+
+**/
+VOID
+EbcPerfUpdateStacks (
+  IN EFI_HANDLE                   Handle
+  );
+
+/**
+  Count a CALLEX in the counters of the current call into EBC, and in the
+  CALLEX profile, if counting is enabled for the call.
+
+  @param  Private       The interpreter state of the call.
+  @param  FuncAddr      The target of the CALLEX.
+  @param  Kind          EBC_CALLEX_NATIVE, EBC_CALLEX_DIRECT or EBC_CALLEX_THUNK.
+  @param  Start         The value of the timer before the CALLEX.
+
+**/
+VOID
+EbcPerfCallEx (
+  IN EBC_VM_PRIVATE               *Private,
+  IN UINTN                        FuncAddr,
+  IN UINTN                        Kind,
+  IN UINT64                       Start
+  );
+
+/**
+  Start counting the instruction mix of a call into EBC, if it is enabled.
+
+  @param  Private       The interpreter state of the call.
+  @param  ImageHandle   The image the call belongs to.
+
+**/
+VOID
+EbcMixStart (
+  IN EBC_VM_PRIVATE               *Private,
+  IN EFI_HANDLE                   ImageHandle
+  );
+
+/**
+  Add the instruction mix of an image that is being unloaded to the one of
+  the calls that don't belong to any image, and free it.
+
+  @param  ImageList     The image that is being unloaded.
+
+**/
+VOID
+EbcMixRetire (
+  IN EBC_IMAGE_LIST               *ImageList
+  );
+
+/**
+  Get the properties of the performance counter, which the clock reads.
+
+**/
+VOID
+EbcInitClock (
+  VOID
+  );
+
+/**
+  Read the clock that the times are measured with: the virtual clock if it
+  runs, or the performance counter otherwise, as a value that always
+  increases.
+
+  @param  Frequency     The frequency of the clock, in Hz, 0 if unknown.
+
+  @return The current value of the clock, or 0 if there is no counter.
+
+**/
+UINT64
+EbcReadClock (
+  OUT UINT64                      *Frequency OPTIONAL
+  );
+
+/**
+  Start or stop the virtual clock. The virtual clock restarts from 0.
+
+  @param  Enable        TRUE to measure the times with the virtual clock,
+                        FALSE to measure them with the performance counter.
+
+**/
+VOID
+EbcSetVirtualClock (
+  IN BOOLEAN                      Enable
+  );
+
+/**
+  Call the periodic callback once the virtual clock has reached its next
+  deadline, and set the one after.
+
+  @param  VmPtr         The VM context of the running call.
+
+**/
+VOID
+EbcVirtualClockPeriodic (
+  IN VM_CONTEXT                   *VmPtr
+  );
+
+/**
+  Produce the EBC performance protocol.
+
+  @param  IHandle               Handle on which to install the protocol.
+
+  @retval EFI_SUCCESS           The protocol was installed.
+  @retval Others                The protocol could not be installed.
+
+**/
+EFI_STATUS
+InitEbcPerformanceProtocol (
+  IN EFI_HANDLE                   *IHandle
+  );
+
 /**
   Free all EBC stacks allocated before.
 
@@ -0,0 +1,873 @@
+/** @file
+  EBC Performance protocol.
+
+  Each call into EBC gets its own set of counters, which the interpreter
+  updates through its VM context while counting is enabled. When the call
+  returns, these are added to the counters of the image the call belongs to
+  and to the global ones, so that only this last step needs to be protected
+  against events.
+
+  The instruction mix, when built in, is counted per image instead, and the
+  CALLEX profile for all the images at once.
+
+  The times are measured with the performance counter, or with a virtual
+  clock that the interpreter advances by a fixed cost per instruction, so
+  that they are the same from one run to the next.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "EbcInt.h"
+
+//
+// The GUID of the protocol isn't part of any package, so define it here.
+//
+EFI_GUID gEfiEbcPerformanceProtocolGuid = EFI_EBC_PERFORMANCE_PROTOCOL_GUID;
+
+//
+// Runtime switch of the counters
+//
+BOOLEAN  mEbcPerfEnabled = FALSE;
+
+//
+// Virtual clock, its next periodic callback, and its cost per opcode, in
+// nominal cycles. The CALLEX instructions cost EBC_VIRTUAL_CALLEX_COST more
+// when they call native code. The costs are made up to rank the instructions
+// against one another, and don't model any real processor.
+//
+BOOLEAN  mEbcVirtualClock    = FALSE;
+UINT64   mEbcVirtualTime     = 0;
+UINT64   mEbcVirtualDeadline = 0;
+
+//
+// Properties of the performance counter
+//
+UINT64   mEbcPerfFrequency = 0;
+BOOLEAN  mEbcPerfCountDown = FALSE;
+
+CONST UINT8  mEbcVirtualCost[] = {
+  20,                             // 0x00 BREAK
+  2,  1,                          // 0x01 JMP, JMP8
+  4,  4,                          // 0x03 CALL, RET
+  1,  1,  1,  1,  1,              // 0x05 CMPeq, CMPlte, CMPgte, CMPulte, CMPugte
+  1,  1,  1,  1,                  // 0x0A NOT, NEG, ADD, SUB
+  3,  3,                          // 0x0E MUL, MULU
+  20, 20, 20, 20,                 // 0x10 DIV, DIVU, MOD, MODU
+  1,  1,  1,  1,  1,  1,          // 0x14 AND, OR, XOR, SHL, SHR, ASHR
+  1,  1,  1,                      // 0x1A EXTNDB, EXTNDW, EXTNDD
+  2,  2,  2,  2,  2,  2,  2,  2,  // 0x1D MOVbw .. MOVqd
+  2,  2,                          // 0x25 MOVsnw, MOVsnd
+  0,                              // 0x27
+  2,                              // 0x28 MOVqq
+  2,  2,                          // 0x29 LOADSP, STORESP
+  2,  2,                          // 0x2B PUSH, POP
+  1,  1,  1,  1,  1,              // 0x2D CMPIeq, CMPIlte, CMPIgte, CMPIulte, CMPIugte
+  2,  2,                          // 0x32 MOVnw, MOVnd
+  0,                              // 0x34
+  2,  2,                          // 0x35 PUSHn, POPn
+  1,  1,  2,                      // 0x37 MOVI, MOVIn, MOVREL
+  0,  0,  0,  0,  0,  0           // 0x3A
+};
+
+/**
+  Get the properties of the performance counter, which the clock reads.
+
+**/
+VOID
+EbcInitClock (
+  VOID
+  )
+{
+  UINT64  StartValue;
+  UINT64  EndValue;
+
+  mEbcPerfFrequency = GetPerformanceCounterProperties (&StartValue, &EndValue);
+  mEbcPerfCountDown = (BOOLEAN) (StartValue > EndValue);
+}
+
+/**
+  Read the clock that the times are measured with: the virtual clock if it
+  runs, or the performance counter otherwise, as a value that always
+  increases.
+
+  @param  Frequency     The frequency of the clock, in Hz, 0 if unknown.
+
+  @return The current value of the clock, or 0 if there is no counter.
+
+**/
+UINT64
+EbcReadClock (
+  OUT UINT64                      *Frequency OPTIONAL
+  )
+{
+  UINT64  Value;
+
+  if (mEbcVirtualClock) {
+    if (Frequency != NULL) {
+      *Frequency = EFI_EBC_VIRTUAL_CLOCK_FREQUENCY;
+    }
+    return mEbcVirtualTime;
+  }
+  if (Frequency != NULL) {
+    *Frequency = mEbcPerfFrequency;
+  }
+  if (mEbcPerfFrequency == 0) {
+    return 0;
+  }
+  Value = GetPerformanceCounter ();
+  //
+  // Negate the counters that count down, so that the differences between two
+  // reads, which is all we use, are positive.
+  //
+  if (mEbcPerfCountDown) {
+    Value = (UINT64) 0 - Value;
+  }
+  return Value;
+}
+
+/**
+  Start or stop the virtual clock. The virtual clock restarts from 0.
+
+  Calls into EBC that are running while the clock changes get the time they
+  take measured with both clocks, which doesn't mean anything.
+
+  @param  Enable        TRUE to measure the times with the virtual clock,
+                        FALSE to measure them with the performance counter.
+
+**/
+VOID
+EbcSetVirtualClock (
+  IN BOOLEAN                      Enable
+  )
+{
+  mEbcVirtualTime     = 0;
+  mEbcVirtualDeadline = EBC_VIRTUAL_PERIODIC_TICKS;
+  mEbcVirtualClock    = Enable;
+}
+
+#if EBC_PERFORMANCE_COUNTERS
+
+EFI_STATUS
+EFIAPI
+EbcPerfEnable (
+  IN EFI_EBC_PERFORMANCE_PROTOCOL     *This,
+  IN BOOLEAN                          Enable
+  );
+
+EFI_STATUS
+EFIAPI
+EbcPerfReset (
+  IN EFI_EBC_PERFORMANCE_PROTOCOL     *This
+  );
+
+EFI_STATUS
+EFIAPI
+EbcPerfSnapshot (
+  IN  EFI_EBC_PERFORMANCE_PROTOCOL    *This,
+  IN  EFI_HANDLE                      ImageHandle OPTIONAL,
+  OUT EFI_EBC_PERFORMANCE_COUNTERS    *Counters
+  );
+
+EFI_STATUS
+EFIAPI
+EbcPerfEnableMix (
+  IN EFI_EBC_PERFORMANCE_PROTOCOL     *This,
+  IN BOOLEAN                          Enable
+  );
+
+EFI_STATUS
+EFIAPI
+EbcPerfMixSnapshot (
+  IN  EFI_EBC_PERFORMANCE_PROTOCOL    *This,
+  IN  EFI_HANDLE                      ImageHandle OPTIONAL,
+  OUT EFI_EBC_INSTRUCTION_MIX         *Mix
+  );
+
+EFI_STATUS
+EFIAPI
+EbcPerfCallExSnapshot (
+  IN  EFI_EBC_PERFORMANCE_PROTOCOL    *This,
+  OUT EFI_EBC_CALLEX_PROFILE          *Profile
+  );
+
+EFI_STATUS
+EFIAPI
+EbcPerfSetClock (
+  IN EFI_EBC_PERFORMANCE_PROTOCOL     *This,
+  IN BOOLEAN                          Virtual
+  );
+
+EFI_STATUS
+EFIAPI
+EbcPerfReadClock (
+  IN  EFI_EBC_PERFORMANCE_PROTOCOL    *This,
+  OUT UINT64                          *Ticks,
+  OUT UINT64                          *Frequency OPTIONAL
+  );
+
+//
+// Counters of all the images, including the calls that could not be tied to
+// an image
+//
+EFI_EBC_PERFORMANCE_COUNTERS  mEbcPerfCounters;
+
+//
+// CALLEX profile, allocated when the counting is first enabled
+//
+EFI_EBC_CALLEX_PROFILE  *mEbcCallExProfile = NULL;
+
+#if EBC_INSTRUCTION_MIX
+//
+// Runtime switch of the instruction mix, and instruction mix of the calls
+// that could not be tied to an image and of the images that were unloaded
+//
+BOOLEAN                  mEbcMixEnabled = FALSE;
+EFI_EBC_INSTRUCTION_MIX  *mEbcMixOther  = NULL;
+#endif
+
+EFI_EBC_PERFORMANCE_PROTOCOL  mEbcPerformanceProtocol = {
+  EFI_EBC_PERFORMANCE_PROTOCOL_REVISION,
+  EbcPerfEnable,
+  EbcPerfReset,
+  EbcPerfSnapshot,
+  EbcPerfEnableMix,
+  EbcPerfMixSnapshot,
+  EbcPerfCallExSnapshot,
+  EbcPerfSetClock,
+  EbcPerfReadClock
+};
+
+/**
+  Add a set of counters to another.
+
+  @param  Dest          The counters to add to.
+  @param  Src           The counters to add.
+
+**/
+VOID
+EbcPerfAdd (
+  IN OUT EFI_EBC_PERFORMANCE_COUNTERS *Dest,
+  IN     EFI_EBC_PERFORMANCE_COUNTERS *Src
+  )
+{
+  Dest->Instructions += Src->Instructions;
+  Dest->Calls        += Src->Calls;
+  Dest->CallExs      += Src->CallExs;
+  Dest->Returns      += Src->Returns;
+  Dest->ThunkEntries += Src->ThunkEntries;
+  Dest->Exceptions   += Src->Exceptions;
+  Dest->NativeTime   += Src->NativeTime;
+  Dest->ExecuteTime  += Src->ExecuteTime;
+}
+
+/**
+  Start counting for a call into EBC, if counting is enabled.
+
+  @param  Private       The interpreter state of the call.
+  @param  Counters      The counters to use for the call, which must remain
+                        valid until EbcPerfStop() is called.
+
+**/
+VOID
+EbcPerfStart (
+  IN EBC_VM_PRIVATE               *Private,
+  IN EFI_EBC_PERFORMANCE_COUNTERS *Counters
+  )
+{
+  if (!mEbcPerfEnabled) {
+    Private->PerfCounters = NULL;
+    return;
+  }
+  ZeroMem (Counters, sizeof (EFI_EBC_PERFORMANCE_COUNTERS));
+  Counters->ThunkEntries = 1;
+  //
+  // ExecuteTime holds minus the start time until the call returns
+  //
+  Counters->ExecuteTime = (UINT64) 0 - EbcReadClock (NULL);
+  Private->PerfCounters = Counters;
+}
+
+/**
+  Stop counting for a call into EBC, and add its counters to the ones of its
+  image and to the global ones.
+
+  @param  Private       The interpreter state of the call.
+  @param  ImageHandle   The image the call belongs to.
+
+**/
+VOID
+EbcPerfStop (
+  IN EBC_VM_PRIVATE               *Private,
+  IN EFI_HANDLE                   ImageHandle
+  )
+{
+  EFI_EBC_PERFORMANCE_COUNTERS  *Counters;
+  EBC_IMAGE_LIST                *ImageList;
+  EFI_TPL                       OldTpl;
+
+  Counters = Private->PerfCounters;
+  if (Counters == NULL) {
+    return;
+  }
+  Private->PerfCounters = NULL;
+  Counters->ExecuteTime += EbcReadClock (NULL);
+
+  ImageList = EbcGetImageList (ImageHandle, FALSE);
+  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  if (ImageList != NULL) {
+    EbcPerfAdd (&ImageList->Perf, Counters);
+  }
+  EbcPerfAdd (&mEbcPerfCounters, Counters);
+  gBS->RestoreTPL (OldTpl);
+}
+
+/**
+  Update the peak number of EBC stacks in use, after one was taken. Must be
+  called at TPL_HIGH_LEVEL.
+
+  @param  Handle        The image that took the stack.
+
+**/
+VOID
+EbcPerfUpdateStacks (
+  IN EFI_HANDLE                   Handle
+  )
+{
+  EBC_IMAGE_LIST  *ImageList;
+  UINTN           Count;
+
+  Count = EbcCountStacksInUse (NULL);
+  if (Count > mEbcPerfCounters.StacksPeak) {
+    mEbcPerfCounters.StacksPeak = Count;
+  }
+  ImageList = EbcGetImageList (Handle, FALSE);
+  if (ImageList != NULL) {
+    Count = EbcCountStacksInUse (Handle);
+    if (Count > ImageList->Perf.StacksPeak) {
+      ImageList->Perf.StacksPeak = Count;
+    }
+  }
+}
+
+/**
+  Count a CALLEX in the counters of the current call into EBC, and in the
+  CALLEX profile, if counting is enabled for the call.
+
+  As for the instruction mix, a count may get lost on the rare occasions
+  where an event that also calls native code interrupts the update.
+
+  @param  Private       The interpreter state of the call.
+  @param  FuncAddr      The target of the CALLEX.
+  @param  Kind          EBC_CALLEX_NATIVE, EBC_CALLEX_DIRECT or EBC_CALLEX_THUNK.
+  @param  Start         The value of the timer before the CALLEX.
+
+**/
+VOID
+EbcPerfCallEx (
+  IN EBC_VM_PRIVATE               *Private,
+  IN UINTN                        FuncAddr,
+  IN UINTN                        Kind,
+  IN UINT64                       Start
+  )
+{
+  EFI_EBC_CALLEX_TARGET  *Target;
+  UINT64                 Ticks;
+  UINTN                  Index;
+  UINTN                  Probe;
+
+  if (Private->PerfCounters == NULL) {
+    return;
+  }
+  Ticks = EbcReadClock (NULL) - Start;
+  EBC_PERF_ADD (Private, CallExs, 1);
+  EBC_PERF_ADD (Private, NativeTime, Ticks);
+  if (mEbcCallExProfile == NULL) {
+    return;
+  }
+
+  Index = ((FuncAddr >> 4) ^ (FuncAddr >> 12)) & (EFI_EBC_CALLEX_TARGETS - 1);
+  for (Probe = 0; Probe < EBC_CALLEX_PROFILE_PROBES; Probe++) {
+    Target = &mEbcCallExProfile->Targets[Index];
+    if (Target->Calls == 0) {
+      Target->FuncAddr = (UINT64) FuncAddr;
+    }
+    if (Target->FuncAddr == (UINT64) FuncAddr) {
+      Target->Calls++;
+      if (Kind == EBC_CALLEX_THUNK) {
+        Target->Thunks++;
+        return;
+      }
+      if (Kind == EBC_CALLEX_DIRECT) {
+        Target->Direct++;
+      }
+      Target->NativeTime += Ticks;
+      if (Ticks > Target->MaxTime) {
+        Target->MaxTime = Ticks;
+      }
+      return;
+    }
+    Index = (Index + 1) & (EFI_EBC_CALLEX_TARGETS - 1);
+  }
+  mEbcCallExProfile->Lost++;
+}
+
+#if EBC_INSTRUCTION_MIX
+/**
+  Add an instruction mix to another.
+
+  @param  Dest          The instruction mix to add to.
+  @param  Src           The instruction mix to add.
+
+**/
+VOID
+EbcMixAdd (
+  IN OUT EFI_EBC_INSTRUCTION_MIX  *Dest,
+  IN     EFI_EBC_INSTRUCTION_MIX  *Src
+  )
+{
+  UINTN  Opcode;
+  UINTN  Index;
+
+  for (Opcode = 0; Opcode < EFI_EBC_MIX_OPCODES; Opcode++) {
+    for (Index = 0; Index < EFI_EBC_MIX_FORMS; Index++) {
+      Dest->Forms[Opcode][Index] += Src->Forms[Opcode][Index];
+    }
+    for (Index = 0; Index < EFI_EBC_MIX_OPCODES; Index++) {
+      Dest->Pairs[Opcode][Index] += Src->Pairs[Opcode][Index];
+    }
+  }
+}
+
+/**
+  Get the instruction mix of an image, and allocate it if this is the first
+  time it is counted.
+
+  @param  ImageHandle   The image.
+
+  @return The instruction mix of the image, or the one of the calls that
+          don't belong to any image if the image isn't known or if its own
+          could not be allocated.
+
+**/
+EFI_EBC_INSTRUCTION_MIX *
+EbcMixGetImageMix (
+  IN EFI_HANDLE                   ImageHandle
+  )
+{
+  EBC_IMAGE_LIST           *ImageList;
+  EFI_EBC_INSTRUCTION_MIX  *Mix;
+  EFI_TPL                  OldTpl;
+
+  ImageList = EbcGetImageList (ImageHandle, FALSE);
+  if (ImageList == NULL) {
+    return mEbcMixOther;
+  }
+  if (ImageList->Mix == NULL) {
+    Mix = AllocateZeroPool (sizeof (EFI_EBC_INSTRUCTION_MIX));
+    if (Mix == NULL) {
+      return mEbcMixOther;
+    }
+    //
+    // An event may have allocated it for a nested call in the meantime
+    //
+    OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+    if (ImageList->Mix == NULL) {
+      ImageList->Mix = Mix;
+      Mix = NULL;
+    }
+    gBS->RestoreTPL (OldTpl);
+    if (Mix != NULL) {
+      FreePool (Mix);
+    }
+  }
+  return ImageList->Mix;
+}
+#endif
+
+/**
+  Start counting the instruction mix of a call into EBC, if it is enabled.
+
+  The interpreter adds to the instruction mix of the image directly, rather
+  than to counters of its own for the call, as these would be too large to
+  live on the stack. A count may therefore get lost, on the rare occasions
+  where an event that runs code from the same image interrupts the update.
+
+  @param  Private       The interpreter state of the call.
+  @param  ImageHandle   The image the call belongs to.
+
+**/
+VOID
+EbcMixStart (
+  IN EBC_VM_PRIVATE               *Private,
+  IN EFI_HANDLE                   ImageHandle
+  )
+{
+  Private->InstMix = NULL;
+#if EBC_INSTRUCTION_MIX
+  if (mEbcMixEnabled) {
+    Private->InstMix = EbcMixGetImageMix (ImageHandle);
+  }
+#endif
+}
+
+/**
+  Add the instruction mix of an image that is being unloaded to the one of
+  the calls that don't belong to any image, and free it.
+
+  @param  ImageList     The image that is being unloaded.
+
+**/
+VOID
+EbcMixRetire (
+  IN EBC_IMAGE_LIST               *ImageList
+  )
+{
+#if EBC_INSTRUCTION_MIX
+  EFI_TPL  OldTpl;
+
+  if (ImageList->Mix == NULL) {
+    return;
+  }
+  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  if (mEbcMixOther != NULL) {
+    EbcMixAdd (mEbcMixOther, ImageList->Mix);
+  }
+  gBS->RestoreTPL (OldTpl);
+  FreePool (ImageList->Mix);
+  ImageList->Mix = NULL;
+#endif
+}
+
+/**
+  Enable or disable the counting.
+
+  @param[in]  This              A pointer to the EFI_EBC_PERFORMANCE_PROTOCOL structure.
+  @param[in]  Enable            TRUE to start counting, FALSE to stop.
+
+  @retval EFI_SUCCESS           The counting was enabled or disabled.
+
+**/
+EFI_STATUS
+EFIAPI
+EbcPerfEnable (
+  IN EFI_EBC_PERFORMANCE_PROTOCOL     *This,
+  IN BOOLEAN                          Enable
+  )
+{
+  //
+  // The counting goes on without the CALLEX profile if it can't be allocated
+  //
+  if (Enable && (mEbcCallExProfile == NULL)) {
+    mEbcCallExProfile = AllocateZeroPool (sizeof (EFI_EBC_CALLEX_PROFILE));
+  }
+  //
+  // Calls that are already running keep counting, or not, until they return
+  //
+  mEbcPerfEnabled = Enable;
+  return EFI_SUCCESS;
+}
+
+/**
+  Reset the counters and the instruction mix of all the images, the global
+  ones, and the CALLEX profile.
+
+  @param[in]  This              A pointer to the EFI_EBC_PERFORMANCE_PROTOCOL structure.
+
+  @retval EFI_SUCCESS           The counters were reset.
+
+**/
+EFI_STATUS
+EFIAPI
+EbcPerfReset (
+  IN EFI_EBC_PERFORMANCE_PROTOCOL     *This
+  )
+{
+  EBC_IMAGE_LIST  *ImageList;
+  EFI_TPL         OldTpl;
+
+  //
+  // The peaks restart from the stacks that are currently in use
+  //
+  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  for (ImageList = mEbcImageList; ImageList != NULL; ImageList = ImageList->Next) {
+    ZeroMem (&ImageList->Perf, sizeof (EFI_EBC_PERFORMANCE_COUNTERS));
+    ImageList->Perf.StacksPeak = EbcCountStacksInUse (ImageList->ImageHandle);
+#if EBC_INSTRUCTION_MIX
+    if (ImageList->Mix != NULL) {
+      ZeroMem (ImageList->Mix, sizeof (EFI_EBC_INSTRUCTION_MIX));
+    }
+#endif
+  }
+  ZeroMem (&mEbcPerfCounters, sizeof (EFI_EBC_PERFORMANCE_COUNTERS));
+  mEbcPerfCounters.StacksPeak = EbcCountStacksInUse (NULL);
+  if (mEbcCallExProfile != NULL) {
+    ZeroMem (mEbcCallExProfile, sizeof (EFI_EBC_CALLEX_PROFILE));
+  }
+#if EBC_INSTRUCTION_MIX
+  if (mEbcMixOther != NULL) {
+    ZeroMem (mEbcMixOther, sizeof (EFI_EBC_INSTRUCTION_MIX));
+  }
+#endif
+  gBS->RestoreTPL (OldTpl);
+  return EFI_SUCCESS;
+}
+
+/**
+  Take a copy of the counters of an EBC image, or of the global ones.
+
+  @param[in]  This              A pointer to the EFI_EBC_PERFORMANCE_PROTOCOL structure.
+  @param[in]  ImageHandle       The handle of the EBC image, or NULL for the
+                                counters of all the images.
+  @param[out] Counters          The copy of the counters.
+
+  @retval EFI_SUCCESS           The counters were copied.
+  @retval EFI_INVALID_PARAMETER Counters is NULL.
+  @retval EFI_NOT_FOUND         ImageHandle is not a known EBC image.
+
+**/
+EFI_STATUS
+EFIAPI
+EbcPerfSnapshot (
+  IN  EFI_EBC_PERFORMANCE_PROTOCOL    *This,
+  IN  EFI_HANDLE                      ImageHandle OPTIONAL,
+  OUT EFI_EBC_PERFORMANCE_COUNTERS    *Counters
+  )
+{
+  EBC_IMAGE_LIST  *ImageList;
+  EFI_TPL         OldTpl;
+
+  if (Counters == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  ImageList = NULL;
+  if (ImageHandle != NULL) {
+    ImageList = EbcGetImageList (ImageHandle, FALSE);
+    if (ImageList == NULL) {
+      return EFI_NOT_FOUND;
+    }
+  }
+
+  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  if (ImageList != NULL) {
+    CopyMem (Counters, &ImageList->Perf, sizeof (EFI_EBC_PERFORMANCE_COUNTERS));
+  } else {
+    CopyMem (Counters, &mEbcPerfCounters, sizeof (EFI_EBC_PERFORMANCE_COUNTERS));
+  }
+  Counters->StacksInUse = EbcCountStacksInUse (ImageHandle);
+  gBS->RestoreTPL (OldTpl);
+  EbcReadClock (&Counters->TimerFrequency);
+  return EFI_SUCCESS;
+}
+
+/**
+  Enable or disable the counting of the instruction mix.
+
+  @param[in]  This              A pointer to the EFI_EBC_PERFORMANCE_PROTOCOL structure.
+  @param[in]  Enable            TRUE to start counting, FALSE to stop.
+
+  @retval EFI_SUCCESS           The counting was enabled or disabled.
+  @retval EFI_UNSUPPORTED       The instruction mix was not built in.
+  @retval EFI_OUT_OF_RESOURCES  The counters could not be allocated.
+
+**/
+EFI_STATUS
+EFIAPI
+EbcPerfEnableMix (
+  IN EFI_EBC_PERFORMANCE_PROTOCOL     *This,
+  IN BOOLEAN                          Enable
+  )
+{
+#if EBC_INSTRUCTION_MIX
+  if (Enable && (mEbcMixOther == NULL)) {
+    mEbcMixOther = AllocateZeroPool (sizeof (EFI_EBC_INSTRUCTION_MIX));
+    if (mEbcMixOther == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+  //
+  // Calls that are already running keep counting, or not, until they return
+  //
+  mEbcMixEnabled = Enable;
+  return EFI_SUCCESS;
+#else
+  return EFI_UNSUPPORTED;
+#endif
+}
+
+/**
+  Take a copy of the instruction mix of an EBC image, or of all of them.
+
+  @param[in]  This              A pointer to the EFI_EBC_PERFORMANCE_PROTOCOL structure.
+  @param[in]  ImageHandle       The handle of the EBC image, or NULL for the
+                                instruction mix of all the images, including
+                                the ones that were unloaded.
+  @param[out] Mix               The copy of the instruction mix.
+
+  @retval EFI_SUCCESS           The instruction mix was copied.
+  @retval EFI_INVALID_PARAMETER Mix is NULL.
+  @retval EFI_NOT_FOUND         ImageHandle is not a known EBC image.
+  @retval EFI_UNSUPPORTED       The instruction mix was not built in.
+
+**/
+EFI_STATUS
+EFIAPI
+EbcPerfMixSnapshot (
+  IN  EFI_EBC_PERFORMANCE_PROTOCOL    *This,
+  IN  EFI_HANDLE                      ImageHandle OPTIONAL,
+  OUT EFI_EBC_INSTRUCTION_MIX         *Mix
+  )
+{
+#if EBC_INSTRUCTION_MIX
+  EBC_IMAGE_LIST  *ImageList;
+  EFI_TPL         OldTpl;
+
+  if (Mix == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  ImageList = NULL;
+  if (ImageHandle != NULL) {
+    ImageList = EbcGetImageList (ImageHandle, FALSE);
+    if (ImageList == NULL) {
+      return EFI_NOT_FOUND;
+    }
+  }
+
+  ZeroMem (Mix, sizeof (EFI_EBC_INSTRUCTION_MIX));
+  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  if (ImageList != NULL) {
+    if (ImageList->Mix != NULL) {
+      EbcMixAdd (Mix, ImageList->Mix);
+    }
+  } else {
+    if (mEbcMixOther != NULL) {
+      EbcMixAdd (Mix, mEbcMixOther);
+    }
+    for (ImageList = mEbcImageList; ImageList != NULL; ImageList = ImageList->Next) {
+      if (ImageList->Mix != NULL) {
+        EbcMixAdd (Mix, ImageList->Mix);
+      }
+    }
+  }
+  gBS->RestoreTPL (OldTpl);
+  return EFI_SUCCESS;
+#else
+  return EFI_UNSUPPORTED;
+#endif
+}
+
+/**
+  Take a copy of the CALLEX profile of all the images.
+
+  @param[in]  This              A pointer to the EFI_EBC_PERFORMANCE_PROTOCOL structure.
+  @param[out] Profile           The copy of the CALLEX profile.
+
+  @retval EFI_SUCCESS           The CALLEX profile was copied.
+  @retval EFI_INVALID_PARAMETER Profile is NULL.
+  @retval EFI_NOT_STARTED       The counting was never enabled, or the profile
+                                could not be allocated when it was.
+
+**/
+EFI_STATUS
+EFIAPI
+EbcPerfCallExSnapshot (
+  IN  EFI_EBC_PERFORMANCE_PROTOCOL    *This,
+  OUT EFI_EBC_CALLEX_PROFILE          *Profile
+  )
+{
+  EFI_TPL  OldTpl;
+
+  if (Profile == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (mEbcCallExProfile == NULL) {
+    return EFI_NOT_STARTED;
+  }
+
+  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  CopyMem (Profile, mEbcCallExProfile, sizeof (EFI_EBC_CALLEX_PROFILE));
+  gBS->RestoreTPL (OldTpl);
+  return EFI_SUCCESS;
+}
+
+/**
+  Select the clock that the times are measured with, and reset the counters.
+
+  @param[in]  This              A pointer to the EFI_EBC_PERFORMANCE_PROTOCOL structure.
+  @param[in]  Virtual           TRUE for the virtual clock, FALSE for the
+                                performance counter.
+
+  @retval EFI_SUCCESS           The clock was selected.
+
+**/
+EFI_STATUS
+EFIAPI
+EbcPerfSetClock (
+  IN EFI_EBC_PERFORMANCE_PROTOCOL     *This,
+  IN BOOLEAN                          Virtual
+  )
+{
+  EbcSetVirtualClock (Virtual);
+  return EbcPerfReset (This);
+}
+
+/**
+  Read the clock that the times are measured with.
+
+  @param[in]  This              A pointer to the EFI_EBC_PERFORMANCE_PROTOCOL structure.
+  @param[out] Ticks             The current value of the clock.
+  @param[out] Frequency         The frequency of the clock, in Hz, 0 if unknown.
+
+  @retval EFI_SUCCESS           The clock was read.
+  @retval EFI_INVALID_PARAMETER Ticks is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+EbcPerfReadClock (
+  IN  EFI_EBC_PERFORMANCE_PROTOCOL    *This,
+  OUT UINT64                          *Ticks,
+  OUT UINT64                          *Frequency OPTIONAL
+  )
+{
+  if (Ticks == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  *Ticks = EbcReadClock (Frequency);
+  return EFI_SUCCESS;
+}
+
+/**
+  Produce the EBC performance protocol.
+
+  @param  IHandle               Handle on which to install the protocol.
+
+  @retval EFI_SUCCESS           The protocol was installed.
+  @retval Others                The protocol could not be installed.
+
+**/
+EFI_STATUS
+InitEbcPerformanceProtocol (
+  IN EFI_HANDLE                   *IHandle
+  )
+{
+  EFI_HANDLE  Handle;
+
+  Handle = NULL;
+  return gBS->InstallProtocolInterface (
+                &Handle,
+                &gEfiEbcPerformanceProtocolGuid,
+                EFI_NATIVE_INTERFACE,
+                &mEbcPerformanceProtocol
+                );
+}
+
+#endif
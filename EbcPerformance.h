@@ -0,0 +1,285 @@
+/** @file
+  EBC Performance protocol, which reports how much work and time the EBC
+  interpreter spends on each EBC image, and on all of them.
+
+  The counters of a call into EBC are added when that call returns. Times are
+  in ticks of the performance counter, and include everything that was done
+  during the call, including nested calls into EBC from native code.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _EBC_PERFORMANCE_PROTOCOL_H_
+#define _EBC_PERFORMANCE_PROTOCOL_H_
+
+#define EFI_EBC_PERFORMANCE_PROTOCOL_GUID \
+  { \
+    0x6C3A9E41, 0x0B5D, 0x4E8A, { 0x9F, 0x27, 0xE1, 0x4B, 0xC0, 0x53, 0x8D, 0x72 } \
+  }
+
+#define EFI_EBC_PERFORMANCE_PROTOCOL_REVISION  0x00010003
+
+//
+// Define for forward reference.
+//
+typedef struct _EFI_EBC_PERFORMANCE_PROTOCOL EFI_EBC_PERFORMANCE_PROTOCOL;
+
+typedef struct {
+  UINT64  Instructions;         ///< EBC instructions retired
+  UINT64  Calls;                ///< EBC to EBC calls
+  UINT64  CallExs;              ///< EBC to native calls
+  UINT64  Returns;              ///< EBC returns
+  UINT64  ThunkEntries;         ///< calls into EBC from native code
+  UINT64  Exceptions;           ///< exceptions raised by the interpreter
+  UINT64  NativeTime;           ///< ticks spent in native calls
+  UINT64  ExecuteTime;          ///< ticks spent in EbcExecute()
+  UINT64  StacksInUse;          ///< EBC stacks currently in use
+  UINT64  StacksPeak;           ///< largest number of EBC stacks in use at once
+  UINT64  TimerFrequency;       ///< frequency of the ticks, in Hz, 0 if unknown
+} EFI_EBC_PERFORMANCE_COUNTERS;
+
+//
+// Instruction mix, which counts the instructions that were executed per
+// opcode and operand form, and per pair of consecutive opcodes.
+//
+// The form of an instruction is made of the two top bits of its opcode byte,
+// which select the 64-bit, immediate or index variants, and of the indirect
+// bits of its two operands. Their exact meaning depends on the instruction.
+//
+#define EFI_EBC_MIX_OPCODES             0x40
+#define EFI_EBC_MIX_FORMS               0x10
+#define EFI_EBC_MIX_FORM_BIT6           0x01  ///< bit 6 of the opcode byte
+#define EFI_EBC_MIX_FORM_BIT7           0x02  ///< bit 7 of the opcode byte
+#define EFI_EBC_MIX_FORM_OP1_INDIRECT   0x04  ///< operand 1 is indirect
+#define EFI_EBC_MIX_FORM_OP2_INDIRECT   0x08  ///< operand 2 is indirect
+
+#define EFI_EBC_MIX_FORM(OpcodeByte, OperandsByte) \
+  ((((OpcodeByte) >> 6) & 0x03) | (((OperandsByte) & 0x08) >> 1) | (((OperandsByte) & 0x80) >> 4))
+
+typedef struct {
+  UINT64  Forms[EFI_EBC_MIX_OPCODES][EFI_EBC_MIX_FORMS];    ///< per opcode and form
+  UINT64  Pairs[EFI_EBC_MIX_OPCODES][EFI_EBC_MIX_OPCODES];  ///< per previous and next opcode
+} EFI_EBC_INSTRUCTION_MIX;
+
+//
+// CALLEX profile, which counts the CALLEX instructions per target address,
+// along with the counters. A CALLEX either calls native code, directly for
+// the boot and runtime services that have a direct path, or gets redirected
+// to EBC code when its target is a thunk. Only the native calls are timed.
+//
+#define EFI_EBC_CALLEX_TARGETS          0x100
+
+typedef struct {
+  UINT64  FuncAddr;             ///< target of the CALLEX
+  UINT64  Calls;                ///< calls, 0 if the entry is free
+  UINT64  Thunks;               ///< calls redirected to EBC code through a thunk
+  UINT64  Direct;               ///< native calls that took the direct path
+  UINT64  NativeTime;           ///< ticks spent in the native calls
+  UINT64  MaxTime;              ///< ticks spent in the longest native call
+} EFI_EBC_CALLEX_TARGET;
+
+typedef struct {
+  UINT64                 Lost;  ///< calls to new targets that found the table full
+  EFI_EBC_CALLEX_TARGET  Targets[EFI_EBC_CALLEX_TARGETS];
+} EFI_EBC_CALLEX_PROFILE;
+
+//
+// Virtual clock, which makes the times that are measured the same from one
+// run to the next. Rather than with the time that elapses, it advances by a
+// fixed cost per instruction, which depends on its opcode, and by a fixed
+// cost per native call made through CALLEX. Its ticks are the cycles of a
+// nominal processor running at EFI_EBC_VIRTUAL_CLOCK_FREQUENCY.
+//
+#define EFI_EBC_VIRTUAL_CLOCK_FREQUENCY 1000000000
+
+/**
+  Enable or disable the counting. Counting is disabled when the EBC driver
+  starts, and then costs nothing.
+
+  @param[in]  This              A pointer to the EFI_EBC_PERFORMANCE_PROTOCOL structure.
+  @param[in]  Enable            TRUE to start counting, FALSE to stop.
+
+  @retval EFI_SUCCESS           The counting was enabled or disabled.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EFI_EBC_PERFORMANCE_ENABLE) (
+  IN EFI_EBC_PERFORMANCE_PROTOCOL     *This,
+  IN BOOLEAN                          Enable
+  );
+
+/**
+  Reset the counters of all the images, and the global ones.
+
+  @param[in]  This              A pointer to the EFI_EBC_PERFORMANCE_PROTOCOL structure.
+
+  @retval EFI_SUCCESS           The counters were reset.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EFI_EBC_PERFORMANCE_RESET) (
+  IN EFI_EBC_PERFORMANCE_PROTOCOL     *This
+  );
+
+/**
+  Take a copy of the counters of an EBC image, or of the global ones.
+
+  @param[in]  This              A pointer to the EFI_EBC_PERFORMANCE_PROTOCOL structure.
+  @param[in]  ImageHandle       The handle of the EBC image, or NULL for the
+                                counters of all the images.
+  @param[out] Counters          The copy of the counters.
+
+  @retval EFI_SUCCESS           The counters were copied.
+  @retval EFI_INVALID_PARAMETER Counters is NULL.
+  @retval EFI_NOT_FOUND         ImageHandle is not a known EBC image.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EFI_EBC_PERFORMANCE_SNAPSHOT) (
+  IN  EFI_EBC_PERFORMANCE_PROTOCOL    *This,
+  IN  EFI_HANDLE                      ImageHandle OPTIONAL,
+  OUT EFI_EBC_PERFORMANCE_COUNTERS    *Counters
+  );
+
+/**
+  Enable or disable the counting of the instruction mix. The instruction mix
+  is only available when the interpreter was built with EBC_INSTRUCTION_MIX,
+  and is counted independently of the other counters, as it slows down the
+  interpreter much more: it keeps the instructions from being run natively.
+
+  @param[in]  This              A pointer to the EFI_EBC_PERFORMANCE_PROTOCOL structure.
+  @param[in]  Enable            TRUE to start counting, FALSE to stop.
+
+  @retval EFI_SUCCESS           The counting was enabled or disabled.
+  @retval EFI_UNSUPPORTED       The instruction mix was not built in.
+  @retval EFI_OUT_OF_RESOURCES  The counters could not be allocated.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EFI_EBC_PERFORMANCE_ENABLE_MIX) (
+  IN EFI_EBC_PERFORMANCE_PROTOCOL     *This,
+  IN BOOLEAN                          Enable
+  );
+
+/**
+  Take a copy of the instruction mix of an EBC image, or of all of them.
+  The instruction mix is reset along with the other counters.
+
+  @param[in]  This              A pointer to the EFI_EBC_PERFORMANCE_PROTOCOL structure.
+  @param[in]  ImageHandle       The handle of the EBC image, or NULL for the
+                                instruction mix of all the images, including
+                                the ones that were unloaded.
+  @param[out] Mix               The copy of the instruction mix.
+
+  @retval EFI_SUCCESS           The instruction mix was copied.
+  @retval EFI_INVALID_PARAMETER Mix is NULL.
+  @retval EFI_NOT_FOUND         ImageHandle is not a known EBC image.
+  @retval EFI_UNSUPPORTED       The instruction mix was not built in.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EFI_EBC_PERFORMANCE_MIX_SNAPSHOT) (
+  IN  EFI_EBC_PERFORMANCE_PROTOCOL    *This,
+  IN  EFI_HANDLE                      ImageHandle OPTIONAL,
+  OUT EFI_EBC_INSTRUCTION_MIX         *Mix
+  );
+
+/**
+  Take a copy of the CALLEX profile of all the images. The CALLEX profile is
+  reset along with the other counters.
+
+  @param[in]  This              A pointer to the EFI_EBC_PERFORMANCE_PROTOCOL structure.
+  @param[out] Profile           The copy of the CALLEX profile.
+
+  @retval EFI_SUCCESS           The CALLEX profile was copied.
+  @retval EFI_INVALID_PARAMETER Profile is NULL.
+  @retval EFI_NOT_STARTED       The counting was never enabled, or the profile
+                                could not be allocated when it was.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EFI_EBC_PERFORMANCE_CALLEX_SNAPSHOT) (
+  IN  EFI_EBC_PERFORMANCE_PROTOCOL    *This,
+  OUT EFI_EBC_CALLEX_PROFILE          *Profile
+  );
+
+/**
+  Select the clock that the times are measured with: the performance counter,
+  which is the default, or the virtual clock. The virtual clock restarts from
+  0, and the counters are reset, as the times measured with the two clocks
+  cannot be added. While the virtual clock runs, the periodic callback of the
+  debug support protocol is called by the interpreter each time the virtual
+  clock has advanced by its period, rather than by a timer.
+
+  @param[in]  This              A pointer to the EFI_EBC_PERFORMANCE_PROTOCOL structure.
+  @param[in]  Virtual           TRUE for the virtual clock, FALSE for the
+                                performance counter.
+
+  @retval EFI_SUCCESS           The clock was selected.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EFI_EBC_PERFORMANCE_SET_CLOCK) (
+  IN EFI_EBC_PERFORMANCE_PROTOCOL     *This,
+  IN BOOLEAN                          Virtual
+  );
+
+/**
+  Read the clock that the times are measured with.
+
+  @param[in]  This              A pointer to the EFI_EBC_PERFORMANCE_PROTOCOL structure.
+  @param[out] Ticks             The current value of the clock.
+  @param[out] Frequency         The frequency of the clock, in Hz, 0 if unknown.
+
+  @retval EFI_SUCCESS           The clock was read.
+  @retval EFI_INVALID_PARAMETER Ticks is NULL.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EFI_EBC_PERFORMANCE_READ_CLOCK) (
+  IN  EFI_EBC_PERFORMANCE_PROTOCOL    *This,
+  OUT UINT64                          *Ticks,
+  OUT UINT64                          *Frequency OPTIONAL
+  );
+
+struct _EFI_EBC_PERFORMANCE_PROTOCOL {
+  UINT64                               Revision;
+  EFI_EBC_PERFORMANCE_ENABLE           Enable;
+  EFI_EBC_PERFORMANCE_RESET            Reset;
+  EFI_EBC_PERFORMANCE_SNAPSHOT         Snapshot;
+  //
+  // Revision 0x00010001
+  //
+  EFI_EBC_PERFORMANCE_ENABLE_MIX       EnableMix;
+  EFI_EBC_PERFORMANCE_MIX_SNAPSHOT     MixSnapshot;
+  //
+  // Revision 0x00010002
+  //
+  EFI_EBC_PERFORMANCE_CALLEX_SNAPSHOT  CallExSnapshot;
+  //
+  // Revision 0x00010003
+  //
+  EFI_EBC_PERFORMANCE_SET_CLOCK        SetClock;
+  EFI_EBC_PERFORMANCE_READ_CLOCK       ReadClock;
+};
+
+extern EFI_GUID gEfiEbcPerformanceProtocolGuid;
+
+#endif
@@ -0,0 +1,106 @@
+/** @file
+  Policy table of the EBC images, which sets how the interpreter runs the
+  images that need other settings than the defaults.
+
+  The images are listed by the GUID of the firmware file they are loaded
+  from, which is the FILE_GUID of their INF. The images that are loaded from
+  elsewhere, such as option ROMs, always get the defaults. The EBC debugger
+  can still override the settings of any image once it is loaded.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "EbcInt.h"
+
+//
+// The settings left to 0 use the defaults. For instance, to give a driver a
+// stack of 2 MB, and abort the calls into it that go through more than 16M
+// backward jumps and calls:
+//
+//  { { 0x01234567, 0x89ab, 0xcdef, { 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef } }, 0x200000, 0x1000000 },
+//
+// A watchdog budget of EBC_WATCHDOG_DISABLED turns the watchdog off for an
+// image, when it is on by default.
+//
+// The last entry only keeps the table from being empty, as no file can have
+// a null GUID.
+//
+EBC_IMAGE_POLICY  mEbcImagePolicy[] = {
+  { { 0x00000000, 0x0000, 0x0000, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } }, 0, 0 }
+};
+
+/**
+  Get the GUID of the firmware file that an image was loaded from.
+
+  @param  LoadedImage   The loaded image protocol of the image.
+
+  @return The GUID of the file, or NULL if the image wasn't loaded from a
+          firmware volume.
+
+**/
+EFI_GUID *
+EbcGetImageFileGuid (
+  IN EFI_LOADED_IMAGE_PROTOCOL  *LoadedImage
+  )
+{
+  EFI_DEVICE_PATH_PROTOCOL  *Node;
+  UINTN                     Length;
+
+  Node = LoadedImage->FilePath;
+  while ((Node != NULL) && (Node->Type != END_DEVICE_PATH_TYPE)) {
+    if ((Node->Type == MEDIA_DEVICE_PATH) && (Node->SubType == MEDIA_PIWG_FW_FILE_DP)) {
+      return &((MEDIA_FW_VOL_FILEPATH_DEVICE_PATH *) Node)->FvFileName;
+    }
+    Length = Node->Length[0] | (Node->Length[1] << 8);
+    if (Length < sizeof (EFI_DEVICE_PATH_PROTOCOL)) {
+      break;
+    }
+    Node = (EFI_DEVICE_PATH_PROTOCOL *) ((UINT8 *) Node + Length);
+  }
+  return NULL;
+}
+
+/**
+  Apply the policy of an EBC image, once it is loaded.
+
+  The settings of the policy that are not valid are ignored, and the image
+  gets the defaults instead.
+
+  @param  ImageList     The image list element of the image.
+  @param  LoadedImage   The loaded image protocol of the image.
+
+**/
+VOID
+EbcApplyImagePolicy (
+  IN EBC_IMAGE_LIST             *ImageList,
+  IN EFI_LOADED_IMAGE_PROTOCOL  *LoadedImage
+  )
+{
+  EFI_GUID  *FileGuid;
+  UINTN     Index;
+
+  FileGuid = EbcGetImageFileGuid (LoadedImage);
+  if (FileGuid == NULL) {
+    return;
+  }
+
+  for (Index = 0; Index < sizeof (mEbcImagePolicy) / sizeof (mEbcImagePolicy[0]); Index++) {
+    if (CompareMem (&mEbcImagePolicy[Index].FileGuid, FileGuid, sizeof (EFI_GUID)) != 0) {
+      continue;
+    }
+    if (mEbcImagePolicy[Index].StackSize >= STACK_POOL_SIZE_MIN) {
+      ImageList->StackPolicy = EBC_ALIGN_STACK_SIZE (mEbcImagePolicy[Index].StackSize);
+    }
+    ImageList->WatchdogPolicy = mEbcImagePolicy[Index].WatchdogBudget;
+    return;
+  }
+}
@@ -0,0 +1,57 @@
+#!/bin/sh
+#
+# Run the interpreter benchmarks of the host build, and compare them with the
+# baseline of the repository, so that a change that slows the interpreter
+# down fails.
+#
+#   ./BenchCheck.sh                 Compare with BenchBaseline.csv, 7 runs, 5% threshold
+#   ./BenchCheck.sh -n 15 -t 10     Do 15 runs, and only fail on a 10% slow down
+#   ./BenchCheck.sh -b Other.csv    Compare with another baseline
+#   ./BenchCheck.sh -u              Replace the baseline with a new run
+#
+# EdbCfg BENCH runs the opcode benchmarks and the corpus programs N times,
+# interleaved, and prints the median time per instruction of each with its
+# 95% confidence interval. BENCH CHECK then prints the change of each one,
+# and of each interpreter function, from the baseline. It fails when the low
+# end of the interval of a benchmark is slower than the baseline by more
+# than the threshold.
+#
+# The baseline depends on the machine, and BenchBaseline.csv comes from the
+# reference host. Make one on another machine with -u before a change, then
+# compare after it. Paths are relative to this directory.
+#
+
+set -e
+
+cd "$(dirname "$0")"
+
+RUNS=7
+THRESHOLD=5
+BASELINE=BenchBaseline.csv
+UPDATE=
+
+while getopts "n:t:b:u" OPTION; do
+  case $OPTION in
+    n) RUNS=$OPTARG ;;
+    t) THRESHOLD=$OPTARG ;;
+    b) BASELINE=$OPTARG ;;
+    u) UPDATE=1 ;;
+    *) sed -n '7,10s/^# *//p' "$0" >&2; exit 2 ;;
+  esac
+done
+
+make -s
+
+#
+# The iterations are the default of BENCH CHECK, so that the times compare
+#
+if [ -n "$UPDATE" ]; then
+  ./build/EdbCfg BENCH 100000 "$RUNS" > "$BASELINE.new"
+  mv "$BASELINE.new" "$BASELINE"
+  echo "Updated $BASELINE"
+else
+  STATUS=0
+  ./build/EdbCfg BENCH CHECK "$BASELINE" "$THRESHOLD" "$RUNS" > build/BenchCheck.csv || STATUS=$?
+  cat build/BenchCheck.csv
+  exit $STATUS
+fi
@@ -0,0 +1,748 @@
+/** @file
+  Merge the coverage files that the debugger saves, and annotate them against
+  the MAP and COD files of the images.
+
+  A coverage file has one bitmap per image, with one bit per 2-byte unit of
+  the image, set where an instruction was executed (see EdbCommon.h). Each
+  image record carries the name of the MAP file that the debugger had loaded
+  for it, which is how it is matched to a MAP file here. The functions of the
+  MAP file give the coverage per function, and the listings of the COD files
+  get a mark on each instruction, the same way the debugger finds the source
+  of an address.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "EdbCommon.h"
+#include "EdbSymbol.h"
+
+#define COV_MAX_LINE    1024
+
+typedef struct {
+  EFI_DEBUGGER_COVERAGE_FILE_IMAGE  Header;
+  UINT8                             *Bitmap;
+} COV_IMAGE;
+
+typedef struct {
+  UINTN                             ImageCount;
+  COV_IMAGE                         *Image;
+} COV_FILE;
+
+typedef struct {
+  CHAR8                             *Name;
+  UINTN                             Rva;
+  UINTN                             Size;
+} COV_FUNCTION;
+
+typedef struct {
+  UINTN                             FunctionCount;
+  COV_FUNCTION                      *Function;
+} COV_MAP;
+
+/**
+  Add an image to a coverage file.
+
+  @param  Cov           The coverage file.
+  @param  Header        The header of the image.
+  @param  Bitmap        The bitmap of the image, which is copied.
+
+  @return The new image, or NULL if out of memory.
+
+**/
+COV_IMAGE *
+CovAddImage (
+  IN OUT COV_FILE                         *Cov,
+  IN     EFI_DEBUGGER_COVERAGE_FILE_IMAGE *Header,
+  IN     UINT8                            *Bitmap
+  )
+{
+  COV_IMAGE  *Image;
+
+  Image = realloc (Cov->Image, (Cov->ImageCount + 1) * sizeof (COV_IMAGE));
+  if (Image == NULL) {
+    return NULL;
+  }
+  Cov->Image = Image;
+  Image      = &Cov->Image[Cov->ImageCount];
+  memcpy (&Image->Header, Header, sizeof (*Header));
+  Image->Header.Name[EFI_DEBUGGER_COVERAGE_NAME_MAX - 1] = 0;
+  Image->Bitmap = malloc (Header->BitmapSize);
+  if (Image->Bitmap == NULL) {
+    return NULL;
+  }
+  memcpy (Image->Bitmap, Bitmap, Header->BitmapSize);
+  Cov->ImageCount++;
+  return Image;
+}
+
+/**
+  Free the images of a coverage file.
+
+  @param  Cov           The coverage file.
+
+**/
+VOID
+CovFree (
+  IN COV_FILE  *Cov
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Cov->ImageCount; Index++) {
+    free (Cov->Image[Index].Bitmap);
+  }
+  free (Cov->Image);
+  memset (Cov, 0, sizeof (*Cov));
+}
+
+/**
+  Read a coverage file, and check its format.
+
+  @param  FileName      The file to read.
+  @param  Cov           Returns the images of the file.
+
+  @retval TRUE          The file was read.
+  @retval FALSE         The file could not be read, or is not a coverage file.
+
+**/
+BOOLEAN
+CovRead (
+  IN  CONST CHAR8  *FileName,
+  OUT COV_FILE     *Cov
+  )
+{
+  FILE                               *File;
+  EFI_DEBUGGER_COVERAGE_FILE_HEADER  FileHeader;
+  EFI_DEBUGGER_COVERAGE_FILE_IMAGE   FileImage;
+  UINT8                              *Bitmap;
+  UINTN                              Index;
+  BOOLEAN                            Result;
+
+  memset (Cov, 0, sizeof (*Cov));
+  File = fopen (FileName, "rb");
+  if (File == NULL) {
+    fprintf (stderr, "Cannot open %s\n", FileName);
+    return FALSE;
+  }
+
+  Result = FALSE;
+  if ((fread (&FileHeader, sizeof (FileHeader), 1, File) != 1) ||
+      (FileHeader.Signature != EFI_DEBUGGER_COVERAGE_SIGNATURE) ||
+      (FileHeader.Version != EFI_DEBUGGER_COVERAGE_VERSION) ||
+      (FileHeader.UnitSize != EFI_DEBUGGER_COVERAGE_UNIT)) {
+    fprintf (stderr, "%s is not a coverage file\n", FileName);
+    goto Done;
+  }
+
+  for (Index = 0; Index < FileHeader.ImageCount; Index++) {
+    if ((fread (&FileImage, sizeof (FileImage), 1, File) != 1) ||
+        (FileImage.BitmapSize != EFI_DEBUGGER_COVERAGE_BITMAP_SIZE (FileImage.ImageSize))) {
+      fprintf (stderr, "%s is truncated or corrupted\n", FileName);
+      goto Done;
+    }
+    Bitmap = malloc (FileImage.BitmapSize);
+    if (Bitmap == NULL) {
+      goto Done;
+    }
+    if (fread (Bitmap, 1, FileImage.BitmapSize, File) != FileImage.BitmapSize) {
+      fprintf (stderr, "%s is truncated or corrupted\n", FileName);
+      free (Bitmap);
+      goto Done;
+    }
+    if (CovAddImage (Cov, &FileImage, Bitmap) == NULL) {
+      free (Bitmap);
+      goto Done;
+    }
+    free (Bitmap);
+  }
+  Result = TRUE;
+
+Done:
+  fclose (File);
+  if (!Result) {
+    CovFree (Cov);
+  }
+  return Result;
+}
+
+/**
+  Write a coverage file, in the format of the debugger.
+
+  @param  FileName      The file to write.
+  @param  Cov           The images to write.
+
+  @retval TRUE          The file was written.
+  @retval FALSE         The file could not be written.
+
+**/
+BOOLEAN
+CovWrite (
+  IN CONST CHAR8  *FileName,
+  IN COV_FILE     *Cov
+  )
+{
+  FILE                               *File;
+  EFI_DEBUGGER_COVERAGE_FILE_HEADER  FileHeader;
+  UINTN                              Index;
+  BOOLEAN                            Result;
+
+  File = fopen (FileName, "wb");
+  if (File == NULL) {
+    fprintf (stderr, "Cannot create %s\n", FileName);
+    return FALSE;
+  }
+
+  memset (&FileHeader, 0, sizeof (FileHeader));
+  FileHeader.Signature  = EFI_DEBUGGER_COVERAGE_SIGNATURE;
+  FileHeader.Version    = EFI_DEBUGGER_COVERAGE_VERSION;
+  FileHeader.ImageCount = (UINT32) Cov->ImageCount;
+  FileHeader.UnitSize   = EFI_DEBUGGER_COVERAGE_UNIT;
+  Result = (BOOLEAN) (fwrite (&FileHeader, sizeof (FileHeader), 1, File) == 1);
+  for (Index = 0; Result && (Index < Cov->ImageCount); Index++) {
+    Result = (BOOLEAN) ((fwrite (&Cov->Image[Index].Header, sizeof (Cov->Image[Index].Header), 1, File) == 1) &&
+                        (fwrite (Cov->Image[Index].Bitmap, 1, Cov->Image[Index].Header.BitmapSize, File) ==
+                         Cov->Image[Index].Header.BitmapSize));
+  }
+
+  if (fclose (File) != 0) {
+    Result = FALSE;
+  }
+  if (!Result) {
+    fprintf (stderr, "Cannot write %s\n", FileName);
+  }
+  return Result;
+}
+
+/**
+  Check whether two image records are the coverage of the same image.
+
+  Images are matched on the name of their MAP file. Without one, only an
+  image loaded at the same address can be told to be the same.
+
+  @param  Image1        The first image.
+  @param  Image2        The second image.
+
+  @retval TRUE          The images are the same.
+  @retval FALSE         The images are different.
+
+**/
+BOOLEAN
+CovSameImage (
+  IN EFI_DEBUGGER_COVERAGE_FILE_IMAGE  *Image1,
+  IN EFI_DEBUGGER_COVERAGE_FILE_IMAGE  *Image2
+  )
+{
+  if (Image1->ImageSize != Image2->ImageSize) {
+    return FALSE;
+  }
+  if (strcasecmp (Image1->Name, Image2->Name) != 0) {
+    return FALSE;
+  }
+  return (BOOLEAN) ((Image1->Name[0] != 0) || (Image1->ImageBase == Image2->ImageBase));
+}
+
+/**
+  Check whether an instruction was executed at an offset of an image.
+
+  @param  Image         The coverage of the image.
+  @param  Rva           The offset in the image.
+
+  @retval TRUE          An instruction was executed there.
+  @retval FALSE         No instruction was executed there.
+
+**/
+BOOLEAN
+CovIsExecuted (
+  IN COV_IMAGE  *Image,
+  IN UINTN      Rva
+  )
+{
+  UINTN  Unit;
+
+  if (Rva >= Image->Header.ImageSize) {
+    return FALSE;
+  }
+  Unit = Rva / EFI_DEBUGGER_COVERAGE_UNIT;
+  return (BOOLEAN) ((Image->Bitmap[Unit / 8] & (1 << (Unit % 8))) != 0);
+}
+
+/**
+  Count the instructions executed in a range of an image.
+
+  @param  Image         The coverage of the image.
+  @param  Rva           The start of the range.
+  @param  Size          The size of the range.
+
+  @return The number of units in the range where an instruction was executed.
+
+**/
+UINTN
+CovCountExecuted (
+  IN COV_IMAGE  *Image,
+  IN UINTN      Rva,
+  IN UINTN      Size
+  )
+{
+  UINTN  Count;
+  UINTN  Offset;
+
+  Count = 0;
+  for (Offset = Rva; Offset < Rva + Size; Offset += EFI_DEBUGGER_COVERAGE_UNIT) {
+    if (CovIsExecuted (Image, Offset)) {
+      Count++;
+    }
+  }
+  return Count;
+}
+
+/**
+  Sort the functions of a MAP file by address.
+
+**/
+int
+CovCompareFunction (
+  CONST VOID  *Function1,
+  CONST VOID  *Function2
+  )
+{
+  CONST COV_FUNCTION  *F1;
+  CONST COV_FUNCTION  *F2;
+
+  F1 = Function1;
+  F2 = Function2;
+  return (F1->Rva < F2->Rva) ? -1 : (F1->Rva > F2->Rva) ? 1 : 0;
+}
+
+/**
+  Read the functions of a MAP file, as the debugger does when it loads its
+  symbols. Each function ends where the next one starts, or at the end of
+  the image.
+
+  @param  FileName      The MAP file.
+  @param  ImageSize     The size of the image.
+  @param  Map           Returns the functions, by address.
+
+  @retval TRUE          The file was read.
+  @retval FALSE         The file could not be read.
+
+**/
+BOOLEAN
+CovReadMap (
+  IN  CONST CHAR8  *FileName,
+  IN  UINTN        ImageSize,
+  OUT COV_MAP      *Map
+  )
+{
+  FILE                *File;
+  CHAR8               Line[COV_MAX_LINE];
+  CHAR8               Name[COV_MAX_LINE];
+  CHAR8               Type[COV_MAX_LINE];
+  unsigned long long  PreferredBase;
+  unsigned long long  Address;
+  unsigned int        Section;
+  unsigned int        Offset;
+  BOOLEAN             HasPreferredBase;
+  BOOLEAN             InSymbols;
+  COV_FUNCTION        *Function;
+  UINTN               Index;
+
+  memset (Map, 0, sizeof (*Map));
+  File = fopen (FileName, "r");
+  if (File == NULL) {
+    fprintf (stderr, "Cannot open %s\n", FileName);
+    return FALSE;
+  }
+
+  HasPreferredBase = FALSE;
+  InSymbols        = FALSE;
+  PreferredBase    = 0;
+  while (fgets (Line, sizeof (Line), File) != NULL) {
+    if (sscanf (Line, " Preferred load address is %llx", &PreferredBase) == 1) {
+      HasPreferredBase = TRUE;
+      continue;
+    }
+    if ((strstr (Line, "Publics by Value") != NULL) || (strstr (Line, "Static symbols") != NULL)) {
+      InSymbols = TRUE;
+      continue;
+    }
+    //
+    // Only the symbols of type "f" are functions
+    //
+    if (!InSymbols ||
+        (sscanf (Line, " %x:%x %s %llx %s", &Section, &Offset, Name, &Address, Type) != 5) ||
+        (strcmp (Type, "f") != 0)) {
+      continue;
+    }
+    Function = realloc (Map->Function, (Map->FunctionCount + 1) * sizeof (COV_FUNCTION));
+    if (Function == NULL) {
+      break;
+    }
+    Map->Function = Function;
+    Function      = &Map->Function[Map->FunctionCount++];
+    Function->Name = strdup (Name);
+    //
+    // Without a preferred load address, the debugger takes the offset from
+    // its default link address
+    //
+    if (HasPreferredBase) {
+      Function->Rva = (UINTN) (Address - PreferredBase);
+    } else {
+      Function->Rva = (UINTN) (Address % EFI_DEBUGGER_DEFAULT_LINK_IMAGEBASE);
+    }
+  }
+  fclose (File);
+
+  if (Map->FunctionCount == 0) {
+    fprintf (stderr, "%s has no functions\n", FileName);
+    return FALSE;
+  }
+
+  qsort (Map->Function, Map->FunctionCount, sizeof (COV_FUNCTION), CovCompareFunction);
+  for (Index = 0; Index < Map->FunctionCount; Index++) {
+    if (Index + 1 < Map->FunctionCount) {
+      Map->Function[Index].Size = Map->Function[Index + 1].Rva - Map->Function[Index].Rva;
+    } else if (Map->Function[Index].Rva < ImageSize) {
+      Map->Function[Index].Size = ImageSize - Map->Function[Index].Rva;
+    }
+  }
+  return TRUE;
+}
+
+/**
+  Free the functions of a MAP file.
+
+  @param  Map           The functions.
+
+**/
+VOID
+CovFreeMap (
+  IN COV_MAP  *Map
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Map->FunctionCount; Index++) {
+    free (Map->Function[Index].Name);
+  }
+  free (Map->Function);
+  memset (Map, 0, sizeof (*Map));
+}
+
+/**
+  Find the image of a coverage file that a MAP file is for.
+
+  @param  Cov           The coverage file.
+  @param  MapFileName   The MAP file.
+
+  @return The image, or NULL if there is none.
+
+**/
+COV_IMAGE *
+CovFindImage (
+  IN COV_FILE     *Cov,
+  IN CONST CHAR8  *MapFileName
+  )
+{
+  CONST CHAR8  *BaseName;
+  UINTN        Index;
+
+  BaseName = strrchr (MapFileName, '/');
+  BaseName = (BaseName == NULL) ? MapFileName : BaseName + 1;
+  for (Index = 0; Index < Cov->ImageCount; Index++) {
+    if (strcasecmp (Cov->Image[Index].Header.Name, BaseName) == 0) {
+      return &Cov->Image[Index];
+    }
+  }
+
+  //
+  // The debugger only names the images that it has symbols for
+  //
+  if (Cov->ImageCount == 1) {
+    return &Cov->Image[0];
+  }
+  return NULL;
+}
+
+/**
+  Print the coverage of each function of a MAP file.
+
+  @param  Image         The coverage of the image.
+  @param  Map           The functions of the image.
+
+**/
+VOID
+CovPrintFunctions (
+  IN COV_IMAGE  *Image,
+  IN COV_MAP    *Map
+  )
+{
+  COV_FUNCTION  *Function;
+  UINTN         Index;
+  UINTN         Executed;
+  UINTN         Entered;
+
+  printf ("  Executed      Rva     Size Function\n");
+  printf ("  ======== ======== ======== ========\n");
+  Entered = 0;
+  for (Index = 0; Index < Map->FunctionCount; Index++) {
+    Function = &Map->Function[Index];
+    Executed = CovCountExecuted (Image, Function->Rva, Function->Size);
+    if (Executed != 0) {
+      Entered++;
+      printf ("  %8lu", (unsigned long) Executed);
+    } else {
+      printf ("         -");
+    }
+    printf (" %08lx %08lx %s\n", (unsigned long) Function->Rva, (unsigned long) Function->Size, Function->Name);
+  }
+  printf ("  %lu of %lu functions executed\n\n", (unsigned long) Entered, (unsigned long) Map->FunctionCount);
+}
+
+/**
+  Print the listing of a COD file, with a mark on each instruction of the
+  functions that are in the MAP file: '+' if it was executed, '-' if not.
+
+  The offsets of a function's listing start from the first instruction of
+  the listing, which is at the address of the function's symbol.
+
+  @param  FileName      The COD file.
+  @param  Image         The coverage of the image.
+  @param  Map           The functions of the image.
+
+  @retval TRUE          The file was read.
+  @retval FALSE         The file could not be read.
+
+**/
+BOOLEAN
+CovAnnotateCod (
+  IN CONST CHAR8  *FileName,
+  IN COV_IMAGE    *Image,
+  IN COV_MAP      *Map
+  )
+{
+  FILE          *File;
+  CHAR8         Line[COV_MAX_LINE];
+  CHAR8         *Tab;
+  COV_FUNCTION  *Function;
+  BOOLEAN       InFunctions;
+  UINTN         Offset;
+  UINTN         OffsetBase;
+  UINTN         Index;
+  CHAR8         Mark;
+
+  File = fopen (FileName, "r");
+  if (File == NULL) {
+    fprintf (stderr, "Cannot open %s\n", FileName);
+    return FALSE;
+  }
+
+  printf ("%s:\n", FileName);
+  InFunctions = FALSE;
+  Function    = NULL;
+  OffsetBase  = (UINTN) -1;
+  while (fgets (Line, sizeof (Line), File) != NULL) {
+    Mark = ' ';
+    if (strncmp (Line, "; mark_begin;", sizeof ("; mark_begin;") - 1) == 0) {
+      InFunctions = TRUE;
+    } else if (strncmp (Line, "; mark_end;", sizeof ("; mark_end;") - 1) == 0) {
+      InFunctions = FALSE;
+      Function    = NULL;
+    } else if (InFunctions && (strchr ("$;_ \r\n", Line[0]) == NULL)) {
+      //
+      // The name of a function is followed by a tab
+      //
+      Tab = strchr (Line, '\t');
+      if (Tab != NULL) {
+        *Tab = 0;
+        for (Function = NULL, Index = 0; Index < Map->FunctionCount; Index++) {
+          if (strcasecmp (Map->Function[Index].Name, Line) == 0) {
+            Function = &Map->Function[Index];
+            break;
+          }
+        }
+        *Tab = '\t';
+        OffsetBase = (UINTN) -1;
+      }
+    } else if ((Function != NULL) && (Line[0] == ' ') && (Line[1] == ' ') && isxdigit ((unsigned char) Line[2])) {
+      Offset = (UINTN) strtoul (&Line[2], NULL, 16);
+      if (OffsetBase == (UINTN) -1) {
+        OffsetBase = Offset;
+      }
+      Mark = CovIsExecuted (Image, Function->Rva + Offset - OffsetBase) ? '+' : '-';
+    }
+    printf ("%c %s", Mark, Line);
+  }
+  fclose (File);
+  printf ("\n");
+  return TRUE;
+}
+
+/**
+  Merge coverage files into one. The bitmaps of the same image are or'ed.
+
+  @param  OutFileName   The file to write.
+  @param  Count         The number of files to merge.
+  @param  InFileName    The files to merge.
+
+  @return The exit code of the program.
+
+**/
+int
+CovMerge (
+  IN CONST CHAR8  *OutFileName,
+  IN UINTN        Count,
+  IN CHAR8        **InFileName
+  )
+{
+  COV_FILE   Out;
+  COV_FILE   In;
+  COV_IMAGE  *Image;
+  UINTN      FileIndex;
+  UINTN      InIndex;
+  UINTN      OutIndex;
+  UINTN      Index;
+  int        Result;
+
+  memset (&Out, 0, sizeof (Out));
+  Result = 1;
+  for (FileIndex = 0; FileIndex < Count; FileIndex++) {
+    if (!CovRead (InFileName[FileIndex], &In)) {
+      goto Done;
+    }
+    for (InIndex = 0; InIndex < In.ImageCount; InIndex++) {
+      for (OutIndex = 0; OutIndex < Out.ImageCount; OutIndex++) {
+        if (CovSameImage (&Out.Image[OutIndex].Header, &In.Image[InIndex].Header)) {
+          break;
+        }
+      }
+      if (OutIndex == Out.ImageCount) {
+        if (CovAddImage (&Out, &In.Image[InIndex].Header, In.Image[InIndex].Bitmap) == NULL) {
+          CovFree (&In);
+          goto Done;
+        }
+        continue;
+      }
+      Image = &Out.Image[OutIndex];
+      for (Index = 0; Index < Image->Header.BitmapSize; Index++) {
+        Image->Bitmap[Index] |= In.Image[InIndex].Bitmap[Index];
+      }
+    }
+    CovFree (&In);
+  }
+
+  if (CovWrite (OutFileName, &Out)) {
+    printf ("Merged %lu files, %lu images\n", (unsigned long) Count, (unsigned long) Out.ImageCount);
+    Result = 0;
+  }
+
+Done:
+  CovFree (&Out);
+  return Result;
+}
+
+/**
+  Print the coverage of each image of a coverage file, and with a MAP file,
+  of each function of its image, and the annotated COD files.
+
+  @param  CovFileName   The coverage file.
+  @param  MapFileName   The MAP file, or NULL.
+  @param  Count         The number of COD files.
+  @param  CodFileName   The COD files.
+
+  @return The exit code of the program.
+
+**/
+int
+CovReport (
+  IN CONST CHAR8  *CovFileName,
+  IN CONST CHAR8  *MapFileName,
+  IN UINTN        Count,
+  IN CHAR8        **CodFileName
+  )
+{
+  COV_FILE   Cov;
+  COV_MAP    Map;
+  COV_IMAGE  *Image;
+  UINTN      Index;
+  int        Result;
+
+  if (!CovRead (CovFileName, &Cov)) {
+    return 1;
+  }
+
+  printf ("              Base     Size Executed Name\n");
+  printf ("  ================ ======== ======== ========\n");
+  for (Index = 0; Index < Cov.ImageCount; Index++) {
+    Image = &Cov.Image[Index];
+    printf (
+      "  %016llx %08x %8lu %s\n",
+      (unsigned long long) Image->Header.ImageBase,
+      Image->Header.ImageSize,
+      (unsigned long) CovCountExecuted (Image, 0, Image->Header.ImageSize),
+      Image->Header.Name
+      );
+  }
+  printf ("\n");
+
+  Result = 0;
+  memset (&Map, 0, sizeof (Map));
+  if (MapFileName != NULL) {
+    Image = CovFindImage (&Cov, MapFileName);
+    if (Image == NULL) {
+      fprintf (stderr, "%s has no image for %s\n", CovFileName, MapFileName);
+      Result = 1;
+    } else if (!CovReadMap (MapFileName, Image->Header.ImageSize, &Map)) {
+      Result = 1;
+    } else {
+      printf ("%s:\n", MapFileName);
+      CovPrintFunctions (Image, &Map);
+      for (Index = 0; Index < Count; Index++) {
+        if (!CovAnnotateCod (CodFileName[Index], Image, &Map)) {
+          Result = 1;
+        }
+      }
+    }
+    CovFreeMap (&Map);
+  }
+
+  CovFree (&Cov);
+  return Result;
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  if ((argc >= 4) && (strcasecmp (argv[1], "MERGE") == 0)) {
+    return CovMerge (argv[2], (UINTN) argc - 3, &argv[3]);
+  }
+  if ((argc >= 3) && (strcasecmp (argv[1], "REPORT") == 0)) {
+    return CovReport (argv[2], (argc >= 4) ? argv[3] : NULL, (argc >= 4) ? (UINTN) argc - 4 : 0, &argv[4]);
+  }
+
+  fprintf (
+    stderr,
+    "usage: %s <Command>\n"
+    "  MERGE <Out> <File>...              - Merge coverage files, or'ing the bitmaps of each image.\n"
+    "  REPORT <File> [<Map> [<Cod>...]]   - Show the coverage of each image, of the functions\n"
+    "                                       of a MAP file, and of the listings of COD files.\n",
+    argv[0]
+    );
+  return 2;
+}
@@ -0,0 +1,120 @@
+/** @file
+  Run an EBC image on the host, and report the speed of the interpreter.
+
+  The interpreter driver is started on an image handle of its own. The image
+  is then loaded and started from another one, as EdbCfg RUN does it in the
+  shell, which also reports the instructions retired, the wall time and the
+  MIPS. No debugger is attached, so the breakpoints that the image executes
+  are skipped, instead of stopping in the default exception handler. With
+  VIRTUAL, the times are measured with the virtual clock, as with EdbCfg RUN.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Protocol/DebugSupport.h>
+
+#include "Host.h"
+
+EFI_STATUS
+EFIAPI
+InitializeEbcDriver (
+  IN EFI_HANDLE           ImageHandle,
+  IN EFI_SYSTEM_TABLE     *SystemTable
+  );
+
+EFI_STATUS
+EdbRunImage (
+  EFI_HANDLE                          ImageHandle,
+  CHAR16                              *FileName,
+  BOOLEAN                             WithMix,
+  BOOLEAN                             Virtual
+  );
+
+/**
+  Skip a breakpoint of the EBC image, as there is no debugger to break into.
+
+  @param  ExceptionType  The EBC exception, which is a breakpoint.
+  @param  SystemContext  The EBC context, which is left alone.
+
+**/
+VOID
+EFIAPI
+EbcRunSkipBreakpoint (
+  IN     EFI_EXCEPTION_TYPE   ExceptionType,
+  IN OUT EFI_SYSTEM_CONTEXT   SystemContext
+  )
+{
+}
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  EFI_STATUS                  Status;
+  EFI_HANDLE                  DriverHandle;
+  EFI_HANDLE                  AppHandle;
+  EFI_DEBUG_SUPPORT_PROTOCOL  *DebugSupport;
+  CHAR16                      *FileName;
+  UINTN                       Length;
+  BOOLEAN                     Virtual;
+
+  Virtual = (BOOLEAN) ((argc == 3) && (AsciiStriCmp (argv[2], "VIRTUAL") == 0));
+  if ((argc != 2) && !Virtual) {
+    fprintf (stderr, "usage: %s <File> [VIRTUAL]\n", argv[0]);
+    return 1;
+  }
+
+  Status = HostInitServices (&DriverHandle);
+  if (!EFI_ERROR (Status)) {
+    Status = InitializeEbcDriver (DriverHandle, gST);
+  }
+  if (!EFI_ERROR (Status)) {
+    Status = HostInitServices (&AppHandle);
+  }
+  if (EFI_ERROR (Status)) {
+    fprintf (stderr, "Could not start the interpreter: %s\n", HostStatusString (Status));
+    return 1;
+  }
+  gImageHandle = AppHandle;
+
+  //
+  // Replace the default handler of breakpoints, which stops for good
+  //
+  Status = gBS->LocateProtocol (&gEfiDebugSupportProtocolGuid, NULL, (VOID **) &DebugSupport);
+  if (!EFI_ERROR (Status)) {
+    DebugSupport->RegisterExceptionCallback (DebugSupport, 0, NULL, EXCEPT_EBC_BREAKPOINT);
+    DebugSupport->RegisterExceptionCallback (DebugSupport, 0, EbcRunSkipBreakpoint, EXCEPT_EBC_BREAKPOINT);
+  }
+
+  //
+  // The path is relative to the current directory, as with EdbCfg
+  //
+  Length   = AsciiStrLen (argv[1]);
+  FileName = AllocateZeroPool ((Length + 1) * sizeof (CHAR16));
+  if (FileName == NULL) {
+    return 1;
+  }
+  while (Length-- > 0) {
+    FileName[Length] = (CHAR16) (UINT8) argv[1][Length];
+  }
+
+  Status = EdbRunImage (AppHandle, FileName, FALSE, Virtual);
+  FreePool (FileName);
+  return EFI_ERROR (Status) ? 1 : 0;
+}
@@ -0,0 +1,588 @@
+/** @file
+  This module contains the EBC support routines of the host build, where the
+  interpreter runs as a regular user space library.
+
+  No code is generated at runtime: a thunk is one slot of a static table of
+  C functions, each of which enters the interpreter with the EBC entry point
+  recorded in its slot. EbcLLCALLEX recognizes these functions to switch to
+  the EBC code directly, and calls anything else as a native C function.
+
+Copyright (c) 2006 - 2014, Intel Corporation. All rights reserved.<BR>
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "EbcInt.h"
+#include "EbcExecute.h"
+#include "EbcDebuggerHook.h"
+#include "Host.h"
+
+//
+// The largest number of arguments that a thunk passes to the EBC code, or
+// that a CALLEX passes to a native function
+//
+#define HOST_MAX_ARGS       16
+
+//
+// The number of thunks that can exist at the same time
+//
+#define HOST_THUNK_COUNT    256
+
+typedef struct {
+  UINTN     EbcEntryPoint;
+  UINT32    Flags;
+  BOOLEAN   InUse;
+} HOST_THUNK;
+
+typedef
+UINT64
+(EFIAPI *HOST_NATIVE_CALL)(
+  UINTN Arg1,  UINTN Arg2,  UINTN Arg3,  UINTN Arg4,
+  UINTN Arg5,  UINTN Arg6,  UINTN Arg7,  UINTN Arg8,
+  UINTN Arg9,  UINTN Arg10, UINTN Arg11, UINTN Arg12,
+  UINTN Arg13, UINTN Arg14, UINTN Arg15, UINTN Arg16
+  );
+
+HOST_THUNK  mHostThunk[HOST_THUNK_COUNT];
+
+//
+// The lowest and highest addresses of the functions of the thunks
+//
+UINTN       mHostThunkLow;
+UINTN       mHostThunkHigh;
+
+UINT64
+EFIAPI
+HostThunkCall (
+  IN HOST_THUNK *Thunk,
+  IN UINTN      *Args
+  );
+
+//
+// One native entry point per thunk slot. A thunk is called through whatever
+// prototype its caller has, which on the supported hosts can only use fewer
+// of the 16 arguments, as in the assembly thunks of the firmware builds.
+//
+#define HOST_THUNK_ENTRY(Index)                                               \
+  UINT64                                                                      \
+  EFIAPI                                                                      \
+  HostThunk##Index (                                                          \
+    UINTN Arg1,  UINTN Arg2,  UINTN Arg3,  UINTN Arg4,                        \
+    UINTN Arg5,  UINTN Arg6,  UINTN Arg7,  UINTN Arg8,                        \
+    UINTN Arg9,  UINTN Arg10, UINTN Arg11, UINTN Arg12,                       \
+    UINTN Arg13, UINTN Arg14, UINTN Arg15, UINTN Arg16                        \
+    )                                                                         \
+  {                                                                           \
+    UINTN Args[HOST_MAX_ARGS] = {                                             \
+      Arg1, Arg2,  Arg3,  Arg4,  Arg5,  Arg6,  Arg7,  Arg8,                   \
+      Arg9, Arg10, Arg11, Arg12, Arg13, Arg14, Arg15, Arg16                   \
+    };                                                                        \
+    return HostThunkCall (&mHostThunk[Index], Args);                          \
+  }
+
+//
+// The slots are numbered with three octal digits, so that the pasted token is
+// both the suffix of the name and the index of the slot
+//
+#define HOST_THUNK_ENTRY_8(Index)                                             \
+  HOST_THUNK_ENTRY(Index##0) HOST_THUNK_ENTRY(Index##1)                       \
+  HOST_THUNK_ENTRY(Index##2) HOST_THUNK_ENTRY(Index##3)                       \
+  HOST_THUNK_ENTRY(Index##4) HOST_THUNK_ENTRY(Index##5)                       \
+  HOST_THUNK_ENTRY(Index##6) HOST_THUNK_ENTRY(Index##7)
+#define HOST_THUNK_ENTRY_64(Index)                                            \
+  HOST_THUNK_ENTRY_8(Index##0) HOST_THUNK_ENTRY_8(Index##1)                   \
+  HOST_THUNK_ENTRY_8(Index##2) HOST_THUNK_ENTRY_8(Index##3)                   \
+  HOST_THUNK_ENTRY_8(Index##4) HOST_THUNK_ENTRY_8(Index##5)                   \
+  HOST_THUNK_ENTRY_8(Index##6) HOST_THUNK_ENTRY_8(Index##7)
+
+#define HOST_THUNK_NAME_8(Index)                                              \
+  HostThunk##Index##0, HostThunk##Index##1,                                   \
+  HostThunk##Index##2, HostThunk##Index##3,                                   \
+  HostThunk##Index##4, HostThunk##Index##5,                                   \
+  HostThunk##Index##6, HostThunk##Index##7,
+#define HOST_THUNK_NAME_64(Index)                                             \
+  HOST_THUNK_NAME_8(Index##0) HOST_THUNK_NAME_8(Index##1)                     \
+  HOST_THUNK_NAME_8(Index##2) HOST_THUNK_NAME_8(Index##3)                     \
+  HOST_THUNK_NAME_8(Index##4) HOST_THUNK_NAME_8(Index##5)                     \
+  HOST_THUNK_NAME_8(Index##6) HOST_THUNK_NAME_8(Index##7)
+
+HOST_THUNK_ENTRY_64(00)
+HOST_THUNK_ENTRY_64(01)
+HOST_THUNK_ENTRY_64(02)
+HOST_THUNK_ENTRY_64(03)
+
+HOST_NATIVE_CALL  mHostThunkEntry[HOST_THUNK_COUNT] = {
+  HOST_THUNK_NAME_64(00)
+  HOST_THUNK_NAME_64(01)
+  HOST_THUNK_NAME_64(02)
+  HOST_THUNK_NAME_64(03)
+};
+
+/**
+  Pushes a 64 bit unsigned value to the VM stack.
+
+  @param VmPtr  The pointer to current VM context.
+  @param Arg    The value to be pushed.
+
+**/
+VOID
+PushU64 (
+  IN VM_CONTEXT *VmPtr,
+  IN UINT64     Arg
+  )
+{
+  //
+  // Advance the VM stack down, and then copy the argument to the stack.
+  // Hope it's aligned.
+  //
+  VmPtr->Gpr[0] -= sizeof (UINT64);
+  *(UINT64 *) VmPtr->Gpr[0] = Arg;
+  return;
+}
+
+/**
+  Set up the VM stack of a new VM context.
+
+  @param  VmContext     The VM context, with the IP already set.
+  @param  ImageHandle   The image that the stack is for.
+  @param  StackIndex    Returns the index of the stack, to give it back later.
+
+  @retval EFI_SUCCESS   The stack is ready.
+  @retval Others        No stack is available.
+
+**/
+EFI_STATUS
+HostInitStack (
+  IN OUT VM_CONTEXT *VmContext,
+  IN     EFI_HANDLE ImageHandle,
+  OUT    UINTN      *StackIndex
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = GetEBCStack (ImageHandle, &VmContext->StackPool, StackIndex);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  VmContext->StackTop = (UINT8*)VmContext->StackPool + (STACK_REMAIN_SIZE);
+  VmContext->Gpr[0] = (UINT64) (UINTN) ((UINT8*)VmContext->StackPool + GetEBCStackSize (*StackIndex));
+  VmContext->HighStackBottom = (UINTN) VmContext->Gpr[0];
+  VmContext->Gpr[0] -= sizeof (UINTN);
+
+  //
+  // Align the stack on a natural boundary.
+  //
+  VmContext->Gpr[0] &= ~(VM_REGISTER)(sizeof (UINTN) - 1);
+
+  //
+  // Put a magic value in the stack gap, then adjust down again.
+  //
+  *(UINTN *) (UINTN) (VmContext->Gpr[0]) = (UINTN) VM_STACK_KEY_VALUE;
+  VmContext->StackMagicPtr             = (UINTN *) (UINTN) VmContext->Gpr[0];
+
+  //
+  // The stack upper to LowStackTop is belong to the VM.
+  //
+  VmContext->LowStackTop   = (UINTN) VmContext->Gpr[0];
+  return EFI_SUCCESS;
+}
+
+/**
+  Begin executing an EBC image.
+
+  This is what a thunk for an EBC protocol service runs, with the arguments
+  of the native caller.
+
+  @param  EntryPoint            The entrypoint of EBC code.
+  @param  Args                  The 16 arguments.
+
+  @return The value returned by the EBC application we're going to run.
+
+**/
+UINT64
+EFIAPI
+EbcInterpret (
+  IN UINTN      EntryPoint,
+  IN UINTN      *Args
+  )
+{
+  //
+  // Create a new VM context on the stack
+  //
+  VM_CONTEXT  VmContext;
+  EFI_STATUS  Status;
+  UINTN       StackIndex;
+  UINTN       Index;
+
+  //
+  // Now clear out our context
+  //
+  ZeroMem ((VOID *) &VmContext, sizeof (VM_CONTEXT));
+
+  //
+  // Set the VM instruction pointer to the correct location in memory.
+  //
+  VmContext.Ip = (VMIP) EntryPoint;
+
+  Status = HostInitStack (&VmContext, EbcFindImageHandle (EntryPoint), &StackIndex);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Copy all the arguments to the VM's stack, as the interpreter does not
+  // know how many the service takes.
+  //
+  for (Index = HOST_MAX_ARGS; Index > 0; Index--) {
+    PushU64 (&VmContext, (UINT64) Args[Index - 1]);
+  }
+
+  //
+  // Interpreter assumes 64-bit return address is pushed on the stack.
+  // The host does not do this so pad the stack accordingly.
+  //
+  PushU64 (&VmContext, (UINT64) 0);
+  PushU64 (&VmContext, (UINT64) 0x1234567887654321ULL);
+
+  //
+  // This is where we say our return address is
+  //
+  VmContext.StackRetAddr  = (UINT64) VmContext.Gpr[0];
+
+  //
+  // Begin executing the EBC code
+  //
+  EbcDebuggerHookEbcInterpret (&VmContext);
+  EbcExecute (&VmContext);
+
+  //
+  // Return the value in Gpr[7] unless there was an error
+  //
+  ReturnEBCStack(StackIndex);
+  return (UINT64) VmContext.Gpr[7];
+}
+
+/**
+  Begin executing an EBC image.
+
+  @param  EntryPoint       The entrypoint of EBC code.
+  @param  ImageHandle      image handle for the EBC application we're executing
+  @param  SystemTable      standard system table passed into an driver's entry
+                           point
+
+  @return The value returned by the EBC application we're going to run.
+
+**/
+UINT64
+EFIAPI
+ExecuteEbcImageEntryPoint (
+  IN UINTN                EntryPoint,
+  IN EFI_HANDLE           ImageHandle,
+  IN EFI_SYSTEM_TABLE     *SystemTable
+  )
+{
+  //
+  // Create a new VM context on the stack
+  //
+  VM_CONTEXT  VmContext;
+  EFI_STATUS  Status;
+  UINTN       StackIndex;
+
+  //
+  // Now clear out our context
+  //
+  ZeroMem ((VOID *) &VmContext, sizeof (VM_CONTEXT));
+
+  //
+  // Save the image handle so we can track the thunks created for this image
+  //
+  VmContext.ImageHandle = ImageHandle;
+  VmContext.SystemTable = SystemTable;
+
+  //
+  // Set the VM instruction pointer to the correct location in memory.
+  //
+  VmContext.Ip = (VMIP) EntryPoint;
+
+  Status = HostInitStack (&VmContext, ImageHandle, &StackIndex);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Simply copy the image handle and system table onto the EBC stack.
+  // Greatly simplifies things by not having to spill the args.
+  //
+  PushU64 (&VmContext, (UINT64) (UINTN) SystemTable);
+  PushU64 (&VmContext, (UINT64) (UINTN) ImageHandle);
+
+  //
+  // VM pushes 16-bytes for return address. Simulate that here.
+  //
+  PushU64 (&VmContext, (UINT64) 0);
+  PushU64 (&VmContext, (UINT64) 0x1234567887654321ULL);
+
+  //
+  // This is where we say our return address is
+  //
+  VmContext.StackRetAddr  = (UINT64) VmContext.Gpr[0];
+
+  //
+  // Begin executing the EBC code
+  //
+  EbcDebuggerHookExecuteEbcImageEntryPoint (&VmContext);
+  EbcExecute (&VmContext);
+
+  //
+  // Return the value in Gpr[7] unless there was an error
+  //
+  ReturnEBCStack(StackIndex);
+  return (UINT64) VmContext.Gpr[7];
+}
+
+/**
+  Enter the interpreter from a thunk.
+
+  @param  Thunk     The slot of the thunk that was called.
+  @param  Args      The 16 arguments of the thunk.
+
+  @return The value returned by the EBC code.
+
+**/
+UINT64
+EFIAPI
+HostThunkCall (
+  IN HOST_THUNK *Thunk,
+  IN UINTN      *Args
+  )
+{
+  if ((Thunk->Flags & FLAG_THUNK_ENTRY_POINT) != 0) {
+    return ExecuteEbcImageEntryPoint (
+             Thunk->EbcEntryPoint,
+             (EFI_HANDLE) Args[0],
+             (EFI_SYSTEM_TABLE *) Args[1]
+             );
+  }
+  return EbcInterpret (Thunk->EbcEntryPoint, Args);
+}
+
+/**
+  Create thunks for an EBC image entry point, or an EBC protocol service.
+
+  @param  ImageHandle           Image handle for the EBC image. If not null, then
+                                we're creating a thunk for an image entry point.
+  @param  EbcEntryPoint         Address of the EBC code that the thunk is to call
+  @param  Thunk                 Returned thunk we create here
+  @param  Flags                 Flags indicating options for creating the thunk
+
+  @retval EFI_SUCCESS           The thunk was created successfully.
+  @retval EFI_INVALID_PARAMETER The parameter of EbcEntryPoint is not 16-bit
+                                aligned.
+  @retval EFI_OUT_OF_RESOURCES  All the thunk slots are in use.
+
+**/
+EFI_STATUS
+EbcCreateThunks (
+  IN EFI_HANDLE           ImageHandle,
+  IN VOID                 *EbcEntryPoint,
+  OUT VOID                **Thunk,
+  IN  UINT32              Flags
+  )
+{
+  UINTN       Index;
+  EFI_STATUS  Status;
+
+  //
+  // Check alignment of pointer to EBC code
+  //
+  if ((UINT32) (UINTN) EbcEntryPoint & 0x01) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  for (Index = 0; Index < HOST_THUNK_COUNT; Index++) {
+    if (!mHostThunk[Index].InUse) {
+      break;
+    }
+  }
+  if (Index == HOST_THUNK_COUNT) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mHostThunk[Index].EbcEntryPoint = (UINTN) EbcEntryPoint;
+  mHostThunk[Index].Flags         = Flags;
+  mHostThunk[Index].InUse         = TRUE;
+
+  //
+  // The slot stands for the thunk buffer, which is given back through
+  // FreePool () when the image is unloaded
+  //
+  Status = EbcAddImageThunk (ImageHandle, (VOID *) &mHostThunk[Index], sizeof (HOST_THUNK));
+  if (EFI_ERROR (Status)) {
+    mHostThunk[Index].InUse = FALSE;
+    return Status;
+  }
+
+  *Thunk = (VOID *) mHostThunkEntry[Index];
+  return EFI_SUCCESS;
+}
+
+/**
+  Release a thunk slot, if a buffer that is being freed is one.
+
+  @param  Buffer        The buffer that is being freed.
+
+  @retval TRUE          The buffer was a thunk slot, which is now free.
+  @retval FALSE         The buffer is not a thunk slot.
+
+**/
+BOOLEAN
+HostFreeThunk (
+  IN VOID   *Buffer
+  )
+{
+  UINTN   Offset;
+
+  Offset = (UINTN) Buffer - (UINTN) mHostThunk;
+  if (Offset >= sizeof (mHostThunk)) {
+    return FALSE;
+  }
+  ((HOST_THUNK *) Buffer)->InUse = FALSE;
+  return TRUE;
+}
+
+/**
+  Find the thunk slot of a native address.
+
+  @param  FuncAddr      The address.
+
+  @return The thunk slot, or NULL if the address is not a thunk.
+
+**/
+HOST_THUNK *
+HostFindThunk (
+  IN UINTN  FuncAddr
+  )
+{
+  UINTN   Index;
+
+  //
+  // Most CALLEX go to native services, which are outside of the functions
+  // of the thunks
+  //
+  if (mHostThunkLow == 0) {
+    mHostThunkLow = MAX_UINTN;
+    for (Index = 0; Index < HOST_THUNK_COUNT; Index++) {
+      mHostThunkLow  = MIN (mHostThunkLow, (UINTN) mHostThunkEntry[Index]);
+      mHostThunkHigh = MAX (mHostThunkHigh, (UINTN) mHostThunkEntry[Index]);
+    }
+  }
+  if ((FuncAddr < mHostThunkLow) || (FuncAddr > mHostThunkHigh)) {
+    return NULL;
+  }
+
+  for (Index = 0; Index < HOST_THUNK_COUNT; Index++) {
+    if ((UINTN) mHostThunkEntry[Index] == FuncAddr) {
+      return mHostThunk[Index].InUse ? &mHostThunk[Index] : NULL;
+    }
+  }
+  return NULL;
+}
+
+/**
+  Call a native function from a CALLEX, with the arguments of the VM stack.
+
+  @param  CallAddr      The function to call.
+  @param  EbcSp         The VM stack pointer, which points to the arguments.
+  @param  FramePtr      The VM frame pointer, above the arguments.
+
+  @return The value returned by the function.
+
+**/
+INT64
+EFIAPI
+EbcLLCALLEXNative (
+  IN UINTN        CallAddr,
+  IN UINTN        EbcSp,
+  IN VOID         *FramePtr
+  )
+{
+  UINTN   Args[HOST_MAX_ARGS];
+  UINTN   Size;
+
+  //
+  // Like the assembly versions, copy the whole frame, but never more than the
+  // 16 arguments that are passed
+  //
+  ZeroMem (Args, sizeof (Args));
+  Size = (UINTN) FramePtr - EbcSp;
+  if (Size > sizeof (Args)) {
+    Size = sizeof (Args);
+  }
+  CopyMem (Args, (VOID *) EbcSp, Size);
+
+  return (INT64) ((HOST_NATIVE_CALL) CallAddr) (
+                   Args[0],  Args[1],  Args[2],  Args[3],
+                   Args[4],  Args[5],  Args[6],  Args[7],
+                   Args[8],  Args[9],  Args[10], Args[11],
+                   Args[12], Args[13], Args[14], Args[15]
+                   );
+}
+
+/**
+  This function is called to execute an EBC CALLEX instruction.
+  The function checks whether the callee is one of the thunks. If it is, set
+  the VM->IP to the target EBC code directly to avoid another VM be startup
+  which cost time and stack space, otherwise call the native code.
+
+  @param  VmPtr            Pointer to a VM context.
+  @param  FuncAddr         Callee's address
+  @param  NewStackPointer  New stack pointer after the call
+  @param  FramePtr         New frame pointer after the call
+  @param  Size             The size of call instruction
+
+**/
+VOID
+EbcLLCALLEX (
+  IN VM_CONTEXT   *VmPtr,
+  IN UINTN        FuncAddr,
+  IN UINTN        NewStackPointer,
+  IN VOID         *FramePtr,
+  IN UINT8        Size
+  )
+{
+  HOST_THUNK  *Thunk;
+
+  Thunk = HostFindThunk (FuncAddr);
+  if (Thunk != NULL) {
+    //
+    // The callee is a thunk to EBC, adjust the stack pointer down 16 bytes and
+    // put our return address and frame pointer on the VM stack.
+    // Then set the VM's IP to new EBC code.
+    //
+    VmPtr->Gpr[0] -= 8;
+    VmWriteMemN (VmPtr, (UINTN) VmPtr->Gpr[0], (UINTN) FramePtr);
+    VmPtr->FramePtr = (VOID *) (UINTN) VmPtr->Gpr[0];
+    VmPtr->Gpr[0] -= 8;
+    VmWriteMem64 (VmPtr, (UINTN) VmPtr->Gpr[0], (UINT64) (UINTN) (VmPtr->Ip + Size));
+
+    VmPtr->Ip = (VMIP) Thunk->EbcEntryPoint;
+  } else {
+    //
+    // The callee is not a thunk to EBC, call native code,
+    // and get return value.
+    //
+    VmPtr->Gpr[7] = EbcLLCALLEXNative (FuncAddr, NewStackPointer, FramePtr);
+
+    //
+    // Advance the IP.
+    //
+    VmPtr->Ip += Size;
+  }
+}
@@ -0,0 +1,103 @@
+/** @file
+  Run EdbCfg on the host, with the interpreter loaded as it is in the shell.
+
+  The interpreter driver is started on an image handle of its own, then the
+  command line is handed to EdbCfg through the shell parameters protocol.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Protocol/ShellParameters.h>
+
+#include "Host.h"
+
+EFI_STATUS
+EFIAPI
+InitializeEbcDriver (
+  IN EFI_HANDLE           ImageHandle,
+  IN EFI_SYSTEM_TABLE     *SystemTable
+  );
+
+EFI_STATUS
+EFIAPI
+InitializeEbcDebuggerConfig (
+  IN EFI_HANDLE                             ImageHandle,
+  IN EFI_SYSTEM_TABLE                       *SystemTable
+  );
+
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  EFI_STATUS                    Status;
+  EFI_HANDLE                    DriverHandle;
+  EFI_HANDLE                    AppHandle;
+  EFI_SHELL_PARAMETERS_PROTOCOL ShellParameters;
+  UINTN                         Index;
+  UINTN                         Length;
+
+  Status = HostInitServices (&DriverHandle);
+  if (!EFI_ERROR (Status)) {
+    Status = InitializeEbcDriver (DriverHandle, gST);
+  }
+  if (!EFI_ERROR (Status)) {
+    Status = HostInitServices (&AppHandle);
+  }
+  if (EFI_ERROR (Status)) {
+    fprintf (stderr, "Could not start the interpreter: %s\n", HostStatusString (Status));
+    return 1;
+  }
+  gImageHandle = AppHandle;
+
+  //
+  // The shell passes the arguments as CHAR16, with the program name first
+  //
+  ZeroMem (&ShellParameters, sizeof (ShellParameters));
+  ShellParameters.Argc = (UINTN) argc;
+  ShellParameters.Argv = AllocateZeroPool ((argc + 1) * sizeof (CHAR16 *));
+  if (ShellParameters.Argv == NULL) {
+    return 1;
+  }
+  for (Index = 0; Index < (UINTN) argc; Index++) {
+    Length = AsciiStrLen (argv[Index]);
+    ShellParameters.Argv[Index] = AllocateZeroPool ((Length + 1) * sizeof (CHAR16));
+    if (ShellParameters.Argv[Index] == NULL) {
+      return 1;
+    }
+    while (Length-- > 0) {
+      ShellParameters.Argv[Index][Length] = (CHAR16) (UINT8) argv[Index][Length];
+    }
+  }
+  Status = gBS->InstallProtocolInterface (
+                  &AppHandle,
+                  &gEfiShellParametersProtocolGuid,
+                  EFI_NATIVE_INTERFACE,
+                  &ShellParameters
+                  );
+  if (!EFI_ERROR (Status)) {
+    Status = InitializeEbcDebuggerConfig (AppHandle, gST);
+  }
+
+  for (Index = 0; Index < (UINTN) argc; Index++) {
+    FreePool (ShellParameters.Argv[Index]);
+  }
+  FreePool (ShellParameters.Argv);
+  return EFI_ERROR (Status) ? 1 : 0;
+}
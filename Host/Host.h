@@ -0,0 +1,97 @@
+/** @file
+  Functions shared by the modules of the host build.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __HOST_H__
+#define __HOST_H__
+
+#include <Uefi.h>
+
+//
+// The handle of the device that the host file system is installed on, which
+// is the current directory
+//
+extern EFI_HANDLE mHostFileSystemHandle;
+
+/**
+  Release a thunk slot, if a buffer that is being freed is one.
+
+  @param  Buffer        The buffer that is being freed.
+
+  @retval TRUE          The buffer was a thunk slot, which is now free.
+  @retval FALSE         The buffer is not a thunk slot.
+
+**/
+BOOLEAN
+HostFreeThunk (
+  IN VOID   *Buffer
+  );
+
+/**
+  Get the text of a status code, as %r prints it.
+
+  @param  Status        The status code.
+
+  @return The text, or NULL if the status code is not a known one.
+
+**/
+CONST CHAR8 *
+HostStatusString (
+  IN EFI_STATUS Status
+  );
+
+/**
+  Set up the system table and the services, and create the handle of an
+  image with its loaded image protocol. Each call creates another image.
+
+  @param  ImageHandle   Returns the new image handle.
+
+  @retval EFI_SUCCESS   The services are ready.
+  @retval Others        The services could not be set up.
+
+**/
+EFI_STATUS
+HostInitServices (
+  OUT EFI_HANDLE  *ImageHandle
+  );
+
+//
+// The image services, of HostImage.c
+//
+
+EFI_STATUS
+EFIAPI
+HostLoadImage (
+  IN  BOOLEAN                      BootPolicy,
+  IN  EFI_HANDLE                   ParentImageHandle,
+  IN  EFI_DEVICE_PATH_PROTOCOL     *DevicePath,
+  IN  VOID                         *SourceBuffer OPTIONAL,
+  IN  UINTN                        SourceSize,
+  OUT EFI_HANDLE                   *ImageHandle
+  );
+
+EFI_STATUS
+EFIAPI
+HostStartImage (
+  IN  EFI_HANDLE                  ImageHandle,
+  OUT UINTN                       *ExitDataSize,
+  OUT CHAR16                      **ExitData    OPTIONAL
+  );
+
+EFI_STATUS
+EFIAPI
+HostUnloadImage (
+  IN  EFI_HANDLE                   ImageHandle
+  );
+
+#endif
@@ -0,0 +1,33 @@
+//
+// Defines the GUIDs that the host build takes from MdePkg in the firmware builds.
+//
+
+#include <Uefi.h>
+
+#include <Protocol/Ebc.h>
+EFI_GUID gEfiEbcProtocolGuid = EFI_EBC_PROTOCOL_GUID;
+EFI_GUID gEfiDebugSupportProtocolGuid = EFI_DEBUG_SUPPORT_PROTOCOL_GUID;
+
+#include <Protocol/EbcSimpleDebugger.h>
+EFI_GUID gEfiEbcSimpleDebuggerProtocolGuid = EFI_EBC_SIMPLE_DEBUGGER_PROTOCOL_GUID;
+
+#include <Protocol/LoadedImage.h>
+EFI_GUID gEfiLoadedImageProtocolGuid = EFI_LOADED_IMAGE_PROTOCOL_GUID;
+
+#include <Protocol/PciRootBridgeIo.h>
+EFI_GUID gEfiPciRootBridgeIoProtocolGuid = EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL_GUID;
+
+#include <Protocol/SimpleFileSystem.h>
+EFI_GUID gEfiSimpleFileSystemProtocolGuid = EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID;
+
+#include <Guid/FileInfo.h>
+EFI_GUID gEfiFileInfoGuid = EFI_FILE_INFO_ID;
+
+#include <Guid/FileSystemInfo.h>
+EFI_GUID gEfiFileSystemInfoGuid = EFI_FILE_SYSTEM_INFO_ID;
+
+#include <Guid/FileSystemVolumeLabelInfo.h>
+EFI_GUID gEfiFileSystemVolumeLabelInfoIdGuid = EFI_FILE_SYSTEM_VOLUME_LABEL_ID;
+
+#include <Guid/DebugImageInfoTable.h>
+EFI_GUID gEfiDebugImageInfoTableGuid = EFI_DEBUG_IMAGE_INFO_TABLE_GUID;
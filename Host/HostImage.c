@@ -0,0 +1,542 @@
+/** @file
+  The image services of the host build.
+
+  LoadImage () reads a PE32+ EBC image from the file system of the current
+  directory, or from a buffer, copies its sections to their place in memory
+  and applies its base relocations. The entry point is then turned into a
+  thunk by the interpreter, as the DXE core does, so that StartImage () can
+  call it as native code. Native images cannot be loaded.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Protocol/Ebc.h>
+#include <Protocol/LoadedImage.h>
+#include <Protocol/SimpleFileSystem.h>
+#include <IndustryStandard/PeImage.h>
+
+#include "Host.h"
+
+typedef struct _HOST_IMAGE HOST_IMAGE;
+
+struct _HOST_IMAGE {
+  HOST_IMAGE                  *Next;
+  EFI_HANDLE                  Handle;
+  EFI_LOADED_IMAGE_PROTOCOL   LoadedImage;
+  EFI_PHYSICAL_ADDRESS        Pages;
+  UINTN                       PageCount;
+  EFI_IMAGE_ENTRY_POINT       EntryPoint;
+  UINT16                      Subsystem;
+  BOOLEAN                     Started;
+};
+
+HOST_IMAGE                *mHostImageList;
+
+/**
+  Find an image that LoadImage () loaded.
+
+  @param  ImageHandle   The image handle.
+
+  @return The image, or NULL if the handle is not one of a loaded image.
+
+**/
+HOST_IMAGE *
+HostGetImage (
+  IN EFI_HANDLE   ImageHandle
+  )
+{
+  HOST_IMAGE  *Image;
+
+  for (Image = mHostImageList; Image != NULL; Image = Image->Next) {
+    if (Image->Handle == ImageHandle) {
+      return Image;
+    }
+  }
+  return NULL;
+}
+
+/**
+  Read a whole file from the file system of the current directory.
+
+  @param  FileName      The path of the file.
+  @param  Buffer        Returns the contents of the file, to be freed by the
+                        caller.
+  @param  Size          Returns the size of the file.
+
+  @retval EFI_SUCCESS   The file was read.
+  @retval EFI_NOT_FOUND The file does not exist.
+  @retval Others        The file could not be read.
+
+**/
+EFI_STATUS
+HostReadFile (
+  IN  CHAR16    *FileName,
+  OUT VOID      **Buffer,
+  OUT UINTN     *Size
+  )
+{
+  EFI_STATUS                        Status;
+  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL   *FileSystem;
+  EFI_FILE_PROTOCOL                 *Root;
+  EFI_FILE_PROTOCOL                 *File;
+  UINT64                            Position;
+
+  Status = gBS->HandleProtocol (
+                  mHostFileSystemHandle,
+                  &gEfiSimpleFileSystemProtocolGuid,
+                  (VOID **) &FileSystem
+                  );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Status = FileSystem->OpenVolume (FileSystem, &Root);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Status = Root->Open (Root, &File, FileName, EFI_FILE_MODE_READ, 0);
+  Root->Close (Root);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = File->SetPosition (File, MAX_UINT64);
+  if (!EFI_ERROR (Status)) {
+    Status = File->GetPosition (File, &Position);
+  }
+  if (!EFI_ERROR (Status)) {
+    Status = File->SetPosition (File, 0);
+  }
+  if (EFI_ERROR (Status)) {
+    File->Close (File);
+    return Status;
+  }
+
+  *Size   = (UINTN) Position;
+  *Buffer = AllocatePool (*Size);
+  if (*Buffer == NULL) {
+    File->Close (File);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Status = File->Read (File, Size, *Buffer);
+  File->Close (File);
+  if (!EFI_ERROR (Status) && (*Size != (UINTN) Position)) {
+    Status = EFI_DEVICE_ERROR;
+  }
+  if (EFI_ERROR (Status)) {
+    FreePool (*Buffer);
+  }
+  return Status;
+}
+
+/**
+  Apply the base relocations of an image that was copied to memory.
+
+  @param  ImageBase     Where the image was copied.
+  @param  Hdr           The NT headers of the copy.
+
+  @retval EFI_SUCCESS   The image was relocated.
+  @retval EFI_LOAD_ERROR  The relocations are corrupt, or of a type that
+                        cannot be applied.
+
+**/
+EFI_STATUS
+HostRelocateImage (
+  IN UINT8                      *ImageBase,
+  IN EFI_IMAGE_NT_HEADERS64     *Hdr
+  )
+{
+  EFI_IMAGE_DATA_DIRECTORY      *Directory;
+  EFI_IMAGE_BASE_RELOCATION     *Block;
+  UINT16                        *Entry;
+  UINT8                         *Fixup;
+  UINT64                        Delta;
+  UINT64                        Value64;
+  UINT32                        Value32;
+  UINT32                        SizeOfImage;
+  UINT32                        Offset;
+  UINT32                        End;
+  UINT64                        Target;
+  UINTN                         Count;
+  UINTN                         Index;
+
+  Delta = (UINT64) (UINTN) ImageBase - Hdr->OptionalHeader.ImageBase;
+  if ((Delta == 0) || (Hdr->OptionalHeader.NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC)) {
+    return EFI_SUCCESS;
+  }
+  SizeOfImage = Hdr->OptionalHeader.SizeOfImage;
+  Directory   = &Hdr->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC];
+  Offset      = Directory->VirtualAddress;
+  End         = Offset + Directory->Size;
+  if ((End < Offset) || (End > SizeOfImage)) {
+    return EFI_LOAD_ERROR;
+  }
+
+  while (Offset + EFI_IMAGE_SIZEOF_BASE_RELOCATION <= End) {
+    Block = (EFI_IMAGE_BASE_RELOCATION *) (ImageBase + Offset);
+    if ((Block->SizeOfBlock < EFI_IMAGE_SIZEOF_BASE_RELOCATION) ||
+        (Block->SizeOfBlock > End - Offset)) {
+      return EFI_LOAD_ERROR;
+    }
+    Entry = (UINT16 *) (Block + 1);
+    Count = (Block->SizeOfBlock - EFI_IMAGE_SIZEOF_BASE_RELOCATION) / sizeof (UINT16);
+    for (Index = 0; Index < Count; Index++) {
+      Target = (UINT64) Block->VirtualAddress + (Entry[Index] & 0xFFF);
+      Fixup  = ImageBase + (UINTN) Target;
+      switch (Entry[Index] >> 12) {
+      case EFI_IMAGE_REL_BASED_ABSOLUTE:
+        break;
+      case EFI_IMAGE_REL_BASED_HIGHLOW:
+        if (Target + sizeof (Value32) > SizeOfImage) {
+          return EFI_LOAD_ERROR;
+        }
+        CopyMem (&Value32, Fixup, sizeof (Value32));
+        Value32 += (UINT32) Delta;
+        CopyMem (Fixup, &Value32, sizeof (Value32));
+        break;
+      case EFI_IMAGE_REL_BASED_DIR64:
+        if (Target + sizeof (Value64) > SizeOfImage) {
+          return EFI_LOAD_ERROR;
+        }
+        CopyMem (&Value64, Fixup, sizeof (Value64));
+        Value64 += Delta;
+        CopyMem (Fixup, &Value64, sizeof (Value64));
+        break;
+      default:
+        return EFI_LOAD_ERROR;
+      }
+    }
+    Offset += Block->SizeOfBlock;
+  }
+  Hdr->OptionalHeader.ImageBase = (UINT64) (UINTN) ImageBase;
+  return EFI_SUCCESS;
+}
+
+/**
+  Copy the headers and the sections of a PE32+ EBC image to memory, and
+  relocate it there.
+
+  @param  Image         The image, which gets its memory and entry point.
+  @param  Source        The contents of the image file.
+  @param  SourceSize    The size of the image file.
+
+  @retval EFI_SUCCESS     The image is ready to be started.
+  @retval EFI_UNSUPPORTED The image is not a PE32+ EBC image.
+  @retval EFI_LOAD_ERROR  The image is corrupt.
+  @retval EFI_OUT_OF_RESOURCES  The image could not be allocated.
+
+**/
+EFI_STATUS
+HostCopyImage (
+  IN OUT HOST_IMAGE   *Image,
+  IN     UINT8        *Source,
+  IN     UINTN        SourceSize
+  )
+{
+  EFI_STATUS                Status;
+  EFI_IMAGE_DOS_HEADER      *DosHdr;
+  EFI_IMAGE_NT_HEADERS64    *Hdr;
+  EFI_IMAGE_SECTION_HEADER  *Section;
+  UINT8                     *ImageBase;
+  UINTN                     HdrOffset;
+  UINTN                     SectionOffset;
+  UINT32                    SizeOfImage;
+  UINT32                    Size;
+  UINTN                     Index;
+
+  //
+  // The DOS header is optional
+  //
+  HdrOffset = 0;
+  DosHdr    = (EFI_IMAGE_DOS_HEADER *) Source;
+  if ((SourceSize >= sizeof (EFI_IMAGE_DOS_HEADER)) && (DosHdr->e_magic == EFI_IMAGE_DOS_SIGNATURE)) {
+    HdrOffset = DosHdr->e_lfanew;
+  }
+  if ((HdrOffset > SourceSize) || (SourceSize - HdrOffset < sizeof (EFI_IMAGE_NT_HEADERS64))) {
+    return EFI_LOAD_ERROR;
+  }
+  Hdr = (EFI_IMAGE_NT_HEADERS64 *) (Source + HdrOffset);
+  if (Hdr->Signature != EFI_IMAGE_NT_SIGNATURE) {
+    return EFI_LOAD_ERROR;
+  }
+  if ((Hdr->FileHeader.Machine != IMAGE_FILE_MACHINE_EBC) ||
+      (Hdr->OptionalHeader.Magic != EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  SizeOfImage   = Hdr->OptionalHeader.SizeOfImage;
+  SectionOffset = HdrOffset + OFFSET_OF (EFI_IMAGE_NT_HEADERS64, OptionalHeader) +
+                  Hdr->FileHeader.SizeOfOptionalHeader;
+  if ((Hdr->OptionalHeader.SizeOfHeaders > SizeOfImage) ||
+      (Hdr->OptionalHeader.SizeOfHeaders > SourceSize) ||
+      (SectionOffset + Hdr->FileHeader.NumberOfSections * sizeof (EFI_IMAGE_SECTION_HEADER) >
+       Hdr->OptionalHeader.SizeOfHeaders) ||
+      (Hdr->OptionalHeader.AddressOfEntryPoint >= SizeOfImage)) {
+    return EFI_LOAD_ERROR;
+  }
+
+  Image->PageCount = EFI_SIZE_TO_PAGES (SizeOfImage);
+  Status = gBS->AllocatePages (AllocateAnyPages, EfiLoaderCode, Image->PageCount, &Image->Pages);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  ImageBase = (UINT8 *) (UINTN) Image->Pages;
+  ZeroMem (ImageBase, SizeOfImage);
+  CopyMem (ImageBase, Source, Hdr->OptionalHeader.SizeOfHeaders);
+
+  //
+  // Sections are zero-filled past their raw data
+  //
+  Section = (EFI_IMAGE_SECTION_HEADER *) (Source + SectionOffset);
+  for (Index = 0; Index < Hdr->FileHeader.NumberOfSections; Index++, Section++) {
+    Size = Section->SizeOfRawData;
+    if ((Section->Misc.VirtualSize != 0) && (Section->Misc.VirtualSize < Size)) {
+      Size = Section->Misc.VirtualSize;
+    }
+    if ((Section->VirtualAddress > SizeOfImage) || (Size > SizeOfImage - Section->VirtualAddress) ||
+        (Section->PointerToRawData > SourceSize) || (Size > SourceSize - Section->PointerToRawData)) {
+      Status = EFI_LOAD_ERROR;
+      break;
+    }
+    CopyMem (ImageBase + Section->VirtualAddress, Source + Section->PointerToRawData, Size);
+  }
+  if (!EFI_ERROR (Status)) {
+    Status = HostRelocateImage (ImageBase, (EFI_IMAGE_NT_HEADERS64 *) (ImageBase + HdrOffset));
+  }
+  if (EFI_ERROR (Status)) {
+    gBS->FreePages (Image->Pages, Image->PageCount);
+    return Status;
+  }
+
+  Image->Subsystem                 = Hdr->OptionalHeader.Subsystem;
+  Image->EntryPoint                = (EFI_IMAGE_ENTRY_POINT) (ImageBase + Hdr->OptionalHeader.AddressOfEntryPoint);
+  Image->LoadedImage.ImageBase     = ImageBase;
+  Image->LoadedImage.ImageSize     = SizeOfImage;
+  if (Image->Subsystem == EFI_IMAGE_SUBSYSTEM_EFI_APPLICATION) {
+    Image->LoadedImage.ImageCodeType = EfiLoaderCode;
+    Image->LoadedImage.ImageDataType = EfiLoaderData;
+  } else if (Image->Subsystem == EFI_IMAGE_SUBSYSTEM_EFI_RUNTIME_DRIVER) {
+    Image->LoadedImage.ImageCodeType = EfiRuntimeServicesCode;
+    Image->LoadedImage.ImageDataType = EfiRuntimeServicesData;
+  } else {
+    Image->LoadedImage.ImageCodeType = EfiBootServicesCode;
+    Image->LoadedImage.ImageDataType = EfiBootServicesData;
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Free an image, once the interpreter has let go of it.
+
+  @param  Image         The image.
+
+**/
+VOID
+HostFreeImage (
+  IN HOST_IMAGE   *Image
+  )
+{
+  EFI_EBC_PROTOCOL  *Ebc;
+  HOST_IMAGE        **Link;
+
+  if (!EFI_ERROR (gBS->LocateProtocol (&gEfiEbcProtocolGuid, NULL, (VOID **) &Ebc))) {
+    Ebc->UnloadImage (Ebc, Image->Handle);
+  }
+  gBS->UninstallProtocolInterface (Image->Handle, &gEfiLoadedImageProtocolGuid, &Image->LoadedImage);
+  gBS->FreePages (Image->Pages, Image->PageCount);
+  if (Image->LoadedImage.FilePath != NULL) {
+    FreePool (Image->LoadedImage.FilePath);
+  }
+  for (Link = &mHostImageList; *Link != Image; Link = &(*Link)->Next) {
+  }
+  *Link = Image->Next;
+  FreePool (Image);
+}
+
+EFI_STATUS
+EFIAPI
+HostLoadImage (
+  IN  BOOLEAN                      BootPolicy,
+  IN  EFI_HANDLE                   ParentImageHandle,
+  IN  EFI_DEVICE_PATH_PROTOCOL     *DevicePath,
+  IN  VOID                         *SourceBuffer OPTIONAL,
+  IN  UINTN                        SourceSize,
+  OUT EFI_HANDLE                   *ImageHandle
+  )
+{
+  EFI_STATUS                  Status;
+  EFI_EBC_PROTOCOL            *Ebc;
+  EFI_DEVICE_PATH_PROTOCOL    *Node;
+  HOST_IMAGE                  *Image;
+  VOID                        *Buffer;
+  EFI_DEVICE_PATH_PROTOCOL    *End;
+  UINTN                       Size;
+  UINTN                       PathSize;
+
+  if ((ImageHandle == NULL) || ((DevicePath == NULL) && (SourceBuffer == NULL))) {
+    return EFI_INVALID_PARAMETER;
+  }
+  Status = gBS->LocateProtocol (&gEfiEbcProtocolGuid, NULL, (VOID **) &Ebc);
+  if (EFI_ERROR (Status)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // The host has no device paths for its handles, so only a file path node
+  // is expected, relative to the current directory
+  //
+  Node     = NULL;
+  PathSize = 0;
+  if (DevicePath != NULL) {
+    for (Node = DevicePath; Node->Type != END_DEVICE_PATH_TYPE; Node = (EFI_DEVICE_PATH_PROTOCOL *) ((UINT8 *) Node + PathSize)) {
+      PathSize = Node->Length[0] | (Node->Length[1] << 8);
+      if (PathSize < sizeof (EFI_DEVICE_PATH_PROTOCOL)) {
+        return EFI_INVALID_PARAMETER;
+      }
+      if ((Node->Type == MEDIA_DEVICE_PATH) && (Node->SubType == MEDIA_FILEPATH_DP)) {
+        break;
+      }
+    }
+    if (Node->Type == END_DEVICE_PATH_TYPE) {
+      return EFI_NOT_FOUND;
+    }
+  }
+
+  Buffer = SourceBuffer;
+  Size   = SourceSize;
+  if (SourceBuffer == NULL) {
+    Status = HostReadFile (((FILEPATH_DEVICE_PATH *) Node)->PathName, &Buffer, &Size);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  Image = AllocateZeroPool (sizeof (HOST_IMAGE));
+  if (Image == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+  } else {
+    Status = HostCopyImage (Image, Buffer, Size);
+    if (EFI_ERROR (Status)) {
+      FreePool (Image);
+    }
+  }
+  if (SourceBuffer == NULL) {
+    FreePool (Buffer);
+  }
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Image->LoadedImage.Revision     = EFI_LOADED_IMAGE_PROTOCOL_REVISION;
+  Image->LoadedImage.ParentHandle = ParentImageHandle;
+  Image->LoadedImage.SystemTable  = gST;
+  if (DevicePath != NULL) {
+    Image->LoadedImage.DeviceHandle = mHostFileSystemHandle;
+    Image->LoadedImage.FilePath     = AllocatePool (PathSize + sizeof (EFI_DEVICE_PATH_PROTOCOL));
+    if (Image->LoadedImage.FilePath != NULL) {
+      CopyMem (Image->LoadedImage.FilePath, Node, PathSize);
+      End            = (EFI_DEVICE_PATH_PROTOCOL *) ((UINT8 *) Image->LoadedImage.FilePath + PathSize);
+      End->Type      = END_DEVICE_PATH_TYPE;
+      End->SubType   = END_ENTIRE_DEVICE_PATH_SUBTYPE;
+      End->Length[0] = sizeof (EFI_DEVICE_PATH_PROTOCOL);
+      End->Length[1] = 0;
+    }
+  }
+  Image->Next    = mHostImageList;
+  mHostImageList = Image;
+
+  Status = gBS->InstallProtocolInterface (
+                  &Image->Handle,
+                  &gEfiLoadedImageProtocolGuid,
+                  EFI_NATIVE_INTERFACE,
+                  &Image->LoadedImage
+                  );
+  if (!EFI_ERROR (Status)) {
+    //
+    // The loaded image protocol must be there for the interpreter to find
+    // where the image lives
+    //
+    Status = Ebc->CreateThunk (Ebc, Image->Handle, (VOID *) Image->EntryPoint, (VOID **) &Image->EntryPoint);
+  }
+  if (EFI_ERROR (Status)) {
+    HostFreeImage (Image);
+    return Status;
+  }
+  *ImageHandle = Image->Handle;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostStartImage (
+  IN  EFI_HANDLE                  ImageHandle,
+  OUT UINTN                       *ExitDataSize,
+  OUT CHAR16                      **ExitData    OPTIONAL
+  )
+{
+  EFI_STATUS    Status;
+  HOST_IMAGE    *Image;
+
+  Image = HostGetImage (ImageHandle);
+  if ((Image == NULL) || Image->Started) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (ExitDataSize != NULL) {
+    *ExitDataSize = 0;
+  }
+  if (ExitData != NULL) {
+    *ExitData = NULL;
+  }
+
+  //
+  // Exit () ends the host program, so only a return comes back here
+  //
+  Image->Started = TRUE;
+  Status = Image->EntryPoint (ImageHandle, gST);
+
+  //
+  // Applications, and drivers that failed, are unloaded when they return
+  //
+  if ((Image->Subsystem == EFI_IMAGE_SUBSYSTEM_EFI_APPLICATION) || EFI_ERROR (Status)) {
+    HostFreeImage (Image);
+  }
+  return Status;
+}
+
+EFI_STATUS
+EFIAPI
+HostUnloadImage (
+  IN  EFI_HANDLE                   ImageHandle
+  )
+{
+  EFI_STATUS    Status;
+  HOST_IMAGE    *Image;
+
+  Image = HostGetImage (ImageHandle);
+  if (Image == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (Image->Started) {
+    if (Image->LoadedImage.Unload == NULL) {
+      return EFI_UNSUPPORTED;
+    }
+    Status = Image->LoadedImage.Unload (ImageHandle);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+  HostFreeImage (Image);
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,1240 @@
+/** @file
+  The library functions that the interpreter and the debugger use, for the
+  host build. They are implemented over libc.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/DebugLib.h>
+#include <Library/TimerLib.h>
+#include <Library/PrintLib.h>
+#include <Library/UefiLib.h>
+#include <Library/DevicePathLib.h>
+#include <Protocol/LoadedImage.h>
+
+#include "Host.h"
+
+//
+// The longest line that Print () and DebugPrint () output at once
+//
+#define HOST_PRINT_SIZE     1024
+
+//
+// Flags of the formatted output
+//
+#define HOST_PRINT_LEFT     0x01
+#define HOST_PRINT_ZERO     0x02
+#define HOST_PRINT_LONG     0x04
+#define HOST_PRINT_SIGN     0x08
+#define HOST_PRINT_SPACE    0x10
+
+//
+// The sink of the formatted output, which is a CHAR16 or a CHAR8 buffer
+//
+typedef struct {
+  VOID      *Buffer;
+  UINTN     Size;
+  UINTN     Length;
+  BOOLEAN   Unicode;
+} HOST_PRINT_BUFFER;
+
+CONST CHAR8 *mHostErrorString[] = {
+  "Success",                      //  RETURN_SUCCESS                = 0
+  "Load Error",                   //  RETURN_LOAD_ERROR             = 1  | MAX_BIT
+  "Invalid Parameter",            //  RETURN_INVALID_PARAMETER      = 2  | MAX_BIT
+  "Unsupported",                  //  RETURN_UNSUPPORTED            = 3  | MAX_BIT
+  "Bad Buffer Size",              //  RETURN_BAD_BUFFER_SIZE        = 4  | MAX_BIT
+  "Buffer Too Small",             //  RETURN_BUFFER_TOO_SMALL,      = 5  | MAX_BIT
+  "Not Ready",                    //  RETURN_NOT_READY              = 6  | MAX_BIT
+  "Device Error",                 //  RETURN_DEVICE_ERROR           = 7  | MAX_BIT
+  "Write Protected",              //  RETURN_WRITE_PROTECTED        = 8  | MAX_BIT
+  "Out of Resources",             //  RETURN_OUT_OF_RESOURCES       = 9  | MAX_BIT
+  "Volume Corrupt",               //  RETURN_VOLUME_CORRUPTED       = 10 | MAX_BIT
+  "Volume Full",                  //  RETURN_VOLUME_FULL            = 11 | MAX_BIT
+  "No Media",                     //  RETURN_NO_MEDIA               = 12 | MAX_BIT
+  "Media changed",                //  RETURN_MEDIA_CHANGED          = 13 | MAX_BIT
+  "Not Found",                    //  RETURN_NOT_FOUND              = 14 | MAX_BIT
+  "Access Denied",                //  RETURN_ACCESS_DENIED          = 15 | MAX_BIT
+  "No Response",                  //  RETURN_NO_RESPONSE            = 16 | MAX_BIT
+  "No mapping",                   //  RETURN_NO_MAPPING             = 17 | MAX_BIT
+  "Time out",                     //  RETURN_TIMEOUT                = 18 | MAX_BIT
+  "Not started",                  //  RETURN_NOT_STARTED            = 19 | MAX_BIT
+  "Already started",              //  RETURN_ALREADY_STARTED        = 20 | MAX_BIT
+  "Aborted",                      //  RETURN_ABORTED                = 21 | MAX_BIT
+  "ICMP Error",                   //  RETURN_ICMP_ERROR             = 22 | MAX_BIT
+  "TFTP Error",                   //  RETURN_TFTP_ERROR             = 23 | MAX_BIT
+  "Protocol Error",               //  RETURN_PROTOCOL_ERROR         = 24 | MAX_BIT
+  "Incompatible Version",         //  RETURN_INCOMPATIBLE_VERSION   = 25 | MAX_BIT
+  "Security Violation",           //  RETURN_SECURITY_VIOLATION     = 26 | MAX_BIT
+  "CRC Error",                    //  RETURN_CRC_ERROR              = 27 | MAX_BIT
+  "End of Media",                 //  RETURN_END_OF_MEDIA           = 28 | MAX_BIT
+  "Reserved (29)",                //  RESERVED                      = 29 | MAX_BIT
+  "Reserved (30)",                //  RESERVED                      = 30 | MAX_BIT
+  "End of File",                  //  RETURN_END_OF_FILE            = 31 | MAX_BIT
+  "Invalid Language",             //  RETURN_INVALID_LANGUAGE       = 32 | MAX_BIT
+  "Compromised Data"              //  RETURN_COMPROMISED_DATA       = 33 | MAX_BIT
+};
+
+CONST CHAR8 *mHostWarningString[] = {
+  "Success",                      //  RETURN_SUCCESS                = 0
+  "Warning Unknown Glyph",        //  RETURN_WARN_UNKNOWN_GLYPH     = 1
+  "Warning Delete Failure",       //  RETURN_WARN_DELETE_FAILURE    = 2
+  "Warning Write Failure",        //  RETURN_WARN_WRITE_FAILURE     = 3
+  "Warning Buffer Too Small",     //  RETURN_WARN_BUFFER_TOO_SMALL  = 4
+  "Warning Stale Data"            //  RETURN_WARN_STALE_DATA        = 5
+};
+
+//
+// String functions
+//
+
+UINTN
+EFIAPI
+StrLen (
+  IN CONST CHAR16 *String
+  )
+{
+  UINTN Length;
+
+  for (Length = 0; String[Length] != 0; Length++) {
+  }
+  return Length;
+}
+
+UINTN
+EFIAPI
+StrSize (
+  IN CONST CHAR16 *String
+  )
+{
+  return (StrLen (String) + 1) * sizeof (CHAR16);
+}
+
+INTN
+EFIAPI
+StrCmp (
+  IN CONST CHAR16 *FirstString,
+  IN CONST CHAR16 *SecondString
+  )
+{
+  while ((*FirstString != 0) && (*FirstString == *SecondString)) {
+    FirstString++;
+    SecondString++;
+  }
+  return *FirstString - *SecondString;
+}
+
+INTN
+EFIAPI
+StrnCmp (
+  IN CONST CHAR16 *FirstString,
+  IN CONST CHAR16 *SecondString,
+  IN UINTN        Length
+  )
+{
+  if (Length == 0) {
+    return 0;
+  }
+  while ((*FirstString != 0) && (*FirstString == *SecondString) && (Length > 1)) {
+    FirstString++;
+    SecondString++;
+    Length--;
+  }
+  return *FirstString - *SecondString;
+}
+
+RETURN_STATUS
+EFIAPI
+StrnCpyS (
+  OUT CHAR16       *Destination,
+  IN  UINTN        DestMax,
+  IN  CONST CHAR16 *Source,
+  IN  UINTN        Length
+  )
+{
+  UINTN Index;
+
+  for (Index = 0; (Index < Length) && (Source[Index] != 0); Index++) {
+    if (Index + 1 >= DestMax) {
+      return RETURN_BUFFER_TOO_SMALL;
+    }
+    Destination[Index] = Source[Index];
+  }
+  if (DestMax == 0) {
+    return RETURN_BUFFER_TOO_SMALL;
+  }
+  Destination[Index] = 0;
+  return RETURN_SUCCESS;
+}
+
+RETURN_STATUS
+EFIAPI
+StrCpyS (
+  OUT CHAR16       *Destination,
+  IN  UINTN        DestMax,
+  IN  CONST CHAR16 *Source
+  )
+{
+  return StrnCpyS (Destination, DestMax, Source, MAX_UINTN);
+}
+
+RETURN_STATUS
+EFIAPI
+StrnCatS (
+  IN OUT CHAR16       *Destination,
+  IN     UINTN        DestMax,
+  IN     CONST CHAR16 *Source,
+  IN     UINTN        Length
+  )
+{
+  UINTN DestLen;
+
+  DestLen = StrLen (Destination);
+  if (DestLen >= DestMax) {
+    return RETURN_BAD_BUFFER_SIZE;
+  }
+  return StrnCpyS (Destination + DestLen, DestMax - DestLen, Source, Length);
+}
+
+RETURN_STATUS
+EFIAPI
+StrCatS (
+  IN OUT CHAR16       *Destination,
+  IN     UINTN        DestMax,
+  IN     CONST CHAR16 *Source
+  )
+{
+  return StrnCatS (Destination, DestMax, Source, MAX_UINTN);
+}
+
+UINTN
+EFIAPI
+AsciiStrLen (
+  IN CONST CHAR8 *String
+  )
+{
+  return strlen (String);
+}
+
+UINTN
+EFIAPI
+AsciiStrSize (
+  IN CONST CHAR8 *String
+  )
+{
+  return strlen (String) + 1;
+}
+
+INTN
+EFIAPI
+AsciiStrCmp (
+  IN CONST CHAR8 *FirstString,
+  IN CONST CHAR8 *SecondString
+  )
+{
+  return strcmp (FirstString, SecondString);
+}
+
+INTN
+EFIAPI
+AsciiStrnCmp (
+  IN CONST CHAR8 *FirstString,
+  IN CONST CHAR8 *SecondString,
+  IN UINTN       Length
+  )
+{
+  return strncmp (FirstString, SecondString, Length);
+}
+
+INTN
+EFIAPI
+AsciiStriCmp (
+  IN CONST CHAR8 *FirstString,
+  IN CONST CHAR8 *SecondString
+  )
+{
+  return strcasecmp (FirstString, SecondString);
+}
+
+RETURN_STATUS
+EFIAPI
+AsciiStrnCpyS (
+  OUT CHAR8        *Destination,
+  IN  UINTN        DestMax,
+  IN  CONST CHAR8  *Source,
+  IN  UINTN        Length
+  )
+{
+  UINTN Index;
+
+  for (Index = 0; (Index < Length) && (Source[Index] != 0); Index++) {
+    if (Index + 1 >= DestMax) {
+      return RETURN_BUFFER_TOO_SMALL;
+    }
+    Destination[Index] = Source[Index];
+  }
+  if (DestMax == 0) {
+    return RETURN_BUFFER_TOO_SMALL;
+  }
+  Destination[Index] = 0;
+  return RETURN_SUCCESS;
+}
+
+RETURN_STATUS
+EFIAPI
+AsciiStrCpyS (
+  OUT CHAR8        *Destination,
+  IN  UINTN        DestMax,
+  IN  CONST CHAR8  *Source
+  )
+{
+  return AsciiStrnCpyS (Destination, DestMax, Source, MAX_UINTN);
+}
+
+//
+// Math functions
+//
+
+UINT64 EFIAPI LShiftU64 (IN UINT64 Operand, IN UINTN Count) { return Operand << Count; }
+UINT64 EFIAPI RShiftU64 (IN UINT64 Operand, IN UINTN Count) { return Operand >> Count; }
+UINT64 EFIAPI ARShiftU64 (IN UINT64 Operand, IN UINTN Count) { return (UINT64) ((INT64) Operand >> Count); }
+UINT64 EFIAPI MultU64x32 (IN UINT64 Multiplicand, IN UINT32 Multiplier) { return Multiplicand * Multiplier; }
+UINT64 EFIAPI MultU64x64 (IN UINT64 Multiplicand, IN UINT64 Multiplier) { return Multiplicand * Multiplier; }
+INT64  EFIAPI MultS64x64 (IN INT64 Multiplicand, IN INT64 Multiplier) { return (INT64) ((UINT64) Multiplicand * (UINT64) Multiplier); }
+UINT64 EFIAPI DivU64x32 (IN UINT64 Dividend, IN UINT32 Divisor) { return Dividend / Divisor; }
+UINT32 EFIAPI ModU64x32 (IN UINT64 Dividend, IN UINT32 Divisor) { return (UINT32) (Dividend % Divisor); }
+
+UINT64
+EFIAPI
+DivU64x32Remainder (
+  IN  UINT64 Dividend,
+  IN  UINT32 Divisor,
+  OUT UINT32 *Remainder OPTIONAL
+  )
+{
+  if (Remainder != NULL) {
+    *Remainder = (UINT32) (Dividend % Divisor);
+  }
+  return Dividend / Divisor;
+}
+
+UINT64
+EFIAPI
+DivU64x64Remainder (
+  IN  UINT64 Dividend,
+  IN  UINT64 Divisor,
+  OUT UINT64 *Remainder OPTIONAL
+  )
+{
+  if (Remainder != NULL) {
+    *Remainder = Dividend % Divisor;
+  }
+  return Dividend / Divisor;
+}
+
+INT64
+EFIAPI
+DivS64x64Remainder (
+  IN  INT64  Dividend,
+  IN  INT64  Divisor,
+  OUT INT64  *Remainder OPTIONAL
+  )
+{
+  if (Remainder != NULL) {
+    *Remainder = Dividend % Divisor;
+  }
+  return Dividend / Divisor;
+}
+
+INTN
+EFIAPI
+HighBitSet32 (
+  IN UINT32 Operand
+  )
+{
+  return (Operand == 0) ? -1 : 31 - __builtin_clz (Operand);
+}
+
+INTN
+EFIAPI
+HighBitSet64 (
+  IN UINT64 Operand
+  )
+{
+  return (Operand == 0) ? -1 : 63 - __builtin_clzll (Operand);
+}
+
+UINT16 EFIAPI SwapBytes16 (IN UINT16 Value) { return __builtin_bswap16 (Value); }
+UINT32 EFIAPI SwapBytes32 (IN UINT32 Value) { return __builtin_bswap32 (Value); }
+UINT64 EFIAPI SwapBytes64 (IN UINT64 Value) { return __builtin_bswap64 (Value); }
+
+//
+// Processor functions
+//
+
+VOID EFIAPI MemoryFence (VOID) { __sync_synchronize (); }
+VOID EFIAPI CpuBreakpoint (VOID) { __builtin_trap (); }
+VOID EFIAPI CpuDeadLoop (VOID) { abort (); }
+VOID EFIAPI CpuPause (VOID) { }
+
+//
+// Memory functions
+//
+
+VOID *
+EFIAPI
+CopyMem (
+  OUT VOID       *DestinationBuffer,
+  IN  CONST VOID *SourceBuffer,
+  IN  UINTN      Length
+  )
+{
+  return memmove (DestinationBuffer, SourceBuffer, Length);
+}
+
+VOID *
+EFIAPI
+SetMem (
+  OUT VOID  *Buffer,
+  IN  UINTN Length,
+  IN  UINT8 Value
+  )
+{
+  return memset (Buffer, Value, Length);
+}
+
+VOID *
+EFIAPI
+SetMem16 (
+  OUT VOID   *Buffer,
+  IN  UINTN  Length,
+  IN  UINT16 Value
+  )
+{
+  UINTN Index;
+
+  for (Index = 0; Index < Length / sizeof (Value); Index++) {
+    ((UINT16 *) Buffer)[Index] = Value;
+  }
+  return Buffer;
+}
+
+VOID *
+EFIAPI
+SetMem32 (
+  OUT VOID   *Buffer,
+  IN  UINTN  Length,
+  IN  UINT32 Value
+  )
+{
+  UINTN Index;
+
+  for (Index = 0; Index < Length / sizeof (Value); Index++) {
+    ((UINT32 *) Buffer)[Index] = Value;
+  }
+  return Buffer;
+}
+
+VOID *
+EFIAPI
+SetMem64 (
+  OUT VOID   *Buffer,
+  IN  UINTN  Length,
+  IN  UINT64 Value
+  )
+{
+  UINTN Index;
+
+  for (Index = 0; Index < Length / sizeof (Value); Index++) {
+    ((UINT64 *) Buffer)[Index] = Value;
+  }
+  return Buffer;
+}
+
+VOID *
+EFIAPI
+ZeroMem (
+  OUT VOID  *Buffer,
+  IN  UINTN Length
+  )
+{
+  return memset (Buffer, 0, Length);
+}
+
+INTN
+EFIAPI
+CompareMem (
+  IN CONST VOID  *DestinationBuffer,
+  IN CONST VOID  *SourceBuffer,
+  IN UINTN       Length
+  )
+{
+  CONST UINT8 *Destination;
+  CONST UINT8 *Source;
+
+  //
+  // Like the EDK2 version, return the difference of the first bytes that
+  // don't match, which memcmp () does not promise
+  //
+  Destination = DestinationBuffer;
+  Source      = SourceBuffer;
+  for (; Length > 0; Length--, Destination++, Source++) {
+    if (*Destination != *Source) {
+      return *Destination - *Source;
+    }
+  }
+  return 0;
+}
+
+BOOLEAN
+EFIAPI
+CompareGuid (
+  IN CONST GUID *Guid1,
+  IN CONST GUID *Guid2
+  )
+{
+  return memcmp (Guid1, Guid2, sizeof (GUID)) == 0;
+}
+
+GUID *
+EFIAPI
+CopyGuid (
+  OUT GUID       *DestinationGuid,
+  IN  CONST GUID *SourceGuid
+  )
+{
+  return memcpy (DestinationGuid, SourceGuid, sizeof (GUID));
+}
+
+//
+// Memory allocation functions
+//
+
+VOID *
+EFIAPI
+AllocatePool (
+  IN UINTN AllocationSize
+  )
+{
+  return malloc (AllocationSize);
+}
+
+VOID *
+EFIAPI
+AllocateZeroPool (
+  IN UINTN AllocationSize
+  )
+{
+  return calloc (1, AllocationSize);
+}
+
+VOID *
+EFIAPI
+AllocateRuntimePool (
+  IN UINTN AllocationSize
+  )
+{
+  return malloc (AllocationSize);
+}
+
+VOID *
+EFIAPI
+AllocateCopyPool (
+  IN UINTN       AllocationSize,
+  IN CONST VOID  *Buffer
+  )
+{
+  VOID  *Memory;
+
+  Memory = malloc (AllocationSize);
+  if (Memory != NULL) {
+    memcpy (Memory, Buffer, AllocationSize);
+  }
+  return Memory;
+}
+
+VOID *
+EFIAPI
+ReallocatePool (
+  IN UINTN  OldSize,
+  IN UINTN  NewSize,
+  IN VOID   *OldBuffer OPTIONAL
+  )
+{
+  VOID  *NewBuffer;
+
+  NewBuffer = calloc (1, NewSize);
+  if ((NewBuffer != NULL) && (OldBuffer != NULL)) {
+    memcpy (NewBuffer, OldBuffer, MIN (OldSize, NewSize));
+    free (OldBuffer);
+  }
+  return NewBuffer;
+}
+
+VOID
+EFIAPI
+FreePool (
+  IN VOID   *Buffer
+  )
+{
+  //
+  // The thunks are not allocated, but their buffers are freed all the same
+  // when an image is unloaded
+  //
+  if (HostFreeThunk (Buffer)) {
+    return;
+  }
+  free (Buffer);
+}
+
+VOID *
+EFIAPI
+AllocatePages (
+  IN UINTN  Pages
+  )
+{
+  return aligned_alloc (EFI_PAGE_SIZE, EFI_PAGES_TO_SIZE (Pages));
+}
+
+VOID
+EFIAPI
+FreePages (
+  IN VOID   *Buffer,
+  IN UINTN  Pages
+  )
+{
+  free (Buffer);
+}
+
+//
+// Timer functions, with a counter in nanoseconds
+//
+
+UINT64
+EFIAPI
+GetPerformanceCounter (
+  VOID
+  )
+{
+  struct timespec Now;
+
+  clock_gettime (CLOCK_MONOTONIC, &Now);
+  return (UINT64) Now.tv_sec * 1000000000ULL + (UINT64) Now.tv_nsec;
+}
+
+UINT64
+EFIAPI
+GetPerformanceCounterProperties (
+  OUT UINT64 *StartValue OPTIONAL,
+  OUT UINT64 *EndValue OPTIONAL
+  )
+{
+  if (StartValue != NULL) {
+    *StartValue = 0;
+  }
+  if (EndValue != NULL) {
+    *EndValue = MAX_UINT64;
+  }
+  return 1000000000ULL;
+}
+
+UINT64
+EFIAPI
+GetTimeInNanoSecond (
+  IN UINT64 Ticks
+  )
+{
+  return Ticks;
+}
+
+UINTN
+EFIAPI
+NanoSecondDelay (
+  IN UINTN NanoSeconds
+  )
+{
+  struct timespec Delay;
+
+  Delay.tv_sec  = NanoSeconds / 1000000000;
+  Delay.tv_nsec = NanoSeconds % 1000000000;
+  nanosleep (&Delay, NULL);
+  return NanoSeconds;
+}
+
+UINTN
+EFIAPI
+MicroSecondDelay (
+  IN UINTN MicroSeconds
+  )
+{
+  NanoSecondDelay (MicroSeconds * 1000);
+  return MicroSeconds;
+}
+
+//
+// Formatted output
+//
+
+CONST CHAR8 *
+HostStatusString (
+  IN EFI_STATUS Status
+  )
+{
+  UINTN Index;
+
+  Index = Status & ~MAX_BIT;
+  if ((Status & MAX_BIT) != 0) {
+    if (Index < ARRAY_SIZE (mHostErrorString)) {
+      return mHostErrorString[Index];
+    }
+  } else if (Index < ARRAY_SIZE (mHostWarningString)) {
+    return mHostWarningString[Index];
+  }
+  return NULL;
+}
+
+/**
+  Add a character to the output, if there is room for it and the NUL.
+
+  @param  Output        The output.
+  @param  Char          The character.
+
+**/
+VOID
+HostPrintChar (
+  IN OUT HOST_PRINT_BUFFER  *Output,
+  IN     CHAR16             Char
+  )
+{
+  if (Output->Length + 1 >= Output->Size) {
+    return;
+  }
+  if (Output->Unicode) {
+    ((CHAR16 *) Output->Buffer)[Output->Length] = Char;
+  } else {
+    ((CHAR8 *) Output->Buffer)[Output->Length] = (CHAR8) Char;
+  }
+  Output->Length++;
+}
+
+/**
+  Add a field to the output, padded to its width.
+
+  @param  Output        The output.
+  @param  Text          The text of the field, in CHAR16 or CHAR8.
+  @param  Unicode       TRUE if the text is in CHAR16.
+  @param  Length        The number of characters of the text.
+  @param  Flags         HOST_PRINT_LEFT and HOST_PRINT_ZERO.
+  @param  Width         The width of the field.
+
+**/
+VOID
+HostPrintField (
+  IN OUT HOST_PRINT_BUFFER  *Output,
+  IN     CONST VOID         *Text,
+  IN     BOOLEAN            Unicode,
+  IN     UINTN              Length,
+  IN     UINTN              Flags,
+  IN     UINTN              Width
+  )
+{
+  UINTN   Index;
+  CHAR16  Pad;
+
+  Pad = ((Flags & HOST_PRINT_ZERO) != 0) ? L'0' : L' ';
+  if ((Flags & HOST_PRINT_LEFT) == 0) {
+    for (Index = Length; Index < Width; Index++) {
+      HostPrintChar (Output, Pad);
+    }
+  }
+  for (Index = 0; Index < Length; Index++) {
+    HostPrintChar (Output, Unicode ? ((CONST CHAR16 *) Text)[Index] : (CHAR8) ((CONST CHAR8 *) Text)[Index]);
+  }
+  if ((Flags & HOST_PRINT_LEFT) != 0) {
+    for (Index = Length; Index < Width; Index++) {
+      HostPrintChar (Output, L' ');
+    }
+  }
+}
+
+/**
+  Format a string with the EDK2 conventions: %s is a CHAR16 string, %a a
+  CHAR8 one, %r a status code, %g a GUID, and the 'l' flag selects 64-bit
+  arguments.
+
+  @param  Output        The output.
+  @param  Format        The format, in CHAR16 or CHAR8.
+  @param  Unicode       TRUE if the format is in CHAR16.
+  @param  Marker        The arguments.
+
+  @return The number of characters of the output, without the NUL.
+
+**/
+UINTN
+HostVPrint (
+  IN OUT HOST_PRINT_BUFFER  *Output,
+  IN     CONST VOID         *Format,
+  IN     BOOLEAN            Unicode,
+  IN     VA_LIST            Marker
+  )
+{
+  UINTN       Index;
+  CHAR16      Char;
+  UINTN       Flags;
+  UINTN       Width;
+  UINTN       Precision;
+  BOOLEAN     HasPrecision;
+  UINT64      Value;
+  BOOLEAN     Negative;
+  CHAR8       Number[40];
+  CHAR8       *Digits;
+  UINTN       Base;
+  BOOLEAN     Upper;
+  CONST VOID  *Text;
+  GUID        *Guid;
+
+#define HOST_FORMAT_CHAR(Index) \
+  (Unicode ? ((CONST CHAR16 *) Format)[Index] : (CHAR16) (UINT8) ((CONST CHAR8 *) Format)[Index])
+
+  Output->Length = 0;
+  for (Index = 0; HOST_FORMAT_CHAR (Index) != 0; Index++) {
+    Char = HOST_FORMAT_CHAR (Index);
+    if (Char != L'%') {
+      HostPrintChar (Output, Char);
+      continue;
+    }
+
+    Flags        = 0;
+    Width        = 0;
+    Precision    = 0;
+    HasPrecision = FALSE;
+    for (Index++; ; Index++) {
+      Char = HOST_FORMAT_CHAR (Index);
+      if (Char == L'-') {
+        Flags |= HOST_PRINT_LEFT;
+      } else if (Char == L'+') {
+        Flags |= HOST_PRINT_SIGN;
+      } else if (Char == L' ') {
+        Flags |= HOST_PRINT_SPACE;
+      } else if (Char == L',') {
+      } else if ((Char == L'l') || (Char == L'L')) {
+        Flags |= HOST_PRINT_LONG;
+      } else if ((Char == L'0') && (Width == 0) && !HasPrecision) {
+        Flags |= HOST_PRINT_ZERO;
+      } else if ((Char >= L'0') && (Char <= L'9')) {
+        if (HasPrecision) {
+          Precision = Precision * 10 + (Char - L'0');
+        } else {
+          Width = Width * 10 + (Char - L'0');
+        }
+      } else if (Char == L'*') {
+        if (HasPrecision) {
+          Precision = VA_ARG (Marker, UINTN);
+        } else {
+          Width = VA_ARG (Marker, UINTN);
+        }
+      } else if (Char == L'.') {
+        HasPrecision = TRUE;
+      } else {
+        break;
+      }
+    }
+
+    Base     = 0;
+    Upper    = FALSE;
+    Negative = FALSE;
+    switch (Char) {
+    case L'd':
+    case L'i':
+      if ((Flags & HOST_PRINT_LONG) != 0) {
+        Value = (UINT64) VA_ARG (Marker, INT64);
+      } else {
+        Value = (UINT64) (INT64) VA_ARG (Marker, int);
+      }
+      Negative = ((INT64) Value < 0);
+      if (Negative) {
+        Value = (UINT64) -(INT64) Value;
+      }
+      Base = 10;
+      break;
+
+    case L'u':
+      Value    = ((Flags & HOST_PRINT_LONG) != 0) ? VA_ARG (Marker, UINT64) : VA_ARG (Marker, unsigned int);
+      Negative = FALSE;
+      Base     = 10;
+      break;
+
+    case L'X':
+      Upper = TRUE;
+      //
+      // Fall through
+      //
+    case L'x':
+      Value    = ((Flags & HOST_PRINT_LONG) != 0) ? VA_ARG (Marker, UINT64) : VA_ARG (Marker, unsigned int);
+      Negative = FALSE;
+      Base     = 16;
+      break;
+
+    case L'p':
+      Value    = (UINTN) VA_ARG (Marker, VOID *);
+      Negative = FALSE;
+      Base     = 16;
+      Upper    = TRUE;
+      Flags   |= HOST_PRINT_ZERO;
+      Width    = sizeof (VOID *) * 2;
+      break;
+
+    case L'c':
+      Char = (CHAR16) VA_ARG (Marker, int);
+      HostPrintField (Output, &Char, TRUE, 1, Flags & HOST_PRINT_LEFT, Width);
+      break;
+
+    case L's':
+    case L'S':
+    case L'a':
+      Text = VA_ARG (Marker, CONST VOID *);
+      if (Text == NULL) {
+        Text = "<null string>";
+        Char = L'a';
+      }
+      if (Char == L'a') {
+        Value = strlen (Text);
+      } else {
+        Value = StrLen (Text);
+      }
+      if (HasPrecision && (Value > Precision)) {
+        Value = Precision;
+      }
+      HostPrintField (Output, Text, Char != L'a', (UINTN) Value, Flags & HOST_PRINT_LEFT, Width);
+      break;
+
+    case L'r':
+      Value = VA_ARG (Marker, EFI_STATUS);
+      Text  = HostStatusString ((EFI_STATUS) Value);
+      if (Text == NULL) {
+        snprintf (Number, sizeof (Number), "%08llX", (unsigned long long) Value);
+        Text = Number;
+      }
+      HostPrintField (Output, Text, FALSE, strlen (Text), Flags & HOST_PRINT_LEFT, Width);
+      break;
+
+    case L'g':
+      Guid = VA_ARG (Marker, GUID *);
+      snprintf (
+        Number,
+        sizeof (Number),
+        "%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+        Guid->Data1, Guid->Data2, Guid->Data3,
+        Guid->Data4[0], Guid->Data4[1], Guid->Data4[2], Guid->Data4[3],
+        Guid->Data4[4], Guid->Data4[5], Guid->Data4[6], Guid->Data4[7]
+        );
+      HostPrintField (Output, Number, FALSE, strlen (Number), Flags & HOST_PRINT_LEFT, Width);
+      break;
+
+    case L'%':
+      HostPrintChar (Output, L'%');
+      break;
+
+    case 0:
+      Index--;
+      break;
+
+    default:
+      HostPrintChar (Output, L'%');
+      HostPrintChar (Output, Char);
+      break;
+    }
+
+    if (Base != 0) {
+      //
+      // Build the digits from the end of the buffer
+      //
+      Digits  = &Number[sizeof (Number) - 1];
+      *Digits = 0;
+      do {
+        *--Digits = (Upper ? "0123456789ABCDEF" : "0123456789abcdef")[Value % Base];
+        Value /= Base;
+      } while (Value != 0);
+      if (HasPrecision) {
+        while ((UINTN) (&Number[sizeof (Number) - 1] - Digits) < Precision) {
+          *--Digits = '0';
+        }
+      }
+      if (Negative || ((Flags & (HOST_PRINT_SIGN | HOST_PRINT_SPACE)) != 0)) {
+        Char = Negative ? L'-' : ((Flags & HOST_PRINT_SIGN) != 0) ? L'+' : L' ';
+        if ((Flags & HOST_PRINT_ZERO) != 0) {
+          HostPrintChar (Output, Char);
+          Width = (Width > 0) ? Width - 1 : 0;
+        } else {
+          *--Digits = (CHAR8) Char;
+        }
+      }
+      HostPrintField (Output, Digits, FALSE, strlen (Digits), Flags, Width);
+    }
+  }
+#undef HOST_FORMAT_CHAR
+
+  if (Output->Size > 0) {
+    if (Output->Unicode) {
+      ((CHAR16 *) Output->Buffer)[Output->Length] = 0;
+    } else {
+      ((CHAR8 *) Output->Buffer)[Output->Length] = 0;
+    }
+  }
+  return Output->Length;
+}
+
+UINTN
+EFIAPI
+UnicodeVSPrint (
+  OUT CHAR16        *StartOfBuffer,
+  IN  UINTN         BufferSize,
+  IN  CONST CHAR16  *FormatString,
+  IN  VA_LIST       Marker
+  )
+{
+  HOST_PRINT_BUFFER Output;
+
+  Output.Buffer  = StartOfBuffer;
+  Output.Size    = BufferSize / sizeof (CHAR16);
+  Output.Unicode = TRUE;
+  return HostVPrint (&Output, FormatString, TRUE, Marker);
+}
+
+UINTN
+EFIAPI
+UnicodeSPrint (
+  OUT CHAR16        *StartOfBuffer,
+  IN  UINTN         BufferSize,
+  IN  CONST CHAR16  *FormatString,
+  ...
+  )
+{
+  VA_LIST Marker;
+  UINTN   Length;
+
+  VA_START (Marker, FormatString);
+  Length = UnicodeVSPrint (StartOfBuffer, BufferSize, FormatString, Marker);
+  VA_END (Marker);
+  return Length;
+}
+
+UINTN
+EFIAPI
+UnicodeVSPrintAsciiFormat (
+  OUT CHAR16        *StartOfBuffer,
+  IN  UINTN         BufferSize,
+  IN  CONST CHAR8   *FormatString,
+  IN  VA_LIST       Marker
+  )
+{
+  HOST_PRINT_BUFFER Output;
+
+  Output.Buffer  = StartOfBuffer;
+  Output.Size    = BufferSize / sizeof (CHAR16);
+  Output.Unicode = TRUE;
+  return HostVPrint (&Output, FormatString, FALSE, Marker);
+}
+
+UINTN
+EFIAPI
+UnicodeSPrintAsciiFormat (
+  OUT CHAR16        *StartOfBuffer,
+  IN  UINTN         BufferSize,
+  IN  CONST CHAR8   *FormatString,
+  ...
+  )
+{
+  VA_LIST Marker;
+  UINTN   Length;
+
+  VA_START (Marker, FormatString);
+  Length = UnicodeVSPrintAsciiFormat (StartOfBuffer, BufferSize, FormatString, Marker);
+  VA_END (Marker);
+  return Length;
+}
+
+UINTN
+EFIAPI
+AsciiVSPrint (
+  OUT CHAR8         *StartOfBuffer,
+  IN  UINTN         BufferSize,
+  IN  CONST CHAR8   *FormatString,
+  IN  VA_LIST       Marker
+  )
+{
+  HOST_PRINT_BUFFER Output;
+
+  Output.Buffer  = StartOfBuffer;
+  Output.Size    = BufferSize;
+  Output.Unicode = FALSE;
+  return HostVPrint (&Output, FormatString, FALSE, Marker);
+}
+
+UINTN
+EFIAPI
+AsciiSPrint (
+  OUT CHAR8         *StartOfBuffer,
+  IN  UINTN         BufferSize,
+  IN  CONST CHAR8   *FormatString,
+  ...
+  )
+{
+  VA_LIST Marker;
+  UINTN   Length;
+
+  VA_START (Marker, FormatString);
+  Length = AsciiVSPrint (StartOfBuffer, BufferSize, FormatString, Marker);
+  VA_END (Marker);
+  return Length;
+}
+
+UINTN
+EFIAPI
+Print (
+  IN CONST CHAR16 *Format,
+  ...
+  )
+{
+  VA_LIST Marker;
+  CHAR16  Buffer[HOST_PRINT_SIZE];
+  UINTN   Length;
+
+  VA_START (Marker, Format);
+  Length = UnicodeVSPrint (Buffer, sizeof (Buffer), Format, Marker);
+  VA_END (Marker);
+  if (gST->ConOut != NULL) {
+    gST->ConOut->OutputString (gST->ConOut, Buffer);
+  }
+  return Length;
+}
+
+UINTN
+EFIAPI
+AsciiPrint (
+  IN CONST CHAR8 *Format,
+  ...
+  )
+{
+  VA_LIST Marker;
+  CHAR16  Buffer[HOST_PRINT_SIZE];
+  UINTN   Length;
+
+  VA_START (Marker, Format);
+  Length = UnicodeVSPrintAsciiFormat (Buffer, sizeof (Buffer), Format, Marker);
+  VA_END (Marker);
+  if (gST->ConOut != NULL) {
+    gST->ConOut->OutputString (gST->ConOut, Buffer);
+  }
+  return Length;
+}
+
+//
+// Debug functions
+//
+
+VOID
+EFIAPI
+DebugPrint (
+  IN  UINTN        ErrorLevel,
+  IN  CONST CHAR8  *Format,
+  ...
+  )
+{
+  VA_LIST Marker;
+  CHAR8   Buffer[HOST_PRINT_SIZE];
+
+  if ((ErrorLevel & (DEBUG_ERROR | DEBUG_WARN | DEBUG_INFO)) == 0) {
+    return;
+  }
+  VA_START (Marker, Format);
+  AsciiVSPrint (Buffer, sizeof (Buffer), Format, Marker);
+  VA_END (Marker);
+  fputs (Buffer, stderr);
+}
+
+VOID
+EFIAPI
+DebugAssert (
+  IN CONST CHAR8  *FileName,
+  IN UINTN        LineNumber,
+  IN CONST CHAR8  *Description
+  )
+{
+  fprintf (stderr, "ASSERT %s(%lu): %s\n", FileName, (unsigned long) LineNumber, Description);
+  abort ();
+}
+
+//
+// Other UefiLib and DevicePathLib functions
+//
+
+EFI_STATUS
+EFIAPI
+EfiGetSystemConfigurationTable (
+  IN  EFI_GUID  *TableGuid,
+  OUT VOID      **Table
+  )
+{
+  UINTN Index;
+
+  *Table = NULL;
+  for (Index = 0; Index < gST->NumberOfTableEntries; Index++) {
+    if (CompareGuid (TableGuid, &gST->ConfigurationTable[Index].VendorGuid)) {
+      *Table = gST->ConfigurationTable[Index].VendorTable;
+      return EFI_SUCCESS;
+    }
+  }
+  return EFI_NOT_FOUND;
+}
+
+EFI_DEVICE_PATH_PROTOCOL *
+EFIAPI
+FileDevicePath (
+  IN EFI_HANDLE      Device OPTIONAL,
+  IN CONST CHAR16    *FileName
+  )
+{
+  FILEPATH_DEVICE_PATH      *FilePath;
+  EFI_DEVICE_PATH_PROTOCOL  *End;
+  UINTN                     Size;
+
+  //
+  // Only the file path node, as the host has no device paths for its
+  // handles. LoadImage () opens it on the file system of the current
+  // directory.
+  //
+  Size     = OFFSET_OF (FILEPATH_DEVICE_PATH, PathName) + StrSize (FileName);
+  FilePath = AllocateZeroPool (Size + sizeof (EFI_DEVICE_PATH_PROTOCOL));
+  if (FilePath == NULL) {
+    return NULL;
+  }
+  FilePath->Header.Type      = MEDIA_DEVICE_PATH;
+  FilePath->Header.SubType   = MEDIA_FILEPATH_DP;
+  FilePath->Header.Length[0] = (UINT8) Size;
+  FilePath->Header.Length[1] = (UINT8) (Size >> 8);
+  CopyMem (FilePath->PathName, FileName, StrSize (FileName));
+
+  End            = (EFI_DEVICE_PATH_PROTOCOL *) ((UINT8 *) FilePath + Size);
+  End->Type      = END_DEVICE_PATH_TYPE;
+  End->SubType   = END_ENTIRE_DEVICE_PATH_SUBTYPE;
+  End->Length[0] = sizeof (EFI_DEVICE_PATH_PROTOCOL);
+  return (EFI_DEVICE_PATH_PROTOCOL *) FilePath;
+}
@@ -0,0 +1,1936 @@
+/** @file
+  The system table, boot services and runtime services of the host build.
+
+  They cover what the interpreter, the debugger and EdbCfg use: a protocol
+  database, events that are signaled by hand or by timers when they are
+  checked, a console over stdin and stdout, and a file system over the
+  current directory. Timer events never call their notification functions,
+  as nothing interrupts the host program.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Protocol/LoadedImage.h>
+#include <Protocol/SimpleFileSystem.h>
+#include <Guid/FileInfo.h>
+
+#include "Host.h"
+
+#define HOST_HANDLE_SIGNATURE     SIGNATURE_32 ('h', 'h', 'n', 'd')
+#define HOST_EVENT_SIGNATURE      SIGNATURE_32 ('h', 'e', 'v', 't')
+#define HOST_FILE_SIGNATURE       SIGNATURE_32 ('h', 'f', 'i', 'l')
+
+//
+// The most protocols that a handle carries
+//
+#define HOST_PROTOCOL_COUNT       16
+
+//
+// The most configuration tables that can be installed
+//
+#define HOST_TABLE_COUNT          16
+
+//
+// How long WaitForEvent () sleeps between two checks of the events, in
+// microseconds
+//
+#define HOST_WAIT_PERIOD          1000
+
+typedef struct {
+  EFI_GUID      Guid;
+  VOID          *Interface;
+} HOST_PROTOCOL;
+
+typedef struct _HOST_HANDLE HOST_HANDLE;
+
+struct _HOST_HANDLE {
+  UINT32        Signature;
+  HOST_HANDLE   *Next;
+  UINTN         ProtocolCount;
+  HOST_PROTOCOL Protocol[HOST_PROTOCOL_COUNT];
+};
+
+typedef struct {
+  UINT32            Signature;
+  UINT32            Type;
+  EFI_TPL           NotifyTpl;
+  EFI_EVENT_NOTIFY  NotifyFunction;
+  VOID              *NotifyContext;
+  BOOLEAN           Signaled;
+  EFI_TIMER_DELAY   TimerType;
+  UINT64            TimerPeriod;
+  UINT64            TimerDue;
+} HOST_EVENT;
+
+typedef struct {
+  EFI_FILE_PROTOCOL File;
+  UINT32            Signature;
+  FILE              *Stream;
+  CHAR8             *Path;
+} HOST_FILE;
+
+#define HOST_FILE_FROM_THIS(a)  CR (a, HOST_FILE, File, HOST_FILE_SIGNATURE)
+
+HOST_HANDLE               *mHostHandleList;
+EFI_TPL                   mHostTpl = TPL_APPLICATION;
+UINT64                    mHostMonotonicCount;
+EFI_CONFIGURATION_TABLE   mHostConfigurationTable[HOST_TABLE_COUNT];
+EFI_HANDLE                mHostFileSystemHandle;
+
+//
+// Console
+//
+
+/**
+  Check whether stdin has a character to read.
+
+  @retval TRUE          A character, or the end of the input, is ready.
+  @retval FALSE         Reading would block.
+
+**/
+BOOLEAN
+HostKeyReady (
+  VOID
+  )
+{
+  fd_set          Set;
+  struct timeval  Timeout;
+
+  FD_ZERO (&Set);
+  FD_SET (STDIN_FILENO, &Set);
+  Timeout.tv_sec  = 0;
+  Timeout.tv_usec = 0;
+  return select (STDIN_FILENO + 1, &Set, NULL, NULL, &Timeout) > 0;
+}
+
+EFI_STATUS
+EFIAPI
+HostInputReset (
+  IN EFI_SIMPLE_TEXT_INPUT_PROTOCOL       *This,
+  IN BOOLEAN                              ExtendedVerification
+  )
+{
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostInputReadKey (
+  IN EFI_SIMPLE_TEXT_INPUT_PROTOCOL       *This,
+  OUT EFI_INPUT_KEY                       *Key
+  )
+{
+  int   Char;
+
+  if (!HostKeyReady ()) {
+    return EFI_NOT_READY;
+  }
+  Char = getchar ();
+  if (Char == EOF) {
+    //
+    // Whoever waits for a key, such as the debugger prompt, would wait for
+    // ever, so end the program there
+    //
+    fprintf (stderr, "\nEnd of the console input\n");
+    exit (EXIT_FAILURE);
+  }
+  Key->ScanCode    = SCAN_NULL;
+  Key->UnicodeChar = (Char == '\n') ? CHAR_CARRIAGE_RETURN : (CHAR16) Char;
+  if (Char == 0x7F) {
+    Key->UnicodeChar = CHAR_BACKSPACE;
+  }
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostTextReset (
+  IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL        *This,
+  IN BOOLEAN                                ExtendedVerification
+  )
+{
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostTextOutputString (
+  IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL        *This,
+  IN CHAR16                                 *String
+  )
+{
+  FILE  *Stream;
+
+  Stream = (This == gST->StdErr) ? stderr : stdout;
+  for (; *String != 0; String++) {
+    //
+    // The console sends CRLF, the host wants LF only. Write the rest as UTF-8.
+    //
+    if (*String == L'\r') {
+      continue;
+    }
+    if (*String < 0x80) {
+      fputc (*String, Stream);
+    } else if (*String < 0x800) {
+      fputc (0xC0 | (*String >> 6), Stream);
+      fputc (0x80 | (*String & 0x3F), Stream);
+    } else {
+      fputc (0xE0 | (*String >> 12), Stream);
+      fputc (0x80 | ((*String >> 6) & 0x3F), Stream);
+      fputc (0x80 | (*String & 0x3F), Stream);
+    }
+  }
+  fflush (Stream);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostTextTestString (
+  IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL        *This,
+  IN CHAR16                                 *String
+  )
+{
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostTextQueryMode (
+  IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL        *This,
+  IN UINTN                                  ModeNumber,
+  OUT UINTN                                 *Columns,
+  OUT UINTN                                 *Rows
+  )
+{
+  if (ModeNumber != 0) {
+    return EFI_UNSUPPORTED;
+  }
+  *Columns = 80;
+  *Rows    = 25;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostTextSetMode (
+  IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL        *This,
+  IN UINTN                                  ModeNumber
+  )
+{
+  return (ModeNumber == 0) ? EFI_SUCCESS : EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+HostTextSetAttribute (
+  IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL        *This,
+  IN UINTN                                  Attribute
+  )
+{
+  This->Mode->Attribute = (INT32) Attribute;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostTextClearScreen (
+  IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL        *This
+  )
+{
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostTextSetCursorPosition (
+  IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL        *This,
+  IN UINTN                                  Column,
+  IN UINTN                                  Row
+  )
+{
+  This->Mode->CursorColumn = (INT32) Column;
+  This->Mode->CursorRow    = (INT32) Row;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostTextEnableCursor (
+  IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL        *This,
+  IN BOOLEAN                                Visible
+  )
+{
+  This->Mode->CursorVisible = Visible;
+  return EFI_SUCCESS;
+}
+
+EFI_SIMPLE_TEXT_INPUT_PROTOCOL  mHostConIn = {
+  HostInputReset,
+  HostInputReadKey,
+  NULL
+};
+
+EFI_SIMPLE_TEXT_OUTPUT_MODE     mHostConOutMode = {
+  1,
+  0,
+  EFI_TEXT_ATTR (EFI_LIGHTGRAY, EFI_BACKGROUND_BLACK),
+  0,
+  0,
+  TRUE
+};
+
+EFI_SIMPLE_TEXT_OUTPUT_MODE     mHostStdErrMode = {
+  1,
+  0,
+  EFI_TEXT_ATTR (EFI_LIGHTGRAY, EFI_BACKGROUND_BLACK),
+  0,
+  0,
+  TRUE
+};
+
+EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL mHostConOut = {
+  HostTextReset,
+  HostTextOutputString,
+  HostTextTestString,
+  HostTextQueryMode,
+  HostTextSetMode,
+  HostTextSetAttribute,
+  HostTextClearScreen,
+  HostTextSetCursorPosition,
+  HostTextEnableCursor,
+  &mHostConOutMode
+};
+
+EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL mHostStdErr = {
+  HostTextReset,
+  HostTextOutputString,
+  HostTextTestString,
+  HostTextQueryMode,
+  HostTextSetMode,
+  HostTextSetAttribute,
+  HostTextClearScreen,
+  HostTextSetCursorPosition,
+  HostTextEnableCursor,
+  &mHostStdErrMode
+};
+
+//
+// Memory services
+//
+
+EFI_TPL
+EFIAPI
+HostRaiseTpl (
+  IN EFI_TPL      NewTpl
+  )
+{
+  EFI_TPL OldTpl;
+
+  OldTpl   = mHostTpl;
+  mHostTpl = NewTpl;
+  return OldTpl;
+}
+
+VOID
+EFIAPI
+HostRestoreTpl (
+  IN EFI_TPL      OldTpl
+  )
+{
+  mHostTpl = OldTpl;
+}
+
+EFI_STATUS
+EFIAPI
+HostAllocatePages (
+  IN     EFI_ALLOCATE_TYPE            Type,
+  IN     EFI_MEMORY_TYPE              MemoryType,
+  IN     UINTN                        Pages,
+  IN OUT EFI_PHYSICAL_ADDRESS         *Memory
+  )
+{
+  VOID  *Buffer;
+
+  if (Type != AllocateAnyPages) {
+    return EFI_UNSUPPORTED;
+  }
+  Buffer = AllocatePages (Pages);
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  *Memory = (EFI_PHYSICAL_ADDRESS) (UINTN) Buffer;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostFreePages (
+  IN  EFI_PHYSICAL_ADDRESS   Memory,
+  IN  UINTN                  Pages
+  )
+{
+  FreePages ((VOID *) (UINTN) Memory, Pages);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostGetMemoryMap (
+  IN OUT UINTN                       *MemoryMapSize,
+  IN OUT EFI_MEMORY_DESCRIPTOR       *MemoryMap,
+  OUT    UINTN                       *MapKey,
+  OUT    UINTN                       *DescriptorSize,
+  OUT    UINT32                      *DescriptorVersion
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+HostAllocatePool (
+  IN  EFI_MEMORY_TYPE              PoolType,
+  IN  UINTN                        Size,
+  OUT VOID                         **Buffer
+  )
+{
+  *Buffer = AllocatePool (Size);
+  return (*Buffer == NULL) ? EFI_OUT_OF_RESOURCES : EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostFreePoolService (
+  IN  VOID                         *Buffer
+  )
+{
+  FreePool (Buffer);
+  return EFI_SUCCESS;
+}
+
+//
+// Event services
+//
+
+/**
+  Check that an event is one of ours.
+
+  @param  Event         The event.
+
+  @return The event, or NULL if it is not valid.
+
+**/
+HOST_EVENT *
+HostGetEvent (
+  IN EFI_EVENT  Event
+  )
+{
+  HOST_EVENT  *HostEvent;
+
+  HostEvent = Event;
+  if ((HostEvent == NULL) || (HostEvent->Signature != HOST_EVENT_SIGNATURE)) {
+    return NULL;
+  }
+  return HostEvent;
+}
+
+/**
+  Signal an event whose timer is due, and set up the next period.
+
+  @param  HostEvent     The event.
+
+**/
+VOID
+HostCheckTimer (
+  IN HOST_EVENT *HostEvent
+  )
+{
+  UINT64  Now;
+
+  if (HostEvent->TimerType == TimerCancel) {
+    return;
+  }
+  Now = GetPerformanceCounter ();
+  if (Now < HostEvent->TimerDue) {
+    return;
+  }
+  HostEvent->Signaled = TRUE;
+  if (HostEvent->TimerType == TimerPeriodic) {
+    HostEvent->TimerDue = Now + HostEvent->TimerPeriod;
+  } else {
+    HostEvent->TimerType = TimerCancel;
+  }
+}
+
+EFI_STATUS
+EFIAPI
+HostCreateEvent (
+  IN  UINT32                       Type,
+  IN  EFI_TPL                      NotifyTpl,
+  IN  EFI_EVENT_NOTIFY             NotifyFunction,
+  IN  VOID                         *NotifyContext,
+  OUT EFI_EVENT                    *Event
+  )
+{
+  HOST_EVENT  *HostEvent;
+
+  if (Event == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  HostEvent = AllocateZeroPool (sizeof (HOST_EVENT));
+  if (HostEvent == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  HostEvent->Signature      = HOST_EVENT_SIGNATURE;
+  HostEvent->Type           = Type;
+  HostEvent->NotifyTpl      = NotifyTpl;
+  HostEvent->NotifyFunction = NotifyFunction;
+  HostEvent->NotifyContext  = NotifyContext;
+  HostEvent->TimerType      = TimerCancel;
+  *Event = HostEvent;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostCreateEventEx (
+  IN       UINT32                 Type,
+  IN       EFI_TPL                NotifyTpl,
+  IN       EFI_EVENT_NOTIFY       NotifyFunction OPTIONAL,
+  IN CONST VOID                   *NotifyContext OPTIONAL,
+  IN CONST EFI_GUID               *EventGroup    OPTIONAL,
+  OUT      EFI_EVENT              *Event
+  )
+{
+  //
+  // No event group is ever signaled on the host
+  //
+  return HostCreateEvent (Type, NotifyTpl, NotifyFunction, (VOID *) NotifyContext, Event);
+}
+
+EFI_STATUS
+EFIAPI
+HostSetTimer (
+  IN  EFI_EVENT                Event,
+  IN  EFI_TIMER_DELAY          Type,
+  IN  UINT64                   TriggerTime
+  )
+{
+  HOST_EVENT  *HostEvent;
+
+  HostEvent = HostGetEvent (Event);
+  if ((HostEvent == NULL) || ((HostEvent->Type & EVT_TIMER) == 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  //
+  // The trigger time is in units of 100ns, the performance counter in ns
+  //
+  HostEvent->TimerType   = Type;
+  HostEvent->TimerPeriod = TriggerTime * 100;
+  HostEvent->TimerDue    = GetPerformanceCounter () + HostEvent->TimerPeriod;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostSignalEvent (
+  IN  EFI_EVENT                Event
+  )
+{
+  HOST_EVENT  *HostEvent;
+
+  HostEvent = HostGetEvent (Event);
+  if (HostEvent == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  HostEvent->Signaled = TRUE;
+  if (((HostEvent->Type & EVT_NOTIFY_SIGNAL) != 0) && (HostEvent->NotifyFunction != NULL)) {
+    HostEvent->Signaled = FALSE;
+    HostEvent->NotifyFunction (Event, HostEvent->NotifyContext);
+  }
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostCloseEvent (
+  IN EFI_EVENT                Event
+  )
+{
+  HOST_EVENT  *HostEvent;
+
+  HostEvent = HostGetEvent (Event);
+  if (HostEvent == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  HostEvent->Signature = 0;
+  FreePool (HostEvent);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostCheckEvent (
+  IN EFI_EVENT                Event
+  )
+{
+  HOST_EVENT  *HostEvent;
+
+  if (Event == mHostConIn.WaitForKey) {
+    //
+    // The end of the input counts as a key, for ReadKeyStroke () to report
+    //
+    return HostKeyReady () ? EFI_SUCCESS : EFI_NOT_READY;
+  }
+
+  HostEvent = HostGetEvent (Event);
+  if ((HostEvent == NULL) || ((HostEvent->Type & EVT_NOTIFY_SIGNAL) != 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  HostCheckTimer (HostEvent);
+  if (!HostEvent->Signaled) {
+    if (HostEvent->NotifyFunction != NULL) {
+      HostEvent->NotifyFunction (Event, HostEvent->NotifyContext);
+    }
+    return EFI_NOT_READY;
+  }
+  HostEvent->Signaled = FALSE;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostWaitForEvent (
+  IN  UINTN                    NumberOfEvents,
+  IN  EFI_EVENT                *Event,
+  OUT UINTN                    *Index
+  )
+{
+  UINTN       EventIndex;
+  EFI_STATUS  Status;
+
+  if ((NumberOfEvents == 0) || (mHostTpl != TPL_APPLICATION)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  for (;;) {
+    for (EventIndex = 0; EventIndex < NumberOfEvents; EventIndex++) {
+      Status = HostCheckEvent (Event[EventIndex]);
+      if (Status != EFI_NOT_READY) {
+        *Index = EventIndex;
+        return Status;
+      }
+    }
+    MicroSecondDelay (HOST_WAIT_PERIOD);
+  }
+}
+
+//
+// Protocol services
+//
+
+/**
+  Check that a handle is one of ours.
+
+  @param  Handle        The handle.
+
+  @return The handle, or NULL if it is not valid.
+
+**/
+HOST_HANDLE *
+HostGetHandle (
+  IN EFI_HANDLE Handle
+  )
+{
+  HOST_HANDLE *HostHandle;
+
+  for (HostHandle = mHostHandleList; HostHandle != NULL; HostHandle = HostHandle->Next) {
+    if (HostHandle == Handle) {
+      return HostHandle;
+    }
+  }
+  return NULL;
+}
+
+/**
+  Find a protocol on a handle.
+
+  @param  HostHandle    The handle.
+  @param  Protocol      The GUID of the protocol.
+
+  @return The protocol entry, or NULL if the handle does not have it.
+
+**/
+HOST_PROTOCOL *
+HostFindProtocol (
+  IN HOST_HANDLE  *HostHandle,
+  IN EFI_GUID     *Protocol
+  )
+{
+  UINTN   Index;
+
+  for (Index = 0; Index < HostHandle->ProtocolCount; Index++) {
+    if (CompareGuid (&HostHandle->Protocol[Index].Guid, Protocol)) {
+      return &HostHandle->Protocol[Index];
+    }
+  }
+  return NULL;
+}
+
+EFI_STATUS
+EFIAPI
+HostInstallProtocolInterface (
+  IN OUT EFI_HANDLE               *Handle,
+  IN     EFI_GUID                 *Protocol,
+  IN     EFI_INTERFACE_TYPE       InterfaceType,
+  IN     VOID                     *Interface
+  )
+{
+  HOST_HANDLE   *HostHandle;
+
+  if ((Handle == NULL) || (Protocol == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (*Handle == NULL) {
+    HostHandle = AllocateZeroPool (sizeof (HOST_HANDLE));
+    if (HostHandle == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    HostHandle->Signature = HOST_HANDLE_SIGNATURE;
+    HostHandle->Next      = mHostHandleList;
+    mHostHandleList       = HostHandle;
+    *Handle               = HostHandle;
+  } else {
+    HostHandle = HostGetHandle (*Handle);
+    if (HostHandle == NULL) {
+      return EFI_INVALID_PARAMETER;
+    }
+    if (HostFindProtocol (HostHandle, Protocol) != NULL) {
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+  if (HostHandle->ProtocolCount == HOST_PROTOCOL_COUNT) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  CopyGuid (&HostHandle->Protocol[HostHandle->ProtocolCount].Guid, Protocol);
+  HostHandle->Protocol[HostHandle->ProtocolCount].Interface = Interface;
+  HostHandle->ProtocolCount++;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostReinstallProtocolInterface (
+  IN EFI_HANDLE               Handle,
+  IN EFI_GUID                 *Protocol,
+  IN VOID                     *OldInterface,
+  IN VOID                     *NewInterface
+  )
+{
+  HOST_HANDLE   *HostHandle;
+  HOST_PROTOCOL *Entry;
+
+  HostHandle = HostGetHandle (Handle);
+  if ((HostHandle == NULL) || (Protocol == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  Entry = HostFindProtocol (HostHandle, Protocol);
+  if ((Entry == NULL) || (Entry->Interface != OldInterface)) {
+    return EFI_NOT_FOUND;
+  }
+  Entry->Interface = NewInterface;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostUninstallProtocolInterface (
+  IN EFI_HANDLE               Handle,
+  IN EFI_GUID                 *Protocol,
+  IN VOID                     *Interface
+  )
+{
+  HOST_HANDLE   *HostHandle;
+  HOST_HANDLE   **Link;
+  HOST_PROTOCOL *Entry;
+
+  HostHandle = HostGetHandle (Handle);
+  if ((HostHandle == NULL) || (Protocol == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  Entry = HostFindProtocol (HostHandle, Protocol);
+  if ((Entry == NULL) || (Entry->Interface != Interface)) {
+    return EFI_NOT_FOUND;
+  }
+  HostHandle->ProtocolCount--;
+  *Entry = HostHandle->Protocol[HostHandle->ProtocolCount];
+
+  //
+  // A handle goes away with its last protocol
+  //
+  if (HostHandle->ProtocolCount == 0) {
+    for (Link = &mHostHandleList; *Link != HostHandle; Link = &(*Link)->Next) {
+    }
+    *Link = HostHandle->Next;
+    HostHandle->Signature = 0;
+    FreePool (HostHandle);
+  }
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostHandleProtocol (
+  IN  EFI_HANDLE               Handle,
+  IN  EFI_GUID                 *Protocol,
+  OUT VOID                     **Interface
+  )
+{
+  HOST_HANDLE   *HostHandle;
+  HOST_PROTOCOL *Entry;
+
+  if ((Protocol == NULL) || (Interface == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  *Interface = NULL;
+  HostHandle = HostGetHandle (Handle);
+  if (HostHandle == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  Entry = HostFindProtocol (HostHandle, Protocol);
+  if (Entry == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+  *Interface = Entry->Interface;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostRegisterProtocolNotify (
+  IN  EFI_GUID                 *Protocol,
+  IN  EFI_EVENT                Event,
+  OUT VOID                     **Registration
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+HostLocateHandle (
+  IN     EFI_LOCATE_SEARCH_TYPE   SearchType,
+  IN     EFI_GUID                 *Protocol,
+  IN     VOID                     *SearchKey,
+  IN OUT UINTN                    *BufferSize,
+  OUT    EFI_HANDLE               *Buffer
+  )
+{
+  HOST_HANDLE   *HostHandle;
+  UINTN         Count;
+
+  if ((BufferSize == NULL) || ((SearchType == ByProtocol) && (Protocol == NULL))) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (SearchType == ByRegisterNotify) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Count = 0;
+  for (HostHandle = mHostHandleList; HostHandle != NULL; HostHandle = HostHandle->Next) {
+    if ((SearchType == ByProtocol) && (HostFindProtocol (HostHandle, Protocol) == NULL)) {
+      continue;
+    }
+    if ((Buffer != NULL) && ((Count + 1) * sizeof (EFI_HANDLE) <= *BufferSize)) {
+      Buffer[Count] = HostHandle;
+    }
+    Count++;
+  }
+  if (Count == 0) {
+    return EFI_NOT_FOUND;
+  }
+  if (Count * sizeof (EFI_HANDLE) > *BufferSize) {
+    *BufferSize = Count * sizeof (EFI_HANDLE);
+    return EFI_BUFFER_TOO_SMALL;
+  }
+  *BufferSize = Count * sizeof (EFI_HANDLE);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostLocateHandleBuffer (
+  IN     EFI_LOCATE_SEARCH_TYPE       SearchType,
+  IN     EFI_GUID                     *Protocol,
+  IN     VOID                         *SearchKey,
+  IN OUT UINTN                        *NoHandles,
+  OUT    EFI_HANDLE                   **Buffer
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       BufferSize;
+
+  if ((NoHandles == NULL) || (Buffer == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  *NoHandles = 0;
+  *Buffer    = NULL;
+  BufferSize = 0;
+  Status = HostLocateHandle (SearchType, Protocol, SearchKey, &BufferSize, NULL);
+  if (Status != EFI_BUFFER_TOO_SMALL) {
+    return Status;
+  }
+  *Buffer = AllocatePool (BufferSize);
+  if (*Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Status = HostLocateHandle (SearchType, Protocol, SearchKey, &BufferSize, *Buffer);
+  *NoHandles = BufferSize / sizeof (EFI_HANDLE);
+  return Status;
+}
+
+EFI_STATUS
+EFIAPI
+HostLocateProtocol (
+  IN  EFI_GUID  *Protocol,
+  IN  VOID      *Registration OPTIONAL,
+  OUT VOID      **Interface
+  )
+{
+  HOST_HANDLE   *HostHandle;
+  HOST_PROTOCOL *Entry;
+
+  if ((Protocol == NULL) || (Interface == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  *Interface = NULL;
+  for (HostHandle = mHostHandleList; HostHandle != NULL; HostHandle = HostHandle->Next) {
+    Entry = HostFindProtocol (HostHandle, Protocol);
+    if (Entry != NULL) {
+      *Interface = Entry->Interface;
+      return EFI_SUCCESS;
+    }
+  }
+  return EFI_NOT_FOUND;
+}
+
+EFI_STATUS
+EFIAPI
+HostLocateDevicePath (
+  IN     EFI_GUID                         *Protocol,
+  IN OUT EFI_DEVICE_PATH_PROTOCOL         **DevicePath,
+  OUT    EFI_HANDLE                       *Device
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+EFI_STATUS
+EFIAPI
+HostOpenProtocol (
+  IN  EFI_HANDLE                Handle,
+  IN  EFI_GUID                  *Protocol,
+  OUT VOID                      **Interface OPTIONAL,
+  IN  EFI_HANDLE                AgentHandle,
+  IN  EFI_HANDLE                ControllerHandle,
+  IN  UINT32                    Attributes
+  )
+{
+  VOID        *Found;
+  EFI_STATUS  Status;
+
+  Status = HostHandleProtocol (Handle, Protocol, &Found);
+  if ((Interface != NULL) && (Attributes != EFI_OPEN_PROTOCOL_TEST_PROTOCOL)) {
+    *Interface = Found;
+  }
+  return Status;
+}
+
+EFI_STATUS
+EFIAPI
+HostCloseProtocol (
+  IN EFI_HANDLE               Handle,
+  IN EFI_GUID                 *Protocol,
+  IN EFI_HANDLE               AgentHandle,
+  IN EFI_HANDLE               ControllerHandle
+  )
+{
+  VOID  *Found;
+
+  return HostHandleProtocol (Handle, Protocol, &Found);
+}
+
+EFI_STATUS
+EFIAPI
+HostOpenProtocolInformation (
+  IN  EFI_HANDLE                          Handle,
+  IN  EFI_GUID                            *Protocol,
+  OUT EFI_OPEN_PROTOCOL_INFORMATION_ENTRY **EntryBuffer,
+  OUT UINTN                               *EntryCount
+  )
+{
+  //
+  // Nobody keeps a protocol open on the host
+  //
+  *EntryBuffer = NULL;
+  *EntryCount  = 0;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostProtocolsPerHandle (
+  IN  EFI_HANDLE      Handle,
+  OUT EFI_GUID        ***ProtocolBuffer,
+  OUT UINTN           *ProtocolBufferCount
+  )
+{
+  HOST_HANDLE   *HostHandle;
+  UINTN         Index;
+
+  HostHandle = HostGetHandle (Handle);
+  if ((HostHandle == NULL) || (ProtocolBuffer == NULL) || (ProtocolBufferCount == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  *ProtocolBuffer = AllocatePool (HostHandle->ProtocolCount * sizeof (EFI_GUID *));
+  if (*ProtocolBuffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  for (Index = 0; Index < HostHandle->ProtocolCount; Index++) {
+    (*ProtocolBuffer)[Index] = &HostHandle->Protocol[Index].Guid;
+  }
+  *ProtocolBufferCount = HostHandle->ProtocolCount;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostInstallMultipleProtocolInterfaces (
+  IN OUT EFI_HANDLE           *Handle,
+  ...
+  )
+{
+  VA_LIST     Marker;
+  EFI_GUID    *Protocol;
+  VOID        *Interface;
+  EFI_STATUS  Status;
+
+  Status = EFI_SUCCESS;
+  VA_START (Marker, Handle);
+  for (Protocol = VA_ARG (Marker, EFI_GUID *); Protocol != NULL; Protocol = VA_ARG (Marker, EFI_GUID *)) {
+    Interface = VA_ARG (Marker, VOID *);
+    Status    = HostInstallProtocolInterface (Handle, Protocol, EFI_NATIVE_INTERFACE, Interface);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+  }
+  VA_END (Marker);
+  return Status;
+}
+
+EFI_STATUS
+EFIAPI
+HostUninstallMultipleProtocolInterfaces (
+  IN EFI_HANDLE           Handle,
+  ...
+  )
+{
+  VA_LIST     Marker;
+  EFI_GUID    *Protocol;
+  VOID        *Interface;
+  EFI_STATUS  Status;
+
+  Status = EFI_SUCCESS;
+  VA_START (Marker, Handle);
+  for (Protocol = VA_ARG (Marker, EFI_GUID *); Protocol != NULL; Protocol = VA_ARG (Marker, EFI_GUID *)) {
+    Interface = VA_ARG (Marker, VOID *);
+    Status    = HostUninstallProtocolInterface (Handle, Protocol, Interface);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+  }
+  VA_END (Marker);
+  return Status;
+}
+
+EFI_STATUS
+EFIAPI
+HostInstallConfigurationTable (
+  IN EFI_GUID *Guid,
+  IN VOID     *Table
+  )
+{
+  UINTN   Index;
+
+  for (Index = 0; Index < gST->NumberOfTableEntries; Index++) {
+    if (CompareGuid (Guid, &mHostConfigurationTable[Index].VendorGuid)) {
+      break;
+    }
+  }
+  if (Table == NULL) {
+    if (Index == gST->NumberOfTableEntries) {
+      return EFI_NOT_FOUND;
+    }
+    gST->NumberOfTableEntries--;
+    mHostConfigurationTable[Index] = mHostConfigurationTable[gST->NumberOfTableEntries];
+    return EFI_SUCCESS;
+  }
+  if (Index == HOST_TABLE_COUNT) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  if (Index == gST->NumberOfTableEntries) {
+    CopyGuid (&mHostConfigurationTable[Index].VendorGuid, Guid);
+    gST->NumberOfTableEntries++;
+  }
+  mHostConfigurationTable[Index].VendorTable = Table;
+  return EFI_SUCCESS;
+}
+
+//
+// Image services, see HostImage.c for the others
+//
+
+EFI_STATUS
+EFIAPI
+HostExit (
+  IN  EFI_HANDLE                   ImageHandle,
+  IN  EFI_STATUS                   ExitStatus,
+  IN  UINTN                        ExitDataSize,
+  IN  CHAR16                       *ExitData     OPTIONAL
+  )
+{
+  exit (EFI_ERROR (ExitStatus) ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+EFI_STATUS
+EFIAPI
+HostExitBootServices (
+  IN  EFI_HANDLE                   ImageHandle,
+  IN  UINTN                        MapKey
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+//
+// Miscellaneous services
+//
+
+EFI_STATUS
+EFIAPI
+HostGetNextMonotonicCount (
+  OUT UINT64                  *Count
+  )
+{
+  *Count = mHostMonotonicCount++;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostStall (
+  IN  UINTN                    Microseconds
+  )
+{
+  MicroSecondDelay (Microseconds);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostSetWatchdogTimer (
+  IN UINTN                    Timeout,
+  IN UINT64                   WatchdogCode,
+  IN UINTN                    DataSize,
+  IN CHAR16                   *WatchdogData OPTIONAL
+  )
+{
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostConnectController (
+  IN  EFI_HANDLE                    ControllerHandle,
+  IN  EFI_HANDLE                    *DriverImageHandle,   OPTIONAL
+  IN  EFI_DEVICE_PATH_PROTOCOL      *RemainingDevicePath, OPTIONAL
+  IN  BOOLEAN                       Recursive
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+EFI_STATUS
+EFIAPI
+HostDisconnectController (
+  IN  EFI_HANDLE                     ControllerHandle,
+  IN  EFI_HANDLE                     DriverImageHandle, OPTIONAL
+  IN  EFI_HANDLE                     ChildHandle        OPTIONAL
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+EFI_STATUS
+EFIAPI
+HostCalculateCrc32 (
+  IN  VOID                              *Data,
+  IN  UINTN                             DataSize,
+  OUT UINT32                            *Crc32
+  )
+{
+  UINT32  Crc;
+  UINT8   *Byte;
+  UINTN   Bit;
+
+  if ((Data == NULL) || (DataSize == 0) || (Crc32 == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  Crc = 0xFFFFFFFF;
+  for (Byte = Data; DataSize > 0; DataSize--, Byte++) {
+    Crc ^= *Byte;
+    for (Bit = 0; Bit < 8; Bit++) {
+      Crc = (Crc >> 1) ^ (0xEDB88320 & (0 - (Crc & 1)));
+    }
+  }
+  *Crc32 = ~Crc;
+  return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+HostCopyMem (
+  IN VOID     *Destination,
+  IN VOID     *Source,
+  IN UINTN    Length
+  )
+{
+  CopyMem (Destination, Source, Length);
+}
+
+VOID
+EFIAPI
+HostSetMem (
+  IN VOID     *Buffer,
+  IN UINTN    Size,
+  IN UINT8    Value
+  )
+{
+  SetMem (Buffer, Size, Value);
+}
+
+//
+// Runtime services
+//
+
+EFI_STATUS
+EFIAPI
+HostGetTime (
+  OUT  EFI_TIME                    *Time,
+  OUT  EFI_TIME_CAPABILITIES       *Capabilities OPTIONAL
+  )
+{
+  struct timespec Now;
+  struct tm       Local;
+
+  if (Time == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  clock_gettime (CLOCK_REALTIME, &Now);
+  localtime_r (&Now.tv_sec, &Local);
+  ZeroMem (Time, sizeof (EFI_TIME));
+  Time->Year       = (UINT16) (Local.tm_year + 1900);
+  Time->Month      = (UINT8) (Local.tm_mon + 1);
+  Time->Day        = (UINT8) Local.tm_mday;
+  Time->Hour       = (UINT8) Local.tm_hour;
+  Time->Minute     = (UINT8) Local.tm_min;
+  Time->Second     = (UINT8) Local.tm_sec;
+  Time->Nanosecond = (UINT32) Now.tv_nsec;
+  Time->TimeZone   = 0x07FF;
+  if (Capabilities != NULL) {
+    Capabilities->Resolution = 1;
+    Capabilities->Accuracy   = 0;
+    Capabilities->SetsToZero = FALSE;
+  }
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostSetTime (
+  IN  EFI_TIME                     *Time
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+HostGetWakeupTime (
+  OUT BOOLEAN                     *Enabled,
+  OUT BOOLEAN                     *Pending,
+  OUT EFI_TIME                    *Time
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+HostSetWakeupTime (
+  IN  BOOLEAN                      Enable,
+  IN  EFI_TIME                     *Time   OPTIONAL
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+HostSetVirtualAddressMap (
+  IN  UINTN                        MemoryMapSize,
+  IN  UINTN                        DescriptorSize,
+  IN  UINT32                       DescriptorVersion,
+  IN  EFI_MEMORY_DESCRIPTOR        *VirtualMap
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+HostConvertPointer (
+  IN     UINTN                      DebugDisposition,
+  IN OUT VOID                       **Address
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+HostGetVariable (
+  IN     CHAR16                      *VariableName,
+  IN     EFI_GUID                    *VendorGuid,
+  OUT    UINT32                      *Attributes,    OPTIONAL
+  IN OUT UINTN                       *DataSize,
+  OUT    VOID                        *Data           OPTIONAL
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+EFI_STATUS
+EFIAPI
+HostGetNextVariableName (
+  IN OUT UINTN                    *VariableNameSize,
+  IN OUT CHAR16                   *VariableName,
+  IN OUT EFI_GUID                 *VendorGuid
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+EFI_STATUS
+EFIAPI
+HostSetVariable (
+  IN  CHAR16                       *VariableName,
+  IN  EFI_GUID                     *VendorGuid,
+  IN  UINT32                       Attributes,
+  IN  UINTN                        DataSize,
+  IN  VOID                         *Data
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+HostGetNextHighMonotonicCount (
+  OUT UINT32                  *HighCount
+  )
+{
+  mHostMonotonicCount = (UINT64) ((mHostMonotonicCount >> 32) + 1) << 32;
+  *HighCount = (UINT32) (mHostMonotonicCount >> 32);
+  return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+HostResetSystem (
+  IN EFI_RESET_TYPE           ResetType,
+  IN EFI_STATUS               ResetStatus,
+  IN UINTN                    DataSize,
+  IN VOID                     *ResetData OPTIONAL
+  )
+{
+  exit (EFI_ERROR (ResetStatus) ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+EFI_STATUS
+EFIAPI
+HostUpdateCapsule (
+  IN VOID                 **CapsuleHeaderArray,
+  IN UINTN                CapsuleCount,
+  IN EFI_PHYSICAL_ADDRESS ScatterGatherList   OPTIONAL
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+HostQueryCapsuleCapabilities (
+  IN  VOID                 **CapsuleHeaderArray,
+  IN  UINTN                CapsuleCount,
+  OUT UINT64               *MaximumCapsuleSize,
+  OUT EFI_RESET_TYPE       *ResetType
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+HostQueryVariableInfo (
+  IN  UINT32            Attributes,
+  OUT UINT64            *MaximumVariableStorageSize,
+  OUT UINT64            *RemainingVariableStorageSize,
+  OUT UINT64            *MaximumVariableSize
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+//
+// File system over the current directory
+//
+
+EFI_STATUS EFIAPI HostFileOpen (IN EFI_FILE_PROTOCOL *This, OUT EFI_FILE_PROTOCOL **NewHandle, IN CHAR16 *FileName, IN UINT64 OpenMode, IN UINT64 Attributes);
+EFI_STATUS EFIAPI HostFileClose (IN EFI_FILE_PROTOCOL *This);
+EFI_STATUS EFIAPI HostFileDelete (IN EFI_FILE_PROTOCOL *This);
+EFI_STATUS EFIAPI HostFileRead (IN EFI_FILE_PROTOCOL *This, IN OUT UINTN *BufferSize, OUT VOID *Buffer);
+EFI_STATUS EFIAPI HostFileWrite (IN EFI_FILE_PROTOCOL *This, IN OUT UINTN *BufferSize, IN VOID *Buffer);
+EFI_STATUS EFIAPI HostFileGetPosition (IN EFI_FILE_PROTOCOL *This, OUT UINT64 *Position);
+EFI_STATUS EFIAPI HostFileSetPosition (IN EFI_FILE_PROTOCOL *This, IN UINT64 Position);
+EFI_STATUS EFIAPI HostFileGetInfo (IN EFI_FILE_PROTOCOL *This, IN EFI_GUID *InformationType, IN OUT UINTN *BufferSize, OUT VOID *Buffer);
+EFI_STATUS EFIAPI HostFileSetInfo (IN EFI_FILE_PROTOCOL *This, IN EFI_GUID *InformationType, IN UINTN BufferSize, IN VOID *Buffer);
+EFI_STATUS EFIAPI HostFileFlush (IN EFI_FILE_PROTOCOL *This);
+
+EFI_FILE_PROTOCOL mHostFileTemplate = {
+  0x00010000,
+  HostFileOpen,
+  HostFileClose,
+  HostFileDelete,
+  HostFileRead,
+  HostFileWrite,
+  HostFileGetPosition,
+  HostFileSetPosition,
+  HostFileGetInfo,
+  HostFileSetInfo,
+  HostFileFlush
+};
+
+/**
+  Create a file handle.
+
+  @param  Path          The host path of the file, which the handle takes.
+  @param  Stream        The stream of the file, or NULL for a directory.
+
+  @return The file handle, or NULL if out of resources.
+
+**/
+HOST_FILE *
+HostCreateFile (
+  IN CHAR8  *Path,
+  IN FILE   *Stream
+  )
+{
+  HOST_FILE   *File;
+
+  File = AllocateZeroPool (sizeof (HOST_FILE));
+  if (File == NULL) {
+    return NULL;
+  }
+  CopyMem (&File->File, &mHostFileTemplate, sizeof (EFI_FILE_PROTOCOL));
+  File->Signature = HOST_FILE_SIGNATURE;
+  File->Path      = Path;
+  File->Stream    = Stream;
+  return File;
+}
+
+EFI_STATUS
+EFIAPI
+HostOpenVolume (
+  IN  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL     *This,
+  OUT EFI_FILE_PROTOCOL                   **Root
+  )
+{
+  HOST_FILE   *File;
+  CHAR8       *Path;
+
+  Path = AllocateCopyPool (sizeof ("."), ".");
+  if (Path == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  File = HostCreateFile (Path, NULL);
+  if (File == NULL) {
+    FreePool (Path);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  *Root = &File->File;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostFileOpen (
+  IN  EFI_FILE_PROTOCOL   *This,
+  OUT EFI_FILE_PROTOCOL   **NewHandle,
+  IN  CHAR16              *FileName,
+  IN  UINT64              OpenMode,
+  IN  UINT64              Attributes
+  )
+{
+  HOST_FILE   *Parent;
+  HOST_FILE   *File;
+  CHAR8       *Path;
+  UINTN       Length;
+  UINTN       Index;
+  struct stat Info;
+  FILE        *Stream;
+  CONST CHAR8 *Mode;
+
+  Parent = HOST_FILE_FROM_THIS (This);
+
+  //
+  // Paths are relative to the parent, unless they start with a backslash,
+  // and only ASCII names are supported
+  //
+  if (*FileName == L'\\') {
+    FileName++;
+    Parent = NULL;
+  }
+  Length = ((Parent != NULL) ? AsciiStrLen (Parent->Path) : 1) + 1 + StrLen (FileName) + 1;
+  Path   = AllocatePool (Length);
+  if (Path == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  AsciiStrCpyS (Path, Length, (Parent != NULL) ? Parent->Path : ".");
+  Index = AsciiStrLen (Path);
+  Path[Index++] = '/';
+  for (; *FileName != 0; FileName++) {
+    if (*FileName >= 0x80) {
+      FreePool (Path);
+      return EFI_NOT_FOUND;
+    }
+    Path[Index++] = (*FileName == L'\\') ? '/' : (CHAR8) *FileName;
+  }
+  Path[Index] = 0;
+
+  if ((stat (Path, &Info) == 0) && S_ISDIR (Info.st_mode)) {
+    Stream = NULL;
+  } else {
+    if ((OpenMode & EFI_FILE_MODE_CREATE) != 0) {
+      Mode = (access (Path, F_OK) == 0) ? "r+b" : "w+b";
+    } else if ((OpenMode & EFI_FILE_MODE_WRITE) != 0) {
+      Mode = "r+b";
+    } else {
+      Mode = "rb";
+    }
+    Stream = fopen (Path, Mode);
+    if (Stream == NULL) {
+      FreePool (Path);
+      return EFI_NOT_FOUND;
+    }
+  }
+
+  File = HostCreateFile (Path, Stream);
+  if (File == NULL) {
+    if (Stream != NULL) {
+      fclose (Stream);
+    }
+    FreePool (Path);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  *NewHandle = &File->File;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostFileClose (
+  IN EFI_FILE_PROTOCOL  *This
+  )
+{
+  HOST_FILE   *File;
+
+  File = HOST_FILE_FROM_THIS (This);
+  if (File->Stream != NULL) {
+    fclose (File->Stream);
+  }
+  FreePool (File->Path);
+  File->Signature = 0;
+  FreePool (File);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostFileDelete (
+  IN EFI_FILE_PROTOCOL  *This
+  )
+{
+  HOST_FILE   *File;
+  int         Result;
+
+  File = HOST_FILE_FROM_THIS (This);
+  Result = remove (File->Path);
+  HostFileClose (This);
+  return (Result == 0) ? EFI_SUCCESS : EFI_WARN_DELETE_FAILURE;
+}
+
+EFI_STATUS
+EFIAPI
+HostFileRead (
+  IN     EFI_FILE_PROTOCOL  *This,
+  IN OUT UINTN              *BufferSize,
+  OUT    VOID               *Buffer
+  )
+{
+  HOST_FILE   *File;
+
+  File = HOST_FILE_FROM_THIS (This);
+  if (File->Stream == NULL) {
+    //
+    // Directories cannot be listed
+    //
+    return EFI_UNSUPPORTED;
+  }
+  *BufferSize = fread (Buffer, 1, *BufferSize, File->Stream);
+  return ferror (File->Stream) ? EFI_DEVICE_ERROR : EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostFileWrite (
+  IN     EFI_FILE_PROTOCOL  *This,
+  IN OUT UINTN              *BufferSize,
+  IN     VOID               *Buffer
+  )
+{
+  HOST_FILE   *File;
+
+  File = HOST_FILE_FROM_THIS (This);
+  if (File->Stream == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+  *BufferSize = fwrite (Buffer, 1, *BufferSize, File->Stream);
+  return ferror (File->Stream) ? EFI_DEVICE_ERROR : EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostFileGetPosition (
+  IN  EFI_FILE_PROTOCOL   *This,
+  OUT UINT64              *Position
+  )
+{
+  HOST_FILE   *File;
+
+  File = HOST_FILE_FROM_THIS (This);
+  if (File->Stream == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+  *Position = (UINT64) ftell (File->Stream);
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostFileSetPosition (
+  IN EFI_FILE_PROTOCOL  *This,
+  IN UINT64             Position
+  )
+{
+  HOST_FILE   *File;
+  int         Result;
+
+  File = HOST_FILE_FROM_THIS (This);
+  if (File->Stream == NULL) {
+    return (Position == 0) ? EFI_SUCCESS : EFI_UNSUPPORTED;
+  }
+  if (Position == MAX_UINT64) {
+    Result = fseek (File->Stream, 0, SEEK_END);
+  } else {
+    Result = fseek (File->Stream, (long) Position, SEEK_SET);
+  }
+  return (Result == 0) ? EFI_SUCCESS : EFI_DEVICE_ERROR;
+}
+
+EFI_STATUS
+EFIAPI
+HostFileGetInfo (
+  IN     EFI_FILE_PROTOCOL  *This,
+  IN     EFI_GUID           *InformationType,
+  IN OUT UINTN              *BufferSize,
+  OUT    VOID               *Buffer
+  )
+{
+  HOST_FILE     *File;
+  EFI_FILE_INFO *FileInfo;
+  CHAR8         *Name;
+  UINTN         Size;
+  UINTN         Index;
+  struct stat   Info;
+
+  File = HOST_FILE_FROM_THIS (This);
+  if (!CompareGuid (InformationType, &gEfiFileInfoGuid)) {
+    return EFI_UNSUPPORTED;
+  }
+  if (stat (File->Path, &Info) != 0) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  Name = strrchr (File->Path, '/');
+  Name = (Name != NULL) ? Name + 1 : File->Path;
+  Size = SIZE_OF_EFI_FILE_INFO + (AsciiStrLen (Name) + 1) * sizeof (CHAR16);
+  if (*BufferSize < Size) {
+    *BufferSize = Size;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+  *BufferSize = Size;
+
+  FileInfo = Buffer;
+  ZeroMem (FileInfo, Size);
+  FileInfo->Size         = Size;
+  FileInfo->FileSize     = (UINT64) Info.st_size;
+  FileInfo->PhysicalSize = (UINT64) Info.st_size;
+  if (S_ISDIR (Info.st_mode)) {
+    FileInfo->Attribute |= EFI_FILE_DIRECTORY;
+  }
+  if (access (File->Path, W_OK) != 0) {
+    FileInfo->Attribute |= EFI_FILE_READ_ONLY;
+  }
+  for (Index = 0; Name[Index] != 0; Index++) {
+    FileInfo->FileName[Index] = (CHAR16) (UINT8) Name[Index];
+  }
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+HostFileSetInfo (
+  IN EFI_FILE_PROTOCOL  *This,
+  IN EFI_GUID           *InformationType,
+  IN UINTN              BufferSize,
+  IN VOID               *Buffer
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS
+EFIAPI
+HostFileFlush (
+  IN EFI_FILE_PROTOCOL  *This
+  )
+{
+  HOST_FILE   *File;
+
+  File = HOST_FILE_FROM_THIS (This);
+  if (File->Stream != NULL) {
+    fflush (File->Stream);
+  }
+  return EFI_SUCCESS;
+}
+
+EFI_SIMPLE_FILE_SYSTEM_PROTOCOL mHostFileSystem = {
+  0x00010000,
+  HostOpenVolume
+};
+
+//
+// The tables
+//
+
+EFI_BOOT_SERVICES mHostBootServices = {
+  {
+    EFI_BOOT_SERVICES_SIGNATURE,
+    EFI_SPECIFICATION_VERSION,
+    sizeof (EFI_BOOT_SERVICES),
+    0,
+    0
+  },
+  HostRaiseTpl,
+  HostRestoreTpl,
+  HostAllocatePages,
+  HostFreePages,
+  HostGetMemoryMap,
+  HostAllocatePool,
+  HostFreePoolService,
+  HostCreateEvent,
+  HostSetTimer,
+  HostWaitForEvent,
+  HostSignalEvent,
+  HostCloseEvent,
+  HostCheckEvent,
+  HostInstallProtocolInterface,
+  HostReinstallProtocolInterface,
+  HostUninstallProtocolInterface,
+  HostHandleProtocol,
+  NULL,
+  HostRegisterProtocolNotify,
+  HostLocateHandle,
+  HostLocateDevicePath,
+  HostInstallConfigurationTable,
+  HostLoadImage,
+  HostStartImage,
+  HostExit,
+  HostUnloadImage,
+  HostExitBootServices,
+  HostGetNextMonotonicCount,
+  HostStall,
+  HostSetWatchdogTimer,
+  HostConnectController,
+  HostDisconnectController,
+  HostOpenProtocol,
+  HostCloseProtocol,
+  HostOpenProtocolInformation,
+  HostProtocolsPerHandle,
+  HostLocateHandleBuffer,
+  HostLocateProtocol,
+  HostInstallMultipleProtocolInterfaces,
+  HostUninstallMultipleProtocolInterfaces,
+  HostCalculateCrc32,
+  HostCopyMem,
+  HostSetMem,
+  HostCreateEventEx
+};
+
+EFI_RUNTIME_SERVICES mHostRuntimeServices = {
+  {
+    EFI_RUNTIME_SERVICES_SIGNATURE,
+    EFI_SPECIFICATION_VERSION,
+    sizeof (EFI_RUNTIME_SERVICES),
+    0,
+    0
+  },
+  HostGetTime,
+  HostSetTime,
+  HostGetWakeupTime,
+  HostSetWakeupTime,
+  HostSetVirtualAddressMap,
+  HostConvertPointer,
+  HostGetVariable,
+  HostGetNextVariableName,
+  HostSetVariable,
+  HostGetNextHighMonotonicCount,
+  HostResetSystem,
+  HostUpdateCapsule,
+  HostQueryCapsuleCapabilities,
+  HostQueryVariableInfo
+};
+
+EFI_SYSTEM_TABLE mHostSystemTable = {
+  {
+    EFI_SYSTEM_TABLE_SIGNATURE,
+    EFI_SPECIFICATION_VERSION,
+    sizeof (EFI_SYSTEM_TABLE),
+    0,
+    0
+  },
+  L"EbcDebugger host",
+  0x00010000,
+  NULL,
+  &mHostConIn,
+  NULL,
+  &mHostConOut,
+  NULL,
+  &mHostStdErr,
+  &mHostRuntimeServices,
+  &mHostBootServices,
+  0,
+  mHostConfigurationTable
+};
+
+EFI_HANDLE            gImageHandle;
+EFI_SYSTEM_TABLE      *gST = &mHostSystemTable;
+EFI_BOOT_SERVICES     *gBS = &mHostBootServices;
+EFI_RUNTIME_SERVICES  *gRT = &mHostRuntimeServices;
+
+EFI_STATUS
+HostInitServices (
+  OUT EFI_HANDLE  *ImageHandle
+  )
+{
+  EFI_STATUS                Status;
+  EFI_LOADED_IMAGE_PROTOCOL *LoadedImage;
+
+  if (mHostConIn.WaitForKey == NULL) {
+    Status = HostCreateEvent (EVT_NOTIFY_WAIT, TPL_NOTIFY, NULL, NULL, &mHostConIn.WaitForKey);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    HostCalculateCrc32 (&mHostBootServices, sizeof (mHostBootServices), &mHostBootServices.Hdr.CRC32);
+    HostCalculateCrc32 (&mHostRuntimeServices, sizeof (mHostRuntimeServices), &mHostRuntimeServices.Hdr.CRC32);
+    HostCalculateCrc32 (&mHostSystemTable, sizeof (mHostSystemTable), &mHostSystemTable.Hdr.CRC32);
+
+    Status = HostInstallProtocolInterface (
+               &mHostFileSystemHandle,
+               &gEfiSimpleFileSystemProtocolGuid,
+               EFI_NATIVE_INTERFACE,
+               &mHostFileSystem
+               );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  //
+  // The images live on the file system of the current directory
+  //
+  LoadedImage = AllocateZeroPool (sizeof (EFI_LOADED_IMAGE_PROTOCOL));
+  if (LoadedImage == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  LoadedImage->Revision      = EFI_LOADED_IMAGE_PROTOCOL_REVISION;
+  LoadedImage->SystemTable   = gST;
+  LoadedImage->DeviceHandle  = mHostFileSystemHandle;
+  LoadedImage->ImageCodeType = EfiLoaderCode;
+  LoadedImage->ImageDataType = EfiLoaderData;
+
+  *ImageHandle = NULL;
+  Status = HostInstallProtocolInterface (
+             ImageHandle,
+             &gEfiLoadedImageProtocolGuid,
+             EFI_NATIVE_INTERFACE,
+             LoadedImage
+             );
+  if (EFI_ERROR (Status)) {
+    FreePool (LoadedImage);
+  }
+  return Status;
+}
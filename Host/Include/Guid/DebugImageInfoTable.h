@@ -0,0 +1,48 @@
+/** @file
+  Debug image information table, for the host build.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __HOST_DEBUG_IMAGE_INFO_TABLE_H__
+#define __HOST_DEBUG_IMAGE_INFO_TABLE_H__
+
+#include <Protocol/LoadedImage.h>
+
+#define EFI_DEBUG_IMAGE_INFO_TABLE_GUID \
+  { \
+    0x49152E77, 0x1ADA, 0x4764, {0xB7, 0xA2, 0x7A, 0xFE, 0xFE, 0xD9, 0x5E, 0x8B } \
+  }
+
+#define EFI_DEBUG_IMAGE_INFO_UPDATE_IN_PROGRESS 0x01
+#define EFI_DEBUG_IMAGE_INFO_TABLE_MODIFIED     0x02
+#define EFI_DEBUG_IMAGE_INFO_TYPE_NORMAL        0x01
+
+typedef struct {
+  UINT32                     ImageInfoType;
+  EFI_LOADED_IMAGE_PROTOCOL  *LoadedImageProtocolInstance;
+  EFI_HANDLE                 ImageHandle;
+} EFI_DEBUG_IMAGE_INFO_NORMAL;
+
+typedef union {
+  UINT32                       *ImageInfoType;
+  EFI_DEBUG_IMAGE_INFO_NORMAL  *NormalImage;
+} EFI_DEBUG_IMAGE_INFO;
+
+typedef struct {
+  volatile UINT32       UpdateStatus;
+  UINT32                TableSize;
+  EFI_DEBUG_IMAGE_INFO  *EfiDebugImageInfoTable;
+} EFI_DEBUG_IMAGE_INFO_TABLE_HEADER;
+
+extern EFI_GUID gEfiDebugImageInfoTableGuid;
+
+#endif
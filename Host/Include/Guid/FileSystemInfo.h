@@ -0,0 +1,34 @@
+/** @file
+  File system information GUID and structure, for the host build.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __HOST_FILE_SYSTEM_INFO_H__
+#define __HOST_FILE_SYSTEM_INFO_H__
+
+#define EFI_FILE_SYSTEM_INFO_ID \
+  { \
+    0x09576E93, 0x6D3F, 0x11D2, {0x8E, 0x39, 0x00, 0xA0, 0xC9, 0x69, 0x72, 0x3B } \
+  }
+
+typedef struct {
+  UINT64  Size;
+  BOOLEAN ReadOnly;
+  UINT64  VolumeSize;
+  UINT64  FreeSpace;
+  UINT32  BlockSize;
+  CHAR16  VolumeLabel[1];
+} EFI_FILE_SYSTEM_INFO;
+
+extern EFI_GUID gEfiFileSystemInfoGuid;
+
+#endif
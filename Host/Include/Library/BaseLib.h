@@ -0,0 +1,66 @@
+/** @file
+  String, math and processor functions of the BaseLib class, for the host
+  build. They are implemented over libc in Host/HostLib.c.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __HOST_BASE_LIB_H__
+#define __HOST_BASE_LIB_H__
+
+//
+// Strings
+//
+UINTN   EFIAPI StrLen (IN CONST CHAR16 *String);
+UINTN   EFIAPI StrSize (IN CONST CHAR16 *String);
+INTN    EFIAPI StrCmp (IN CONST CHAR16 *FirstString, IN CONST CHAR16 *SecondString);
+INTN    EFIAPI StrnCmp (IN CONST CHAR16 *FirstString, IN CONST CHAR16 *SecondString, IN UINTN Length);
+RETURN_STATUS EFIAPI StrCpyS (OUT CHAR16 *Destination, IN UINTN DestMax, IN CONST CHAR16 *Source);
+RETURN_STATUS EFIAPI StrnCpyS (OUT CHAR16 *Destination, IN UINTN DestMax, IN CONST CHAR16 *Source, IN UINTN Length);
+RETURN_STATUS EFIAPI StrCatS (IN OUT CHAR16 *Destination, IN UINTN DestMax, IN CONST CHAR16 *Source);
+RETURN_STATUS EFIAPI StrnCatS (IN OUT CHAR16 *Destination, IN UINTN DestMax, IN CONST CHAR16 *Source, IN UINTN Length);
+UINTN   EFIAPI AsciiStrLen (IN CONST CHAR8 *String);
+UINTN   EFIAPI AsciiStrSize (IN CONST CHAR8 *String);
+INTN    EFIAPI AsciiStrCmp (IN CONST CHAR8 *FirstString, IN CONST CHAR8 *SecondString);
+INTN    EFIAPI AsciiStrnCmp (IN CONST CHAR8 *FirstString, IN CONST CHAR8 *SecondString, IN UINTN Length);
+INTN    EFIAPI AsciiStriCmp (IN CONST CHAR8 *FirstString, IN CONST CHAR8 *SecondString);
+RETURN_STATUS EFIAPI AsciiStrCpyS (OUT CHAR8 *Destination, IN UINTN DestMax, IN CONST CHAR8 *Source);
+RETURN_STATUS EFIAPI AsciiStrnCpyS (OUT CHAR8 *Destination, IN UINTN DestMax, IN CONST CHAR8 *Source, IN UINTN Length);
+
+//
+// Math
+//
+UINT64  EFIAPI LShiftU64 (IN UINT64 Operand, IN UINTN Count);
+UINT64  EFIAPI RShiftU64 (IN UINT64 Operand, IN UINTN Count);
+UINT64  EFIAPI ARShiftU64 (IN UINT64 Operand, IN UINTN Count);
+UINT64  EFIAPI MultU64x32 (IN UINT64 Multiplicand, IN UINT32 Multiplier);
+UINT64  EFIAPI MultU64x64 (IN UINT64 Multiplicand, IN UINT64 Multiplier);
+INT64   EFIAPI MultS64x64 (IN INT64 Multiplicand, IN INT64 Multiplier);
+UINT64  EFIAPI DivU64x32 (IN UINT64 Dividend, IN UINT32 Divisor);
+UINT64  EFIAPI DivU64x32Remainder (IN UINT64 Dividend, IN UINT32 Divisor, OUT UINT32 *Remainder OPTIONAL);
+UINT64  EFIAPI DivU64x64Remainder (IN UINT64 Dividend, IN UINT64 Divisor, OUT UINT64 *Remainder OPTIONAL);
+INT64   EFIAPI DivS64x64Remainder (IN INT64 Dividend, IN INT64 Divisor, OUT INT64 *Remainder OPTIONAL);
+UINT32  EFIAPI ModU64x32 (IN UINT64 Dividend, IN UINT32 Divisor);
+INTN    EFIAPI HighBitSet32 (IN UINT32 Operand);
+INTN    EFIAPI HighBitSet64 (IN UINT64 Operand);
+UINT16  EFIAPI SwapBytes16 (IN UINT16 Value);
+UINT32  EFIAPI SwapBytes32 (IN UINT32 Value);
+UINT64  EFIAPI SwapBytes64 (IN UINT64 Value);
+
+//
+// Processor
+//
+VOID    EFIAPI MemoryFence (VOID);
+VOID    EFIAPI CpuBreakpoint (VOID);
+VOID    EFIAPI CpuDeadLoop (VOID);
+VOID    EFIAPI CpuPause (VOID);
+
+#endif
@@ -0,0 +1,28 @@
+/** @file
+  Memory functions of the BaseMemoryLib class, for the host build.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __HOST_BASE_MEMORY_LIB_H__
+#define __HOST_BASE_MEMORY_LIB_H__
+
+VOID *  EFIAPI CopyMem (OUT VOID *DestinationBuffer, IN CONST VOID *SourceBuffer, IN UINTN Length);
+VOID *  EFIAPI SetMem (OUT VOID *Buffer, IN UINTN Length, IN UINT8 Value);
+VOID *  EFIAPI SetMem16 (OUT VOID *Buffer, IN UINTN Length, IN UINT16 Value);
+VOID *  EFIAPI SetMem32 (OUT VOID *Buffer, IN UINTN Length, IN UINT32 Value);
+VOID *  EFIAPI SetMem64 (OUT VOID *Buffer, IN UINTN Length, IN UINT64 Value);
+VOID *  EFIAPI ZeroMem (OUT VOID *Buffer, IN UINTN Length);
+INTN    EFIAPI CompareMem (IN CONST VOID *DestinationBuffer, IN CONST VOID *SourceBuffer, IN UINTN Length);
+BOOLEAN EFIAPI CompareGuid (IN CONST GUID *Guid1, IN CONST GUID *Guid2);
+GUID *  EFIAPI CopyGuid (OUT GUID *DestinationGuid, IN CONST GUID *SourceGuid);
+
+#endif
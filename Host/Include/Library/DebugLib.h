@@ -0,0 +1,76 @@
+/** @file
+  Debug messages and assertions of the DebugLib class, for the host build.
+
+  Messages go to stderr. Define MDEPKG_NDEBUG to compile them out, along with
+  the assertions and the DEBUG_CODE() blocks, as in a RELEASE build.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __HOST_DEBUG_LIB_H__
+#define __HOST_DEBUG_LIB_H__
+
+#define DEBUG_INIT      0x00000001
+#define DEBUG_WARN      0x00000002
+#define DEBUG_LOAD      0x00000004
+#define DEBUG_FS        0x00000008
+#define DEBUG_INFO      0x00000040
+#define DEBUG_VERBOSE   0x00400000
+#define DEBUG_ERROR     0x80000000
+
+#define EFI_D_INIT      DEBUG_INIT
+#define EFI_D_WARN      DEBUG_WARN
+#define EFI_D_LOAD      DEBUG_LOAD
+#define EFI_D_FS        DEBUG_FS
+#define EFI_D_INFO      DEBUG_INFO
+#define EFI_D_VERBOSE   DEBUG_VERBOSE
+#define EFI_D_ERROR     DEBUG_ERROR
+
+VOID
+EFIAPI
+DebugPrint (
+  IN  UINTN        ErrorLevel,
+  IN  CONST CHAR8  *Format,
+  ...
+  );
+
+VOID
+EFIAPI
+DebugAssert (
+  IN CONST CHAR8  *FileName,
+  IN UINTN        LineNumber,
+  IN CONST CHAR8  *Description
+  );
+
+#ifndef MDEPKG_NDEBUG
+#define DEBUG(Expression)     do { DebugPrint Expression; } while (FALSE)
+#define ASSERT(Expression) \
+  do { \
+    if (!(Expression)) { \
+      DebugAssert (__FILE__, __LINE__, #Expression); \
+    } \
+  } while (FALSE)
+#define DEBUG_CODE_BEGIN()    do { UINT8  __DebugCodeLocal
+#define DEBUG_CODE_END()      __DebugCodeLocal = 0; __DebugCodeLocal++; } while (FALSE)
+#else
+#define DEBUG(Expression)     do { } while (FALSE)
+#define ASSERT(Expression)    do { } while (FALSE)
+#define DEBUG_CODE_BEGIN()    do { if (FALSE) { UINT8  __DebugCodeLocal
+#define DEBUG_CODE_END()      __DebugCodeLocal = 0; __DebugCodeLocal++; } } while (FALSE)
+#endif
+
+#define ASSERT_EFI_ERROR(StatusParameter)  ASSERT (!EFI_ERROR (StatusParameter))
+#define DEBUG_CODE(Expression)  \
+  DEBUG_CODE_BEGIN ();          \
+  Expression                    \
+  DEBUG_CODE_END ()
+
+#endif
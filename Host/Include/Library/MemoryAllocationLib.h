@@ -0,0 +1,28 @@
+/** @file
+  Pool and page allocation functions of the MemoryAllocationLib class, for
+  the host build.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __HOST_MEMORY_ALLOCATION_LIB_H__
+#define __HOST_MEMORY_ALLOCATION_LIB_H__
+
+VOID *  EFIAPI AllocatePool (IN UINTN AllocationSize);
+VOID *  EFIAPI AllocateZeroPool (IN UINTN AllocationSize);
+VOID *  EFIAPI AllocateRuntimePool (IN UINTN AllocationSize);
+VOID *  EFIAPI AllocateCopyPool (IN UINTN AllocationSize, IN CONST VOID *Buffer);
+VOID *  EFIAPI ReallocatePool (IN UINTN OldSize, IN UINTN NewSize, IN VOID *OldBuffer OPTIONAL);
+VOID    EFIAPI FreePool (IN VOID *Buffer);
+VOID *  EFIAPI AllocatePages (IN UINTN Pages);
+VOID    EFIAPI FreePages (IN VOID *Buffer, IN UINTN Pages);
+
+#endif
@@ -0,0 +1,25 @@
+/** @file
+  Performance counter functions of the TimerLib class, for the host build.
+  The counter is the monotonic clock of the host, in nanoseconds.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __HOST_TIMER_LIB_H__
+#define __HOST_TIMER_LIB_H__
+
+UINTN   EFIAPI MicroSecondDelay (IN UINTN MicroSeconds);
+UINTN   EFIAPI NanoSecondDelay (IN UINTN NanoSeconds);
+UINT64  EFIAPI GetPerformanceCounter (VOID);
+UINT64  EFIAPI GetPerformanceCounterProperties (OUT UINT64 *StartValue OPTIONAL, OUT UINT64 *EndValue OPTIONAL);
+UINT64  EFIAPI GetTimeInNanoSecond (IN UINT64 Ticks);
+
+#endif
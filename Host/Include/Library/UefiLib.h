@@ -0,0 +1,25 @@
+/** @file
+  Console output and configuration table functions of the UefiLib class,
+  for the host build.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __HOST_UEFI_LIB_H__
+#define __HOST_UEFI_LIB_H__
+
+#include <Library/UefiBootServicesTableLib.h>
+
+UINTN       EFIAPI Print (IN CONST CHAR16 *Format, ...);
+UINTN       EFIAPI AsciiPrint (IN CONST CHAR8 *Format, ...);
+EFI_STATUS  EFIAPI EfiGetSystemConfigurationTable (IN EFI_GUID *TableGuid, OUT VOID **Table);
+
+#endif
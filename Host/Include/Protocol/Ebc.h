@@ -0,0 +1,78 @@
+/** @file
+  EBC protocol and EBC instruction encodings, for the host build.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __HOST_EBC_PROTOCOL_H__
+#define __HOST_EBC_PROTOCOL_H__
+
+#define EFI_EBC_INTERPRETER_PROTOCOL_GUID \
+  { \
+    0x13AC6DD1, 0x73D0, 0x11D4, {0xB0, 0x6B, 0x00, 0xAA, 0x00, 0xBD, 0x6D, 0xE7 } \
+  }
+
+#define EFI_EBC_PROTOCOL_GUID EFI_EBC_INTERPRETER_PROTOCOL_GUID
+
+typedef struct _EFI_EBC_PROTOCOL EFI_EBC_PROTOCOL;
+
+typedef
+EFI_STATUS
+(EFIAPI *EFI_EBC_CREATE_THUNK)(
+  IN EFI_EBC_PROTOCOL           *This,
+  IN EFI_HANDLE                 ImageHandle,
+  IN VOID                       *EbcEntryPoint,
+  OUT VOID                      **Thunk
+  );
+
+typedef
+EFI_STATUS
+(EFIAPI *EFI_EBC_UNLOAD_IMAGE)(
+  IN EFI_EBC_PROTOCOL           *This,
+  IN EFI_HANDLE                 ImageHandle
+  );
+
+typedef
+EFI_STATUS
+(EFIAPI *EBC_ICACHE_FLUSH)(
+  IN EFI_PHYSICAL_ADDRESS     Start,
+  IN UINT64                   Length
+  );
+
+typedef
+EFI_STATUS
+(EFIAPI *EFI_EBC_REGISTER_ICACHE_FLUSH)(
+  IN EFI_EBC_PROTOCOL           *This,
+  IN EBC_ICACHE_FLUSH           Flush
+  );
+
+typedef
+EFI_STATUS
+(EFIAPI *EFI_EBC_GET_VERSION)(
+  IN EFI_EBC_PROTOCOL           *This,
+  IN OUT UINT64                 *Version
+  );
+
+struct _EFI_EBC_PROTOCOL {
+  EFI_EBC_CREATE_THUNK          CreateThunk;
+  EFI_EBC_UNLOAD_IMAGE          UnloadImage;
+  EFI_EBC_REGISTER_ICACHE_FLUSH RegisterICacheFlush;
+  EFI_EBC_GET_VERSION           GetVersion;
+};
+
+extern EFI_GUID gEfiEbcProtocolGuid;
+
+//
+// MdePkg keeps the instruction encodings in this header
+//
+#include <Protocol/DebugSupport.h>
+
+#endif
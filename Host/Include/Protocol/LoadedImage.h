@@ -0,0 +1,60 @@
+/** @file
+  Loaded image protocol and the firmware file device path node, for the host
+  build.
+
+Copyright (c) 2016, Pete Batard. All rights reserved.<BR>
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __HOST_LOADED_IMAGE_PROTOCOL_H__
+#define __HOST_LOADED_IMAGE_PROTOCOL_H__
+
+#define EFI_LOADED_IMAGE_PROTOCOL_GUID \
+  { \
+    0x5B1B31A1, 0x9562, 0x11D2, {0x8E, 0x3F, 0x00, 0xA0, 0xC9, 0x69, 0x72, 0x3B } \
+  }
+
+#define EFI_LOADED_IMAGE_PROTOCOL_REVISION  0x1000
+
+typedef struct {
+  UINT32                    Revision;
+  EFI_HANDLE                ParentHandle;
+  EFI_SYSTEM_TABLE          *SystemTable;
+  EFI_HANDLE                DeviceHandle;
+  EFI_DEVICE_PATH_PROTOCOL  *FilePath;
+  VOID                      *Reserved;
+  UINT32                    LoadOptionsSize;
+  VOID                      *LoadOptions;
+  VOID                      *ImageBase;
+  UINT64                    ImageSize;
+  EFI_MEMORY_TYPE           ImageCodeType;
+  EFI_MEMORY_TYPE           ImageDataType;
+  EFI_IMAGE_UNLOAD          Unload;
+} EFI_LOADED_IMAGE_PROTOCOL;
+
+#define MEDIA_DEVICE_PATH         0x04
+#define MEDIA_FILEPATH_DP         0x04
+#define MEDIA_PIWG_FW_FILE_DP     0x06
+#define END_DEVICE_PATH_TYPE      0x7F
+#define END_ENTIRE_DEVICE_PATH_SUBTYPE  0xFF
+
+typedef struct {
+  EFI_DEVICE_PATH_PROTOCOL  Header;
+  CHAR16                    PathName[1];
+} FILEPATH_DEVICE_PATH;
+
+typedef struct {
+  EFI_DEVICE_PATH_PROTOCOL  Header;
+  EFI_GUID                  FvFileName;
+} MEDIA_FW_VOL_FILEPATH_DEVICE_PATH;
+
+extern EFI_GUID gEfiLoadedImageProtocolGuid;
+
+#endif
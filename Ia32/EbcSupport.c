@@ -25,8 +25,6 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 //
 #define VM_STACK_SIZE   (1024 * 4)
 
-#define STACK_REMAIN_SIZE (1024 * 4)
-
 //
 // This is instruction buffer used to create EBC thunk
 //
@@ -261,12 +259,12 @@ EbcInterpret (
   //
   // Allocate stack pool
   //
-  Status = GetEBCStack((EFI_HANDLE)-1, &VmContext.StackPool, &StackIndex);
+  Status = GetEBCStack (EbcFindImageHandle (Addr), &VmContext.StackPool, &StackIndex);
   if (EFI_ERROR(Status)) {
     return Status;
   }
   VmContext.StackTop = (UINT8*)VmContext.StackPool + (STACK_REMAIN_SIZE);
-  VmContext.Gpr[0] = (UINT64)(UINTN) ((UINT8*)VmContext.StackPool + STACK_POOL_SIZE);
+  VmContext.Gpr[0] = (UINT64)(UINTN) ((UINT8*)VmContext.StackPool + GetEBCStackSize (StackIndex));
   VmContext.HighStackBottom = (UINTN)VmContext.Gpr[0];
   VmContext.Gpr[0] &= ~((VM_REGISTER)(sizeof (UINTN) - 1));
   VmContext.Gpr[0] -= sizeof (UINTN);
@@ -405,7 +403,7 @@ ExecuteEbcImageEntryPoint (
     return Status;
   }
   VmContext.StackTop = (UINT8*)VmContext.StackPool + (STACK_REMAIN_SIZE);
-  VmContext.Gpr[0] = (UINT64)(UINTN) ((UINT8*)VmContext.StackPool + STACK_POOL_SIZE);
+  VmContext.Gpr[0] = (UINT64)(UINTN) ((UINT8*)VmContext.StackPool + GetEBCStackSize (StackIndex));
   VmContext.HighStackBottom = (UINTN)VmContext.Gpr[0];
   VmContext.Gpr[0] -= sizeof (UINTN);
 
@@ -18,7 +18,7 @@
 #define __EFI_DEBUGGER_CONFIGURATION_H__
 
 #define EFI_DEBUGGER_CONFIGURATION_PROTOCOL_GUID \
-  { 0x577d959c, 0xe967, 0x4546, 0x86, 0x20, 0xc7, 0x78, 0xfa, 0xe5, 0xda, 0x5 }
+  { 0x577d959c, 0xe967, 0x4546, { 0x86, 0x20, 0xc7, 0x78, 0xfa, 0xe5, 0xda, 0x5 } }
 
 #define EFI_DEBUGGER_CONFIGURATION_VERSION  0x00000001
 
@@ -0,0 +1,124 @@
+/*++
+
+Copyright (c) 2016 - Pete Batard <pete@akeo.ie>
+
+All rights reserved. This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+Module Name:
+
+TimerLib.c
+
+Abstract:
+
+Performance counter, as provided by the EDK2 TimerLib. The time stamp counter
+is used on x86 and x64, with its frequency measured against Stall(). The
+virtual count of the generic timer is used on ARM, with the frequency that the
+firmware programmed in CNTFRQ.
+
+--*/
+
+#include <Uefi.h>
+#if defined (MDE_CPU_X64) || defined (MDE_CPU_IA32) || defined (MDE_CPU_ARM)
+#include <intrin.h>
+#endif
+
+#if defined (MDE_CPU_X64) || defined (MDE_CPU_IA32)
+UINT64 mPerformanceCounterFrequency = 0;
+
+UINT64
+EFIAPI
+GetPerformanceCounter (
+  VOID
+  )
+{
+  return (UINT64) __rdtsc ();
+}
+
+UINT64
+EFIAPI
+GetPerformanceCounterProperties (
+  OUT UINT64  *StartValue,  OPTIONAL
+  OUT UINT64  *EndValue     OPTIONAL
+  )
+{
+  UINT64  Start;
+
+  if (StartValue != NULL) {
+    *StartValue = 0;
+  }
+  if (EndValue != NULL) {
+    *EndValue = (UINT64) -1;
+  }
+  //
+  // Measure the frequency on a 10 ms stall, the first time only
+  //
+  if (mPerformanceCounterFrequency == 0) {
+    Start = GetPerformanceCounter ();
+    gBS->Stall (10000);
+    mPerformanceCounterFrequency = (GetPerformanceCounter () - Start) * 100;
+  }
+  return mPerformanceCounterFrequency;
+}
+#elif defined (MDE_CPU_ARM)
+UINT64
+EFIAPI
+GetPerformanceCounter (
+  VOID
+  )
+{
+  //
+  // MRRC p15, 1, <Rt>, <Rt2>, c14 (CNTVCT)
+  //
+  return (UINT64) _MoveFromCoprocessor64 (15, 1, 14);
+}
+
+UINT64
+EFIAPI
+GetPerformanceCounterProperties (
+  OUT UINT64  *StartValue,  OPTIONAL
+  OUT UINT64  *EndValue     OPTIONAL
+  )
+{
+  if (StartValue != NULL) {
+    *StartValue = 0;
+  }
+  if (EndValue != NULL) {
+    *EndValue = (UINT64) -1;
+  }
+  //
+  // MRC p15, 0, <Rt>, c14, c0, 0 (CNTFRQ)
+  //
+  return (UINT64) _MoveFromCoprocessor (15, 0, 14, 0, 0);
+}
+#else
+UINT64
+EFIAPI
+GetPerformanceCounter (
+  VOID
+  )
+{
+  return 0;
+}
+
+UINT64
+EFIAPI
+GetPerformanceCounterProperties (
+  OUT UINT64  *StartValue,  OPTIONAL
+  OUT UINT64  *EndValue     OPTIONAL
+  )
+{
+  if (StartValue != NULL) {
+    *StartValue = 0;
+  }
+  if (EndValue != NULL) {
+    *EndValue = 0;
+  }
+  return 0;
+}
+#endif